@@ -730,6 +730,11 @@ def midi_autoconnect():
     # Connect ZynMidiRouter:step_out to ZynthStep input
     required_routes["zynseq:input"].add("ZynMidiRouter:step_out")
 
+    # Connect MIDI Input Devices to zynmixer MIDI input (in-engine CC control)
+    if "zynmixer:midi_in" in required_routes:
+        for hwsp in hw_midi_src_ports:
+            required_routes["zynmixer:midi_in"].add(hwsp.name)
+
     # Connect ZynMidiRouter:ctrl_out to enabled MIDI-FB ports (MIDI-Controller FeedBack)
     # TODO => We need a new mechanism for this!! Or simply use the ctrldev drivers
     # for port in hw_midi_dst_ports:
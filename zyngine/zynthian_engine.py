@@ -496,6 +496,16 @@ class zynthian_engine(zynthian_basic_engine):
     def preset_exists(self, bank_info, preset_name):
         logging.error("Not implemented!!!")
 
+    def defer_controllers_state(self, processor, ctrls_state):
+        """Hold controllers state until engine is ready to apply it, e.g. whilst preset loads in background
+
+        processor : Processor object
+        ctrls_state : Dictionary of controller states, indexed by symbol
+        Returns : True if deferred, in which case engine calls processor.set_controllers_state when ready
+        """
+
+        return False
+
     # Implement in derived classes to enable features in GUI
     # def save_preset(self, bank_name, preset_name):
     # def delete_preset(self, bank_info, preset_info):
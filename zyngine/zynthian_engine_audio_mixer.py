@@ -40,6 +40,13 @@ class zynmixer(zynthian_engine):
     # Subsignals are defined inside each module. Here we define audio_mixer subsignals:
     SS_ZCTRL_SET_VALUE = 1
 
+    # In-engine MIDI CC parameter indexes (MIXER_PARAM_xxx) indexed by symbol
+    MIDI_PARAMS = {'level': 1, 'balance': 2, 'mute': 3, 'solo': 4, 'mono': 5, 'phase': 6, 'ms': 7}
+    # In-engine MIDI CC mapping flags (MIXER_CC_xxx)
+    MIDI_CC_14BIT = 0x01
+    MIDI_CC_TAKEOVER = 0x02
+    MIDI_CC_MOMENTARY = 0x04
+
     # Function to initialize library
     def __init__(self):
         super().__init__()
@@ -105,6 +112,30 @@ class zynmixer(zynthian_engine):
 
         self.lib_zynmixer.getMaxChannels.restype = ctypes.c_uint8
 
+        self.lib_zynmixer.setSilenceThreshold.argtypes = [ctypes.c_float]
+        self.lib_zynmixer.getSilenceThreshold.restype = ctypes.c_float
+        self.lib_zynmixer.setSilenceHangover.argtypes = [ctypes.c_uint32]
+        self.lib_zynmixer.getSilenceHangover.restype = ctypes.c_uint32
+        self.lib_zynmixer.isChannelSilent.argtypes = [ctypes.c_uint8]
+        self.lib_zynmixer.isChannelSilent.restype = ctypes.c_uint8
+        self.lib_zynmixer.getSilenceSaving.restype = ctypes.c_float
+
+        self.lib_zynmixer.setMidiCcMap.argtypes = [
+            ctypes.c_uint8, ctypes.c_uint8, ctypes.c_uint8, ctypes.c_uint8, ctypes.c_uint8]
+        self.lib_zynmixer.setMidiCcMap.restype = ctypes.c_uint8
+        self.lib_zynmixer.getMidiCcMap.argtypes = [ctypes.c_uint8, ctypes.c_uint8, ctypes.POINTER(
+            ctypes.c_uint8), ctypes.POINTER(ctypes.c_uint8)]
+        self.lib_zynmixer.getMidiCcMap.restype = ctypes.c_uint8
+        self.lib_zynmixer.learnMidiCc.argtypes = [
+            ctypes.c_uint8, ctypes.c_uint8, ctypes.c_uint8]
+        self.lib_zynmixer.isMidiLearning.restype = ctypes.c_uint8
+        self.lib_zynmixer.getMidiChanges.restype = ctypes.c_uint32
+        self.lib_zynmixer.startCapture.argtypes = [ctypes.c_char_p]
+        self.lib_zynmixer.startCapture.restype = ctypes.c_uint8
+        self.lib_zynmixer.isCapturing.restype = ctypes.c_uint8
+        self.lib_zynmixer.replayCapture.argtypes = [ctypes.c_char_p]
+        self.lib_zynmixer.replayCapture.restype = ctypes.c_int32
+
         self.MAX_NUM_CHANNELS = self.lib_zynmixer.getMaxChannels()
 
         # List of learned {cc:zctrl} indexed by learned MIDI channel
@@ -547,6 +578,95 @@ class zynmixer(zynthian_engine):
             return
         self.lib_zynmixer.enableDpm(start, end, int(enable))
 
+    # Function to configure silence detection which skips processing of idle channels
+    # threshold: Level in dBFS below which input is considered silent (<= -200 to disable)
+    # hangover: Duration in ms input must be silent before processing is skipped
+    def set_silence_detection(self, threshold, hangover):
+        self.lib_zynmixer.setSilenceThreshold(threshold)
+        self.lib_zynmixer.setSilenceHangover(hangover)
+
+    # Function to get mixer processing statistics
+    # returns: Dictionary of silent channel indexes and proportion of channel processing skipped since previous call
+    def get_stats(self):
+        silent = [chan for chan in range(self.MAX_NUM_CHANNELS) if self.lib_zynmixer.isChannelSilent(chan)]
+        return {
+            "silent_channels": silent,
+            "silence_saving": self.lib_zynmixer.getSilenceSaving()
+        }
+
+    # Function to map a MIDI CC received on zynmixer:midi_in to a mixer parameter (processed within jack process)
+    # midi_chan: MIDI channel (0..15)
+    # cc: MIDI CC number (MSB 0..31 for 14-bit)
+    # channel: Index of mixer channel
+    # symbol: Parameter symbol ('level', 'balance', 'mute', 'solo', 'mono', 'phase', 'ms') or None to remove
+    # flags: Bitwise MIDI_CC_xxx flags
+    # returns: True on success
+    def set_midi_cc_map(self, midi_chan, cc, channel, symbol, flags=0):
+        if channel >= self.MAX_NUM_CHANNELS:
+            channel = self.MAX_NUM_CHANNELS - 1
+        param = self.MIDI_PARAMS.get(symbol, 0)
+        return bool(self.lib_zynmixer.setMidiCcMap(midi_chan, cc, channel, param, flags))
+
+    # Function to get mixer parameter mapped to a MIDI CC
+    # midi_chan: MIDI channel (0..15)
+    # cc: MIDI CC number
+    # returns: Tuple (channel, symbol, flags) or None if not mapped
+    def get_midi_cc_map(self, midi_chan, cc):
+        channel = ctypes.c_uint8()
+        flags = ctypes.c_uint8()
+        param = self.lib_zynmixer.getMidiCcMap(midi_chan, cc, ctypes.byref(channel), ctypes.byref(flags))
+        for symbol, p in self.MIDI_PARAMS.items():
+            if p == param:
+                return (channel.value, symbol, flags.value)
+        return None
+
+    # Function to remove all in-engine MIDI CC mappings
+    def clear_midi_cc_map(self):
+        self.lib_zynmixer.clearMidiCcMap()
+
+    # Function to map next MIDI CC received on zynmixer:midi_in to a mixer parameter
+    # channel: Index of mixer channel
+    # symbol: Parameter symbol or None to cancel learn
+    # flags: Bitwise MIDI_CC_xxx flags
+    def learn_midi_cc(self, channel, symbol, flags=0):
+        if channel >= self.MAX_NUM_CHANNELS:
+            channel = self.MAX_NUM_CHANNELS - 1
+        self.lib_zynmixer.learnMidiCc(channel, self.MIDI_PARAMS.get(symbol, 0), flags)
+
+    # Function to check if waiting for in-engine MIDI learn
+    def is_midi_cc_learning(self):
+        return bool(self.lib_zynmixer.isMidiLearning())
+
+    # Function to update controllers of channels changed by in-engine MIDI CC
+    def refresh_midi_changes(self):
+        changes = self.lib_zynmixer.getMidiChanges()
+        chan = 0
+        while changes:
+            if changes & 1:
+                for symbol, zctrl in self.zctrls[chan].items():
+                    value = getattr(self, f"get_{symbol}")(chan)
+                    if value != zctrl.value:
+                        zctrl.set_value(value, False)
+                        zynsigman.send(zynsigman.S_AUDIO_MIXER, self.SS_ZCTRL_SET_VALUE,
+                                       chan=chan, symbol=symbol, value=value)
+            changes >>= 1
+            chan += 1
+
+    # Function to start capturing process inputs and API calls to a log for offline replay
+    # filename: Full path and filename of log
+    # Returns: True on success
+    def start_capture(self, filename):
+        return bool(self.lib_zynmixer.startCapture(bytes(filename, "utf-8")))
+
+    # Function to stop capturing process inputs
+    def stop_capture(self):
+        self.lib_zynmixer.stopCapture()
+
+    # Function to check if capturing process inputs
+    # Returns: True if capturing
+    def is_capturing(self):
+        return bool(self.lib_zynmixer.isCapturing())
+
     # Function to add OSC client registration
     # client: IP address of OSC client
     def add_osc_client(self, client):
@@ -591,6 +711,8 @@ class zynmixer(zynthian_engine):
         full : True to get state of all parameters or false for off-default values
         Returns : List of dictionaries describing parameter states
         """
+        # Controllers changed by in-engine MIDI CC since last poll
+        self.refresh_midi_changes()
         state = {}
         for chan in range(self.MAX_NUM_CHANNELS):
             key = 'chan_{:02d}'.format(chan)
@@ -608,6 +730,12 @@ class zynmixer(zynthian_engine):
             for chan in range(16):
                 for cc, zctrl in self.learned_cc[chan].items():
                     state["midi_learn"][f"{chan},{cc}"] = zctrl.graph_path
+        state["midi_cc_map"] = {}
+        for midi_chan in range(16):
+            for cc in range(128):
+                cc_map = self.get_midi_cc_map(midi_chan, cc)
+                if cc_map:
+                    state["midi_cc_map"][f"{midi_chan},{cc}"] = list(cc_map)
         return state
 
     def set_state(self, state, full=True):
@@ -640,6 +768,16 @@ class zynmixer(zynthian_engine):
                 except Exception as e:
                     logging.warning(
                         f"Failed to restore mixer midi learn: {ml} => {graph_path} ({e})")
+        if "midi_cc_map" in state:
+            # state["midi_cc_map"][f"{midi_chan},{cc}"] = [channel, symbol, flags]
+            self.clear_midi_cc_map()
+            for key, cc_map in state["midi_cc_map"].items():
+                try:
+                    midi_chan, cc = key.split(',')
+                    self.set_midi_cc_map(int(midi_chan), int(cc), *cc_map)
+                except Exception as e:
+                    logging.warning(
+                        f"Failed to restore mixer MIDI CC map: {key} => {cc_map} ({e})")
 
     # --------------------------------------------------------------------------
     # MIDI Learn
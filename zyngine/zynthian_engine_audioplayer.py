@@ -23,9 +23,11 @@
 # ******************************************************************************
 
 import os
+import select
 import shutil
 import logging
 from glob import glob
+from threading import Thread, Lock
 
 from . import zynthian_engine
 from zynlibs.zynaudioplayer import *
@@ -42,6 +44,7 @@ class zynthian_engine_audioplayer(zynthian_engine):
 
     # Subsignals are defined inside each module. Here we define audio_recorder subsignals:
     SS_AUDIO_PLAYER_STATE = 1
+    SS_AUDIO_PLAYER_LOAD = 2  # File load completed (handle, success)
 
     # ---------------------------------------------------------------------------
     # Config variables
@@ -82,6 +85,8 @@ class zynthian_engine_audioplayer(zynthian_engine):
         self.custom_gui_fpath = "/zynthian/zynthian-ui/zyngui/zynthian_widget_audioplayer.py"
 
         self.monitors_dict = {}
+        self.pending_loads = {}  # Dictionary of loads in progress, indexed by player handle
+        self.load_lock = Lock()
         self.start()
         self.reset()
 
@@ -91,10 +96,21 @@ class zynthian_engine_audioplayer(zynthian_engine):
 
     def start(self):
         self.jackname = zynaudioplayer.get_jack_client_name()
+        # Keep prewarmed players ready to avoid delay when adding chains or loading snapshots
+        zynaudioplayer.set_pool_size(int(os.environ.get('ZYNTHIAN_AUDIOPLAYER_POOL_SIZE', 2)))
+        # Optionally degrade time stretch quality of players rather than xrun when DSP load is high
+        zynaudioplayer.enable_stretch_governor(os.environ.get('ZYNTHIAN_AUDIOPLAYER_STRETCH_GOVERNOR', '0') == '1')
         zynsigman.register_queued(
             zynsigman.S_AUDIO_RECORDER, zynthian_audio_recorder.SS_AUDIO_RECORDER_STATE, self.update_rec)
+        self.load_thread_running = True
+        self.load_thread = Thread(target=self.load_thread_task, args=())
+        self.load_thread.name = "audio player load"
+        self.load_thread.daemon = True  # thread dies with the program
+        self.load_thread.start()
 
     def stop(self):
+        self.load_thread_running = False
+        self.load_thread.join()
         try:
             zynaudioplayer.stop()
             zynsigman.unregister(
@@ -129,6 +145,8 @@ class zynthian_engine_audioplayer(zynthian_engine):
         self.processor = processor
 
     def remove_processor(self, processor):
+        with self.load_lock:
+            self.pending_loads.pop(processor.handle, None)
         zynaudioplayer.remove_player(processor.handle)
         super().remove_processor(processor)
         if processor == self.processor:
@@ -202,10 +220,73 @@ class zynthian_engine_audioplayer(zynthian_engine):
         return glob(path) != []
 
     def set_preset(self, processor, preset, preload=False):
-        if zynaudioplayer.get_filename(processor.handle) == preset[0] and zynaudioplayer.get_file_duration(preset[0]) == zynaudioplayer.get_duration(processor.handle):
-            return False
+        if zynaudioplayer.get_filename(processor.handle) == preset[0]:
+            if processor.handle in self.pending_loads or zynaudioplayer.get_file_duration(preset[0]) == zynaudioplayer.get_duration(processor.handle):
+                return False
 
-        zynaudioplayer.load(processor.handle, preset[0])
+        # File is opened in background and controllers are updated when load completes (see load_complete)
+        logging.debug(
+            f"Loading Audio Track '{preset[0]}' in player {processor.handle}")
+        with self.load_lock:
+            if not zynaudioplayer.load_async(processor.handle, preset[0]):
+                logging.error(f"Failed to start loading Audio Track '{preset[0]}' in player {processor.handle}")
+                return False
+            self.pending_loads[processor.handle] = {"processor": processor, "preset": preset}
+        return True
+
+    def load_thread_task(self):
+        fd = zynaudioplayer.get_load_fd()
+        while self.load_thread_running:
+            # Timeout allows thread to exit and polls for results if eventfd is not available
+            if fd >= 0:
+                select.select([fd], [], [], 0.5)
+                try:
+                    os.read(fd, 8)
+                except BlockingIOError:
+                    pass
+            else:
+                select.select([], [], [], 0.1)
+            for handle, success in zynaudioplayer.get_load_results():
+                try:
+                    self.load_complete(handle, success)
+                except Exception as e:
+                    logging.error(f"Failed to complete load in player {handle} => {e}")
+
+    def load_complete(self, handle, success):
+        with self.load_lock:
+            if zynaudioplayer.is_loading(handle):
+                return  # Result of a load that was superseded
+            load = self.pending_loads.pop(handle, None)
+        if load is None:
+            return
+        if not success:
+            logging.warning(f"Failed to load Audio Track '{load['preset'][0]}' in player {handle}")
+        processor = load["processor"]
+        self.update_controllers(processor)
+        if "ctrls_state" in load:
+            processor.set_controllers_state(load["ctrls_state"])
+        if load.get("start"):
+            zynaudioplayer.start_playback(handle)
+        zynsigman.send(
+            zynsigman.S_AUDIO_PLAYER, self.SS_AUDIO_PLAYER_LOAD, handle=handle, success=success)
+
+    def defer_controllers_state(self, processor, ctrls_state):
+        with self.load_lock:
+            if processor.handle in self.pending_loads:
+                self.pending_loads[processor.handle]["ctrls_state"] = ctrls_state
+                return True
+        return False
+
+    def start_playback(self, processor):
+        """Start playback, waiting for load to complete if player is loading"""
+
+        with self.load_lock:
+            if processor.handle in self.pending_loads:
+                self.pending_loads[processor.handle]["start"] = True
+                return
+        zynaudioplayer.start_playback(processor.handle)
+
+    def update_controllers(self, processor):
         self.monitors_dict[processor.handle]['filename'] = zynaudioplayer.get_filename(
             processor.handle)
         self.monitors_dict[processor.handle]['frames'] = zynaudioplayer.get_frames(
@@ -224,8 +305,6 @@ class zynthian_engine_audioplayer(zynthian_engine):
             loop = 'looping'
         else:
             loop = 'one-shot'
-        logging.debug(
-            f"Loading Audio Track '{preset[0]}' in player {processor.handle}")
         if zynaudioplayer.get_playback_state(processor.handle):
             transport = 'playing'
         else:
@@ -343,8 +422,6 @@ class zynthian_engine_audioplayer(zynthian_engine):
         self.processor = processor
         zynaudioplayer.set_control_cb(self.control_cb)
 
-        return True
-
     def save_preset(self, bank_name, preset_name):
         if self.processor is None:
             return
@@ -461,6 +538,8 @@ class zynthian_engine_audioplayer(zynthian_engine):
                         ctrl_dict['release'].set_value(value, False)
                     elif id == 23:
                         ctrl_dict['varispeed'].set_value(value, False)
+                    elif id == zynaudioplayer.NOTIFY_STRETCH_TIER:
+                        logging.debug(f"Audio player {handle} stretch tier => {int(value)}")
                     break
         except Exception as e:
             logging.error(e)
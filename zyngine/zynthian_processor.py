@@ -739,17 +739,25 @@ class zynthian_processor:
                 # Legacy snapshots without preset_info
                 self.set_preset(state["preset_info"], force_set_engine=False)
         # Set controller values
-        if "controllers" in state:
-            for symbol, ctrl_state in state["controllers"].items():
-                try:
-                    zctrl = self.controllers_dict[symbol]
-                    if "value" in ctrl_state:
-                        zctrl.set_value(ctrl_state["value"], True)
-                    if "midi_cc_momentary_switch" in ctrl_state:
-                        zctrl.midi_cc_momentary_switch = ctrl_state['midi_cc_momentary_switch']
-                except Exception as e:
-                    logging.warning("Invalid controller for processor {}: {}".format(
-                        self.get_basepath(), e))
+        if "controllers" in state and not self.engine.defer_controllers_state(self, state["controllers"]):
+            self.set_controllers_state(state["controllers"])
+
+    def set_controllers_state(self, ctrls_state):
+        """Configure controllers from state model dictionary
+
+        ctrls_state : Dictionary of controller states, indexed by symbol
+        """
+
+        for symbol, ctrl_state in ctrls_state.items():
+            try:
+                zctrl = self.controllers_dict[symbol]
+                if "value" in ctrl_state:
+                    zctrl.set_value(ctrl_state["value"], True)
+                if "midi_cc_momentary_switch" in ctrl_state:
+                    zctrl.midi_cc_momentary_switch = ctrl_state['midi_cc_momentary_switch']
+            except Exception as e:
+                logging.warning("Invalid controller for processor {}: {}".format(
+                    self.get_basepath(), e))
 
     def restore_state_legacy(self, state):
         """Restore legacy states from state
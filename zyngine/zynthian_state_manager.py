@@ -632,6 +632,9 @@ class zynthian_state_manager:
                 # Sequencer Status => It must be improved using callbacks
                 self.zynseq.update_state()
 
+                # Mixer controllers changed by in-engine MIDI CC
+                self.zynmixer.refresh_midi_changes()
+
                 # Clean some status flags
                 if xruns_status:
                     self.status_xrun = False
@@ -2146,7 +2149,7 @@ class zynthian_state_manager:
             zynaudioplayer.start_playback(self.audio_player.handle)
         else:
             self.audio_player.engine.load_latest(self.audio_player)
-            zynaudioplayer.start_playback(self.audio_player.handle)
+            self.audio_player.engine.start_playback(self.audio_player)
 
     def stop_audio_player(self, reset_pos=False):
         zynaudioplayer.stop_playback(self.audio_player.handle)
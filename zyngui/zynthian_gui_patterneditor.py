@@ -1615,7 +1615,12 @@ class zynthian_gui_patterneditor(zynthian_gui_base.zynthian_gui_base):
         super().refresh_status()
         self.playstate = self.zynseq.libseq.getSequenceState(
             self.bank, self.sequence) & 0xff
-        step = self.zynseq.libseq.getPatternPlayhead()
+        # Playhead is read from library's monitor feed without locking its mutex
+        mon = self.zynseq.read_monitor()
+        if mon:
+            step = mon.pattern_playhead
+        else:
+            step = self.zynseq.libseq.getPatternPlayhead()
         if self.playhead != step:
             self.playhead = step
             self.play_canvas.coords("playCursor", 1 + self.playhead * self.step_width,
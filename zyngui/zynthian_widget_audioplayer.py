@@ -50,6 +50,7 @@ class zynthian_widget_audioplayer(zynthian_widget_base.zynthian_widget_base):
     def __init__(self, parent):
         super().__init__(parent)
         self.refreshing = False
+        self.monitor_slot = -1
         self.play_pos = 0.0
         self.loop_start = 0.0
         self.loop_end = 1.0
@@ -418,6 +419,11 @@ class zynthian_widget_audioplayer(zynthian_widget_base.zynthian_widget_base):
             self.drag_marker = option.lower()
             self.on_canvas_drag(event)
 
+    def set_processor(self, processor):
+        super().set_processor(processor)
+        # Playhead is read from library's monitor feed each refresh
+        self.monitor_slot = zynaudioplayer.get_monitor_slot(processor.handle)
+
     def get_monitors(self):
         self.monitors = self.processor.engine.get_monitors_dict(
             self.processor.handle)
@@ -584,7 +590,11 @@ class zynthian_widget_audioplayer(zynthian_widget_base.zynthian_widget_base):
             cue_pos = int(self.samplerate *
                           self.processor.controllers_dict['cue pos'].value)
             selected_cue = self.processor.controllers_dict['cue'].value
-            pos_time = self.processor.controllers_dict['position'].value
+            mon = zynaudioplayer.read_monitor(self.monitor_slot)
+            if mon and mon.file_open == zynaudioplayer.FILE_OPEN:
+                pos_time = mon.position
+            else:
+                pos_time = self.processor.controllers_dict['position'].value
             pos = int(pos_time * self.samplerate * self.speed)
             refresh_info = False
 
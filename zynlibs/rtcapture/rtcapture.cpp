@@ -0,0 +1,500 @@
+/*  Defines capture and replay of process thread inputs shared by zynlibs
+ *
+ *   Copyright (c) 2020 Brian Walton
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "rtcapture.h"
+#include <atomic>            // provides atomic
+#include <cerrno>            // provides ENODATA
+#include <chrono>            // provides time durations
+#include <jack/ringbuffer.h> // provides lock-free ringbuffer
+#include <mutex>             // provides mutex for API ringbuffer
+#include <stdio.h>           // provides fprintf, file access
+#include <thread>            // provides writer thread
+#include <vector>            // provides vector
+
+#define CAPTURE_IDLE 0    // Not capturing
+#define CAPTURE_PENDING 1 // Waiting for first period to record runtime state
+#define CAPTURE_RUNNING 2 // Capturing
+
+#define REPLAY_MAX_EVENTS 4096  // Maximum quantity of events in a replay MIDI buffer
+#define REPLAY_MAX_DATA 65536   // Maximum quantity of bytes in a replay MIDI buffer
+#define JACK_MIDI_EVENT_SIZE 12 // Size of JACK2 MIDI event header within port buffer
+#define JACK_MIDI_INLINE_SIZE 4 // Largest event that JACK2 stores within event header
+
+struct REPLAY_MIDI {
+    jack_nframes_t frames = 0;                   // Quantity of frames in period
+    uint32_t capacity     = 0;                   // Largest event that fits in empty buffer
+    uint32_t count        = 0;                   // Quantity of events in buffer
+    uint32_t used         = 0;                   // Quantity of bytes stored outside event headers (JACK2 accounting)
+    uint32_t dataPos      = 0;                   // Offset of next free byte in data
+    jack_midi_event_t events[REPLAY_MAX_EVENTS]; // Events
+    uint8_t data[REPLAY_MAX_DATA];               // Event data
+};
+
+// Library is loaded with dlopen so TLS accessed from process thread uses initial-exec model to avoid lazy allocation by __tls_get_addr
+static thread_local bool t_bProcessThread __attribute__((tls_model("initial-exec"))) = false; // True in process thread
+static thread_local uint32_t t_nApiDepth __attribute__((tls_model("initial-exec"))) = 0;      // Depth of nested API calls in this thread
+
+// Capture
+static char s_sLibrary[12]                = "";             // Name of library used in messages
+static std::atomic<uint8_t> s_nState{CAPTURE_IDLE};         // Capture state [CAPTURE_IDLE | CAPTURE_PENDING | CAPTURE_RUNNING]
+static uint32_t s_nPeriod                 = 0;              // Quantity of period records made since start of capture
+static std::atomic<uint32_t> s_nStep{0};                    // Quantity of process thread records made since start of capture
+static std::atomic<uint32_t> s_nCallbackSeq{0};             // Incremented at start and end of each process thread callback (odd whilst in callback)
+static std::atomic<bool> s_bLost{false};                    // True if a record could not be written to ringbuffer
+static std::atomic<bool> s_bWriterRunning{false};           // False to stop writer thread
+static jack_ringbuffer_t* s_pRing         = NULL;           // Records from process thread
+static jack_ringbuffer_t* s_pApiRing      = NULL;           // Records from API calls
+static std::mutex s_mutexApi;                               // Excludes API calls from each other (process thread never takes it)
+static std::thread s_threadWriter;                          // Thread draining ringbuffers to file
+static FILE* s_pFile                      = NULL;           // Log file
+static bool s_bCallbackCapture            = false;          // True if capture was active at start of current callback
+static CAPTURE_API_DATA s_api;                              // API call in progress (populated whilst holding s_mutexApi)
+static uint8_t s_aApiArgs[CAPTURE_MAX_API_ARGS];            // Packed arguments of API call in progress
+static uint32_t s_nApiSeq                 = 0;              // Callback sequence at start of API call in progress
+alignas(8) static uint8_t s_aRecord[CAPTURE_MAX_RECORD];    // Process thread record being populated
+static uint8_t s_nRecordType              = 0;              // Type of record being populated (0 if none)
+static uint32_t s_nRecordSize             = 0;              // Size of record being populated
+static bool s_bRecordOverflow             = false;          // True if record being populated exceeded CAPTURE_MAX_RECORD
+
+// Replay
+static bool s_bReplay                     = false;          // True whilst a log is open for replay
+static std::vector<uint8_t> s_vReplayLog;                   // Records of log open for replay
+
+// Write a complete record to a ringbuffer - returns false and flags loss if insufficient space
+static bool push(jack_ringbuffer_t* pRing, uint8_t type, const void* pData, uint32_t nSize, const void* pData2 = NULL, uint32_t nSize2 = 0) {
+    CAPTURE_RECORD record = {type, {0, 0, 0}, nSize + nSize2};
+    if (jack_ringbuffer_write_space(pRing) < sizeof(record) + record.size) {
+        s_bLost = true;
+        return false;
+    }
+    jack_ringbuffer_write(pRing, (const char*)&record, sizeof(record));
+    jack_ringbuffer_write(pRing, (const char*)pData, nSize);
+    if (nSize2)
+        jack_ringbuffer_write(pRing, (const char*)pData2, nSize2);
+    return true;
+}
+
+// Write complete records from a ringbuffer to log file
+static void drain(jack_ringbuffer_t* pRing) {
+    static uint8_t aBuffer[sizeof(CAPTURE_RECORD) + CAPTURE_MAX_RECORD];
+    CAPTURE_RECORD record;
+    while (jack_ringbuffer_read_space(pRing) >= sizeof(record)) {
+        jack_ringbuffer_peek(pRing, (char*)&record, sizeof(record));
+        size_t nSize = sizeof(record) + record.size;
+        if (jack_ringbuffer_read_space(pRing) < nSize)
+            break; // Record not yet complete
+        if (nSize > sizeof(aBuffer)) {
+            // Cannot occur unless ringbuffer corrupt
+            jack_ringbuffer_read_advance(pRing, nSize);
+            s_bLost = true;
+            continue;
+        }
+        jack_ringbuffer_read(pRing, (char*)aBuffer, nSize);
+        fwrite(aBuffer, nSize, 1, s_pFile);
+    }
+}
+
+// Writer thread - drains ringbuffers to log file until stopped
+static void writer() {
+    while (true) {
+        bool bRunning = s_bWriterRunning;
+        drain(s_pRing);
+        drain(s_pApiRing);
+        if (s_bLost.exchange(false)) {
+            CAPTURE_RECORD record = {CAPTURE_RECORD_LOST, {0, 0, 0}, 0};
+            fwrite(&record, sizeof(record), 1, s_pFile);
+            fprintf(stderr, "lib%s capture ringbuffer overflow - log incomplete\n", s_sLibrary);
+        }
+        if (!bRunning)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    fflush(s_pFile);
+}
+
+bool captureStart(const char* filename, const char* library, uint32_t nVersion, uint32_t nSampleRate, uint32_t nSeed, uint32_t nStateSize) {
+    if (s_pFile || s_bReplay || nStateSize > CAPTURE_MAX_RECORD)
+        return false;
+    strncpy(s_sLibrary, library, sizeof(s_sLibrary) - 1);
+    if (!s_pRing) {
+        // Allocate once and keep - process thread may still hold a reference after a previous stop
+        s_pRing    = jack_ringbuffer_create(CAPTURE_RING_SIZE);
+        s_pApiRing = jack_ringbuffer_create(CAPTURE_API_RING_SIZE);
+        if (!s_pRing || !s_pApiRing) {
+            fprintf(stderr, "lib%s failed to allocate capture ringbuffers\n", s_sLibrary);
+            return false;
+        }
+        jack_ringbuffer_mlock(s_pRing);
+        jack_ringbuffer_mlock(s_pApiRing);
+    }
+    jack_ringbuffer_reset(s_pRing);
+    jack_ringbuffer_reset(s_pApiRing);
+    s_pFile = fopen(filename, "wb");
+    if (!s_pFile) {
+        fprintf(stderr, "lib%s failed to open capture file %s\n", s_sLibrary, filename);
+        return false;
+    }
+    CAPTURE_HEADER header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "zcap", 4);
+    strncpy(header.library, library, sizeof(header.library) - 1);
+    header.version    = nVersion;
+    header.sampleRate = nSampleRate;
+    header.seed       = nSeed;
+    header.stateSize  = nStateSize;
+    fwrite(&header, sizeof(header), 1, s_pFile);
+    s_nPeriod        = 0;
+    s_nStep          = 0;
+    s_bLost          = false;
+    s_bWriterRunning = true;
+    s_threadWriter   = std::thread(writer);
+    return true;
+}
+
+void captureArm() {
+    if (s_pFile)
+        s_nState = CAPTURE_PENDING;
+}
+
+void captureStop() {
+    if (!s_pFile)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(s_mutexApi); // Wait for API call in progress to be recorded
+        s_nState = CAPTURE_IDLE;
+    }
+    // Wait for callback that may have started capturing before state changed so that all its records are in the ringbuffer
+    while (s_nCallbackSeq & 1)
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    s_bWriterRunning = false;
+    if (s_threadWriter.joinable())
+        s_threadWriter.join();
+    fclose(s_pFile);
+    s_pFile = NULL;
+}
+
+bool captureIsRunning() { return s_nState != CAPTURE_IDLE; }
+
+bool captureIsPending() { return s_nState == CAPTURE_PENDING; }
+
+bool captureBeginCallback() {
+    t_bProcessThread = true;
+    ++s_nCallbackSeq;
+    s_bCallbackCapture = (s_nState != CAPTURE_IDLE);
+    return s_bCallbackCapture && s_nState == CAPTURE_RUNNING;
+}
+
+void captureEndCallback() {
+    s_bCallbackCapture = false;
+    ++s_nCallbackSeq;
+}
+
+bool captureState(const void* pState, uint32_t nSize) {
+    uint8_t nState = CAPTURE_PENDING;
+    if (!s_bCallbackCapture || !s_nState.compare_exchange_strong(nState, CAPTURE_RUNNING))
+        return false;
+    push(s_pRing, CAPTURE_RECORD_STATE, pState, nSize);
+    ++s_nStep;
+    return true;
+}
+
+void* captureRecordBegin(uint8_t type, uint32_t nSize) {
+    if (nSize > CAPTURE_MAX_RECORD)
+        return NULL;
+    memset(s_aRecord, 0, nSize);
+    s_nRecordType     = type;
+    s_nRecordSize     = nSize;
+    s_bRecordOverflow = false;
+    return s_aRecord;
+}
+
+bool captureRecordIsOpen() { return s_nRecordType != 0; }
+
+void* captureRecordFixed() { return s_nRecordType ? s_aRecord : NULL; }
+
+void* captureRecordReserve(uint32_t nSize) {
+    if (!s_nRecordType || s_bRecordOverflow)
+        return NULL;
+    if (s_nRecordSize + nSize > CAPTURE_MAX_RECORD) {
+        s_bRecordOverflow = true;
+        return NULL;
+    }
+    void* pData = s_aRecord + s_nRecordSize;
+    s_nRecordSize += nSize;
+    return pData;
+}
+
+bool captureRecordAppend(const void* pData, uint32_t nSize) {
+    void* pDest = captureRecordReserve(nSize);
+    if (!pDest)
+        return false;
+    memcpy(pDest, pData, nSize);
+    return true;
+}
+
+bool captureRecordMidi(const jack_midi_event_t* pEvent) {
+    uint8_t* pDest = (uint8_t*)captureRecordReserve(2 * sizeof(uint32_t) + pEvent->size);
+    if (!pDest)
+        return false;
+    uint32_t aHeader[2] = {pEvent->time, uint32_t(pEvent->size)};
+    memcpy(pDest, aHeader, sizeof(aHeader));
+    memcpy(pDest + sizeof(aHeader), pEvent->buffer, pEvent->size);
+    return true;
+}
+
+void captureRecordEnd() {
+    if (!s_nRecordType)
+        return;
+    if (s_bRecordOverflow)
+        s_bLost = true;
+    else
+        push(s_pRing, s_nRecordType, s_aRecord, s_nRecordSize);
+    if (s_nRecordType == CAPTURE_RECORD_PERIOD)
+        ++s_nPeriod;
+    s_nRecordType = 0;
+    ++s_nStep;
+}
+
+uint32_t captureGetPeriod() { return s_nPeriod; }
+
+void captureLost() { s_bLost = true; }
+
+bool captureIsProcessThread() { return t_bProcessThread; }
+
+bool captureApiEnter() { return t_nApiDepth++ == 0 && s_nState != CAPTURE_IDLE && !t_bProcessThread; }
+
+void captureApiLeave() { --t_nApiDepth; }
+
+bool captureApiBegin(uint16_t id, const uint8_t* pData, uint16_t nSize) {
+    s_mutexApi.lock();
+    if (s_nState == CAPTURE_IDLE) {
+        s_mutexApi.unlock();
+        return false;
+    }
+    // Record is stamped when call completes so that replay applies it after the callbacks that preceded its completion
+    s_api = {0, id, nSize, 0, {0, 0, 0}};
+    memcpy(s_aApiArgs, pData, nSize);
+    s_nApiSeq = s_nCallbackSeq;
+    return true;
+}
+
+void captureApiEnd() {
+    s_api.step    = s_nStep;
+    uint32_t nSeq = s_nCallbackSeq;
+    s_api.overlap = (nSeq != s_nApiSeq || (nSeq & 1)); // A callback ran whilst call was changing state
+    push(s_pApiRing, CAPTURE_RECORD_API, &s_api, sizeof(s_api), s_aApiArgs, s_api.size);
+    s_mutexApi.unlock();
+}
+
+bool captureApiScopeBegin(uint16_t id, const CAPTURE_ARG* pArgs, uint8_t nArgs) {
+    if (!captureApiEnter())
+        return false;
+    uint8_t aData[CAPTURE_MAX_API_ARGS];
+    uint16_t nSize = 0;
+    for (uint8_t nArg = 0; nArg < nArgs; ++nArg) {
+        if (nSize + pArgs[nArg].size > CAPTURE_MAX_API_ARGS) {
+            captureLost(); // Replay cannot reproduce this call
+            return false;
+        }
+        memcpy(aData + nSize, pArgs[nArg].data, pArgs[nArg].size);
+        nSize += pArgs[nArg].size;
+    }
+    return captureApiBegin(id, aData, nSize);
+}
+
+void captureApiScopeEnd(bool* pRecorded) {
+    if (*pRecorded)
+        captureApiEnd();
+    captureApiLeave();
+}
+
+uint64_t captureHash(uint64_t nHash, const void* pData, size_t nSize) {
+    // FNV-1a
+    const uint8_t* p = (const uint8_t*)pData;
+    for (size_t i = 0; i < nSize; ++i) {
+        nHash ^= p[i];
+        nHash *= 0x100000001b3ULL;
+    }
+    return nHash;
+}
+
+uint64_t captureHashMidi(uint64_t nHash, const jack_midi_event_t* pEvent) {
+    uint32_t aHeader[2] = {pEvent->time, uint32_t(pEvent->size)};
+    nHash               = captureHash(nHash, aHeader, sizeof(aHeader));
+    return captureHash(nHash, pEvent->buffer, pEvent->size);
+}
+
+bool replayOpen(const char* filename, const char* library, uint32_t nVersion, uint32_t nStateSize, CAPTURE_HEADER* pHeader) {
+    if (s_bReplay || s_pFile)
+        return false;
+    strncpy(s_sLibrary, library, sizeof(s_sLibrary) - 1);
+    FILE* pFile = fopen(filename, "rb");
+    if (!pFile)
+        return false;
+    if (fread(pHeader, sizeof(CAPTURE_HEADER), 1, pFile) != 1 || memcmp(pHeader->magic, "zcap", 4) ||
+        strncmp(pHeader->library, library, sizeof(pHeader->library)) || pHeader->version != nVersion || pHeader->stateSize != nStateSize) {
+        fprintf(stderr, "lib%s replay: %s is not a compatible capture log\n", s_sLibrary, filename);
+        fclose(pFile);
+        return false;
+    }
+    s_vReplayLog.clear();
+    uint8_t aChunk[4096];
+    size_t nRead;
+    while ((nRead = fread(aChunk, 1, sizeof(aChunk), pFile)) > 0)
+        s_vReplayLog.insert(s_vReplayLog.end(), aChunk, aChunk + nRead);
+    fclose(pFile);
+    t_bProcessThread = true; // API calls made by replayed callbacks are nested within them
+    s_bReplay        = true;
+    return true;
+}
+
+int32_t replayRun(replay_record_fn_t* pRecordFn, replay_api_fn_t* pApiFn) {
+    if (!s_bReplay)
+        return -2;
+
+    // Index records, separating API calls which are applied before the process thread record that followed them
+    std::vector<size_t> vRecords, vApi;
+    size_t nPos = 0;
+    while (nPos + sizeof(CAPTURE_RECORD) <= s_vReplayLog.size()) {
+        CAPTURE_RECORD record;
+        memcpy(&record, s_vReplayLog.data() + nPos, sizeof(record));
+        if (nPos + sizeof(record) + record.size > s_vReplayLog.size())
+            break; // Incomplete final record
+        if (record.type == CAPTURE_RECORD_LOST) {
+            fprintf(stderr, "lib%s replay: log is incomplete (capture ringbuffer overflowed)\n", s_sLibrary);
+            return -2;
+        }
+        if (record.type == CAPTURE_RECORD_API)
+            vApi.push_back(nPos + sizeof(record));
+        else
+            vRecords.push_back(nPos);
+        nPos += sizeof(record) + record.size;
+    }
+    if (vRecords.empty() || s_vReplayLog[vRecords[0]] != CAPTURE_RECORD_STATE)
+        return -2;
+
+    int32_t nResult       = -1;
+    size_t nApi           = 0;
+    uint32_t nStep        = 0;
+    std::vector<uint64_t> vPayload(CAPTURE_MAX_RECORD / sizeof(uint64_t)); // Aligned copy of record payload
+    for (size_t nRecord : vRecords) {
+        CAPTURE_RECORD record;
+        memcpy(&record, s_vReplayLog.data() + nRecord, sizeof(record));
+        bool bOverlap = false; // True if last call applied before this record overlapped it
+        for (; nApi < vApi.size(); ++nApi) {
+            CAPTURE_API_DATA api;
+            memcpy(&api, s_vReplayLog.data() + vApi[nApi], sizeof(api));
+            if (api.step > nStep)
+                break;
+            bOverlap = api.overlap;
+            pApiFn(api.id, s_vReplayLog.data() + vApi[nApi] + sizeof(api));
+        }
+        ++nStep;
+        if (record.size > CAPTURE_MAX_RECORD) {
+            nResult = -2;
+            break;
+        }
+        memcpy(vPayload.data(), s_vReplayLog.data() + nRecord + sizeof(record), record.size);
+        nResult = pRecordFn(record.type, vPayload.data(), record.size, bOverlap);
+        if (nResult != -1)
+            break;
+    }
+    return nResult;
+}
+
+void replayClose() {
+    if (!s_bReplay)
+        return;
+    s_vReplayLog.clear();
+    s_vReplayLog.shrink_to_fit();
+    t_bProcessThread = false;
+    s_bReplay        = false;
+}
+
+bool replayIsOpen() { return s_bReplay; }
+
+REPLAY_MIDI* replayMidiCreate() { return new REPLAY_MIDI; }
+
+void replayMidiFree(REPLAY_MIDI* pBuffer) { delete pBuffer; }
+
+void replayMidiReset(REPLAY_MIDI* pBuffer, jack_nframes_t nFrames, uint32_t nCapacity) {
+    pBuffer->frames   = nFrames;
+    pBuffer->capacity = nCapacity;
+    replayMidiClear(pBuffer);
+}
+
+const uint8_t* replayMidiFill(REPLAY_MIDI* pBuffer, const uint8_t* pData, uint32_t nEvents) {
+    for (uint32_t i = 0; i < nEvents; ++i) {
+        uint32_t aHeader[2];
+        memcpy(aHeader, pData, sizeof(aHeader));
+        pData += sizeof(aHeader);
+        if (pBuffer->count >= REPLAY_MAX_EVENTS || pBuffer->dataPos + aHeader[1] > REPLAY_MAX_DATA)
+            return NULL;
+        jack_midi_event_t* pEvent = &pBuffer->events[pBuffer->count++];
+        pEvent->time              = aHeader[0];
+        pEvent->size              = aHeader[1];
+        pEvent->buffer            = pBuffer->data + pBuffer->dataPos;
+        memcpy(pEvent->buffer, pData, aHeader[1]);
+        pBuffer->dataPos += aHeader[1];
+        pData += aHeader[1];
+    }
+    return pData;
+}
+
+void replayMidiClear(REPLAY_MIDI* pBuffer) {
+    pBuffer->count   = 0;
+    pBuffer->used    = 0;
+    pBuffer->dataPos = 0;
+}
+
+uint32_t replayMidiCount(REPLAY_MIDI* pBuffer) { return pBuffer->count; }
+
+int replayMidiGet(jack_midi_event_t* pEvent, REPLAY_MIDI* pBuffer, uint32_t index) {
+    if (index >= pBuffer->count)
+        return ENODATA;
+    *pEvent = pBuffer->events[index];
+    return 0;
+}
+
+size_t replayMidiMaxEventSize(REPLAY_MIDI* pBuffer) {
+    int64_t nLeft = int64_t(pBuffer->capacity) - int64_t(JACK_MIDI_EVENT_SIZE) * pBuffer->count - pBuffer->used;
+    if (nLeft < 0)
+        return 0;
+    if (nLeft <= JACK_MIDI_INLINE_SIZE)
+        return JACK_MIDI_INLINE_SIZE;
+    return nLeft;
+}
+
+uint8_t* replayMidiReserve(REPLAY_MIDI* pBuffer, jack_nframes_t nTime, size_t nSize) {
+    if (nTime >= pBuffer->frames)
+        return NULL;
+    if (pBuffer->count && pBuffer->events[pBuffer->count - 1].time > nTime)
+        return NULL;
+    size_t nSpace = replayMidiMaxEventSize(pBuffer);
+    if (nSpace == 0 || nSize > nSpace || pBuffer->count >= REPLAY_MAX_EVENTS || pBuffer->dataPos + nSize > REPLAY_MAX_DATA)
+        return NULL;
+    jack_midi_event_t* pEvent = &pBuffer->events[pBuffer->count++];
+    pEvent->time              = nTime;
+    pEvent->size              = nSize;
+    pEvent->buffer            = pBuffer->data + pBuffer->dataPos;
+    pBuffer->dataPos += nSize;
+    if (nSize > JACK_MIDI_INLINE_SIZE)
+        pBuffer->used += nSize;
+    return pEvent->buffer;
+}
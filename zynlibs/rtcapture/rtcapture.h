@@ -0,0 +1,475 @@
+/*  Declares capture and replay of process thread inputs shared by zynlibs
+ *
+ *   Copyright (c) 2020 Brian Walton
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*  A library's process thread records each callback's inputs (MIDI input, frame time, transport, audio input...) and hashes of its outputs into a
+    record that is pushed to a preallocated ringbuffer. API calls that mutate library state are recorded into a second ringbuffer, stamped when they
+    complete with the quantity of process thread records that preceded them. A writer thread drains both ringbuffers to a log file. The process thread
+    never waits for an API call so capture does not disturb the timing it records. A call that overlapped a callback is flagged because that callback
+    may have seen it partly applied.
+    Replay reads a log, applies each API call before the first process thread record that followed it and passes each record to the library which
+    re-runs its callback offline, without a JACK server, and compares its outputs bit-for-bit with the capture.
+    Each library that compiles rtcapture.cpp has its own capture state, writer thread and log. Log records are in host byte order - replay on the
+    same architecture as capture. The library defines the content of its state and process thread records.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+#include <cstdint>     // provides uint data types
+#include <cstring>     // provides memcpy, strlen
+#include <tuple>       // provides tuple, apply
+#include <type_traits> // provides is_arithmetic, decay
+#else
+#include <stdbool.h> // provides bool
+#include <stddef.h>  // provides size_t
+#include <stdint.h>  // provides uint data types
+#include <string.h>  // provides memcpy
+#endif
+#include <jack/midiport.h> // provides jack_midi_event_t
+
+#define CAPTURE_RING_SIZE (1 << 22)     // Size of process thread ringbuffer in bytes
+#define CAPTURE_API_RING_SIZE (1 << 18) // Size of API call ringbuffer in bytes
+#define CAPTURE_MAX_RECORD (1 << 18)    // Largest process thread record
+#define CAPTURE_MAX_API_ARGS 4096       // Largest packed arguments of an API call
+
+// Log record types (libraries may define other process thread record types from CAPTURE_RECORD_USER)
+#define CAPTURE_RECORD_STATE 1  // Runtime state of library at start of capture
+#define CAPTURE_RECORD_PERIOD 2 // Process period inputs and hashes of outputs
+#define CAPTURE_RECORD_USER 3   // First library specific record type
+#define CAPTURE_RECORD_API 4    // API call that mutates library state
+#define CAPTURE_RECORD_LOST 5   // Ringbuffer overflowed or record too large - records missing after this point
+
+#define CAPTURE_HASH_SEED 0xcbf29ce484222325ULL // Initial value of FNV-1a hash
+
+// Log file header
+typedef struct {
+    char magic[4];       // "zcap"
+    char library[12];    // Name of library that made capture
+    uint32_t version;    // Library's capture format version
+    uint32_t sampleRate; // Samplerate during capture
+    uint32_t seed;       // Seed of pseudo random generators at start of capture
+    uint32_t stateSize;  // Size of runtime state record (validates library version)
+} CAPTURE_HEADER;
+
+// Prefix of each log record
+typedef struct {
+    uint8_t type;   // Record type [CAPTURE_RECORD_STATE | CAPTURE_RECORD_PERIOD | CAPTURE_RECORD_API | CAPTURE_RECORD_LOST | library specific]
+    uint8_t pad[3]; // Padding
+    uint32_t size;  // Size of record payload following this prefix
+} CAPTURE_RECORD;
+
+// API call record payload (followed by packed arguments)
+typedef struct {
+    uint32_t step;   // Quantity of process thread records made before the call completed (replay applies it before the next)
+    uint16_t id;     // Index of API function
+    uint16_t size;   // Size of packed arguments
+    uint8_t overlap; // 1 if a process thread callback ran whilst the call was in progress
+    uint8_t pad[3];  // Padding
+} CAPTURE_API_DATA;
+
+// Argument of an API call recorded by C code (see CAPTURE_API_C)
+typedef struct {
+    const void* data; // Pointer to value
+    uint16_t size;    // Size of value
+} CAPTURE_ARG;
+
+// In-memory MIDI port buffer used during replay, emulating JACK2 space accounting so that events are deferred exactly as they were during capture
+typedef struct REPLAY_MIDI REPLAY_MIDI;
+
+/** @brief  Handle a process thread record during replay
+ *   @param  type Record type
+ *   @param  pPayload Pointer to record payload (8 byte aligned)
+ *   @param  nSize Size of payload
+ *   @param  bOverlap True if an API call applied immediately before this record overlapped it during capture
+ *   @retval int32_t -1 to continue, -2 to abort or index of period whose output differs
+ */
+typedef int32_t replay_record_fn_t(uint8_t type, const void* pPayload, uint32_t nSize, bool bOverlap);
+
+/** @brief  Call a captured API function during replay
+ *   @param  id Index of API function
+ *   @param  pArgs Pointer to packed arguments
+ */
+typedef void replay_api_fn_t(uint16_t id, const uint8_t* pArgs);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief  Open capture log and start writer thread
+ *   @param  filename Full path and filename of log
+ *   @param  library Name of library (stored in header, up to 11 characters)
+ *   @param  nVersion Library's capture format version
+ *   @param  nSampleRate Samplerate
+ *   @param  nSeed Seed of pseudo random generators
+ *   @param  nStateSize Size of runtime state record
+ *   @retval bool True on success
+ *   @note   Nothing is recorded until captureArm is called
+ */
+bool captureStart(const char* filename, const char* library, uint32_t nVersion, uint32_t nSampleRate, uint32_t nSeed, uint32_t nStateSize);
+
+/** @brief  Start recording - API calls are recorded immediately, process periods from next period which must call captureState
+ */
+void captureArm();
+
+/** @brief  Stop capture, flush and close log (also closes a log that was not armed)
+ */
+void captureStop();
+
+/** @brief  Check if capture is running
+ *   @retval bool True if capturing (or waiting for first period)
+ */
+bool captureIsRunning();
+
+/** @brief  Check if capture is waiting for first period
+ *   @retval bool True if runtime state must be recorded in this period
+ */
+bool captureIsPending();
+
+/** @brief  Mark start of a process thread callback - never blocks
+ *   @retval bool True if this callback is being captured (capture running and runtime state recorded)
+ */
+bool captureBeginCallback();
+
+/** @brief  Mark end of a process thread callback, after its record has ended
+ */
+void captureEndCallback();
+
+/** @brief  Record runtime state - call from process thread callback when captureIsPending
+ *   @param  pState Pointer to state
+ *   @param  nSize Size of state
+ *   @retval bool True if recorded (records of this and following callbacks are captured)
+ */
+bool captureState(const void* pState, uint32_t nSize);
+
+/** @brief  Start populating a process thread record
+ *   @param  type Record type
+ *   @param  nSize Size of fixed part of record
+ *   @retval void* Pointer to fixed part (zeroed) or NULL if too large
+ */
+void* captureRecordBegin(uint8_t type, uint32_t nSize);
+
+/** @brief  Check if a process thread record is being populated
+ *   @retval bool True if captureRecordBegin has been called without captureRecordEnd
+ */
+bool captureRecordIsOpen();
+
+/** @brief  Get fixed part of record being populated
+ *   @retval void* Pointer to fixed part or NULL if no record being populated
+ */
+void* captureRecordFixed();
+
+/** @brief  Reserve space at end of record being populated
+ *   @param  nSize Quantity of bytes
+ *   @retval void* Pointer to reserved space or NULL if record would exceed CAPTURE_MAX_RECORD (record will be lost)
+ */
+void* captureRecordReserve(uint32_t nSize);
+
+/** @brief  Append data to record being populated
+ *   @param  pData Pointer to data
+ *   @param  nSize Quantity of bytes
+ *   @retval bool True on success
+ */
+bool captureRecordAppend(const void* pData, uint32_t nSize);
+
+/** @brief  Append MIDI event to record being populated (time:uint32, size:uint32, data)
+ *   @param  pEvent Pointer to event
+ *   @retval bool True on success
+ */
+bool captureRecordMidi(const jack_midi_event_t* pEvent);
+
+/** @brief  Push record being populated to ringbuffer and count it
+ *   @note   Counts the record even if it could not be pushed so that API calls stay aligned (log is marked incomplete)
+ */
+void captureRecordEnd();
+
+/** @brief  Get quantity of period records made since start of capture
+ *   @retval uint32_t Index of next period
+ */
+uint32_t captureGetPeriod();
+
+/** @brief  Flag capture log incomplete
+ */
+void captureLost();
+
+/** @brief  Check if calling thread is the process thread (or replay thread)
+ *   @retval bool True if process thread
+ */
+bool captureIsProcessThread();
+
+/** @brief  Enter an API function - call at start of each API function that mutates library state
+ *   @retval bool True if this call must be recorded (outermost call by a thread other than the process thread whilst capturing)
+ *   @note   Must be paired with captureApiLeave
+ */
+bool captureApiEnter();
+
+/** @brief  Leave an API function
+ */
+void captureApiLeave();
+
+/** @brief  Start recording an API call, excluding other API calls until captureApiEnd
+ *   @param  id Index of API function
+ *   @param  pData Pointer to packed arguments
+ *   @param  nSize Size of packed arguments
+ *   @retval bool True if recorded (captureApiEnd must be called when the call completes)
+ */
+bool captureApiBegin(uint16_t id, const uint8_t* pData, uint16_t nSize);
+
+/** @brief  End a recorded API call, stamping it with the quantity of process thread records made before it completed
+ */
+void captureApiEnd();
+
+/** @brief  Enter an API function and record it if required (C interface, see CAPTURE_API_C)
+ *   @param  id Index of API function
+ *   @param  pArgs Array of arguments
+ *   @param  nArgs Quantity of arguments
+ *   @retval bool True if recorded
+ */
+bool captureApiScopeBegin(uint16_t id, const CAPTURE_ARG* pArgs, uint8_t nArgs);
+
+/** @brief  Leave an API function entered by captureApiScopeBegin (cleanup function of CAPTURE_API_C)
+ *   @param  pRecorded Pointer to value returned by captureApiScopeBegin
+ */
+void captureApiScopeEnd(bool* pRecorded);
+
+/** @brief  Update FNV-1a hash with data
+ *   @param  nHash Current hash
+ *   @param  pData Pointer to data
+ *   @param  nSize Quantity of bytes
+ *   @retval uint64_t Updated hash
+ */
+uint64_t captureHash(uint64_t nHash, const void* pData, size_t nSize);
+
+/** @brief  Update hash with a MIDI event
+ *   @param  nHash Current hash
+ *   @param  pEvent Pointer to event
+ *   @retval uint64_t Updated hash
+ */
+uint64_t captureHashMidi(uint64_t nHash, const jack_midi_event_t* pEvent);
+
+/** @brief  Open a capture log for replay
+ *   @param  filename Full path and filename of log
+ *   @param  library Name of library that must have made capture
+ *   @param  nVersion Capture format version that log must have
+ *   @param  nStateSize Size of runtime state record that log must have
+ *   @param  pHeader Pointer to header to populate
+ *   @retval bool True on success (replayClose must be called)
+ */
+bool replayOpen(const char* filename, const char* library, uint32_t nVersion, uint32_t nStateSize, CAPTURE_HEADER* pHeader);
+
+/** @brief  Replay an open capture log
+ *   @param  pRecordFn Function to handle each process thread record (first is the runtime state)
+ *   @param  pApiFn Function to call each captured API function
+ *   @retval int32_t -1 if all outputs match, index of first period that differs or -2 on error
+ */
+int32_t replayRun(replay_record_fn_t* pRecordFn, replay_api_fn_t* pApiFn);
+
+/** @brief  Close capture log opened for replay
+ */
+void replayClose();
+
+/** @brief  Check if a capture log is open for replay
+ *   @retval bool True if open
+ */
+bool replayIsOpen();
+
+/** @brief  Create replay MIDI buffer
+ *   @retval REPLAY_MIDI* Pointer to buffer (free with replayMidiFree)
+ */
+REPLAY_MIDI* replayMidiCreate();
+
+/** @brief  Free replay MIDI buffer
+ *   @param  pBuffer Pointer to buffer
+ */
+void replayMidiFree(REPLAY_MIDI* pBuffer);
+
+/** @brief  Clear replay MIDI buffer at start of a period
+ *   @param  pBuffer Pointer to buffer
+ *   @param  nFrames Quantity of frames in period
+ *   @param  nCapacity Largest event that fits in empty buffer (as recorded during capture)
+ */
+void replayMidiReset(REPLAY_MIDI* pBuffer, jack_nframes_t nFrames, uint32_t nCapacity);
+
+/** @brief  Populate replay MIDI buffer with recorded events
+ *   @param  pBuffer Pointer to buffer
+ *   @param  pData Pointer to events recorded by captureRecordMidi
+ *   @param  nEvents Quantity of events
+ *   @retval const uint8_t* Pointer to data following events or NULL if events do not fit
+ */
+const uint8_t* replayMidiFill(REPLAY_MIDI* pBuffer, const uint8_t* pData, uint32_t nEvents);
+
+/** @brief  Clear events from replay MIDI buffer
+ *   @param  pBuffer Pointer to buffer
+ */
+void replayMidiClear(REPLAY_MIDI* pBuffer);
+
+/** @brief  Get quantity of events in replay MIDI buffer
+ *   @param  pBuffer Pointer to buffer
+ *   @retval uint32_t Quantity of events
+ */
+uint32_t replayMidiCount(REPLAY_MIDI* pBuffer);
+
+/** @brief  Get event from replay MIDI buffer
+ *   @param  pEvent Pointer to event to populate
+ *   @param  pBuffer Pointer to buffer
+ *   @param  index Index of event
+ *   @retval int 0 on success
+ */
+int replayMidiGet(jack_midi_event_t* pEvent, REPLAY_MIDI* pBuffer, uint32_t index);
+
+/** @brief  Get largest event that fits in replay MIDI buffer
+ *   @param  pBuffer Pointer to buffer
+ *   @retval size_t Size of largest event in bytes
+ */
+size_t replayMidiMaxEventSize(REPLAY_MIDI* pBuffer);
+
+/** @brief  Reserve space for event in replay MIDI buffer
+ *   @param  pBuffer Pointer to buffer
+ *   @param  nTime Offset of event within period
+ *   @param  nSize Size of event in bytes
+ *   @retval uint8_t* Pointer to event data or NULL if insufficient space
+ */
+uint8_t* replayMidiReserve(REPLAY_MIDI* pBuffer, jack_nframes_t nTime, size_t nSize);
+
+#ifdef __cplusplus
+}
+
+// Pack an API argument - returns false if arguments exceed CAPTURE_MAX_API_ARGS
+template <typename T> bool capturePack(uint8_t* pData, uint16_t& nSize, T value) {
+    static_assert(std::is_arithmetic<T>::value, "Only arithmetic API arguments may be captured");
+    if (nSize + sizeof(T) > CAPTURE_MAX_API_ARGS)
+        return false;
+    memcpy(pData + nSize, &value, sizeof(T));
+    nSize += sizeof(T);
+    return true;
+}
+
+// Pack a string API argument (including terminator)
+inline bool capturePack(uint8_t* pData, uint16_t& nSize, const char* value) {
+    size_t nLen = value ? strlen(value) + 1 : 1;
+    if (nSize + nLen > CAPTURE_MAX_API_ARGS)
+        return false;
+    if (value)
+        memcpy(pData + nSize, value, nLen);
+    else
+        pData[nSize] = '\0';
+    nSize += nLen;
+    return true;
+}
+
+inline bool capturePack(uint8_t* pData, uint16_t& nSize, char* value) { return capturePack(pData, nSize, (const char*)value); }
+
+// Pack a block of bytes API argument (size:uint32, data)
+struct CaptureBlob {
+    const uint8_t* data; // Pointer to data
+    uint32_t size;       // Quantity of bytes
+};
+
+inline bool capturePack(uint8_t* pData, uint16_t& nSize, CaptureBlob value) {
+    if (nSize + sizeof(uint32_t) + value.size > CAPTURE_MAX_API_ARGS)
+        return false;
+    memcpy(pData + nSize, &value.size, sizeof(uint32_t));
+    memcpy(pData + nSize + sizeof(uint32_t), value.data, value.size);
+    nSize += sizeof(uint32_t) + value.size;
+    return true;
+}
+
+// Unpack an API argument
+template <typename T> T replayUnpack(const uint8_t*& pData) {
+    T value;
+    memcpy(&value, pData, sizeof(T));
+    pData += sizeof(T);
+    return value;
+}
+
+// Unpack a string API argument
+template <> inline const char* replayUnpack<const char*>(const uint8_t*& pData) {
+    const char* value = (const char*)pData;
+    pData += strlen(value) + 1;
+    return value;
+}
+
+template <> inline char* replayUnpack<char*>(const uint8_t*& pData) { return (char*)replayUnpack<const char*>(pData); }
+
+// Unpack a block of bytes API argument packed from a CaptureBlob
+template <> inline const uint8_t* replayUnpack<const uint8_t*>(const uint8_t*& pData) {
+    uint32_t nSize;
+    memcpy(&nSize, pData, sizeof(nSize));
+    const uint8_t* value = pData + sizeof(nSize);
+    pData += sizeof(nSize) + nSize;
+    return value;
+}
+
+/** @brief  Call an API function with arguments unpacked from a captured API record
+ *   @param  pFunction Pointer to function
+ *   @param  pData Pointer to packed arguments
+ */
+template <typename R, typename... Args> void replayApiCall(R (*pFunction)(Args...), const uint8_t* pData) {
+    // Braced initialisation evaluates (unpacks) arguments in order
+    std::tuple<typename std::decay<Args>::type...> args{replayUnpack<typename std::decay<Args>::type>(pData)...};
+    std::apply(pFunction, args);
+}
+
+/*  Records an API call when constructed at start of an API function and stamps it when destroyed at its end. Only the
+    outermost API call made by a thread other than the process thread is recorded - calls nested within another API function or made by the
+    process thread are reproduced by replaying their caller.
+*/
+class CaptureApiScope {
+  public:
+    template <typename... Args> CaptureApiScope(uint16_t id, Args... args) {
+        if (captureApiEnter()) {
+            uint8_t aData[CAPTURE_MAX_API_ARGS];
+            uint16_t nSize = 0;
+            if ((capturePack(aData, nSize, args) && ...))
+                m_bRecorded = captureApiBegin(id, aData, nSize);
+            else
+                captureLost(); // Replay cannot reproduce this call
+        }
+    }
+    ~CaptureApiScope() {
+        if (m_bRecorded)
+            captureApiEnd();
+        captureApiLeave();
+    }
+
+  private:
+    bool m_bRecorded = false; // True if this call was recorded
+};
+
+#else
+
+// Argument of CAPTURE_API_C (must be an lvalue, e.g. function parameter)
+#define CAPTURE_ARG(value) {&(value), sizeof(value)}
+
+/*  Record call of API function during capture - place at start of C function, e.g. CAPTURE_API_C(API_setLevel, CAPTURE_ARG(channel), CAPTURE_ARG(level))
+    Call is stamped when the function returns.
+*/
+#define CAPTURE_API_C(id, ...)                                                                                                                                 \
+    __attribute__((cleanup(captureApiScopeEnd))) bool captureScope =                                                                                           \
+        captureApiScopeBegin(id, (const CAPTURE_ARG[]){__VA_ARGS__}, sizeof((const CAPTURE_ARG[]){__VA_ARGS__}) / sizeof(CAPTURE_ARG))
+
+// Record call of API function without arguments during capture - place at start of C function
+#define CAPTURE_API_C0(id) __attribute__((cleanup(captureApiScopeEnd))) bool captureScope = captureApiScopeBegin(id, NULL, 0)
+
+// Declare and unpack an argument of a captured API call within a replay_api_fn_t (C interface) - unpack in the order of the CAPTURE_API_C arguments
+#define REPLAY_ARG_C(type, name, pArgs)                                                                                                                        \
+    type name;                                                                                                                                                 \
+    memcpy(&name, pArgs, sizeof(type));                                                                                                                        \
+    pArgs += sizeof(type)
+
+#endif
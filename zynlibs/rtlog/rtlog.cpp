@@ -0,0 +1,241 @@
+/*  Defines real-time safe logging shared by zynlibs
+ *
+ *   Copyright (c) 2020 Brian Walton
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "rtlog.h"
+#include <atomic>   // provides atomic
+#include <chrono>   // provides time durations
+#include <cstring>  // provides strchr
+#include <mutex>    // provides mutex for enable
+#include <stdio.h>  // provides fprintf
+#include <thread>   // provides writer thread
+
+// Single producer (owning thread), single consumer (writer thread) ring of records
+struct RTLOG_RING {
+    std::atomic<bool> claimed{false};   // True when owned by a thread
+    std::atomic<uint32_t> write{0};     // Count of records pushed
+    std::atomic<uint32_t> read{0};      // Count of records written
+    std::atomic<uint32_t> dropped{0};   // Count of records dropped because ring was full
+    RTLOG_RECORD records[RTLOG_RING_SIZE];
+};
+
+// Releases calling thread's ring when the thread exits
+struct RTLOG_THREAD {
+    bool bOwner = false; // True if thread claimed a ring
+    ~RTLOG_THREAD();
+};
+
+static RTLOG_RING s_aRings[RTLOG_MAX_THREADS];      // Rings, claimed by real-time threads with rtlogThreadInit
+// Library is loaded with dlopen so TLS accessed from real-time threads uses initial-exec model to avoid lazy allocation by __tls_get_addr
+static thread_local RTLOG_RING* t_pRing __attribute__((tls_model("initial-exec"))) = NULL; // Ring owned by this thread (NULL if thread writes directly)
+static thread_local RTLOG_THREAD t_thread;          // Releases ring at thread exit (only constructed by rtlogThreadInit)
+static std::atomic<bool> s_bEnabled{false};         // True if logging enabled
+static std::atomic<uint32_t> s_nSequence{0};        // Sequence of next record
+static std::atomic<bool> s_bWriterRunning{false};   // False to stop writer thread
+static std::thread s_threadWriter;                  // Thread formatting records to stderr
+static std::mutex s_mutexEnable;                    // Excludes enable calls from each other
+static std::mutex s_mutexWrite;                     // Excludes writer thread and threads without a ring from each other whilst writing to stderr
+static uint32_t s_nReportedDropped = 0;             // Quantity of dropped records last reported by writer thread
+
+RTLOG_THREAD::~RTLOG_THREAD() {
+    if (!bOwner || !t_pRing)
+        return;
+    // Pending records stay in the ring and are written before those of the next owner
+    t_pRing->claimed.store(false, std::memory_order_release);
+    t_pRing = NULL;
+}
+
+// Write one printf style conversion with stored argument
+static void writeArg(const char* sSpec, char cConversion, uint8_t nType, const RTLOG_VALUE& value) {
+    char sFormat[24];
+    switch (cConversion) {
+    case 'd':
+    case 'i':
+        snprintf(sFormat, sizeof(sFormat), "%sll%c", sSpec, cConversion);
+        fprintf(stderr, sFormat, nType == RTLOG_ARG_DOUBLE ? (long long)value.d : (long long)value.i);
+        break;
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'o':
+        snprintf(sFormat, sizeof(sFormat), "%sll%c", sSpec, cConversion);
+        fprintf(stderr, sFormat, nType == RTLOG_ARG_DOUBLE ? (unsigned long long)value.d : (unsigned long long)value.u);
+        break;
+    case 'c':
+        snprintf(sFormat, sizeof(sFormat), "%sc", sSpec);
+        fprintf(stderr, sFormat, int(value.i));
+        break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        snprintf(sFormat, sizeof(sFormat), "%s%c", sSpec, cConversion);
+        if (nType == RTLOG_ARG_INT)
+            fprintf(stderr, sFormat, double(value.i));
+        else if (nType == RTLOG_ARG_UINT)
+            fprintf(stderr, sFormat, double(value.u));
+        else
+            fprintf(stderr, sFormat, value.d);
+        break;
+    case 's':
+        snprintf(sFormat, sizeof(sFormat), "%ss", sSpec);
+        fprintf(stderr, sFormat, nType == RTLOG_ARG_STRING && value.p ? (const char*)value.p : "(null)");
+        break;
+    case 'p':
+        snprintf(sFormat, sizeof(sFormat), "%sp", sSpec);
+        fprintf(stderr, sFormat, value.p);
+        break;
+    default:
+        break;
+    }
+}
+
+// Format record to stderr, interpreting each conversion according to stored argument type
+static void writeRecord(const RTLOG_RECORD& record) {
+    uint8_t nArg = 0;
+    for (const char* pChar = record.format; *pChar; ++pChar) {
+        if (*pChar != '%') {
+            fputc(*pChar, stderr);
+            continue;
+        }
+        if (*(++pChar) == '%') {
+            fputc('%', stderr);
+            continue;
+        }
+        // Copy flags, width and precision. Length modifiers are replaced to suit stored argument.
+        char sSpec[16] = "%";
+        size_t nLen    = 1;
+        while (*pChar && strchr("-+ #0123456789.", *pChar)) {
+            if (nLen < sizeof(sSpec) - 1)
+                sSpec[nLen++] = *pChar;
+            ++pChar;
+        }
+        sSpec[nLen] = '\0';
+        while (*pChar && strchr("hlLqjzt", *pChar))
+            ++pChar;
+        if (!*pChar)
+            break;
+        if (nArg < record.args) {
+            writeArg(sSpec, *pChar, record.types[nArg], record.values[nArg]);
+            ++nArg;
+        }
+    }
+}
+
+// Write pending records from all rings in the order they were pushed
+static void drain() {
+    std::lock_guard<std::mutex> lock(s_mutexWrite);
+    while (true) {
+        RTLOG_RING* pOldest = NULL;
+        for (uint8_t nRing = 0; nRing < RTLOG_MAX_THREADS; ++nRing) {
+            RTLOG_RING* pRing = &s_aRings[nRing];
+            uint32_t nRead    = pRing->read.load(std::memory_order_relaxed);
+            if (nRead == pRing->write.load(std::memory_order_acquire))
+                continue;
+            if (!pOldest ||
+                int32_t(pRing->records[nRead % RTLOG_RING_SIZE].sequence -
+                        pOldest->records[pOldest->read.load(std::memory_order_relaxed) % RTLOG_RING_SIZE].sequence) < 0)
+                pOldest = pRing;
+        }
+        if (!pOldest)
+            break;
+        uint32_t nRead = pOldest->read.load(std::memory_order_relaxed);
+        writeRecord(pOldest->records[nRead % RTLOG_RING_SIZE]);
+        pOldest->read.store(nRead + 1, std::memory_order_release);
+    }
+    uint32_t nDropped = rtlogGetDropped();
+    if (nDropped != s_nReportedDropped) {
+        fprintf(stderr, "rtlog dropped %u records\n", nDropped - s_nReportedDropped);
+        s_nReportedDropped = nDropped;
+    }
+    fflush(stderr);
+}
+
+// Writer thread - formats records until stopped
+static void writer() {
+    while (true) {
+        bool bRunning = s_bWriterRunning;
+        drain();
+        if (!bRunning)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(RTLOG_INTERVAL));
+    }
+}
+
+// Stops writer thread when library unloaded
+static struct RtlogShutdown {
+    ~RtlogShutdown() { rtlogEnable(false); }
+} s_shutdown;
+
+void rtlogEnable(bool bEnable) {
+    std::lock_guard<std::mutex> lock(s_mutexEnable);
+    s_bEnabled = bEnable;
+    if (bEnable && !s_bWriterRunning) {
+        s_bWriterRunning = true;
+        s_threadWriter   = std::thread(writer);
+    } else if (!bEnable && s_bWriterRunning) {
+        s_bWriterRunning = false;
+        s_threadWriter.join();
+    }
+}
+
+bool rtlogIsEnabled() { return s_bEnabled.load(std::memory_order_relaxed); }
+
+uint32_t rtlogGetDropped() {
+    uint32_t nDropped = 0;
+    for (uint8_t nRing = 0; nRing < RTLOG_MAX_THREADS; ++nRing)
+        nDropped += s_aRings[nRing].dropped;
+    return nDropped;
+}
+
+void rtlogThreadInit(void* pArgs) {
+    if (t_pRing)
+        return;
+    // Claim first free ring
+    for (uint8_t nRing = 0; nRing < RTLOG_MAX_THREADS; ++nRing) {
+        bool bClaimed = false;
+        if (s_aRings[nRing].claimed.compare_exchange_strong(bClaimed, true, std::memory_order_acquire)) {
+            t_pRing         = &s_aRings[nRing];
+            t_thread.bOwner = true;
+            return;
+        }
+    }
+    fprintf(stderr, "rtlog: no free ring - thread will write log messages directly\n");
+}
+
+void rtlogPush(RTLOG_RECORD* pRecord) {
+    if (!t_pRing) {
+        // Thread is not real-time so may block whilst writing
+        std::lock_guard<std::mutex> lock(s_mutexWrite);
+        writeRecord(*pRecord);
+        fflush(stderr);
+        return;
+    }
+    uint32_t nWrite = t_pRing->write.load(std::memory_order_relaxed);
+    if (nWrite - t_pRing->read.load(std::memory_order_acquire) >= RTLOG_RING_SIZE) {
+        ++t_pRing->dropped;
+        return;
+    }
+    pRecord->sequence                            = s_nSequence++;
+    t_pRing->records[nWrite % RTLOG_RING_SIZE] = *pRecord;
+    t_pRing->write.store(nWrite + 1, std::memory_order_release);
+}
@@ -0,0 +1,142 @@
+/*  Declares real-time safe logging shared by zynlibs
+ *
+ *   Copyright (c) 2020 Brian Walton
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*  Audio threads must not format text or write to files so log messages are pushed as fixed size binary records (format string pointer + arguments)
+ *  to a lock-free ring owned by the calling thread. A background thread formats and writes them to stderr. Records that do not fit are counted and
+ *  the count is reported by the background thread.
+ *  Rings are reserved for real-time threads, which claim one with rtlogThreadInit (e.g. as jack thread init callback) and release it when they exit.
+ *  Other threads, e.g. API calls that share code with the process thread, format and write their messages directly.
+ *  Each library that compiles rtlog.cpp has its own rings and background thread.
+ */
+
+#pragma once
+
+#include <cstdint>     // provides uint data types
+#include <type_traits> // provides is_integral, is_signed, is_floating_point
+
+#define RTLOG_MAX_ARGS 8     // Maximum quantity of arguments in a log record
+#define RTLOG_RING_SIZE 512  // Quantity of records in each thread's ring (must be power of 2)
+#define RTLOG_MAX_THREADS 8  // Maximum quantity of real-time threads that may own a ring
+#define RTLOG_INTERVAL 50    // Period in milliseconds between background thread writes
+
+#define RTLOG_ARG_INT 0    // Signed integer argument
+#define RTLOG_ARG_UINT 1   // Unsigned integer argument
+#define RTLOG_ARG_DOUBLE 2 // Floating point argument
+#define RTLOG_ARG_STRING 3 // Pointer to string that remains valid until written, e.g. string literal
+#define RTLOG_ARG_POINTER 4 // Other pointer
+
+// Log message from audio thread if logging enabled. Format is printf style. Arguments must be numbers, pointers or static strings.
+#define RTLOG(fmt, args...)                                                                                                                                    \
+    if (rtlogIsEnabled())                                                                                                                                      \
+    rtlog(fmt, ##args)
+
+union RTLOG_VALUE {
+    int64_t i;
+    uint64_t u;
+    double d;
+    const void* p;
+};
+
+struct RTLOG_RECORD {
+    const char* format;                  // Pointer to printf style format string (must be string literal)
+    uint32_t sequence;                   // Order of record across all threads
+    uint8_t args;                        // Quantity of arguments
+    uint8_t types[RTLOG_MAX_ARGS];       // Type of each argument [RTLOG_ARG_INT | RTLOG_ARG_UINT | RTLOG_ARG_DOUBLE | RTLOG_ARG_STRING | RTLOG_ARG_POINTER]
+    RTLOG_VALUE values[RTLOG_MAX_ARGS];  // Value of each argument
+};
+
+/** @brief  Enable logging, starting or stopping background thread
+ *   @param  bEnable True to enable
+ *   @note   Call from non-real-time thread. Records pending when disabled are written before background thread stops.
+ */
+void rtlogEnable(bool bEnable);
+
+/** @brief  Check if logging is enabled
+ *   @retval bool True if enabled
+ */
+bool rtlogIsEnabled();
+
+/** @brief  Get quantity of records dropped because a ring was full
+ *   @retval uint32_t Quantity of dropped records since library loaded
+ */
+uint32_t rtlogGetDropped();
+
+/** @brief  Claim a ring for the calling real-time thread
+ *   @param  pArgs Unused (allows use as JackThreadInitCallback)
+ *   @note   Call from the thread before it logs from real-time context. Ring is released when the thread exits.
+ *   @note   If all RTLOG_MAX_THREADS rings are claimed the thread writes directly, as a non-real-time thread.
+ */
+void rtlogThreadInit(void* pArgs);
+
+/** @brief  Push record to calling thread's ring without blocking
+ *   @param  pRecord Pointer to record (sequence is populated)
+ *   @note   Threads without a ring (see rtlogThreadInit) format and write the record immediately, blocking whilst writing
+ */
+void rtlogPush(RTLOG_RECORD* pRecord);
+
+// Populate argument of record according to its type
+template <typename T> inline void rtlogArg(RTLOG_RECORD& record, T value) {
+    static_assert(std::is_integral<T>::value || std::is_enum<T>::value || std::is_floating_point<T>::value, "rtlog argument must be a number or pointer");
+    if (record.args >= RTLOG_MAX_ARGS)
+        return;
+    uint8_t nArg = record.args++;
+    if (std::is_floating_point<T>::value) {
+        record.types[nArg]    = RTLOG_ARG_DOUBLE;
+        record.values[nArg].d = double(value);
+    } else if (std::is_signed<T>::value) {
+        record.types[nArg]    = RTLOG_ARG_INT;
+        record.values[nArg].i = int64_t(value);
+    } else {
+        record.types[nArg]    = RTLOG_ARG_UINT;
+        record.values[nArg].u = uint64_t(value);
+    }
+}
+
+inline void rtlogArg(RTLOG_RECORD& record, const char* value) {
+    if (record.args >= RTLOG_MAX_ARGS)
+        return;
+    record.types[record.args]      = RTLOG_ARG_STRING;
+    record.values[record.args++].p = value;
+}
+
+template <typename T> inline void rtlogArg(RTLOG_RECORD& record, T* value) {
+    if (record.args >= RTLOG_MAX_ARGS)
+        return;
+    record.types[record.args]      = RTLOG_ARG_POINTER;
+    record.values[record.args++].p = value;
+}
+
+inline void rtlogArgs(RTLOG_RECORD&) {}
+
+template <typename T, typename... Args> inline void rtlogArgs(RTLOG_RECORD& record, T value, Args... args) {
+    rtlogArg(record, value);
+    rtlogArgs(record, args...);
+}
+
+/** @brief  Log message without blocking, formatting or allocating memory
+ *   @param  format printf style format string (must be string literal)
+ *   @param  args Arguments (numbers, pointers or static strings)
+ */
+template <typename... Args> inline void rtlog(const char* format, Args... args) {
+    RTLOG_RECORD record;
+    record.format = format;
+    record.args   = 0;
+    rtlogArgs(record, args...);
+    rtlogPush(&record);
+}
@@ -0,0 +1,159 @@
+/*  Tests real-time safe logging shared by zynlibs
+ *
+ *   Copyright (c) 2020 Brian Walton
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*  Standalone test of rtlog rings, cross-thread ordering, drop counting and ring release
+    Build and run: cmake -S . -B build && cmake --build build && ctest --test-dir build
+*/
+
+#include "rtlog.h"
+#include <atomic>   // provides atomic
+#include <stdio.h>  // provides fprintf, tmpfile
+#include <string>   // provides std::string
+#include <thread>   // provides thread
+#include <unistd.h> // provides dup, dup2
+
+static FILE* s_pCapture = NULL; // Temporary file receiving stderr whilst capturing
+static int s_nStderr    = -1;   // Duplicate of original stderr file descriptor
+static int s_nFailures  = 0;    // Quantity of failed checks
+
+#define CHECK(condition)                                                                                                                                       \
+    if (!(condition)) {                                                                                                                                        \
+        fprintf(stdout, "FAIL %s:%d %s\n", __func__, __LINE__, #condition);                                                                                    \
+        ++s_nFailures;                                                                                                                                         \
+    }
+
+// Redirect stderr to a temporary file
+static void captureStart() {
+    fflush(stderr);
+    s_pCapture = tmpfile();
+    s_nStderr  = dup(2);
+    dup2(fileno(s_pCapture), 2);
+}
+
+// Restore stderr and return text written since captureStart
+static std::string captureStop() {
+    fflush(stderr);
+    dup2(s_nStderr, 2);
+    close(s_nStderr);
+    std::string sText;
+    rewind(s_pCapture);
+    char sBuffer[256];
+    size_t nRead;
+    while ((nRead = fread(sBuffer, 1, sizeof(sBuffer), s_pCapture)) > 0)
+        sText.append(sBuffer, nRead);
+    fclose(s_pCapture);
+    return sText;
+}
+
+// Write pending records by starting and stopping the writer thread
+static void flush() {
+    rtlogEnable(true);
+    rtlogEnable(false);
+}
+
+// Build expected output of consecutive numbered records
+static std::string expected(uint32_t nFirst, uint32_t nCount) {
+    std::string sText;
+    for (uint32_t n = nFirst; n < nFirst + nCount; ++n)
+        sText += std::to_string(n) + "\n";
+    return sText;
+}
+
+// Records pushed to a ring are held until the writer runs then written in order
+static void testRing() {
+    captureStart();
+    std::thread thread([]() {
+        rtlogThreadInit(NULL);
+        for (uint32_t n = 0; n < 100; ++n)
+            rtlog("%u\n", n);
+    });
+    thread.join();
+    std::string sHeld = captureStop();
+    CHECK(sHeld.empty());
+    captureStart();
+    flush();
+    CHECK(captureStop() == expected(0, 100));
+}
+
+// Records from several rings are merged in the order they were pushed
+static void testOrdering() {
+    std::atomic<uint32_t> nNext{0};
+    auto fn = [&nNext](uint32_t nFirst) {
+        rtlogThreadInit(NULL);
+        for (uint32_t n = nFirst; n < 200; n += 2) {
+            while (nNext.load() != n)
+                ;
+            rtlog("%u\n", n);
+            nNext.store(n + 1);
+        }
+    };
+    captureStart();
+    std::thread threadEven(fn, 0);
+    std::thread threadOdd(fn, 1);
+    threadEven.join();
+    threadOdd.join();
+    flush();
+    CHECK(captureStop() == expected(0, 200));
+}
+
+// Records that do not fit in a full ring are counted and the count is reported
+static void testDrop() {
+    uint32_t nDropped = rtlogGetDropped();
+    captureStart();
+    std::thread thread([]() {
+        rtlogThreadInit(NULL);
+        for (uint32_t n = 0; n < RTLOG_RING_SIZE + 10; ++n)
+            rtlog("%u\n", n);
+    });
+    thread.join();
+    CHECK(rtlogGetDropped() == nDropped + 10);
+    flush();
+    CHECK(captureStop() == expected(0, RTLOG_RING_SIZE) + "rtlog dropped 10 records\n");
+}
+
+// Rings are released when their threads exit so may be reused by any quantity of threads
+static void testRelease() {
+    captureStart();
+    for (uint32_t n = 0; n < 4 * RTLOG_MAX_THREADS; ++n) {
+        std::thread thread([n]() {
+            rtlogThreadInit(NULL);
+            rtlog("%u\n", n);
+        });
+        thread.join();
+    }
+    flush();
+    CHECK(captureStop() == expected(0, 4 * RTLOG_MAX_THREADS));
+}
+
+// Threads without a ring write immediately
+static void testDirect() {
+    captureStart();
+    rtlog("%u %s %.1f\n", 7u, "direct", 2.5);
+    CHECK(captureStop() == "7 direct 2.5\n");
+}
+
+int main() {
+    testRing();
+    testOrdering();
+    testDrop();
+    testRelease();
+    testDirect();
+    fprintf(stdout, "%s\n", s_nFailures ? "FAILED" : "PASSED");
+    return s_nFailures ? 1 : 0;
+}
@@ -0,0 +1,68 @@
+/*  Defines shared memory monitor regions shared by zynlibs
+ *
+ *   Copyright (c) 2020 Brian Walton
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "rtmonitor.h"
+#include <errno.h>    // provides errno
+#include <fcntl.h>    // provides O_CREAT
+#include <stdio.h>    // provides snprintf
+#include <stdlib.h>   // provides calloc
+#include <sys/mman.h> // provides shm_open, mmap
+#include <unistd.h>   // provides getpid, ftruncate
+
+void* rtmonitorCreate(RTMONITOR& monitor, const char* sPrefix, size_t nSize) {
+    monitor.nSize = nSize;
+    snprintf(monitor.sName, sizeof(monitor.sName), "%s.%d", sPrefix, getpid());
+    int fd = shm_open(monitor.sName, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 && errno == EEXIST) {
+        // Stale object left by a crashed process that had the same pid
+        shm_unlink(monitor.sName);
+        fd = shm_open(monitor.sName, O_CREAT | O_EXCL | O_RDWR, 0644);
+    }
+    if (fd >= 0) {
+        // New shared memory object is zero filled
+        if (ftruncate(fd, nSize) == 0) {
+            void* pRegion = mmap(NULL, nSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (pRegion != MAP_FAILED) {
+                monitor.pRegion = pRegion;
+                monitor.bShared = true;
+            }
+        }
+        close(fd);
+        if (!monitor.bShared)
+            shm_unlink(monitor.sName);
+    }
+    if (!monitor.pRegion) {
+        monitor.sName[0] = '\0';
+        monitor.pRegion  = calloc(1, nSize);
+    }
+    return monitor.pRegion;
+}
+
+void rtmonitorRelease(RTMONITOR& monitor) {
+    if (monitor.bShared) {
+        munmap(monitor.pRegion, monitor.nSize);
+        shm_unlink(monitor.sName);
+    } else {
+        free(monitor.pRegion);
+    }
+    monitor.pRegion  = nullptr;
+    monitor.nSize    = 0;
+    monitor.bShared  = false;
+    monitor.sName[0] = '\0';
+}
@@ -0,0 +1,64 @@
+/*  Declares shared memory monitor regions shared by zynlibs
+ *
+ *   Copyright (c) 2020 Brian Walton
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*  A library's process thread publishes its state to a monitor region that UI code and other processes read without calling the library.
+ *  The region is a POSIX shared memory object named <prefix>.<pid> so each instance of a library has its own region. Only the instance that
+ *  created the object clears or unlinks it. If shared memory is unavailable the region is allocated privately and is only readable in-process.
+ *  Each block of published state starts with a seqlock counter: the writer makes it odd before and even after updating the block. Readers copy
+ *  the block and retry if the counter was odd or changed during the copy. The writer never waits for readers.
+ */
+
+#pragma once
+
+#include <cstddef> // provides size_t
+#include <cstdint> // provides uint data types
+
+struct RTMONITOR {
+    void* pRegion  = nullptr; // Pointer to zero initialised region (nullptr if not created)
+    size_t nSize   = 0;       // Size of region in bytes
+    bool bShared   = false;   // True if region is shared memory created by this instance (false if private memory)
+    char sName[64] = "";      // Name of shared memory object (empty if private memory)
+};
+
+/** @brief  Create monitor region
+ *   @param  monitor Monitor descriptor to populate
+ *   @param  sPrefix Shared memory object name prefix, e.g. "/zynseq"
+ *   @param  nSize Size of region in bytes
+ *   @retval void* Pointer to zero initialised region or nullptr if no memory available
+ *   @note   Falls back to private memory if shared memory cannot be created (bShared is false)
+ */
+void* rtmonitorCreate(RTMONITOR& monitor, const char* sPrefix, size_t nSize);
+
+/** @brief  Release monitor region, unlinking shared memory only if created by this instance
+ *   @param  monitor Monitor descriptor populated by rtmonitorCreate
+ */
+void rtmonitorRelease(RTMONITOR& monitor);
+
+/** @brief  Start seqlock write of a block of monitor region
+ *   @param  pSeq Pointer to block's seqlock counter
+ */
+inline void rtmonitorWriteBegin(uint32_t* pSeq) {
+    __atomic_store_n(pSeq, *pSeq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/** @brief  End seqlock write of a block of monitor region
+ *   @param  pSeq Pointer to block's seqlock counter
+ */
+inline void rtmonitorWriteEnd(uint32_t* pSeq) { __atomic_store_n(pSeq, *pSeq + 1, __ATOMIC_RELEASE); }
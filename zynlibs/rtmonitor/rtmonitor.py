@@ -0,0 +1,41 @@
+#!/usr/bin/python3
+# -*- coding: utf-8 -*-
+# ********************************************************************
+# ZYNTHIAN PROJECT: Monitor Region Reader
+#
+# Reads monitor regions published by zynlibs without calling the libraries
+#
+# Copyright (C) 2021-2024 Brian Walton <brian@riban.co.uk>
+# License: LGPL V3
+#
+# ********************************************************************
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License as
+# published by the Free Software Foundation; either version 2 of
+# the License, or any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# For a full copy of the GNU General Public License see the LICENSE.txt file.
+#
+# ********************************************************************
+
+
+
+# Read consistent copy of a seqlock protected block of a monitor region
+# block: ctypes.Structure mapped onto the region whose "seq" field is odd whilst the library writes the block
+# tries: Quantity of attempts before giving up
+# Returns: Copy of block (same ctypes type) or None if block could not be read whilst being updated
+def read_seqlock(block, tries=10):
+    for i in range(tries):
+        seq = block.seq
+        if seq & 1:
+            continue
+        copy = type(block).from_buffer_copy(block)
+        if block.seq == seq:
+            return copy
+    return None
@@ -43,9 +43,9 @@ enum envState {
 };
 
 struct cue_point {
-    uint32_t offset;
+    sf_count_t offset;
     char name[256] = {'\0'};
-    cue_point(uint32_t pos, const char* nm) {
+    cue_point(sf_count_t pos, const char* nm) {
         offset = pos;
         if (nm)
             sprintf(name, nm);
@@ -62,6 +62,7 @@ class AUDIO_PLAYER {
     uint8_t file_open = FILE_CLOSED;
     ;                                 // 0=file closed, 1=file opening, 2=file open - used to flag thread to close file or thread to flag file failed to open
     uint8_t file_read_status  = IDLE; // File reading status (IDLE|SEEKING|LOADING)
+    bool loading              = false; // True whilst file is being opened (until load completion is notified)
 
     uint8_t play_state        = STOPPED;          // Current playback state (STOPPED|STARTING|PLAYING|STOPPING)
     sf_count_t file_read_pos  = 0;                // Current file read position (frames)
@@ -132,8 +133,9 @@ class AUDIO_PLAYER {
 
     jack_ringbuffer_t* ringbuffer_a = nullptr; // Used to pass A samples from file reader to jack process
     jack_ringbuffer_t* ringbuffer_b = nullptr; // Used to pass B samples from file reader to jack process
-    jack_nframes_t play_pos_frames  = 0;       // Current playback position in frames since start of audio at play samplerate
-    size_t frames                   = 0;       // Quanity of frames after samplerate conversion
+    sf_count_t play_pos_frames      = 0;       // Current playback position in frames since start of audio at play samplerate
+    sf_count_t frames               = 0;       // Quanity of frames after samplerate conversion
+    sf_count_t seek_indexed         = 0;       // Position in file up to which decoder seek index has been built (frames)
     std::string filename;
     uint8_t base_note        = 60; // MIDI note to play at normal pitch
     uint8_t midi_chan        = -1; // MIDI channel to listen
@@ -145,7 +147,7 @@ class AUDIO_PLAYER {
     uint8_t beats            = 0;                     // Quantity of beats in audio clip (used for stetching loops) 0 if not stretching
     bool time_ratio_dirty    = false;                 // True if time stretch ratio changed
     double time_ratio        = 1.0;                   // Time stretch ratio
-    float src_ratio          = 1.0;                   // Samplerate ratio of file
+    double src_ratio         = 1.0;                   // Samplerate ratio of file (double to maintain frame accuracy in long files)
     float pitch_bend         = 0.0;                   // Amount of MIDI pitch bend applied +/-range
     uint8_t pitch_bend_range = 2;                     // Pitchbend range in semitones
     cb_fn_t* cb_fn           = nullptr;               // Pointer to function to receive notification of change
@@ -157,5 +159,60 @@ class AUDIO_PLAYER {
     float speed                                = 1.0; // Base speed factor
     float pitch                                = 1.0; // Base pitch factor
 
+    // MIDI CC control (processed within jack process)
+    uint8_t cc_map[128]                        = {};  // Player parameter (PLAYER_PARAM_xxx) indexed by MIDI CC number
+    uint8_t cc_flags[128]                      = {};  // Mapping flags (PLAYER_CC_xxx) indexed by MIDI CC number
+    uint8_t cc_msb[32]                         = {};  // Last received MSB of 14-bit CC
+    float gain_target                          = 1.0; // Gain that smoothed gain is approaching
+    float cc_gain                              = 1.0; // Gain requested by CC during current period
+    jack_nframes_t cc_gain_offset              = UINT32_MAX; // Frame offset within period of first gain CC (UINT32_MAX if none)
+    float varispeed_target                     = 1.0; // Varispeed that smoothed varispeed is approaching
+    bool varispeed_ride                        = false; // True whilst varispeed is approaching target set by CC
+    float cc_smooth_time                       = 0.02;  // Time constant of CC parameter smoothing in seconds
+
+    // Time stretch quality governor
+    uint8_t stretch_quality                    = 0;   // Best permitted quality tier (STRETCH_TIER_xxx)
+    uint8_t stretch_tier_req                   = 0;   // Quality tier requested by governor
+    uint8_t stretch_tier                       = 0;   // Quality tier in use by jack process
+    uint8_t last_stretch_tier                  = 0;
+    uint8_t stretch_priority                   = 128; // Governor priority (lower degraded first, 255 never degraded)
+    double rs_frac                             = 1.0; // Resample tier: position between previous and current frame
+    float rs_prev_a                            = 0.0; // Resample tier: previous A sample
+    float rs_prev_b                            = 0.0; // Resample tier: previous B sample
+    float rs_cur_a                             = 0.0; // Resample tier: current A sample
+    float rs_cur_b                             = 0.0; // Resample tier: current B sample
+
     RubberBand::RubberBandStretcher* stretcher = nullptr; // Time/pitch warp
+    jack_nframes_t stretcher_samplerate        = 0;       // Samplerate stretcher was created for
+    uint32_t stretcher_serial                  = 0;       // Incremented when stretcher is allocated or reset outside jack process
+    uint32_t stretcher_synced                  = 0;       // Value of stretcher_serial when jack process last reset stretcher for capture
+    size_t ringbuffer_size                     = 0;       // Size of each ring buffer in bytes
+    uint32_t pool_index                        = 0;       // Identifies player whilst idle in pool (pool port names)
+
+    // Gapless playlist
+    std::vector<std::string> playlist;                // Queue of files to play after current file (protected by mutex)
+    float crossfade                            = 0.0; // Duration of crossfade between playlist files in seconds (0 for gapless butt joint)
+    uint64_t ring_frames_written               = 0;   // Quantity of frames written to ring buffers since last seek
+    uint64_t ring_frames_read                  = 0;   // Quantity of frames read from ring buffers since last seek
+    uint64_t switch_pos                        = 0;   // Value of ring_frames_read at which next playlist file starts
+    bool switch_pending                        = false; // True if file reader has switched to next playlist file but playback has not reached it
+    bool playlist_switched                     = false; // True if playback has switched to next playlist file (cleared by notification)
+    double switch_time_ratio                   = 1.0;   // Time stretch ratio to apply when playback reaches next playlist file
+    unsigned int last_playlist_count           = 0;
+    struct SF_INFO next_info;                         // Info of next playlist file, staged by file reader until playback reaches it (protected by mutex)
+    std::string next_filename;                        // Path of next playlist file (protected by mutex)
+    double next_src_ratio                      = 1.0; // Samplerate ratio of next playlist file (protected by mutex)
+    sf_count_t next_frames                     = 0;   // Quantity of frames in next playlist file (protected by mutex)
+    sf_count_t next_loop_start                 = 0;   // Loop start of next playlist file (protected by mutex)
+    sf_count_t next_loop_end                   = 0;   // Loop end of next playlist file (protected by mutex)
+    uint8_t next_beats                         = 0;   // Quantity of beats in next playlist file (protected by mutex)
+    uint8_t next_base_note                     = 60;  // Base note of next playlist file (protected by mutex)
+
+    // Monitor feed (published by jack process)
+    int monitor_slot                           = -1;  // Index of slot in monitor region (-1 if none)
+    uint32_t monitor_frames                    = 0;   // Quantity of frames accumulated in current envelope point
+    float monitor_peak_a                       = 0.0; // Peak absolute A level of current envelope point
+    float monitor_peak_b                       = 0.0; // Peak absolute B level of current envelope point
+    float monitor_sum_a                        = 0.0; // Sum of squared A samples of current envelope point
+    float monitor_sum_b                        = 0.0; // Sum of squared B samples of current envelope point
 };
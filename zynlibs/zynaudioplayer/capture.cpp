@@ -0,0 +1,293 @@
+/*  Implementation of capture and replay of audio player process inputs
+    Copyright (C) 2021-2024 Brian Walton <brian@riban.co.uk>
+    License: LGPL V3
+*/
+
+#include "capture.h"
+
+#include <cstring> // provides memset, memcpy
+#include <vector>  // provides vector
+
+// Operations recorded on ring tape
+enum TAPE_OP : uint32_t {
+    TAPE_SPACE,  // Read space (bytes holds value)
+    TAPE_READ,   // Read (bytes of data follow)
+    TAPE_ADVANCE // Read advance after peeking read vector (bytes of data consumed follow)
+};
+
+// Ring tape entry header
+struct TAPE_ENTRY {
+    uint32_t ring;  // Ring identifier [IO_RING]
+    uint32_t op;    // Operation [TAPE_OP]
+    uint32_t bytes; // Read space or quantity of bytes of data that follow
+};
+
+// Capture
+static bool s_bPeriodCapture                                   = false; // True if current period is being captured
+static jack_nframes_t s_nPeriodFrames                          = 0;     // Quantity of frames in current period
+static uint32_t s_nSamplerate                                  = 0;     // Playback samplerate in current period
+static jack_default_audio_sample_t* s_aOutputs[IO_MAX_OUTPUTS] = {};    // Output buffers requested in current period (hashed at end of period)
+static uint32_t s_nOutputs                                     = 0;     // Quantity of output buffers requested in current period
+
+// Replay
+static bool s_bReplay               = false;   // True if replaying
+static REPLAY_MIDI* s_pReplayMidi   = nullptr; // Replay MIDI input buffer
+static const uint8_t* s_pTape       = nullptr; // Next entry on ring tape of current replayed period
+static const uint8_t* s_pTapeEnd    = nullptr; // End of ring tape of current replayed period
+static bool s_bTapeError            = false;   // True if jack process diverged from ring tape
+static std::vector<float> s_vVector[2];        // Data consumed from read vector of A and B ring in current replayed period
+static std::vector<float> s_vZeros;            // Silence beyond recorded data (sized to largest read space on tape)
+static uint64_t s_nReplayOutputHash = 0;       // Hash of audio outputs from last replayed period
+static uint64_t s_nReplayStateHash  = 0;       // Hash of player state from last replayed period
+
+// Get period record being populated
+static CAPTURE_PERIOD_DATA* periodRecord() { return (CAPTURE_PERIOD_DATA*)captureRecordFixed(); }
+
+// Start populating record of current period
+static void beginPeriodRecord() {
+    CAPTURE_PERIOD_DATA* pPeriod = (CAPTURE_PERIOD_DATA*)captureRecordBegin(CAPTURE_RECORD_PERIOD, sizeof(CAPTURE_PERIOD_DATA));
+    if (!pPeriod)
+        return;
+    pPeriod->period     = captureGetPeriod();
+    pPeriod->frames     = s_nPeriodFrames;
+    pPeriod->samplerate = s_nSamplerate;
+    s_bPeriodCapture    = true;
+}
+
+void ioBeginPeriod(jack_nframes_t nFrames, uint32_t nSamplerate) {
+    s_nPeriodFrames  = nFrames;
+    s_nSamplerate    = nSamplerate;
+    s_bPeriodCapture = false;
+    s_nOutputs       = 0;
+    if (captureBeginCallback())
+        beginPeriodRecord();
+}
+
+void ioCaptureState(const void* pState, uint32_t nSize) {
+    if (captureState(pState, nSize))
+        beginPeriodRecord();
+}
+
+bool ioIsPeriodCaptured() { return s_bPeriodCapture && captureIsProcessThread(); }
+
+bool ioIsPeriodHashed() { return s_bPeriodCapture || s_bReplay; }
+
+void ioCapturePlayer(const CAPTURE_PLAYER_DATA* pPlayer, const void* pState, const int64_t* pCues, size_t nCueStride) {
+    if (!ioIsPeriodCaptured())
+        return;
+    if (!captureRecordAppend(pPlayer, sizeof(CAPTURE_PLAYER_DATA)) || !captureRecordAppend(pState, pPlayer->state))
+        return;
+    for (uint32_t cue = 0; cue < pPlayer->cues; ++cue)
+        if (!captureRecordAppend((const uint8_t*)pCues + cue * nCueStride, sizeof(int64_t)))
+            return;
+    ++periodRecord()->players;
+}
+
+void ioEndPeriod(uint64_t nStateHash) {
+    if (!s_bPeriodCapture && !s_bReplay) {
+        captureEndCallback();
+        return;
+    }
+    uint64_t nOutputHash = CAPTURE_HASH_SEED;
+    for (uint32_t nOutput = 0; nOutput < s_nOutputs; ++nOutput) {
+        nOutputHash = captureHash(nOutputHash, &nOutput, sizeof(nOutput));
+        nOutputHash = captureHash(nOutputHash, s_aOutputs[nOutput], s_nPeriodFrames * sizeof(jack_default_audio_sample_t));
+    }
+    if (s_bReplay) {
+        if (s_pTape != s_pTapeEnd)
+            s_bTapeError = true; // Jack process did not consume all it consumed during capture
+        s_nReplayOutputHash = nOutputHash;
+        s_nReplayStateHash  = nStateHash;
+        captureEndCallback();
+        return;
+    }
+    CAPTURE_PERIOD_DATA* pPeriod = periodRecord();
+    pPeriod->outputHash          = nOutputHash;
+    pPeriod->stateHash           = nStateHash;
+    captureRecordEnd();
+    s_bPeriodCapture = false;
+    captureEndCallback();
+}
+
+jack_default_audio_sample_t* ioGetAudioOutput(jack_port_t* pPort, jack_nframes_t nFrames) {
+    jack_default_audio_sample_t* pBuffer = s_bReplay ? (jack_default_audio_sample_t*)pPort : (jack_default_audio_sample_t*)jack_port_get_buffer(pPort, nFrames);
+    if (s_nOutputs < IO_MAX_OUTPUTS)
+        s_aOutputs[s_nOutputs++] = pBuffer;
+    return pBuffer;
+}
+
+void* ioGetMidiBuffer(jack_port_t* pPort, jack_nframes_t nFrames) {
+    if (s_bReplay)
+        return s_pReplayMidi;
+    return jack_port_get_buffer(pPort, nFrames);
+}
+
+uint32_t ioMidiGetEventCount(void* pBuffer) {
+    if (s_bReplay)
+        return replayMidiCount((REPLAY_MIDI*)pBuffer);
+    return jack_midi_get_event_count(pBuffer);
+}
+
+int ioMidiEventGet(jack_midi_event_t* pEvent, void* pBuffer, uint32_t index) {
+    if (s_bReplay)
+        return replayMidiGet(pEvent, (REPLAY_MIDI*)pBuffer, index);
+    int nResult = jack_midi_event_get(pEvent, pBuffer, index);
+    if (nResult == 0 && ioIsPeriodCaptured()) {
+        // Append MIDI input event to period record
+        if (captureRecordMidi(pEvent))
+            ++periodRecord()->events;
+    }
+    return nResult;
+}
+
+// Append entry to ring tape of period record
+static void tapeAppend(uint32_t nRing, uint32_t nOp, uint32_t nBytes, const void* pData1 = nullptr, uint32_t nBytes1 = 0, const void* pData2 = nullptr,
+                       uint32_t nBytes2 = 0) {
+    TAPE_ENTRY entry = {nRing, nOp, nBytes};
+    if (!captureRecordAppend(&entry, sizeof(entry)))
+        return;
+    if (nBytes1 && !captureRecordAppend(pData1, nBytes1))
+        return;
+    if (nBytes2)
+        captureRecordAppend(pData2, nBytes2);
+}
+
+// Get next entry from ring tape of replayed period - returns pointer to its data or nullptr if jack process diverged from tape
+static const uint8_t* tapeNext(uint32_t nRing, uint32_t nOp, TAPE_ENTRY& entry) {
+    if (s_bTapeError || s_pTape + sizeof(entry) > s_pTapeEnd) {
+        s_bTapeError = true;
+        return nullptr;
+    }
+    memcpy(&entry, s_pTape, sizeof(entry));
+    const uint8_t* pData = s_pTape + sizeof(entry);
+    uint32_t nData       = nOp == TAPE_SPACE ? 0 : entry.bytes;
+    if (entry.ring != nRing || entry.op != nOp || pData + nData > s_pTapeEnd) {
+        s_bTapeError = true;
+        return nullptr;
+    }
+    s_pTape = pData + nData;
+    return pData;
+}
+
+size_t ioRingReadSpace(jack_ringbuffer_t* pRing, uint32_t nRing) {
+    if (s_bReplay) {
+        TAPE_ENTRY entry;
+        if (!tapeNext(nRing, TAPE_SPACE, entry))
+            return 0;
+        if (s_vZeros.size() < entry.bytes / sizeof(float))
+            s_vZeros.resize(entry.bytes / sizeof(float));
+        return entry.bytes;
+    }
+    size_t nSpace = jack_ringbuffer_read_space(pRing);
+    if (ioIsPeriodCaptured())
+        tapeAppend(nRing, TAPE_SPACE, nSpace);
+    return nSpace;
+}
+
+size_t ioRingRead(jack_ringbuffer_t* pRing, uint32_t nRing, char* pDest, size_t nBytes) {
+    if (s_bReplay) {
+        TAPE_ENTRY entry;
+        const uint8_t* pData = tapeNext(nRing, TAPE_READ, entry);
+        if (!pData || entry.bytes > nBytes) {
+            s_bTapeError = true;
+            return 0;
+        }
+        memcpy(pDest, pData, entry.bytes);
+        return entry.bytes;
+    }
+    size_t nRead = jack_ringbuffer_read(pRing, pDest, nBytes);
+    if (ioIsPeriodCaptured())
+        tapeAppend(nRing, TAPE_READ, nRead, pDest, nRead);
+    return nRead;
+}
+
+void ioRingGetReadVector(jack_ringbuffer_t* pRing, uint32_t nRing, jack_ringbuffer_data_t* pVector) {
+    if (!s_bReplay) {
+        jack_ringbuffer_get_read_vector(pRing, pVector);
+        return;
+    }
+    // Serve data that jack process consumed from this vector during capture, found ahead on tape, followed by silence
+    std::vector<float>& vData = s_vVector[nRing & 1];
+    vData.clear();
+    TAPE_ENTRY entry;
+    for (const uint8_t* pTape = s_pTape; pTape + sizeof(entry) <= s_pTapeEnd;) {
+        memcpy(&entry, pTape, sizeof(entry));
+        pTape += sizeof(entry);
+        uint32_t nData = entry.op == TAPE_SPACE ? 0 : entry.bytes;
+        if (pTape + nData > s_pTapeEnd)
+            break;
+        if (entry.op == TAPE_ADVANCE && entry.ring == nRing) {
+            vData.resize(nData / sizeof(float));
+            memcpy(vData.data(), pTape, vData.size() * sizeof(float));
+            break;
+        }
+        pTape += nData;
+    }
+    pVector[0].buf = (char*)vData.data();
+    pVector[0].len = vData.size() * sizeof(float);
+    pVector[1].buf = (char*)s_vZeros.data();
+    pVector[1].len = s_vZeros.size() * sizeof(float);
+}
+
+void ioRingReadAdvance(jack_ringbuffer_t* pRing, uint32_t nRing, const jack_ringbuffer_data_t* pVector, size_t nBytes) {
+    if (s_bReplay) {
+        TAPE_ENTRY entry;
+        if (tapeNext(nRing, TAPE_ADVANCE, entry) && entry.bytes != nBytes)
+            s_bTapeError = true;
+        return;
+    }
+    if (ioIsPeriodCaptured()) {
+        size_t nBytes1 = nBytes < pVector[0].len ? nBytes : pVector[0].len;
+        tapeAppend(nRing, TAPE_ADVANCE, nBytes, pVector[0].buf, nBytes1, pVector[1].buf, nBytes - nBytes1);
+    }
+    jack_ringbuffer_read_advance(pRing, nBytes);
+}
+
+void ioRingReset(jack_ringbuffer_t* pRing) {
+    if (!s_bReplay)
+        jack_ringbuffer_reset(pRing);
+}
+
+void replayStart() {
+    if (s_bReplay)
+        return;
+    s_pReplayMidi = replayMidiCreate();
+    s_bReplay     = true;
+}
+
+void replayStop() {
+    if (!s_bReplay)
+        return;
+    s_bReplay = false;
+    replayMidiFree(s_pReplayMidi);
+    s_pReplayMidi = nullptr;
+    s_pTape = s_pTapeEnd = nullptr;
+    for (auto& vData : s_vVector)
+        std::vector<float>().swap(vData);
+    std::vector<float>().swap(s_vZeros);
+    s_nOutputs = 0;
+}
+
+bool replayIsRunning() { return s_bReplay; }
+
+jack_port_t* replayCreatePort() { return (jack_port_t*)new jack_default_audio_sample_t[CAPTURE_MAX_FRAMES](); }
+
+void replayFreePort(jack_port_t* pPort) { delete[] (jack_default_audio_sample_t*)pPort; }
+
+bool replaySetPeriod(const CAPTURE_PERIOD_DATA* pPeriod, const uint8_t* pEvents, const uint8_t* pEnd) {
+    if (!s_bReplay || pPeriod->frames > CAPTURE_MAX_FRAMES)
+        return false;
+    replayMidiReset(s_pReplayMidi, pPeriod->frames, 0);
+    s_pTape = replayMidiFill(s_pReplayMidi, pEvents, pPeriod->events);
+    if (!s_pTape || s_pTape > pEnd)
+        return false;
+    s_pTapeEnd   = pEnd;
+    s_bTapeError = false;
+    return true;
+}
+
+bool replayGetPeriodHashes(uint64_t* pOutput, uint64_t* pState) {
+    *pOutput = s_nReplayOutputHash;
+    *pState  = s_nReplayStateHash;
+    return !s_bTapeError;
+}
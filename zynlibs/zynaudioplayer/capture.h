@@ -0,0 +1,179 @@
+/*  Capture and replay of audio player process inputs
+    Copyright (C) 2021-2024 Brian Walton <brian@riban.co.uk>
+    License: LGPL V3
+
+    The jack process reaches JACK ports and the file reader ring buffers only through the io* functions declared here. Normally they call JACK directly.
+    During capture they also record each period's inputs (MIDI input events and a tape of ring buffer read space and audio consumed) and a hash of its
+    audio outputs using the shared capture core (rtcapture.h). During replay the io* functions serve the recorded inputs from memory and ports are replay
+    buffers. Player configuration changed by API calls and the file reader is recorded as a snapshot of each player at the start of each period.
+*/
+
+#pragma once
+
+#include "rtcapture.h"       // provides shared capture core
+#include <jack/jack.h>       // provides interface to JACK
+#include <jack/midiport.h>   // provides interface to JACK MIDI ports
+#include <jack/ringbuffer.h> // provides jack ring buffer
+
+#define CAPTURE_VERSION 1
+#define CAPTURE_MAX_FRAMES 8192 // Largest JACK period that may be replayed
+#define IO_MAX_OUTPUTS 256      // Quantity of audio outputs hashed each period (2 per player)
+
+#define IO_RING(index, leg) ((index) * 2 + (leg)) // Identifies a player's ring buffer on the tape (leg 0 for A, 1 for B)
+
+// Process period record payload (followed by each player's CAPTURE_PLAYER_DATA, then MIDI input events, each time:uint32, size:uint32, data, then ring tape)
+struct CAPTURE_PERIOD_DATA {
+    uint32_t period;        // Index of period since start of capture
+    jack_nframes_t frames;  // Quantity of frames in period
+    uint32_t samplerate;    // Playback samplerate
+    uint32_t players;       // Quantity of players that follow
+    uint32_t events;        // Quantity of MIDI input events that follow players
+    uint32_t pad;           // Padding
+    uint64_t outputHash;    // Hash of audio outputs
+    uint64_t stateHash;     // Hash of player state at end of period
+};
+
+// Player record (followed by player state snapshot then cue point offsets)
+struct CAPTURE_PLAYER_DATA {
+    uint32_t index;  // Player index
+    uint32_t sync;   // 1 if stretcher was reset to a known state at start of period
+    uint32_t cues;   // Quantity of cue point offsets (sf_count_t) that follow snapshot
+    uint32_t state;  // Size of snapshot
+};
+
+/** @brief  Start process period - call at start of each process callback
+ *   @param  nFrames Quantity of frames in period
+ *   @param  nSamplerate Playback samplerate
+ */
+void ioBeginPeriod(jack_nframes_t nFrames, uint32_t nSamplerate);
+
+/** @brief  Record runtime state at start of first captured period - call from process thread after ioBeginPeriod when captureIsPending
+ *   @param  pState Pointer to state
+ *   @param  nSize Size of state
+ */
+void ioCaptureState(const void* pState, uint32_t nSize);
+
+/** @brief  Check if current period is being captured
+ *   @retval bool True if inputs of this period are recorded
+ */
+bool ioIsPeriodCaptured();
+
+/** @brief  Check if current period is being captured or replayed
+ *   @retval bool True if outputs of this period are hashed
+ */
+bool ioIsPeriodHashed();
+
+/** @brief  Append a player snapshot to the current period record - call before processing MIDI input
+ *   @param  pPlayer Pointer to player record
+ *   @param  pState Pointer to player state snapshot
+ *   @param  pCues Pointer to offset of first cue point
+ *   @param  nCueStride Distance in bytes between offsets of consecutive cue points
+ */
+void ioCapturePlayer(const CAPTURE_PLAYER_DATA* pPlayer, const void* pState, const int64_t* pCues, size_t nCueStride);
+
+/** @brief  End process period - call at end of each process callback, hashes outputs
+ *   @param  nStateHash Hash of player state at end of period
+ */
+void ioEndPeriod(uint64_t nStateHash);
+
+/** @brief  Get audio output buffer for this period (hashed at end of period)
+ *   @param  pPort Pointer to port
+ *   @param  nFrames Quantity of frames in period
+ *   @retval jack_default_audio_sample_t* Pointer to buffer
+ */
+jack_default_audio_sample_t* ioGetAudioOutput(jack_port_t* pPort, jack_nframes_t nFrames);
+
+/** @brief  Get MIDI input buffer for this period
+ *   @param  pPort Pointer to port
+ *   @param  nFrames Quantity of frames in period
+ *   @retval void* Pointer to buffer
+ */
+void* ioGetMidiBuffer(jack_port_t* pPort, jack_nframes_t nFrames);
+
+/** @brief  Get quantity of events in MIDI input buffer
+ *   @param  pBuffer Pointer to buffer
+ *   @retval uint32_t Quantity of events
+ */
+uint32_t ioMidiGetEventCount(void* pBuffer);
+
+/** @brief  Get event from MIDI input buffer (recorded during capture)
+ *   @param  pEvent Pointer to event to populate
+ *   @param  pBuffer Pointer to buffer
+ *   @param  index Index of event
+ *   @retval int 0 on success
+ */
+int ioMidiEventGet(jack_midi_event_t* pEvent, void* pBuffer, uint32_t index);
+
+/** @brief  Get quantity of bytes available to read from a ring buffer (recorded during capture)
+ *   @param  pRing Pointer to ring buffer
+ *   @param  nRing Ring identifier [IO_RING]
+ *   @retval size_t Quantity of bytes
+ */
+size_t ioRingReadSpace(jack_ringbuffer_t* pRing, uint32_t nRing);
+
+/** @brief  Read from a ring buffer (recorded during capture)
+ *   @param  pRing Pointer to ring buffer
+ *   @param  nRing Ring identifier [IO_RING]
+ *   @param  pDest Pointer to destination
+ *   @param  nBytes Maximum quantity of bytes to read
+ *   @retval size_t Quantity of bytes read
+ */
+size_t ioRingRead(jack_ringbuffer_t* pRing, uint32_t nRing, char* pDest, size_t nBytes);
+
+/** @brief  Get read vector of a ring buffer (data later consumed by ioRingReadAdvance during replay)
+ *   @param  pRing Pointer to ring buffer
+ *   @param  nRing Ring identifier [IO_RING]
+ *   @param  pVector Pointer to array of two vectors to populate
+ */
+void ioRingGetReadVector(jack_ringbuffer_t* pRing, uint32_t nRing, jack_ringbuffer_data_t* pVector);
+
+/** @brief  Advance read pointer of a ring buffer (data consumed from read vector is recorded during capture)
+ *   @param  pRing Pointer to ring buffer
+ *   @param  nRing Ring identifier [IO_RING]
+ *   @param  pVector Read vector from ioRingGetReadVector
+ *   @param  nBytes Quantity of bytes consumed
+ */
+void ioRingReadAdvance(jack_ringbuffer_t* pRing, uint32_t nRing, const jack_ringbuffer_data_t* pVector, size_t nBytes);
+
+/** @brief  Reset a ring buffer (ignored during replay)
+ *   @param  pRing Pointer to ring buffer
+ */
+void ioRingReset(jack_ringbuffer_t* pRing);
+
+/** @brief  Start replay - io* functions serve recorded inputs
+ */
+void replayStart();
+
+/** @brief  Stop replay - io* functions return to JACK
+ */
+void replayStop();
+
+/** @brief  Check if replay is running
+ *   @retval bool True if replaying
+ */
+bool replayIsRunning();
+
+/** @brief  Create a replay audio output buffer to use as a port
+ *   @retval jack_port_t* Pointer to buffer (free with replayFreePort)
+ */
+jack_port_t* replayCreatePort();
+
+/** @brief  Free a replay audio output buffer
+ *   @param  pPort Pointer to buffer from replayCreatePort
+ */
+void replayFreePort(jack_port_t* pPort);
+
+/** @brief  Set inputs of next replayed period
+ *   @param  pPeriod Pointer to period record payload
+ *   @param  pEvents Pointer to MIDI input events (following player records)
+ *   @param  pEnd Pointer to end of payload
+ *   @retval bool True on success, false if period exceeds replay buffers or record is truncated
+ */
+bool replaySetPeriod(const CAPTURE_PERIOD_DATA* pPeriod, const uint8_t* pEvents, const uint8_t* pEnd);
+
+/** @brief  Get hashes from last replayed period
+ *   @param  pOutput Pointer to populate with audio output hash
+ *   @param  pState Pointer to populate with player state hash
+ *   @retval bool True if jack process consumed the ring tape exactly as captured
+ */
+bool replayGetPeriodHashes(uint64_t* pOutput, uint64_t* pState);
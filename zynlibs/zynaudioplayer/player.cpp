@@ -5,9 +5,13 @@
 */
 
 #include "player.h"
+#include "capture.h"   // provides capture and replay of process inputs
+#include "rtlog.h"     // provides real-time safe logging from process thread
+#include "rtmonitor.h" // provides shared memory monitor region
 
 #include <algorithm>       // provides find
 #include <arpa/inet.h>     // provides inet_pton
+#include <atomic>          // provides atomic
 #include <cstring>         // provides strcmp, memset
 #include <fcntl.h>         // provides fcntl
 #include <jack/jack.h>     // provides interface to JACK
@@ -17,6 +21,7 @@
 #include <stdio.h>         // provides printf
 #include <stdlib.h>        // provides exit
 #include <string>          // provides std:string
+#include <sys/eventfd.h>   // provides eventfd
 #include <unistd.h>        // provides usleep
 #include <vector>
 
@@ -33,13 +38,55 @@ uint8_t g_last_debug        = 0;
 char g_supported_codecs[1024];
 uint8_t g_mutex      = 0;
 uint32_t g_nextIndex = 1;
+vector<AUDIO_PLAYER*> g_vPlayerPool; // Idle players with registered ports and preallocated buffers
+unsigned int g_poolSize   = 0;       // Quantity of idle players to keep in pool
+atomic<uint32_t> g_nextPoolIndex{1}; // Used to give pooled players unique port names
+pthread_mutex_t g_pool_mutex = PTHREAD_MUTEX_INITIALIZER; // Protects player pool
+pthread_cond_t g_pool_cond   = PTHREAD_COND_INITIALIZER;  // Signalled when a player is taken from pool or pool refill thread should exit
+pthread_t g_pool_thread;                                  // ID of pool refill thread
+bool g_pool_refill           = false;                     // True whilst pool refill thread runs
 float g_tempo        = 2.0; // Tempo in beats per second
+pthread_mutex_t g_load_mutex = PTHREAD_MUTEX_INITIALIZER; // Protects load slots and player loading flags
+pthread_cond_t g_load_cond   = PTHREAD_COND_INITIALIZER;  // Signalled when a load slot is released or a load completes
+unsigned int g_loads_active  = 0;                         // Quantity of files currently being opened
+unsigned int g_max_loads     = 4;                         // Maximum quantity of files that may be opened concurrently
+int g_load_fd                = -1;                        // eventfd signalled when each load completes
+vector<pair<AUDIO_PLAYER*, uint8_t>> g_vLoadResults;      // Queue of completed loads (player, success) protected by g_load_mutex
+uint8_t g_beats_per_bar      = 4;                         // Quantity of beats in each bar, used to align tempo synced playlist files
+bool g_governor              = false;                     // True if stretch governor enabled
+pthread_t g_governor_thread;                              // ID of stretch governor thread
+float g_governor_low         = 50.0;                      // DSP load (percent) below which governor improves stretch quality
+float g_governor_high        = 80.0;                      // DSP load (percent) above which governor reduces stretch quality
+float g_governor_load        = 0.0;                       // Smoothed DSP load (percent)
+monitor_region* g_monitor    = nullptr;                   // Monitor feed of player state and output envelopes
+RTMONITOR g_monitor_shm;                                  // Shared memory containing monitor region
 
 // Declare local functions
 void set_env_gate(AUDIO_PLAYER* pPlayer, uint8_t gate);
 void reset_env(AUDIO_PLAYER* pPlayer);
 float process_env(AUDIO_PLAYER* pPlayer);
 
+#define SEEK_DECODE_SECONDS 2      // Forward seeks within encoded files shorter than this decode rather than seek
+#define SEEK_CHECKPOINT_SECONDS 60 // Interval between seek index checkpoints in MPEG files
+#define SEEK_INDEX_MIN_SECONDS 600 // Minimum duration of MPEG file that requires seek index
+#define CC_JOG_STEP 0.01           // Seconds moved by each tick of a jog CC
+#define GOVERNOR_INTERVAL 100000   // Stretch governor DSP load poll interval (us)
+#define GOVERNOR_SETTLE 5          // Quantity of governor intervals to wait after reducing quality before reducing again
+#define GOVERNOR_HOLD 20           // Quantity of governor intervals DSP load must be low before improving quality
+#define GOVERNOR_MAX_TIER STRETCH_TIER_FAST // Cheapest stretch tier governor may select
+#define POOL_SRC_RATIO 2           // Ring buffers of pooled players are sized for files down to half JACK samplerate so that most loads reuse them
+
+// Delay line holding the last frames of a playlist file to crossfade with the next file
+struct fade_buffer {
+    vector<float> a;       // A samples
+    vector<float> b;       // B samples
+    size_t count  = 0;     // Quantity of frames held
+    size_t pos    = 0;     // Index of oldest frame
+    size_t mixed  = 0;     // Quantity of frames of next file mixed with held frames
+    size_t length = 0;     // Quantity of frames in current crossfade
+    bool fading   = false; // True whilst mixing held frames with next file
+};
+
 #define DPRINTF(fmt, args...)                                                                                                                                  \
     if (g_debug)                                                                                                                                               \
     fprintf(stderr, fmt, ##args)
@@ -203,6 +250,23 @@ void send_notifications(AUDIO_PLAYER* pPlayer, int param) {
         if (pPlayer->cb_fn)
             ((cb_fn_t*)pPlayer->cb_fn)(pPlayer, NOTIFY_VARISPEED, (float)(pPlayer->varispeed));
     }
+    if (param == NOTIFY_ALL || param == NOTIFY_PLAYLIST) {
+        getMutex();
+        unsigned int nCount = pPlayer->playlist.size();
+        bool bSwitched      = pPlayer->playlist_switched;
+        pPlayer->playlist_switched = false;
+        releaseMutex();
+        if (bSwitched || nCount != pPlayer->last_playlist_count) {
+            pPlayer->last_playlist_count = nCount;
+            if (pPlayer->cb_fn)
+                ((cb_fn_t*)pPlayer->cb_fn)(pPlayer, NOTIFY_PLAYLIST, (float)(nCount));
+        }
+    }
+    if ((param == NOTIFY_ALL || param == NOTIFY_STRETCH_TIER) && pPlayer->stretch_tier != pPlayer->last_stretch_tier) {
+        pPlayer->last_stretch_tier = pPlayer->stretch_tier;
+        if (pPlayer->cb_fn)
+            ((cb_fn_t*)pPlayer->cb_fn)(pPlayer, NOTIFY_STRETCH_TIER, (float)(pPlayer->stretch_tier));
+    }
     if ((param == NOTIFY_ALL || param == NOTIFY_DEBUG) && g_debug != g_last_debug) {
         g_last_debug = g_debug;
         if (pPlayer->cb_fn)
@@ -210,6 +274,301 @@ void send_notifications(AUDIO_PLAYER* pPlayer, int param) {
     }
 }
 
+// Configure stretcher options for a quality tier (stretcher options may be changed whilst processing in realtime mode)
+void set_stretch_options(AUDIO_PLAYER* pPlayer, uint8_t tier) {
+    if (!pPlayer->stretcher || tier == STRETCH_TIER_RESAMPLE)
+        return;
+    pPlayer->stretcher->setFormantOption(tier == STRETCH_TIER_FULL ? RubberBandStretcher::OptionFormantPreserved : RubberBandStretcher::OptionFormantShifted);
+    pPlayer->stretcher->setPitchOption(tier == STRETCH_TIER_FAST ? RubberBandStretcher::OptionPitchHighSpeed : RubberBandStretcher::OptionPitchHighConsistency);
+    pPlayer->stretcher->setTransientsOption(tier == STRETCH_TIER_FAST ? RubberBandStretcher::OptionTransientsSmooth : RubberBandStretcher::OptionTransientsCrisp);
+    pPlayer->stretcher->setPhaseOption(tier == STRETCH_TIER_FAST ? RubberBandStretcher::OptionPhaseIndependent : RubberBandStretcher::OptionPhaseLaminar);
+}
+
+void alloc_stretcher(AUDIO_PLAYER* pPlayer) {
+    // Reuse existing (e.g. pool preallocated) stretcher unless samplerate has changed
+    ++pPlayer->stretcher_serial;
+    if (pPlayer->stretcher && pPlayer->stretcher_samplerate == g_samplerate) {
+        pPlayer->stretcher->reset();
+        set_stretch_options(pPlayer, pPlayer->stretch_tier);
+        return;
+    }
+    delete pPlayer->stretcher;
+    pPlayer->stretcher = new RubberBandStretcher(g_samplerate, 2,
+                                                 RubberBandStretcher::OptionProcessRealTime | RubberBandStretcher::OptionWindowShort |
+                                                     RubberBandStretcher::OptionPitchHighConsistency | RubberBandStretcher::OptionFormantPreserved);
+    pPlayer->stretcher->setMaxProcessSize(256);
+    pPlayer->stretcher_samplerate = g_samplerate;
+    set_stretch_options(pPlayer, pPlayer->stretch_tier);
+}
+
+void alloc_ringbuffers(AUDIO_PLAYER* pPlayer, size_t size) {
+    // Reuse existing (e.g. pool preallocated) ring buffers if they are large enough
+    if (pPlayer->ringbuffer_a && pPlayer->ringbuffer_b && pPlayer->ringbuffer_size >= size) {
+        jack_ringbuffer_reset(pPlayer->ringbuffer_a);
+        jack_ringbuffer_reset(pPlayer->ringbuffer_b);
+        return;
+    }
+    if (pPlayer->ringbuffer_a)
+        jack_ringbuffer_free(pPlayer->ringbuffer_a);
+    if (pPlayer->ringbuffer_b)
+        jack_ringbuffer_free(pPlayer->ringbuffer_b);
+    pPlayer->ringbuffer_a = jack_ringbuffer_create(size);
+    jack_ringbuffer_mlock(pPlayer->ringbuffer_a);
+    pPlayer->ringbuffer_b = jack_ringbuffer_create(size);
+    jack_ringbuffer_mlock(pPlayer->ringbuffer_b);
+    pPlayer->ringbuffer_size = size;
+}
+
+bool acquire_load_slot(AUDIO_PLAYER* pPlayer) {
+    // Wait for a free load slot - returns false if load is cancelled whilst waiting
+    pthread_mutex_lock(&g_load_mutex);
+    while (g_loads_active >= g_max_loads && pPlayer->file_open == FILE_OPENING)
+        pthread_cond_wait(&g_load_cond, &g_load_mutex);
+    bool bAcquired = (pPlayer->file_open == FILE_OPENING);
+    if (bAcquired)
+        ++g_loads_active;
+    pthread_mutex_unlock(&g_load_mutex);
+    return bAcquired;
+}
+
+void load_complete(AUDIO_PLAYER* pPlayer, bool bSlot) {
+    // Release load slot and notify result of load
+    bool bSuccess = (pPlayer->file_open == FILE_OPEN);
+    pthread_mutex_lock(&g_load_mutex);
+    if (bSlot)
+        --g_loads_active;
+    pPlayer->loading = false;
+    if (g_vLoadResults.size() >= MAX_LOAD_RESULTS)
+        g_vLoadResults.erase(g_vLoadResults.begin()); // Nobody is reading results so discard oldest
+    g_vLoadResults.emplace_back(pPlayer, bSuccess);
+    pthread_cond_broadcast(&g_load_cond);
+    pthread_mutex_unlock(&g_load_mutex);
+    if (g_load_fd >= 0) {
+        uint64_t nCount = 1;
+        if (write(g_load_fd, &nCount, sizeof(nCount)) != sizeof(nCount))
+            DPRINTF("libzynaudioplayer failed to signal load completion\n");
+    }
+    if (pPlayer->cb_fn)
+        ((cb_fn_t*)pPlayer->cb_fn)(pPlayer, NOTIFY_LOAD, bSuccess ? 1.0 : 0.0);
+    DPRINTF("libzynaudioplayer load of '%s' %s\n", pPlayer->filename.c_str(), bSuccess ? "completed" : "failed");
+}
+
+// Read metadata from file - playlist files are staged in next_xxx until playback reaches them and do not change loop, gain or cue points of the player
+void read_metadata(AUDIO_PLAYER* pPlayer, SNDFILE* pFile, bool bPlaylist) {
+    const char* loopModes[] = {"None", "Forward", "Backward", "Alternating"};
+    SF_CUES cues;
+    cues.cue_count = 0;
+    if (!bPlaylist)
+        sf_command(pFile, SFC_GET_CUE, &cues, sizeof(cues));
+
+    int nLoopMode  = SF_LOOP_FORWARD; // Loop mode (loop is enabled if file has no loop info)
+    uint8_t nBeats = 0;
+    SF_LOOP_INFO loopInfo;
+    if (sf_command(pFile, SFC_GET_LOOP_INFO, &loopInfo, sizeof(loopInfo)) == SF_TRUE) {
+        fprintf(stderr, "File loop info: Sig:%d/%d, %0.2fBPM, %d beats, Mode: %s, Root key: %d\n", loopInfo.time_sig_num, loopInfo.time_sig_den, loopInfo.bpm,
+                loopInfo.num_beats, loopModes[loopInfo.loop_mode - 800], loopInfo.root_key);
+        nLoopMode = loopInfo.loop_mode;
+        nBeats    = loopInfo.num_beats;
+    }
+
+    float fGain           = 1.0;
+    int nBaseNote         = 60;
+    sf_count_t nLoopStart = -1; // Loop start from instrument info (-1 if none)
+    sf_count_t nLoopEnd   = -1;
+    SF_INSTRUMENT inst;
+    if (sf_command(pFile, SFC_GET_INSTRUMENT, &inst, sizeof(inst)) == SF_TRUE) {
+        fprintf(stderr, "File instrument info: gain: %d, detune:%d, velocity: %d-%d, basenote: %d, detune: %d, keyrange: %d-%d\n", inst.gain, inst.detune,
+                inst.velocity_lo, inst.velocity_hi, inst.basenote, inst.detune, inst.key_lo, inst.key_hi);
+        fGain = pow(10, (float(inst.gain) / 20));
+        for (int i = 0; i < inst.loop_count; ++i) {
+            fprintf(stderr, "\tLoop %d: mode:%s, start: %d, end:%d, count:%u\n", i, loopModes[inst.loops[i].mode - 800], inst.loops[i].start, inst.loops[i].end,
+                    inst.loops[i].count);
+        }
+        nBaseNote = inst.basenote; // Negative base note leaves base note unchanged
+        if (inst.loop_count) {
+            nLoopStart = inst.loops[0].start;
+            nLoopEnd   = inst.loops[0].end;
+        }
+    }
+
+    if (bPlaylist) {
+        // Time ratio, base note and loop points are applied when playback reaches this file
+        getMutex();
+        pPlayer->next_beats      = nBeats;
+        pPlayer->next_base_note  = nBaseNote >= 0 ? nBaseNote : pPlayer->base_note;
+        pPlayer->next_loop_start = nLoopStart >= 0 ? nLoopStart : 0;
+        pPlayer->next_loop_end   = nLoopEnd >= 0 ? nLoopEnd : pPlayer->next_frames;
+        releaseMutex();
+        return;
+    }
+
+    getMutex();
+    for (uint32_t i = 0; i < cues.cue_count; ++i)
+        add_cue_point_frames(pPlayer, cues.cue_points[i].sample_offset, cues.cue_points[i].name);
+    releaseMutex();
+    enable_loop(pPlayer, nLoopMode == SF_LOOP_FORWARD);
+    set_beats(pPlayer, nBeats);
+    getMutex();
+    pPlayer->gain = fGain;
+    if (nBaseNote >= 0)
+        pPlayer->base_note = nBaseNote;
+    if (nLoopStart >= 0) {
+        pPlayer->loop_start     = nLoopStart;
+        pPlayer->loop_start_src = pPlayer->loop_start * pPlayer->src_ratio;
+        pPlayer->loop_end       = nLoopEnd;
+        pPlayer->loop_end_src   = pPlayer->loop_end * pPlayer->src_ratio;
+    }
+    releaseMutex();
+}
+
+// Apply metadata of next playlist file staged by file reader - called with mutex held when playback reaches the file
+void apply_next_file(AUDIO_PLAYER* pPlayer) {
+    pPlayer->filename.swap(pPlayer->next_filename); // Swap avoids allocation in jack process
+    pPlayer->sf_info          = pPlayer->next_info;
+    pPlayer->src_ratio        = pPlayer->next_src_ratio;
+    pPlayer->pos_notify_delta = float(pPlayer->next_frames) / g_samplerate / 400;
+    pPlayer->frames           = pPlayer->next_frames * pPlayer->src_ratio;
+    pPlayer->loop_start       = pPlayer->next_loop_start;
+    pPlayer->loop_end         = pPlayer->next_loop_end;
+    pPlayer->crop_start       = 0;
+    pPlayer->crop_end         = pPlayer->next_frames;
+    pPlayer->loop_start_src   = pPlayer->loop_start * pPlayer->src_ratio;
+    pPlayer->loop_end_src     = pPlayer->loop_end * pPlayer->src_ratio;
+    pPlayer->crop_start_src   = 0;
+    pPlayer->crop_end_src     = pPlayer->crop_end * pPlayer->src_ratio;
+    pPlayer->beats            = pPlayer->next_beats;
+    pPlayer->base_note        = pPlayer->next_base_note;
+    pPlayer->cue_points.clear(); // Retains capacity so does not free in jack process
+    pPlayer->time_ratio        = pPlayer->switch_time_ratio;
+    pPlayer->time_ratio_dirty  = true;
+    pPlayer->switch_pending    = false;
+    pPlayer->playlist_switched = true;
+}
+
+// Write a frame to the playback ring buffers
+bool ring_write(AUDIO_PLAYER* pPlayer, float fA, float fB) {
+    if (jack_ringbuffer_write_space(pPlayer->ringbuffer_a) < sizeof(float) || jack_ringbuffer_write_space(pPlayer->ringbuffer_b) < sizeof(float))
+        return false;
+    jack_ringbuffer_write(pPlayer->ringbuffer_b, (const char*)(&fB), sizeof(float));
+    jack_ringbuffer_write(pPlayer->ringbuffer_a, (const char*)(&fA), sizeof(float));
+    ++pPlayer->ring_frames_written;
+    return true;
+}
+
+// Write frames held for crossfade to the playback ring buffers
+bool flush_fade(AUDIO_PLAYER* pPlayer, fade_buffer& fade) {
+    while (fade.count) {
+        if (!ring_write(pPlayer, fade.a[fade.pos], fade.b[fade.pos]))
+            return false;
+        fade.pos = (fade.pos + 1) % fade.a.size();
+        --fade.count;
+    }
+    fade.fading = false;
+    return true;
+}
+
+// Write a frame to the playback ring buffers via crossfade delay line - bHold true to hold back last frames of file to crossfade with next playlist file
+bool write_frame(AUDIO_PLAYER* pPlayer, fade_buffer& fade, float fA, float fB, bool bHold) {
+    size_t nSize = fade.a.size();
+    if (fade.fading) {
+        // Mix oldest held frame of previous file with this frame of next file
+        float fGain = float(fade.mixed) / fade.length;
+        if (!ring_write(pPlayer, fA * fGain + fade.a[fade.pos] * (1.0 - fGain), fB * fGain + fade.b[fade.pos] * (1.0 - fGain)))
+            return false;
+        ++fade.mixed;
+        fade.pos = (fade.pos + 1) % nSize;
+        if (--fade.count == 0)
+            fade.fading = false;
+        return true;
+    }
+    if (bHold && nSize) {
+        if (fade.count < nSize) {
+            size_t nIndex  = (fade.pos + fade.count++) % nSize;
+            fade.a[nIndex] = fA;
+            fade.b[nIndex] = fB;
+            return true;
+        }
+        if (!ring_write(pPlayer, fade.a[fade.pos], fade.b[fade.pos]))
+            return false;
+        fade.a[fade.pos] = fA;
+        fade.b[fade.pos] = fB;
+        fade.pos         = (fade.pos + 1) % nSize;
+        return true;
+    }
+    if (!flush_fade(pPlayer, fade))
+        return false;
+    return ring_write(pPlayer, fA, fB);
+}
+
+// Get quantity of frames of silence required to pad a tempo synced file to a whole quantity of bars
+sf_count_t get_bar_padding(AUDIO_PLAYER* pPlayer) {
+    if (!pPlayer->beats || !g_beats_per_bar)
+        return 0;
+    double dLength = pPlayer->crop_end_src - pPlayer->crop_start_src;
+    double dBar    = dLength * g_beats_per_bar / pPlayer->beats;
+    if (dBar < 1.0)
+        return 0;
+    sf_count_t nPad = llround(ceil(dLength / dBar - 0.001) * dBar - dLength);
+    return nPad > 0 ? nPad : 0;
+}
+
+// Check if file is encoded (compressed) so that seeking may require decoding
+bool is_encoded(SF_INFO& info) {
+    switch (info.format & SF_FORMAT_SUBMASK) {
+    case SF_FORMAT_PCM_S8:
+    case SF_FORMAT_PCM_16:
+    case SF_FORMAT_PCM_24:
+    case SF_FORMAT_PCM_32:
+    case SF_FORMAT_PCM_U8:
+    case SF_FORMAT_FLOAT:
+    case SF_FORMAT_DOUBLE:
+        return false;
+    }
+    return true;
+}
+
+// Get initial seek index position: -1 if not encoded, file length if index not required
+sf_count_t get_seek_index_start(SF_INFO& info) {
+    if (!is_encoded(info))
+        return -1;
+    // Only mpg123 (MPEG) builds a seek index as it decodes. Other decoders seek directly (FLAC seek table, Ogg bisection) so gain nothing from indexing.
+    if ((info.format & SF_FORMAT_TYPEMASK) != SF_FORMAT_MPEG)
+        return info.frames;
+    if (info.frames < (sf_count_t)SEEK_INDEX_MIN_SECONDS * info.samplerate)
+        return info.frames;
+    return 0;
+}
+
+// Seek within file, decoding forward instead of seeking when target is just ahead of read position in encoded file
+sf_count_t seek_file(AUDIO_PLAYER* pPlayer, SNDFILE* pFile, sf_count_t pos, float* pBuffer, size_t nBufferFrames) {
+    if (pPlayer->seek_indexed >= 0 && pos >= pPlayer->file_read_pos && pos - pPlayer->file_read_pos < SEEK_DECODE_SECONDS * pPlayer->sf_info.samplerate &&
+        nBufferFrames) {
+        sf_count_t nSkip = pos - pPlayer->file_read_pos;
+        while (nSkip > 0) {
+            sf_count_t nRead = sf_readf_float(pFile, pBuffer, nSkip < (sf_count_t)nBufferFrames ? nSkip : nBufferFrames);
+            if (nRead <= 0)
+                break;
+            nSkip -= nRead;
+        }
+        if (nSkip == 0)
+            return pos;
+    }
+    return sf_seek(pFile, pos, SEEK_SET);
+}
+
+// Extend decoder seek index by one checkpoint then restore read position - builds index of long encoded files whilst idle
+void index_file(AUDIO_PLAYER* pPlayer, SNDFILE* pFile) {
+    sf_count_t nCheckpoint = pPlayer->seek_indexed + SEEK_CHECKPOINT_SECONDS * pPlayer->sf_info.samplerate;
+    if (nCheckpoint >= pPlayer->sf_info.frames)
+        nCheckpoint = pPlayer->sf_info.frames - 1;
+    if (sf_seek(pFile, nCheckpoint, SEEK_SET) < 0 || nCheckpoint == pPlayer->sf_info.frames - 1) {
+        DPRINTF("libzynaudioplayer seek index of '%s' complete\n", pPlayer->filename.c_str());
+        pPlayer->seek_indexed = pPlayer->sf_info.frames;
+    } else
+        pPlayer->seek_indexed = nCheckpoint;
+    sf_seek(pFile, pPlayer->file_read_pos, SEEK_SET);
+}
+
 void* file_thread_fn(void* param) {
     AUDIO_PLAYER* pPlayer   = (AUDIO_PLAYER*)(param);
     pPlayer->sf_info.format = 0; // This triggers sf_open to populate info structure
@@ -218,88 +577,61 @@ void* file_thread_fn(void* param) {
     size_t nMaxFrames;        // Maximum quantity of frames that may be read from file
     size_t nUnusedFrames = 0; // Quantity of frames in input buffer not used by SRC
 
-    SNDFILE* pFile       = sf_open(pPlayer->filename.c_str(), SFM_READ, &pPlayer->sf_info);
-    if (!pFile || pPlayer->sf_info.channels < 1) {
+    SNDFILE* pFile       = NULL;
+    SNDFILE* pNextFile   = NULL; // Next playlist file, opened in advance of end of current file
+    SF_INFO nextInfo;            // Info of next playlist file
+    string sNextFilename;        // Path of next playlist file
+    fade_buffer fade;            // Frames held back to crossfade with next playlist file
+    sf_count_t nPadFrames = -1;  // Frames of silence remaining to pad to bar boundary (-1 if not yet calculated)
+
+    // Limit quantity of files opened concurrently
+    bool bSlot = acquire_load_slot(pPlayer);
+    if (bSlot) {
+        pFile = sf_open(pPlayer->filename.c_str(), SFM_READ, &pPlayer->sf_info);
+        if (!pFile || pPlayer->sf_info.channels < 1) {
+            pPlayer->file_open = FILE_CLOSED;
+            fprintf(stderr, "libaudioplayer error: failed to open file %s: %s\n", pPlayer->filename.c_str(), sf_strerror(pFile));
+        }
+        if (pPlayer->sf_info.channels < 0) {
+            pPlayer->file_open = FILE_CLOSED;
+            fprintf(stderr, "libaudioplayer error: file %s has no tracks\n", pPlayer->filename.c_str());
+            int nError = sf_close(pFile);
+            if (nError != 0)
+                fprintf(stderr, "libaudioplayer error: failed to close file with error code %d\n", nError);
+        }
+    } else {
         pPlayer->file_open = FILE_CLOSED;
-        fprintf(stderr, "libaudioplayer error: failed to open file %s: %s\n", pPlayer->filename.c_str(), sf_strerror(pFile));
-    }
-    if (pPlayer->sf_info.channels < 0) {
-        pPlayer->file_open = FILE_CLOSED;
-        fprintf(stderr, "libaudioplayer error: file %s has no tracks\n", pPlayer->filename.c_str());
-        int nError = sf_close(pFile);
-        if (nError != 0)
-            fprintf(stderr, "libaudioplayer error: failed to close file with error code %d\n", nError);
     }
 
-    if (pPlayer->file_open) {
-        pPlayer->stretcher = new RubberBandStretcher(g_samplerate, 2,
-                                                     RubberBandStretcher::OptionProcessRealTime | RubberBandStretcher::OptionWindowShort |
-                                                         RubberBandStretcher::OptionPitchHighConsistency | RubberBandStretcher::OptionFormantPreserved);
-        pPlayer->stretcher->setMaxProcessSize(256);
+    if (pPlayer->file_open != FILE_OPENING)
+        load_complete(pPlayer, bSlot);
+    else {
+        alloc_stretcher(pPlayer);
 
         pPlayer->loop_start       = 0;
         pPlayer->loop_end         = pPlayer->sf_info.frames;
         pPlayer->crop_start       = 0;
         pPlayer->crop_end         = pPlayer->sf_info.frames;
         pPlayer->file_read_status = SEEKING;
-        pPlayer->src_ratio        = (float)g_samplerate / pPlayer->sf_info.samplerate;
+        pPlayer->switch_pending   = false;
+        pPlayer->src_ratio        = (double)g_samplerate / pPlayer->sf_info.samplerate;
         if (pPlayer->src_ratio < 0.1)
             pPlayer->src_ratio = 1;
         srcData.src_ratio           = pPlayer->src_ratio;
         pPlayer->pos_notify_delta   = float(pPlayer->sf_info.frames) / g_samplerate / 400;
         pPlayer->output_buffer_size = pPlayer->src_ratio * pPlayer->input_buffer_size;
-        pPlayer->ringbuffer_a       = jack_ringbuffer_create(pPlayer->output_buffer_size * pPlayer->buffer_count * sizeof(float));
-        jack_ringbuffer_mlock(pPlayer->ringbuffer_a);
-        pPlayer->ringbuffer_b = jack_ringbuffer_create(pPlayer->output_buffer_size * pPlayer->buffer_count * sizeof(float));
-        jack_ringbuffer_mlock(pPlayer->ringbuffer_b);
+        alloc_ringbuffers(pPlayer, pPlayer->output_buffer_size * pPlayer->buffer_count * sizeof(float));
         pPlayer->file_open = FILE_OPEN;
 
-        {
-            // Scope to avoid extra memory usage
-            const char* loopModes[] = {"None", "Forward", "Backward", "Alternating"};
-            SF_CUES cues;
-            sf_command(pFile, SFC_GET_CUE, &cues, sizeof(cues));
-            for (uint32_t i = 0; i < cues.cue_count; ++i)
-                add_cue_point(pPlayer, float(cues.cue_points[i].sample_offset) / pPlayer->sf_info.samplerate, cues.cue_points[i].name);
-
-            SF_LOOP_INFO loopInfo;
-            if (sf_command(pFile, SFC_GET_LOOP_INFO, &loopInfo, sizeof(loopInfo)) == SF_TRUE) {
-                fprintf(stderr, "File loop info: Sig:%d/%d, %0.2fBPM, %d beats, Mode: %s, Root key: %d\n", loopInfo.time_sig_num, loopInfo.time_sig_den,
-                        loopInfo.bpm, loopInfo.num_beats, loopModes[loopInfo.loop_mode - 800], loopInfo.root_key);
-                enable_loop(pPlayer, loopInfo.loop_mode == SF_LOOP_FORWARD);
-                set_beats(pPlayer, loopInfo.num_beats);
-            } else {
-                enable_loop(pPlayer, true);
-                set_beats(pPlayer, 0);
-            }
-
-            SF_INSTRUMENT inst;
-            if (sf_command(pFile, SFC_GET_INSTRUMENT, &inst, sizeof(inst)) == SF_TRUE) {
-                fprintf(stderr, "File instrument info: gain: %d, detune:%d, velocity: %d-%d, basenote: %d, detune: %d, keyrange: %d-%d\n", inst.gain,
-                        inst.detune, inst.velocity_lo, inst.velocity_hi, inst.basenote, inst.detune, inst.key_lo, inst.key_hi);
-                pPlayer->gain = pow(10, (float(inst.gain) / 20));
-                for (int i = 0; i < inst.loop_count; ++i) {
-                    fprintf(stderr, "\tLoop %d: mode:%s, start: %d, end:%d, count:%u\n", i, loopModes[inst.loops[i].mode - 800], inst.loops[i].start,
-                            inst.loops[i].end, inst.loops[i].count);
-                }
-                if (inst.basenote >= 0)
-                    pPlayer->base_note = inst.basenote;
-                if (inst.loop_count) {
-                    pPlayer->loop_start     = inst.loops[0].start;
-                    pPlayer->loop_start_src = pPlayer->loop_start * pPlayer->src_ratio;
-                    pPlayer->loop_end       = inst.loops[0].end;
-                    pPlayer->loop_end_src   = pPlayer->loop_end * pPlayer->src_ratio;
-                }
-            } else {
-                pPlayer->gain      = 1.0;
-                pPlayer->base_note = 60;
-            }
-        }
+        read_metadata(pPlayer, pFile, false);
 
         // Initialise samplerate converter
-        float pBufferIn[pPlayer->input_buffer_size * pPlayer->sf_info.channels];   // Buffer used to read sample data from file
-        float pBufferOut[pPlayer->output_buffer_size * pPlayer->sf_info.channels]; // Buffer used to write converted sample data to
-        float pBufferRev[pPlayer->output_buffer_size * pPlayer->sf_info.channels]; // Buffer used to write reverse playback sample data to
+        vector<float> vBufferIn(pPlayer->input_buffer_size * pPlayer->sf_info.channels);   // Buffer used to read sample data from file
+        vector<float> vBufferOut(pPlayer->output_buffer_size * pPlayer->sf_info.channels); // Buffer used to write converted sample data to
+        vector<float> vBufferRev(pPlayer->output_buffer_size * pPlayer->sf_info.channels); // Buffer used to write reverse playback sample data to
+        float* pBufferIn        = vBufferIn.data();
+        float* pBufferOut       = vBufferOut.data();
+        float* pBufferRev       = vBufferRev.data();
         srcData.data_in         = pBufferIn;
         srcData.data_out        = pBufferOut;
         srcData.output_frames   = pPlayer->output_buffer_size;
@@ -308,6 +640,7 @@ void* file_thread_fn(void* param) {
         pPlayer->loop_start_src = pPlayer->loop_start * pPlayer->src_ratio;
         pPlayer->crop_end_src   = pPlayer->crop_end * pPlayer->src_ratio;
         pPlayer->crop_start_src = pPlayer->crop_start * pPlayer->src_ratio;
+        pPlayer->seek_indexed   = get_seek_index_start(pPlayer->sf_info);
         int nError;
         pSrcState = src_new(pPlayer->src_quality, pPlayer->sf_info.channels, &nError);
         if (!pSrcState) {
@@ -316,31 +649,88 @@ void* file_thread_fn(void* param) {
         }
 
         DPRINTF("Opened file '%s' with samplerate %u, duration: %f\n", pPlayer->filename.c_str(), pPlayer->sf_info.samplerate, get_duration(pPlayer));
+        load_complete(pPlayer, bSlot);
 
+        SF_INFO fileInfo = pPlayer->sf_info; // Info of file being read (sf_info changes when playback reaches next playlist file)
         while (pPlayer->file_open == FILE_OPEN) {
+            // Preroll next playlist file so that it is ready to switch at end of current file
+            getMutex();
+            string sNext;
+            if (!pPlayer->playlist.empty())
+                sNext = pPlayer->playlist.front();
+            releaseMutex();
+            if (pNextFile && sNext != sNextFilename) {
+                // Playlist has changed since next file was opened
+                sf_close(pNextFile);
+                pNextFile = NULL;
+                sNextFilename.clear();
+            }
+            if (!pNextFile && !sNext.empty() && pPlayer->loop != 1) {
+                nextInfo.format = 0;
+                pNextFile       = sf_open(sNext.c_str(), SFM_READ, &nextInfo);
+                if (!pNextFile || nextInfo.channels < 1) {
+                    fprintf(stderr, "libaudioplayer error: failed to open playlist file %s: %s\n", sNext.c_str(), sf_strerror(pNextFile));
+                    if (pNextFile)
+                        sf_close(pNextFile);
+                    pNextFile = NULL;
+                    // Remove unplayable file from playlist
+                    getMutex();
+                    if (!pPlayer->playlist.empty() && pPlayer->playlist.front() == sNext)
+                        pPlayer->playlist.erase(pPlayer->playlist.begin());
+                    releaseMutex();
+                } else {
+                    sNextFilename = sNext;
+                    DPRINTF("libzynaudioplayer prerolled next playlist file '%s'\n", sNextFilename.c_str());
+                }
+            }
+            if (!fade.count && !fade.fading) {
+                // Crossfade duration may only change whilst no frames are held
+                size_t nFadeFrames = pPlayer->crossfade * g_samplerate;
+                if (nFadeFrames > pPlayer->output_buffer_size)
+                    nFadeFrames = pPlayer->output_buffer_size;
+                if (nFadeFrames != fade.a.size()) {
+                    fade.a.resize(nFadeFrames);
+                    fade.b.resize(nFadeFrames);
+                    fade.pos = 0;
+                }
+            }
+
             if (pPlayer->file_read_status == SEEKING) {
                 // Main thread has signalled seek within file
                 getMutex();
+                if (pPlayer->switch_pending) {
+                    // Reader has already switched to next playlist file so seek within that file
+                    apply_next_file(pPlayer);
+                    if (pPlayer->play_pos_frames > pPlayer->crop_end_src)
+                        pPlayer->play_pos_frames = pPlayer->crop_start_src;
+                }
                 jack_ringbuffer_reset(pPlayer->ringbuffer_a);
                 jack_ringbuffer_reset(pPlayer->ringbuffer_b);
-                sf_count_t pos = sf_seek(pFile, pPlayer->play_pos_frames / pPlayer->src_ratio, SEEK_SET);
+                sf_count_t pos = seek_file(pPlayer, pFile, pPlayer->play_pos_frames / pPlayer->src_ratio, pBufferRev, vBufferRev.size() / fileInfo.channels);
                 if (pos >= 0)
                     pPlayer->file_read_pos = pos;
                 // DPRINTF("Seeking to %u frames (%fs) src ratio=%f\n", nNewPos, get_position(pPlayer), srcData.src_ratio);
-                pPlayer->file_read_status = LOADING;
-                pPlayer->looped           = false;
+                pPlayer->file_read_status    = LOADING;
+                pPlayer->looped              = false;
+                pPlayer->ring_frames_written = 0;
+                pPlayer->ring_frames_read    = 0;
+                pPlayer->switch_pending      = false;
                 releaseMutex();
                 src_reset(pSrcState);
                 nUnusedFrames        = 0;
                 srcData.end_of_input = 0;
                 pPlayer->stretcher->reset();
+                ++pPlayer->stretcher_serial;
+                fade.count  = 0;
+                fade.fading = false;
+                nPadFrames  = -1;
             } else if (pPlayer->file_read_status == LOOPING) {
                 // Reached loop end point and need to read from loop marker
                 sf_count_t pos;
                 if (pPlayer->varispeed < 0.0)
                     pos = sf_seek(pFile, pPlayer->loop_end, SEEK_SET);
                 else
-                    pos = sf_seek(pFile, pPlayer->loop_start, SEEK_SET);
+                    pos = seek_file(pPlayer, pFile, pPlayer->loop_start, pBufferRev, vBufferRev.size() / fileInfo.channels);
                 getMutex();
                 if (pos >= 0)
                     pPlayer->file_read_pos = pos;
@@ -359,32 +749,43 @@ void* file_thread_fn(void* param) {
                 int nFramesRead = 0;
                 // Load block of data from file to SRC or output buffer
                 nMaxFrames      = pPlayer->input_buffer_size - nUnusedFrames;
+                // Limit block to fit ring buffer, which may be sized for a playlist file with different samplerate
+                size_t nRingFrames = pPlayer->ringbuffer_size / sizeof(float) / 2;
+                if (nMaxFrames * srcData.src_ratio + fade.count > nRingFrames)
+                    nMaxFrames = (nRingFrames - fade.count) / srcData.src_ratio;
+                // Frames held for crossfade may be flushed with this block
+                size_t nSpace = (nMaxFrames * srcData.src_ratio + fade.count) * sizeof(float);
 
-                if (jack_ringbuffer_write_space(pPlayer->ringbuffer_a) >= nMaxFrames * sizeof(float) * pPlayer->src_ratio &&
-                    jack_ringbuffer_write_space(pPlayer->ringbuffer_b) >= nMaxFrames * sizeof(float) * pPlayer->src_ratio) {
+                if (jack_ringbuffer_write_space(pPlayer->ringbuffer_a) >= nSpace && jack_ringbuffer_write_space(pPlayer->ringbuffer_b) >= nSpace) {
 
                     bool bReverse = (pPlayer->varispeed < 0.0);
+                    bool bHold    = pNextFile && !bReverse; // Hold back end of file to crossfade with next playlist file
+                    // Next playlist file is read uncropped and without loop until playback reaches it and applies its metadata
+                    bool bStaged          = pPlayer->switch_pending;
+                    bool bLoop            = pPlayer->loop == 1 && !bStaged;
+                    sf_count_t nCropStart = bStaged ? 0 : pPlayer->crop_start;
+                    sf_count_t nCropEnd   = bStaged ? fileInfo.frames : pPlayer->crop_end;
                     if (bReverse) {
-                        if (pPlayer->loop == 1) {
+                        if (bLoop) {
                             // Limit read to loop range
                             if (pPlayer->file_read_pos <= pPlayer->loop_start)
                                 nMaxFrames = 0;
                             else if (pPlayer->file_read_pos - nMaxFrames < pPlayer->loop_start)
                                 nMaxFrames = pPlayer->file_read_pos - pPlayer->loop_start;
-                        } else if (pPlayer->file_read_pos - nMaxFrames < pPlayer->crop_start) {
+                        } else if (pPlayer->file_read_pos - nMaxFrames < nCropStart) {
                             // Limit read to crop range
-                            nMaxFrames = pPlayer->file_read_pos - pPlayer->crop_start;
+                            nMaxFrames = pPlayer->file_read_pos - nCropStart;
                         }
                     } else {
-                        if (pPlayer->loop == 1) {
+                        if (bLoop) {
                             // Limit read to loop range
                             if (pPlayer->file_read_pos >= pPlayer->loop_end)
                                 nMaxFrames = 0;
                             else if (pPlayer->file_read_pos + nMaxFrames > pPlayer->loop_end)
                                 nMaxFrames = pPlayer->loop_end - pPlayer->file_read_pos;
-                        } else if (pPlayer->file_read_pos + nMaxFrames > pPlayer->crop_end) {
+                        } else if (pPlayer->file_read_pos + nMaxFrames > nCropEnd) {
                             // Limit read to crop range
-                            nMaxFrames = pPlayer->crop_end - pPlayer->file_read_pos;
+                            nMaxFrames = nCropEnd - pPlayer->file_read_pos;
                         }
                     }
 
@@ -405,8 +806,8 @@ void* file_thread_fn(void* param) {
                                 size_t wOffset = 0;
                                 // Reverse audio chunk
                                 for (int i = nFramesRead; i > 0; --i) {
-                                    for (size_t j = 0; j < pPlayer->sf_info.channels; ++j) {
-                                        pBufferOut[wOffset] = pBufferRev[(i - 1) * pPlayer->sf_info.channels + j];
+                                    for (size_t j = 0; j < fileInfo.channels; ++j) {
+                                        pBufferOut[wOffset] = pBufferRev[(i - 1) * fileInfo.channels + j];
                                         ++wOffset;
                                     }
                                 }
@@ -427,15 +828,15 @@ void* file_thread_fn(void* param) {
                                 nFramesRead = sf_readf_float(pFile, pBufferRev, nMaxFrames);
                                 size_t wPos = nUnusedFrames;
                                 for (size_t i = nFramesRead; i == 0; --i) {
-                                    for (size_t j = 0; j < pPlayer->sf_info.channels; ++j) {
-                                        pBufferIn[wPos] = pBufferRev[(i - 1) * pPlayer->sf_info.channels + j];
+                                    for (size_t j = 0; j < fileInfo.channels; ++j) {
+                                        pBufferIn[wPos] = pBufferRev[(i - 1) * fileInfo.channels + j];
                                         ++wPos;
                                     }
                                 }
                                 sf_seek(pFile, pos, SEEK_SET);
                             }
                         } else
-                            pPlayer->file_read_pos += (nFramesRead = sf_readf_float(pFile, pBufferIn + nUnusedFrames * pPlayer->sf_info.channels, nMaxFrames));
+                            pPlayer->file_read_pos += (nFramesRead = sf_readf_float(pFile, pBufferIn + nUnusedFrames * fileInfo.channels, nMaxFrames));
                     }
 
                     getMutex();
@@ -457,8 +858,8 @@ void* file_thread_fn(void* param) {
                                 nUnusedFrames = nFramesRead - srcData.input_frames_used;
                                 nFramesRead   = srcData.output_frames_gen;
                                 // Shift unused samples to start of buffer
-                                memcpy(pBufferIn, pBufferIn + srcData.input_frames_used * sizeof(float) * pPlayer->sf_info.channels,
-                                       nUnusedFrames * sizeof(float) * pPlayer->sf_info.channels);
+                                memcpy(pBufferIn, pBufferIn + srcData.input_frames_used * sizeof(float) * fileInfo.channels,
+                                       nUnusedFrames * sizeof(float) * fileInfo.channels);
                             }
                         } else {
                             // DPRINTF("No SRC, read %u frames\n", nFramesRead);
@@ -466,20 +867,20 @@ void* file_thread_fn(void* param) {
                         // Demux samples and populate playback ring buffers
                         for (size_t frame = 0; frame < nFramesRead; ++frame) {
                             float fA = 0.0, fB = 0.0;
-                            size_t sample = frame * pPlayer->sf_info.channels;
-                            if (pPlayer->sf_info.channels > 1) {
+                            size_t sample = frame * fileInfo.channels;
+                            if (fileInfo.channels > 1) {
                                 if (pPlayer->track_a < 0) {
                                     // Send sum of odd channels to A
-                                    for (int track = 0; track < pPlayer->sf_info.channels; track += 2)
-                                        fA += pBufferOut[sample + track] / (pPlayer->sf_info.channels / 2);
+                                    for (int track = 0; track < fileInfo.channels; track += 2)
+                                        fA += pBufferOut[sample + track] / (fileInfo.channels / 2);
                                 } else {
                                     // Send pPlayer->track to A
                                     fA = pBufferOut[sample + pPlayer->track_a];
                                 }
                                 if (pPlayer->track_b < 0) {
                                     // Send sum of odd channels to B
-                                    for (int track = 0; track + 1 < pPlayer->sf_info.channels; track += 2)
-                                        fB += pBufferOut[sample + track + 1] / (pPlayer->sf_info.channels / 2);
+                                    for (int track = 0; track + 1 < fileInfo.channels; track += 2)
+                                        fB += pBufferOut[sample + track + 1] / (fileInfo.channels / 2);
                                 } else {
                                     // Send pPlayer->track to B
                                     fB = pBufferOut[sample + pPlayer->track_b];
@@ -489,19 +890,122 @@ void* file_thread_fn(void* param) {
                                 fA = pBufferOut[sample] / 2;
                                 fB = pBufferOut[sample] / 2;
                             }
-                            int nWrote = jack_ringbuffer_write(pPlayer->ringbuffer_b, (const char*)(&fB), sizeof(float));
-                            if (sizeof(float) < jack_ringbuffer_write(pPlayer->ringbuffer_a, (const char*)(&fA), nWrote)) {
+                            if (!write_frame(pPlayer, fade, fA, fB, bHold)) {
                                 // Shouldn't underun due to previous wait for space but just in case...
                                 fprintf(stderr, "libZynAudioPlayer Underrun during writing to ringbuffer - this should never happen!!!\n");
                                 break;
                             }
                         }
-                    } else if (pPlayer->loop == 1) {
+                    } else if (bLoop) {
                         // Short read - looping so fill from loop start point in file
                         pPlayer->file_read_status = LOOPING;
                         // srcData.end_of_input = 1;
                         releaseMutex();
                         DPRINTF("libzynaudioplayer read to loop point in input file - setting loading status to looping\n");
+                    } else if (bHold && bStaged) {
+                        // End of file but playback has not yet reached it so wait for its metadata to be applied before staging next file
+                        pPlayer->file_read_status = WAITING;
+                        releaseMutex();
+                    } else if (bHold) {
+                        // End of file with next playlist file ready
+                        releaseMutex();
+                        if (nPadFrames < 0)
+                            nPadFrames = get_bar_padding(pPlayer);
+                        while (nPadFrames > 0 && write_frame(pPlayer, fade, 0.0, 0.0, true))
+                            --nPadFrames;
+                        if (nPadFrames > 0) {
+                            // Wait for space to pad to bar boundary
+                            pPlayer->file_read_status = WAITING;
+                            continue;
+                        }
+                        nPadFrames = -1;
+
+                        getMutex();
+                        bool bValid = !pPlayer->playlist.empty() && pPlayer->playlist.front() == sNextFilename;
+                        if (bValid)
+                            pPlayer->playlist.erase(pPlayer->playlist.begin());
+                        releaseMutex();
+                        if (!bValid) {
+                            // Playlist changed since next file was opened so reassess at next cycle
+                            sf_close(pNextFile);
+                            pNextFile = NULL;
+                            sNextFilename.clear();
+                            pPlayer->file_read_status = WAITING;
+                            continue;
+                        }
+
+                        // Switch to next playlist file
+                        double fSrcRatio = (double)g_samplerate / nextInfo.samplerate;
+                        if (fSrcRatio < 0.1)
+                            fSrcRatio = 1;
+                        if (pSrcState)
+                            pSrcState = src_delete(pSrcState);
+                        pSrcState = src_new(pPlayer->src_quality, nextInfo.channels, &nError);
+                        if (!pSrcState) {
+                            fprintf(stderr, "Failed to create a samplerate converter: %d\n", nError);
+                            sf_close(pNextFile);
+                            pNextFile                 = NULL;
+                            pPlayer->file_read_status = IDLE;
+                            pPlayer->file_open        = FILE_CLOSED;
+                            break;
+                        }
+                        nError = sf_close(pFile);
+                        if (nError != 0)
+                            fprintf(stderr, "libaudioplayer error: failed to close file with error code %d\n", nError);
+                        pFile     = pNextFile;
+                        pNextFile = NULL;
+
+                        unsigned int nOutputSize = fSrcRatio * pPlayer->input_buffer_size;
+                        vBufferIn.resize(pPlayer->input_buffer_size * nextInfo.channels);
+                        vBufferOut.resize(nOutputSize * nextInfo.channels);
+                        vBufferRev.resize(nOutputSize * nextInfo.channels);
+                        pBufferIn             = vBufferIn.data();
+                        pBufferOut            = vBufferOut.data();
+                        pBufferRev            = vBufferRev.data();
+                        srcData.data_in       = pBufferIn;
+                        srcData.data_out      = pBufferOut;
+                        srcData.output_frames = nOutputSize;
+                        srcData.src_ratio     = fSrcRatio;
+                        srcData.end_of_input  = 0;
+                        nUnusedFrames         = 0;
+
+                        // Reader state changes now but metadata is staged until playback reaches next file
+                        fileInfo = nextInfo;
+                        getMutex();
+                        pPlayer->next_info          = nextInfo;
+                        pPlayer->next_filename      = sNextFilename;
+                        pPlayer->next_src_ratio     = fSrcRatio;
+                        pPlayer->next_frames        = nextInfo.frames;
+                        pPlayer->output_buffer_size = nOutputSize;
+                        pPlayer->file_read_pos      = 0;
+                        pPlayer->seek_indexed       = get_seek_index_start(nextInfo);
+                        if (pPlayer->track_a >= nextInfo.channels)
+                            pPlayer->track_a = -1;
+                        if (pPlayer->track_b >= nextInfo.channels)
+                            pPlayer->track_b = -1;
+                        releaseMutex();
+                        read_metadata(pPlayer, pFile, true);
+
+                        if (fade.count) {
+                            fade.fading = true;
+                            fade.mixed  = 0;
+                            fade.length = fade.count;
+                        }
+                        getMutex();
+                        // Time ratio of next file is applied when playback reaches it
+                        pPlayer->switch_time_ratio = 1.0;
+                        if (pPlayer->next_beats && pPlayer->next_frames > 0)
+                            pPlayer->switch_time_ratio = g_samplerate * pPlayer->next_beats / (g_tempo * pPlayer->next_frames * fSrcRatio);
+                        pPlayer->switch_pos     = pPlayer->ring_frames_written;
+                        pPlayer->switch_pending = true;
+                        releaseMutex();
+                        pPlayer->file_read_status = WAITING; // Preroll following playlist file before reading this file
+                        DPRINTF("libzynaudioplayer switched reader to next playlist file '%s'\n", sNextFilename.c_str());
+                        sNextFilename.clear();
+                    } else if (fade.count && !flush_fade(pPlayer, fade)) {
+                        // End of file with frames held for crossfade but insufficient space to flush them
+                        pPlayer->file_read_status = WAITING;
+                        releaseMutex();
                     } else {
                         // End of file
                         pPlayer->file_read_status = IDLE;
@@ -513,12 +1017,17 @@ void* file_thread_fn(void* param) {
                     pPlayer->file_read_status = WAITING;
                 }
             }
+            if (pPlayer->seek_indexed >= 0 && pPlayer->seek_indexed < fileInfo.frames && pPlayer->play_state == STOPPED && !pPlayer->switch_pending &&
+                (pPlayer->file_read_status == IDLE || pPlayer->file_read_status == WAITING))
+                index_file(pPlayer, pFile);
             // if(pPlayer->file_read_status != LOOPING) {
             send_notifications(pPlayer, NOTIFY_ALL);
             usleep(10000); // Reduce CPU load by waiting until next file read operation
             //}
         }
     }
+    if (pNextFile)
+        sf_close(pNextFile);
     if (pFile) {
         int nError = sf_close(pFile);
         if (nError != 0)
@@ -538,35 +1047,84 @@ void* file_thread_fn(void* param) {
 /**** player instance functions take 'handle' param to identify player instance****/
 
 uint8_t load(AUDIO_PLAYER* pPlayer, const char* filename, cb_fn_t cb_fn) {
+    if (!load_async(pPlayer, filename, nullptr))
+        return 0;
+    pthread_mutex_lock(&g_load_mutex);
+    while (pPlayer->loading)
+        pthread_cond_wait(&g_load_cond, &g_load_mutex);
+    pthread_mutex_unlock(&g_load_mutex);
+
+    if (pPlayer->file_open) {
+        pPlayer->cb_fn = cb_fn;
+    }
+    return (pPlayer->file_open == FILE_OPEN);
+}
+
+uint8_t load_async(AUDIO_PLAYER* pPlayer, const char* filename, cb_fn_t cb_fn) {
+    if (!pPlayer)
+        return 0;
     unload(pPlayer);
-    pPlayer->cb_fn;
+    pPlayer->cb_fn     = cb_fn;
     pPlayer->track_a   = 0;
     pPlayer->track_b   = 0;
     pPlayer->filename  = filename;
 
     pPlayer->file_open = FILE_OPENING;
+    pPlayer->loading   = true;
     if (pthread_create(&(pPlayer->file_thread), 0, file_thread_fn, pPlayer)) {
         fprintf(stderr, "libzynaudioplayer error: failed to create file reading thread\n");
-        unload(pPlayer);
+        pPlayer->loading     = false;
+        pPlayer->file_open   = FILE_CLOSED;
+        pPlayer->file_thread = 0;
+        pPlayer->cb_fn       = nullptr;
         return 0;
     }
-    while (pPlayer->file_open == FILE_OPENING) {
-        usleep(10000); //!@todo Optimise wait for file open
-    }
+    return 1;
+}
 
-    if (pPlayer->file_open) {
-        pPlayer->cb_fn = cb_fn;
+uint8_t is_loading(AUDIO_PLAYER* pPlayer) {
+    if (!pPlayer)
+        return 0;
+    return pPlayer->loading;
+}
+
+int get_load_fd() { return g_load_fd; }
+
+AUDIO_PLAYER* get_load_result(uint8_t* result) {
+    AUDIO_PLAYER* pPlayer = nullptr;
+    pthread_mutex_lock(&g_load_mutex);
+    if (!g_vLoadResults.empty()) {
+        pPlayer = g_vLoadResults.front().first;
+        if (result)
+            *result = g_vLoadResults.front().second;
+        g_vLoadResults.erase(g_vLoadResults.begin());
     }
-    return (pPlayer->file_open == FILE_OPEN);
+    pthread_mutex_unlock(&g_load_mutex);
+    return pPlayer;
 }
 
+void set_max_parallel_loads(unsigned int count) {
+    if (count < 1)
+        count = 1;
+    pthread_mutex_lock(&g_load_mutex);
+    g_max_loads = count;
+    pthread_cond_broadcast(&g_load_cond);
+    pthread_mutex_unlock(&g_load_mutex);
+}
+
+unsigned int get_max_parallel_loads() { return g_max_loads; }
+
 void unload(AUDIO_PLAYER* pPlayer) {
     if (!pPlayer || !pPlayer->file_thread)
         return;
     stop_playback(pPlayer);
+    pthread_mutex_lock(&g_load_mutex);
     pPlayer->file_open = FILE_CLOSED;
+    pthread_cond_broadcast(&g_load_cond); // Wake file thread if waiting for a load slot
+    pthread_mutex_unlock(&g_load_mutex);
     pPlayer->cue_points.clear();
     pthread_join(pPlayer->file_thread, NULL);
+    pPlayer->file_thread = 0;
 }
 
 uint8_t save(AUDIO_PLAYER* pPlayer, const char* filename) {
@@ -654,8 +1212,8 @@ uint8_t save(AUDIO_PLAYER* pPlayer, const char* filename) {
     sf_command(outfile, SFC_SET_INSTRUMENT, &inst, sizeof(inst));
 
     float buffer[1024 * sfinfo.channels];
-    sf_count_t pos    = sf_seek(infile, pPlayer->crop_start, SEEK_SET);
-    uint32_t duration = pPlayer->crop_end - pPlayer->crop_start;
+    sf_count_t pos      = sf_seek(infile, pPlayer->crop_start, SEEK_SET);
+    sf_count_t duration = pPlayer->crop_end - pPlayer->crop_start;
     while (duration) {
         uint32_t frames = sf_readf_float(infile, buffer, 1024);
         if (duration > frames) {
@@ -681,14 +1239,12 @@ const char* get_filename(AUDIO_PLAYER* pPlayer) {
 
 float get_duration(AUDIO_PLAYER* pPlayer) {
     if (pPlayer && pPlayer->file_open == FILE_OPEN && pPlayer->sf_info.samplerate)
-        return (float)pPlayer->sf_info.frames / pPlayer->sf_info.samplerate / pPlayer->speed;
+        return (double)pPlayer->sf_info.frames / pPlayer->sf_info.samplerate / pPlayer->speed;
     return 0.0f;
 }
 
-void set_position(AUDIO_PLAYER* pPlayer, float time) {
-    if (!pPlayer || pPlayer->file_open != FILE_OPEN)
-        return;
-    sf_count_t frames = time * g_samplerate * pPlayer->speed;
+// Set playback position (frames at play samplerate) and signal file reader to seek
+void set_play_pos(AUDIO_PLAYER* pPlayer, sf_count_t frames) {
     if (frames > pPlayer->crop_end_src)
         frames = pPlayer->crop_end_src;
     else if (frames < pPlayer->crop_start_src)
@@ -701,12 +1257,30 @@ void set_position(AUDIO_PLAYER* pPlayer, float time) {
     send_notifications(pPlayer, NOTIFY_POSITION);
 }
 
+void set_position(AUDIO_PLAYER* pPlayer, float time) {
+    if (!pPlayer || pPlayer->file_open != FILE_OPEN)
+        return;
+    set_play_pos(pPlayer, (double)time * g_samplerate * pPlayer->speed);
+}
+
 float get_position(AUDIO_PLAYER* pPlayer) {
     if (pPlayer && pPlayer->file_open == FILE_OPEN)
-        return (float)(pPlayer->play_pos_frames) / g_samplerate / pPlayer->speed;
+        return (double)(pPlayer->play_pos_frames) / g_samplerate / pPlayer->speed;
     return 0.0;
 }
 
+void set_position_frames(AUDIO_PLAYER* pPlayer, int64_t frames) {
+    if (!pPlayer || pPlayer->file_open != FILE_OPEN)
+        return;
+    set_play_pos(pPlayer, llround(frames * pPlayer->src_ratio));
+}
+
+int64_t get_position_frames(AUDIO_PLAYER* pPlayer) {
+    if (!pPlayer || pPlayer->file_open != FILE_OPEN)
+        return 0;
+    return llround(pPlayer->play_pos_frames / pPlayer->src_ratio);
+}
+
 void enable_loop(AUDIO_PLAYER* pPlayer, uint8_t nLoop) {
     if (!pPlayer)
         return;
@@ -722,7 +1296,12 @@ void enable_loop(AUDIO_PLAYER* pPlayer, uint8_t nLoop) {
 void set_loop_start_time(AUDIO_PLAYER* pPlayer, float time) {
     if (!pPlayer)
         return;
-    jack_nframes_t frames = pPlayer->sf_info.samplerate * time;
+    set_loop_start_frames(pPlayer, llround((double)pPlayer->sf_info.samplerate * time));
+}
+
+void set_loop_start_frames(AUDIO_PLAYER* pPlayer, int64_t frames) {
+    if (!pPlayer)
+        return;
     if (frames >= pPlayer->loop_end)
         frames = pPlayer->loop_end - 1;
     if (frames < pPlayer->crop_start)
@@ -740,13 +1319,24 @@ void set_loop_start_time(AUDIO_PLAYER* pPlayer, float time) {
 float get_loop_start_time(AUDIO_PLAYER* pPlayer) {
     if (!pPlayer || pPlayer->sf_info.samplerate == 0)
         return 0.0;
-    return (float)(pPlayer->loop_start) / pPlayer->sf_info.samplerate;
+    return (double)(pPlayer->loop_start) / pPlayer->sf_info.samplerate;
+}
+
+int64_t get_loop_start_frames(AUDIO_PLAYER* pPlayer) {
+    if (!pPlayer)
+        return 0;
+    return pPlayer->loop_start;
 }
 
 void set_loop_end_time(AUDIO_PLAYER* pPlayer, float time) {
     if (!pPlayer)
         return;
-    jack_nframes_t frames = pPlayer->sf_info.samplerate * time;
+    set_loop_end_frames(pPlayer, llround((double)pPlayer->sf_info.samplerate * time));
+}
+
+void set_loop_end_frames(AUDIO_PLAYER* pPlayer, int64_t frames) {
+    if (!pPlayer)
+        return;
     if (frames <= pPlayer->loop_start)
         frames = pPlayer->loop_start + 1;
     if (frames > pPlayer->crop_end)
@@ -764,7 +1354,13 @@ void set_loop_end_time(AUDIO_PLAYER* pPlayer, float time) {
 float get_loop_end_time(AUDIO_PLAYER* pPlayer) {
     if (!pPlayer || pPlayer->sf_info.samplerate == 0)
         return 0.0;
-    return (float)(pPlayer->loop_end) / pPlayer->sf_info.samplerate;
+    return (double)(pPlayer->loop_end) / pPlayer->sf_info.samplerate;
+}
+
+int64_t get_loop_end_frames(AUDIO_PLAYER* pPlayer) {
+    if (!pPlayer)
+        return 0;
+    return pPlayer->loop_end;
 }
 
 uint8_t is_loop(AUDIO_PLAYER* pPlayer) {
@@ -776,21 +1372,26 @@ uint8_t is_loop(AUDIO_PLAYER* pPlayer) {
 void set_crop_start_time(AUDIO_PLAYER* pPlayer, float time) {
     if (!pPlayer)
         return;
-    if (time < 0.0)
-        time = 0.0;
-    jack_nframes_t frames = pPlayer->sf_info.samplerate * time;
+    set_crop_start_frames(pPlayer, llround((double)pPlayer->sf_info.samplerate * time));
+}
+
+void set_crop_start_frames(AUDIO_PLAYER* pPlayer, int64_t frames) {
+    if (!pPlayer)
+        return;
+    if (frames < 0)
+        frames = 0;
     if (frames >= pPlayer->crop_end)
         frames = pPlayer->crop_end - 1;
     if (frames > pPlayer->loop_end)
-        set_loop_end_time(pPlayer, time);
+        set_loop_end_frames(pPlayer, frames);
     if (frames > pPlayer->loop_start)
-        set_loop_start_time(pPlayer, time);
+        set_loop_start_frames(pPlayer, frames);
     getMutex();
     pPlayer->crop_start     = frames;
     pPlayer->crop_start_src = pPlayer->crop_start * pPlayer->src_ratio;
     releaseMutex();
-    if (pPlayer->play_pos_frames < frames)
-        set_position(pPlayer, time);
+    if (pPlayer->play_pos_frames < pPlayer->crop_start_src)
+        set_position_frames(pPlayer, frames);
     pPlayer->last_crop_start = -1;
     updateTempo(pPlayer);
     send_notifications(pPlayer, NOTIFY_CROP_START);
@@ -799,21 +1400,32 @@ void set_crop_start_time(AUDIO_PLAYER* pPlayer, float time) {
 float get_crop_start_time(AUDIO_PLAYER* pPlayer) {
     if (!pPlayer || pPlayer->sf_info.samplerate == 0)
         return 0.0;
-    return (float)(pPlayer->crop_start) / pPlayer->sf_info.samplerate;
+    return (double)(pPlayer->crop_start) / pPlayer->sf_info.samplerate;
+}
+
+int64_t get_crop_start_frames(AUDIO_PLAYER* pPlayer) {
+    if (!pPlayer)
+        return 0;
+    return pPlayer->crop_start;
 }
 
 void set_crop_end_time(AUDIO_PLAYER* pPlayer, float time) {
     if (!pPlayer)
         return;
-    jack_nframes_t frames = pPlayer->sf_info.samplerate * time;
+    set_crop_end_frames(pPlayer, llround((double)pPlayer->sf_info.samplerate * time));
+}
+
+void set_crop_end_frames(AUDIO_PLAYER* pPlayer, int64_t frames) {
+    if (!pPlayer)
+        return;
     if (frames < pPlayer->crop_start)
         frames = pPlayer->crop_start + 1;
     if (frames > pPlayer->sf_info.frames)
         frames = pPlayer->sf_info.frames;
     if (frames < pPlayer->loop_end)
-        set_loop_end_time(pPlayer, time);
+        set_loop_end_frames(pPlayer, frames);
     if (frames < pPlayer->loop_start)
-        set_loop_start_time(pPlayer, time);
+        set_loop_start_frames(pPlayer, frames);
     getMutex();
     pPlayer->crop_end     = frames;
     pPlayer->crop_end_src = frames * pPlayer->src_ratio;
@@ -835,15 +1447,23 @@ void set_crop_end_time(AUDIO_PLAYER* pPlayer, float time) {
 float get_crop_end_time(AUDIO_PLAYER* pPlayer) {
     if (!pPlayer || pPlayer->sf_info.samplerate == 0)
         return 0.0;
-    return (float)(pPlayer->crop_end) / pPlayer->sf_info.samplerate;
+    return (double)(pPlayer->crop_end) / pPlayer->sf_info.samplerate;
+}
+
+int64_t get_crop_end_frames(AUDIO_PLAYER* pPlayer) {
+    if (!pPlayer)
+        return 0;
+    return pPlayer->crop_end;
 }
 
 int32_t add_cue_point(AUDIO_PLAYER* pPlayer, float position, const char* name) {
     if (!pPlayer || position < 0.0)
         return -1;
+    return add_cue_point_frames(pPlayer, llround((double)position * pPlayer->sf_info.samplerate), name);
+}
 
-    uint32_t frames = position * pPlayer->sf_info.samplerate;
-    if (frames >= pPlayer->sf_info.frames)
+int32_t add_cue_point_frames(AUDIO_PLAYER* pPlayer, int64_t frames, const char* name) {
+    if (!pPlayer || frames < 0 || frames >= pPlayer->sf_info.frames)
         return -1;
     for (size_t i = 0; i < pPlayer->cue_points.size(); ++i) {
         if (pPlayer->cue_points[i].offset == frames)
@@ -860,12 +1480,12 @@ int32_t add_cue_point(AUDIO_PLAYER* pPlayer, float position, const char* name) {
 int32_t remove_cue_point(AUDIO_PLAYER* pPlayer, float position) {
     if (!pPlayer || position < 0.0)
         return -1;
-    int32_t minOffset    = 0.5 * pPlayer->sf_info.samplerate;
-    int32_t markerOffset = minOffset;
-    int32_t frames       = position * pPlayer->sf_info.samplerate;
-    int32_t result       = -1;
+    sf_count_t minOffset    = 0.5 * pPlayer->sf_info.samplerate;
+    sf_count_t markerOffset = minOffset;
+    sf_count_t frames       = (double)position * pPlayer->sf_info.samplerate;
+    int32_t result          = -1;
     for (int32_t i = 0; i < pPlayer->cue_points.size(); ++i) {
-        int32_t dT = abs(int32_t(pPlayer->cue_points[i].offset) - frames);
+        sf_count_t dT = llabs(pPlayer->cue_points[i].offset - frames);
         if (dT < markerOffset) {
             result       = i;
             markerOffset = dT;
@@ -887,14 +1507,23 @@ uint32_t get_cue_point_count(AUDIO_PLAYER* pPlayer) {
 float get_cue_point_position(AUDIO_PLAYER* pPlayer, uint32_t index) {
     if (!pPlayer || index >= pPlayer->cue_points.size() || pPlayer->sf_info.samplerate < 1000)
         return -1.0;
-    return float(pPlayer->cue_points[index].offset) / pPlayer->sf_info.samplerate;
+    return double(pPlayer->cue_points[index].offset) / pPlayer->sf_info.samplerate;
+}
+
+int64_t get_cue_point_frames(AUDIO_PLAYER* pPlayer, uint32_t index) {
+    if (!pPlayer || index >= pPlayer->cue_points.size())
+        return -1;
+    return pPlayer->cue_points[index].offset;
 }
 
 bool set_cue_point_position(AUDIO_PLAYER* pPlayer, uint32_t index, float position) {
-    if (!pPlayer || index >= pPlayer->cue_points.size() || position < 0.0)
+    if (!pPlayer || position < 0.0)
         return false;
-    uint32_t frames = position * pPlayer->sf_info.samplerate;
-    if (frames >= pPlayer->sf_info.frames)
+    return set_cue_point_frames(pPlayer, index, llround((double)position * pPlayer->sf_info.samplerate));
+}
+
+bool set_cue_point_frames(AUDIO_PLAYER* pPlayer, uint32_t index, int64_t frames) {
+    if (!pPlayer || index >= pPlayer->cue_points.size() || frames < 0 || frames >= pPlayer->sf_info.frames)
         return false;
     pPlayer->cue_points[index].offset = frames;
     return true;
@@ -933,6 +1562,7 @@ void stop_playback(AUDIO_PLAYER* pPlayer) {
     if (pPlayer && pPlayer->play_state != STOPPED) {
         pPlayer->play_state     = STOPPING;
         pPlayer->play_varispeed = pPlayer->varispeed;
+        pPlayer->varispeed_ride = false;
     }
     // send_notifications(pPlayer, NOTIFY_TRANSPORT);
 }
@@ -970,7 +1600,7 @@ int get_channels(AUDIO_PLAYER* pPlayer) {
     return pPlayer->sf_info.channels;
 }
 
-int get_frames(AUDIO_PLAYER* pPlayer) {
+int64_t get_frames(AUDIO_PLAYER* pPlayer) {
     if (!pPlayer || pPlayer->file_open != FILE_OPEN)
         return 0;
     return pPlayer->sf_info.frames;
@@ -1150,7 +1780,7 @@ inline float process_env(AUDIO_PLAYER* pPlayer) {
 }
 
 inline void set_env_gate(AUDIO_PLAYER* pPlayer, uint8_t gate) {
-    DPRINTF("set_env_gate: was: %d req: %d current env phase: %d\n", pPlayer->env_gate, gate, pPlayer->env_state);
+    RTLOG("set_env_gate: was: %d req: %d current env phase: %d\n", pPlayer->env_gate, gate, pPlayer->env_state);
     if (gate) {
         pPlayer->env_state = ENV_ATTACK;
         // fprintf(stderr, "Envelope: ATTACK\n");
@@ -1166,16 +1796,265 @@ inline void reset_env(AUDIO_PLAYER* pPlayer) {
     pPlayer->env_level = 0.0;
 }
 
+// Get smoothing coefficient for a quantity of frames
+inline float cc_smooth_coef(AUDIO_PLAYER* pPlayer, jack_nframes_t frames) {
+    if (pPlayer->cc_smooth_time <= 0.0)
+        return 1.0;
+    return 1.0 - exp(-(float)frames / (pPlayer->cc_smooth_time * g_samplerate));
+}
+
+// Set varispeed from within jack process (mutex already held)
+inline void apply_varispeed(AUDIO_PLAYER* pPlayer, float ratio) {
+    bool stop  = ((pPlayer->varispeed >= 0.1 && ratio < 0.1) || (pPlayer->varispeed <= -0.1 && ratio > -0.1));
+    bool start = (pPlayer->play_state != PLAYING && fabs(pPlayer->varispeed) < 0.1 && fabs(ratio) >= 0.1);
+    if ((ratio < 0.0) != (pPlayer->varispeed < 0.0))
+        pPlayer->file_read_status = SEEKING; // File reader must reload in new direction
+    pPlayer->varispeed        = ratio;
+    pPlayer->time_ratio_dirty = true;
+    if (stop && pPlayer->play_state != STOPPED)
+        pPlayer->play_state = STOPPING;
+    if (start && pPlayer->play_state != PLAYING)
+        pPlayer->play_state = STARTING;
+}
+
+// Handle mapped MIDI CC from within jack process (mutex already held) - returns true if CC is mapped
+bool process_cc(AUDIO_PLAYER* pPlayer, uint8_t cc, uint8_t value, jack_nframes_t offset) {
+    uint8_t param;
+    uint16_t raw;          // Control value
+    uint16_t maxRaw = 127; // Maximum control value
+    if (cc >= 32 && cc < 64 && (pPlayer->cc_flags[cc - 32] & PLAYER_CC_14BIT)) {
+        // LSB of 14-bit CC
+        param  = pPlayer->cc_map[cc - 32];
+        raw    = (pPlayer->cc_msb[cc - 32] << 7) | value;
+        maxRaw = 16383;
+    } else {
+        param = pPlayer->cc_map[cc];
+        raw   = value;
+        if (cc < 32 && (pPlayer->cc_flags[cc] & PLAYER_CC_14BIT)) {
+            // MSB of 14-bit CC is applied coarsely until LSB received
+            pPlayer->cc_msb[cc] = value;
+            raw                 = value << 7;
+            maxRaw              = 16383;
+        }
+    }
+    if (param == PLAYER_PARAM_NONE)
+        return false;
+
+    float unipolar = (float)raw / maxRaw;
+    float bipolar  = ((float)raw - (maxRaw + 1) / 2) / ((maxRaw - 1) / 2); // Centre value is zero
+    if (bipolar < -1.0)
+        bipolar = -1.0;
+    sf_count_t frames;
+    switch (param) {
+    case PLAYER_PARAM_GAIN:
+        // Gain is applied (smoothed) from the event's frame offset
+        pPlayer->cc_gain = unipolar * 2.0;
+        if (pPlayer->cc_gain < 0.00001)
+            pPlayer->cc_gain = 0.00001;
+        if (pPlayer->cc_gain_offset == UINT32_MAX)
+            pPlayer->cc_gain_offset = offset;
+        break;
+    case PLAYER_PARAM_VARISPEED:
+        // Varispeed is smoothed at start of each period
+        pPlayer->varispeed_target = bipolar * 2.0;
+        pPlayer->varispeed_ride   = true;
+        break;
+    case PLAYER_PARAM_POSITION:
+        pPlayer->play_pos_frames  = pPlayer->crop_start_src + unipolar * (pPlayer->crop_end_src - pPlayer->crop_start_src);
+        pPlayer->file_read_status = SEEKING;
+        break;
+    case PLAYER_PARAM_JOG:
+        frames = pPlayer->play_pos_frames + (value < 64 ? value : value - 128) * CC_JOG_STEP * g_samplerate * pPlayer->speed;
+        if (frames > pPlayer->crop_end_src)
+            frames = pPlayer->crop_end_src;
+        else if (frames < pPlayer->crop_start_src)
+            frames = pPlayer->crop_start_src;
+        pPlayer->play_pos_frames  = frames;
+        pPlayer->file_read_status = SEEKING;
+        break;
+    case PLAYER_PARAM_LOOP_START:
+        frames = pPlayer->crop_start + unipolar * (pPlayer->crop_end - pPlayer->crop_start);
+        if (frames >= pPlayer->loop_end)
+            frames = pPlayer->loop_end - 1;
+        if (frames < pPlayer->crop_start)
+            frames = pPlayer->crop_start;
+        pPlayer->loop_start     = frames;
+        pPlayer->loop_start_src = pPlayer->loop_start * pPlayer->src_ratio;
+        if (pPlayer->loop == 1 && pPlayer->looped)
+            pPlayer->file_read_status = SEEKING;
+        break;
+    case PLAYER_PARAM_LOOP_END:
+        frames = pPlayer->crop_start + unipolar * (pPlayer->crop_end - pPlayer->crop_start);
+        if (frames <= pPlayer->loop_start)
+            frames = pPlayer->loop_start + 1;
+        if (frames > pPlayer->crop_end)
+            frames = pPlayer->crop_end;
+        pPlayer->loop_end     = frames;
+        pPlayer->loop_end_src = pPlayer->loop_end * pPlayer->src_ratio;
+        if (pPlayer->loop == 1 && pPlayer->looped)
+            pPlayer->file_read_status = SEEKING;
+        break;
+    }
+    return true;
+}
+
+// Switch stretch quality tier from within jack process (mutex already held)
+inline void apply_stretch_tier(AUDIO_PLAYER* pPlayer, uint8_t tier) {
+    if (tier == STRETCH_TIER_RESAMPLE) {
+        pPlayer->rs_frac   = 1.0;
+        pPlayer->rs_prev_a = pPlayer->rs_prev_b = pPlayer->rs_cur_a = pPlayer->rs_cur_b = 0.0;
+    } else {
+        set_stretch_options(pPlayer, tier);
+        if (pPlayer->stretch_tier == STRETCH_TIER_RESAMPLE) {
+            // Stretcher has not processed recent audio
+            pPlayer->stretcher->reset();
+            pPlayer->time_ratio_dirty = true;
+        }
+    }
+    pPlayer->stretch_tier = tier;
+}
+
+// Get sample at offset from a ring buffer read vector
+inline float ring_peek(jack_ringbuffer_data_t* vec, size_t offset) {
+    size_t count = vec[0].len / sizeof(float);
+    if (offset < count)
+        return ((float*)vec[0].buf)[offset];
+    return ((float*)vec[1].buf)[offset - count];
+}
+
+// Populate output buffers by linear interpolation of ring buffers, bypassing stretcher - returns quantity of frames populated
+size_t resample(AUDIO_PLAYER* pPlayer, float* pOutA, float* pOutB, jack_nframes_t nFrames, size_t& r_count) {
+    double step  = fabs(pPlayer->varispeed) * pPlayer->speed * pPlayer->pitch * pPlayer->pitchshift / pPlayer->time_ratio;
+    size_t avail = min(ioRingReadSpace(pPlayer->ringbuffer_a, IO_RING(pPlayer->index, 0)), ioRingReadSpace(pPlayer->ringbuffer_b, IO_RING(pPlayer->index, 1))) /
+                   sizeof(float);
+    jack_ringbuffer_data_t vecA[2], vecB[2];
+    ioRingGetReadVector(pPlayer->ringbuffer_a, IO_RING(pPlayer->index, 0), vecA);
+    ioRingGetReadVector(pPlayer->ringbuffer_b, IO_RING(pPlayer->index, 1), vecB);
+    size_t used   = 0; // Quantity of frames consumed from ring buffers
+    size_t offset = 0;
+    for (; offset < nFrames; ++offset) {
+        while (pPlayer->rs_frac >= 1.0 && used < avail) {
+            pPlayer->rs_prev_a = pPlayer->rs_cur_a;
+            pPlayer->rs_prev_b = pPlayer->rs_cur_b;
+            pPlayer->rs_cur_a  = ring_peek(vecA, used);
+            pPlayer->rs_cur_b  = ring_peek(vecB, used);
+            pPlayer->rs_frac -= 1.0;
+            ++used;
+        }
+        if (pPlayer->rs_frac >= 1.0)
+            break; // Ring buffers run dry
+        pOutA[offset] = pPlayer->rs_prev_a + (pPlayer->rs_cur_a - pPlayer->rs_prev_a) * pPlayer->rs_frac;
+        pOutB[offset] = pPlayer->rs_prev_b + (pPlayer->rs_cur_b - pPlayer->rs_prev_b) * pPlayer->rs_frac;
+        pPlayer->rs_frac += step;
+    }
+    ioRingReadAdvance(pPlayer->ringbuffer_a, IO_RING(pPlayer->index, 0), vecA, used * sizeof(float));
+    ioRingReadAdvance(pPlayer->ringbuffer_b, IO_RING(pPlayer->index, 1), vecB, used * sizeof(float));
+    r_count += used;
+    return offset;
+}
+
 // Handle JACK process callback
-int on_jack_process(jack_nframes_t nFrames, void* arg) {
-    getMutex();
+// Create monitor region in shared memory, falling back to private memory if shared memory is unavailable
+void init_monitor() {
+    g_monitor = (monitor_region*)rtmonitorCreate(g_monitor_shm, MONITOR_SHM_PREFIX, sizeof(monitor_region));
+    if (!g_monitor)
+        return;
+    if (!g_monitor_shm.bShared)
+        fprintf(stderr, "libzynaudioplayer error: failed to create shared memory - monitor feed only available within process\n");
+    g_monitor->version         = MONITOR_VERSION;
+    g_monitor->players         = MONITOR_PLAYERS;
+    g_monitor->envelope_points = MONITOR_ENVELOPE;
+    g_monitor->envelope_period = MONITOR_ENVELOPE_PERIOD;
+}
+
+void release_monitor() {
+    rtmonitorRelease(g_monitor_shm);
+    g_monitor = nullptr;
+}
 
+// Assign a free monitor slot to a player (call before player is added to g_vPlayers)
+void acquire_monitor_slot(AUDIO_PLAYER* pPlayer) {
+    pPlayer->monitor_slot = -1;
+    if (!g_monitor)
+        return;
+    for (int slot = 0; slot < MONITOR_PLAYERS; ++slot) {
+        monitor_player* pMon = &g_monitor->player[slot];
+        if (pMon->index)
+            continue;
+        rtmonitorWriteBegin(&pMon->seq);
+        pMon->index          = pPlayer->index;
+        pMon->play_state     = STOPPED;
+        pMon->file_open      = FILE_CLOSED;
+        pMon->envelope_count = 0;
+        rtmonitorWriteEnd(&pMon->seq);
+        pPlayer->monitor_slot = slot;
+        return;
+    }
+}
+
+// Free a player's monitor slot (call after player is removed from g_vPlayers)
+void release_monitor_slot(AUDIO_PLAYER* pPlayer) {
+    if (!g_monitor || pPlayer->monitor_slot < 0)
+        return;
+    monitor_player* pMon = &g_monitor->player[pPlayer->monitor_slot];
+    rtmonitorWriteBegin(&pMon->seq);
+    pMon->index = 0;
+    rtmonitorWriteEnd(&pMon->seq);
+    pPlayer->monitor_slot = -1;
+}
+
+// Publish playhead, state and output envelope of a player to its monitor slot - called from jack process
+void publish_monitor(AUDIO_PLAYER* pPlayer, const float* pOutA, const float* pOutB, jack_nframes_t nFrames) {
+    if (!g_monitor || pPlayer->monitor_slot < 0)
+        return;
+    monitor_player* pMon = &g_monitor->player[pPlayer->monitor_slot];
+    uint32_t nPeriod     = g_samplerate * MONITOR_ENVELOPE_PERIOD;
+    rtmonitorWriteBegin(&pMon->seq);
+    for (jack_nframes_t offset = 0; offset < nFrames; ++offset) {
+        float fA = pOutA ? pOutA[offset] : 0.0;
+        float fB = pOutB ? pOutB[offset] : 0.0;
+        pPlayer->monitor_peak_a = max(pPlayer->monitor_peak_a, fabsf(fA));
+        pPlayer->monitor_peak_b = max(pPlayer->monitor_peak_b, fabsf(fB));
+        pPlayer->monitor_sum_a += fA * fA;
+        pPlayer->monitor_sum_b += fB * fB;
+        if (++pPlayer->monitor_frames < nPeriod)
+            continue;
+        uint32_t point        = pMon->envelope_count % MONITOR_ENVELOPE;
+        pMon->peak_a[point]   = pPlayer->monitor_peak_a;
+        pMon->peak_b[point]   = pPlayer->monitor_peak_b;
+        pMon->rms_a[point]    = sqrtf(pPlayer->monitor_sum_a / pPlayer->monitor_frames);
+        pMon->rms_b[point]    = sqrtf(pPlayer->monitor_sum_b / pPlayer->monitor_frames);
+        ++pMon->envelope_count;
+        pPlayer->monitor_frames = 0;
+        pPlayer->monitor_peak_a = 0.0;
+        pPlayer->monitor_peak_b = 0.0;
+        pPlayer->monitor_sum_a  = 0.0;
+        pPlayer->monitor_sum_b  = 0.0;
+    }
+    pMon->play_state = pPlayer->play_state;
+    pMon->file_open  = pPlayer->file_open;
+    pMon->loop       = pPlayer->loop;
+    pMon->varispeed  = pPlayer->varispeed;
+    if (pPlayer->file_open == FILE_OPEN) {
+        pMon->position        = (double)(pPlayer->play_pos_frames) / g_samplerate / pPlayer->speed;
+        pMon->position_frames = llround(pPlayer->play_pos_frames / pPlayer->src_ratio);
+        pMon->duration        = pPlayer->sf_info.samplerate ? (double)pPlayer->sf_info.frames / pPlayer->sf_info.samplerate / pPlayer->speed : 0.0;
+    } else {
+        pMon->position        = 0.0;
+        pMon->position_frames = 0;
+        pMon->duration        = 0.0;
+    }
+    rtmonitorWriteEnd(&pMon->seq);
+}
+
+// Process one period of all players (mutex already held)
+void process_period(jack_nframes_t nFrames) {
     // Process MIDI input
-    void* pMidiBuffer = jack_port_get_buffer(g_jack_midi_in, nFrames);
+    void* pMidiBuffer = ioGetMidiBuffer(g_jack_midi_in, nFrames);
     jack_midi_event_t midiEvent;
-    jack_nframes_t nCount = jack_midi_get_event_count(pMidiBuffer);
+    jack_nframes_t nCount = ioMidiGetEventCount(pMidiBuffer);
     for (jack_nframes_t i = 0; i < nCount; i++) {
-        jack_midi_event_get(&midiEvent, pMidiBuffer, i);
+        ioMidiEventGet(&midiEvent, pMidiBuffer, i);
         uint8_t chan = midiEvent.buffer[0] & 0x0F;
         for (auto it = g_vPlayers.begin(); it != g_vPlayers.end(); ++it) {
             AUDIO_PLAYER* pPlayer = *it;
@@ -1240,11 +2119,11 @@ int on_jack_process(jack_nframes_t nFrames, void* arg) {
                         pPlayer->held_notes[pPlayer->last_note_played] = 0;
                         pPlayer->held_note                             = 0;
                         stop_playback(pPlayer);
-                        DPRINTF("TOGGLE OFF\n");
+                        RTLOG("TOGGLE OFF\n");
                     } else {
                         pPlayer->held_notes[pPlayer->last_note_played] = 1;
                         pPlayer->held_note                             = 1;
-                        DPRINTF("TOGGLE ON\n");
+                        RTLOG("TOGGLE ON\n");
                     }
                     continue;
                 } else {
@@ -1258,8 +2137,8 @@ int on_jack_process(jack_nframes_t nFrames, void* arg) {
                     pPlayer->time_ratio_dirty = true;
                 }
                 pPlayer->file_read_status = SEEKING;
-                jack_ringbuffer_reset(pPlayer->ringbuffer_a);
-                jack_ringbuffer_reset(pPlayer->ringbuffer_b);
+                ioRingReset(pPlayer->ringbuffer_a);
+                ioRingReset(pPlayer->ringbuffer_b);
             } else if (cmd == 0xE0) {
                 // Pitchbend
                 pPlayer->pitch_bend = pPlayer->pitch_bend_range * ((midiEvent.buffer[1] + 128 * midiEvent.buffer[2]) / 8192.0 - 1.0);
@@ -1268,6 +2147,8 @@ int on_jack_process(jack_nframes_t nFrames, void* arg) {
                     pPlayer->pitchshift       = pow(2.0, (pPlayer->last_note_played - pPlayer->base_note + pPlayer->pitch_bend) / 12);
                     pPlayer->time_ratio_dirty = true;
                 }
+            } else if (cmd == 0xB0 && pPlayer->file_open == FILE_OPEN && process_cc(pPlayer, midiEvent.buffer[1], midiEvent.buffer[2], midiEvent.time)) {
+                // Mapped CC handled by process_cc
             } else if (cmd == 0xB0) {
                 if (midiEvent.buffer[1] == 64) {
                     // Sustain pedal
@@ -1299,14 +2180,29 @@ int on_jack_process(jack_nframes_t nFrames, void* arg) {
 
     for (auto it = g_vPlayers.begin(); it != g_vPlayers.end(); ++it) {
         AUDIO_PLAYER* pPlayer = *it;
-        if (pPlayer->file_open != FILE_OPEN)
+        if (pPlayer->file_open != FILE_OPEN) {
+            publish_monitor(pPlayer, nullptr, nullptr, nFrames);
             continue;
+        }
+
+        if (pPlayer->stretch_tier != pPlayer->stretch_tier_req)
+            apply_stretch_tier(pPlayer, pPlayer->stretch_tier_req);
+
+        if (pPlayer->varispeed_ride) {
+            // Smooth varispeed towards value requested by MIDI CC
+            float ratio = pPlayer->varispeed + (pPlayer->varispeed_target - pPlayer->varispeed) * cc_smooth_coef(pPlayer, nFrames);
+            if (fabs(pPlayer->varispeed_target - ratio) < 0.001) {
+                ratio                   = pPlayer->varispeed_target;
+                pPlayer->varispeed_ride = false;
+            }
+            apply_varispeed(pPlayer, ratio);
+        }
 
         uint32_t cue_point_play = pPlayer->cue_points.size();
         size_t r_count          = 0; // Quantity of frames removed from queue, i.e. how far advanced through the audio
         size_t a_count          = 0; // Quantity of frames added to playback (non silent audio)
-        auto pOutA              = (jack_default_audio_sample_t*)jack_port_get_buffer(pPlayer->jack_out_a, nFrames);
-        auto pOutB              = (jack_default_audio_sample_t*)jack_port_get_buffer(pPlayer->jack_out_b, nFrames);
+        auto pOutA              = ioGetAudioOutput(pPlayer->jack_out_a, nFrames);
+        auto pOutB              = ioGetAudioOutput(pPlayer->jack_out_b, nFrames);
         float pInA[256];
         float pInB[256];
         float* stretch_input_buffers[] = {pInA, pInB};
@@ -1318,38 +2214,54 @@ int on_jack_process(jack_nframes_t nFrames, void* arg) {
         }
 
         if (pPlayer->play_state == PLAYING || pPlayer->play_state == STOPPING) {
-            if (pPlayer->time_ratio_dirty) {
-                if (fabs(pPlayer->varispeed) < 0.1) {
-                    // Much lower than this and the stretcher starts auto-resizing its buffers
-                    //!@todo Pause playback
-                    // pPlayer->stretcher->setTimeRatio(0.0);
-                } else {
-                    pPlayer->stretcher->setTimeRatio(pPlayer->time_ratio / fabs(pPlayer->varispeed) / pPlayer->speed);
-                    pPlayer->stretcher->setPitchScale(pPlayer->pitch * pPlayer->pitchshift * fabs(pPlayer->varispeed));
+            if (pPlayer->stretch_tier == STRETCH_TIER_RESAMPLE) {
+                a_count = resample(pPlayer, pOutA, pOutB, nFrames, r_count);
+            } else {
+                if (pPlayer->time_ratio_dirty) {
+                    if (fabs(pPlayer->varispeed) < 0.1) {
+                        // Much lower than this and the stretcher starts auto-resizing its buffers
+                        //!@todo Pause playback
+                        // pPlayer->stretcher->setTimeRatio(0.0);
+                    } else {
+                        pPlayer->stretcher->setTimeRatio(pPlayer->time_ratio / fabs(pPlayer->varispeed) / pPlayer->speed);
+                        pPlayer->stretcher->setPitchScale(pPlayer->pitch * pPlayer->pitchshift * fabs(pPlayer->varispeed));
+                    }
+                    pPlayer->time_ratio_dirty = false;
                 }
-                pPlayer->time_ratio_dirty = false;
-            }
-            while (pPlayer->stretcher->available() < nFrames) {
-                // Process data from fifo until sufficient to populate this frame (first attempt may give -1 but that's okay as we will repeat)
-                size_t sampsReq = min((size_t)256, pPlayer->stretcher->getSamplesRequired());
-                size_t nBytes   = min(jack_ringbuffer_read_space(pPlayer->ringbuffer_a), jack_ringbuffer_read_space(pPlayer->ringbuffer_b));
-                nBytes          = min(nBytes, sampsReq * sizeof(float));
-                nBytes -= nBytes % sizeof(float);
-                size_t nRead  = jack_ringbuffer_read(pPlayer->ringbuffer_a, (char*)pInA, nBytes);
-                size_t nReadB = jack_ringbuffer_read(pPlayer->ringbuffer_b, (char*)pInB, nRead);
-                r_count += nRead / sizeof(float);
-                // stretch
-                pPlayer->stretcher->process(stretch_input_buffers, nRead / sizeof(float), nRead != nBytes);
-                if (nRead == 0)
-                    break; // fifo buffers run dry
+                while (pPlayer->stretcher->available() < nFrames) {
+                    // Process data from fifo until sufficient to populate this frame (first attempt may give -1 but that's okay as we will repeat)
+                    size_t sampsReq = min((size_t)256, pPlayer->stretcher->getSamplesRequired());
+                    size_t nBytes   = min(ioRingReadSpace(pPlayer->ringbuffer_a, IO_RING(pPlayer->index, 0)),
+                                          ioRingReadSpace(pPlayer->ringbuffer_b, IO_RING(pPlayer->index, 1)));
+                    nBytes          = min(nBytes, sampsReq * sizeof(float));
+                    nBytes -= nBytes % sizeof(float);
+                    size_t nRead  = ioRingRead(pPlayer->ringbuffer_a, IO_RING(pPlayer->index, 0), (char*)pInA, nBytes);
+                    size_t nReadB = ioRingRead(pPlayer->ringbuffer_b, IO_RING(pPlayer->index, 1), (char*)pInB, nRead);
+                    r_count += nRead / sizeof(float);
+                    // stretch
+                    pPlayer->stretcher->process(stretch_input_buffers, nRead / sizeof(float), nRead != nBytes);
+                    if (nRead == 0)
+                        break; // fifo buffers run dry
+                }
+                a_count = min(pPlayer->stretcher->available(), (int)nFrames);
+                if (a_count < 0)
+                    a_count = 0; // If stretcher gives fault it will respond with -1
+                a_count = pPlayer->stretcher->retrieve(output_buffers, a_count);
             }
-            a_count = min(pPlayer->stretcher->available(), (int)nFrames);
-            if (a_count < 0)
-                a_count = 0; // If stretcher gives fault it will respond with -1
-            a_count = pPlayer->stretcher->retrieve(output_buffers, a_count);
             if (pPlayer->held_note != pPlayer->env_gate)
                 set_env_gate(pPlayer, pPlayer->held_note);
+            float fGainCoef = cc_smooth_coef(pPlayer, 1);
             for (size_t offset = 0; offset < a_count; ++offset) {
+                // Smooth gain towards value requested by MIDI CC from its frame offset
+                if (offset == pPlayer->cc_gain_offset) {
+                    pPlayer->gain_target    = pPlayer->cc_gain;
+                    pPlayer->cc_gain_offset = UINT32_MAX;
+                }
+                if (pPlayer->gain != pPlayer->gain_target) {
+                    pPlayer->gain += (pPlayer->gain_target - pPlayer->gain) * fGainCoef;
+                    if (fabs(pPlayer->gain_target - pPlayer->gain) < 0.00001)
+                        pPlayer->gain = pPlayer->gain_target;
+                }
                 // Set volume / gain / level / envelope
                 if (pPlayer->env_state != ENV_IDLE) {
                     process_env(pPlayer);
@@ -1368,6 +2280,13 @@ int on_jack_process(jack_nframes_t nFrames, void* arg) {
                 pPlayer->play_pos_frames -= r_count;
             else
                 pPlayer->play_pos_frames += r_count;
+            pPlayer->ring_frames_read += r_count;
+            if (pPlayer->switch_pending && pPlayer->ring_frames_read >= pPlayer->switch_pos) {
+                // Reached first frame of next playlist file
+                apply_next_file(pPlayer);
+                pPlayer->play_pos_frames = pPlayer->crop_start_src + pPlayer->ring_frames_read - pPlayer->switch_pos;
+                cue_point_play           = 0;
+            }
 
             if (cue_point_play) {
                 uint8_t cue = pPlayer->last_note_played - 59;
@@ -1389,7 +2308,7 @@ int on_jack_process(jack_nframes_t nFrames, void* arg) {
                 if (pPlayer->loop == 1) {
                     if (bReverse) {
                         if (pPlayer->play_pos_frames <= pPlayer->loop_start_src) {
-                            size_t i = pPlayer->loop_start_src - pPlayer->play_pos_frames;
+                            sf_count_t i = pPlayer->loop_start_src - pPlayer->play_pos_frames;
                             i %= pPlayer->loop_end_src - pPlayer->loop_start_src;
                             pPlayer->play_pos_frames = pPlayer->loop_end_src - i;
                         }
@@ -1407,7 +2326,7 @@ int on_jack_process(jack_nframes_t nFrames, void* arg) {
                         pPlayer->play_pos_frames = pPlayer->crop_start_src;
                     pPlayer->play_state = STOPPING;
                     pPlayer->env_state  = ENV_IDLE;
-                    DPRINTF("libzynaudioplayer: Short read (%lu) and IDLE so STOPPING\n", a_count);
+                    RTLOG("libzynaudioplayer: Short read (%lu) and IDLE so STOPPING\n", a_count);
                 }
             }
         }
@@ -1432,9 +2351,17 @@ int on_jack_process(jack_nframes_t nFrames, void* arg) {
                 pPlayer->held_note = 0;
             }
 
-            DPRINTF("libzynaudioplayer: Stopped. Used %u frames from %u in buffer to soft mute (fade). Silencing remaining %u frames (%u bytes)\n", a_count,
-                    nFrames, nFrames - a_count, (nFrames - a_count) * sizeof(jack_default_audio_sample_t));
+            RTLOG("libzynaudioplayer: Stopped. Used %u frames from %u in buffer to soft mute (fade). Silencing remaining %u frames (%u bytes)\n", a_count,
+                  nFrames, nFrames - a_count, (nFrames - a_count) * sizeof(jack_default_audio_sample_t));
+        }
+
+        if (pPlayer->cc_gain_offset != UINT32_MAX) {
+            // Gain CC beyond end of audio in this period
+            pPlayer->gain_target    = pPlayer->cc_gain;
+            pPlayer->cc_gain_offset = UINT32_MAX;
         }
+        if (a_count == 0)
+            pPlayer->gain = pPlayer->gain_target; // No need to smooth whilst silent
 
         // Silence remainder of frame
         memset(pOutA + a_count, 0, (nFrames - a_count) * sizeof(jack_default_audio_sample_t));
@@ -1442,12 +2369,228 @@ int on_jack_process(jack_nframes_t nFrames, void* arg) {
         if (pPlayer->env_state != ENV_IDLE)
             for (int i = 0; i < nFrames - a_count; ++i)
                 process_env(pPlayer);
+
+        publish_monitor(pPlayer, pOutA, pOutB, nFrames);
     }
+}
+
+// ** Capture and replay **
+
+// Player configuration and jack process state that determine the output of a period (excludes monitor feed which is not published during replay)
+#define PLAYER_STATE_FIELDS(X)                                                                                                                                 \
+    X(file_open) X(file_read_status) X(play_state) X(loop) X(looped) X(loop_start) X(loop_start_src) X(loop_end) X(loop_end_src) X(crop_start)                \
+    X(crop_start_src) X(crop_end) X(crop_end_src) X(gain) X(env_state) X(env_gate) X(env_hold) X(env_hold_count) X(env_level) X(env_attack_base)           \
+    X(env_attack_coef) X(env_decay_base) X(env_decay_coef) X(env_sustain_level) X(env_release_base) X(env_release_coef) X(play_pos_frames) X(base_note)      \
+    X(midi_chan) X(last_note_played) X(held_notes) X(held_note) X(sustain) X(time_ratio_dirty) X(time_ratio) X(src_ratio) X(pitch_bend)                    \
+    X(pitch_bend_range) X(varispeed) X(play_varispeed) X(pitchshift) X(speed) X(pitch) X(cc_map) X(cc_flags) X(cc_msb) X(gain_target) X(cc_gain)            \
+    X(cc_gain_offset) X(varispeed_target) X(varispeed_ride) X(cc_smooth_time) X(stretch_tier_req) X(stretch_tier) X(rs_frac) X(rs_prev_a) X(rs_prev_b)     \
+    X(rs_cur_a) X(rs_cur_b) X(ring_frames_read) X(switch_pos) X(switch_pending) X(playlist_switched) X(switch_time_ratio) X(stretcher_samplerate)          \
+    X(next_src_ratio) X(next_frames) X(next_loop_start) X(next_loop_end) X(next_beats) X(next_base_note)
+
+#define PLAYER_STATE_DECLARE(field) decltype(AUDIO_PLAYER::field) field;
+struct PLAYER_STATE {
+    PLAYER_STATE_FIELDS(PLAYER_STATE_DECLARE)
+};
+
+// Runtime state at start of capture (each period records a snapshot of each player)
+struct RUNTIME_STATE {
+    uint32_t samplerate; // Playback samplerate
+    uint32_t players;    // Quantity of players
+};
+
+// Populate snapshot of player (padding is zeroed so that snapshot may be hashed)
+void get_player_state(AUDIO_PLAYER* pPlayer, PLAYER_STATE* pState) {
+    memset(pState, 0, sizeof(PLAYER_STATE));
+#define PLAYER_STATE_GET(field) memcpy(&pState->field, &pPlayer->field, sizeof(pState->field));
+    PLAYER_STATE_FIELDS(PLAYER_STATE_GET)
+}
 
+// Restore player from snapshot
+void set_player_state(AUDIO_PLAYER* pPlayer, const PLAYER_STATE* pState) {
+#define PLAYER_STATE_SET(field) memcpy(&pPlayer->field, &pState->field, sizeof(pState->field));
+    PLAYER_STATE_FIELDS(PLAYER_STATE_SET)
+}
+
+// Reset stretcher to a state that replay can reproduce - called from jack process during capture and replay
+void sync_stretcher(AUDIO_PLAYER* pPlayer) {
+    pPlayer->stretcher_synced = pPlayer->stretcher_serial;
+    if (!pPlayer->stretcher)
+        return;
+    pPlayer->stretcher->reset();
+    pPlayer->stretcher->setTimeRatio(1.0);
+    pPlayer->stretcher->setPitchScale(1.0);
+    set_stretch_options(pPlayer, pPlayer->stretch_tier);
+    pPlayer->time_ratio_dirty = true;
+}
+
+// Record snapshot of each player at start of captured period (mutex already held)
+void capture_players(bool bSyncAll) {
+    PLAYER_STATE state;
+    for (AUDIO_PLAYER* pPlayer : g_vPlayers) {
+        CAPTURE_PLAYER_DATA data = {pPlayer->index, 0, (uint32_t)pPlayer->cue_points.size(), sizeof(PLAYER_STATE)};
+        if (bSyncAll || pPlayer->stretcher_synced != pPlayer->stretcher_serial) {
+            sync_stretcher(pPlayer);
+            data.sync = 1;
+        }
+        get_player_state(pPlayer, &state);
+        ioCapturePlayer(&data, &state, data.cues ? &pPlayer->cue_points[0].offset : nullptr, sizeof(cue_point));
+    }
+}
+
+// Hash state of all players at end of period
+uint64_t get_state_hash() {
+    uint64_t nHash = CAPTURE_HASH_SEED;
+    PLAYER_STATE state;
+    for (AUDIO_PLAYER* pPlayer : g_vPlayers) {
+        get_player_state(pPlayer, &state);
+        nHash = captureHash(nHash, &pPlayer->index, sizeof(pPlayer->index));
+        nHash = captureHash(nHash, &state, sizeof(state));
+    }
+    return nHash;
+}
+
+int on_jack_process(jack_nframes_t nFrames, void* arg) {
+    getMutex();
+    ioBeginPeriod(nFrames, g_samplerate);
+    bool bSyncAll = false;
+    if (captureIsPending()) {
+        RUNTIME_STATE state = {g_samplerate, (uint32_t)g_vPlayers.size()};
+        ioCaptureState(&state, sizeof(state));
+        bSyncAll = true;
+    }
+    if (ioIsPeriodCaptured())
+        capture_players(bSyncAll);
+    process_period(nFrames);
+    ioEndPeriod(ioIsPeriodHashed() ? get_state_hash() : 0);
     releaseMutex();
     return 0;
 }
 
+vector<AUDIO_PLAYER*> g_vReplayPlayers; // Players restored from capture log (outputs are replay buffers, no file reader)
+
+// Get replay player with index, creating it if necessary
+static AUDIO_PLAYER* replay_player(uint32_t index) {
+    for (AUDIO_PLAYER* pPlayer : g_vReplayPlayers)
+        if (pPlayer->index == index)
+            return pPlayer;
+    AUDIO_PLAYER* pPlayer = new AUDIO_PLAYER();
+    pPlayer->index        = index;
+    pPlayer->jack_out_a   = replayCreatePort();
+    pPlayer->jack_out_b   = replayCreatePort();
+    pPlayer->monitor_slot = -1;
+    g_vReplayPlayers.push_back(pPlayer);
+    return pPlayer;
+}
+
+static int32_t replay_record(uint8_t type, const void* pPayload, uint32_t nSize, bool bOverlap) {
+    if (type == CAPTURE_RECORD_STATE) {
+        RUNTIME_STATE state;
+        memcpy(&state, pPayload, sizeof(state));
+        g_samplerate = state.samplerate;
+    } else if (type == CAPTURE_RECORD_PERIOD) {
+        const CAPTURE_PERIOD_DATA* pPeriod = (const CAPTURE_PERIOD_DATA*)pPayload;
+        const uint8_t* pData               = (const uint8_t*)(pPeriod + 1);
+        const uint8_t* pEnd                = (const uint8_t*)pPayload + nSize;
+        g_samplerate                       = pPeriod->samplerate;
+        g_vPlayers.clear();
+        // Restore snapshot of each player that existed at start of period
+        for (uint32_t i = 0; i < pPeriod->players; ++i) {
+            CAPTURE_PLAYER_DATA data;
+            if (pData + sizeof(data) > pEnd)
+                return -2;
+            memcpy(&data, pData, sizeof(data));
+            pData += sizeof(data);
+            if (data.state != sizeof(PLAYER_STATE) || pData + data.state + data.cues * sizeof(int64_t) > pEnd)
+                return -2;
+            AUDIO_PLAYER* pPlayer       = replay_player(data.index);
+            jack_nframes_t nStretchRate = pPlayer->stretcher_samplerate;
+            PLAYER_STATE state;
+            memcpy(&state, pData, sizeof(state));
+            set_player_state(pPlayer, &state);
+            pData += data.state;
+            pPlayer->cue_points.clear();
+            for (uint32_t nCue = 0; nCue < data.cues; ++nCue) {
+                int64_t nOffset;
+                memcpy(&nOffset, pData, sizeof(nOffset));
+                pData += sizeof(nOffset);
+                pPlayer->cue_points.emplace_back(nOffset, nullptr);
+            }
+            if (pPlayer->stretcher && pPlayer->stretcher_samplerate != nStretchRate) {
+                delete pPlayer->stretcher;
+                pPlayer->stretcher = nullptr;
+            }
+            if (!pPlayer->stretcher && pPlayer->stretcher_samplerate) {
+                // Stretcher is created at the samplerate it was created with during capture
+                uint32_t nSamplerate = g_samplerate;
+                g_samplerate         = pPlayer->stretcher_samplerate;
+                alloc_stretcher(pPlayer);
+                g_samplerate = nSamplerate;
+            }
+            if (data.sync)
+                sync_stretcher(pPlayer);
+            g_vPlayers.push_back(pPlayer);
+        }
+        if (!replaySetPeriod(pPeriod, pData, pEnd))
+            return -2;
+        on_jack_process(pPeriod->frames, nullptr);
+        uint64_t nOutput, nState;
+        bool bTape = replayGetPeriodHashes(&nOutput, &nState);
+        if (nOutput != pPeriod->outputHash || nState != pPeriod->stateHash || !bTape) {
+            fprintf(stderr, "libzynaudioplayer replay: period %u differs (audio output %s, state %s, ring tape %s)\n", pPeriod->period,
+                    nOutput == pPeriod->outputHash ? "same" : "differs", nState == pPeriod->stateHash ? "same" : "differs", bTape ? "same" : "differs");
+            return pPeriod->period;
+        }
+    }
+    return -1;
+}
+
+// Player configuration is recorded as a snapshot each period so API calls are not replayed
+static void replay_api(uint16_t id, const uint8_t* pArgs) { fprintf(stderr, "libzynaudioplayer replay ignoring unknown API call %u\n", id); }
+
+bool startCapture(const char* filename) {
+    if (!g_jack_client || captureIsRunning() || replayIsRunning())
+        return false;
+    // Capture must start with players stopped so that stretchers and ring buffers start from a state that replay can reproduce
+    for (AUDIO_PLAYER* pPlayer : g_vPlayers) {
+        if (pPlayer->play_state != STOPPED) {
+            fprintf(stderr, "libzynaudioplayer cannot start capture whilst playing\n");
+            return false;
+        }
+    }
+    if (!captureStart(filename, "audioplayer", CAPTURE_VERSION, g_samplerate, 0, sizeof(RUNTIME_STATE)))
+        return false;
+    captureArm();
+    return true;
+}
+
+void stopCapture() { captureStop(); }
+
+bool isCapturing() { return captureIsRunning(); }
+
+int32_t replayCapture(const char* filename) {
+    if (g_jack_client || !g_vPlayers.empty() || captureIsRunning() || replayIsRunning())
+        return -2; // Replay drives the process callback so must not run alongside JACK
+    CAPTURE_HEADER header;
+    if (!replayOpen(filename, "audioplayer", CAPTURE_VERSION, sizeof(RUNTIME_STATE), &header))
+        return -2;
+    replayStart();
+    g_samplerate    = header.sampleRate;
+    int32_t nResult = replayRun(replay_record, replay_api);
+
+    // Release replay state
+    g_vPlayers.clear();
+    for (AUDIO_PLAYER* pPlayer : g_vReplayPlayers) {
+        delete pPlayer->stretcher;
+        replayFreePort(pPlayer->jack_out_a);
+        replayFreePort(pPlayer->jack_out_b);
+        delete pPlayer;
+    }
+    g_vReplayPlayers.clear();
+    replayStop();
+    replayClose();
+    return nResult;
+}
+
 // Handle JACK process callback
 int on_jack_samplerate(jack_nframes_t nFrames, void* pArgs) {
     DPRINTF("libzynaudioplayer: Jack sample rate: %u\n", nFrames);
@@ -1456,7 +2599,13 @@ int on_jack_samplerate(jack_nframes_t nFrames, void* pArgs) {
     return 0;
 }
 
-static void lib_init(void) { fprintf(stderr, "Started libzynaudioplayer using %s\n", sf_version_string()); }
+static void lib_init(void) {
+    fprintf(stderr, "Started libzynaudioplayer using %s\n", sf_version_string());
+    g_load_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (g_load_fd < 0)
+        fprintf(stderr, "libzynaudioplayer error: failed to create load completion eventfd\n");
+    init_monitor();
+}
 
 bool init_jack() {
     if (g_jack_client)
@@ -1477,6 +2626,7 @@ bool init_jack() {
 
     // Register the callback to process audio and MIDI
     jack_set_process_callback(g_jack_client, on_jack_process, 0);
+    jack_set_thread_init_callback(g_jack_client, rtlogThreadInit, 0);
     jack_set_sample_rate_callback(g_jack_client, on_jack_samplerate, 0);
 
     if (jack_activate(g_jack_client)) {
@@ -1499,20 +2649,44 @@ void stop_jack() {
 
 static void lib_exit(void) {
     fprintf(stderr, "libzynaudioplayer exiting...  ");
+    enable_stretch_governor(0);
+    set_pool_size(0);
     while (!g_vPlayers.empty()) {
         remove_player(g_vPlayers.front());
     }
+    if (g_load_fd >= 0)
+        close(g_load_fd);
+    g_load_fd = -1;
+    release_monitor();
     fprintf(stderr, "done!\n");
 }
 
-AUDIO_PLAYER* add_player() {
-    if (!init_jack())
-        return nullptr;
-    AUDIO_PLAYER* pPlayer = new AUDIO_PLAYER();
-    if (!pPlayer)
-        return nullptr;
-    pPlayer->index = g_nextIndex++;
-    ;
+void reset_player(AUDIO_PLAYER* pPlayer) {
+    // Restore default configuration, retaining ports and preallocated resources
+    jack_port_t* pOutA            = pPlayer->jack_out_a;
+    jack_port_t* pOutB            = pPlayer->jack_out_b;
+    RubberBandStretcher* pStretch = pPlayer->stretcher;
+    jack_ringbuffer_t* pRingA     = pPlayer->ringbuffer_a;
+    jack_ringbuffer_t* pRingB     = pPlayer->ringbuffer_b;
+    size_t nRingSize              = pPlayer->ringbuffer_size;
+    jack_nframes_t nStretchRate   = pPlayer->stretcher_samplerate;
+    uint32_t nStretchSerial       = pPlayer->stretcher_serial;
+    uint32_t nIndex               = pPlayer->index;
+    uint32_t nPoolIndex           = pPlayer->pool_index;
+
+    *pPlayer                      = AUDIO_PLAYER();
+
+    pPlayer->jack_out_a           = pOutA;
+    pPlayer->jack_out_b           = pOutB;
+    pPlayer->stretcher            = pStretch;
+    pPlayer->ringbuffer_a         = pRingA;
+    pPlayer->ringbuffer_b         = pRingB;
+    pPlayer->ringbuffer_size      = nRingSize;
+    pPlayer->stretcher_samplerate = nStretchRate;
+    pPlayer->stretcher_serial     = nStretchSerial + 1;
+    pPlayer->index                = nIndex;
+    pPlayer->pool_index           = nPoolIndex;
+
     pPlayer->loop_start_src = pPlayer->loop_start * pPlayer->src_ratio;
     pPlayer->loop_end       = pPlayer->input_buffer_size;
     pPlayer->loop_end_src   = pPlayer->loop_end * pPlayer->src_ratio;
@@ -1520,7 +2694,6 @@ AUDIO_PLAYER* add_player() {
     pPlayer->crop_start_src = pPlayer->crop_start * pPlayer->src_ratio;
     pPlayer->crop_end       = pPlayer->input_buffer_size;
     pPlayer->crop_end_src   = pPlayer->crop_end * pPlayer->src_ratio;
-    g_vPlayers.push_back(pPlayer);
 
     set_env_target_ratio_a(pPlayer, 0.3);
     set_env_target_ratio_dr(pPlayer, 0.0001);
@@ -1530,43 +2703,221 @@ AUDIO_PLAYER* add_player() {
     set_env_sustain(pPlayer, 1.0);
     set_env_gate(pPlayer, 0);
     reset_env(pPlayer);
+}
 
-    // Create audio output ports
-    char port_name[8];
+AUDIO_PLAYER* create_player(bool bPooled) {
+    // Create player and register its audio output ports
+    AUDIO_PLAYER* pPlayer = new AUDIO_PLAYER();
+    if (!pPlayer)
+        return nullptr;
+    char port_name[16];
+    const char* prefix = "out";
+    uint32_t index;
+    if (bPooled) {
+        prefix = "pool";
+        index = pPlayer->pool_index = g_nextPoolIndex++;
+        alloc_stretcher(pPlayer);
+        alloc_ringbuffers(pPlayer, pPlayer->input_buffer_size * POOL_SRC_RATIO * pPlayer->buffer_count * sizeof(float));
+    } else {
+        index = pPlayer->index = g_nextIndex++;
+    }
 
-    sprintf(port_name, "out_%02da", pPlayer->index);
+    sprintf(port_name, "%s_%02da", prefix, index);
     if (!(pPlayer->jack_out_a = jack_port_register(g_jack_client, port_name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0))) {
         fprintf(stderr, "libaudioplayer error: cannot register audio output port %s\n", port_name);
-        return 0;
+        delete pPlayer;
+        return nullptr;
     }
-    sprintf(port_name, "out_%02db", pPlayer->index);
+    sprintf(port_name, "%s_%02db", prefix, index);
     if (!(pPlayer->jack_out_b = jack_port_register(g_jack_client, port_name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0))) {
         fprintf(stderr, "libaudioplayer error: cannot register audio output port %s\n", port_name);
         jack_port_unregister(g_jack_client, pPlayer->jack_out_a);
-        return 0;
+        delete pPlayer;
+        return nullptr;
     }
-
-    // fprintf(stderr, "libzynaudioplayer: Created new audio player\n");
     return pPlayer;
 }
 
-void remove_player(AUDIO_PLAYER* pPlayer) {
-    if (!pPlayer)
-        return;
-    unload(pPlayer);
+void destroy_player(AUDIO_PLAYER* pPlayer) {
+    // Unregister ports and free all resources of an unloaded player
     if (jack_port_unregister(g_jack_client, pPlayer->jack_out_a)) {
         fprintf(stderr, "libaudioplayer error: cannot unregister audio output port %02dA\n", pPlayer->index);
     }
     if (jack_port_unregister(g_jack_client, pPlayer->jack_out_b)) {
         fprintf(stderr, "libaudioplayer error: cannot unregister audio output port %02dB\n", pPlayer->index);
     }
+    delete pPlayer->stretcher;
+    if (pPlayer->ringbuffer_a)
+        jack_ringbuffer_free(pPlayer->ringbuffer_a);
+    if (pPlayer->ringbuffer_b)
+        jack_ringbuffer_free(pPlayer->ringbuffer_b);
+    delete pPlayer;
+}
+
+void rename_ports(AUDIO_PLAYER* pPlayer, const char* prefix, uint32_t index) {
+    char port_name[16];
+    sprintf(port_name, "%s_%02da", prefix, index);
+    if (jack_port_rename(g_jack_client, pPlayer->jack_out_a, port_name))
+        fprintf(stderr, "libaudioplayer error: cannot rename audio output port to %s\n", port_name);
+    sprintf(port_name, "%s_%02db", prefix, index);
+    if (jack_port_rename(g_jack_client, pPlayer->jack_out_b, port_name))
+        fprintf(stderr, "libaudioplayer error: cannot rename audio output port to %s\n", port_name);
+}
+
+void* pool_thread_fn(void* param) {
+    // Prewarm players in background to replace those taken from pool
+    pthread_mutex_lock(&g_pool_mutex);
+    while (g_pool_refill) {
+        if (g_vPlayerPool.size() >= g_poolSize) {
+            pthread_cond_wait(&g_pool_cond, &g_pool_mutex);
+            continue;
+        }
+        pthread_mutex_unlock(&g_pool_mutex);
+        AUDIO_PLAYER* pPlayer = create_player(true);
+        if (pPlayer)
+            reset_player(pPlayer);
+        pthread_mutex_lock(&g_pool_mutex);
+        if (!pPlayer) {
+            pthread_cond_wait(&g_pool_cond, &g_pool_mutex); // Retry when next player is taken from pool
+            continue;
+        }
+        if (g_pool_refill && g_vPlayerPool.size() < g_poolSize) {
+            g_vPlayerPool.push_back(pPlayer);
+            continue;
+        }
+        // Pool was shrunk whilst creating player
+        pthread_mutex_unlock(&g_pool_mutex);
+        destroy_player(pPlayer);
+        pthread_mutex_lock(&g_pool_mutex);
+    }
+    pthread_mutex_unlock(&g_pool_mutex);
+    return nullptr;
+}
+
+void stop_pool_refill() {
+    pthread_mutex_lock(&g_pool_mutex);
+    bool bRunning = g_pool_refill;
+    g_pool_refill = false;
+    pthread_cond_signal(&g_pool_cond);
+    pthread_mutex_unlock(&g_pool_mutex);
+    if (bRunning)
+        pthread_join(g_pool_thread, NULL);
+}
+
+AUDIO_PLAYER* add_player() {
+    if (!init_jack())
+        return nullptr;
+    AUDIO_PLAYER* pPlayer = nullptr;
+    pthread_mutex_lock(&g_pool_mutex);
+    if (!g_vPlayerPool.empty()) {
+        // Acquire prewarmed player from pool and refill pool in background
+        pPlayer = g_vPlayerPool.back();
+        g_vPlayerPool.pop_back();
+        pthread_cond_signal(&g_pool_cond);
+    }
+    pthread_mutex_unlock(&g_pool_mutex);
+    if (pPlayer) {
+        pPlayer->index = g_nextIndex++;
+        rename_ports(pPlayer, "out", pPlayer->index);
+    } else {
+        pPlayer = create_player(false);
+        if (!pPlayer)
+            return nullptr;
+        reset_player(pPlayer);
+    }
+    acquire_monitor_slot(pPlayer);
+    getMutex();
+    g_vPlayers.push_back(pPlayer);
+    releaseMutex();
+
+    // fprintf(stderr, "libzynaudioplayer: Created new audio player\n");
+    return pPlayer;
+}
+
+void remove_player(AUDIO_PLAYER* pPlayer) {
+    if (!pPlayer)
+        return;
+    unload(pPlayer);
+    // Discard load results so that a reused (pooled) player is not reported for loads of its previous owner
+    pthread_mutex_lock(&g_load_mutex);
+    g_vLoadResults.erase(remove_if(g_vLoadResults.begin(), g_vLoadResults.end(), [pPlayer](const pair<AUDIO_PLAYER*, uint8_t>& result) { return result.first == pPlayer; }), g_vLoadResults.end());
+    pthread_mutex_unlock(&g_load_mutex);
+    getMutex();
     auto it = find(g_vPlayers.begin(), g_vPlayers.end(), pPlayer);
     if (it != g_vPlayers.end())
         g_vPlayers.erase(it);
-    if (g_vPlayers.size() == 0)
+    releaseMutex();
+    release_monitor_slot(pPlayer);
+    pthread_mutex_lock(&g_pool_mutex);
+    bool bPool = g_vPlayerPool.size() < g_poolSize;
+    pthread_mutex_unlock(&g_pool_mutex);
+    if (bPool) {
+        // Return player to pool for reuse
+        jack_port_disconnect(g_jack_client, pPlayer->jack_out_a);
+        jack_port_disconnect(g_jack_client, pPlayer->jack_out_b);
+        if (!pPlayer->pool_index)
+            pPlayer->pool_index = g_nextPoolIndex++;
+        rename_ports(pPlayer, "pool", pPlayer->pool_index);
+        reset_player(pPlayer);
+        pthread_mutex_lock(&g_pool_mutex);
+        bPool = g_vPlayerPool.size() < g_poolSize; // Refill thread may have filled pool meanwhile
+        if (bPool)
+            g_vPlayerPool.push_back(pPlayer);
+        pthread_mutex_unlock(&g_pool_mutex);
+    }
+    if (!bPool)
+        destroy_player(pPlayer);
+    if (g_vPlayers.size() == 0 && g_poolSize == 0)
         stop_jack();
 }
 
+void set_pool_size(unsigned int size) {
+    vector<AUDIO_PLAYER*> vSurplus;
+    pthread_mutex_lock(&g_pool_mutex);
+    g_poolSize = size;
+    while (g_vPlayerPool.size() > g_poolSize) {
+        vSurplus.push_back(g_vPlayerPool.back());
+        g_vPlayerPool.pop_back();
+    }
+    pthread_mutex_unlock(&g_pool_mutex);
+    if (size == 0)
+        stop_pool_refill();
+    for (auto it = vSurplus.begin(); it != vSurplus.end(); ++it)
+        destroy_player(*it);
+    if (size && init_jack()) {
+        // Fill pool now then keep it filled in background
+        while (get_pool_count() < size) {
+            AUDIO_PLAYER* pPlayer = create_player(true);
+            if (!pPlayer)
+                break;
+            reset_player(pPlayer);
+            pthread_mutex_lock(&g_pool_mutex);
+            g_vPlayerPool.push_back(pPlayer);
+            pthread_mutex_unlock(&g_pool_mutex);
+        }
+        pthread_mutex_lock(&g_pool_mutex);
+        if (!g_pool_refill) {
+            g_pool_refill = true;
+            if (pthread_create(&g_pool_thread, 0, pool_thread_fn, nullptr)) {
+                fprintf(stderr, "libzynaudioplayer error: failed to create player pool thread\n");
+                g_pool_refill = false;
+            }
+        }
+        pthread_mutex_unlock(&g_pool_mutex);
+    }
+    if (g_jack_client && g_vPlayers.size() == 0 && g_poolSize == 0)
+        stop_jack();
+}
+
+unsigned int get_pool_size() { return g_poolSize; }
+
+unsigned int get_pool_count() {
+    pthread_mutex_lock(&g_pool_mutex);
+    unsigned int nCount = g_vPlayerPool.size();
+    pthread_mutex_unlock(&g_pool_mutex);
+    return nCount;
+}
+
 void set_base_note(AUDIO_PLAYER* pPlayer, uint8_t base_note) {
     if (pPlayer && base_note < 128)
         pPlayer->base_note = base_note;
@@ -1587,6 +2938,94 @@ void set_midi_chan(AUDIO_PLAYER* pPlayer, uint8_t midi_chan) {
         pPlayer->midi_chan = -1;
 }
 
+uint8_t set_cc_map(AUDIO_PLAYER* pPlayer, uint8_t cc, uint8_t param, uint8_t flags) {
+    if (!pPlayer || cc > 127 || param > PLAYER_PARAM_LOOP_END)
+        return 0;
+    if (cc == 64 || cc == 120 || cc == 123)
+        return 0; // Reserved for sustain and all off
+    if (cc > 31 || param == PLAYER_PARAM_JOG)
+        flags &= ~PLAYER_CC_14BIT; // Only CC 0..31 have LSB and jog is relative
+    getMutex();
+    pPlayer->cc_map[cc]   = param;
+    pPlayer->cc_flags[cc] = param ? flags : 0;
+    if (cc < 32)
+        pPlayer->cc_msb[cc] = 0;
+    releaseMutex();
+    return 1;
+}
+
+uint8_t get_cc_map(AUDIO_PLAYER* pPlayer, uint8_t cc) {
+    if (!pPlayer || cc > 127)
+        return PLAYER_PARAM_NONE;
+    return pPlayer->cc_map[cc];
+}
+
+uint8_t get_cc_flags(AUDIO_PLAYER* pPlayer, uint8_t cc) {
+    if (!pPlayer || cc > 127)
+        return 0;
+    return pPlayer->cc_flags[cc];
+}
+
+void clear_cc_map(AUDIO_PLAYER* pPlayer) {
+    if (!pPlayer)
+        return;
+    getMutex();
+    memset(pPlayer->cc_map, 0, sizeof(pPlayer->cc_map));
+    memset(pPlayer->cc_flags, 0, sizeof(pPlayer->cc_flags));
+    memset(pPlayer->cc_msb, 0, sizeof(pPlayer->cc_msb));
+    releaseMutex();
+}
+
+void set_cc_smoothing(AUDIO_PLAYER* pPlayer, float time) {
+    if (!pPlayer || time < 0.0 || time > 10.0)
+        return;
+    pPlayer->cc_smooth_time = time;
+}
+
+float get_cc_smoothing(AUDIO_PLAYER* pPlayer) {
+    if (!pPlayer)
+        return 0.0;
+    return pPlayer->cc_smooth_time;
+}
+
+void set_stretch_quality(AUDIO_PLAYER* pPlayer, uint8_t tier) {
+    if (!pPlayer || tier > STRETCH_TIER_RESAMPLE)
+        return;
+    getMutex();
+    pPlayer->stretch_quality = tier;
+    if (!g_governor || pPlayer->stretch_tier_req < tier)
+        pPlayer->stretch_tier_req = tier;
+    releaseMutex();
+}
+
+uint8_t get_stretch_quality(AUDIO_PLAYER* pPlayer) {
+    if (!pPlayer)
+        return STRETCH_TIER_FULL;
+    return pPlayer->stretch_quality;
+}
+
+uint8_t get_stretch_tier(AUDIO_PLAYER* pPlayer) {
+    if (!pPlayer)
+        return STRETCH_TIER_FULL;
+    return pPlayer->stretch_tier;
+}
+
+void set_stretch_priority(AUDIO_PLAYER* pPlayer, uint8_t priority) {
+    if (!pPlayer)
+        return;
+    getMutex();
+    pPlayer->stretch_priority = priority;
+    if (priority == 255)
+        pPlayer->stretch_tier_req = pPlayer->stretch_quality;
+    releaseMutex();
+}
+
+uint8_t get_stretch_priority(AUDIO_PLAYER* pPlayer) {
+    if (!pPlayer)
+        return 0;
+    return pPlayer->stretch_priority;
+}
+
 int get_index(AUDIO_PLAYER* pPlayer) {
     if (!pPlayer)
         return -1;
@@ -1625,7 +3064,9 @@ void set_gain(AUDIO_PLAYER* pPlayer, float gain) {
     if (gain > 100000)
         gain = 100000;
     getMutex();
-    pPlayer->gain = gain;
+    pPlayer->gain           = gain;
+    pPlayer->gain_target    = gain;
+    pPlayer->cc_gain_offset = UINT32_MAX;
     releaseMutex();
     send_notifications(pPlayer, NOTIFY_GAIN);
 }
@@ -1729,6 +3170,8 @@ void set_varispeed(AUDIO_PLAYER* pPlayer, float ratio) {
 
     getMutex();
     pPlayer->varispeed        = ratio;
+    pPlayer->varispeed_target = ratio;
+    pPlayer->varispeed_ride   = false;
     pPlayer->time_ratio_dirty = true;
     pPlayer->file_read_status = SEEKING;
     releaseMutex();
@@ -1800,6 +3243,138 @@ uint8_t get_beats(AUDIO_PLAYER* pPlayer) {
     return pPlayer->beats;
 }
 
+uint8_t playlist_add(AUDIO_PLAYER* pPlayer, const char* filename) {
+    if (!pPlayer || !filename)
+        return 0;
+    getMutex();
+    pPlayer->playlist.push_back(filename);
+    releaseMutex();
+    return 1;
+}
+
+void playlist_clear(AUDIO_PLAYER* pPlayer) {
+    if (!pPlayer)
+        return;
+    getMutex();
+    pPlayer->playlist.clear();
+    releaseMutex();
+}
+
+unsigned int playlist_count(AUDIO_PLAYER* pPlayer) {
+    if (!pPlayer)
+        return 0;
+    getMutex();
+    unsigned int nCount = pPlayer->playlist.size();
+    releaseMutex();
+    return nCount;
+}
+
+void set_crossfade(AUDIO_PLAYER* pPlayer, float duration) {
+    if (!pPlayer)
+        return;
+    if (duration < 0.0)
+        duration = 0.0;
+    pPlayer->crossfade = duration;
+}
+
+float get_crossfade(AUDIO_PLAYER* pPlayer) {
+    if (!pPlayer)
+        return 0.0;
+    return pPlayer->crossfade;
+}
+
+void set_beats_per_bar(uint8_t beats) { g_beats_per_bar = beats; }
+
+uint8_t get_beats_per_bar() { return g_beats_per_bar; }
+
+// Stretch governor thread - steps players between stretch quality tiers based on DSP load
+void* governor_thread_fn(void* param) {
+    unsigned int nSettle = 0; // Quantity of intervals remaining before quality may be reduced again
+    unsigned int nCalm   = 0; // Quantity of consecutive intervals with low DSP load
+    while (g_governor) {
+        usleep(GOVERNOR_INTERVAL);
+        if (!g_jack_client)
+            continue;
+        g_governor_load = 0.7 * g_governor_load + 0.3 * jack_cpu_load(g_jack_client);
+        if (nSettle)
+            --nSettle;
+        AUDIO_PLAYER* pTarget = nullptr;
+        if (g_governor_load > g_governor_high) {
+            nCalm = 0;
+            if (nSettle)
+                continue;
+            // Reduce quality of lowest priority, best quality playing player (not beyond FAST because RESAMPLE changes pitch with speed)
+            getMutex();
+            for (auto it = g_vPlayers.begin(); it != g_vPlayers.end(); ++it) {
+                AUDIO_PLAYER* pPlayer = *it;
+                if (pPlayer->file_open != FILE_OPEN || pPlayer->play_state == STOPPED || pPlayer->stretch_priority == 255 ||
+                    pPlayer->stretch_tier_req >= GOVERNOR_MAX_TIER)
+                    continue;
+                if (!pTarget || pPlayer->stretch_priority < pTarget->stretch_priority ||
+                    (pPlayer->stretch_priority == pTarget->stretch_priority && pPlayer->stretch_tier_req < pTarget->stretch_tier_req))
+                    pTarget = pPlayer;
+            }
+            if (pTarget)
+                ++pTarget->stretch_tier_req;
+            releaseMutex();
+            if (pTarget) {
+                nSettle = GOVERNOR_SETTLE;
+                DPRINTF("libzynaudioplayer: DSP load %0.1f%% - player %u stretch tier %u\n", g_governor_load, pTarget->index, pTarget->stretch_tier_req);
+            }
+        } else if (g_governor_load < g_governor_low) {
+            if (++nCalm < GOVERNOR_HOLD)
+                continue;
+            nCalm = 0;
+            // Restore quality of highest priority, lowest quality player
+            getMutex();
+            for (auto it = g_vPlayers.begin(); it != g_vPlayers.end(); ++it) {
+                AUDIO_PLAYER* pPlayer = *it;
+                if (pPlayer->stretch_tier_req <= pPlayer->stretch_quality)
+                    continue;
+                if (!pTarget || pPlayer->stretch_priority > pTarget->stretch_priority ||
+                    (pPlayer->stretch_priority == pTarget->stretch_priority && pPlayer->stretch_tier_req > pTarget->stretch_tier_req))
+                    pTarget = pPlayer;
+            }
+            if (pTarget)
+                --pTarget->stretch_tier_req;
+            releaseMutex();
+            if (pTarget)
+                DPRINTF("libzynaudioplayer: DSP load %0.1f%% - player %u stretch tier %u\n", g_governor_load, pTarget->index, pTarget->stretch_tier_req);
+        } else {
+            nCalm = 0;
+        }
+    }
+    return nullptr;
+}
+
+void enable_stretch_governor(int enable) {
+    if (enable && !g_governor) {
+        g_governor = true;
+        if (pthread_create(&g_governor_thread, 0, governor_thread_fn, nullptr)) {
+            fprintf(stderr, "libzynaudioplayer error: failed to create stretch governor thread\n");
+            g_governor = false;
+        }
+    } else if (!enable && g_governor) {
+        g_governor = false;
+        pthread_join(g_governor_thread, NULL);
+        getMutex();
+        for (auto it = g_vPlayers.begin(); it != g_vPlayers.end(); ++it)
+            (*it)->stretch_tier_req = (*it)->stretch_quality;
+        releaseMutex();
+    }
+}
+
+int is_stretch_governor_enabled() { return g_governor; }
+
+void set_stretch_governor_thresholds(float low, float high) {
+    if (low < 0.0 || high > 100.0 || low >= high)
+        return;
+    g_governor_low  = low;
+    g_governor_high = high;
+}
+
+float get_stretch_governor_load() { return g_governor_load; }
+
 void set_tempo(float tempo) {
     if (tempo < 10.0)
         return;
@@ -1838,8 +3413,19 @@ const char* get_file_info(const char* filename, int type) {
 void enable_debug(int enable) {
     fprintf(stderr, "libaudioplayer setting debug mode %s\n", enable ? "on" : "off");
     g_debug = enable;
+    rtlogEnable(enable);
 }
 
 int is_debug() { return g_debug; }
 
 unsigned int get_player_count() { return g_vPlayers.size(); }
+
+monitor_region* get_monitor_region() { return g_monitor; }
+
+const char* get_monitor_name() { return g_monitor_shm.sName; }
+
+int get_monitor_slot(AUDIO_PLAYER* pPlayer) {
+    if (!pPlayer)
+        return -1;
+    return pPlayer->monitor_slot;
+}
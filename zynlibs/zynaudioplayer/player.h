@@ -34,7 +34,69 @@ enum {
     NOTIFY_ENV_RELEASE      = 20,
     NOTIFY_ENV_ATTACK_CURVE = 21,
     NOTIFY_ENV_DECAY_CURVE  = 22,
-    NOTIFY_VARISPEED        = 23
+    NOTIFY_VARISPEED        = 23,
+    NOTIFY_LOAD             = 24,
+    NOTIFY_PLAYLIST         = 25,
+    NOTIFY_STRETCH_TIER     = 26
+};
+
+// Time stretch quality tiers (best to cheapest)
+enum {
+    STRETCH_TIER_FULL     = 0, // Formant preserving, high consistency pitch shift
+    STRETCH_TIER_STANDARD = 1, // High consistency pitch shift without formant preservation
+    STRETCH_TIER_FAST     = 2, // High speed pitch shift, smooth transients, independent phase
+    STRETCH_TIER_RESAMPLE = 3  // Bypass stretcher - speed and pitch change together (linear interpolation)
+};
+
+// Player parameters that may be controlled by MIDI CC
+enum {
+    PLAYER_PARAM_NONE       = 0,
+    PLAYER_PARAM_GAIN       = 1, // Gain 0..2
+    PLAYER_PARAM_VARISPEED  = 2, // Varispeed -2..+2 (centre is stopped)
+    PLAYER_PARAM_POSITION   = 3, // Absolute position between crop start and crop end
+    PLAYER_PARAM_JOG        = 4, // Relative position (1..63 forward, 65..127 backward)
+    PLAYER_PARAM_LOOP_START = 5, // Loop start between crop start and crop end
+    PLAYER_PARAM_LOOP_END   = 6  // Loop end between crop start and crop end
+};
+
+// MIDI CC mapping flags
+#define PLAYER_CC_14BIT 0x01 // CC 0..31 is MSB with LSB on CC+32
+
+#define MAX_LOAD_RESULTS 256 // Maximum quantity of completed loads queued for get_load_result()
+
+// Monitor feed published to shared memory for UI animation without library calls
+#define MONITOR_SHM_PREFIX "/zynaudioplayer" // POSIX shared memory object name prefix (/dev/shm/zynaudioplayer.<pid>)
+#define MONITOR_VERSION 1                    // Layout version of monitor region
+#define MONITOR_PLAYERS 32                   // Quantity of player slots in monitor region
+#define MONITOR_ENVELOPE 64                  // Quantity of points in each player's rolling output envelope
+#define MONITOR_ENVELOPE_PERIOD 0.02         // Duration of each envelope point in seconds
+
+// State of a player published by jack process. Seqlock: seq is odd whilst being written so readers copy the slot and retry if seq was odd or changed.
+struct monitor_player {
+    uint32_t seq;                      // Sequence counter
+    uint32_t index;                    // Index of player using slot (0 if slot unused)
+    uint8_t play_state;                // Playback state (STOPPED|PLAYING|STARTING|STOPPING)
+    uint8_t file_open;                 // File state (FILE_CLOSED|FILE_OPENING|FILE_OPEN)
+    uint8_t loop;                      // Loop mode
+    uint8_t reserved;                  // Unused (padding)
+    float position;                    // Playhead in seconds (as get_position)
+    float duration;                    // Duration of file in seconds
+    float varispeed;                   // Current varispeed ratio
+    int64_t position_frames;           // Playhead in frames at file samplerate (as get_position_frames)
+    uint32_t envelope_count;           // Quantity of envelope points written since slot acquired (latest is at (envelope_count - 1) % MONITOR_ENVELOPE)
+    float peak_a[MONITOR_ENVELOPE];    // Peak absolute level of A output in each envelope point
+    float peak_b[MONITOR_ENVELOPE];    // Peak absolute level of B output in each envelope point
+    float rms_a[MONITOR_ENVELOPE];     // RMS level of A output in each envelope point
+    float rms_b[MONITOR_ENVELOPE];     // RMS level of B output in each envelope point
+};
+
+// Shared memory region containing monitor feed of all players
+struct monitor_region {
+    uint32_t version;                        // Layout version (MONITOR_VERSION)
+    uint32_t players;                        // Quantity of player slots (MONITOR_PLAYERS)
+    uint32_t envelope_points;                // Quantity of points in each envelope (MONITOR_ENVELOPE)
+    float envelope_period;                   // Duration of each envelope point in seconds
+    monitor_player player[MONITOR_PLAYERS]; // Player slots
 };
 
 /** @brief  Library constructor (initalisation) */
@@ -71,6 +133,23 @@ AUDIO_PLAYER* add_player();
  */
 void remove_player(AUDIO_PLAYER* pPlayer);
 
+/** @brief  Set quantity of idle players to keep in pool
+ *   @param  size Quantity of players to keep prewarmed (ports registered, buffers allocated)
+ *   @note   Pool is filled immediately. add_player() acquires from pool and remove_player() returns to pool (renaming ports) whilst below this size.
+ *   @note   Players taken from pool are replaced by a background thread. Ring buffers of pooled players are sized for files down to half JACK samplerate.
+ */
+void set_pool_size(unsigned int size);
+
+/** @brief  Get configured quantity of idle players to keep in pool
+ *   @retval unsigned int Pool size
+ */
+unsigned int get_pool_size();
+
+/** @brief  Get quantity of idle players currently in pool
+ *   @retval unsigned int Quantity of players available for immediate use
+ */
+unsigned int get_pool_count();
+
 /** @brief  Set the MIDI base note
  *   @param  player_handle Handle of player provided by init_player()
  *   @param  base_note MIDI note that will trigger playback at normal speed
@@ -89,6 +168,79 @@ uint8_t get_base_note(AUDIO_PLAYER* pPlayer);
  */
 void set_midi_chan(AUDIO_PLAYER* pPlayer, uint8_t midi_chan);
 
+/** @brief  Map a MIDI CC to a player parameter
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @param  cc MIDI CC number [0..127] (MSB [0..31] if 14-bit) received on player's MIDI channel
+ *   @param  param Player parameter (PLAYER_PARAM_xxx, PLAYER_PARAM_NONE to remove mapping)
+ *   @param  flags Bitwise PLAYER_CC_xxx flags
+ *   @retval uint8_t 1 on success, 0 if CC is reserved (sustain, all off) or parameters invalid
+ *   @note   CC is processed within jack process at the event's frame offset. Gain and varispeed are smoothed. Changes are reported by the notification callback.
+ */
+uint8_t set_cc_map(AUDIO_PLAYER* pPlayer, uint8_t cc, uint8_t param, uint8_t flags);
+
+/** @brief  Get player parameter mapped to a MIDI CC
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @param  cc MIDI CC number [0..127]
+ *   @retval uint8_t Player parameter (PLAYER_PARAM_xxx)
+ */
+uint8_t get_cc_map(AUDIO_PLAYER* pPlayer, uint8_t cc);
+
+/** @brief  Get flags of a MIDI CC mapping
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @param  cc MIDI CC number [0..127]
+ *   @retval uint8_t Bitwise PLAYER_CC_xxx flags
+ */
+uint8_t get_cc_flags(AUDIO_PLAYER* pPlayer, uint8_t cc);
+
+/** @brief  Remove all MIDI CC mappings from player
+ *   @param  player_handle Handle of player provided by init_player()
+ */
+void clear_cc_map(AUDIO_PLAYER* pPlayer);
+
+/** @brief  Set smoothing time of parameters controlled by MIDI CC
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @param  time Time constant in seconds (0 for no smoothing)
+ */
+void set_cc_smoothing(AUDIO_PLAYER* pPlayer, float time);
+
+/** @brief  Get smoothing time of parameters controlled by MIDI CC
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @retval float Time constant in seconds
+ */
+float get_cc_smoothing(AUDIO_PLAYER* pPlayer);
+
+/** @brief  Set best time stretch quality tier of player
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @param  tier Quality tier (STRETCH_TIER_xxx)
+ *   @note   Stretch governor may step player to cheaper tiers but not better than this and not beyond STRETCH_TIER_FAST
+ */
+void set_stretch_quality(AUDIO_PLAYER* pPlayer, uint8_t tier);
+
+/** @brief  Get best time stretch quality tier of player
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @retval uint8_t Quality tier (STRETCH_TIER_xxx)
+ */
+uint8_t get_stretch_quality(AUDIO_PLAYER* pPlayer);
+
+/** @brief  Get time stretch quality tier currently in use by player
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @retval uint8_t Quality tier (STRETCH_TIER_xxx)
+ *   @note   Changes are notified by NOTIFY_STRETCH_TIER callback
+ */
+uint8_t get_stretch_tier(AUDIO_PLAYER* pPlayer);
+
+/** @brief  Set player priority for stretch governor
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @param  priority Priority [0..255] - lower priority players are degraded first and restored last, 255 never degraded
+ */
+void set_stretch_priority(AUDIO_PLAYER* pPlayer, uint8_t priority);
+
+/** @brief  Get player priority for stretch governor
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @retval uint8_t Priority [0..255]
+ */
+uint8_t get_stretch_priority(AUDIO_PLAYER* pPlayer);
+
 /** @brief  Get player index
  *   @param  player_handle Handle of player provided by init_player()
  *   @param  index ID of the player
@@ -108,6 +260,46 @@ const char* get_jack_client_name();
  */
 uint8_t load(AUDIO_PLAYER* pPlayer, const char* filename, cb_fn_t cb_fn);
 
+/** @brief  Open audio file without waiting for it to load
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @param  filename Full path and name of file to load
+ *   @param  cb_fn Pointer to callback function with template void(float)
+ *   @retval uint8_t True if load started
+ *   @note   Completion is notified by NOTIFY_LOAD callback (value 1.0 on success, 0.0 on failure) and by signalling the eventfd provided by get_load_fd()
+ *   @note   Files are opened in parallel, limited by set_max_parallel_loads()
+ */
+uint8_t load_async(AUDIO_PLAYER* pPlayer, const char* filename, cb_fn_t cb_fn);
+
+/** @brief  Check if a file is being loaded
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @retval uint8_t True if load has not yet completed
+ */
+uint8_t is_loading(AUDIO_PLAYER* pPlayer);
+
+/** @brief  Get file descriptor signalled when any load completes
+ *   @retval int eventfd file descriptor (readable when loads have completed) or -1 if unavailable
+ *   @note   Reading the descriptor returns (and clears) the quantity of loads completed since last read
+ *   @note   Use get_load_result() to identify which players completed loading
+ */
+int get_load_fd();
+
+/** @brief  Get result of oldest completed load, removing it from queue
+ *   @param  result Pointer to populate with result of load (1 on success, 0 on failure)
+ *   @retval AUDIO_PLAYER* Handle of player that completed load or NULL if queue is empty
+ *   @note   Queue holds up to MAX_LOAD_RESULTS results, discarding oldest if not read
+ */
+AUDIO_PLAYER* get_load_result(uint8_t* result);
+
+/** @brief  Set maximum quantity of files that may be opened concurrently
+ *   @param  count Maximum quantity of concurrent loads (minimum 1)
+ */
+void set_max_parallel_loads(unsigned int count);
+
+/** @brief  Get maximum quantity of files that may be opened concurrently
+ *   @retval unsigned int Maximum quantity of concurrent loads
+ */
+unsigned int get_max_parallel_loads();
+
 /** @brief  Save audio file
  *   @param  player_handle Handle of player provided by init_player()
  *   @param  filename Full path and name of file to create or overwrite
@@ -145,6 +337,19 @@ void set_position(AUDIO_PLAYER* pPlayer, float time);
  */
 float get_position(AUDIO_PLAYER* pPlayer);
 
+/** @brief  Set playhead position with frame accuracy
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @param  frames Frames since start of file (at file samplerate)
+ *   @note   Use for long files where seconds (float) may not resolve individual frames
+ */
+void set_position_frames(AUDIO_PLAYER* pPlayer, int64_t frames);
+
+/** @brief  Get playhead position with frame accuracy
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @retval int64_t Frames since start of file (at file samplerate)
+ */
+int64_t get_position_frames(AUDIO_PLAYER* pPlayer);
+
 /** @brief  Set loop mode
  *   @param  player_handle Handle of player provided by init_player()
  *   @param  nLoop 1 to loop at end of audio, 2 to play to end (ignore MIDI note-off)
@@ -169,6 +374,18 @@ void set_loop_start_time(AUDIO_PLAYER* pPlayer, float time);
  */
 float get_loop_start_time(AUDIO_PLAYER* pPlayer);
 
+/** @brief  Set start of loop with frame accuracy
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @param  frames Start of loop in frames since start of file (at file samplerate)
+ */
+void set_loop_start_frames(AUDIO_PLAYER* pPlayer, int64_t frames);
+
+/** @brief  Get start of loop with frame accuracy
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @retval int64_t Start of loop in frames since start of file (at file samplerate)
+ */
+int64_t get_loop_start_frames(AUDIO_PLAYER* pPlayer);
+
 /** @brief  Set end of loop
  *   @param  player_handle Handle of player provided by init_player()
  *   @param  time End of loop in seconds since end of file
@@ -181,6 +398,18 @@ void set_loop_end_time(AUDIO_PLAYER* pPlayer, float time);
  */
 float get_loop_end_time(AUDIO_PLAYER* pPlayer);
 
+/** @brief  Set end of loop with frame accuracy
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @param  frames End of loop in frames since start of file (at file samplerate)
+ */
+void set_loop_end_frames(AUDIO_PLAYER* pPlayer, int64_t frames);
+
+/** @brief  Get end of loop with frame accuracy
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @retval int64_t End of loop in frames since start of file (at file samplerate)
+ */
+int64_t get_loop_end_frames(AUDIO_PLAYER* pPlayer);
+
 /** @brief  Set start of audio (crop)
  *   @param  player_handle Handle of player provided by init_player()
  *   @param  time Start of crop in seconds since start of file
@@ -193,6 +422,18 @@ void set_crop_start_time(AUDIO_PLAYER* pPlayer, float time);
  */
 float get_crop_start_time(AUDIO_PLAYER* pPlayer);
 
+/** @brief  Set start of audio (crop) with frame accuracy
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @param  frames Start of audio (crop) in frames since start of file (at file samplerate)
+ */
+void set_crop_start_frames(AUDIO_PLAYER* pPlayer, int64_t frames);
+
+/** @brief  Get start of audio (crop) with frame accuracy
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @retval int64_t Start of audio (crop) in frames since start of file (at file samplerate)
+ */
+int64_t get_crop_start_frames(AUDIO_PLAYER* pPlayer);
+
 /** @brief  Set end audio (crop)
  *   @param  player_handle Handle of player provided by init_player()
  *   @param  time End of crop in seconds since end of file
@@ -205,6 +446,18 @@ void set_crop_end_time(AUDIO_PLAYER* pPlayer, float time);
  */
 float get_crop_end_time(AUDIO_PLAYER* pPlayer);
 
+/** @brief  Set end of audio (crop) with frame accuracy
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @param  frames End of audio (crop) in frames since start of file (at file samplerate)
+ */
+void set_crop_end_frames(AUDIO_PLAYER* pPlayer, int64_t frames);
+
+/** @brief  Get end of audio (crop) with frame accuracy
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @retval int64_t End of audio (crop) in frames since start of file (at file samplerate)
+ */
+int64_t get_crop_end_frames(AUDIO_PLAYER* pPlayer);
+
 /** @brief  Add a cue marker
  *   @param  player_handle Handle of player provided by init_player()
  *   @param  position Position within file (in seconds) to add marker
@@ -213,6 +466,14 @@ float get_crop_end_time(AUDIO_PLAYER* pPlayer);
  */
 int32_t add_cue_point(AUDIO_PLAYER* pPlayer, float position, const char* name = nullptr);
 
+/** @brief  Add a cue marker with frame accuracy
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @param  frames Position within file (in frames at file samplerate) to add marker
+ *   @param  name Cue point name
+ *   @retval int32_t Index of marker or -1 on failure
+ */
+int32_t add_cue_point_frames(AUDIO_PLAYER* pPlayer, int64_t frames, const char* name = nullptr);
+
 /** @brief  Remove a cue marker
  *   @param  player_handle Handle of player provided by init_player()
  *   @param  position Position within file (in secondes) of marker to remove
@@ -234,6 +495,13 @@ uint32_t get_cue_point_count(AUDIO_PLAYER* pPlayer);
  */
 float get_cue_point_position(AUDIO_PLAYER* pPlayer, uint32_t index);
 
+/** @brief  Get a cue point's position with frame accuracy
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @param  index Index of cue point
+ *   @retval int64_t Position (in frames at file samplerate) of cue point or -1 if not found
+ */
+int64_t get_cue_point_frames(AUDIO_PLAYER* pPlayer, uint32_t index);
+
 /** @brief  Set a cue point's position
  *   @param  player_handle Handle of player provided by init_player()
  *   @param  index Index of cue point
@@ -242,6 +510,14 @@ float get_cue_point_position(AUDIO_PLAYER* pPlayer, uint32_t index);
  */
 bool set_cue_point_position(AUDIO_PLAYER* pPlayer, uint32_t index, float position);
 
+/** @brief  Set a cue point's position with frame accuracy
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @param  index Index of cue point
+ *   @param  frames Position (in frames at file samplerate) of cue point
+ *   @retval bool True on success
+ */
+bool set_cue_point_frames(AUDIO_PLAYER* pPlayer, uint32_t index, int64_t frames);
+
 /** @brief  Get a cue point's name
  *   @param  player_handle Handle of player provided by init_player()
  *   @param  index Index of cue point
@@ -292,9 +568,9 @@ int get_channels(AUDIO_PLAYER* pPlayer);
 
 /** @brief  Get quantity of frames (samples) in currently loaded file
  *   @param  player_handle Handle of player provided by init_player()
- *   @retval int Quantity of frames
+ *   @retval int64_t Quantity of frames
  */
-int get_frames(AUDIO_PLAYER* pPlayer);
+int64_t get_frames(AUDIO_PLAYER* pPlayer);
 
 /** @brief  Get format of currently loaded file
  *   @param  player_handle Handle of player provided by init_player()
@@ -532,6 +808,51 @@ void set_beats(AUDIO_PLAYER* pPlayer, uint8_t beats);
  */
 uint8_t get_beats(AUDIO_PLAYER* pPlayer);
 
+/** @brief  Add a file to the end of the player's playlist
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @param  filename Full path and name of file to play after preceding files
+ *   @retval uint8_t 1 on success
+ *   @note   The next file is opened whilst the current file plays and playback switches to it without gap at the end (crop end) of the current file
+ *   @note   Playlist is ignored whilst looping. Filename, duration, position, etc. change when playback reaches the next file, not when it is opened.
+ *   @note   Switching is notified by NOTIFY_PLAYLIST callback with the quantity of remaining playlist files
+ */
+uint8_t playlist_add(AUDIO_PLAYER* pPlayer, const char* filename);
+
+/** @brief  Remove all files from the player's playlist
+ *   @param  player_handle Handle of player provided by init_player()
+ */
+void playlist_clear(AUDIO_PLAYER* pPlayer);
+
+/** @brief  Get quantity of files remaining in the player's playlist
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @retval unsigned int Quantity of files queued after current file
+ */
+unsigned int playlist_count(AUDIO_PLAYER* pPlayer);
+
+/** @brief  Set duration of crossfade between playlist files
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @param  duration Crossfade duration in seconds (0 for gapless switch without crossfade)
+ *   @note   Limited to the duration of the SRC buffer
+ */
+void set_crossfade(AUDIO_PLAYER* pPlayer, float duration);
+
+/** @brief  Get duration of crossfade between playlist files
+ *   @param  player_handle Handle of player provided by init_player()
+ *   @retval float Crossfade duration in seconds
+ */
+float get_crossfade(AUDIO_PLAYER* pPlayer);
+
+/** @brief  Set quantity of beats in each bar
+ *   @param  beats Quantity of beats per bar (0 to disable bar alignment)
+ *   @note   Tempo synced files (beats > 0) are padded with silence to a whole quantity of bars before switching to the next playlist file
+ */
+void set_beats_per_bar(uint8_t beats);
+
+/** @brief  Get quantity of beats in each bar
+ *   @retval uint8_t Quantity of beats per bar
+ */
+uint8_t get_beats_per_bar();
+
 /** @brief  Set tempo for loop play
  *   @param  tempo Tempo in beats per minute
  */
@@ -539,6 +860,48 @@ void set_tempo(float tempo);
 
 /**** Global functions ****/
 
+/** @brief  Enable stretch governor
+ *   @param  enable 1 to enable, 0 to disable (and restore all players to their best quality tier)
+ *   @note   Governor monitors jack DSP load, stepping playing players to cheaper stretch tiers when load exceeds the high threshold and back when below the low threshold
+ *   @note   Governor does not select STRETCH_TIER_RESAMPLE, which changes pitch with speed. It is disabled by default.
+ */
+void enable_stretch_governor(int enable);
+
+/** @brief  Check if stretch governor is enabled
+ *   @retval int 1 if enabled
+ */
+int is_stretch_governor_enabled();
+
+/** @brief  Set stretch governor DSP load thresholds
+ *   @param  low DSP load (percent) below which players are stepped to better tiers
+ *   @param  high DSP load (percent) above which players are stepped to cheaper tiers
+ */
+void set_stretch_governor_thresholds(float low, float high);
+
+/** @brief  Get smoothed DSP load measured by stretch governor
+ *   @retval float DSP load in percent
+ */
+float get_stretch_governor_load();
+
+/** @brief  Get monitor region
+ *   @retval monitor_region* Pointer to region containing playhead, state and output envelope of each player
+ *   @note   Region is also published as POSIX shared memory for other processes (see get_monitor_name)
+ *   @note   Updated each jack period. Readers must use the seqlock of each slot rather than library calls.
+ */
+monitor_region* get_monitor_region();
+
+/** @brief  Get name of shared memory object containing monitor region
+ *   @retval const char* POSIX shared memory name (MONITOR_SHM_PREFIX.<pid>) or empty string if region is private to this process
+ *   @note   Name is unique to each instance of the library so several processes may publish monitor feeds
+ */
+const char* get_monitor_name();
+
+/** @brief  Get index of player's slot in monitor region
+ *   @param  pPlayer Pointer to player
+ *   @retval int Slot index or -1 if player has no slot (more than MONITOR_PLAYERS players)
+ */
+int get_monitor_slot(AUDIO_PLAYER* pPlayer);
+
 /** @brief  Enable debug output
  *   @param  bEnable True to enable, false to disable
  */
@@ -569,6 +932,32 @@ const char* get_file_info(const char* filename, int type);
  */
 unsigned int get_player_count();
 
+// ** Capture and replay **
+
+/** @brief  Start capturing jack process inputs to a log that may be replayed offline to reproduce a problem
+ *   @param  filename Full path and filename of log
+ *   @retval bool True on success, false if no JACK client, already capturing, a player is playing or file cannot be written
+ *   @note   Records a snapshot of each player, MIDI input and audio consumed from the file reader at the start of each period with a hash of each
+ *           period's audio output and player state. Stretchers are reset to a known state at the start of capture and whenever they are reset.
+ */
+bool startCapture(const char* filename);
+
+/** @brief  Stop capturing process inputs, flushing log to file
+ */
+void stopCapture();
+
+/** @brief  Check if capturing process inputs
+ *   @retval bool True if capturing
+ */
+bool isCapturing();
+
+/** @brief  Replay a capture log offline and compare outputs bit-for-bit with those captured
+ *   @param  filename Full path and filename of log
+ *   @retval int32_t Index of first period whose output differs, -1 if all outputs match, -2 if log cannot be replayed
+ *   @note   Must run in a process that has not added a player (no JACK client)
+ */
+int32_t replayCapture(const char* filename);
+
 #ifdef __cplusplus
 }
 #endif
@@ -4,18 +4,54 @@
 # Tests use two letters to define order of groups and two digit integer to define order within group
 
 import unittest
+import ctypes
 import jack
-from time import sleep
+import math
+import mmap
+import os
+import select
+import struct
+import subprocess
+import sys
+import wave
+from time import sleep, monotonic
 
+sys.path.append(os.path.realpath(os.path.join(os.path.dirname(__file__), "..", "..")))  # provides zynlibs.rtmonitor
 import zynaudioplayer
 
 client = jack.Client("zynaudioplayer_unittest")
 
 STOPPED = 0
-STARTING = 1
-PLAYING = 2
+PLAYING = 1
+STARTING = 2
 STOPPING = 3
 
+STRETCH_TIER_FULL = 0
+STRETCH_TIER_FAST = 2
+STRETCH_TIER_RESAMPLE = 3
+
+
+# Write a 16-bit sine wave file
+def write_wav(filename, duration, channels, samplerate):
+    with wave.open(filename, "wb") as wav:
+        wav.setnchannels(channels)
+        wav.setsampwidth(2)
+        wav.setframerate(samplerate)
+        frames = bytearray()
+        for i in range(int(duration * samplerate)):
+            frames += struct.pack("<h", int(8000 * math.sin(i * 0.05))) * channels
+        wav.writeframes(frames)
+
+
+# Wait for a condition to be true
+def wait_for(condition, timeout):
+    end = monotonic() + timeout
+    while not condition():
+        if monotonic() > end:
+            return False
+        sleep(0.005)
+    return True
+
 
 class TestLibZynAudioPlayer(unittest.TestCase):
     @classmethod
@@ -59,4 +95,223 @@ class TestLibZynAudioPlayer(unittest.TestCase):
         self.assertEqual(libaudioplayer.getFormat(), 0x010000 | 0x0002)
 
 
+    def test_aa06_pool(self):
+        zynaudioplayer.set_pool_size(2)
+        self.assertEqual(zynaudioplayer.get_pool_count(), 2)
+        # Player taken from pool is replaced in background
+        handle = zynaudioplayer.add_player()
+        sleep(0.5)
+        self.assertEqual(zynaudioplayer.get_pool_count(), 2)
+        # Pool is full so removed player is freed
+        zynaudioplayer.remove_player(handle)
+        self.assertEqual(zynaudioplayer.get_pool_count(), 2)
+        zynaudioplayer.set_pool_size(0)
+        self.assertEqual(zynaudioplayer.get_pool_count(), 0)
+
+    def test_aa07_load_results(self):
+        write_wav("/tmp/test_load_a.wav", 0.5, 2, 44100)
+        write_wav("/tmp/test_load_b.wav", 0.5, 1, 22050)
+        zynaudioplayer.get_load_results()  # Discard results of previous tests
+        handles = [zynaudioplayer.add_player() for i in range(3)]
+        self.assertTrue(zynaudioplayer.load_async(handles[0], "/tmp/test_load_a.wav"))
+        self.assertTrue(zynaudioplayer.load_async(handles[1], "/tmp/test_load_missing.wav"))
+        self.assertTrue(zynaudioplayer.load_async(handles[2], "/tmp/test_load_b.wav"))
+        # Each completed load is reported with its player handle
+        results = {}
+        fd = zynaudioplayer.get_load_fd()
+        self.assertGreaterEqual(fd, 0)
+        end = monotonic() + 2.0
+        while len(results) < 3 and monotonic() < end:
+            select.select([fd], [], [], 0.1)
+            try:
+                os.read(fd, 8)
+            except BlockingIOError:
+                pass
+            results.update(zynaudioplayer.get_load_results())
+        self.assertEqual(results, {handles[0]: True, handles[1]: False, handles[2]: True})
+        # Results of removed player are discarded
+        self.assertTrue(zynaudioplayer.load_async(handles[0], "/tmp/test_load_b.wav"))
+        self.assertTrue(wait_for(lambda: not zynaudioplayer.is_loading(handles[0]), 2.0))
+        for handle in handles:
+            zynaudioplayer.remove_player(handle)
+        self.assertEqual(zynaudioplayer.get_load_results(), [])
+
+    def test_ab00_capture(self):
+        handle = zynaudioplayer.add_player()
+        self.assertTrue(zynaudioplayer.load(handle, "./test.wav"))
+        self.assertTrue(zynaudioplayer.start_capture("/tmp/test_audioplayer_capture.zcap"))
+        self.assertTrue(zynaudioplayer.is_capturing())
+        self.assertFalse(zynaudioplayer.start_capture("/tmp/test_audioplayer_capture.zcap"))
+        zynaudioplayer.set_speed(handle, 1.5)
+        zynaudioplayer.start_playback(handle)
+        sleep(0.5)
+        zynaudioplayer.set_varispeed(handle, 0.5)
+        sleep(0.5)
+        zynaudioplayer.stop_playback(handle)
+        sleep(0.2)
+        zynaudioplayer.stop_capture()
+        self.assertFalse(zynaudioplayer.is_capturing())
+        # Replay must run in a process without a JACK client
+        self.assertEqual(zynaudioplayer.replay_capture("/tmp/test_audioplayer_capture.zcap"), -2)
+        zynaudioplayer.remove_player(handle)
+        replay = subprocess.run([sys.executable, "-c",
+                                 "import ctypes; lib = ctypes.cdll.LoadLibrary('/zynthian/zynthian-ui/zynlibs/zynaudioplayer/build/libzynaudioplayer.so'); "
+                                 "lib.replayCapture.restype = ctypes.c_int32; print(lib.replayCapture(b'/tmp/test_audioplayer_capture.zcap'))"],
+                                capture_output=True, text=True, timeout=60)
+        self.assertEqual(replay.stdout.strip(), "-1", replay.stderr)
+
+
+    def test_ac00_playlist_switch(self):
+        write_wav("/tmp/test_playlist_a.wav", 2.0, 2, 44100)
+        write_wav("/tmp/test_playlist_b.wav", 0.5, 1, 22050)
+        handle = zynaudioplayer.add_player()
+        self.assertTrue(zynaudioplayer.load(handle, "/tmp/test_playlist_a.wav"))
+        zynaudioplayer.enable_loop(handle, False)
+        self.assertTrue(zynaudioplayer.playlist_add(handle, "/tmp/test_playlist_b.wav"))
+        start = monotonic()
+        zynaudioplayer.start_playback(handle)
+        # File reader switches to next file in advance of playback
+        self.assertTrue(wait_for(lambda: zynaudioplayer.playlist_count(handle) == 0, 2.0))
+        self.assertLess(monotonic() - start, 1.8)
+        # Metadata remains that of the file being heard until playback reaches next file
+        self.assertEqual(zynaudioplayer.get_filename(handle), "/tmp/test_playlist_a.wav")
+        self.assertAlmostEqual(zynaudioplayer.get_duration(handle), 2.0, 2)
+        self.assertEqual(zynaudioplayer.get_samplerate(handle), 44100)
+        self.assertEqual(zynaudioplayer.get_channels(handle), 2)
+        self.assertTrue(wait_for(lambda: zynaudioplayer.get_filename(handle) == "/tmp/test_playlist_b.wav", 2.0))
+        self.assertGreater(monotonic() - start, 1.9)
+        self.assertAlmostEqual(zynaudioplayer.get_duration(handle), 0.5, 2)
+        self.assertEqual(zynaudioplayer.get_samplerate(handle), 22050)
+        self.assertEqual(zynaudioplayer.get_channels(handle), 1)
+        self.assertEqual(zynaudioplayer.get_playback_state(handle), PLAYING)
+        self.assertLess(zynaudioplayer.get_position(handle), 0.1)
+        # Playback ends at end of last file
+        self.assertTrue(wait_for(lambda: zynaudioplayer.get_playback_state(handle) == STOPPED, 1.0))
+        self.assertEqual(zynaudioplayer.get_filename(handle), "/tmp/test_playlist_b.wav")
+        zynaudioplayer.remove_player(handle)
+
+    def test_ac01_playlist_short_files(self):
+        # Each file shorter than the ring buffer is still reached in turn
+        write_wav("/tmp/test_playlist_a.wav", 0.5, 2, 44100)
+        write_wav("/tmp/test_playlist_b.wav", 0.2, 1, 22050)
+        write_wav("/tmp/test_playlist_c.wav", 0.2, 2, 48000)
+        handle = zynaudioplayer.add_player()
+        self.assertTrue(zynaudioplayer.load(handle, "/tmp/test_playlist_a.wav"))
+        zynaudioplayer.enable_loop(handle, False)
+        self.assertTrue(zynaudioplayer.playlist_add(handle, "/tmp/test_playlist_b.wav"))
+        self.assertTrue(zynaudioplayer.playlist_add(handle, "/tmp/test_playlist_c.wav"))
+        zynaudioplayer.start_playback(handle)
+        self.assertTrue(wait_for(lambda: zynaudioplayer.get_filename(handle) == "/tmp/test_playlist_b.wav", 1.0))
+        self.assertEqual(zynaudioplayer.get_samplerate(handle), 22050)
+        self.assertTrue(wait_for(lambda: zynaudioplayer.get_filename(handle) == "/tmp/test_playlist_c.wav", 1.0))
+        self.assertEqual(zynaudioplayer.get_samplerate(handle), 48000)
+        self.assertTrue(wait_for(lambda: zynaudioplayer.get_playback_state(handle) == STOPPED, 1.0))
+        zynaudioplayer.remove_player(handle)
+
+    def test_ad00_stretch_governor(self):
+        write_wav("/tmp/test_governor.wav", 10.0, 2, 44100)
+        handle = zynaudioplayer.add_player()
+        self.assertTrue(zynaudioplayer.load(handle, "/tmp/test_governor.wav"))
+        zynaudioplayer.set_stretch_priority(handle, 10)
+        self.assertEqual(zynaudioplayer.get_stretch_priority(handle), 10)
+        zynaudioplayer.start_playback(handle)
+        # Any DSP load exceeds thresholds so governor steps down but not to resample tier which changes pitch
+        zynaudioplayer.set_stretch_governor_thresholds(0.0, 0.001)
+        zynaudioplayer.enable_stretch_governor(True)
+        self.assertTrue(wait_for(lambda: zynaudioplayer.get_stretch_tier(handle) == STRETCH_TIER_FAST, 3.0))
+        sleep(1.0)
+        self.assertEqual(zynaudioplayer.get_stretch_tier(handle), STRETCH_TIER_FAST)
+        # Highest priority is never degraded
+        zynaudioplayer.set_stretch_priority(handle, 255)
+        self.assertTrue(wait_for(lambda: zynaudioplayer.get_stretch_tier(handle) == STRETCH_TIER_FULL, 1.0))
+        # User may select resample tier
+        zynaudioplayer.set_stretch_quality(handle, STRETCH_TIER_RESAMPLE)
+        self.assertTrue(wait_for(lambda: zynaudioplayer.get_stretch_tier(handle) == STRETCH_TIER_RESAMPLE, 1.0))
+        zynaudioplayer.set_stretch_quality(handle, STRETCH_TIER_FULL)
+        zynaudioplayer.set_stretch_priority(handle, 128)
+        # Disabling governor restores best quality
+        zynaudioplayer.enable_stretch_governor(False)
+        self.assertTrue(wait_for(lambda: zynaudioplayer.get_stretch_tier(handle) == STRETCH_TIER_FULL, 1.0))
+        zynaudioplayer.set_stretch_governor_thresholds(50.0, 80.0)
+        zynaudioplayer.stop_playback(handle)
+        zynaudioplayer.remove_player(handle)
+
+    def test_ae00_monitor(self):
+        write_wav("/tmp/test_monitor.wav", 3.0, 2, 44100)
+        handle = zynaudioplayer.add_player()
+        self.assertTrue(zynaudioplayer.load(handle, "/tmp/test_monitor.wav"))
+        slot = zynaudioplayer.get_monitor_slot(handle)
+        self.assertGreaterEqual(slot, 0)
+        zynaudioplayer.start_playback(handle)
+        # Every copy read whilst jack process writes the slot is consistent
+        reads = 0
+        last_position = 0.0
+        last_count = 0
+        end = monotonic() + 1.0
+        while monotonic() < end:
+            mon = zynaudioplayer.read_monitor(slot)
+            if mon is None:
+                continue
+            reads += 1
+            self.assertEqual(mon.seq & 1, 0)
+            self.assertEqual(mon.index, zynaudioplayer.get_index(handle))
+            self.assertEqual(mon.file_open, zynaudioplayer.FILE_OPEN)
+            self.assertAlmostEqual(mon.duration, 3.0, 2)
+            self.assertGreaterEqual(mon.position, last_position)
+            self.assertLessEqual(mon.position, mon.duration)
+            self.assertGreaterEqual(mon.envelope_count, last_count)
+            last_position = mon.position
+            last_count = mon.envelope_count
+        self.assertGreater(reads, 100)
+        self.assertGreater(last_position, 0.5)
+        self.assertGreater(last_count, zynaudioplayer.MONITOR_ENVELOPE)
+        envelope = zynaudioplayer.get_monitor_envelope(mon)
+        self.assertEqual(len(envelope), zynaudioplayer.MONITOR_ENVELOPE)
+        for peak_a, peak_b, rms_a, rms_b in envelope[-25:]:
+            self.assertGreater(peak_a, 0.1)
+            self.assertLessEqual(rms_a, peak_a)
+        # Region is published to other processes under a name unique to this instance
+        name = zynaudioplayer.get_monitor_name()
+        self.assertEqual(name, f"/zynaudioplayer.{os.getpid()}")
+        with open("/dev/shm" + name, "rb") as f:
+            shm = mmap.mmap(f.fileno(), ctypes.sizeof(zynaudioplayer.MonitorRegion), prot=mmap.PROT_READ)
+            version, players = struct.unpack_from("<II", shm, 0)
+            shm.close()
+        self.assertEqual(version, 1)
+        self.assertEqual(players, zynaudioplayer.MONITOR_PLAYERS)
+        zynaudioplayer.stop_playback(handle)
+        zynaudioplayer.remove_player(handle)
+
+    def test_af00_marker_frames(self):
+        write_wav("/tmp/test_markers.wav", 2.0, 2, 44100)
+        handle = zynaudioplayer.add_player()
+        self.assertTrue(zynaudioplayer.load(handle, "/tmp/test_markers.wav"))
+        # Markers set in frames are exact (not rounded through float seconds)
+        zynaudioplayer.set_crop_start_frames(handle, 1001)
+        zynaudioplayer.set_crop_end_frames(handle, 80001)
+        zynaudioplayer.set_loop_start_frames(handle, 2003)
+        zynaudioplayer.set_loop_end_frames(handle, 70007)
+        self.assertEqual(zynaudioplayer.get_crop_start_frames(handle), 1001)
+        self.assertEqual(zynaudioplayer.get_crop_end_frames(handle), 80001)
+        self.assertEqual(zynaudioplayer.get_loop_start_frames(handle), 2003)
+        self.assertEqual(zynaudioplayer.get_loop_end_frames(handle), 70007)
+        self.assertAlmostEqual(zynaudioplayer.get_loop_start(handle), 2003 / 44100, 5)
+        # Markers are limited by crop and each other
+        zynaudioplayer.set_loop_end_frames(handle, 90000)
+        self.assertEqual(zynaudioplayer.get_loop_end_frames(handle), 80001)
+        zynaudioplayer.set_loop_start_frames(handle, 0)
+        self.assertEqual(zynaudioplayer.get_loop_start_frames(handle), 1001)
+        # Cue points
+        zynaudioplayer.clear_cue_points(handle)
+        self.assertEqual(zynaudioplayer.add_cue_point_frames(handle, 44101, "b"), 0)
+        self.assertEqual(zynaudioplayer.add_cue_point_frames(handle, 44099, "a"), 0)
+        self.assertEqual(zynaudioplayer.add_cue_point_frames(handle, 44099), -1)
+        self.assertEqual(zynaudioplayer.add_cue_point_frames(handle, 88200), -1)
+        self.assertEqual(zynaudioplayer.get_cue_point_frames(handle, 1), 44101)
+        self.assertTrue(zynaudioplayer.set_cue_point_frames(handle, 1, 44102))
+        self.assertEqual(zynaudioplayer.get_cue_point_frames(handle, 1), 44102)
+        self.assertEqual(zynaudioplayer.get_cue_point_frames(handle, 2), -1)
+        zynaudioplayer.remove_player(handle)
+
+
 unittest.main()
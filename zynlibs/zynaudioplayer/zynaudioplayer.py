@@ -29,6 +29,8 @@ import logging
 from _ctypes import dlclose
 from os.path import dirname, realpath
 
+from zynlibs.rtmonitor import rtmonitor
+
 # -------------------------------------------------------------------------------
 # Zynthian audio file player Library Wrapper
 #
@@ -43,6 +45,67 @@ from os.path import dirname, realpath
 
 control_cb = None
 
+NOTIFY_LOAD = 24
+NOTIFY_PLAYLIST = 25
+NOTIFY_STRETCH_TIER = 26
+
+STRETCH_TIER_FULL = 0
+STRETCH_TIER_STANDARD = 1
+STRETCH_TIER_FAST = 2
+STRETCH_TIER_RESAMPLE = 3
+
+PLAYER_PARAM_NONE = 0
+PLAYER_PARAM_GAIN = 1
+PLAYER_PARAM_VARISPEED = 2
+PLAYER_PARAM_POSITION = 3
+PLAYER_PARAM_JOG = 4
+PLAYER_PARAM_LOOP_START = 5
+PLAYER_PARAM_LOOP_END = 6
+
+PLAYER_CC_14BIT = 0x01
+
+FILE_CLOSED = 0
+FILE_OPENING = 1
+FILE_OPEN = 2
+
+MONITOR_PLAYERS = 32
+MONITOR_ENVELOPE = 64
+
+
+# Player slot of monitor region (mirrors monitor_player in player.h)
+class MonitorPlayer(ctypes.Structure):
+    _fields_ = [
+        ("seq", ctypes.c_uint32),
+        ("index", ctypes.c_uint32),
+        ("play_state", ctypes.c_uint8),
+        ("file_open", ctypes.c_uint8),
+        ("loop", ctypes.c_uint8),
+        ("reserved", ctypes.c_uint8),
+        ("position", ctypes.c_float),
+        ("duration", ctypes.c_float),
+        ("varispeed", ctypes.c_float),
+        ("position_frames", ctypes.c_int64),
+        ("envelope_count", ctypes.c_uint32),
+        ("peak_a", ctypes.c_float * MONITOR_ENVELOPE),
+        ("peak_b", ctypes.c_float * MONITOR_ENVELOPE),
+        ("rms_a", ctypes.c_float * MONITOR_ENVELOPE),
+        ("rms_b", ctypes.c_float * MONITOR_ENVELOPE)
+    ]
+
+
+# Monitor region published by library (mirrors monitor_region in player.h)
+class MonitorRegion(ctypes.Structure):
+    _fields_ = [
+        ("version", ctypes.c_uint32),
+        ("players", ctypes.c_uint32),
+        ("envelope_points", ctypes.c_uint32),
+        ("envelope_period", ctypes.c_float),
+        ("player", MonitorPlayer * MONITOR_PLAYERS)
+    ]
+
+
+monitor = None
+
 try:
     # Load or increment ref to lib
     libaudioplayer = ctypes.cdll.LoadLibrary(
@@ -51,10 +114,16 @@ try:
     libaudioplayer.get_base_note.restype = ctypes.c_uint8
     libaudioplayer.get_duration.restype = ctypes.c_float
     libaudioplayer.get_position.restype = ctypes.c_float
+    libaudioplayer.get_position_frames.restype = ctypes.c_int64
+    libaudioplayer.get_frames.restype = ctypes.c_int64
     libaudioplayer.get_loop_start_time.restype = ctypes.c_float
     libaudioplayer.get_loop_end_time.restype = ctypes.c_float
     libaudioplayer.get_crop_start_time.restype = ctypes.c_float
     libaudioplayer.get_crop_end_time.restype = ctypes.c_float
+    libaudioplayer.get_loop_start_frames.restype = ctypes.c_int64
+    libaudioplayer.get_loop_end_frames.restype = ctypes.c_int64
+    libaudioplayer.get_crop_start_frames.restype = ctypes.c_int64
+    libaudioplayer.get_crop_end_frames.restype = ctypes.c_int64
     libaudioplayer.get_file_duration.restype = ctypes.c_float
     libaudioplayer.get_env_attack.restype = ctypes.c_float
     libaudioplayer.get_env_hold.restype = ctypes.c_float
@@ -66,10 +135,14 @@ try:
     libaudioplayer.get_supported_codecs.restype = ctypes.c_char_p
     libaudioplayer.get_jack_client_name.restype = ctypes.c_char_p
     libaudioplayer.get_gain.restype = ctypes.c_float
+    libaudioplayer.get_crossfade.restype = ctypes.c_float
     libaudioplayer.add_player.restype = ctypes.c_void_p
     libaudioplayer.get_cue_point_position.restype = ctypes.c_float
     libaudioplayer.set_cue_point_position.restype = ctypes.c_bool
     libaudioplayer.add_cue_point.restype = ctypes.c_int32
+    libaudioplayer.add_cue_point_frames.restype = ctypes.c_int32
+    libaudioplayer.get_cue_point_frames.restype = ctypes.c_int64
+    libaudioplayer.set_cue_point_frames.restype = ctypes.c_bool
     libaudioplayer.remove_cue_point.restype = ctypes.c_int32
     libaudioplayer.get_cue_point_count.restype = ctypes.c_uint32
     libaudioplayer.get_cue_point_name.restype = ctypes.c_char_p
@@ -80,6 +153,30 @@ try:
     libaudioplayer.get_pitch.restype = ctypes.c_float
     libaudioplayer.get_varispeed.restype = ctypes.c_float
     libaudioplayer.is_loop.restype = ctypes.c_uint8
+    libaudioplayer.load_async.restype = ctypes.c_uint8
+    libaudioplayer.is_loading.restype = ctypes.c_uint8
+    libaudioplayer.get_load_result.restype = ctypes.c_void_p
+    libaudioplayer.get_max_parallel_loads.restype = ctypes.c_uint
+    libaudioplayer.playlist_add.restype = ctypes.c_uint8
+    libaudioplayer.playlist_count.restype = ctypes.c_uint
+    libaudioplayer.set_cc_map.restype = ctypes.c_uint8
+    libaudioplayer.get_cc_map.restype = ctypes.c_uint8
+    libaudioplayer.get_cc_flags.restype = ctypes.c_uint8
+    libaudioplayer.get_cc_smoothing.restype = ctypes.c_float
+    libaudioplayer.get_stretch_quality.restype = ctypes.c_uint8
+    libaudioplayer.get_stretch_tier.restype = ctypes.c_uint8
+    libaudioplayer.get_stretch_priority.restype = ctypes.c_uint8
+    libaudioplayer.get_stretch_governor_load.restype = ctypes.c_float
+    libaudioplayer.get_monitor_region.restype = ctypes.c_void_p
+    libaudioplayer.get_monitor_slot.restype = ctypes.c_int
+    libaudioplayer.get_monitor_name.restype = ctypes.c_char_p
+    libaudioplayer.startCapture.argtypes = [ctypes.c_char_p]
+    libaudioplayer.startCapture.restype = ctypes.c_bool
+    libaudioplayer.isCapturing.restype = ctypes.c_bool
+    libaudioplayer.replayCapture.argtypes = [ctypes.c_char_p]
+    libaudioplayer.replayCapture.restype = ctypes.c_int32
+    if libaudioplayer.get_monitor_region():
+        monitor = MonitorRegion.from_address(libaudioplayer.get_monitor_region())
 
 except Exception as e:
     libaudioplayer = None
@@ -110,6 +207,22 @@ def add_player():
     return libaudioplayer.add_player()
 
 
+# Set quantity of prewarmed players to keep in pool
+# size: Quantity of idle players (ports registered, buffers allocated) ready for add_player
+def set_pool_size(size):
+    libaudioplayer.set_pool_size(ctypes.c_uint(size))
+
+
+# Get configured quantity of prewarmed players
+def get_pool_size():
+    return libaudioplayer.get_pool_size()
+
+
+# Get quantity of prewarmed players currently in pool
+def get_pool_count():
+    return libaudioplayer.get_pool_count()
+
+
 # Remove a player
 def remove_player(handle):
     return libaudioplayer.remove_player(ctypes.c_void_p(handle))
@@ -157,6 +270,45 @@ def load(handle, filename):
     return libaudioplayer.load(ctypes.c_void_p(handle), bytes(filename, "utf-8"), value_cb)
 
 
+# Load an audio file without waiting for it to open
+# handle: Index of player
+# filename: Full path and filename
+# Returns: True if load started. Result is notified to control callback with id NOTIFY_LOAD (1.0 on success, 0.0 on failure)
+def load_async(handle, filename):
+    return libaudioplayer.load_async(ctypes.c_void_p(handle), bytes(filename, "utf-8"), value_cb) == 1
+
+
+# Check if a player is loading a file
+# handle: Index of player
+# Returns: True if load has not completed
+def is_loading(handle):
+    return libaudioplayer.is_loading(ctypes.c_void_p(handle)) == 1
+
+
+# Get file descriptor that becomes readable when loads complete (for use with select / poll)
+# Returns: eventfd file descriptor or -1 if not available
+def get_load_fd():
+    return libaudioplayer.get_load_fd()
+
+
+# Get results of completed loads (read after load file descriptor is signalled)
+# Returns: List of (handle, success) in order of completion
+def get_load_results():
+    results = []
+    result = ctypes.c_uint8(0)
+    while True:
+        handle = libaudioplayer.get_load_result(ctypes.byref(result))
+        if not handle:
+            return results
+        results.append((handle, result.value == 1))
+
+
+# Set maximum quantity of files that may be opened concurrently
+# count: Maximum quantity of parallel loads
+def set_max_parallel_loads(count):
+    libaudioplayer.set_max_parallel_loads(ctypes.c_uint(count))
+
+
 # Unload the currently loaded audio file
 # handle: Index of player
 def unload(handle):
@@ -210,6 +362,20 @@ def get_position(handle):
     return libaudioplayer.get_position(ctypes.c_void_p(handle))
 
 
+# Set playhead position with frame accuracy (for long files)
+# handle: Index of player
+# frames: Frames since start of file
+def set_position_frames(handle, frames):
+    libaudioplayer.set_position_frames(ctypes.c_void_p(handle), ctypes.c_int64(frames))
+
+
+# Get playhead position with frame accuracy (for long files)
+# handle: Index of player
+# Returns: Frames since start of file
+def get_position_frames(handle):
+    return libaudioplayer.get_position_frames(ctypes.c_void_p(handle))
+
+
 # Enable looping of playback
 # handle: Index of player
 # enable: True to enable looping
@@ -239,6 +405,20 @@ def set_loop_start(handle, time):
         ctypes.c_void_p(handle), ctypes.c_float(time))
 
 
+# Get start of loop with frame accuracy (for long files)
+# handle: Index of player
+# Returns: Frames since start of file
+def get_loop_start_frames(handle):
+    return libaudioplayer.get_loop_start_frames(ctypes.c_void_p(handle))
+
+
+# Set start of loop with frame accuracy (for long files)
+# handle: Index of player
+# frames: Frames since start of file
+def set_loop_start_frames(handle, frames):
+    libaudioplayer.set_loop_start_frames(ctypes.c_void_p(handle), ctypes.c_int64(frames))
+
+
 # Get end of loop in seconds from end of file
 # handle: Index of player
 # Returns: Loop end
@@ -254,6 +434,20 @@ def set_loop_end(handle, time):
         ctypes.c_void_p(handle), ctypes.c_float(time))
 
 
+# Get end of loop with frame accuracy (for long files)
+# handle: Index of player
+# Returns: Frames since start of file
+def get_loop_end_frames(handle):
+    return libaudioplayer.get_loop_end_frames(ctypes.c_void_p(handle))
+
+
+# Set end of loop with frame accuracy (for long files)
+# handle: Index of player
+# frames: Frames since start of file
+def set_loop_end_frames(handle, frames):
+    libaudioplayer.set_loop_end_frames(ctypes.c_void_p(handle), ctypes.c_int64(frames))
+
+
 # Get start of audio (crop) in seconds from start of file
 # handle: Index of player
 # Returns: Crop start
@@ -269,6 +463,20 @@ def set_crop_start(handle, time):
         ctypes.c_void_p(handle), ctypes.c_float(time))
 
 
+# Get start of audio (crop) with frame accuracy (for long files)
+# handle: Index of player
+# Returns: Frames since start of file
+def get_crop_start_frames(handle):
+    return libaudioplayer.get_crop_start_frames(ctypes.c_void_p(handle))
+
+
+# Set start of audio (crop) with frame accuracy (for long files)
+# handle: Index of player
+# frames: Frames since start of file
+def set_crop_start_frames(handle, frames):
+    libaudioplayer.set_crop_start_frames(ctypes.c_void_p(handle), ctypes.c_int64(frames))
+
+
 # Get end of audio (crop) in seconds from end of file
 # handle: Index of player
 # Returns: Crop end
@@ -284,6 +492,20 @@ def set_crop_end(handle, time):
         ctypes.c_void_p(handle), ctypes.c_floattime)
 
 
+# Get end of audio (crop) with frame accuracy (for long files)
+# handle: Index of player
+# Returns: Frames since start of file
+def get_crop_end_frames(handle):
+    return libaudioplayer.get_crop_end_frames(ctypes.c_void_p(handle))
+
+
+# Set end of audio (crop) with frame accuracy (for long files)
+# handle: Index of player
+# frames: Frames since start of file
+def set_crop_end_frames(handle, frames):
+    libaudioplayer.set_crop_end_frames(ctypes.c_void_p(handle), ctypes.c_int64(frames))
+
+
 # Add a cue point marker
 # handle: Index of player
 # pos: Marker position in seconds
@@ -295,6 +517,17 @@ def add_cue_point(handle, pos, name=None):
     return libaudioplayer.add_cue_point(ctypes.c_void_p(handle), ctypes.c_float(pos), ctypes.c_char_p(bytes(name, "utf-8")))
 
 
+# Add a cue point marker with frame accuracy (for long files)
+# handle: Index of player
+# frames: Marker position in frames since start of file
+# name: Marker name (max 255 chars)
+# Returns: Index of cue point or -1 on failure
+def add_cue_point_frames(handle, frames, name=None):
+    if name is None:
+        name = ""
+    return libaudioplayer.add_cue_point_frames(ctypes.c_void_p(handle), ctypes.c_int64(frames), ctypes.c_char_p(bytes(name, "utf-8")))
+
+
 # Remove a cue point marker
 # handle: Index of player
 # frames: Marker position in frames
@@ -327,6 +560,23 @@ def set_cue_point_position(handle, index, position):
     return libaudioplayer.set_cue_point_position(ctypes.c_void_p(handle), ctypes.c_uint32(index), ctypes.c_float(position))
 
 
+# Get a cue point's position with frame accuracy (for long files)
+# handle: Index of player
+# index Index of cue point
+# Returns: Position (in frames) of cue point or -1 if not found
+def get_cue_point_frames(handle, index):
+    return libaudioplayer.get_cue_point_frames(ctypes.c_void_p(handle), ctypes.c_uint32(index))
+
+
+# Set a cue point's position with frame accuracy (for long files)
+# handle: Index of player
+# index Index of cue point
+# frames: Position (in frames) of cue point
+# Returns: True on success
+def set_cue_point_frames(handle, index, frames):
+    return libaudioplayer.set_cue_point_frames(ctypes.c_void_p(handle), ctypes.c_uint32(index), ctypes.c_int64(frames))
+
+
 # Get a cue point's name
 # handle: Index of player
 # index Index of cue point
@@ -597,6 +847,45 @@ def get_release(handle):
     return libaudioplayer.get_env_release(ctypes.c_void_p(handle))
 
 
+# Map a MIDI CC (received on player's MIDI channel) to a player parameter, processed within jack process
+# handle: Index of player
+# cc: MIDI CC number (MSB 0..31 if 14-bit)
+# param: Player parameter (PLAYER_PARAM_xxx) or PLAYER_PARAM_NONE to remove mapping
+# flags: Bitwise PLAYER_CC_xxx flags
+# Returns: True on success. Changes are reported to control callback.
+def set_cc_map(handle, cc, param, flags=0):
+    return libaudioplayer.set_cc_map(ctypes.c_void_p(handle), ctypes.c_uint8(cc), ctypes.c_uint8(param), ctypes.c_uint8(flags)) == 1
+
+
+# Get player parameter mapped to a MIDI CC
+# handle: Index of player
+# cc: MIDI CC number
+# Returns: Tuple (param, flags)
+def get_cc_map(handle, cc):
+    return (libaudioplayer.get_cc_map(ctypes.c_void_p(handle), ctypes.c_uint8(cc)),
+            libaudioplayer.get_cc_flags(ctypes.c_void_p(handle), ctypes.c_uint8(cc)))
+
+
+# Remove all MIDI CC mappings from player
+# handle: Index of player
+def clear_cc_map(handle):
+    libaudioplayer.clear_cc_map(ctypes.c_void_p(handle))
+
+
+# Set smoothing time of parameters controlled by MIDI CC
+# handle: Index of player
+# time: Time constant in seconds (0 for no smoothing)
+def set_cc_smoothing(handle, time):
+    libaudioplayer.set_cc_smoothing(ctypes.c_void_p(handle), ctypes.c_float(time))
+
+
+# Get smoothing time of parameters controlled by MIDI CC
+# handle: Index of player
+# Returns: Time constant in seconds
+def get_cc_smoothing(handle):
+    return libaudioplayer.get_cc_smoothing(ctypes.c_void_p(handle))
+
+
 # Set beats in clip
 # handle: Index of player
 # beats: Quantity of beats or zero for non-beat based sample
@@ -617,6 +906,141 @@ def set_tempo(tempo):
     libaudioplayer.set_tempo(ctypes.c_float(tempo))
 
 
+# Add a file to the end of the playlist (played without gap after the current file)
+# handle: Index of player
+# filename: Full path and filename
+# Returns: True on success. Switch is notified to control callback with id NOTIFY_PLAYLIST (quantity of remaining files)
+def playlist_add(handle, filename):
+    return libaudioplayer.playlist_add(ctypes.c_void_p(handle), bytes(filename, "utf-8")) == 1
+
+
+# Remove all files from the playlist
+# handle: Index of player
+def playlist_clear(handle):
+    libaudioplayer.playlist_clear(ctypes.c_void_p(handle))
+
+
+# Get quantity of files remaining in playlist
+# handle: Index of player
+# Returns: Quantity of files queued after current file
+def playlist_count(handle):
+    return libaudioplayer.playlist_count(ctypes.c_void_p(handle))
+
+
+# Set crossfade between playlist files
+# handle: Index of player
+# duration: Crossfade duration in seconds (0 for gapless switch)
+def set_crossfade(handle, duration):
+    libaudioplayer.set_crossfade(ctypes.c_void_p(handle), ctypes.c_float(duration))
+
+
+# Get crossfade between playlist files
+# handle: Index of player
+# Returns: Crossfade duration in seconds
+def get_crossfade(handle):
+    return libaudioplayer.get_crossfade(ctypes.c_void_p(handle))
+
+
+# Set best time stretch quality tier of player (governor may step down from this)
+# handle: Index of player
+# tier: Quality tier (STRETCH_TIER_xxx)
+def set_stretch_quality(handle, tier):
+    libaudioplayer.set_stretch_quality(ctypes.c_void_p(handle), ctypes.c_uint8(tier))
+
+
+# Get best time stretch quality tier of player
+# handle: Index of player
+# Returns: Quality tier (STRETCH_TIER_xxx)
+def get_stretch_quality(handle):
+    return libaudioplayer.get_stretch_quality(ctypes.c_void_p(handle))
+
+
+# Get time stretch quality tier currently in use by player
+# handle: Index of player
+# Returns: Quality tier (STRETCH_TIER_xxx). Changes are notified to control callback with id NOTIFY_STRETCH_TIER
+def get_stretch_tier(handle):
+    return libaudioplayer.get_stretch_tier(ctypes.c_void_p(handle))
+
+
+# Set player priority for stretch governor
+# handle: Index of player
+# priority: 0..255 - lower priority degraded first, 255 never degraded
+def set_stretch_priority(handle, priority):
+    libaudioplayer.set_stretch_priority(ctypes.c_void_p(handle), ctypes.c_uint8(priority))
+
+
+# Get player priority for stretch governor
+# handle: Index of player
+# Returns: Priority 0..255
+def get_stretch_priority(handle):
+    return libaudioplayer.get_stretch_priority(ctypes.c_void_p(handle))
+
+
+# Enable stretch governor which steps players between stretch quality tiers based on DSP load
+# enable: True to enable
+def enable_stretch_governor(enable=True):
+    libaudioplayer.enable_stretch_governor(int(enable))
+
+
+# Check if stretch governor is enabled
+def is_stretch_governor_enabled():
+    return libaudioplayer.is_stretch_governor_enabled() == 1
+
+
+# Set stretch governor DSP load thresholds
+# low: DSP load (percent) below which quality is improved
+# high: DSP load (percent) above which quality is reduced
+def set_stretch_governor_thresholds(low, high):
+    libaudioplayer.set_stretch_governor_thresholds(ctypes.c_float(low), ctypes.c_float(high))
+
+
+# Get smoothed DSP load measured by stretch governor
+# Returns: DSP load in percent
+def get_stretch_governor_load():
+    return libaudioplayer.get_stretch_governor_load()
+
+
+# Get index of player's slot in monitor region (call once then read with read_monitor)
+# handle: Index of player
+# Returns: Slot index or -1 if player has no slot
+def get_monitor_slot(handle):
+    return libaudioplayer.get_monitor_slot(ctypes.c_void_p(handle))
+
+
+# Get name of shared memory object containing monitor region (for other processes)
+# Returns: POSIX shared memory name or empty string if region is private to this process
+def get_monitor_name():
+    return libaudioplayer.get_monitor_name().decode("utf-8")
+
+
+# Read consistent copy of a player's monitor slot without calling library
+# slot: Index of slot (from get_monitor_slot)
+# Returns: MonitorPlayer copy or None if slot is invalid or could not be read whilst being updated
+def read_monitor(slot):
+    if monitor is None or slot < 0 or slot >= MONITOR_PLAYERS:
+        return None
+    return rtmonitor.read_seqlock(monitor.player[slot])
+
+
+# Get rolling output envelope from a monitor slot copy, oldest point first
+# mon: MonitorPlayer returned by read_monitor
+# Returns: List of (peak_a, peak_b, rms_a, rms_b) tuples
+def get_monitor_envelope(mon):
+    count = min(mon.envelope_count, MONITOR_ENVELOPE)
+    start = mon.envelope_count - count
+    envelope = []
+    for i in range(start, mon.envelope_count):
+        point = i % MONITOR_ENVELOPE
+        envelope.append((mon.peak_a[point], mon.peak_b[point], mon.rms_a[point], mon.rms_b[point]))
+    return envelope
+
+
+# Set quantity of beats in each bar (tempo synced playlist files switch on bar boundary)
+# beats: Beats per bar (0 to disable bar alignment)
+def set_beats_per_bar(beats):
+    libaudioplayer.set_beats_per_bar(ctypes.c_uint8(beats))
+
+
 # Set file read buffer size
 # handle: Index of player
 # count: Buffer size in frames
@@ -706,4 +1130,30 @@ def get_file_info(filename):
     return data
 
 
+
+# Start capturing jack process inputs to a log that may be replayed offline
+# filename: Full path and filename of log
+# Returns: True on success
+def start_capture(filename):
+    return libaudioplayer.startCapture(bytes(filename, "utf-8"))
+
+
+# Stop capturing jack process inputs
+def stop_capture():
+    libaudioplayer.stopCapture()
+
+
+# Check if capturing jack process inputs
+# Returns: True if capturing
+def is_capturing():
+    return libaudioplayer.isCapturing()
+
+
+# Replay a capture log offline (must not have added a player in this process)
+# filename: Full path and filename of log
+# Returns: Index of first period that differs, -1 if all match, -2 on error
+def replay_capture(filename):
+    return libaudioplayer.replayCapture(bytes(filename, "utf-8"))
+
+
 # -------------------------------------------------------------------------------
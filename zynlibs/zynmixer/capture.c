@@ -0,0 +1,201 @@
+/*
+ * ******************************************************************
+ * ZYNTHIAN PROJECT: Audio Mixer Library
+ *
+ * Capture and replay of mixer process inputs
+ *
+ * Copyright (C) 2019-2024 Brian Walton <brian@riban.co.uk>
+ *
+ * ******************************************************************
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the LICENSE.txt file.
+ *
+ * ******************************************************************
+ */
+
+#include <stdlib.h> // provides malloc, free
+#include <string.h> // provides memset, memcpy
+
+#include "capture.h"
+
+// Capture
+static bool s_bPeriodCapture                                  = false; // True if current period is being captured
+static jack_nframes_t s_nPeriodFrames                         = 0;     // Quantity of frames in current period
+static jack_default_audio_sample_t* s_aOutputs[IO_CHANNELS * 2] = {NULL}; // Output buffers requested in current period (hashed at end of period)
+
+// Replay
+static bool s_bReplay                         = false;  // True if replaying
+static jack_default_audio_sample_t* s_aReplayAudio[IO_PORT_MIDI] = {NULL}; // Replay audio buffers, indexed by port (used as port pointers during replay)
+static REPLAY_MIDI* s_pReplayMidi             = NULL;   // Replay MIDI buffer (used as port pointer during replay)
+static uint64_t s_nReplayOutputHash           = 0;      // Hash of audio outputs from last replayed period
+static uint64_t s_nReplayStateHash            = 0;      // Hash of mixer state from last replayed period
+
+// Get period record being populated
+static CAPTURE_PERIOD_DATA* periodRecord() { return (CAPTURE_PERIOD_DATA*)captureRecordFixed(); }
+
+jack_port_t* ioRegisterPort(jack_client_t* pClient, const char* name, uint8_t port) {
+    if (s_bReplay) {
+        if (port == IO_PORT_MIDI)
+            return (jack_port_t*)s_pReplayMidi;
+        return port < IO_PORT_MIDI ? (jack_port_t*)s_aReplayAudio[port] : NULL;
+    }
+    if (port == IO_PORT_MIDI)
+        return jack_port_register(pClient, name, JACK_DEFAULT_MIDI_TYPE, JackPortIsInput, 0);
+    return jack_port_register(pClient, name, JACK_DEFAULT_AUDIO_TYPE, port < IO_PORT_OUTPUT(0, 0) ? JackPortIsInput : JackPortIsOutput, 0);
+}
+
+// Start populating record of current period
+static void beginPeriodRecord() {
+    CAPTURE_PERIOD_DATA* pPeriod = (CAPTURE_PERIOD_DATA*)captureRecordBegin(CAPTURE_RECORD_PERIOD, sizeof(CAPTURE_PERIOD_DATA));
+    if (!pPeriod)
+        return;
+    pPeriod->period  = captureGetPeriod();
+    pPeriod->frames  = s_nPeriodFrames;
+    s_bPeriodCapture = true;
+}
+
+void ioBeginPeriod(jack_nframes_t nFrames) {
+    s_nPeriodFrames  = nFrames;
+    s_bPeriodCapture = false;
+    memset(s_aOutputs, 0, sizeof(s_aOutputs));
+    if (captureBeginCallback())
+        beginPeriodRecord();
+}
+
+void ioCaptureState(const void* pState, uint32_t nSize) {
+    if (captureState(pState, nSize))
+        beginPeriodRecord();
+}
+
+bool ioIsPeriodHashed() { return s_bPeriodCapture || s_bReplay; }
+
+void ioEndPeriod(uint64_t nStateHash) {
+    if (!s_bPeriodCapture && !s_bReplay) {
+        captureEndCallback();
+        return;
+    }
+    uint64_t nOutputHash = CAPTURE_HASH_SEED;
+    for (uint8_t nOutput = 0; nOutput < IO_CHANNELS * 2; ++nOutput) {
+        if (!s_aOutputs[nOutput])
+            continue;
+        nOutputHash = captureHash(nOutputHash, &nOutput, sizeof(nOutput));
+        nOutputHash = captureHash(nOutputHash, s_aOutputs[nOutput], s_nPeriodFrames * sizeof(jack_default_audio_sample_t));
+    }
+    if (s_bReplay) {
+        s_nReplayOutputHash = nOutputHash;
+        s_nReplayStateHash  = nStateHash;
+        captureEndCallback();
+        return;
+    }
+    CAPTURE_PERIOD_DATA* pPeriod = periodRecord();
+    pPeriod->outputHash          = nOutputHash;
+    pPeriod->stateHash           = nStateHash;
+    captureRecordEnd();
+    s_bPeriodCapture = false;
+    captureEndCallback();
+}
+
+jack_default_audio_sample_t* ioGetAudioInput(jack_port_t* pPort, uint8_t port, jack_nframes_t nFrames) {
+    if (s_bReplay)
+        return (jack_default_audio_sample_t*)pPort;
+    jack_default_audio_sample_t* pBuffer = jack_port_get_buffer(pPort, nFrames);
+    if (s_bPeriodCapture && captureIsProcessThread() && port < IO_PORT_OUTPUT(0, 0)) {
+        // Append audio input to period record
+        if (captureRecordAppend(pBuffer, nFrames * sizeof(jack_default_audio_sample_t)))
+            periodRecord()->inputs |= 1ULL << port;
+    }
+    return pBuffer;
+}
+
+jack_default_audio_sample_t* ioGetAudioOutput(jack_port_t* pPort, uint8_t port, jack_nframes_t nFrames) {
+    jack_default_audio_sample_t* pBuffer = s_bReplay ? (jack_default_audio_sample_t*)pPort : jack_port_get_buffer(pPort, nFrames);
+    if (port >= IO_PORT_OUTPUT(0, 0) && port < IO_PORT_MIDI)
+        s_aOutputs[port - IO_PORT_OUTPUT(0, 0)] = pBuffer;
+    return pBuffer;
+}
+
+void* ioGetMidiBuffer(jack_port_t* pPort, jack_nframes_t nFrames) {
+    if (s_bReplay)
+        return pPort;
+    return jack_port_get_buffer(pPort, nFrames);
+}
+
+uint32_t ioMidiGetEventCount(void* pBuffer) {
+    if (s_bReplay)
+        return replayMidiCount((REPLAY_MIDI*)pBuffer);
+    return jack_midi_get_event_count(pBuffer);
+}
+
+int ioMidiEventGet(jack_midi_event_t* pEvent, void* pBuffer, uint32_t index) {
+    if (s_bReplay)
+        return replayMidiGet(pEvent, (REPLAY_MIDI*)pBuffer, index);
+    int nResult = jack_midi_event_get(pEvent, pBuffer, index);
+    if (nResult == 0 && s_bPeriodCapture && captureIsProcessThread()) {
+        // Append MIDI input event to period record
+        if (captureRecordMidi(pEvent))
+            ++periodRecord()->events;
+    }
+    return nResult;
+}
+
+void replayStart() {
+    if (s_bReplay)
+        return;
+    for (uint8_t port = 0; port < IO_PORT_MIDI; ++port)
+        s_aReplayAudio[port] = calloc(CAPTURE_MAX_FRAMES, sizeof(jack_default_audio_sample_t));
+    s_pReplayMidi = replayMidiCreate();
+    s_bReplay     = true;
+}
+
+void replayStop() {
+    if (!s_bReplay)
+        return;
+    s_bReplay = false;
+    for (uint8_t port = 0; port < IO_PORT_MIDI; ++port) {
+        free(s_aReplayAudio[port]);
+        s_aReplayAudio[port] = NULL;
+    }
+    replayMidiFree(s_pReplayMidi);
+    s_pReplayMidi = NULL;
+    memset(s_aOutputs, 0, sizeof(s_aOutputs));
+}
+
+bool replayIsRunning() { return s_bReplay; }
+
+bool replaySetPeriod(const CAPTURE_PERIOD_DATA* pPeriod, uint32_t nSize) {
+    if (!s_bReplay || pPeriod->frames > CAPTURE_MAX_FRAMES)
+        return false;
+    replayMidiReset(s_pReplayMidi, pPeriod->frames, 0);
+    const uint8_t* pData = replayMidiFill(s_pReplayMidi, (const uint8_t*)(pPeriod + 1), pPeriod->events);
+    if (!pData)
+        return false;
+    // Audio of ports read during capture follows MIDI events in port order (audio is copied because events leave it unaligned)
+    const uint8_t* pEnd = (const uint8_t*)pPeriod + nSize;
+    uint32_t nBytes     = pPeriod->frames * sizeof(jack_default_audio_sample_t);
+    for (uint8_t port = 0; port < IO_PORT_OUTPUT(0, 0); ++port) {
+        if (!(pPeriod->inputs & (1ULL << port))) {
+            memset(s_aReplayAudio[port], 0, nBytes);
+            continue;
+        }
+        if (pData + nBytes > pEnd)
+            return false;
+        memcpy(s_aReplayAudio[port], pData, nBytes);
+        pData += nBytes;
+    }
+    return true;
+}
+
+void replayGetPeriodHashes(uint64_t* pOutput, uint64_t* pState) {
+    *pOutput = s_nReplayOutputHash;
+    *pState  = s_nReplayStateHash;
+}
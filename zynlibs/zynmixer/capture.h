@@ -0,0 +1,148 @@
+/*
+ * ******************************************************************
+ * ZYNTHIAN PROJECT: Audio Mixer Library
+ *
+ * Capture and replay of mixer process inputs
+ *
+ * Copyright (C) 2019-2024 Brian Walton <brian@riban.co.uk>
+ *
+ * ******************************************************************
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the LICENSE.txt file.
+ *
+ * ******************************************************************
+ */
+
+/*  The process thread reaches JACK ports only through the io* functions declared here. Normally they call JACK directly. During capture they also
+    record each period's inputs (MIDI control events and audio of each routed channel) and a hash of its audio outputs using the shared capture core
+    (rtcapture.h). During replay the io* functions serve the recorded inputs from memory and ports are replay buffers.
+*/
+
+#pragma once
+
+#include "rtcapture.h"     // provides shared capture core
+#include <jack/jack.h>     // provides interface to JACK
+#include <jack/midiport.h> // provides interface to JACK MIDI ports
+
+#define CAPTURE_VERSION 1
+#define CAPTURE_MAX_FRAMES 8192 // Largest JACK period that may be replayed
+
+// Ports accessed by process thread
+#define IO_CHANNELS 17                                   // Quantity of mixer channels
+#define IO_PORT_INPUT(chan, leg) ((chan) * 2 + (leg))    // Audio input of a channel leg
+#define IO_PORT_OUTPUT(chan, leg) (IO_CHANNELS * 2 + (chan) * 2 + (leg)) // Audio output of a channel leg
+#define IO_PORT_MIDI (IO_CHANNELS * 4)                   // MIDI control input
+#define IO_PORTS (IO_PORT_MIDI + 1)
+
+// Process period record payload (followed by MIDI input events, each time:uint32, size:uint32, data, then audio of each input port read in period)
+typedef struct {
+    uint32_t period;     // Index of period since start of capture
+    uint32_t frames;     // Quantity of frames in period
+    uint32_t events;     // Quantity of MIDI input events that follow
+    uint32_t pad;        // Padding
+    uint64_t inputs;     // Bitmask of input ports whose audio follows the MIDI events, in order read
+    uint64_t outputHash; // Hash of audio outputs
+    uint64_t stateHash;  // Hash of mixer state at end of period (levels, meters, MIDI control)
+} CAPTURE_PERIOD_DATA;
+
+/** @brief  Register a JACK port (replay buffer during replay)
+ *   @param  pClient Pointer to JACK client
+ *   @param  name Port name
+ *   @param  port Port index [IO_PORT_xxx]
+ *   @retval jack_port_t* Pointer to port or NULL on failure
+ */
+jack_port_t* ioRegisterPort(jack_client_t* pClient, const char* name, uint8_t port);
+
+/** @brief  Start process period - call at start of each process callback
+ *   @param  nFrames Quantity of frames in period
+ */
+void ioBeginPeriod(jack_nframes_t nFrames);
+
+/** @brief  Record runtime state at start of first captured period - call from process thread after ioBeginPeriod when captureIsPending
+ *   @param  pState Pointer to state
+ *   @param  nSize Size of state
+ */
+void ioCaptureState(const void* pState, uint32_t nSize);
+
+/** @brief  Check if current period is being captured or replayed
+ *   @retval bool True if outputs of this period are hashed
+ */
+bool ioIsPeriodHashed();
+
+/** @brief  End process period - call at end of each process callback, hashes outputs
+ *   @param  nStateHash Hash of mixer state at end of period
+ */
+void ioEndPeriod(uint64_t nStateHash);
+
+/** @brief  Get audio input buffer of a channel leg for this period (recorded during capture)
+ *   @param  pPort Pointer to port
+ *   @param  port Port index [IO_PORT_INPUT]
+ *   @param  nFrames Quantity of frames in period
+ *   @retval jack_default_audio_sample_t* Pointer to buffer
+ */
+jack_default_audio_sample_t* ioGetAudioInput(jack_port_t* pPort, uint8_t port, jack_nframes_t nFrames);
+
+/** @brief  Get audio output buffer of a channel leg for this period (hashed at end of period)
+ *   @param  pPort Pointer to port
+ *   @param  port Port index [IO_PORT_OUTPUT]
+ *   @param  nFrames Quantity of frames in period
+ *   @retval jack_default_audio_sample_t* Pointer to buffer
+ */
+jack_default_audio_sample_t* ioGetAudioOutput(jack_port_t* pPort, uint8_t port, jack_nframes_t nFrames);
+
+/** @brief  Get MIDI input buffer for this period
+ *   @param  pPort Pointer to port
+ *   @param  nFrames Quantity of frames in period
+ *   @retval void* Pointer to buffer
+ */
+void* ioGetMidiBuffer(jack_port_t* pPort, jack_nframes_t nFrames);
+
+/** @brief  Get quantity of events in MIDI input buffer
+ *   @param  pBuffer Pointer to buffer
+ *   @retval uint32_t Quantity of events
+ */
+uint32_t ioMidiGetEventCount(void* pBuffer);
+
+/** @brief  Get event from MIDI input buffer (recorded during capture)
+ *   @param  pEvent Pointer to event to populate
+ *   @param  pBuffer Pointer to buffer
+ *   @param  index Index of event
+ *   @retval int 0 on success
+ */
+int ioMidiEventGet(jack_midi_event_t* pEvent, void* pBuffer, uint32_t index);
+
+/** @brief  Start replay - io* functions serve recorded inputs
+ */
+void replayStart();
+
+/** @brief  Stop replay - io* functions return to JACK
+ */
+void replayStop();
+
+/** @brief  Check if replay is running
+ *   @retval bool True if replaying
+ */
+bool replayIsRunning();
+
+/** @brief  Set inputs of next replayed period
+ *   @param  pPeriod Pointer to period record payload
+ *   @param  nSize Size of payload
+ *   @retval bool True on success, false if period exceeds replay buffers or record is truncated
+ */
+bool replaySetPeriod(const CAPTURE_PERIOD_DATA* pPeriod, uint32_t nSize);
+
+/** @brief  Get hashes from last replayed period
+ *   @param  pOutput Pointer to populate with audio output hash
+ *   @param  pState Pointer to populate with mixer state hash
+ */
+void replayGetPeriodHashes(uint64_t* pOutput, uint64_t* pState);
@@ -32,8 +32,10 @@
 
 #include "mixer.h"
 
+#include "capture.h" // provides capture and replay of process inputs
 #include "tinyosc.h"
-#include <arpa/inet.h> // provides inet_pton
+#include <arpa/inet.h>     // provides inet_pton
+#include <jack/midiport.h> // provides JACK MIDI interface
 
 char g_oscbuffer[1024];  // Used to send OSC messages
 char g_oscpath[20];      //!@todo Ensure path length is sufficient for all paths, e.g. /mixer/faderxxx
@@ -47,6 +49,35 @@ int g_solo       = 0;    // True if any channel solo enabled
 
 #define MAX_CHANNELS 17
 #define MAX_OSC_CLIENTS 5
+#define DEFAULT_SILENCE_THRESHOLD -120.0 // Level (dBFS) below which input is considered silent
+#define DEFAULT_SILENCE_HANGOVER 200     // Duration (ms) input must be below threshold before channel processing is skipped
+#define TAKEOVER_WINDOW (2.0 / 127)      // Distance from parameter value within which soft takeover engages
+
+_Static_assert(MAX_CHANNELS == IO_CHANNELS, "Capture must record every channel");
+
+// API functions that mutate state used by process thread, recorded during capture and called during replay (append only - index is stored in capture log)
+enum CAPTURE_API_ID {
+    API_setLevel,
+    API_setBalance,
+    API_setMute,
+    API_setPhase,
+    API_setNormalise,
+    API_setSolo,
+    API_toggleMute,
+    API_togglePhase,
+    API_setMono,
+    API_setMS,
+    API_reset,
+    API_enableDpm,
+    API_setMidiCcMap,
+    API_clearMidiCcMap,
+    API_learnMidiCc,
+    API_setSilenceThreshold,
+    API_setSilenceHangover,
+    API_setRouting,
+    API_onJackSamplerate,
+    API_onJackBuffersize
+};
 
 struct dynamic {
     jack_port_t* inPortA;  // Jack input port A
@@ -70,9 +101,30 @@ struct dynamic {
     uint8_t inRouted;      // 1 if source routed to channel
     uint8_t outRouted;     // 1 if output routed
     uint8_t enable_dpm;    // 1 to enable calculation of peak meter
+    uint8_t silent;        // 1 if input proven silent (processing skipped)
+    jack_nframes_t quiet;  // Quantity of consecutive frames with input below silence threshold
+};
+
+// MIDI CC mapping to a mixer parameter
+struct cc_map {
+    uint8_t param;   // Mixer parameter (MIXER_PARAM_xxx) or MIXER_PARAM_NONE if not mapped
+    uint8_t channel; // Index of mixer channel
+    uint8_t flags;   // Bitwise MIXER_CC_xxx flags
+    uint8_t msb;     // Last received MSB (14-bit) or value
+    uint8_t lsb;     // Last received LSB (14-bit)
+    uint8_t engaged; // 1 if soft takeover has caught parameter
+    float last;      // Last received normalised value (-1 if none)
+    float applied;   // Last normalised value applied to parameter
 };
 
 jack_client_t* g_pJackClient;
+jack_port_t* g_pMidiInPort;                    // JACK MIDI input for control surfaces
+struct cc_map g_ccMap[16][128];                // CC mappings indexed by MIDI channel and CC number
+uint8_t g_nLearnChannel = 0;                   // Mixer channel of parameter awaiting MIDI learn
+uint8_t g_nLearnParam   = MIXER_PARAM_NONE;    // Parameter awaiting MIDI learn or MIXER_PARAM_NONE if not learning
+uint8_t g_nLearnFlags   = 0;                   // Flags to apply to learned CC
+uint32_t g_nMidiOscPending;                    // Bitmask of channels changed by MIDI awaiting OSC notification
+uint32_t g_nMidiChanges;                       // Bitmask of channels changed by MIDI since last call to getMidiChanges
 struct dynamic g_dynamic[MAX_CHANNELS];
 struct dynamic g_dynamic_last[MAX_CHANNELS]; // Previous values used to thin OSC updates
 unsigned int g_nDampingCount  = 0;
@@ -86,6 +138,13 @@ jack_nframes_t g_buffersize                     = 1024;  // Jack buffer size use
 jack_default_audio_sample_t* pNormalisedBufferA = NULL;  // Pointer to buffer for normalised audio
 jack_default_audio_sample_t* pNormalisedBufferB = NULL;  // Pointer to buffer for normalised audio
 
+// Silence detection
+float g_fSilenceThreshold         = 0.000001;                 // Absolute sample value below which input is considered silent
+unsigned int g_nSilenceHangoverMs = DEFAULT_SILENCE_HANGOVER; // Duration (ms) input must be silent before skipping processing
+jack_nframes_t g_nSilenceHangover = 8820;                     // Quantity of frames input must be silent before skipping processing
+uint32_t g_nChannelCycles         = 0;                        // Quantity of channel process cycles (wraps)
+uint32_t g_nSilentCycles          = 0;                        // Quantity of channel process cycles skipped due to silence (wraps)
+
 static float convertToDBFS(float raw) {
     if (raw <= 0)
         return -200;
@@ -118,8 +177,33 @@ void sendOscInt(const char* path, int value) {
     }
 }
 
+// Send OSC notification of all parameters of a channel
+static void sendOscChannel(uint8_t chan) {
+    sprintf(g_oscpath, "/mixer/fader%d", chan);
+    sendOscFloat(g_oscpath, g_dynamic[chan].reqlevel);
+    sprintf(g_oscpath, "/mixer/balance%d", chan);
+    sendOscFloat(g_oscpath, g_dynamic[chan].reqbalance);
+    sprintf(g_oscpath, "/mixer/mute%d", chan);
+    sendOscInt(g_oscpath, g_dynamic[chan].mute);
+    sprintf(g_oscpath, "/mixer/solo%d", chan);
+    sendOscInt(g_oscpath, chan < MAX_CHANNELS - 1 ? g_dynamic[chan].solo : g_solo);
+    sprintf(g_oscpath, "/mixer/mono%d", chan);
+    sendOscInt(g_oscpath, g_dynamic[chan].mono);
+    sprintf(g_oscpath, "/mixer/phase%d", chan);
+    sendOscInt(g_oscpath, g_dynamic[chan].phase);
+}
+
 void* eventThreadFn(void* param) {
     while (g_sendEvents) {
+        uint32_t nChanged = __atomic_exchange_n(&g_nMidiOscPending, 0, __ATOMIC_ACQUIRE);
+        if (g_bOsc && nChanged) {
+            // Report parameters changed by MIDI control (not sent from process thread)
+            for (uint8_t chan = 0; chan < MAX_CHANNELS; ++chan)
+                if (nChanged & (1 << chan))
+                    sendOscChannel(chan);
+            if (nChanged & (1 << MAX_CHANNELS))
+                sendOscChannel(MAX_CHANNELS - 1); // Main solo state
+        }
         if (g_bOsc) {
             for (unsigned int chan = 0; chan < MAX_CHANNELS; chan++) {
                 if ((int)(100000 * g_dynamic_last[chan].dpmA) != (int)(100000 * g_dynamic[chan].dpmA)) {
@@ -149,12 +233,150 @@ void* eventThreadFn(void* param) {
     pthread_exit(NULL);
 }
 
-static int onJackProcess(jack_nframes_t nFrames, void* pArgs) {
+// Set solo of a channel and update global solo flag. Setting main mixbus solo clears all channel solos. Called from process thread so must not block.
+// Returns: True if all channel solos were cleared
+static uint8_t updateSolo(uint8_t channel, uint8_t solo) {
+    uint8_t bClearAll = channel + 1 >= MAX_CHANNELS;
+    if (bClearAll) {
+        for (uint8_t chan = 0; chan < MAX_CHANNELS; ++chan)
+            g_dynamic[chan].solo = 0;
+    } else {
+        g_dynamic[channel].solo = solo;
+    }
+    int nSolo = 0;
+    for (uint8_t chan = 0; chan < MAX_CHANNELS - 1; ++chan)
+        nSolo |= g_dynamic[chan].solo;
+    g_solo = nSolo;
+    return bClearAll;
+}
+
+// Apply a normalised (0..1) MIDI control value to a mixer parameter. Called from process thread so must not block.
+static void applyMidiParam(struct cc_map* pMap, float fValue) {
+    struct dynamic* pChannel = &g_dynamic[pMap->channel];
+    float fCurrent;
+    switch (pMap->param) {
+    case MIXER_PARAM_LEVEL:
+    case MIXER_PARAM_BALANCE:
+        fCurrent = pMap->param == MIXER_PARAM_LEVEL ? pChannel->reqlevel : (pChannel->reqbalance + 1) / 2;
+        if (pMap->flags & MIXER_CC_TAKEOVER) {
+            if (pMap->engaged && fabs(fCurrent - pMap->applied) > 0.0001)
+                pMap->engaged = 0; // Parameter changed elsewhere so must catch it again
+            if (!pMap->engaged) {
+                // Engage when control is close to or crosses parameter value
+                if (fabs(fValue - fCurrent) <= TAKEOVER_WINDOW || (pMap->last >= 0 && (pMap->last - fCurrent) * (fValue - fCurrent) <= 0))
+                    pMap->engaged = 1;
+                pMap->last = fValue;
+                if (!pMap->engaged)
+                    return;
+            }
+        }
+        pMap->last    = fValue;
+        pMap->applied = fValue;
+        if (pMap->param == MIXER_PARAM_LEVEL)
+            pChannel->reqlevel = fValue;
+        else
+            pChannel->reqbalance = fValue * 2 - 1;
+        break;
+    default: {
+        // Switch
+        uint8_t* pState;
+        switch (pMap->param) {
+        case MIXER_PARAM_MUTE:
+            pState = &pChannel->mute;
+            break;
+        case MIXER_PARAM_SOLO:
+            pState = &pChannel->solo;
+            break;
+        case MIXER_PARAM_MONO:
+            pState = &pChannel->mono;
+            break;
+        case MIXER_PARAM_PHASE:
+            pState = &pChannel->phase;
+            break;
+        case MIXER_PARAM_MS:
+            pState = &pChannel->ms;
+            break;
+        default:
+            return;
+        }
+        if (pMap->flags & MIXER_CC_MOMENTARY) {
+            // Toggle on press, ignore release
+            if (fValue == 0)
+                return;
+            *pState = !*pState;
+        } else {
+            *pState = fValue >= 0.5;
+        }
+        if (pMap->param == MIXER_PARAM_SOLO) {
+            if (updateSolo(pMap->channel, *pState)) {
+                __atomic_fetch_or(&g_nMidiOscPending, (1 << MAX_CHANNELS) - 1, __ATOMIC_RELEASE);
+                __atomic_fetch_or(&g_nMidiChanges, (1 << MAX_CHANNELS) - 1, __ATOMIC_RELEASE);
+            }
+            __atomic_fetch_or(&g_nMidiOscPending, 1 << MAX_CHANNELS, __ATOMIC_RELEASE);
+        }
+    }
+    }
+    __atomic_fetch_or(&g_nMidiOscPending, 1 << pMap->channel, __ATOMIC_RELEASE);
+    __atomic_fetch_or(&g_nMidiChanges, 1 << pMap->channel, __ATOMIC_RELEASE);
+}
+
+// Process MIDI control messages received since last period
+static void processMidi(jack_nframes_t nFrames) {
+    void* pMidiBuffer = ioGetMidiBuffer(g_pMidiInPort, nFrames);
+    jack_midi_event_t midiEvent;
+    uint32_t nCount = ioMidiGetEventCount(pMidiBuffer);
+    for (uint32_t i = 0; i < nCount; ++i) {
+        if (ioMidiEventGet(&midiEvent, pMidiBuffer, i) || midiEvent.size != 3 || (midiEvent.buffer[0] & 0xF0) != 0xB0)
+            continue;
+        uint8_t nMidiChan   = midiEvent.buffer[0] & 0x0F;
+        uint8_t nCC         = midiEvent.buffer[1] & 0x7F;
+        uint8_t nValue      = midiEvent.buffer[2] & 0x7F;
+        struct cc_map* pMap = &g_ccMap[nMidiChan][nCC];
+        if (g_nLearnParam != MIXER_PARAM_NONE) {
+            // Assign this CC to parameter awaiting learn
+            if (nCC >= 32 && nCC < 64 && (g_ccMap[nMidiChan][nCC - 32].flags & MIXER_CC_14BIT))
+                continue; // LSB of a learned 14-bit control
+            if ((g_nLearnFlags & MIXER_CC_14BIT) && nCC >= 32)
+                continue; // 14-bit controls must use CC 0..31 for MSB
+            pMap->channel = g_nLearnChannel;
+            pMap->flags   = g_nLearnFlags;
+            pMap->engaged = 0;
+            pMap->last    = -1;
+            pMap->lsb     = 0;
+            pMap->param   = g_nLearnParam;
+            g_nLearnParam = MIXER_PARAM_NONE;
+            __atomic_fetch_or(&g_nMidiChanges, 1 << g_nLearnChannel, __ATOMIC_RELEASE);
+        }
+        if (pMap->param == MIXER_PARAM_NONE) {
+            if (nCC < 32 || nCC >= 64)
+                continue;
+            // May be LSB of a 14-bit control
+            pMap = &g_ccMap[nMidiChan][nCC - 32];
+            if (pMap->param == MIXER_PARAM_NONE || !(pMap->flags & MIXER_CC_14BIT))
+                continue;
+            pMap->lsb = nValue;
+            applyMidiParam(pMap, (float)((pMap->msb << 7) | pMap->lsb) / 16383);
+        } else if (pMap->flags & MIXER_CC_14BIT) {
+            // MSB applied immediately (coarse), refined by subsequent LSB
+            pMap->msb = nValue;
+            pMap->lsb = 0;
+            applyMidiParam(pMap, (float)(pMap->msb << 7) / 16383);
+        } else {
+            pMap->msb = nValue;
+            applyMidiParam(pMap, (float)nValue / 127);
+        }
+    }
+}
+
+// Process one period of mixer
+static void processPeriod(jack_nframes_t nFrames) {
     jack_default_audio_sample_t *pInA, *pInB, *pOutA, *pOutB, *pChanOutA, *pChanOutB;
 
     unsigned int frame, chan;
     float curLevelA, curLevelB, reqLevelA, reqLevelB, fDeltaA, fDeltaB, fSampleA, fSampleB, fSampleM;
 
+    processMidi(nFrames);
+
     // Clear the normalisation buffer. This will be populated by each channel then used in final channel iteration
     memset(pNormalisedBufferA, 0.0, nFrames * sizeof(jack_default_audio_sample_t));
     memset(pNormalisedBufferB, 0.0, nFrames * sizeof(jack_default_audio_sample_t));
@@ -199,84 +421,104 @@ static int onJackProcess(jack_nframes_t nFrames, void* pArgs) {
 
             // **Apply processing to audio samples**
 
-            pInA    = jack_port_get_buffer(g_dynamic[chan].inPortA, nFrames);
-            pInB    = jack_port_get_buffer(g_dynamic[chan].inPortB, nFrames);
+            pInA    = ioGetAudioInput(g_dynamic[chan].inPortA, IO_PORT_INPUT(chan, 0), nFrames);
+            pInB    = ioGetAudioInput(g_dynamic[chan].inPortB, IO_PORT_INPUT(chan, 1), nFrames);
+
+            // Detect signal presence - scan stops at first sample above threshold so costs little for active channels
+            for (frame = 0; frame < nFrames; frame++) {
+                if (fabs(pInA[frame]) > g_fSilenceThreshold || fabs(pInB[frame]) > g_fSilenceThreshold)
+                    break;
+                if (chan == MAX_CHANNELS - 1 &&
+                    (fabs(pNormalisedBufferA[frame]) > g_fSilenceThreshold || fabs(pNormalisedBufferB[frame]) > g_fSilenceThreshold))
+                    break;
+            }
+            if (frame < nFrames)
+                g_dynamic[chan].quiet = 0; // Wake immediately so this period is processed
+            else if (g_dynamic[chan].quiet < g_nSilenceHangover)
+                g_dynamic[chan].quiet += nFrames;
+            g_dynamic[chan].silent = g_dynamic[chan].quiet >= g_nSilenceHangover;
+            ++g_nChannelCycles;
 
             if (isChannelOutRouted(chan)) {
                 // Direct output so create audio buffers
-                pChanOutA = jack_port_get_buffer(g_dynamic[chan].outPortA, nFrames);
-                pChanOutB = jack_port_get_buffer(g_dynamic[chan].outPortB, nFrames);
+                pChanOutA = ioGetAudioOutput(g_dynamic[chan].outPortA, IO_PORT_OUTPUT(chan, 0), nFrames);
+                pChanOutB = ioGetAudioOutput(g_dynamic[chan].outPortB, IO_PORT_OUTPUT(chan, 1), nFrames);
                 memset(pChanOutA, 0.0, nFrames * sizeof(jack_default_audio_sample_t));
                 memset(pChanOutB, 0.0, nFrames * sizeof(jack_default_audio_sample_t));
             } else {
                 pChanOutA = pChanOutB = NULL;
             }
 
-            // Iterate samples, scaling each and adding to output and set DPM if any samples louder than current DPM
-            for (frame = 0; frame < nFrames; frame++) {
-                if (chan == MAX_CHANNELS - 1) {
-                    // Mix channel input and normalised channels mix
-                    fSampleA = (pInA[frame] + pNormalisedBufferA[frame]);
-                    fSampleB = (pInB[frame] + pNormalisedBufferB[frame]);
-                } else {
-                    fSampleA = pInA[frame];
-                    fSampleB = pInB[frame];
-                }
-                // Handle channel phase reverse
-                if (g_dynamic[chan].phase)
-                    fSampleB = -fSampleB;
-
-                // Decode M+S
-                if (g_dynamic[chan].ms) {
-                    fSampleM = fSampleA + fSampleB;
-                    fSampleB = fSampleA - fSampleB;
-                    fSampleA = fSampleM;
-                }
-
-                // Handle mono
-                if (g_dynamic[chan].mono) {
-                    fSampleA = (fSampleA + fSampleB) / 2.0;
-                    fSampleB = fSampleA;
-                }
-
-                // Apply level adjustment
-                fSampleA *= curLevelA;
-                fSampleB *= curLevelB;
-
-                // Check for error
-                if (isinf(fSampleA))
-                    fSampleA = 1.0;
-                if (isinf(fSampleB))
-                    fSampleB = 1.0;
-
-                // Write sample to output buffer
-                if (pChanOutA) {
-                    pChanOutA[frame] += fSampleA;
-                    pChanOutB[frame] += fSampleB;
-                }
-                // Write normalised samples
-                if (chan < MAX_CHANNELS - 1 && g_dynamic[chan].normalise) {
-                    pNormalisedBufferA[frame] += fSampleA;
-                    pNormalisedBufferB[frame] += fSampleB;
-                }
-
-                curLevelA += fDeltaA;
-                curLevelB += fDeltaB;
-
-                // Process DPM
-                if (g_dynamic[chan].enable_dpm) {
-                    fSampleA = fabs(fSampleA);
-                    if (fSampleA > g_dynamic[chan].dpmA)
-                        g_dynamic[chan].dpmA = fSampleA;
-                    fSampleB = fabs(fSampleB);
-                    if (fSampleB > g_dynamic[chan].dpmB)
-                        g_dynamic[chan].dpmB = fSampleB;
-
-                    // Update peak hold and scale DPM for damped release
-                    if (g_dynamic[chan].dpmA > g_dynamic[chan].holdA)
-                        g_dynamic[chan].holdA = g_dynamic[chan].dpmA;
-                    if (g_dynamic[chan].dpmB > g_dynamic[chan].holdB)
-                        g_dynamic[chan].holdB = g_dynamic[chan].dpmB;
+            if (g_dynamic[chan].silent) {
+                // Silent input contributes nothing so skip level, M+S and summing - just let meters decay
+                ++g_nSilentCycles;
+            } else {
+                // Iterate samples, scaling each and adding to output and set DPM if any samples louder than current DPM
+                for (frame = 0; frame < nFrames; frame++) {
+                    if (chan == MAX_CHANNELS - 1) {
+                        // Mix channel input and normalised channels mix
+                        fSampleA = (pInA[frame] + pNormalisedBufferA[frame]);
+                        fSampleB = (pInB[frame] + pNormalisedBufferB[frame]);
+                    } else {
+                        fSampleA = pInA[frame];
+                        fSampleB = pInB[frame];
+                    }
+                    // Handle channel phase reverse
+                    if (g_dynamic[chan].phase)
+                        fSampleB = -fSampleB;
+
+                    // Decode M+S
+                    if (g_dynamic[chan].ms) {
+                        fSampleM = fSampleA + fSampleB;
+                        fSampleB = fSampleA - fSampleB;
+                        fSampleA = fSampleM;
+                    }
+
+                    // Handle mono
+                    if (g_dynamic[chan].mono) {
+                        fSampleA = (fSampleA + fSampleB) / 2.0;
+                        fSampleB = fSampleA;
+                    }
+
+                    // Apply level adjustment
+                    fSampleA *= curLevelA;
+                    fSampleB *= curLevelB;
+
+                    // Check for error
+                    if (isinf(fSampleA))
+                        fSampleA = 1.0;
+                    if (isinf(fSampleB))
+                        fSampleB = 1.0;
+
+                    // Write sample to output buffer
+                    if (pChanOutA) {
+                        pChanOutA[frame] += fSampleA;
+                        pChanOutB[frame] += fSampleB;
+                    }
+                    // Write normalised samples
+                    if (chan < MAX_CHANNELS - 1 && g_dynamic[chan].normalise) {
+                        pNormalisedBufferA[frame] += fSampleA;
+                        pNormalisedBufferB[frame] += fSampleB;
+                    }
+
+                    curLevelA += fDeltaA;
+                    curLevelB += fDeltaB;
+
+                    // Process DPM
+                    if (g_dynamic[chan].enable_dpm) {
+                        fSampleA = fabs(fSampleA);
+                        if (fSampleA > g_dynamic[chan].dpmA)
+                            g_dynamic[chan].dpmA = fSampleA;
+                        fSampleB = fabs(fSampleB);
+                        if (fSampleB > g_dynamic[chan].dpmB)
+                            g_dynamic[chan].dpmB = fSampleB;
+
+                        // Update peak hold and scale DPM for damped release
+                        if (g_dynamic[chan].dpmA > g_dynamic[chan].holdA)
+                            g_dynamic[chan].holdA = g_dynamic[chan].dpmA;
+                        if (g_dynamic[chan].dpmB > g_dynamic[chan].holdB)
+                            g_dynamic[chan].holdB = g_dynamic[chan].dpmB;
+                    }
                 }
             }
             if (g_nHoldCount == 0) {
@@ -305,33 +547,131 @@ static int onJackProcess(jack_nframes_t nFrames, void* pArgs) {
         g_nHoldCount = g_nDampingPeriod * 20;
     else
         --g_nHoldCount;
+}
+
+// Process thread state at start of capture (port pointers within dynamic are not restored)
+struct runtime_state {
+    struct dynamic dynamic[MAX_CHANNELS];
+    struct cc_map ccMap[16][128];
+    float dpmDecay;
+    float silenceThreshold;
+    uint32_t silenceHangoverMs;
+    uint32_t silenceHangover;
+    uint32_t dampingCount;
+    uint32_t dampingPeriod;
+    uint32_t holdCount;
+    uint32_t samplerate;
+    uint32_t buffersize;
+    int32_t solo;
+    uint8_t learnChannel;
+    uint8_t learnParam;
+    uint8_t learnFlags;
+};
+struct runtime_state g_captureState; // Runtime state populated at start of capture
+
+int onJackBuffersize(jack_nframes_t nBuffersize, void* arg);
+
+// Populate runtime state - call from process thread at start of first captured period
+static void getRuntimeState(struct runtime_state* pState) {
+    memcpy(pState->dynamic, g_dynamic, sizeof(g_dynamic));
+    memcpy(pState->ccMap, g_ccMap, sizeof(g_ccMap));
+    pState->dpmDecay          = g_fDpmDecay;
+    pState->silenceThreshold  = g_fSilenceThreshold;
+    pState->silenceHangoverMs = g_nSilenceHangoverMs;
+    pState->silenceHangover   = g_nSilenceHangover;
+    pState->dampingCount      = g_nDampingCount;
+    pState->dampingPeriod     = g_nDampingPeriod;
+    pState->holdCount         = g_nHoldCount;
+    pState->samplerate        = g_samplerate;
+    pState->buffersize        = g_buffersize;
+    pState->solo              = g_solo;
+    pState->learnChannel      = g_nLearnChannel;
+    pState->learnParam        = g_nLearnParam;
+    pState->learnFlags        = g_nLearnFlags;
+}
 
+// Restore runtime state before replay, retaining port pointers
+static void setRuntimeState(const struct runtime_state* pState) {
+    for (uint8_t chan = 0; chan < MAX_CHANNELS; ++chan) {
+        struct dynamic ports = g_dynamic[chan];
+        g_dynamic[chan]          = pState->dynamic[chan];
+        g_dynamic[chan].inPortA  = ports.inPortA;
+        g_dynamic[chan].inPortB  = ports.inPortB;
+        g_dynamic[chan].outPortA = ports.outPortA;
+        g_dynamic[chan].outPortB = ports.outPortB;
+    }
+    memcpy(g_ccMap, pState->ccMap, sizeof(g_ccMap));
+    g_fDpmDecay          = pState->dpmDecay;
+    g_fSilenceThreshold  = pState->silenceThreshold;
+    g_nSilenceHangoverMs = pState->silenceHangoverMs;
+    g_nSilenceHangover   = pState->silenceHangover;
+    g_samplerate         = pState->samplerate;
+    onJackBuffersize(pState->buffersize, NULL); // Allocate normalisation buffers
+    g_nDampingCount  = pState->dampingCount;
+    g_nDampingPeriod = pState->dampingPeriod;
+    g_nHoldCount     = pState->holdCount;
+    g_solo           = pState->solo;
+    g_nLearnChannel  = pState->learnChannel;
+    g_nLearnParam    = pState->learnParam;
+    g_nLearnFlags    = pState->learnFlags;
+}
+
+// Hash mixer state that process thread changes - levels, meters, silence detection and MIDI control
+static uint64_t getStateHash() {
+    uint64_t nHash = CAPTURE_HASH_SEED;
+    for (uint8_t chan = 0; chan < MAX_CHANNELS; ++chan)
+        nHash = captureHash(nHash, &g_dynamic[chan].level, sizeof(struct dynamic) - offsetof(struct dynamic, level));
+    nHash = captureHash(nHash, g_ccMap, sizeof(g_ccMap));
+    nHash = captureHash(nHash, &g_solo, sizeof(g_solo));
+    nHash = captureHash(nHash, &g_nLearnParam, sizeof(g_nLearnParam));
+    nHash = captureHash(nHash, &g_nDampingCount, sizeof(g_nDampingCount));
+    return captureHash(nHash, &g_nHoldCount, sizeof(g_nHoldCount));
+}
+
+static int onJackProcess(jack_nframes_t nFrames, void* pArgs) {
+    ioBeginPeriod(nFrames);
+    if (captureIsPending()) {
+        getRuntimeState(&g_captureState);
+        ioCaptureState(&g_captureState, sizeof(g_captureState));
+    }
+    processPeriod(nFrames);
+    ioEndPeriod(ioIsPeriodHashed() ? getStateHash() : 0);
     return 0;
 }
 
+// Set routing of channels (recorded during capture because it changes process thread behaviour)
+static void setRouting(uint32_t inRouted, uint32_t outRouted) {
+    CAPTURE_API_C(API_setRouting, CAPTURE_ARG(inRouted), CAPTURE_ARG(outRouted));
+    for (uint8_t chan = 0; chan < MAX_CHANNELS; chan++) {
+        g_dynamic[chan].inRouted  = (inRouted >> chan) & 1;
+        g_dynamic[chan].outRouted = (outRouted >> chan) & 1;
+    }
+}
+
 void onJackConnect(jack_port_id_t source, jack_port_id_t dest, int connect, void* args) {
-    uint8_t chan;
-    for (chan = 0; chan < MAX_CHANNELS; chan++) {
+    uint32_t inRouted  = 0;
+    uint32_t outRouted = 0;
+    for (uint8_t chan = 0; chan < MAX_CHANNELS; chan++) {
         if (jack_port_connected(g_dynamic[chan].inPortA) > 0 || (jack_port_connected(g_dynamic[chan].inPortB) > 0))
-            g_dynamic[chan].inRouted = 1;
-        else
-            g_dynamic[chan].inRouted = 0;
+            inRouted |= 1 << chan;
         if (jack_port_connected(g_dynamic[chan].outPortA) > 0 || (jack_port_connected(g_dynamic[chan].outPortB) > 0))
-            g_dynamic[chan].outRouted = 1;
-        else
-            g_dynamic[chan].outRouted = 0;
+            outRouted |= 1 << chan;
     }
+    setRouting(inRouted, outRouted);
 }
 
 int onJackSamplerate(jack_nframes_t nSamplerate, void* arg) {
+    CAPTURE_API_C(API_onJackSamplerate, CAPTURE_ARG(nSamplerate));
     if (nSamplerate == 0)
         return 0;
-    g_samplerate     = nSamplerate;
-    g_nDampingPeriod = g_fDpmDecay * nSamplerate / g_buffersize / 15;
+    g_samplerate       = nSamplerate;
+    g_nDampingPeriod   = g_fDpmDecay * nSamplerate / g_buffersize / 15;
+    g_nSilenceHangover = (uint64_t)g_nSilenceHangoverMs * nSamplerate / 1000;
     return 0;
 }
 
 int onJackBuffersize(jack_nframes_t nBuffersize, void* arg) {
+    CAPTURE_API_C(API_onJackBuffersize, CAPTURE_ARG(nBuffersize));
     if (nBuffersize == 0)
         return 0;
     g_buffersize     = nBuffersize;
@@ -379,22 +719,22 @@ int init() {
         g_dynamic[chan].normalise  = 1;
         char sName[11];
         sprintf(sName, "input_%02lda", chan + 1);
-        if (!(g_dynamic[chan].inPortA = jack_port_register(g_pJackClient, sName, JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0))) {
+        if (!(g_dynamic[chan].inPortA = ioRegisterPort(g_pJackClient, sName, IO_PORT_INPUT(chan, 0)))) {
             fprintf(stderr, "libzynmixer: Cannot register %s\n", sName);
             exit(1);
         }
         sprintf(sName, "input_%02ldb", chan + 1);
-        if (!(g_dynamic[chan].inPortB = jack_port_register(g_pJackClient, sName, JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0))) {
+        if (!(g_dynamic[chan].inPortB = ioRegisterPort(g_pJackClient, sName, IO_PORT_INPUT(chan, 1)))) {
             fprintf(stderr, "libzynmixer: Cannot register %s\n", sName);
             exit(1);
         }
         sprintf(sName, "output_%02lda", chan + 1);
-        if (!(g_dynamic[chan].outPortA = jack_port_register(g_pJackClient, sName, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0))) {
+        if (!(g_dynamic[chan].outPortA = ioRegisterPort(g_pJackClient, sName, IO_PORT_OUTPUT(chan, 0)))) {
             fprintf(stderr, "libzynmixer: Cannot register %s\n", sName);
             exit(1);
         }
         sprintf(sName, "output_%02ldb", chan + 1);
-        if (!(g_dynamic[chan].outPortB = jack_port_register(g_pJackClient, sName, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0))) {
+        if (!(g_dynamic[chan].outPortB = ioRegisterPort(g_pJackClient, sName, IO_PORT_OUTPUT(chan, 1)))) {
             fprintf(stderr, "libzynmixer: Cannot register %s\n", sName);
             exit(1);
         }
@@ -404,10 +744,19 @@ int init() {
         g_dynamic_last[chan].holdB = 100.0;
     }
 
+    if (!(g_pMidiInPort = ioRegisterPort(g_pJackClient, "midi_in", IO_PORT_MIDI))) {
+        fprintf(stderr, "libzynmixer: Cannot register midi_in\n");
+        exit(1);
+    }
+    clearMidiCcMap();
+
 #ifdef DEBUG
     fprintf(stderr, "libzynmixer: Created input ports\n");
 #endif
 
+    setSilenceThreshold(DEFAULT_SILENCE_THRESHOLD);
+    setSilenceHangover(DEFAULT_SILENCE_HANGOVER);
+
     // Register the cleanup function to be called when library exits
     atexit(end);
 
@@ -456,6 +805,7 @@ void end() {
 }
 
 void setLevel(uint8_t channel, float level) {
+    CAPTURE_API_C(API_setLevel, CAPTURE_ARG(channel), CAPTURE_ARG(level));
     if (channel >= MAX_CHANNELS)
         channel = MAX_CHANNELS - 1;
     else
@@ -471,6 +821,7 @@ float getLevel(uint8_t channel) {
 }
 
 void setBalance(uint8_t channel, float balance) {
+    CAPTURE_API_C(API_setBalance, CAPTURE_ARG(channel), CAPTURE_ARG(balance));
     if (fabs(balance) > 1)
         return;
     if (channel >= MAX_CHANNELS)
@@ -487,6 +838,7 @@ float getBalance(uint8_t channel) {
 }
 
 void setMute(uint8_t channel, uint8_t mute) {
+    CAPTURE_API_C(API_setMute, CAPTURE_ARG(channel), CAPTURE_ARG(mute));
     if (channel >= MAX_CHANNELS)
         channel = MAX_CHANNELS - 1;
     g_dynamic[channel].mute = mute;
@@ -501,6 +853,7 @@ uint8_t getMute(uint8_t channel) {
 }
 
 void setPhase(uint8_t channel, uint8_t phase) {
+    CAPTURE_API_C(API_setPhase, CAPTURE_ARG(channel), CAPTURE_ARG(phase));
     if (channel >= MAX_CHANNELS)
         channel = MAX_CHANNELS - 1;
     g_dynamic[channel].phase = phase;
@@ -517,6 +870,7 @@ uint8_t getPhase(uint8_t channel) {
 }
 
 void setNormalise(uint8_t channel, uint8_t enable) {
+    CAPTURE_API_C(API_setNormalise, CAPTURE_ARG(channel), CAPTURE_ARG(enable));
     if (channel >= MAX_CHANNELS)
         channel = MAX_CHANNELS - 1;
     g_dynamic[channel].normalise = enable;
@@ -533,22 +887,17 @@ uint8_t getNormalise(uint8_t channel, uint8_t enable) {
 }
 
 void setSolo(uint8_t channel, uint8_t solo) {
-    if (channel + 1 >= MAX_CHANNELS) {
-        // Setting main mixbus solo will disable all channel solos
+    CAPTURE_API_C(API_setSolo, CAPTURE_ARG(channel), CAPTURE_ARG(solo));
+    if (updateSolo(channel, solo)) {
+        // Setting main mixbus solo disabled all channel solos
         for (uint8_t nChannel = 0; nChannel < MAX_CHANNELS - 1; ++nChannel) {
-            g_dynamic[nChannel].solo = 0;
             sprintf(g_oscpath, "/mixer/solo%d", nChannel);
             sendOscInt(g_oscpath, 0);
         }
     } else {
-        g_dynamic[channel].solo = solo;
         sprintf(g_oscpath, "/mixer/solo%d", channel);
         sendOscInt(g_oscpath, solo);
     }
-    // Set the global solo flag if any channel solo is enabled
-    g_solo = 0;
-    for (uint8_t nChannel = 0; nChannel < MAX_CHANNELS - 1; ++nChannel)
-        g_solo |= g_dynamic[nChannel].solo;
     sprintf(g_oscpath, "/mixer/solo%d", MAX_CHANNELS - 1);
     sendOscInt(g_oscpath, g_solo);
 }
@@ -560,6 +909,7 @@ uint8_t getSolo(uint8_t channel) {
 }
 
 void toggleMute(uint8_t channel) {
+    CAPTURE_API_C(API_toggleMute, CAPTURE_ARG(channel));
     uint8_t mute;
     if (channel >= MAX_CHANNELS)
         channel = MAX_CHANNELS - 1;
@@ -571,6 +921,7 @@ void toggleMute(uint8_t channel) {
 }
 
 void togglePhase(uint8_t channel) {
+    CAPTURE_API_C(API_togglePhase, CAPTURE_ARG(channel));
     uint8_t phase;
     if (channel >= MAX_CHANNELS)
         channel = MAX_CHANNELS - 1;
@@ -582,6 +933,7 @@ void togglePhase(uint8_t channel) {
 }
 
 void setMono(uint8_t channel, uint8_t mono) {
+    CAPTURE_API_C(API_setMono, CAPTURE_ARG(channel), CAPTURE_ARG(mono));
     if (channel >= MAX_CHANNELS)
         channel = MAX_CHANNELS - 1;
     g_dynamic[channel].mono = (mono != 0);
@@ -596,6 +948,7 @@ uint8_t getMono(uint8_t channel) {
 }
 
 void setMS(uint8_t channel, uint8_t enable) {
+    CAPTURE_API_C(API_setMS, CAPTURE_ARG(channel), CAPTURE_ARG(enable));
     if (channel >= MAX_CHANNELS)
         channel = MAX_CHANNELS - 1;
     g_dynamic[channel].ms = enable != 0;
@@ -608,6 +961,7 @@ uint8_t getMS(uint8_t channel) {
 }
 
 void reset(uint8_t channel) {
+    CAPTURE_API_C(API_reset, CAPTURE_ARG(channel));
     if (channel >= MAX_CHANNELS)
         channel = MAX_CHANNELS - 1;
     setLevel(channel, 0.8);
@@ -668,6 +1022,7 @@ void getDpmStates(uint8_t start, uint8_t end, float* values) {
 }
 
 void enableDpm(uint8_t start, uint8_t end, uint8_t enable) {
+    CAPTURE_API_C(API_enableDpm, CAPTURE_ARG(start), CAPTURE_ARG(end), CAPTURE_ARG(enable));
     struct dynamic* pChannel;
     if (start > end) {
         uint8_t tmp = start;
@@ -735,3 +1090,293 @@ void removeOscClient(const char* client) {
 }
 
 uint8_t getMaxChannels() { return MAX_CHANNELS; }
+
+uint8_t setMidiCcMap(uint8_t midiChan, uint8_t cc, uint8_t channel, uint8_t param, uint8_t flags) {
+    CAPTURE_API_C(API_setMidiCcMap, CAPTURE_ARG(midiChan), CAPTURE_ARG(cc), CAPTURE_ARG(channel), CAPTURE_ARG(param), CAPTURE_ARG(flags));
+    if (midiChan > 15 || cc > 127 || param > MIXER_PARAM_MS)
+        return 0;
+    if ((flags & MIXER_CC_14BIT) && cc >= 32)
+        return 0;
+    if (channel >= MAX_CHANNELS)
+        channel = MAX_CHANNELS - 1;
+    struct cc_map* pMap = &g_ccMap[midiChan][cc];
+    // Disable mapping whilst updating to avoid process thread using partial configuration
+    pMap->param         = MIXER_PARAM_NONE;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    pMap->channel = channel;
+    pMap->flags   = flags;
+    pMap->msb     = 0;
+    pMap->lsb     = 0;
+    pMap->engaged = 0;
+    pMap->last    = -1;
+    pMap->applied = -1;
+    __atomic_store_n(&pMap->param, param, __ATOMIC_RELEASE);
+    return 1;
+}
+
+uint8_t getMidiCcMap(uint8_t midiChan, uint8_t cc, uint8_t* channel, uint8_t* flags) {
+    if (midiChan > 15 || cc > 127)
+        return MIXER_PARAM_NONE;
+    struct cc_map* pMap = &g_ccMap[midiChan][cc];
+    if (channel)
+        *channel = pMap->channel;
+    if (flags)
+        *flags = pMap->flags;
+    return pMap->param;
+}
+
+void clearMidiCcMap() {
+    CAPTURE_API_C0(API_clearMidiCcMap);
+    g_nLearnParam = MIXER_PARAM_NONE;
+    for (uint8_t midiChan = 0; midiChan < 16; ++midiChan)
+        for (uint8_t cc = 0; cc < 128; ++cc)
+            g_ccMap[midiChan][cc].param = MIXER_PARAM_NONE;
+}
+
+void learnMidiCc(uint8_t channel, uint8_t param, uint8_t flags) {
+    CAPTURE_API_C(API_learnMidiCc, CAPTURE_ARG(channel), CAPTURE_ARG(param), CAPTURE_ARG(flags));
+    if (param > MIXER_PARAM_MS)
+        param = MIXER_PARAM_NONE;
+    if (channel >= MAX_CHANNELS)
+        channel = MAX_CHANNELS - 1;
+    g_nLearnParam = MIXER_PARAM_NONE;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    g_nLearnChannel = channel;
+    g_nLearnFlags   = flags;
+    __atomic_store_n(&g_nLearnParam, param, __ATOMIC_RELEASE);
+}
+
+uint8_t isMidiLearning() { return g_nLearnParam != MIXER_PARAM_NONE; }
+
+uint32_t getMidiChanges() { return __atomic_exchange_n(&g_nMidiChanges, 0, __ATOMIC_ACQUIRE); }
+
+void setSilenceThreshold(float threshold) {
+    CAPTURE_API_C(API_setSilenceThreshold, CAPTURE_ARG(threshold));
+    if (threshold <= -200)
+        g_fSilenceThreshold = -1.0; // Any sample exceeds threshold so silence detection is disabled
+    else
+        g_fSilenceThreshold = powf(10, threshold / 20);
+}
+
+float getSilenceThreshold() {
+    if (g_fSilenceThreshold < 0)
+        return -200;
+    return convertToDBFS(g_fSilenceThreshold);
+}
+
+void setSilenceHangover(uint32_t hangover) {
+    CAPTURE_API_C(API_setSilenceHangover, CAPTURE_ARG(hangover));
+    g_nSilenceHangoverMs = hangover;
+    g_nSilenceHangover   = (uint64_t)hangover * g_samplerate / 1000;
+}
+
+uint32_t getSilenceHangover() { return g_nSilenceHangoverMs; }
+
+uint8_t isChannelSilent(uint8_t channel) {
+    if (channel >= MAX_CHANNELS)
+        channel = MAX_CHANNELS - 1;
+    return g_dynamic[channel].silent;
+}
+
+float getSilenceSaving() {
+    static uint32_t nLastChannelCycles = 0;
+    static uint32_t nLastSilentCycles  = 0;
+    uint32_t nSilentCycles             = g_nSilentCycles;
+    uint32_t nChannelCycles            = g_nChannelCycles;
+    uint32_t nCycles                   = nChannelCycles - nLastChannelCycles;
+    uint32_t nSkipped                  = nSilentCycles - nLastSilentCycles;
+    nLastChannelCycles                 = nChannelCycles;
+    nLastSilentCycles                  = nSilentCycles;
+    if (nCycles == 0 || nSkipped > nCycles)
+        return 0.0;
+    return (float)nSkipped / nCycles;
+}
+
+// ** Capture and replay **
+
+// Call a captured API function during replay
+static void replayApi(uint16_t id, const uint8_t* pArgs) {
+    switch (id) {
+    case API_setLevel: {
+        REPLAY_ARG_C(uint8_t, channel, pArgs);
+        REPLAY_ARG_C(float, level, pArgs);
+        setLevel(channel, level);
+        break;
+    }
+    case API_setBalance: {
+        REPLAY_ARG_C(uint8_t, channel, pArgs);
+        REPLAY_ARG_C(float, balance, pArgs);
+        setBalance(channel, balance);
+        break;
+    }
+    case API_setMute: {
+        REPLAY_ARG_C(uint8_t, channel, pArgs);
+        REPLAY_ARG_C(uint8_t, value, pArgs);
+        setMute(channel, value);
+        break;
+    }
+    case API_setPhase: {
+        REPLAY_ARG_C(uint8_t, channel, pArgs);
+        REPLAY_ARG_C(uint8_t, value, pArgs);
+        setPhase(channel, value);
+        break;
+    }
+    case API_setNormalise: {
+        REPLAY_ARG_C(uint8_t, channel, pArgs);
+        REPLAY_ARG_C(uint8_t, value, pArgs);
+        setNormalise(channel, value);
+        break;
+    }
+    case API_setSolo: {
+        REPLAY_ARG_C(uint8_t, channel, pArgs);
+        REPLAY_ARG_C(uint8_t, value, pArgs);
+        setSolo(channel, value);
+        break;
+    }
+    case API_setMono: {
+        REPLAY_ARG_C(uint8_t, channel, pArgs);
+        REPLAY_ARG_C(uint8_t, value, pArgs);
+        setMono(channel, value);
+        break;
+    }
+    case API_setMS: {
+        REPLAY_ARG_C(uint8_t, channel, pArgs);
+        REPLAY_ARG_C(uint8_t, value, pArgs);
+        setMS(channel, value);
+        break;
+    }
+    case API_toggleMute: {
+        REPLAY_ARG_C(uint8_t, channel, pArgs);
+        toggleMute(channel);
+        break;
+    }
+    case API_togglePhase: {
+        REPLAY_ARG_C(uint8_t, channel, pArgs);
+        togglePhase(channel);
+        break;
+    }
+    case API_reset: {
+        REPLAY_ARG_C(uint8_t, channel, pArgs);
+        reset(channel);
+        break;
+    }
+    case API_enableDpm: {
+        REPLAY_ARG_C(uint8_t, start, pArgs);
+        REPLAY_ARG_C(uint8_t, end, pArgs);
+        REPLAY_ARG_C(uint8_t, enable, pArgs);
+        enableDpm(start, end, enable);
+        break;
+    }
+    case API_setMidiCcMap: {
+        REPLAY_ARG_C(uint8_t, midiChan, pArgs);
+        REPLAY_ARG_C(uint8_t, cc, pArgs);
+        REPLAY_ARG_C(uint8_t, channel, pArgs);
+        REPLAY_ARG_C(uint8_t, param, pArgs);
+        REPLAY_ARG_C(uint8_t, flags, pArgs);
+        setMidiCcMap(midiChan, cc, channel, param, flags);
+        break;
+    }
+    case API_clearMidiCcMap:
+        clearMidiCcMap();
+        break;
+    case API_learnMidiCc: {
+        REPLAY_ARG_C(uint8_t, channel, pArgs);
+        REPLAY_ARG_C(uint8_t, param, pArgs);
+        REPLAY_ARG_C(uint8_t, flags, pArgs);
+        learnMidiCc(channel, param, flags);
+        break;
+    }
+    case API_setSilenceThreshold: {
+        REPLAY_ARG_C(float, threshold, pArgs);
+        setSilenceThreshold(threshold);
+        break;
+    }
+    case API_setSilenceHangover: {
+        REPLAY_ARG_C(uint32_t, hangover, pArgs);
+        setSilenceHangover(hangover);
+        break;
+    }
+    case API_setRouting: {
+        REPLAY_ARG_C(uint32_t, inRouted, pArgs);
+        REPLAY_ARG_C(uint32_t, outRouted, pArgs);
+        setRouting(inRouted, outRouted);
+        break;
+    }
+    case API_onJackSamplerate: {
+        REPLAY_ARG_C(jack_nframes_t, samplerate, pArgs);
+        onJackSamplerate(samplerate, NULL);
+        break;
+    }
+    case API_onJackBuffersize: {
+        REPLAY_ARG_C(jack_nframes_t, buffersize, pArgs);
+        onJackBuffersize(buffersize, NULL);
+        break;
+    }
+    default:
+        fprintf(stderr, "libzynmixer replay ignoring unknown API call %u\n", id);
+    }
+}
+
+// Replay a process thread record - returns -1 if outputs match
+static int32_t replayRecord(uint8_t type, const void* pPayload, uint32_t nSize, bool bOverlap) {
+    if (type == CAPTURE_RECORD_STATE) {
+        memcpy(&g_captureState, pPayload, sizeof(g_captureState));
+        setRuntimeState(&g_captureState);
+    } else if (type == CAPTURE_RECORD_PERIOD) {
+        const CAPTURE_PERIOD_DATA* pPeriod = (const CAPTURE_PERIOD_DATA*)pPayload;
+        if (pPeriod->frames > g_buffersize || !replaySetPeriod(pPeriod, nSize))
+            return -2;
+        onJackProcess(pPeriod->frames, NULL);
+        uint64_t nOutput, nState;
+        replayGetPeriodHashes(&nOutput, &nState);
+        if (nOutput != pPeriod->outputHash || nState != pPeriod->stateHash) {
+            fprintf(stderr, "libzynmixer replay: period %u differs (audio output %s, state %s)\n", pPeriod->period,
+                    nOutput == pPeriod->outputHash ? "same" : "differs", nState == pPeriod->stateHash ? "same" : "differs");
+            if (bOverlap)
+                fprintf(stderr, "libzynmixer replay: an API call overlapped period %u during capture\n", pPeriod->period);
+            return pPeriod->period;
+        }
+    }
+    return -1;
+}
+
+uint8_t startCapture(const char* filename) {
+    if (!g_pJackClient || captureIsRunning() || replayIsRunning())
+        return 0;
+    if (!captureStart(filename, "zynmixer", CAPTURE_VERSION, g_samplerate, 0, sizeof(struct runtime_state)))
+        return 0;
+    captureArm();
+    return 1;
+}
+
+void stopCapture() { captureStop(); }
+
+uint8_t isCapturing() { return captureIsRunning(); }
+
+int32_t replayCapture(const char* filename) {
+    if (g_pJackClient || captureIsRunning() || replayIsRunning())
+        return -2; // Replay drives the process callbacks so must not run alongside JACK
+    CAPTURE_HEADER header;
+    if (!replayOpen(filename, "zynmixer", CAPTURE_VERSION, sizeof(struct runtime_state), &header))
+        return -2;
+
+    // Replay ports replace JACK ports (runtime state restores everything else)
+    replayStart();
+    for (uint8_t chan = 0; chan < MAX_CHANNELS; ++chan) {
+        g_dynamic[chan].inPortA  = ioRegisterPort(NULL, NULL, IO_PORT_INPUT(chan, 0));
+        g_dynamic[chan].inPortB  = ioRegisterPort(NULL, NULL, IO_PORT_INPUT(chan, 1));
+        g_dynamic[chan].outPortA = ioRegisterPort(NULL, NULL, IO_PORT_OUTPUT(chan, 0));
+        g_dynamic[chan].outPortB = ioRegisterPort(NULL, NULL, IO_PORT_OUTPUT(chan, 1));
+    }
+    g_pMidiInPort   = ioRegisterPort(NULL, NULL, IO_PORT_MIDI);
+    int32_t nResult = replayRun(replayRecord, replayApi);
+    replayStop();
+    replayClose();
+    for (uint8_t chan = 0; chan < MAX_CHANNELS; ++chan)
+        g_dynamic[chan].inPortA = g_dynamic[chan].inPortB = g_dynamic[chan].outPortA = g_dynamic[chan].outPortB = NULL;
+    g_pMidiInPort = NULL;
+    free(pNormalisedBufferA);
+    free(pNormalisedBufferB);
+    pNormalisedBufferA = pNormalisedBufferB = NULL;
+    return nResult;
+}
@@ -26,6 +26,21 @@
 #include <jack/jack.h>
 #include <stdint.h> //provides fixed width integer types
 
+// Mixer parameters controllable by MIDI CC
+#define MIXER_PARAM_NONE 0
+#define MIXER_PARAM_LEVEL 1
+#define MIXER_PARAM_BALANCE 2
+#define MIXER_PARAM_MUTE 3
+#define MIXER_PARAM_SOLO 4
+#define MIXER_PARAM_MONO 5
+#define MIXER_PARAM_PHASE 6
+#define MIXER_PARAM_MS 7
+
+// MIDI CC mapping flags
+#define MIXER_CC_14BIT 0x01     // CC 0..31 is MSB with LSB on CC+32
+#define MIXER_CC_TAKEOVER 0x02  // Fader / balance ignored until control reaches parameter value
+#define MIXER_CC_MOMENTARY 0x04 // Switch toggles on each non-zero value (else on when value >= 64)
+
 //-----------------------------------------------------------------------------
 // Library Initialization
 //-----------------------------------------------------------------------------
@@ -206,3 +221,98 @@ void removeOscClient(const char* client);
  *   @retval size_t Maximum quantity of channels
  */
 uint8_t getMaxChannels();
+
+/** @brief  Set level below which channel input is considered silent
+ *   @param  threshold Level in dBFS (<= -200 to disable silence detection)
+ *   @note   Channels with input below threshold for the hangover period skip level, M+S and summing processing
+ */
+void setSilenceThreshold(float threshold);
+
+/** @brief  Get level below which channel input is considered silent
+ *   @retval float Level in dBFS (-200 if silence detection disabled)
+ */
+float getSilenceThreshold();
+
+/** @brief  Set duration input must be silent before channel processing is skipped
+ *   @param  hangover Duration in ms
+ */
+void setSilenceHangover(uint32_t hangover);
+
+/** @brief  Get duration input must be silent before channel processing is skipped
+ *   @retval uint32_t Duration in ms
+ */
+uint32_t getSilenceHangover();
+
+/** @brief  Check if channel input is silent
+ *   @param  channel Index of channel
+ *   @retval uint8_t 1 if channel processing is skipped due to silent input
+ */
+uint8_t isChannelSilent(uint8_t channel);
+
+/** @brief  Get proportion of channel processing saved by silence detection
+ *   @retval float Ratio of skipped to total routed channel process cycles since previous call (0..1)
+ */
+float getSilenceSaving();
+
+/** @brief  Map a MIDI CC received on the mixer MIDI input to a mixer parameter
+ *   @param  midiChan MIDI channel [0..15]
+ *   @param  cc MIDI CC number [0..127] (MSB [0..31] if 14-bit)
+ *   @param  channel Index of mixer channel
+ *   @param  param Mixer parameter (MIXER_PARAM_xxx, MIXER_PARAM_NONE to remove mapping)
+ *   @param  flags Bitwise MIXER_CC_xxx flags
+ *   @retval uint8_t 1 on success
+ *   @note   CC is processed within JACK process callback. Changes are notified via OSC and getMidiChanges.
+ */
+uint8_t setMidiCcMap(uint8_t midiChan, uint8_t cc, uint8_t channel, uint8_t param, uint8_t flags);
+
+/** @brief  Get mixer parameter mapped to a MIDI CC
+ *   @param  midiChan MIDI channel [0..15]
+ *   @param  cc MIDI CC number [0..127]
+ *   @param  channel Pointer to populate with index of mixer channel (may be NULL)
+ *   @param  flags Pointer to populate with bitwise MIXER_CC_xxx flags (may be NULL)
+ *   @retval uint8_t Mixer parameter (MIXER_PARAM_NONE if not mapped)
+ */
+uint8_t getMidiCcMap(uint8_t midiChan, uint8_t cc, uint8_t* channel, uint8_t* flags);
+
+/** @brief  Remove all MIDI CC mappings and cancel MIDI learn
+ */
+void clearMidiCcMap();
+
+/** @brief  Map next MIDI CC received on the mixer MIDI input to a mixer parameter
+ *   @param  channel Index of mixer channel
+ *   @param  param Mixer parameter (MIXER_PARAM_xxx, MIXER_PARAM_NONE to cancel learn)
+ *   @param  flags Bitwise MIXER_CC_xxx flags
+ */
+void learnMidiCc(uint8_t channel, uint8_t param, uint8_t flags);
+
+/** @brief  Check if waiting for MIDI learn
+ *   @retval uint8_t 1 if waiting for a MIDI CC to learn
+ */
+uint8_t isMidiLearning();
+
+/** @brief  Get channels with parameters changed by MIDI CC
+ *   @retval uint32_t Bitmask of mixer channels changed since last call
+ */
+uint32_t getMidiChanges();
+
+/** @brief  Start capturing process thread inputs and API calls to a log for replay
+ *   @param  filename Full path and filename of log
+ *   @retval uint8_t 1 on success
+ */
+uint8_t startCapture(const char* filename);
+
+/** @brief  Stop capture and close log
+ */
+void stopCapture();
+
+/** @brief  Check if capture is running
+ *   @retval uint8_t 1 if capturing
+ */
+uint8_t isCapturing();
+
+/** @brief  Replay a capture log, checking that outputs match those captured
+ *   @param  filename Full path and filename of log
+ *   @retval int32_t -1 if all outputs match, index of first period that differs or -2 on error
+ *   @note   Replay drives the process callback so must be called without a JACK client (before init)
+ */
+int32_t replayCapture(const char* filename);
@@ -0,0 +1,178 @@
+/*  Defines AnalogClock class providing audio rate sync pulse generation and detection
+ *
+ *   Copyright (c) 2020 Brian Walton
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "analogclock.h"
+#include <cmath> // provides llround
+
+bool AnalogClock::isValidPpqn(uint8_t ppqn) {
+    if (ppqn == 0 || ppqn > ANALOGCLOCK_MAX_PPQN)
+        return false;
+    return (PPQN % ppqn == 0) || (ppqn % PPQN == 0);
+}
+
+void AnalogClock::setOutputPpqn(uint8_t ppqn) {
+    if (ppqn && !isValidPpqn(ppqn))
+        return;
+    m_nOutputPpqn = ppqn;
+}
+
+uint8_t AnalogClock::getOutputPpqn() { return m_nOutputPpqn; }
+
+void AnalogClock::setPulseWidth(uint32_t frames) { m_nPulseWidth = frames ? frames : 1; }
+
+void AnalogClock::clock(double dTime, double dFramesPerClock, uint8_t nClock) {
+    if (m_nOutputPpqn == 0)
+        return;
+    uint8_t nPulses = 1;
+    if (m_nOutputPpqn < PPQN) {
+        if (nClock % (PPQN / m_nOutputPpqn))
+            return;
+    } else {
+        nPulses = m_nOutputPpqn / PPQN;
+    }
+    for (uint8_t nPulse = 0; nPulse < nPulses; ++nPulse) {
+        if (m_nPulses >= ANALOGCLOCK_MAX_PULSES)
+            return; // Should not happen unless period is very long
+        double dPulse = dTime + nPulse * dFramesPerClock / nPulses;
+        m_aPulses[(m_nPulseStart + m_nPulses++) % ANALOGCLOCK_MAX_PULSES] = dPulse < 0.0 ? 0 : uint64_t(llround(dPulse));
+    }
+}
+
+void AnalogClock::render(float* pBuffer, uint64_t nNow, uint32_t nFrames) {
+    uint64_t nEnd = nNow + nFrames;
+    for (uint16_t nPulse = 0; nPulse < m_nPulses; ++nPulse) {
+        uint64_t nStart = m_aPulses[(m_nPulseStart + nPulse) % ANALOGCLOCK_MAX_PULSES];
+        if (nStart >= nEnd)
+            break; // Pulses are in time order so remainder are in later periods
+        uint64_t nStop = nStart + m_nPulseWidth;
+        for (uint64_t nFrame = nStart < nNow ? nNow : nStart; nFrame < nStop && nFrame < nEnd; ++nFrame)
+            pBuffer[nFrame - nNow] = 1.0;
+    }
+    // Remove pulses that have completed
+    while (m_nPulses && m_aPulses[m_nPulseStart] + m_nPulseWidth <= nEnd) {
+        m_nPulseStart = (m_nPulseStart + 1) % ANALOGCLOCK_MAX_PULSES;
+        --m_nPulses;
+    }
+}
+
+void AnalogClock::setInputPpqn(uint8_t ppqn) {
+    if (!isValidPpqn(ppqn))
+        return;
+    m_nInputPpqn = ppqn;
+    m_dLastEdge  = -1.0; // Restart measurement
+}
+
+uint8_t AnalogClock::getInputPpqn() { return m_nInputPpqn; }
+
+void AnalogClock::setThreshold(float level) {
+    if (level < 0.01 || level > 1.0)
+        return;
+    m_fThreshold = level;
+}
+
+float AnalogClock::getThreshold() { return m_fThreshold; }
+
+void AnalogClock::setEdge(uint8_t edge) {
+    if (edge > SYNC_EDGE_FALLING)
+        return;
+    m_nEdge = edge;
+}
+
+uint8_t AnalogClock::getEdge() { return m_nEdge; }
+
+uint32_t AnalogClock::detect(const float* pBuffer, uint64_t nNow, uint32_t nFrames, double* pEdges, uint32_t nMaxEdges) {
+    uint32_t nEdges = 0;
+    float fLow      = m_fThreshold / 2;
+    float fLast     = m_fLastSample;
+    for (uint32_t nFrame = 0; nFrame < nFrames; ++nFrame) {
+        float fSample = pBuffer[nFrame];
+        float fLevel  = 0.0; // Level crossed by this sample
+        bool bEdge    = false;
+        if (!m_bHigh && fSample >= m_fThreshold) {
+            m_bHigh = true;
+            fLevel  = m_fThreshold;
+            bEdge   = (m_nEdge == SYNC_EDGE_RISING);
+        } else if (m_bHigh && fSample < fLow) {
+            m_bHigh = false;
+            fLevel  = fLow;
+            bEdge   = (m_nEdge == SYNC_EDGE_FALLING);
+        }
+        if (bEdge && nEdges < nMaxEdges) {
+            // Interpolate position of crossing between previous sample and this sample
+            double dFraction = (fSample != fLast) ? (fLevel - fLast) / (fSample - fLast) : 1.0;
+            if (dFraction < 0.0 || dFraction > 1.0)
+                dFraction = 1.0;
+            pEdges[nEdges++] = double(nNow) + nFrame - 1.0 + dFraction;
+        }
+        fLast = fSample;
+    }
+    m_fLastSample = fLast;
+    return nEdges;
+}
+
+double AnalogClock::edge(double dTime, double dFramesPerClock, std::queue<std::pair<double, double>>* pQueue) {
+    // Add clocks subdividing previous pulse - any not yet due are added at this edge
+    fill(pQueue, dTime);
+    for (; m_nPendingClocks; --m_nPendingClocks)
+        if (pQueue)
+            pQueue->push(std::pair<double, double>(dTime, m_dClockSpacing));
+
+    double dExpected = dFramesPerClock * PPQN / m_nInputPpqn; // Frames between edges at current tempo
+    double dBeat     = 0.0;
+    if (m_dLastEdge < 0.0 || dTime - m_dLastEdge > ANALOGCLOCK_TIMEOUT * dExpected) {
+        // First edge or edges resumed after a pause so restart measurement from this edge
+        m_nEdgeCount = 0;
+        m_dBeatStart = dTime;
+    } else {
+        dExpected = dTime - m_dLastEdge;
+        if (++m_nEdgeCount >= m_nInputPpqn) {
+            dBeat        = dTime - m_dBeatStart;
+            m_nEdgeCount = 0;
+            m_dBeatStart = dTime;
+        }
+    }
+    m_dLastEdge = dTime;
+
+    if (m_nInputPpqn > PPQN) {
+        // Several edges per clock so add clock at first edge of each group
+        if (m_nEdgeCount % (m_nInputPpqn / PPQN) == 0 && pQueue)
+            pQueue->push(std::pair<double, double>(dTime, dExpected * m_nInputPpqn / PPQN));
+        return dBeat;
+    }
+    // Clock at edge then clocks subdividing interval until next edge, assuming it is the same as the last interval
+    uint8_t nClocks = PPQN / m_nInputPpqn;
+    m_dClockSpacing = dExpected / nClocks;
+    if (pQueue)
+        pQueue->push(std::pair<double, double>(dTime, m_dClockSpacing));
+    m_dNextClock     = dTime + m_dClockSpacing;
+    m_nPendingClocks = nClocks - 1;
+    return dBeat;
+}
+
+void AnalogClock::fill(std::queue<std::pair<double, double>>* pQueue, double dEnd) {
+    if (!pQueue) {
+        m_nPendingClocks = 0;
+        return;
+    }
+    while (m_nPendingClocks && m_dNextClock < dEnd) {
+        pQueue->push(std::pair<double, double>(m_dNextClock, m_dClockSpacing));
+        m_dNextClock += m_dClockSpacing;
+        --m_nPendingClocks;
+    }
+}
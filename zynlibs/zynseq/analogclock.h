@@ -0,0 +1,148 @@
+/*  Declares AnalogClock class providing audio rate sync pulse generation and detection
+ *
+ *   Copyright (c) 2020 Brian Walton
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#pragma once
+
+#include "pattern.h" //provides PPQN
+#include <cstdint>   //provides uint data types
+#include <queue>     //provides queue of clock positions
+
+#define ANALOGCLOCK_MAX_PULSES 256 // Maximum quantity of output pulses pending or in progress
+#define ANALOGCLOCK_MAX_EDGES 64   // Maximum quantity of input edges detected in one period
+#define ANALOGCLOCK_MAX_PPQN 96    // Highest pulses per quarter note of sync input or output
+#define ANALOGCLOCK_TIMEOUT 4.0    // Quantity of expected pulse intervals without an edge after which input restarts (tempo taken from next edges)
+
+#define SYNC_EDGE_RISING 0  // Detect sync input pulse on transition above threshold
+#define SYNC_EDGE_FALLING 1 // Detect sync input pulse on transition below half threshold
+
+/** AnalogClock class renders sync pulses (Volca / Pocket Operator / modular style) to an audio buffer at the sample nearest each pulse and detects
+ *  sync pulses in an audio buffer, recovering clocks (PPQN per quarter note) from them. Pulses in and out may be at any rate that divides into or is a
+ *  multiple of the clock rate. Input pulses below the clock rate are subdivided using the interval between the two most recent pulses.
+ *  Contains no pointers so may be copied to save and restore its state.
+ */
+class AnalogClock {
+  public:
+    /** @brief  Set quantity of output pulses per quarter note
+     *   @param  ppqn Pulses per quarter note [0 to disable, 1, 2, 3, 4, 6, 8, 12, 24, 48, 72, 96]
+     */
+    void setOutputPpqn(uint8_t ppqn);
+
+    /** @brief  Get quantity of output pulses per quarter note
+     *   @retval uint8_t Pulses per quarter note (0 if disabled)
+     */
+    uint8_t getOutputPpqn();
+
+    /** @brief  Set duration of output pulses
+     *   @param  frames Pulse width in frames
+     */
+    void setPulseWidth(uint32_t frames);
+
+    /** @brief  Add output pulses due at a clock
+     *   @param  dTime Frame time of clock
+     *   @param  dFramesPerClock Frames until next clock
+     *   @param  nClock Index of clock within beat [0..PPQN-1]
+     */
+    void clock(double dTime, double dFramesPerClock, uint8_t nClock);
+
+    /** @brief  Render output pulses to audio buffer
+     *   @param  pBuffer Pointer to audio buffer (cleared by caller)
+     *   @param  nNow Frame time at start of period
+     *   @param  nFrames Quantity of frames in period
+     *   @note   Pulses started in earlier periods are completed so call every period, including when transport is stopped
+     */
+    void render(float* pBuffer, uint64_t nNow, uint32_t nFrames);
+
+    /** @brief  Set quantity of input pulses per quarter note
+     *   @param  ppqn Pulses per quarter note [1, 2, 3, 4, 6, 8, 12, 24, 48, 72, 96]
+     */
+    void setInputPpqn(uint8_t ppqn);
+
+    /** @brief  Get quantity of input pulses per quarter note
+     *   @retval uint8_t Pulses per quarter note
+     */
+    uint8_t getInputPpqn();
+
+    /** @brief  Set level of input pulse detection
+     *   @param  level Threshold [0.01..1.0] - falling edges are detected at half this level to reject noise
+     */
+    void setThreshold(float level);
+
+    /** @brief  Get level of input pulse detection
+     *   @retval float Threshold
+     */
+    float getThreshold();
+
+    /** @brief  Set which transition of input pulses is detected
+     *   @param  edge [SYNC_EDGE_RISING | SYNC_EDGE_FALLING]
+     */
+    void setEdge(uint8_t edge);
+
+    /** @brief  Get which transition of input pulses is detected
+     *   @retval uint8_t Edge [SYNC_EDGE_RISING | SYNC_EDGE_FALLING]
+     */
+    uint8_t getEdge();
+
+    /** @brief  Detect pulse edges in audio buffer
+     *   @param  pBuffer Pointer to audio buffer
+     *   @param  nNow Frame time at start of period
+     *   @param  nFrames Quantity of frames in period
+     *   @param  pEdges Pointer to array populated with frame time of each edge, interpolated between samples either side of threshold
+     *   @param  nMaxEdges Size of pEdges array
+     *   @retval uint32_t Quantity of edges detected
+     */
+    uint32_t detect(const float* pBuffer, uint64_t nNow, uint32_t nFrames, double* pEdges, uint32_t nMaxEdges);
+
+    /** @brief  Recover clocks from an input edge
+     *   @param  dTime Frame time of edge
+     *   @param  dFramesPerClock Frames per clock at current tempo, used until the interval between edges is known
+     *   @param  pQueue Pointer to queue of clock positions (frame time) and durations (frames) or NULL to track tempo without adding clocks
+     *   @retval double Duration of the beat ending at this edge in frames or 0 if not the end of a measured beat
+     *   @note   Clocks subdividing the previous pulse that are not yet due are added at this edge so that no clock is lost when tempo increases
+     */
+    double edge(double dTime, double dFramesPerClock, std::queue<std::pair<double, double>>* pQueue);
+
+    /** @brief  Add clocks subdividing the last input pulse that are due before end of period
+     *   @param  pQueue Pointer to queue of clock positions or NULL to discard pending clocks
+     *   @param  dEnd Frame time at end of period
+     */
+    void fill(std::queue<std::pair<double, double>>* pQueue, double dEnd);
+
+  private:
+    bool isValidPpqn(uint8_t ppqn);
+
+    // Output
+    uint8_t m_nOutputPpqn = 0;                  // Output pulses per quarter note (0 if disabled)
+    uint32_t m_nPulseWidth = 240;               // Output pulse duration in frames
+    uint64_t m_aPulses[ANALOGCLOCK_MAX_PULSES]; // Frame time of start of each pending or sounding pulse (ring)
+    uint16_t m_nPulseStart = 0;                 // Index of oldest pulse
+    uint16_t m_nPulses     = 0;                 // Quantity of pulses
+
+    // Input
+    uint8_t m_nInputPpqn   = 2;                // Input pulses per quarter note
+    uint8_t m_nEdge        = SYNC_EDGE_RISING; // Transition detected
+    float m_fThreshold     = 0.2;              // Detection level
+    bool m_bHigh           = false;            // True if input is above threshold (until it falls below half threshold)
+    float m_fLastSample    = 0.0;              // Last sample of previous period
+    uint8_t m_nEdgeCount   = 0;                // Quantity of edges since start of beat
+    double m_dLastEdge     = -1.0;             // Frame time of last edge (negative if none)
+    double m_dBeatStart    = -1.0;             // Frame time of edge at start of beat (negative if not measuring)
+    double m_dNextClock    = 0.0;              // Frame time of next clock subdividing last pulse
+    double m_dClockSpacing = 0.0;              // Frames between clocks subdividing last pulse
+    uint8_t m_nPendingClocks = 0;              // Quantity of clocks subdividing last pulse not yet added to queue
+};
@@ -0,0 +1,351 @@
+/*  Defines Arrangement class providing a linear song timeline
+ *
+ *   Copyright (c) 2020 Brian Walton
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "arrangement.h"
+#include <algorithm>
+
+// Order of events at same time: timebase changes first, then stops before launches so that a launch is not immediately stopped
+static uint8_t getEventRank(uint8_t type) {
+    switch (type) {
+    case ARRANGEMENT_TIMESIG:
+        return 0;
+    case ARRANGEMENT_TEMPO:
+        return 1;
+    case ARRANGEMENT_SCENE:
+        return 2;
+    case ARRANGEMENT_STOP:
+        return 3;
+    default:
+        return 4;
+    }
+}
+
+static bool isEarlier(const ArrangementEvent& a, const ArrangementEvent& b) {
+    if (a.bar != b.bar)
+        return a.bar < b.bar;
+    if (a.tick != b.tick)
+        return a.tick < b.tick;
+    return getEventRank(a.type) < getEventRank(b.type);
+}
+
+// Tempo and time signature events are unique at each time, launch events are unique per sequence
+static bool isSameEvent(const ArrangementEvent& event, uint16_t bar, uint32_t tick, uint8_t type, uint32_t value) {
+    if (event.bar != bar || event.tick != tick || event.type != type)
+        return false;
+    return type == ARRANGEMENT_TEMPO || type == ARRANGEMENT_TIMESIG || event.value == value;
+}
+
+// Set play position of sequence and all its tracks
+static void setSequencePosition(Sequence* pSequence, uint32_t position) {
+    pSequence->setPlayPosition(position);
+    for (uint32_t nTrack = 0; nTrack < pSequence->getTracks(); ++nTrack)
+        pSequence->getTrack(nTrack)->setPosition(position);
+}
+
+Arrangement::Arrangement() { compile(44100, 1920.0, DEFAULT_TEMPO, 4, 4); }
+
+void Arrangement::enable(bool enable) {
+    m_bEnabled = enable;
+    m_bDirty   = true;
+}
+
+bool Arrangement::isEnabled() { return m_bEnabled; }
+
+void Arrangement::addEvent(uint16_t bar, uint32_t tick, uint8_t type, uint32_t value) {
+    if (type == ARRANGEMENT_TIMESIG)
+        tick = 0; // Time signature may only change at start of bar
+    for (auto it = m_vEvents.begin(); it != m_vEvents.end(); ++it) {
+        if (isSameEvent(*it, bar, tick, type, value)) {
+            it->value = value;
+            m_bDirty  = true;
+            return;
+        }
+    }
+    ArrangementEvent event = {bar, type, tick, value};
+    m_vEvents.insert(std::upper_bound(m_vEvents.begin(), m_vEvents.end(), event, isEarlier), event);
+    m_bDirty = true;
+    reserveTables();
+}
+
+void Arrangement::reserveTables() {
+    // Each launch may make one sequence active and each scene may make every sequence of a bank active
+    size_t nActive = 0;
+    for (auto it = m_vEvents.begin(); it != m_vEvents.end(); ++it)
+        if (it->type == ARRANGEMENT_LAUNCH)
+            ++nActive;
+        else if (it->type == ARRANGEMENT_SCENE)
+            nActive += 256;
+    m_vSegments.reserve(m_vEvents.size() + 1);
+    m_vLaunches.reserve(m_vEvents.size());
+    m_vActive.reserve(nActive);
+}
+
+void Arrangement::removeEvent(uint16_t bar, uint32_t tick, uint8_t type, uint32_t value) {
+    for (auto it = m_vEvents.begin(); it != m_vEvents.end(); ++it) {
+        if (isSameEvent(*it, bar, tick, type, value)) {
+            m_vEvents.erase(it);
+            m_bDirty = true;
+            return;
+        }
+    }
+}
+
+void Arrangement::clear() {
+    m_vEvents.clear();
+    m_bDirty = true;
+}
+
+uint32_t Arrangement::getEventQuant() { return m_vEvents.size(); }
+
+ArrangementEvent* Arrangement::getEvent(uint32_t index) {
+    if (index >= m_vEvents.size())
+        return NULL;
+    return &(m_vEvents[index]);
+}
+
+bool Arrangement::isDirty() { return m_bDirty; }
+
+void Arrangement::setDirty() { m_bDirty = true; }
+
+void Arrangement::compile(uint32_t sampleRate, double ticksPerBeat, double tempo, uint8_t beatsPerBar, uint8_t beatType) {
+    m_dTicksPerBeat  = ticksPerBeat;
+    m_dTicksPerClock = ticksPerBeat / PPQN;
+    if (beatsPerBar == 0)
+        beatsPerBar = 4;
+    m_vSegments.clear();
+    m_vLaunches.clear();
+
+    ArrangementSegment segment;
+    segment.frame         = 0;
+    segment.songTick      = 0;
+    segment.bar           = 0;
+    segment.barTick       = 0;
+    segment.ticksPerBar   = ticksPerBeat * beatsPerBar;
+    segment.tempo         = tempo;
+    segment.framesPerTick = 60.0 * sampleRate / (tempo * ticksPerBeat);
+    segment.beatsPerBar   = beatsPerBar;
+    segment.beatType      = beatType;
+
+    if (m_bEnabled) {
+        // Split timeline into segments at each tempo and time signature change
+        for (auto it = m_vEvents.begin(); it != m_vEvents.end(); ++it) {
+            if (it->type != ARRANGEMENT_TEMPO && it->type != ARRANGEMENT_TIMESIG)
+                continue;
+            double dSongTick = segment.songTick + (double(it->bar) - segment.bar) * segment.ticksPerBar + double(it->tick) - segment.barTick;
+            if (dSongTick > segment.songTick) {
+                m_vSegments.push_back(segment);
+                segment.frame += (dSongTick - segment.songTick) * segment.framesPerTick;
+                segment.songTick = dSongTick;
+                segment.bar      = it->bar + it->tick / segment.ticksPerBar;
+                segment.barTick  = it->tick % segment.ticksPerBar;
+            }
+            if (it->type == ARRANGEMENT_TEMPO && it->value) {
+                segment.tempo         = it->value / 100.0;
+                segment.framesPerTick = 60.0 * sampleRate / (segment.tempo * ticksPerBeat);
+            } else if (it->type == ARRANGEMENT_TIMESIG && (it->value >> 8)) {
+                segment.beatsPerBar = it->value >> 8;
+                segment.beatType    = it->value & 0xFF;
+                segment.ticksPerBar = ticksPerBeat * segment.beatsPerBar;
+            }
+        }
+    }
+    m_vSegments.push_back(segment);
+
+    if (m_bEnabled) {
+        // Convert launch events to clock cycles from start of song
+        for (auto it = m_vEvents.begin(); it != m_vEvents.end(); ++it) {
+            if (it->type != ARRANGEMENT_LAUNCH && it->type != ARRANGEMENT_STOP && it->type != ARRANGEMENT_SCENE)
+                continue;
+            ArrangementLaunch launch = {uint32_t(getSongTick(it->bar, it->tick) / m_dTicksPerClock), it->type, it->value};
+            m_vLaunches.push_back(launch);
+        }
+    }
+    m_nNextLaunch = 0;
+    m_bDirty      = false;
+}
+
+ArrangementSegment* Arrangement::findSegmentByFrame(double frame) {
+    auto it = std::upper_bound(m_vSegments.begin(), m_vSegments.end(), frame,
+                               [](double frame, const ArrangementSegment& segment) { return frame < segment.frame; });
+    if (it != m_vSegments.begin())
+        --it;
+    return &(*it);
+}
+
+ArrangementSegment* Arrangement::findSegmentByBar(uint32_t bar, uint32_t tick) {
+    auto it = std::upper_bound(m_vSegments.begin(), m_vSegments.end(), std::pair<uint32_t, uint32_t>(bar, tick),
+                               [](const std::pair<uint32_t, uint32_t>& pos, const ArrangementSegment& segment) {
+                                   return pos.first < segment.bar || (pos.first == segment.bar && pos.second < segment.barTick);
+                               });
+    if (it != m_vSegments.begin())
+        --it;
+    return &(*it);
+}
+
+ArrangementSegment* Arrangement::getSegmentAtTick(double songTick) {
+    auto it = std::upper_bound(m_vSegments.begin(), m_vSegments.end(), songTick,
+                               [](double tick, const ArrangementSegment& segment) { return tick < segment.songTick; });
+    if (it != m_vSegments.begin())
+        --it;
+    return &(*it);
+}
+
+double Arrangement::getSongTick(uint32_t bar, uint32_t tick) {
+    ArrangementSegment* pSegment = findSegmentByBar(bar, tick);
+    return pSegment->songTick + (double(bar) - pSegment->bar) * pSegment->ticksPerBar + double(tick) - pSegment->barTick;
+}
+
+void Arrangement::getBBTAtTick(double songTick, jack_position_t* pPosition) {
+    ArrangementSegment* pSegment = getSegmentAtTick(songTick);
+    // Ticks from start of the bar in which segment starts
+    double dTicks                = pSegment->barTick + songTick - pSegment->songTick;
+    uint32_t nBars               = dTicks / pSegment->ticksPerBar;
+    double dTickInBar            = dTicks - double(nBars) * pSegment->ticksPerBar;
+    uint32_t nBeat               = dTickInBar / m_dTicksPerBeat;
+    if (nBeat >= pSegment->beatsPerBar)
+        nBeat = pSegment->beatsPerBar - 1;
+    pPosition->bar              = pSegment->bar + nBars + 1;
+    pPosition->beat             = nBeat + 1;
+    pPosition->tick             = dTickInBar - nBeat * m_dTicksPerBeat;
+    pPosition->bar_start_tick   = songTick - dTickInBar;
+    pPosition->beats_per_bar    = pSegment->beatsPerBar;
+    pPosition->beat_type        = pSegment->beatType;
+    pPosition->ticks_per_beat   = m_dTicksPerBeat;
+    pPosition->beats_per_minute = pSegment->tempo;
+    pPosition->valid            = JackPositionBBT;
+}
+
+double Arrangement::getBBT(jack_position_t* pPosition) {
+    ArrangementSegment* pSegment = findSegmentByFrame(pPosition->frame);
+    double dSongTick             = pSegment->songTick + (pPosition->frame - pSegment->frame) / pSegment->framesPerTick;
+    getBBTAtTick(dSongTick, pPosition);
+    return dSongTick;
+}
+
+double Arrangement::getFrame(uint32_t bar, uint32_t beat, uint32_t tick) {
+    uint32_t nBarTick            = beat * m_dTicksPerBeat + tick;
+    ArrangementSegment* pSegment = findSegmentByBar(bar, nBarTick);
+    double dTicks                = (double(bar) - pSegment->bar) * pSegment->ticksPerBar + double(nBarTick) - pSegment->barTick;
+    return pSegment->frame + dTicks * pSegment->framesPerTick;
+}
+
+double Arrangement::getFrameAtTick(double songTick) {
+    ArrangementSegment* pSegment = getSegmentAtTick(songTick);
+    return pSegment->frame + (songTick - pSegment->songTick) * pSegment->framesPerTick;
+}
+
+uint32_t Arrangement::getEndClock() {
+    if (m_vLaunches.empty())
+        return 0;
+    return m_vLaunches.back().clock;
+}
+
+void Arrangement::clock(uint32_t clock, SequenceManager* pSeqMan) {
+    while (m_nNextLaunch < m_vLaunches.size() && m_vLaunches[m_nNextLaunch].clock <= clock) {
+        ArrangementLaunch* pLaunch = &(m_vLaunches[m_nNextLaunch++]);
+        if (pLaunch->clock < clock)
+            continue; // Missed (should not happen unless locate failed)
+        uint8_t nBank       = pLaunch->value >> 8;
+        Sequence* pSequence = NULL;
+        switch (pLaunch->type) {
+        case ARRANGEMENT_LAUNCH:
+            if (!(pSequence = pSeqMan->findSequence(nBank, pLaunch->value & 0xFF)))
+                break; // Target sequence does not exist
+            pSeqMan->setSequencePlayState(nBank, pLaunch->value & 0xFF, PLAYING);
+            setSequencePosition(pSequence, 0);
+            break;
+        case ARRANGEMENT_STOP:
+            if (pSeqMan->findSequence(nBank, pLaunch->value & 0xFF))
+                pSeqMan->setSequencePlayState(nBank, pLaunch->value & 0xFF, STOPPED);
+            break;
+        case ARRANGEMENT_SCENE:
+            pSeqMan->stop();
+            for (uint32_t nSequence = 0; (pSequence = pSeqMan->findSequence(pLaunch->value, nSequence)); ++nSequence) {
+                if (pSequence->isEmpty())
+                    continue;
+                pSeqMan->setSequencePlayState(pLaunch->value, nSequence, PLAYING);
+                setSequencePosition(pSequence, 0);
+            }
+            break;
+        }
+    }
+}
+
+void Arrangement::locate(uint32_t clock, SequenceManager* pSeqMan) {
+    // Replay launch events before this clock to find which sequences should be playing and when each started
+    m_vActive.clear();
+    auto launch = [&](uint8_t bank, uint8_t sequence, uint32_t start) {
+        Sequence* pSequence = pSeqMan->findSequence(bank, sequence);
+        if (!pSequence)
+            return; // Target sequence does not exist
+        uint8_t nGroup = pSequence->getGroup();
+        for (auto it = m_vActive.begin(); it != m_vActive.end();) {
+            if (pSeqMan->findSequence(it->sequence >> 8, it->sequence & 0xFF)->getGroup() == nGroup)
+                it = m_vActive.erase(it);
+            else
+                ++it;
+        }
+        if (m_vActive.size() < m_vActive.capacity()) // Table is preallocated when events change
+            m_vActive.push_back({uint16_t((bank << 8) | sequence), start});
+    };
+    for (m_nNextLaunch = 0; m_nNextLaunch < m_vLaunches.size() && m_vLaunches[m_nNextLaunch].clock < clock; ++m_nNextLaunch) {
+        ArrangementLaunch* pLaunch = &(m_vLaunches[m_nNextLaunch]);
+        Sequence* pSequence        = NULL;
+        switch (pLaunch->type) {
+        case ARRANGEMENT_LAUNCH:
+            launch(pLaunch->value >> 8, pLaunch->value & 0xFF, pLaunch->clock);
+            break;
+        case ARRANGEMENT_STOP:
+            m_vActive.erase(std::remove_if(m_vActive.begin(), m_vActive.end(), [&](const ArrangementActive& active) { return active.sequence == pLaunch->value; }),
+                            m_vActive.end());
+            break;
+        case ARRANGEMENT_SCENE:
+            m_vActive.clear();
+            for (uint32_t nSequence = 0; (pSequence = pSeqMan->findSequence(pLaunch->value, nSequence)); ++nSequence)
+                if (!pSequence->isEmpty())
+                    launch(pLaunch->value, nSequence, pLaunch->clock);
+            break;
+        }
+    }
+
+    // Start sequences in order of bank and sequence
+    std::sort(m_vActive.begin(), m_vActive.end(), [](const ArrangementActive& a, const ArrangementActive& b) { return a.sequence < b.sequence; });
+    pSeqMan->stop();
+    for (auto it = m_vActive.begin(); it != m_vActive.end(); ++it) {
+        Sequence* pSequence = pSeqMan->findSequence(it->sequence >> 8, it->sequence & 0xFF);
+        uint32_t nLength    = pSequence->getLength();
+        uint32_t nElapsed   = clock - it->clock;
+        if (nLength == 0)
+            continue;
+        switch (pSequence->getPlayMode()) {
+        case DISABLED:
+            continue;
+        case ONESHOT:
+        case ONESHOTALL:
+        case ONESHOTSYNC:
+            if (nElapsed >= nLength)
+                continue; // Already finished
+            break;
+        default:
+            nElapsed %= nLength;
+        }
+        pSeqMan->setSequencePlayState(it->sequence >> 8, it->sequence & 0xFF, PLAYING);
+        setSequencePosition(pSequence, nElapsed);
+    }
+}
@@ -0,0 +1,207 @@
+/*  Declares Arrangement class providing a linear song timeline
+ *
+ *   Copyright (c) 2020 Brian Walton
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#pragma once
+
+#include "constants.h"
+#include "sequencemanager.h"
+#include <cstdint> //provides uint data types
+#include <jack/transport.h>
+#include <vector>
+
+// Arrangement event types
+#define ARRANGEMENT_TEMPO 1   // Change tempo. Value: tempo in 1/100 BPM
+#define ARRANGEMENT_TIMESIG 2 // Change time signature at start of bar. Value: beats per bar << 8 | beat type
+#define ARRANGEMENT_LAUNCH 3  // Start a sequence from its beginning. Value: bank << 8 | sequence
+#define ARRANGEMENT_STOP 4    // Stop a sequence. Value: bank << 8 | sequence
+#define ARRANGEMENT_SCENE 5   // Stop all sequences and start every sequence in a bank (scene). Value: bank
+
+struct ArrangementEvent {
+    uint16_t bar;   // Bar at which event occurs in timeline (zero based)
+    uint8_t type;   // Event type [ARRANGEMENT_TEMPO | ARRANGEMENT_TIMESIG | ARRANGEMENT_LAUNCH | ARRANGEMENT_STOP | ARRANGEMENT_SCENE]
+    uint32_t tick;  // Tick within bar at which event occurs (0 for time signature)
+    uint32_t value; // Event value (dependant on type)
+};
+
+// A section of the timeline with constant tempo and time signature
+struct ArrangementSegment {
+    double frame;         // Frames from start of song to start of segment
+    double songTick;      // Ticks from start of song to start of segment
+    uint32_t bar;         // Bar at start of segment (zero based)
+    uint32_t barTick;     // Tick within bar at start of segment
+    uint32_t ticksPerBar; // Quantity of ticks in each bar of segment
+    double tempo;         // Tempo in beats per minute
+    double framesPerTick; // Quantity of frames in each tick
+    uint8_t beatsPerBar;  // Time signature numerator
+    uint8_t beatType;     // Time signature denominator
+};
+
+// A sequence launch or stop at a fixed clock position within the song
+struct ArrangementLaunch {
+    uint32_t clock; // Clock cycles from start of song
+    uint8_t type;   // [ARRANGEMENT_LAUNCH | ARRANGEMENT_STOP | ARRANGEMENT_SCENE]
+    uint32_t value; // Event value
+};
+
+// A sequence that would be playing at a located position
+struct ArrangementActive {
+    uint16_t sequence; // bank << 8 | sequence
+    uint32_t clock;    // Clock cycles from start of song to launch of sequence
+};
+
+/** Arrangement class provides a linear timeline of sequence launches with tempo and time signature events
+ *   Events are compiled into a table of segments sorted by time allowing binary search conversion between frames and BBT
+ */
+class Arrangement {
+  public:
+    /** @brief  Construct arrangement object
+     */
+    Arrangement();
+
+    /** @brief  Enable or disable arrangement
+     *   @param  enable True to play arrangement, false to use single tempo and time signature
+     */
+    void enable(bool enable);
+
+    /** @brief  Check if arrangement is enabled
+     *   @retval bool True if enabled
+     */
+    bool isEnabled();
+
+    /** @brief  Add event to arrangement
+     *   @param  bar Bar at which event occurs (zero based)
+     *   @param  tick Tick within bar at which event occurs
+     *   @param  type Event type [ARRANGEMENT_TEMPO | ARRANGEMENT_TIMESIG | ARRANGEMENT_LAUNCH | ARRANGEMENT_STOP | ARRANGEMENT_SCENE]
+     *   @param  value Event value
+     *   @note   Replaces any existing event of same type and value (or same type for tempo and time signature) at same time
+     */
+    void addEvent(uint16_t bar, uint32_t tick, uint8_t type, uint32_t value);
+
+    /** @brief  Remove event from arrangement
+     *   @param  bar Bar at which event occurs (zero based)
+     *   @param  tick Tick within bar at which event occurs
+     *   @param  type Event type
+     *   @param  value Event value (ignored for tempo and time signature)
+     */
+    void removeEvent(uint16_t bar, uint32_t tick, uint8_t type, uint32_t value);
+
+    /** @brief  Remove all events
+     */
+    void clear();
+
+    /** @brief  Get quantity of events
+     *   @retval uint32_t Quantity of events in arrangement
+     */
+    uint32_t getEventQuant();
+
+    /** @brief  Get event by index
+     *   @param  index Index of event
+     *   @retval ArrangementEvent* Pointer to event or NULL if invalid index
+     */
+    ArrangementEvent* getEvent(uint32_t index);
+
+    /** @brief  Check if events have changed since last compile
+     *   @retval bool True if compile is required
+     */
+    bool isDirty();
+
+    /** @brief  Flag that compile is required, e.g. due to change of default tempo
+     */
+    void setDirty();
+
+    /** @brief  Compile events into segment and launch tables
+     *   @param  sampleRate Samples per second
+     *   @param  ticksPerBeat Ticks in each beat
+     *   @param  tempo Tempo at start of song if not defined by an event
+     *   @param  beatsPerBar Beats per bar at start of song if not defined by an event
+     *   @param  beatType Beat type at start of song if not defined by an event
+     *   @note   Events are ignored when arrangement is disabled
+     */
+    void compile(uint32_t sampleRate, double ticksPerBeat, double tempo, uint8_t beatsPerBar, uint8_t beatType);
+
+    /** @brief  Populate BBT fields of JACK position from its frame
+     *   @param  pPosition Pointer to JACK position structure with frame set
+     *   @retval double Ticks from start of song
+     */
+    double getBBT(jack_position_t* pPosition);
+
+    /** @brief  Populate BBT fields of JACK position at song position
+     *   @param  songTick Ticks from start of song
+     *   @param  pPosition Pointer to JACK position structure to populate
+     */
+    void getBBTAtTick(double songTick, jack_position_t* pPosition);
+
+    /** @brief  Get frame at BBT position
+     *   @param  bar Bar (zero based)
+     *   @param  beat Beat within bar (zero based)
+     *   @param  tick Tick within beat
+     *   @retval double Frames from start of song
+     */
+    double getFrame(uint32_t bar, uint32_t beat, uint32_t tick);
+
+    /** @brief  Get frame at song position
+     *   @param  songTick Ticks from start of song
+     *   @retval double Frames from start of song
+     */
+    double getFrameAtTick(double songTick);
+
+    /** @brief  Get segment in effect at a song position
+     *   @param  songTick Ticks from start of song
+     *   @retval ArrangementSegment* Pointer to segment
+     */
+    ArrangementSegment* getSegmentAtTick(double songTick);
+
+    /** @brief  Get quantity of clock cycles from start of song to last launch event
+     *   @retval uint32_t Clock cycles
+     */
+    uint32_t getEndClock();
+
+    /** @brief  Start and stop sequences due at clock cycle
+     *   @param  clock Clock cycles from start of song
+     *   @param  pSeqMan Pointer to sequence manager
+     *   @note   Call once for each clock cycle, before sequence manager clock. Launches and stops of sequences that do not exist are ignored.
+     */
+    void clock(uint32_t clock, SequenceManager* pSeqMan);
+
+    /** @brief  Set sequences to the play state and position they would have at a clock cycle
+     *   @param  clock Clock cycles from start of song
+     *   @param  pSeqMan Pointer to sequence manager
+     *   @note   Does not allocate memory so may be called from JACK process thread. Launches of sequences that do not exist are ignored.
+     */
+    void locate(uint32_t clock, SequenceManager* pSeqMan);
+
+  private:
+    ArrangementSegment* findSegmentByFrame(double frame);
+    ArrangementSegment* findSegmentByBar(uint32_t bar, uint32_t tick);
+    double getSongTick(uint32_t bar, uint32_t tick);
+
+    /** @brief  Reserve compiled and active launch tables for current events so that compile and locate do not allocate in JACK process thread
+     */
+    void reserveTables();
+
+    std::vector<ArrangementEvent> m_vEvents;     // List of events ordered by time
+    std::vector<ArrangementSegment> m_vSegments; // Compiled segments ordered by time
+    std::vector<ArrangementLaunch> m_vLaunches;  // Compiled launch events ordered by clock
+    std::vector<ArrangementActive> m_vActive;    // Sequences active at located position (preallocated by reserveTables)
+    size_t m_nNextLaunch   = 0;                  // Index of next launch event to process during playback
+    double m_dTicksPerBeat = 1920.0;             // Ticks in each beat
+    double m_dTicksPerClock = 80.0;              // Ticks in each clock cycle
+    bool m_bDirty          = true;               // True if events changed since last compile
+    bool m_bEnabled        = false;              // True to apply events, false for single segment with default tempo and time signature
+};
@@ -0,0 +1,352 @@
+/*  Defines capture and replay of sequencer process inputs
+ *
+ *   Copyright (c) 2020 Brian Walton
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "capture.h"
+#include <atomic> // provides atomic
+#include <stdio.h>
+
+static jack_client_t* s_pClient = NULL;           // Pointer to JACK client
+static jack_port_t* s_aPorts[IO_PORTS] = {NULL};  // Pointers to JACK ports
+static void* s_aBuffers[IO_PORTS]      = {NULL};  // Pointers to port buffers of current period
+
+// Capture
+static bool s_bPeriodCapture   = false;              // True if current period is being captured
+static jack_nframes_t s_nPeriodFrames = 0;           // Quantity of frames in current period
+static bool s_bTimebaseCapture = false;              // True if current timebase callback is being captured
+static float s_aSyncInput[CAPTURE_MAX_FRAMES];       // Sync input of current period being captured (appended to period record)
+static std::atomic<jack_nframes_t> s_nInputLatency{0}; // Capture latency of MIDI input port
+
+// Replay
+static bool s_bReplay = false;                       // True if replaying
+static REPLAY_MIDI* s_aReplayMidi[IO_PORTS]   = {NULL}; // Replay MIDI buffers, indexed by port (NULL for audio ports)
+static float* s_aReplayAudio[IO_PORTS]        = {NULL}; // Replay audio buffers, indexed by port (NULL for MIDI ports)
+static CAPTURE_PERIOD_DATA s_replayPeriod;           // Inputs of current replayed period
+static CAPTURE_TIMEBASE_DATA s_replayTimebase;       // Inputs of current replayed timebase callback
+static uint64_t s_nReplayOutputHash    = 0;          // Hash of MIDI output from last replayed period
+static uint64_t s_nReplayFeedbackHash  = 0;          // Hash of feedback output from last replayed period
+static uint64_t s_nReplayMetronomeHash = 0;          // Hash of metronome output from last replayed period
+static uint64_t s_nReplaySyncHash      = 0;          // Hash of sync output from last replayed period
+static uint64_t s_nReplayTimebaseHash  = 0;          // Hash of position from last replayed timebase callback
+
+// Check if port carries audio
+static bool isAudioPort(uint8_t port) { return port == IO_PORT_METRONOME || port == IO_PORT_SYNC_OUTPUT || port == IO_PORT_SYNC_INPUT; }
+
+// Get period record being populated
+static CAPTURE_PERIOD_DATA* periodRecord() { return (CAPTURE_PERIOD_DATA*)captureRecordFixed(); }
+
+// Hash all events in a MIDI buffer
+static uint64_t hashMidi(void* pBuffer) {
+    uint64_t nHash = CAPTURE_HASH_SEED;
+    if (!pBuffer)
+        return nHash;
+    jack_midi_event_t event;
+    uint32_t nCount = ioMidiGetEventCount(pBuffer);
+    for (uint32_t i = 0; i < nCount; ++i) {
+        if (ioMidiEventGet(&event, pBuffer, i) == 0)
+            nHash = captureHashMidi(nHash, &event);
+    }
+    return nHash;
+}
+
+void ioSetPort(uint8_t port, jack_port_t* pPort) {
+    if (port < IO_PORTS)
+        s_aPorts[port] = pPort;
+}
+
+void ioSetClient(jack_client_t* pClient) { s_pClient = pClient; }
+
+// Start populating record of current period
+static void beginPeriodRecord() {
+    CAPTURE_PERIOD_DATA* pPeriod = (CAPTURE_PERIOD_DATA*)captureRecordBegin(CAPTURE_RECORD_PERIOD, sizeof(CAPTURE_PERIOD_DATA));
+    pPeriod->period              = captureGetPeriod();
+    pPeriod->frames              = s_nPeriodFrames;
+    s_bPeriodCapture             = true;
+}
+
+void ioBeginPeriod(jack_nframes_t nFrames) {
+    s_nPeriodFrames  = nFrames;
+    s_bPeriodCapture = false;
+    if (captureBeginCallback())
+        beginPeriodRecord();
+}
+
+void ioCaptureState(const void* pState, uint32_t nSize) {
+    if (captureState(pState, nSize))
+        beginPeriodRecord();
+}
+
+void ioEndPeriod(jack_nframes_t nFrames) {
+    if (!s_bPeriodCapture && !s_bReplay) {
+        captureEndCallback();
+        return;
+    }
+    uint64_t nOutputHash    = hashMidi(s_aBuffers[IO_PORT_OUTPUT]);
+    uint64_t nFeedbackHash  = hashMidi(s_aBuffers[IO_PORT_FEEDBACK]);
+    uint64_t nMetronomeHash = CAPTURE_HASH_SEED;
+    if (s_aBuffers[IO_PORT_METRONOME])
+        nMetronomeHash = captureHash(CAPTURE_HASH_SEED, s_aBuffers[IO_PORT_METRONOME], sizeof(jack_default_audio_sample_t) * nFrames);
+    uint64_t nSyncHash = CAPTURE_HASH_SEED;
+    if (s_aBuffers[IO_PORT_SYNC_OUTPUT])
+        nSyncHash = captureHash(CAPTURE_HASH_SEED, s_aBuffers[IO_PORT_SYNC_OUTPUT], sizeof(jack_default_audio_sample_t) * nFrames);
+    if (s_bReplay) {
+        s_nReplayOutputHash    = nOutputHash;
+        s_nReplayFeedbackHash  = nFeedbackHash;
+        s_nReplayMetronomeHash = nMetronomeHash;
+        s_nReplaySyncHash      = nSyncHash;
+        captureEndCallback();
+        return;
+    }
+    CAPTURE_PERIOD_DATA* pPeriod = periodRecord();
+    pPeriod->outputHash          = nOutputHash;
+    pPeriod->feedbackHash        = nFeedbackHash;
+    pPeriod->metronomeHash       = nMetronomeHash;
+    pPeriod->syncHash            = nSyncHash;
+    captureRecordAppend(s_aSyncInput, pPeriod->syncFrames * sizeof(float));
+    captureRecordEnd();
+    s_bPeriodCapture = false;
+    captureEndCallback();
+}
+
+void ioBeginTimebase(jack_transport_state_t nState, jack_nframes_t nFrames, jack_position_t* pPosition, int bUpdate) {
+    s_bTimebaseCapture = captureBeginCallback();
+    if (!s_bTimebaseCapture)
+        return;
+    CAPTURE_TIMEBASE_DATA* pTimebase = (CAPTURE_TIMEBASE_DATA*)captureRecordBegin(CAPTURE_RECORD_TIMEBASE, sizeof(CAPTURE_TIMEBASE_DATA));
+    pTimebase->period                = captureGetPeriod();
+    pTimebase->state                 = nState;
+    pTimebase->frames                = nFrames;
+    pTimebase->update                = bUpdate;
+    pTimebase->position              = *pPosition;
+}
+
+void ioEndTimebase(jack_position_t* pPosition) {
+    if (s_bReplay) {
+        s_nReplayTimebaseHash = captureHash(CAPTURE_HASH_SEED, pPosition, sizeof(jack_position_t));
+        captureEndCallback();
+        return;
+    }
+    if (s_bTimebaseCapture) {
+        ((CAPTURE_TIMEBASE_DATA*)captureRecordFixed())->hash = captureHash(CAPTURE_HASH_SEED, pPosition, sizeof(jack_position_t));
+        captureRecordEnd();
+        s_bTimebaseCapture = false;
+    }
+    captureEndCallback();
+}
+
+void* ioGetBuffer(uint8_t port, jack_nframes_t nFrames) {
+    if (port >= IO_PORTS)
+        return NULL;
+    if (s_bReplay) {
+        if (isAudioPort(port))
+            s_aBuffers[port] = s_aReplayAudio[port];
+        else
+            s_aBuffers[port] = s_aReplayMidi[port];
+        return s_aBuffers[port];
+    }
+    s_aBuffers[port] = jack_port_get_buffer(s_aPorts[port], nFrames);
+    if (port == IO_PORT_SYNC_INPUT && s_bPeriodCapture && captureIsProcessThread() && nFrames <= CAPTURE_MAX_FRAMES) {
+        // Record sync input to append to period record
+        memcpy(s_aSyncInput, s_aBuffers[port], sizeof(float) * nFrames);
+        periodRecord()->syncFrames = nFrames;
+    }
+    return s_aBuffers[port];
+}
+
+void ioMidiClearBuffer(void* pBuffer) {
+    if (s_bReplay) {
+        replayMidiClear((REPLAY_MIDI*)pBuffer);
+        return;
+    }
+    jack_midi_clear_buffer(pBuffer);
+    if (s_bPeriodCapture && captureIsProcessThread()) {
+        if (pBuffer == s_aBuffers[IO_PORT_OUTPUT])
+            periodRecord()->outputCapacity = jack_midi_max_event_size(pBuffer);
+        else if (pBuffer == s_aBuffers[IO_PORT_FEEDBACK])
+            periodRecord()->feedbackCapacity = jack_midi_max_event_size(pBuffer);
+    }
+}
+
+size_t ioMidiMaxEventSize(void* pBuffer) {
+    if (s_bReplay)
+        return replayMidiMaxEventSize((REPLAY_MIDI*)pBuffer);
+    return jack_midi_max_event_size(pBuffer);
+}
+
+uint32_t ioMidiGetEventCount(void* pBuffer) {
+    if (s_bReplay)
+        return replayMidiCount((REPLAY_MIDI*)pBuffer);
+    return jack_midi_get_event_count(pBuffer);
+}
+
+int ioMidiEventGet(jack_midi_event_t* pEvent, void* pBuffer, uint32_t index) {
+    if (s_bReplay)
+        return replayMidiGet(pEvent, (REPLAY_MIDI*)pBuffer, index);
+    int nResult = jack_midi_event_get(pEvent, pBuffer, index);
+    if (nResult == 0 && s_bPeriodCapture && pBuffer == s_aBuffers[IO_PORT_INPUT] && captureIsProcessThread()) {
+        // Append MIDI input event to period record
+        if (captureRecordMidi(pEvent))
+            ++periodRecord()->events;
+    }
+    return nResult;
+}
+
+uint8_t* ioMidiEventReserve(void* pBuffer, jack_nframes_t nTime, size_t nSize) {
+    if (s_bReplay)
+        return replayMidiReserve((REPLAY_MIDI*)pBuffer, nTime, nSize);
+    return jack_midi_event_reserve(pBuffer, nTime, nSize);
+}
+
+jack_nframes_t ioLastFrameTime() {
+    if (s_bReplay)
+        return s_replayPeriod.frameTime;
+    jack_nframes_t nFrameTime = jack_last_frame_time(s_pClient);
+    if (s_bPeriodCapture && captureIsProcessThread())
+        periodRecord()->frameTime = nFrameTime;
+    return nFrameTime;
+}
+
+jack_nframes_t ioFrameTime() {
+    if (s_bReplay)
+        return s_replayTimebase.frameTime;
+    jack_nframes_t nFrameTime = jack_frame_time(s_pClient);
+    if (s_bTimebaseCapture && captureIsProcessThread())
+        ((CAPTURE_TIMEBASE_DATA*)captureRecordFixed())->frameTime = nFrameTime;
+    return nFrameTime;
+}
+
+void ioUpdateInputLatency() {
+    if (!s_aPorts[IO_PORT_INPUT])
+        return;
+    jack_latency_range_t range;
+    jack_port_get_latency_range(s_aPorts[IO_PORT_INPUT], JackCaptureLatency, &range);
+    s_nInputLatency = range.max;
+}
+
+jack_nframes_t ioInputLatency() {
+    if (s_bReplay)
+        return s_replayPeriod.inputLatency;
+    jack_nframes_t nLatency = s_nInputLatency;
+    if (s_bPeriodCapture && captureIsProcessThread())
+        periodRecord()->inputLatency = nLatency;
+    return nLatency;
+}
+
+jack_transport_state_t ioTransportQuery(jack_position_t* pPosition) {
+    if (s_bReplay) {
+        if (pPosition) {
+            memset(pPosition, 0, sizeof(jack_position_t));
+            pPosition->frame = s_replayPeriod.transportFrame;
+        }
+        return jack_transport_state_t(s_replayPeriod.transportState);
+    }
+    jack_position_t position;
+    if (!pPosition)
+        pPosition = &position;
+    jack_transport_state_t nState = jack_transport_query(s_pClient, pPosition);
+    if (s_bPeriodCapture && captureIsProcessThread()) {
+        CAPTURE_PERIOD_DATA* pPeriod = periodRecord();
+        pPeriod->transportState      = nState;
+        pPeriod->transportFrame      = pPosition->frame;
+    }
+    return nState;
+}
+
+void ioTransportStart() {
+    if (!s_bReplay)
+        jack_transport_start(s_pClient);
+}
+
+void ioTransportStop() {
+    if (!s_bReplay)
+        jack_transport_stop(s_pClient);
+}
+
+void ioTransportLocate(jack_nframes_t nFrame) {
+    if (!s_bReplay)
+        jack_transport_locate(s_pClient, nFrame);
+}
+
+void ioTransportReposition(jack_position_t* pPosition) {
+    if (!s_bReplay)
+        jack_transport_reposition(s_pClient, pPosition);
+}
+
+void replayStart() {
+    if (s_bReplay)
+        return;
+    for (uint8_t port = 0; port < IO_PORTS; ++port) {
+        if (isAudioPort(port))
+            s_aReplayAudio[port] = new float[CAPTURE_MAX_FRAMES];
+        else
+            s_aReplayMidi[port] = replayMidiCreate();
+    }
+    memset(&s_replayPeriod, 0, sizeof(s_replayPeriod));
+    memset(&s_replayTimebase, 0, sizeof(s_replayTimebase));
+    s_bReplay = true;
+}
+
+void replayStop() {
+    if (!s_bReplay)
+        return;
+    s_bReplay = false;
+    for (uint8_t port = 0; port < IO_PORTS; ++port) {
+        replayMidiFree(s_aReplayMidi[port]);
+        delete[] s_aReplayAudio[port];
+        s_aReplayMidi[port]  = NULL;
+        s_aReplayAudio[port] = NULL;
+        s_aBuffers[port]     = NULL;
+    }
+}
+
+bool replayIsRunning() { return s_bReplay; }
+
+bool replaySetPeriod(const CAPTURE_PERIOD_DATA* pPeriod) {
+    if (!s_bReplay || pPeriod->frames > CAPTURE_MAX_FRAMES)
+        return false;
+    s_replayPeriod = *pPeriod;
+    for (uint8_t port = 0; port < IO_PORTS; ++port) {
+        if (s_aReplayMidi[port])
+            replayMidiReset(s_aReplayMidi[port], pPeriod->frames, 0);
+    }
+    replayMidiReset(s_aReplayMidi[IO_PORT_OUTPUT], pPeriod->frames, pPeriod->outputCapacity);
+    replayMidiReset(s_aReplayMidi[IO_PORT_FEEDBACK], pPeriod->frames, pPeriod->feedbackCapacity);
+
+    // Populate MIDI input from events following period record
+    const uint8_t* pData = replayMidiFill(s_aReplayMidi[IO_PORT_INPUT], (const uint8_t*)(pPeriod + 1), pPeriod->events);
+    if (!pData)
+        return false;
+
+    // Populate sync input from samples following MIDI input events (silence if not captured)
+    if (pPeriod->syncFrames > CAPTURE_MAX_FRAMES)
+        return false;
+    memcpy(s_aReplayAudio[IO_PORT_SYNC_INPUT], pData, sizeof(float) * pPeriod->syncFrames);
+    memset(s_aReplayAudio[IO_PORT_SYNC_INPUT] + pPeriod->syncFrames, 0, sizeof(float) * (CAPTURE_MAX_FRAMES - pPeriod->syncFrames));
+    return true;
+}
+
+void replaySetTimebase(const CAPTURE_TIMEBASE_DATA* pTimebase) { s_replayTimebase = *pTimebase; }
+
+void replayGetPeriodHashes(uint64_t* pOutput, uint64_t* pFeedback, uint64_t* pMetronome, uint64_t* pSync) {
+    *pOutput    = s_nReplayOutputHash;
+    *pFeedback  = s_nReplayFeedbackHash;
+    *pMetronome = s_nReplayMetronomeHash;
+    *pSync      = s_nReplaySyncHash;
+}
+
+uint64_t replayGetTimebaseHash() { return s_nReplayTimebaseHash; }
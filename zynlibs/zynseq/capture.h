@@ -0,0 +1,238 @@
+/*  Declares capture and replay of sequencer process inputs
+ *
+ *   Copyright (c) 2020 Brian Walton
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*  The process thread reaches JACK only through the io* functions declared here. Normally they call JACK directly. During capture they also record
+    each period's inputs (MIDI input events, frame time, transport state, sync input, timebase callback arguments) and a hash of each period's outputs
+    using the shared capture core (rtcapture.h), which also records the API calls that mutate sequencer state.
+    During replay the io* functions serve the recorded inputs from memory so that the library may be re-run offline, without a JACK server, and its
+    output compared bit-for-bit with the capture.
+*/
+
+#pragma once
+
+#include "rtcapture.h" // provides shared capture core
+#include <jack/jack.h>
+#include <jack/midiport.h>
+#include <jack/transport.h>
+
+#define CAPTURE_VERSION 5
+#define CAPTURE_MAX_FRAMES 8192 // Largest JACK period that may be replayed
+
+// Log record types specific to zynseq
+#define CAPTURE_RECORD_TIMEBASE CAPTURE_RECORD_USER // Timebase callback inputs and hash of resulting position
+
+// Ports accessed by process thread
+#define IO_PORT_INPUT 0       // MIDI input
+#define IO_PORT_OUTPUT 1      // MIDI output
+#define IO_PORT_METRONOME 2   // Metronome audio output
+#define IO_PORT_FEEDBACK 3    // Controller feedback MIDI output
+#define IO_PORT_SYNC_OUTPUT 4 // Analog sync pulse audio output
+#define IO_PORT_SYNC_INPUT 5  // Analog sync pulse audio input
+#define IO_PORTS 6
+
+// Process period record payload (followed by MIDI input events, each time:uint32, size:uint32, data, then sync input samples)
+struct CAPTURE_PERIOD_DATA {
+    uint32_t period;           // Index of period since start of capture
+    jack_nframes_t frames;     // Quantity of frames in period
+    jack_nframes_t frameTime;  // JACK frame time at start of period
+    uint32_t transportState;   // JACK transport state
+    jack_nframes_t transportFrame; // JACK transport position
+    uint32_t outputCapacity;   // Largest event that fits in empty MIDI output buffer
+    uint32_t feedbackCapacity; // Largest event that fits in empty feedback buffer
+    uint32_t events;           // Quantity of MIDI input events that follow
+    jack_nframes_t inputLatency; // Capture latency of MIDI input port
+    uint32_t syncFrames;       // Quantity of sync input samples that follow MIDI input events (0 if sync input not read)
+    uint64_t outputHash;       // Hash of MIDI output
+    uint64_t feedbackHash;     // Hash of controller feedback output
+    uint64_t metronomeHash;    // Hash of metronome audio output
+    uint64_t syncHash;         // Hash of sync pulse audio output
+};
+
+// Timebase callback record payload
+struct CAPTURE_TIMEBASE_DATA {
+    uint32_t period;          // Index of period in which callback was made
+    uint32_t state;           // JACK transport state passed to callback
+    jack_nframes_t frames;    // Quantity of frames passed to callback
+    int32_t update;           // Position update request passed to callback
+    jack_nframes_t frameTime; // JACK frame time read during callback
+    uint32_t pad;             // Padding
+    uint64_t hash;            // Hash of position after callback
+    jack_position_t position; // Position passed to callback
+};
+
+/** @brief  Set JACK port used by process thread
+ *   @param  port Port index [IO_PORT_INPUT | IO_PORT_OUTPUT | IO_PORT_METRONOME | IO_PORT_FEEDBACK | IO_PORT_SYNC_OUTPUT | IO_PORT_SYNC_INPUT]
+ *   @param  pPort Pointer to JACK port
+ */
+void ioSetPort(uint8_t port, jack_port_t* pPort);
+
+/** @brief  Set JACK client used by process thread
+ *   @param  pClient Pointer to JACK client
+ */
+void ioSetClient(jack_client_t* pClient);
+
+/** @brief  Start process period - call at start of each process callback
+ *   @param  nFrames Quantity of frames in period
+ */
+void ioBeginPeriod(jack_nframes_t nFrames);
+
+/** @brief  End process period - call at end of each process callback, hashes outputs
+ *   @param  nFrames Quantity of frames in period
+ */
+void ioEndPeriod(jack_nframes_t nFrames);
+
+/** @brief  Start timebase callback
+ *   @param  nState Transport state passed to callback
+ *   @param  nFrames Quantity of frames passed to callback
+ *   @param  pPosition Pointer to position passed to callback
+ *   @param  bUpdate Update request passed to callback
+ */
+void ioBeginTimebase(jack_transport_state_t nState, jack_nframes_t nFrames, jack_position_t* pPosition, int bUpdate);
+
+/** @brief  End timebase callback - hashes resulting position
+ *   @param  pPosition Pointer to position passed to callback
+ */
+void ioEndTimebase(jack_position_t* pPosition);
+
+/** @brief  Get buffer of a port for this period
+ *   @param  port Port index
+ *   @param  nFrames Quantity of frames in period
+ *   @retval void* Pointer to buffer
+ *   @note   Sync input is only captured in periods that request its buffer
+ */
+void* ioGetBuffer(uint8_t port, jack_nframes_t nFrames);
+
+/** @brief  Clear MIDI buffer
+ *   @param  pBuffer Pointer to buffer
+ */
+void ioMidiClearBuffer(void* pBuffer);
+
+/** @brief  Get largest MIDI event that fits in buffer
+ *   @param  pBuffer Pointer to buffer
+ *   @retval size_t Size of largest event in bytes
+ */
+size_t ioMidiMaxEventSize(void* pBuffer);
+
+/** @brief  Get quantity of events in MIDI buffer
+ *   @param  pBuffer Pointer to buffer
+ *   @retval uint32_t Quantity of events
+ */
+uint32_t ioMidiGetEventCount(void* pBuffer);
+
+/** @brief  Get event from MIDI buffer
+ *   @param  pEvent Pointer to event to populate
+ *   @param  pBuffer Pointer to buffer
+ *   @param  index Index of event
+ *   @retval int 0 on success
+ */
+int ioMidiEventGet(jack_midi_event_t* pEvent, void* pBuffer, uint32_t index);
+
+/** @brief  Reserve space for event in MIDI buffer
+ *   @param  pBuffer Pointer to buffer
+ *   @param  nTime Offset of event within period
+ *   @param  nSize Size of event in bytes
+ *   @retval uint8_t* Pointer to event data or NULL if insufficient space
+ */
+uint8_t* ioMidiEventReserve(void* pBuffer, jack_nframes_t nTime, size_t nSize);
+
+/** @brief  Get JACK frame time at start of this period
+ *   @retval jack_nframes_t Frame time
+ */
+jack_nframes_t ioLastFrameTime();
+
+/** @brief  Get current JACK frame time
+ *   @retval jack_nframes_t Frame time
+ */
+jack_nframes_t ioFrameTime();
+
+/** @brief  Update MIDI input port capture latency - call from JACK latency callback
+ */
+void ioUpdateInputLatency();
+
+/** @brief  Get capture latency of MIDI input port
+ *   @retval jack_nframes_t Latency in frames
+ */
+jack_nframes_t ioInputLatency();
+
+/** @brief  Query transport
+ *   @param  pPosition Pointer to position to populate (may be NULL)
+ *   @retval jack_transport_state_t Transport state
+ */
+jack_transport_state_t ioTransportQuery(jack_position_t* pPosition);
+
+/** @brief  Start transport (ignored during replay - transport state is an input)
+ */
+void ioTransportStart();
+
+/** @brief  Stop transport (ignored during replay)
+ */
+void ioTransportStop();
+
+/** @brief  Locate transport (ignored during replay)
+ *   @param  nFrame Frame position
+ */
+void ioTransportLocate(jack_nframes_t nFrame);
+
+/** @brief  Reposition transport (ignored during replay)
+ *   @param  pPosition Pointer to position
+ */
+void ioTransportReposition(jack_position_t* pPosition);
+
+/** @brief  Record runtime state at start of first captured period - call from process thread after ioBeginPeriod when captureIsPending
+ *   @param  pState Pointer to state
+ *   @param  nSize Size of state
+ */
+void ioCaptureState(const void* pState, uint32_t nSize);
+
+/** @brief  Start replay - io* functions serve recorded inputs
+ */
+void replayStart();
+
+/** @brief  Stop replay - io* functions return to JACK
+ */
+void replayStop();
+
+/** @brief  Check if replay is running
+ *   @retval bool True if replaying
+ */
+bool replayIsRunning();
+
+/** @brief  Set inputs of next replayed period
+ *   @param  pPeriod Pointer to period record payload
+ *   @retval bool True on success, false if period exceeds replay buffers
+ */
+bool replaySetPeriod(const CAPTURE_PERIOD_DATA* pPeriod);
+
+/** @brief  Set inputs of next replayed timebase callback
+ *   @param  pTimebase Pointer to timebase record payload
+ */
+void replaySetTimebase(const CAPTURE_TIMEBASE_DATA* pTimebase);
+
+/** @brief  Get hashes of outputs from last replayed period
+ *   @param  pOutput Pointer to populate with MIDI output hash
+ *   @param  pFeedback Pointer to populate with feedback hash
+ *   @param  pMetronome Pointer to populate with metronome hash
+ *   @param  pSync Pointer to populate with sync output hash
+ */
+void replayGetPeriodHashes(uint64_t* pOutput, uint64_t* pFeedback, uint64_t* pMetronome, uint64_t* pSync);
+
+/** @brief  Get hash of position from last replayed timebase callback
+ *   @retval uint64_t Hash
+ */
+uint64_t replayGetTimebaseHash();
@@ -49,6 +49,15 @@
 #define STOPPING_SYNC 5 // Sequence is playing waiting to stop at next sync point
 #define LASTPLAYSTATUS 5
 
+// Follow action (performed when sequence reaches end of its last loop)
+#define FOLLOW_NONE 0   // No follow action
+#define FOLLOW_START 1  // Start all target sequences
+#define FOLLOW_STOP 2   // Stop all target sequences
+#define FOLLOW_RANDOM 3 // Start one target sequence chosen randomly by weight
+#define FOLLOW_SCENE 4  // Stop all sequences and start every sequence in bank of target chosen randomly by weight
+#define LASTFOLLOWACTION 4
+#define MAX_FOLLOW_TARGETS 16 // Maximum quantity of follow action targets per sequence
+
 // MIDI commands
 #define MIDI_NOTE_OFF 0x80
 #define MIDI_NOTE_ON 0x90
@@ -74,4 +83,6 @@ struct MIDI_MESSAGE {
     uint8_t command = 0;
     uint8_t value1  = 0;
     uint8_t value2  = 0;
+    uint8_t* data   = nullptr; // Complete message (including status byte) if longer than 3 bytes, e.g. SysEx
+    uint16_t size   = 0;       // Quantity of bytes in data
 };
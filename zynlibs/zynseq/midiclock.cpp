@@ -0,0 +1,130 @@
+/*  Defines MidiClock class providing MIDI clock pulse generation
+ *
+ *   Copyright (c) 2020 Brian Walton
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "midiclock.h"
+#include <cmath> // provides llround, fabs, sqrt
+
+void MidiClock::reset() { m_bRunning = false; }
+
+void MidiClock::fill(std::queue<std::pair<double, double>>* pQueue, double dNow, double dEnd, double dFramesPerClock, size_t nMinimum,
+                     std::multimap<uint64_t, MIDI_MESSAGE*>* pSchedule) {
+    if (!m_bRunning && !pQueue->empty() && pQueue->back().first < dNow) {
+        // Discard pulses left from before transport stopped rather than send a burst to catch up
+        std::queue<std::pair<double, double>> qEmpty;
+        std::swap(*pQueue, qEmpty);
+    }
+    if (pQueue->empty()) {
+        pQueue->push(std::pair<double, double>(dNow, dFramesPerClock));
+        m_bRunning = false;
+    }
+    if (!m_bRunning || pQueue->back().first != m_dLast) {
+        // Start, or continue from a pulse positioned by transport relocation
+        m_dLast          = pQueue->back().first;
+        m_dSpacing       = pQueue->back().second;
+        m_dTarget        = m_dSpacing;
+        m_dRampStep      = 0.0;
+        m_bRunning       = true;
+        m_bLastScheduled = false;
+    }
+    scheduleLast(dEnd, pSchedule);
+    while (pQueue->size() < nMinimum || (m_dLast >= dEnd && m_dLast + m_dLatency < dEnd)) {
+        if (dFramesPerClock != m_dTarget) {
+            m_dTarget   = dFramesPerClock;
+            m_dRampStep = (m_dTarget - m_dSpacing) / (m_nRamp ? m_nRamp : 1);
+        }
+        if (m_dSpacing != m_dTarget) {
+            m_dSpacing += m_dRampStep;
+            if ((m_dRampStep > 0.0 && m_dSpacing > m_dTarget) || (m_dRampStep < 0.0 && m_dSpacing < m_dTarget) || m_dRampStep == 0.0)
+                m_dSpacing = m_dTarget;
+        }
+        m_dLast += m_dSpacing;
+        m_bLastScheduled = false;
+        pQueue->push(std::pair<double, double>(m_dLast, m_dSpacing));
+        scheduleLast(dEnd, pSchedule);
+    }
+}
+
+void MidiClock::scheduleLast(double dEnd, std::multimap<uint64_t, MIDI_MESSAGE*>* pSchedule) {
+    // Only the last pulse may be beyond this period so earlier pulses are always scheduled
+    if (m_bLastScheduled || (m_dLast >= dEnd && m_dLast + m_dLatency >= dEnd))
+        return;
+    if (pSchedule)
+        schedule(m_dLast, pSchedule);
+    m_bLastScheduled = true;
+}
+
+void MidiClock::relay(double dTime, std::multimap<uint64_t, MIDI_MESSAGE*>* pSchedule) { schedule(dTime, pSchedule); }
+
+uint64_t MidiClock::getOutputTime(double dTime) {
+    double dOutput = dTime + m_dLatency;
+    if (dOutput < 0.0)
+        return 0;
+    return uint64_t(llround(dOutput));
+}
+
+void MidiClock::schedule(double dTime, std::multimap<uint64_t, MIDI_MESSAGE*>* pSchedule) {
+    MIDI_MESSAGE* pMsg = new MIDI_MESSAGE;
+    pMsg->command      = MIDI_CLOCK;
+    pMsg->value1       = MIDICLOCK_GENERATED;
+    pSchedule->insert(std::pair<uint64_t, MIDI_MESSAGE*>(getOutputTime(dTime), pMsg));
+    if (m_nPendingCount == MIDICLOCK_PENDING) {
+        // Oldest pulse was never reported as sent so stop tracking it
+        m_nPendingStart = (m_nPendingStart + 1) % MIDICLOCK_PENDING;
+        --m_nPendingCount;
+    }
+    m_aPending[(m_nPendingStart + m_nPendingCount++) % MIDICLOCK_PENDING] = dTime + m_dLatency;
+}
+
+void MidiClock::sent(uint64_t nTime) {
+    if (m_nPendingCount == 0)
+        return;
+    double dDeviation = std::fabs(double(nTime) - m_aPending[m_nPendingStart]);
+    m_nPendingStart   = (m_nPendingStart + 1) % MIDICLOCK_PENDING;
+    --m_nPendingCount;
+    if (dDeviation > m_dJitterPeak)
+        m_dJitterPeak = dDeviation;
+    m_dJitterSquares += dDeviation * dDeviation;
+    ++m_nJitterCount;
+}
+
+void MidiClock::setLatency(double dFrames) { m_dLatency = dFrames; }
+
+double MidiClock::getLatency() { return m_dLatency; }
+
+void MidiClock::setRamp(uint8_t pulses) {
+    if (pulses > MIDICLOCK_MAX_RAMP)
+        pulses = MIDICLOCK_MAX_RAMP;
+    m_nRamp = pulses;
+}
+
+uint8_t MidiClock::getRamp() { return m_nRamp; }
+
+double MidiClock::getJitter(bool peak) {
+    if (peak)
+        return m_dJitterPeak;
+    if (m_nJitterCount == 0)
+        return 0.0;
+    return std::sqrt(m_dJitterSquares / m_nJitterCount);
+}
+
+void MidiClock::resetJitter() {
+    m_dJitterPeak    = 0.0;
+    m_dJitterSquares = 0.0;
+    m_nJitterCount   = 0;
+}
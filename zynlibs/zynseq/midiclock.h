@@ -0,0 +1,120 @@
+/*  Declares MidiClock class providing MIDI clock pulse generation
+ *
+ *   Copyright (c) 2020 Brian Walton
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#pragma once
+
+#include "constants.h"
+#include <cstddef> //provides size_t
+#include <cstdint> //provides uint data types
+#include <map>     //provides multimap for schedule
+#include <queue>   //provides queue of clock positions
+
+#define MIDICLOCK_MAX_RAMP 96     // Maximum quantity of pulses over which a tempo change may be ramped
+#define MIDICLOCK_PENDING 256     // Maximum quantity of scheduled pulses tracked for jitter measurement
+#define MIDICLOCK_GENERATED 1     // MIDI_MESSAGE value1 flagging a pulse from the generator (not sent for single byte messages)
+
+/** MidiClock class generates clock pulses at fractional frame positions, ramping tempo changes and scheduling MIDI clock messages offset by
+ *  output latency. Pulse times accumulate as double precision frame positions so that spacing does not drift and each message is sent at the
+ *  frame nearest its ideal time.
+ */
+class MidiClock {
+  public:
+    /** @brief  Stop generating pulses - next call to fill restarts the pulse train
+     */
+    void reset();
+
+    /** @brief  Append pulses to clock queue, scheduling a MIDI clock message for each
+     *   @param  pQueue Pointer to queue of pulse positions (frame time) and pulse durations (frames)
+     *   @param  dNow Frame time at start of period, used as first pulse if queue is empty
+     *   @param  dEnd Frame time at end of period
+     *   @param  dFramesPerClock Target frames per pulse (tempo)
+     *   @param  nMinimum Minimum quantity of pulses to leave in queue
+     *   @param  pSchedule Pointer to MIDI schedule or NULL to not send MIDI clock
+     *   @note   Pulses are also added ahead of the period when latency is negative so that their messages may be sent early
+     *   @note   A pulse queued beyond the period is not scheduled until a later period so that no clock is sent after transport stops
+     */
+    void fill(std::queue<std::pair<double, double>>* pQueue, double dNow, double dEnd, double dFramesPerClock, size_t nMinimum,
+              std::multimap<uint64_t, MIDI_MESSAGE*>* pSchedule);
+
+    /** @brief  Schedule a MIDI clock message for a pulse from an external clock source
+     *   @param  dTime Frame time of pulse
+     *   @param  pSchedule Pointer to MIDI schedule
+     */
+    void relay(double dTime, std::multimap<uint64_t, MIDI_MESSAGE*>* pSchedule);
+
+    /** @brief  Get frame time at which a message aligned with a pulse is sent
+     *   @param  dTime Frame time of pulse
+     *   @retval uint64_t Frame time offset by latency
+     */
+    uint64_t getOutputTime(double dTime);
+
+    /** @brief  Record that a generated pulse was written to output - call from process thread
+     *   @param  nTime Frame time at which pulse was written
+     */
+    void sent(uint64_t nTime);
+
+    /** @brief  Set output latency offset
+     *   @param  dFrames Offset in frames (positive delays MIDI clock, negative sends it early)
+     */
+    void setLatency(double dFrames);
+
+    /** @brief  Get output latency offset
+     *   @retval double Offset in frames
+     */
+    double getLatency();
+
+    /** @brief  Set quantity of pulses over which a tempo change is ramped
+     *   @param  pulses Quantity of pulses [0..MIDICLOCK_MAX_RAMP, 0 to change tempo immediately]
+     */
+    void setRamp(uint8_t pulses);
+
+    /** @brief  Get quantity of pulses over which a tempo change is ramped
+     *   @retval uint8_t Quantity of pulses
+     */
+    uint8_t getRamp();
+
+    /** @brief  Get measured deviation of sent pulses from their ideal time
+     *   @param  peak True for peak deviation, false for RMS deviation
+     *   @retval double Deviation in frames
+     */
+    double getJitter(bool peak);
+
+    /** @brief  Reset jitter measurement
+     */
+    void resetJitter();
+
+  private:
+    void scheduleLast(double dEnd, std::multimap<uint64_t, MIDI_MESSAGE*>* pSchedule);
+    void schedule(double dTime, std::multimap<uint64_t, MIDI_MESSAGE*>* pSchedule);
+
+    bool m_bRunning      = false; // True if generating pulses
+    double m_dLast       = 0.0;   // Frame time of last pulse added to queue
+    bool m_bLastScheduled = false; // True if MIDI clock message has been scheduled for last pulse
+    double m_dSpacing    = 0.0;   // Frames per pulse of last pulse
+    double m_dTarget     = 0.0;   // Frames per pulse being ramped towards
+    double m_dRampStep   = 0.0;   // Change of spacing each pulse during ramp
+    uint8_t m_nRamp      = 0;     // Quantity of pulses over which tempo changes are ramped
+    double m_dLatency    = 0.0;   // Output latency offset in frames
+    double m_aPending[MIDICLOCK_PENDING]; // Ideal output time of each scheduled pulse not yet sent (ring)
+    uint16_t m_nPendingStart = 0;  // Index of oldest pending pulse
+    uint16_t m_nPendingCount = 0;  // Quantity of pending pulses
+    double m_dJitterPeak     = 0.0; // Largest absolute deviation in frames
+    double m_dJitterSquares  = 0.0; // Sum of squared deviations
+    uint32_t m_nJitterCount  = 0;   // Quantity of pulses measured
+};
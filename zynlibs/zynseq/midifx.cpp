@@ -0,0 +1,286 @@
+/**    MidiFx class methods implementation **/
+
+#include "midifx.h"
+#include <cmath>
+
+// Default parameter values
+static const int16_t g_anDefaultParams[MIDIFX_PARAMS] = {
+    0,     // MIDIFX_ENABLE
+    0xFFF, // MIDIFX_SCALE_MASK (chromatic)
+    0,     // MIDIFX_SCALE_TONIC
+    0,     // MIDIFX_CHORD_1
+    0,     // MIDIFX_CHORD_2
+    0,     // MIDIFX_CHORD_3
+    0,     // MIDIFX_VELOCITY_CURVE
+    1,     // MIDIFX_VELOCITY_MIN
+    127,   // MIDIFX_VELOCITY_MAX
+    6,     // MIDIFX_REPEAT_RATE (1/16 note)
+    0,     // MIDIFX_ARP_MODE
+    6,     // MIDIFX_ARP_RATE (1/16 note)
+    1,     // MIDIFX_ARP_OCTAVES
+    50     // MIDIFX_ARP_GATE
+};
+
+// Parameter limits
+static const int16_t g_anMinParams[MIDIFX_PARAMS] = {0, 0, 0, -24, -24, -24, -100, 1, 1, 1, 0, 1, 1, 1};
+static const int16_t g_anMaxParams[MIDIFX_PARAMS] = {0x1F, 0xFFF, 11, 24, 24, 24, 100, 127, 127, 384, MIDIFX_ARP_RANDOM, 384, 4, 100};
+
+MidiFx::MidiFx() {
+    for (uint8_t nParam = 0; nParam < MIDIFX_PARAMS; ++nParam)
+        m_anParams[nParam] = g_anDefaultParams[nParam];
+    updateVelocityCurve();
+}
+
+void MidiFx::setParam(uint8_t param, int16_t value) {
+    if (param >= MIDIFX_PARAMS)
+        return;
+    if (value < g_anMinParams[param])
+        value = g_anMinParams[param];
+    if (value > g_anMaxParams[param])
+        value = g_anMaxParams[param];
+    m_anParams[param] = value;
+    if (param == MIDIFX_VELOCITY_CURVE || param == MIDIFX_VELOCITY_MIN || param == MIDIFX_VELOCITY_MAX)
+        updateVelocityCurve();
+}
+
+void MidiFx::seedRandom(uint32_t seed) { m_nRandom = seed; }
+
+int16_t MidiFx::getParam(uint8_t param) {
+    if (param >= MIDIFX_PARAMS)
+        return 0;
+    return m_anParams[param];
+}
+
+bool MidiFx::isConfigured() {
+    for (uint8_t nParam = 0; nParam < MIDIFX_PARAMS; ++nParam)
+        if (m_anParams[nParam] != g_anDefaultParams[nParam])
+            return true;
+    return false;
+}
+
+bool MidiFx::isEnabled() { return m_anParams[MIDIFX_ENABLE] != 0; }
+
+void MidiFx::updateVelocityCurve() {
+    // Curve exponent is 1/4 at +100, 1 at 0 and 4 at -100
+    double dGamma = pow(2.0, -m_anParams[MIDIFX_VELOCITY_CURVE] / 50.0);
+    double dMin   = m_anParams[MIDIFX_VELOCITY_MIN];
+    double dMax   = m_anParams[MIDIFX_VELOCITY_MAX];
+
+    m_anVelocity[0] = 0;
+    for (uint8_t nVelocity = 1; nVelocity < 128; ++nVelocity) {
+        int nValue = lround(dMin + (dMax - dMin) * pow(nVelocity / 127.0, dGamma));
+        if (nValue < 1)
+            nValue = 1;
+        if (nValue > 127)
+            nValue = 127;
+        m_anVelocity[nVelocity] = nValue;
+    }
+}
+
+uint8_t MidiFx::quantise(uint8_t note) {
+    uint16_t nMask = m_anParams[MIDIFX_SCALE_MASK];
+    if (!nMask)
+        return note;
+    uint8_t nTonic = m_anParams[MIDIFX_SCALE_TONIC];
+    // Find nearest note in scale, preferring lower note
+    for (uint8_t nOffset = 0; nOffset < 12; ++nOffset) {
+        if (note >= nOffset && (nMask & (1 << ((note - nOffset + 12 - nTonic) % 12))))
+            return note - nOffset;
+        if (note + nOffset < 128 && (nMask & (1 << ((note + nOffset + 12 - nTonic) % 12))))
+            return note + nOffset;
+    }
+    return note;
+}
+
+void MidiFx::schedule(uint64_t nTime, uint8_t command, uint8_t value1, uint8_t value2, std::multimap<uint64_t, MIDI_MESSAGE*>* pSchedule) {
+    MIDI_MESSAGE* pMsg = new MIDI_MESSAGE;
+    pMsg->command      = command;
+    pMsg->value1       = value1;
+    pMsg->value2       = value2;
+    pSchedule->insert(std::pair<uint64_t, MIDI_MESSAGE*>(nTime, pMsg));
+}
+
+// Release held notes if enabled stages have changed, so that notes are not left sounding or retriggered by stale slots
+void MidiFx::checkStages(uint64_t nTime, std::multimap<uint64_t, MIDI_MESSAGE*>* pSchedule) {
+    uint8_t nStages = m_anParams[MIDIFX_ENABLE];
+    if (nStages == m_nStages)
+        return;
+    m_nStages = nStages;
+    for (uint8_t nSlot = 0; nSlot < MIDIFX_MAX_NOTES; ++nSlot) {
+        MIDIFX_NOTE* pNote = &m_aNotes[nSlot];
+        if (pNote->command && pNote->sounding && pNote->end > nTime)
+            schedule(nTime, MIDI_NOTE_OFF | (pNote->command & 0x0F), pNote->note, 0, pSchedule);
+        *pNote = MIDIFX_NOTE();
+    }
+    m_nArpClocks = 0;
+    m_nArpStep   = 0;
+}
+
+void MidiFx::process(uint64_t nTime, const MIDI_MESSAGE& msg, std::multimap<uint64_t, MIDI_MESSAGE*>* pSchedule) {
+    checkStages(nTime, pSchedule);
+    uint8_t nStages  = m_anParams[MIDIFX_ENABLE];
+    uint8_t nCommand = msg.command & 0xF0;
+    if (!nStages || (nCommand != MIDI_NOTE_ON && nCommand != MIDI_NOTE_OFF)) {
+        schedule(nTime, msg.command, msg.value1, msg.value2, pSchedule);
+        return;
+    }
+
+    uint8_t nRoot = msg.value1;
+    if (nStages & MIDIFX_STAGE_SCALE)
+        nRoot = quantise(nRoot);
+    noteEvent(nTime, msg.command, nRoot, msg.value2, pSchedule);
+    if (!(nStages & MIDIFX_STAGE_CHORD))
+        return;
+    uint8_t anNotes[MIDIFX_MAX_CHORD + 1] = {nRoot}; // Notes sent, to avoid duplicates when quantised to same note
+    uint8_t nNotes                        = 1;
+    for (uint8_t nChord = 0; nChord < MIDIFX_MAX_CHORD; ++nChord) {
+        int16_t nInterval = m_anParams[MIDIFX_CHORD_1 + nChord];
+        if (nInterval == 0 || nRoot + nInterval < 0 || nRoot + nInterval > 127)
+            continue;
+        uint8_t nNote = nRoot + nInterval;
+        if (nStages & MIDIFX_STAGE_SCALE)
+            nNote = quantise(nNote);
+        uint8_t nIndex = 0;
+        while (nIndex < nNotes && anNotes[nIndex] != nNote)
+            ++nIndex;
+        if (nIndex < nNotes)
+            continue;
+        anNotes[nNotes++] = nNote;
+        noteEvent(nTime, msg.command, nNote, msg.value2, pSchedule);
+    }
+}
+
+void MidiFx::noteEvent(uint64_t nTime, uint8_t command, uint8_t note, uint8_t velocity, std::multimap<uint64_t, MIDI_MESSAGE*>* pSchedule) {
+    uint8_t nStages = m_anParams[MIDIFX_ENABLE];
+    bool bArp       = nStages & MIDIFX_STAGE_ARP;
+    if ((command & 0xF0) == MIDI_NOTE_ON && velocity) {
+        // Reuse a slot that has finished or else the oldest slot
+        MIDIFX_NOTE* pSlot = &m_aNotes[0];
+        for (uint8_t nSlot = 0; nSlot < MIDIFX_MAX_NOTES; ++nSlot) {
+            MIDIFX_NOTE* pNote = &m_aNotes[nSlot];
+            if (pNote->command == 0 || pNote->end <= nTime) {
+                pSlot = pNote;
+                break;
+            }
+            if (pNote->start < pSlot->start)
+                pSlot = pNote;
+        }
+        pSlot->start    = nTime;
+        pSlot->end      = UINT64_MAX;
+        pSlot->clocks   = 0;
+        pSlot->command  = command;
+        pSlot->note     = note;
+        pSlot->velocity = velocity;
+        pSlot->sounding = !bArp;
+        if (bArp)
+            return;
+        if (nStages & MIDIFX_STAGE_VELOCITY)
+            velocity = m_anVelocity[velocity];
+        schedule(nTime, command, note, velocity, pSchedule);
+        return;
+    }
+
+    // Note off ends every slot holding note (same note may be held by more than one input note)
+    bool bFound    = false;
+    bool bSounding = false;
+    for (uint8_t nSlot = 0; nSlot < MIDIFX_MAX_NOTES; ++nSlot) {
+        MIDIFX_NOTE* pNote = &m_aNotes[nSlot];
+        if (pNote->end == UINT64_MAX && pNote->note == note && (pNote->command & 0x0F) == (command & 0x0F) && pNote->start <= nTime) {
+            pNote->end = nTime;
+            bFound     = true;
+            bSounding |= pNote->sounding;
+        }
+    }
+    if (bFound && !bSounding)
+        return; // Note on was consumed by arpeggiator
+    schedule(nTime, command, note, velocity, pSchedule);
+}
+
+void MidiFx::clock(uint64_t nTime, double dSamplesPerClock, std::multimap<uint64_t, MIDI_MESSAGE*>* pSchedule) {
+    checkStages(nTime, pSchedule);
+    uint8_t nStages = m_anParams[MIDIFX_ENABLE];
+    if (!(nStages & (MIDIFX_STAGE_REPEAT | MIDIFX_STAGE_ARP)))
+        return;
+
+    if (!(nStages & MIDIFX_STAGE_ARP)) {
+        // Note repeat
+        uint16_t nRate = m_anParams[MIDIFX_REPEAT_RATE];
+        for (uint8_t nSlot = 0; nSlot < MIDIFX_MAX_NOTES; ++nSlot) {
+            MIDIFX_NOTE* pNote = &m_aNotes[nSlot];
+            if (!pNote->sounding || pNote->start > nTime || pNote->end <= nTime)
+                continue;
+            uint16_t nClocks = pNote->clocks++; // First clock is that of note on
+            if (nClocks == 0 || nClocks % nRate)
+                continue;
+            uint8_t nVelocity = pNote->velocity;
+            if (nStages & MIDIFX_STAGE_VELOCITY)
+                nVelocity = m_anVelocity[nVelocity];
+            schedule(nTime, MIDI_NOTE_OFF | (pNote->command & 0x0F), pNote->note, 0, pSchedule);
+            schedule(nTime, pNote->command, pNote->note, nVelocity, pSchedule);
+        }
+        return;
+    }
+
+    // Arpeggiator - gather held notes in ascending order
+    MIDIFX_NOTE* apHeld[MIDIFX_MAX_NOTES];
+    uint8_t nHeld = 0;
+    for (uint8_t nSlot = 0; nSlot < MIDIFX_MAX_NOTES; ++nSlot) {
+        MIDIFX_NOTE* pNote = &m_aNotes[nSlot];
+        if (pNote->command == 0 || pNote->start > nTime || pNote->end <= nTime)
+            continue;
+        uint8_t nIndex = nHeld++;
+        while (nIndex && apHeld[nIndex - 1]->note > pNote->note) {
+            apHeld[nIndex] = apHeld[nIndex - 1];
+            --nIndex;
+        }
+        apHeld[nIndex] = pNote;
+    }
+    if (nHeld == 0) {
+        // Restart arpeggio when next note is held
+        m_nArpClocks = 0;
+        m_nArpStep   = 0;
+        return;
+    }
+    uint16_t nRate = m_anParams[MIDIFX_ARP_RATE];
+    if (m_nArpClocks >= nRate)
+        m_nArpClocks = 0;
+    if (m_nArpClocks++)
+        return;
+
+    uint32_t nSteps = nHeld * m_anParams[MIDIFX_ARP_OCTAVES];
+    uint32_t nIndex;
+    switch (m_anParams[MIDIFX_ARP_MODE]) {
+    case MIDIFX_ARP_DOWN:
+        nIndex = nSteps - 1 - m_nArpStep % nSteps;
+        break;
+    case MIDIFX_ARP_UPDOWN: {
+        uint32_t nPeriod = nSteps > 1 ? 2 * nSteps - 2 : 1;
+        nIndex           = m_nArpStep % nPeriod;
+        if (nIndex >= nSteps)
+            nIndex = nPeriod - nIndex;
+        break;
+    }
+    case MIDIFX_ARP_RANDOM:
+        m_nRandom = m_nRandom * 1103515245 + 12345;
+        nIndex    = (m_nRandom >> 16) % nSteps;
+        break;
+    default:
+        nIndex = m_nArpStep % nSteps;
+    }
+    ++m_nArpStep;
+
+    MIDIFX_NOTE* pNote = apHeld[nIndex % nHeld];
+    uint16_t nNote     = pNote->note + 12 * (nIndex / nHeld);
+    if (nNote > 127)
+        return;
+    uint8_t nVelocity = pNote->velocity;
+    if (nStages & MIDIFX_STAGE_VELOCITY)
+        nVelocity = m_anVelocity[nVelocity];
+    uint64_t nDuration = nRate * dSamplesPerClock * m_anParams[MIDIFX_ARP_GATE] / 100;
+    if (nDuration > 1)
+        --nDuration; // Send note off one sample before next step
+    else
+        nDuration = 1;
+    schedule(nTime, pNote->command, nNote, nVelocity, pSchedule);
+    schedule(nTime + nDuration, MIDI_NOTE_OFF | (pNote->command & 0x0F), nNote, 0, pSchedule);
+}
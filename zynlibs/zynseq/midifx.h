@@ -0,0 +1,136 @@
+/*  Declares MidiFx class providing per-track MIDI effects applied during scheduling
+ *
+ *   Copyright (c) 2020 Brian Walton
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#pragma once
+
+#include "constants.h"
+#include <cstdint> //provides uint data types
+#include <map>
+
+// MIDI effect stages (bitwise flags of MIDIFX_ENABLE parameter)
+#define MIDIFX_STAGE_SCALE 0x01    // Quantise notes to scale
+#define MIDIFX_STAGE_CHORD 0x02    // Add chord notes to each note
+#define MIDIFX_STAGE_VELOCITY 0x04 // Apply velocity curve
+#define MIDIFX_STAGE_REPEAT 0x08   // Retrigger held notes
+#define MIDIFX_STAGE_ARP 0x10      // Arpeggiate held notes (replaces note repeat)
+
+// MIDI effect parameters
+#define MIDIFX_ENABLE 0          // Bitwise flags of enabled stages
+#define MIDIFX_SCALE_MASK 1      // Bitwise mask of notes in scale, bit 0 = tonic (0..4095)
+#define MIDIFX_SCALE_TONIC 2     // Tonic of scale (0..11)
+#define MIDIFX_CHORD_1 3         // Interval of first chord note in semitones (-24..24, 0 = none)
+#define MIDIFX_CHORD_2 4         // Interval of second chord note in semitones (-24..24, 0 = none)
+#define MIDIFX_CHORD_3 5         // Interval of third chord note in semitones (-24..24, 0 = none)
+#define MIDIFX_VELOCITY_CURVE 6  // Velocity curve (-100..100, 0 = linear, positive = louder)
+#define MIDIFX_VELOCITY_MIN 7    // Minimum note on velocity (1..127)
+#define MIDIFX_VELOCITY_MAX 8    // Maximum note on velocity (1..127)
+#define MIDIFX_REPEAT_RATE 9     // Clock cycles between note repeats (1..384)
+#define MIDIFX_ARP_MODE 10       // Arpeggiator mode [MIDIFX_ARP_UP | MIDIFX_ARP_DOWN | MIDIFX_ARP_UPDOWN | MIDIFX_ARP_RANDOM]
+#define MIDIFX_ARP_RATE 11       // Clock cycles between arpeggiator steps (1..384)
+#define MIDIFX_ARP_OCTAVES 12    // Quantity of octaves spanned by arpeggiator (1..4)
+#define MIDIFX_ARP_GATE 13       // Arpeggiator note duration as percentage of step (1..100)
+#define MIDIFX_PARAMS 14         // Quantity of parameters
+
+// Arpeggiator modes
+#define MIDIFX_ARP_UP 0
+#define MIDIFX_ARP_DOWN 1
+#define MIDIFX_ARP_UPDOWN 2
+#define MIDIFX_ARP_RANDOM 3
+
+#define MIDIFX_MAX_NOTES 16 // Quantity of held notes tracked by note repeat and arpeggiator
+#define MIDIFX_MAX_CHORD 3  // Quantity of notes that may be added to form chord
+
+// A note held (between note on and note off) in the input to the effects
+struct MIDIFX_NOTE {
+    uint64_t start   = 0;     // Time of note on (64-bit frame time)
+    uint64_t end     = 0;     // Time of note off or UINT64_MAX if not yet known
+    uint16_t clocks  = 0;     // Clock cycles since note started
+    uint8_t command  = 0;     // Note on command (with channel)
+    uint8_t note     = 0;     // MIDI note
+    uint8_t velocity = 0;     // Note on velocity
+    bool sounding    = false; // True if note on was sent (not consumed by arpeggiator)
+};
+
+/** MidiFx class provides a chain of MIDI effects (scale quantise, chord, velocity curve, note repeat, arpeggiator) for a track
+ *   All state is preallocated so may be used within the realtime thread.
+ *   Timed effects (note repeat, arpeggiator) are specified in clock cycles so follow tempo.
+ */
+class MidiFx {
+  public:
+    /** @brief  Construct MIDI effects object
+     */
+    MidiFx();
+
+    /** @brief  Set a parameter
+     *   @param  param Parameter index [MIDIFX_ENABLE..MIDIFX_PARAMS - 1]
+     *   @param  value Parameter value (limited to parameter range)
+     */
+    void setParam(uint8_t param, int16_t value);
+
+    /** @brief  Get a parameter
+     *   @param  param Parameter index [MIDIFX_ENABLE..MIDIFX_PARAMS - 1]
+     *   @retval int16_t Parameter value or 0 if invalid parameter
+     */
+    int16_t getParam(uint8_t param);
+
+    /** @brief  Check if any parameter differs from its default value
+     *   @retval bool True if configured
+     */
+    bool isConfigured();
+
+    /** @brief  Check if any effect stage is enabled
+     *   @retval bool True if enabled
+     */
+    bool isEnabled();
+
+    /** @brief  Process an event, scheduling the resulting event(s)
+     *   @param  nTime Time at which event is scheduled (64-bit frame time)
+     *   @param  msg MIDI message
+     *   @param  pSchedule Pointer to schedule to populate
+     */
+    void process(uint64_t nTime, const MIDI_MESSAGE& msg, std::multimap<uint64_t, MIDI_MESSAGE*>* pSchedule);
+
+    /** @brief  Handle clock signal, scheduling note repeats and arpeggiator steps
+     *   @param  nTime Time of clock cycle (64-bit frame time)
+     *   @param  dSamplesPerClock Samples per clock
+     *   @param  pSchedule Pointer to schedule to populate
+     *   @note   Call once for each clock cycle of the track, after its events are processed
+     */
+    void clock(uint64_t nTime, double dSamplesPerClock, std::multimap<uint64_t, MIDI_MESSAGE*>* pSchedule);
+
+    /** @brief  Seed pseudo random generator used by random arpeggiator
+     *   @param  seed Seed value
+     */
+    void seedRandom(uint32_t seed);
+
+  private:
+    void checkStages(uint64_t nTime, std::multimap<uint64_t, MIDI_MESSAGE*>* pSchedule);
+    void noteEvent(uint64_t nTime, uint8_t command, uint8_t note, uint8_t velocity, std::multimap<uint64_t, MIDI_MESSAGE*>* pSchedule);
+    void schedule(uint64_t nTime, uint8_t command, uint8_t value1, uint8_t value2, std::multimap<uint64_t, MIDI_MESSAGE*>* pSchedule);
+    uint8_t quantise(uint8_t note);
+    void updateVelocityCurve();
+
+    int16_t m_anParams[MIDIFX_PARAMS];      // Parameter values
+    uint8_t m_anVelocity[128];              // Velocity curve lookup table
+    MIDIFX_NOTE m_aNotes[MIDIFX_MAX_NOTES]; // Held notes
+    uint16_t m_nArpClocks = 0;              // Clock cycles since last arpeggiator step
+    uint32_t m_nArpStep   = 0;              // Index of arpeggiator step
+    uint32_t m_nRandom    = 1;              // Pseudo random generator state
+    uint8_t m_nStages     = 0;              // Stages enabled when last processed (realtime thread)
+};
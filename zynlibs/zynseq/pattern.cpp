@@ -37,9 +37,12 @@ Pattern& Pattern::operator=(Pattern& p) {
     m_fPlayChance    = p.m_fPlayChance;
     m_nZoom          = p.m_nZoom;
     // Copy Events
-    uint32_t i       = 0;
+    m_vData.clear();
+    uint32_t i = 0;
     while (StepEvent* ev = p.getEventAt(i)) {
-        addEvent(ev);
+        StepEvent* pNew = addEvent(ev);
+        if (ev->getDataSize())
+            pNew->setData(addData(p.getEventData(ev), ev->getDataSize()), ev->getDataSize()); // Payload offset is relative to source pool
         i++;
     }
     resetSnapshots();
@@ -263,6 +266,78 @@ uint8_t Pattern::getProgramChange(uint32_t step) {
     return 0xFF;
 }
 
+bool Pattern::addSysex(uint32_t step, const uint8_t* data, uint16_t size) {
+    if (step >= (m_nBeats * m_nStepsPerBeat) || !data || size < 2 || size > MAX_SYSEX_SIZE)
+        return false;
+    if (data[0] != MIDI_SYSEX_START || data[size - 1] != MIDI_SYSEX_END)
+        return false;
+    for (uint16_t i = 1; i < size - 1; ++i)
+        if (data[i] & 0x80)
+            return false;
+    removeSysex(step); // Only one SysEx per step
+    return setEventData(addEvent(step, MIDI_SYSEX_START), data, size);
+}
+
+bool Pattern::removeSysex(uint32_t step) {
+    if (step >= (m_nBeats * m_nStepsPerBeat))
+        return false;
+    for (auto it = m_vEvents.begin(); it != m_vEvents.end(); ++it) {
+        if ((*it)->getPosition() == step && (*it)->getCommand() == MIDI_SYSEX_START) {
+            // Payload remains in pool until snapshots are reset because undo may restore it
+            delete *it;
+            m_vEvents.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+const uint8_t* Pattern::getSysex(uint32_t step, uint16_t* size) {
+    for (StepEvent* ev : m_vEvents) {
+        if (ev->getPosition() != step || ev->getCommand() != MIDI_SYSEX_START)
+            continue;
+        if (size)
+            *size = ev->getDataSize();
+        return getEventData(ev);
+    }
+    if (size)
+        *size = 0;
+    return NULL;
+}
+
+uint8_t* Pattern::getEventData(StepEvent* pEvent) {
+    if (!pEvent || !pEvent->getDataSize() || pEvent->getDataOffset() + pEvent->getDataSize() > m_vData.size())
+        return NULL;
+    return m_vData.data() + pEvent->getDataOffset();
+}
+
+bool Pattern::setEventData(StepEvent* pEvent, const uint8_t* data, uint16_t size) {
+    if (!pEvent || !data || size == 0 || size > MAX_SYSEX_SIZE)
+        return false;
+    pEvent->setData(addData(data, size), size);
+    return true;
+}
+
+uint32_t Pattern::addData(const uint8_t* data, uint16_t size) {
+    uint32_t nOffset = m_vData.size();
+    m_vData.insert(m_vData.end(), data, data + size);
+    return nOffset;
+}
+
+void Pattern::compactData() {
+    if (m_vData.empty())
+        return;
+    std::vector<uint8_t> vData;
+    for (StepEvent* ev : m_vEvents) {
+        uint8_t* pData = getEventData(ev);
+        if (!pData)
+            continue;
+        ev->setData(vData.size(), ev->getDataSize());
+        vData.insert(vData.end(), pData, pData + ev->getDataSize());
+    }
+    m_vData.swap(vData);
+}
+
 void Pattern::addControl(uint32_t step, uint8_t control, uint8_t valueStart, uint8_t valueEnd, float duration) {
     float fDuration = duration;
     if (step > (m_nBeats * m_nStepsPerBeat) || control > 127 || valueStart > 127 || valueEnd > 127 || fDuration > (m_nBeats * m_nStepsPerBeat))
@@ -511,6 +586,7 @@ void Pattern::resetSnapshots() {
     }
     m_vSnapshots.clear();
     // m_vSnapshotPos = m_vSnapshots.end();
+    compactData();
     saveSnapshot();
 }
 
@@ -6,6 +6,7 @@
 
 #define MAX_STUTTER_COUNT 32
 #define MAX_STUTTER_DUR 96
+#define MAX_SYSEX_SIZE 4096 // Maximum size of a SysEx step event payload including 0xF0 and 0xF7
 
 const static uint32_t PPQN = 24;
 
@@ -32,6 +33,8 @@ class StepEvent {
         m_nStutterCount = 0;
         m_nStutterDur   = 1;
         m_nPlayChance   = 100;
+        m_nDataOffset   = 0;
+        m_nDataSize     = 0;
     };
 
     /** Constructor - create an instance of StepEvent object
@@ -51,6 +54,8 @@ class StepEvent {
         m_nStutterCount = 0;
         m_nStutterDur   = 1;
         m_nPlayChance   = 100;
+        m_nDataOffset   = 0;
+        m_nDataSize     = 0;
     };
 
     /** Copy constructor - create an copy of StepEvent object from an existing object
@@ -67,6 +72,8 @@ class StepEvent {
         m_nStutterCount = pEvent->getStutterCount();
         m_nStutterDur   = pEvent->getStutterDur();
         m_nPlayChance   = pEvent->getPlayChance();
+        m_nDataOffset   = pEvent->getDataOffset();
+        m_nDataSize     = pEvent->getDataSize();
     };
 
     uint32_t getPosition() { return m_nPosition; }
@@ -80,6 +87,8 @@ class StepEvent {
     uint8_t getStutterCount() { return m_nStutterCount; }
     uint8_t getStutterDur() { return m_nStutterDur; }
     uint8_t getPlayChance() { return m_nPlayChance; }
+    uint32_t getDataOffset() { return m_nDataOffset; }
+    uint16_t getDataSize() { return m_nDataSize; }
     void setPosition(uint32_t position) { m_nPosition = position; }
     void setOffset(float offset) { m_fOffset = offset; }
     void setDuration(float duration) { m_fDuration = duration; }
@@ -93,6 +102,10 @@ class StepEvent {
             m_nStutterDur = value;
     }
     void setPlayChance(uint8_t chance) { m_nPlayChance = chance; }
+    void setData(uint32_t offset, uint16_t size) {
+        m_nDataOffset = offset;
+        m_nDataSize   = size;
+    }
 
   private:
     uint32_t m_nPosition;    // Start position of event in steps
@@ -107,6 +120,8 @@ class StepEvent {
     uint8_t m_nStutterCount; // Quantity of stutters (fast repeats) at start of event
     uint8_t m_nStutterDur;   // Duration of each stutter in clock cycles
     uint8_t m_nPlayChance;   // Probability of playing (0 = not played, 50 = plays with 50%, 100 = always plays)
+    uint32_t m_nDataOffset;  // Offset of variable length payload (SysEx) within pattern's data pool
+    uint16_t m_nDataSize;    // Quantity of bytes of variable length payload (0 for 1..3 byte MIDI messages)
 };
 
 typedef std::vector<StepEvent*> StepEventVector;
@@ -276,6 +291,43 @@ class Pattern {
      */
     uint8_t getProgramChange(uint32_t step);
 
+    /** @brief  Add SysEx message to pattern
+     *   @param  step Quantity of steps from start of pattern at which to add SysEx
+     *   @param  data Pointer to complete SysEx message, starting 0xF0 and ending 0xF7
+     *   @param  size Quantity of bytes in message [2..MAX_SYSEX_SIZE]
+     *   @retval bool True on success
+     *   @note   Replaces any existing SysEx at this step
+     */
+    bool addSysex(uint32_t step, const uint8_t* data, uint16_t size);
+
+    /** @brief  Remove SysEx message from pattern
+     *   @param  step Quantity of steps from start of pattern at which to remove SysEx
+     *   @retval bool True on success
+     */
+    bool removeSysex(uint32_t step);
+
+    /** @brief  Get SysEx message at a step
+     *   @param  step Quantity of steps from start of pattern at which SysEx resides
+     *   @param  size Pointer to populate with quantity of bytes in message (0 if no SysEx at this step)
+     *   @retval const uint8_t* Pointer to message or NULL if no SysEx at this step
+     *   @note   Pointer is invalidated by subsequent changes to pattern
+     */
+    const uint8_t* getSysex(uint32_t step, uint16_t* size);
+
+    /** @brief  Get pointer to variable length payload of an event
+     *   @param  pEvent Pointer to event within this pattern
+     *   @retval uint8_t* Pointer to payload or NULL if event has no payload
+     */
+    uint8_t* getEventData(StepEvent* pEvent);
+
+    /** @brief  Set variable length payload of an event
+     *   @param  pEvent Pointer to event within this pattern
+     *   @param  data Pointer to payload
+     *   @param  size Quantity of bytes in payload [1..MAX_SYSEX_SIZE]
+     *   @retval bool True on success
+     */
+    bool setEventData(StepEvent* pEvent, const uint8_t* data, uint16_t size);
+
     /** @brief  Add continuous controller to pattern
      *   @param  position Quantity of steps from start of pattern at which control starts
      *   @param  control MIDI controller number
@@ -495,7 +547,20 @@ class Pattern {
   private:
     void deleteEvent(uint32_t position, uint8_t command, uint8_t value1);
 
+    /** @brief  Append payload to data pool
+     *   @param  data Pointer to payload
+     *   @param  size Quantity of bytes in payload
+     *   @retval uint32_t Offset of payload within pool
+     */
+    uint32_t addData(const uint8_t* data, uint16_t size);
+
+    /** @brief  Remove payloads from data pool that are not used by current events
+     *   @note   Only call when no snapshots refer to pool. Caller must hold mutex because process thread reads pool.
+     */
+    void compactData();
+
     StepEventVector m_vEvents;                                                   // Vector of pattern events
+    std::vector<uint8_t> m_vData;                                                // Pool of variable length event payloads (SysEx), appended by edits
     std::vector<StepEventVector*> m_vSnapshots;                                  // Vector of vectors of pattern events
     std::vector<StepEventVector*>::iterator m_vSnapshotPos = m_vSnapshots.end(); // Iterator pointing to the current snapshot
 
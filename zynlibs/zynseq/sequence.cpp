@@ -52,6 +52,8 @@ Track* Sequence::getTrack(size_t index) {
     return NULL;
 }
 
+Track* Sequence::getCurrentTrack() { return getTrack(m_nCurrentTrack); }
+
 void Sequence::addTempo(uint16_t tempo, uint16_t bar, uint16_t tick) {
     m_timebase.addTimebaseEvent(bar, tick, TIMEBASE_TYPE_TEMPO, tempo);
     m_bChanged = true;
@@ -101,6 +103,8 @@ void Sequence::setPlayState(uint8_t state) {
         return;
     if ((m_nMode == ONESHOT || m_nMode == LOOP) && (state == STOPPING || state == STOPPING_SYNC))
         state = STOPPED;
+    if (nState == STOPPED)
+        m_nLoops = 0; // Starting so count loops from start
     m_nState = state;
     if (m_nState == STOPPED)
         if (m_nMode == ONESHOT) {
@@ -115,10 +119,73 @@ void Sequence::setPlayState(uint8_t state) {
 
 uint32_t Sequence::getState() { return (m_nGroup << 16) | (m_nMode << 8) | m_nState; }
 
-uint8_t Sequence::clock(uint32_t nTime, bool bSync, double dSamplesPerClock) {
-    m_nCurrentTrack = 0;
-    uint8_t nReturn = 0;
-    uint8_t nState  = m_nState;
+void Sequence::setFollowAction(uint8_t action, uint16_t loops, bool stop) {
+    if (action > LASTFOLLOWACTION)
+        return;
+    m_nFollowAction = action;
+    m_nFollowLoops  = loops ? loops : 1;
+    m_bFollowStop   = stop;
+    m_bChanged      = true;
+}
+
+uint8_t Sequence::getFollowAction() { return m_nFollowAction; }
+
+uint16_t Sequence::getFollowLoops() { return m_nFollowLoops; }
+
+bool Sequence::getFollowStop() { return m_bFollowStop; }
+
+bool Sequence::addFollowTarget(uint8_t bank, uint8_t sequence, uint8_t weight) {
+    if (m_vFollowTargets.size() >= MAX_FOLLOW_TARGETS || weight == 0)
+        return false;
+    FOLLOW_TARGET target;
+    target.bank     = bank;
+    target.sequence = sequence;
+    target.weight   = weight;
+    m_vFollowTargets.push_back(target);
+    m_bChanged = true;
+    return true;
+}
+
+void Sequence::clearFollowTargets() {
+    if (m_vFollowTargets.size())
+        m_bChanged = true;
+    m_vFollowTargets.clear();
+}
+
+uint8_t Sequence::getFollowTargets() { return m_vFollowTargets.size(); }
+
+FOLLOW_TARGET* Sequence::getFollowTarget(uint8_t index) {
+    if (index < m_vFollowTargets.size())
+        return &(m_vFollowTargets[index]);
+    return NULL;
+}
+
+void Sequence::remapFollowTargets(uint8_t bank, const std::vector<int>& vIndex) {
+    for (auto it = m_vFollowTargets.begin(); it != m_vFollowTargets.end();) {
+        if (it->bank == bank && it->sequence < vIndex.size()) {
+            if (vIndex[it->sequence] < 0) {
+                it         = m_vFollowTargets.erase(it);
+                m_bChanged = true;
+                continue;
+            }
+            if (it->sequence != vIndex[it->sequence]) {
+                it->sequence = vIndex[it->sequence];
+                m_bChanged   = true;
+            }
+        }
+        ++it;
+    }
+}
+
+int Sequence::getFollowPending() { return m_nFollowPending; }
+
+void Sequence::seedRandom(uint32_t seed) { m_random.seed(seed); }
+
+uint8_t Sequence::clock(uint64_t nTime, bool bSync, double dSamplesPerClock) {
+    m_nCurrentTrack  = 0;
+    m_nFollowPending = -2;
+    uint8_t nReturn  = 0;
+    uint8_t nState   = m_nState;
     if (bSync) {
         if (m_nMode == ONESHOTSYNC && m_nState != STARTING)
             m_nState = STOPPED;
@@ -148,6 +215,7 @@ uint8_t Sequence::clock(uint32_t nTime, bool bSync, double dSamplesPerClock) {
     }
     if (m_nPosition >= m_nLength) {
         // End of sequence
+        bool bFollow = (m_nState == PLAYING && m_nLength && m_nFollowAction != FOLLOW_NONE && !m_vFollowTargets.empty());
         switch (m_nMode) {
         case ONESHOT:
         case ONESHOTALL:
@@ -166,6 +234,27 @@ uint8_t Sequence::clock(uint32_t nTime, bool bSync, double dSamplesPerClock) {
         }
         m_nPosition    = 0;
         m_nLastSyncPos = 0;
+        if (bFollow && (++m_nLoops >= m_nFollowLoops || m_nState == STOPPED)) {
+            // Choose target now so that sequence manager can start it at loop point
+            m_nLoops         = 0;
+            m_nFollowPending = -1;
+            if (m_nFollowAction == FOLLOW_RANDOM || m_nFollowAction == FOLLOW_SCENE) {
+                uint32_t nTotal = 0;
+                for (auto it = m_vFollowTargets.begin(); it != m_vFollowTargets.end(); ++it)
+                    nTotal += it->weight;
+                if (nTotal) {
+                    uint32_t nChoice = m_random() % nTotal;
+                    for (m_nFollowPending = 0; nChoice >= m_vFollowTargets[m_nFollowPending].weight; ++m_nFollowPending)
+                        nChoice -= m_vFollowTargets[m_nFollowPending].weight;
+                } else
+                    m_nFollowPending = -2; // No target may be chosen
+            }
+            if (m_nFollowPending != -2) {
+                if (m_bFollowStop)
+                    setPlayState(STOPPED);
+                nReturn |= 4;
+            }
+        }
     }
 
     m_bStateChanged |= (nState != m_nState);
@@ -3,9 +3,17 @@
 #include "constants.h"
 #include "timebase.h"
 #include "track.h"
+#include <random>
 #include <string>
 #include <vector>
 
+// Sequence started or stopped by a follow action
+struct FOLLOW_TARGET {
+    uint8_t bank     = 0; // Index of bank containing target sequence
+    uint8_t sequence = 0; // Index of target sequence within bank
+    uint8_t weight   = 1; // Relative probability of target being chosen by random follow actions
+};
+
 /** Sequence class provides a collection of tracks
  *   A collection of tracks that will play in unison / simultaneously
  *   A timebase track which allows change of tempo and time signature during playback
@@ -79,6 +87,12 @@ class Sequence {
      */
     Track* getTrack(size_t index);
 
+    /** @brief  Get pointer to track that provided last event
+     *   @retval Track* Pointer to track or NULL if no more events
+     *   @note   Valid after call to getEvent()
+     */
+    Track* getCurrentTrack();
+
     /** @brief  Add tempo event to timebase track
      *   @param  tempo Tempo in BPM
      *   @param  bar Bar (measure) at which to set tempo
@@ -112,15 +126,79 @@ class Sequence {
      */
     Timebase* getTimebase();
 
+    /** @brief  Set follow action
+     *   @param  action Follow action [FOLLOW_NONE | FOLLOW_START | FOLLOW_STOP | FOLLOW_RANDOM | FOLLOW_SCENE]
+     *   @param  loops Quantity of times sequence plays to end before follow action is performed [1..65535]
+     *   @param  stop True to stop this sequence when follow action is performed
+     *   @note   Follow action is also performed when a one-shot sequence ends before completing its loops
+     */
+    void setFollowAction(uint8_t action, uint16_t loops, bool stop);
+
+    /** @brief  Get follow action
+     *   @retval uint8_t Follow action
+     */
+    uint8_t getFollowAction();
+
+    /** @brief  Get quantity of loops before follow action is performed
+     *   @retval uint16_t Quantity of loops
+     */
+    uint16_t getFollowLoops();
+
+    /** @brief  Check if sequence stops when follow action is performed
+     *   @retval bool True if sequence stops
+     */
+    bool getFollowStop();
+
+    /** @brief  Add a follow action target
+     *   @param  bank Index of bank containing target sequence
+     *   @param  sequence Index of target sequence within bank
+     *   @param  weight Relative probability of target being chosen by random follow actions
+     *   @retval bool True on success, false if MAX_FOLLOW_TARGETS already added or weight is zero
+     */
+    bool addFollowTarget(uint8_t bank, uint8_t sequence, uint8_t weight);
+
+    /** @brief  Remove all follow action targets
+     */
+    void clearFollowTargets();
+
+    /** @brief  Get quantity of follow action targets
+     *   @retval uint8_t Quantity of targets
+     */
+    uint8_t getFollowTargets();
+
+    /** @brief  Get a follow action target
+     *   @param  index Index of target
+     *   @retval FOLLOW_TARGET* Pointer to target or NULL if bad index
+     */
+    FOLLOW_TARGET* getFollowTarget(uint8_t index);
+
+    /** @brief  Update follow action targets after sequences in a bank are reordered
+     *   @param  bank Index of bank that was reordered
+     *   @param  vIndex New index of each sequence, indexed by old index (-1 to remove targets of a removed sequence)
+     */
+    void remapFollowTargets(uint8_t bank, const std::vector<int>& vIndex);
+
+    /** @brief  Get follow action target chosen at last clock
+     *   @retval int Index of target chosen for random or scene actions, -1 for all targets or -2 if follow action not triggered at last clock
+     *   @note   Valid after call to clock()
+     */
+    int getFollowPending();
+
+    /** @brief  Seed pseudo random generator used to choose follow action targets
+     *   @param  seed Seed value
+     */
+    void seedRandom(uint32_t seed);
+
     /** @brief  Handle clock signal
-     *   @param  nTime Time (quantity of samples since JACK epoch)
+     *   @param  nTime Time (64-bit frame time extended from JACK frame time)
      *   @param  bSync True to indicate sync pulse, e.g. to sync tracks
      *   @param  dSamplesPerClock Samples per clock
-     *   @retval uint8_t Bitwise flag of what clock triggers [1=track step | 2=change of state]
+     *   @retval uint8_t Bitwise flag of what clock triggers [1=track step | 2=change of state | 4=follow action]
      *   @note   Sequences are clocked syncronously but not locked to absolute time so depend on start time for absolute timing
      *   @note   Will clock each track
+     *   @note   Follow action is evaluated at end of sequence and performed by sequence manager before next clock so that targets start at loop point
      */
-    uint8_t clock(uint32_t nTime, bool bSync, double dSamplesPerClock);
+    uint8_t clock(uint64_t nTime, bool bSync, double dSamplesPerClock);
 
     /** @brief  Gets next event at current clock cycle
      *   @retval SEQ_EVENT* Pointer to sequence event at this time or NULL if no more events
@@ -187,4 +265,11 @@ class Sequence {
     bool m_bStateChanged    = false;   // True if state changed since last clock cycle
     bool m_bEmpty           = true;    // True if all patterns are emtpy (no events)
     std::string m_sName;               // Sequence name
+    uint8_t m_nFollowAction = FOLLOW_NONE; // Follow action
+    uint16_t m_nFollowLoops = 1;       // Quantity of loops before follow action
+    bool m_bFollowStop      = true;    // True to stop sequence when follow action performed
+    uint16_t m_nLoops       = 0;       // Quantity of loops played since sequence started
+    int m_nFollowPending    = -2;      // Follow action target chosen at last clock (-1 for all, -2 if none)
+    std::vector<FOLLOW_TARGET> m_vFollowTargets; // Follow action targets
+    std::minstd_rand m_random{std::random_device{}()}; // Pseudo random generator for choosing follow action targets
 };
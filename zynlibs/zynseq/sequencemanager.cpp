@@ -4,7 +4,17 @@
 
 /** SequenceManager class methods implementation **/
 
-SequenceManager::SequenceManager() { init(); }
+SequenceManager::SequenceManager() {
+    sem_init(&m_semWorkers, 0, 0);
+    sem_init(&m_semJobsDone, 0, 0);
+    init();
+}
+
+SequenceManager::~SequenceManager() {
+    setParallelWorkers(0);
+    sem_destroy(&m_semWorkers);
+    sem_destroy(&m_semJobsDone);
+}
 
 void SequenceManager::init() {
     stop();
@@ -115,13 +125,48 @@ void SequenceManager::copyPattern(uint32_t source, uint32_t destination) {
 
 Sequence* SequenceManager::getSequence(uint8_t bank, uint8_t sequence) {
     // Add missing sequences
-    while (m_mBanks[bank].size() <= sequence) {
-        m_mBanks[bank].push_back(new Sequence());
-        addPattern(bank, m_mBanks[bank].size() - 1, 0, 0, createPattern(), false);
+    if (m_mBanks[bank].size() <= sequence) {
+        while (m_mBanks[bank].size() <= sequence) {
+            m_mBanks[bank].push_back(new Sequence());
+            addPattern(bank, m_mBanks[bank].size() - 1, 0, 0, createPattern(), false);
+        }
+        reservePlayingSequences();
     }
     return m_mBanks[bank][sequence];
 }
 
+void SequenceManager::reservePlayingSequences() {
+    // Each sequence appears at most once in the playing list so it never grows in the audio thread
+    size_t nSequences = 0;
+    for (auto it = m_mBanks.begin(); it != m_mBanks.end(); ++it)
+        nSequences += it->second.size();
+    if (m_vPlayingSequences.capacity() < nSequences)
+        m_vPlayingSequences.reserve(nSequences);
+}
+
+void SequenceManager::remapSequences(uint8_t bank, const std::vector<int>& vIndex) {
+    for (auto itBank = m_mBanks.begin(); itBank != m_mBanks.end(); ++itBank)
+        for (auto itSeq = itBank->second.begin(); itSeq != itBank->second.end(); ++itSeq)
+            (*itSeq)->remapFollowTargets(bank, vIndex);
+    for (auto it = m_vPlayingSequences.begin(); it != m_vPlayingSequences.end();) {
+        if (it->first == bank && it->second < vIndex.size()) {
+            if (vIndex[it->second] < 0) {
+                it = m_vPlayingSequences.erase(it);
+                continue;
+            }
+            it->second = vIndex[it->second];
+        }
+        ++it;
+    }
+}
+
+Sequence* SequenceManager::findSequence(uint8_t bank, uint8_t sequence) {
+    auto it = m_mBanks.find(bank);
+    if (it == m_mBanks.end() || sequence >= it->second.size())
+        return NULL;
+    return it->second[sequence];
+}
+
 bool SequenceManager::addPattern(uint8_t bank, uint8_t sequence, uint32_t track, uint32_t position, uint32_t pattern, bool force) {
     Sequence* pSequence = getSequence(bank, sequence);
     Track* pTrack       = pSequence->getTrack(track);
@@ -150,39 +195,228 @@ void SequenceManager::updateAllSequenceLengths() {
             (*itSeq)->updateLength();
 }
 
-size_t SequenceManager::clock(std::pair<double, double> timeinfo, std::multimap<uint32_t, MIDI_MESSAGE*>* pSchedule, bool bSync) {
+void SequenceManager::clockSequence(Sequence* pSequence, uint64_t nTime, double dSamplesPerClock, bool bSync,
+                                    std::multimap<uint64_t, MIDI_MESSAGE*>* pSchedule) {
+    uint8_t nEventType = pSequence->clock(nTime, bSync, dSamplesPerClock);
+    if (nEventType & 1) {
+        // A step event
+        while (SEQ_EVENT* pEvent = pSequence->getEvent()) {
+            uint64_t nEventTime = pEvent->time;
+            if (pEvent->msg.data) {
+                // SysEx bypasses MIDI effects and is copied from pattern pool so that it survives pattern edits whilst scheduled
+                uint8_t* pData = allocSysex(pEvent->msg.data, pEvent->msg.size);
+                if (!pData)
+                    continue; // Arena full - drop message rather than allocate in realtime thread
+                MIDI_MESSAGE* pNewEvent = new MIDI_MESSAGE(pEvent->msg);
+                pNewEvent->data         = pData;
+                pSchedule->insert(std::pair<uint64_t, MIDI_MESSAGE*>(nEventTime, pNewEvent));
+                continue;
+            }
+            MidiFx* pMidiFx = pSequence->getCurrentTrack()->getMidiFx();
+            if (pMidiFx->isEnabled()) {
+                pMidiFx->process(nEventTime, pEvent->msg, pSchedule);
+                continue;
+            }
+            MIDI_MESSAGE* pNewEvent = new MIDI_MESSAGE(pEvent->msg);
+            pSchedule->insert(std::pair<uint64_t, MIDI_MESSAGE*>(nEventTime, pNewEvent));
+            // fprintf(stderr, "Clock time: %u Scheduling event 0x%x 0x%x 0x%x with time %u at %u framesPerClock: %f\n", nTime, pEvent->msg.command,
+            // pEvent->msg.value1, pEvent->msg.value2, pEvent->time, nEventTime, dSamplesPerClock);
+        }
+    }
+    uint8_t nState = pSequence->getPlayState();
+    if (nState == PLAYING || nState == STOPPING || nState == STOPPING_SYNC) {
+        // Note repeat and arpeggiator are clocked while sequence plays
+        for (uint32_t nTrack = 0; nTrack < pSequence->getTracks(); ++nTrack)
+            pSequence->getTrack(nTrack)->getMidiFx()->clock(nTime, dSamplesPerClock, pSchedule);
+    }
+    if (nEventType & 2) {
+        // Change of state
+        // uint8_t nTrigger = getTriggerNote(it->first, it->second);
+        // It's currently polled from python
+    }
+}
+
+uint8_t* SequenceManager::allocSysex(const uint8_t* pData, uint16_t nSize) {
+    uint32_t nPos = m_nSysexPos.fetch_add(nSize, std::memory_order_relaxed);
+    if (nPos + nSize > SYSEX_ARENA_SIZE)
+        return NULL;
+    m_nSysexPending.fetch_add(1, std::memory_order_relaxed);
+    memcpy(m_aSysexArena + nPos, pData, nSize);
+    return m_aSysexArena + nPos;
+}
+
+void SequenceManager::releaseSysex() {
+    if (m_nSysexPending.load(std::memory_order_relaxed))
+        m_nSysexPending.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void SequenceManager::seedRandom(uint32_t seed) {
+    uint32_t nTrackIndex = 0;
+    for (auto itBank = m_mBanks.begin(); itBank != m_mBanks.end(); ++itBank)
+        for (auto itSeq = itBank->second.begin(); itSeq != itBank->second.end(); ++itSeq)
+            for (uint32_t nTrack = 0; nTrack < (*itSeq)->getTracks(); ++nTrack)
+                (*itSeq)->getTrack(nTrack)->seedRandom(seed + nTrackIndex++);
+    uint32_t nSequenceIndex = 0;
+    for (auto itBank = m_mBanks.begin(); itBank != m_mBanks.end(); ++itBank)
+        for (auto itSeq = itBank->second.begin(); itSeq != itBank->second.end(); ++itSeq)
+            (*itSeq)->seedRandom(~seed + nSequenceIndex++);
+}
+
+bool SequenceManager::locateSequence(Sequence* pSequence, uint8_t* bank, uint8_t* sequence) {
+    for (auto itBank = m_mBanks.begin(); itBank != m_mBanks.end(); ++itBank)
+        for (size_t nIndex = 0; nIndex < itBank->second.size(); ++nIndex)
+            if (itBank->second[nIndex] == pSequence) {
+                *bank     = itBank->first;
+                *sequence = nIndex;
+                return true;
+            }
+    return false;
+}
+
+bool SequenceManager::runParallelJob() {
+    uint64_t nCursor = m_nJobCursor.load(std::memory_order_acquire);
+    do {
+        if ((nCursor & 0xFFFFFFFF) >= (nCursor >> 32))
+            return false;
+    } while (!m_nJobCursor.compare_exchange_weak(nCursor, nCursor + 1, std::memory_order_acq_rel, std::memory_order_acquire));
+    PARALLEL_JOB& job = m_vJobs[nCursor & 0xFFFFFFFF];
+    clockSequence(job.pSequence, m_nJobTime, m_dJobSamplesPerClock, m_bJobSync, &job.mEvents);
+    if (m_nJobsDone.fetch_add(1, std::memory_order_acq_rel) + 1 == (nCursor >> 32))
+        sem_post(&m_semJobsDone); // Last job of this clock
+    return true;
+}
+
+void* SequenceManager::parallelWorker(void* pArgs) {
+    SequenceManager* pThis = (SequenceManager*)pArgs;
+    while (true) {
+        sem_wait(&pThis->m_semWorkers);
+        if (!pThis->m_bWorkersRunning)
+            break;
+        while (pThis->runParallelJob())
+            ;
+    }
+    return NULL;
+}
+
+size_t SequenceManager::clock(std::pair<double, double> timeinfo, std::multimap<uint64_t, MIDI_MESSAGE*>* pSchedule, bool bSync) {
     /** Get events scheduled for next step from all tracks in each playing sequence.
         Populate schedule with start, end and interpolated events
     */
-    uint32_t nTime          = timeinfo.first;
+    uint64_t nTime          = timeinfo.first;
     double dSamplesPerClock = timeinfo.second;
-    for (auto it = m_vPlayingSequences.begin(); it != m_vPlayingSequences.end();) {
+    uint8_t nWorkers        = m_nWorkers;
+    if (m_nSysexPending.load(std::memory_order_relaxed) == 0)
+        m_nSysexPos.store(0, std::memory_order_relaxed); // Nothing refers to arena so rewind
+    if (nWorkers == 0 || m_vPlayingSequences.size() < m_nParallelThreshold) {
+        // Serial event generation - small workload does not justify waking workers
+        for (auto it = m_vPlayingSequences.begin(); it != m_vPlayingSequences.end();) {
+            Sequence* pSequence = getSequence(it->first, it->second);
+            if (pSequence->getPlayState() == STOPPED) {
+                it = m_vPlayingSequences.erase(it);
+                continue;
+            }
+            clockSequence(pSequence, nTime, dSamplesPerClock, bSync, pSchedule);
+            ++it;
+        }
+        performFollowActions();
+        return m_vPlayingSequences.size();
+    }
+
+    /*  Parallel event generation - each playing sequence is a job processed by the next free worker (or this thread) into its own buffer.
+        Sequences share no playback state so may be processed concurrently. Buffers are merged into the schedule in play order so that
+        events are ordered by time then sequence, exactly as serial generation. Jobs are preallocated by setParallelWorkers and merging moves
+        each event's node into the schedule so no memory is allocated here. Sequences beyond the preallocated jobs are clocked after the merge.
+    */
+    size_t nJobs = 0;
+    auto it      = m_vPlayingSequences.begin();
+    while (it != m_vPlayingSequences.end() && nJobs < m_vJobs.size()) {
         Sequence* pSequence = getSequence(it->first, it->second);
         if (pSequence->getPlayState() == STOPPED) {
             it = m_vPlayingSequences.erase(it);
             continue;
         }
-        uint8_t nEventType = pSequence->clock(nTime, bSync, dSamplesPerClock);
-        if (nEventType & 1) {
-            // A step event
-            while (SEQ_EVENT* pEvent = pSequence->getEvent()) {
-                uint32_t nEventTime     = pEvent->time;
-                MIDI_MESSAGE* pNewEvent = new MIDI_MESSAGE(pEvent->msg);
-                pSchedule->insert(std::pair<uint32_t, MIDI_MESSAGE*>(nEventTime, pNewEvent));
-                // fprintf(stderr, "Clock time: %u Scheduling event 0x%x 0x%x 0x%x with time %u at %u framesPerClock: %f\n", nTime, pEvent->msg.command,
-                // pEvent->msg.value1, pEvent->msg.value2, pEvent->time, nEventTime, dSamplesPerClock);
-            }
-        }
-        if (nEventType & 2) {
-            // Change of state
-            // uint8_t nTrigger = getTriggerNote(it->first, it->second);
-            // It's currently polled from python
+        m_vJobs[nJobs++].pSequence = pSequence;
+        ++it;
+    }
+    if (nJobs) {
+        m_nJobTime            = nTime;
+        m_dJobSamplesPerClock = dSamplesPerClock;
+        m_bJobSync            = bSync;
+        m_nJobsDone.store(0, std::memory_order_relaxed);
+        m_nJobCursor.store(uint64_t(nJobs) << 32, std::memory_order_release);
+        for (uint8_t nWorker = 0; nWorker < nWorkers && nWorker + 1u < nJobs; ++nWorker)
+            sem_post(&m_semWorkers);
+        while (runParallelJob())
+            ;
+        while (sem_wait(&m_semJobsDone)) // Posted by whichever thread completes the last job (workers have same priority as this thread)
+            ;
+        for (size_t nJob = 0; nJob < nJobs; ++nJob)
+            pSchedule->merge(m_vJobs[nJob].mEvents); // Each event is inserted after existing events with same time
+    }
+    while (it != m_vPlayingSequences.end()) {
+        Sequence* pSequence = getSequence(it->first, it->second);
+        if (pSequence->getPlayState() == STOPPED) {
+            it = m_vPlayingSequences.erase(it);
+            continue;
         }
+        clockSequence(pSequence, nTime, dSamplesPerClock, bSync, pSchedule);
         ++it;
     }
+    performFollowActions();
     return m_vPlayingSequences.size();
 }
 
+void SequenceManager::launchSequence(uint8_t bank, uint8_t sequence) {
+    Sequence* pSequence = findSequence(bank, sequence);
+    if (!pSequence)
+        return; // Missing targets are ignored rather than created in the audio thread
+    setSequencePlayState(bank, sequence, PLAYING);
+    pSequence->setPlayPosition(0);
+    for (uint32_t nTrack = 0; nTrack < pSequence->getTracks(); ++nTrack)
+        pSequence->getTrack(nTrack)->setPosition(0);
+}
+
+void SequenceManager::performFollowActions() {
+    // Sequences launched by follow actions are appended to playing sequences but were not clocked so are not checked
+    size_t nCount = m_vPlayingSequences.size();
+    for (size_t nIndex = 0; nIndex < nCount && nIndex < m_vPlayingSequences.size(); ++nIndex) {
+        Sequence* pSequence = findSequence(m_vPlayingSequences[nIndex].first, m_vPlayingSequences[nIndex].second);
+        if (!pSequence)
+            continue;
+        int nChoice = pSequence->getFollowPending();
+        if (nChoice == -2)
+            continue;
+        FOLLOW_TARGET* pTarget = pSequence->getFollowTarget(nChoice < 0 ? 0 : nChoice);
+        switch (pSequence->getFollowAction()) {
+        case FOLLOW_START:
+            for (uint8_t nTarget = 0; (pTarget = pSequence->getFollowTarget(nTarget)); ++nTarget)
+                launchSequence(pTarget->bank, pTarget->sequence);
+            break;
+        case FOLLOW_STOP:
+            for (uint8_t nTarget = 0; (pTarget = pSequence->getFollowTarget(nTarget)); ++nTarget)
+                if (findSequence(pTarget->bank, pTarget->sequence))
+                    setSequencePlayState(pTarget->bank, pTarget->sequence, STOPPED);
+            break;
+        case FOLLOW_RANDOM:
+            if (pTarget)
+                launchSequence(pTarget->bank, pTarget->sequence);
+            break;
+        case FOLLOW_SCENE:
+            if (!pTarget)
+                break;
+            stop();
+            for (uint32_t nSequence = 0; nSequence <= 0xFF; ++nSequence) {
+                Sequence* pSceneSequence = findSequence(pTarget->bank, nSequence);
+                if (!pSceneSequence)
+                    break;
+                if (!pSceneSequence->isEmpty())
+                    launchSequence(pTarget->bank, nSequence);
+            }
+            break;
+        }
+    }
+}
+
 void SequenceManager::setSequencePlayState(uint8_t bank, uint8_t sequence, uint8_t state) {
     Sequence* pSequence = getSequence(bank, sequence);
     if (state == STARTING || state == PLAYING || state == RESTARTING) {
@@ -236,6 +470,8 @@ uint16_t SequenceManager::getTriggerSequence(uint8_t note) {
 
 size_t SequenceManager::getPlayingSequencesCount() { return m_vPlayingSequences.size(); }
 
+const std::vector<std::pair<uint32_t, uint32_t>>& SequenceManager::getPlayingSequences() { return m_vPlayingSequences; }
+
 void SequenceManager::stop() {
     for (auto it = m_vPlayingSequences.begin(); it != m_vPlayingSequences.end(); ++it)
         getSequence(it->first, it->second)->setPlayState(STOPPED);
@@ -291,30 +527,105 @@ bool SequenceManager::moveSequence(uint8_t bank, uint8_t sequence, uint8_t posit
     if (position >= getSequencesInBank(bank))
         setSequencesInBank(bank, position + 1);
     Sequence* pSequence = getSequence(bank, sequence); // Store sequence we want to move
+    std::vector<int> vIndex(getSequencesInBank(bank));
+    for (size_t nIndex = 0; nIndex < vIndex.size(); ++nIndex)
+        vIndex[nIndex] = nIndex;
     if (position < sequence) {
-        for (size_t nIndex = sequence; nIndex > position; --nIndex)
+        for (size_t nIndex = sequence; nIndex > position; --nIndex) {
             m_mBanks[bank][nIndex] = m_mBanks[bank][nIndex - 1];
+            vIndex[nIndex - 1]     = nIndex;
+        }
         m_mBanks[bank][position] = pSequence;
     } else if (position > sequence) {
-        for (size_t nIndex = sequence; nIndex < position; ++nIndex)
+        for (size_t nIndex = sequence; nIndex < position; ++nIndex) {
             m_mBanks[bank][nIndex] = m_mBanks[bank][nIndex + 1];
+            vIndex[nIndex + 1]     = nIndex;
+        }
         m_mBanks[bank][position] = pSequence;
     }
+    vIndex[sequence] = position;
+    remapSequences(bank, vIndex);
     return true;
 }
 
 void SequenceManager::insertSequence(uint8_t bank, uint8_t sequence) {
+    if (sequence > getSequencesInBank(bank))
+        getSequence(bank, sequence - 1);
+    std::vector<int> vIndex(getSequencesInBank(bank));
+    for (size_t nIndex = 0; nIndex < vIndex.size(); ++nIndex)
+        vIndex[nIndex] = nIndex < sequence ? nIndex : nIndex + 1;
     m_mBanks[bank].insert(m_mBanks[bank].begin() + sequence, new Sequence());
     addPattern(bank, sequence, 0, 0, createPattern(), false);
+    remapSequences(bank, vIndex);
+    reservePlayingSequences();
 }
 
 void SequenceManager::removeSequence(uint8_t bank, uint8_t sequence) {
     if (sequence < m_mBanks[bank].size()) {
+        std::vector<int> vIndex(getSequencesInBank(bank));
+        for (size_t nIndex = 0; nIndex < vIndex.size(); ++nIndex)
+            vIndex[nIndex] = nIndex < sequence ? nIndex : nIndex - 1;
+        vIndex[sequence] = -1;
         delete (m_mBanks[bank][sequence]);
         m_mBanks[bank].erase(m_mBanks[bank].begin() + sequence);
+        remapSequences(bank, vIndex);
     }
 }
 
 void SequenceManager::clearBank(uint32_t bank) { setSequencesInBank(bank, 0); }
 
 uint32_t SequenceManager::getBanks() { return m_mBanks.size(); }
+
+void SequenceManager::setParallelWorkers(uint8_t workers, int priority) {
+    if (workers > MAX_PARALLEL_WORKERS)
+        workers = MAX_PARALLEL_WORKERS;
+    if (workers == m_nWorkers)
+        return;
+    // Stop existing workers - the process thread completes any jobs not yet claimed
+    uint8_t nWorkers = m_nWorkers;
+    m_nWorkers       = 0;
+    if (nWorkers) {
+        m_bWorkersRunning = false;
+        for (uint8_t nWorker = 0; nWorker < nWorkers; ++nWorker)
+            sem_post(&m_semWorkers);
+        for (uint8_t nWorker = 0; nWorker < nWorkers; ++nWorker)
+            pthread_join(m_aWorkers[nWorker], NULL);
+        // Discard stale wake-ups
+        while (sem_trywait(&m_semWorkers) == 0)
+            ;
+    }
+    if (workers == 0)
+        return;
+
+    // Jobs are preallocated so that the process thread does not allocate them
+    if (m_vJobs.size() < MAX_PARALLEL_JOBS)
+        m_vJobs.resize(MAX_PARALLEL_JOBS);
+    m_bWorkersRunning = true;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (priority > 0) {
+        sched_param param;
+        param.sched_priority = priority;
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+    for (nWorkers = 0; nWorkers < workers; ++nWorkers) {
+        // A normal priority worker could be starved by the realtime process thread waiting for it so only realtime workers are used with realtime JACK
+        int nError = pthread_create(&m_aWorkers[nWorkers], &attr, parallelWorker, this);
+        if (nError) {
+            fprintf(stderr, "zynseq failed to create worker thread (%d) - parallel event generation limited to %u workers\n", nError, nWorkers);
+            break;
+        }
+    }
+    pthread_attr_destroy(&attr);
+    if (nWorkers == 0)
+        m_bWorkersRunning = false;
+    m_nWorkers = nWorkers;
+}
+
+uint8_t SequenceManager::getParallelWorkers() { return m_nWorkers; }
+
+void SequenceManager::setParallelThreshold(uint32_t threshold) { m_nParallelThreshold = threshold; }
+
+uint32_t SequenceManager::getParallelThreshold() { return m_nParallelThreshold; }
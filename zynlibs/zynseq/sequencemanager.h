@@ -2,9 +2,16 @@
 #include "pattern.h"
 #include "sequence.h"
 #include "track.h"
+#include <atomic>      // provides atomic
 #include <map>
+#include <pthread.h>   // provides multithreading
+#include <semaphore.h> // provides sem_t
 
 #define DEFAULT_TRACK_COUNT 4
+#define MAX_PARALLEL_WORKERS 8        // Maximum quantity of worker threads used for parallel event generation
+#define DEFAULT_PARALLEL_THRESHOLD 16  // Minimum quantity of playing sequences to use parallel event generation
+#define MAX_PARALLEL_JOBS 256          // Maximum quantity of playing sequences generated in parallel (others are generated by process thread)
+#define SYSEX_ARENA_SIZE 65536         // Size of preallocated buffer holding scheduled SysEx messages
 
 /** SequenceManager class provides creation, recall, update and delete of patterns which other modules can subseqnetly use. It manages persistent (disk)
  * storage. SequenceManager is implemented as a singleton ensuring a single instance is available to all callers.
@@ -15,6 +22,10 @@ class SequenceManager {
      */
     SequenceManager();
 
+    /** @brief  Destroy sequence manager object, stopping any worker threads
+     */
+    ~SequenceManager();
+
     /** @brief  Initialise all data
      */
     void init();
@@ -56,12 +67,14 @@ class SequenceManager {
     /** @brief  Copy pattern
      *   @param  source Index of pattern to copy from
      *   @param  destination Index of pattern to populate
+     *   @note   Caller must hold mutex because destination's payload pool is freed whilst process thread may be reading it
      */
     void copyPattern(uint32_t source, uint32_t destination);
 
     /** @brief  Replace pattern
      *   @param  index Pattern index
      *   @param  pattern Pointer to new pattern
+     *   @note   Caller must hold mutex because existing payload pool is freed whilst process thread may be reading it
      */
     void replacePattern(uint32_t index, Pattern* pattern);
 
@@ -77,13 +90,13 @@ class SequenceManager {
     void updateAllSequenceLengths();
 
     /** @brief  Handle clock
-     *   @param  timeinfo Pair: Offset since JACK epoch for start of next period, duration of clock cycle in frames
+     *   @param  timeinfo Pair: 64-bit frame time of clock, duration of clock cycle in frames
      *   @param  pSchedule Pointer to the schedule to populate with events
      *   @param  bSync True indicates a sync pulse
      *   @param  dSamplesPerClock Quantity of samples in each clock cycle
      *   @retval size_t Quantity of playing sequences
      */
-    size_t clock(std::pair<double, double> timeinfo, std::multimap<uint32_t, MIDI_MESSAGE*>* pSchedule, bool bSync);
+    size_t clock(std::pair<double, double> timeinfo, std::multimap<uint64_t, MIDI_MESSAGE*>* pSchedule, bool bSync);
 
     /** @brief  Get pointer to sequence
      *   @param  bank Index of bank containing sequence
@@ -93,6 +106,14 @@ class SequenceManager {
      */
     Sequence* getSequence(uint8_t bank, uint8_t sequence);
 
+    /** @brief  Get pointer to sequence without creating it
+     *   @param  bank Index of bank containing sequence
+     *   @param  sequence Index of sequence within bank
+     *   @retval Sequence* Pointer to sequence or NULL if sequence does not exist
+     *   @note   Does not allocate so may be used within realtime thread
+     */
+    Sequence* findSequence(uint8_t bank, uint8_t sequence);
+
     /** @brief  Add pattern to sequence
      *   @param  bank Index of bank
      *   @param  sequence Index of sequence
@@ -175,6 +196,11 @@ class SequenceManager {
      */
     size_t getPlayingSequencesCount();
 
+    /** @brief  Get playing sequences
+     *   @retval std::vector<std::pair<uint32_t, uint32_t>>& Reference to vector of <bank,sequence> pairs of sequences starting, playing or stopping
+     */
+    const std::vector<std::pair<uint32_t, uint32_t>>& getPlayingSequences();
+
     /** @brief  Stop all collections / sequences
      */
     void stop();
@@ -228,7 +254,105 @@ class SequenceManager {
      */
     uint32_t getBanks();
 
+    /** @brief  Set quantity of worker threads used to generate events in parallel
+     *   @param  workers Quantity of worker threads [0..MAX_PARALLEL_WORKERS] (0 to disable parallel event generation)
+     *   @param  priority Realtime (SCHED_FIFO) priority of worker threads or 0 for normal priority
+     *   @note   Call from non-realtime thread whilst process thread is not clocking sequences. The JACK process thread also generates events whilst waiting
+     *           for workers. Jobs for MAX_PARALLEL_JOBS playing sequences are preallocated.
+     *   @note   Workers should have same scheduling as JACK process thread. If realtime priority is requested but not permitted, no workers are started.
+     */
+    void setParallelWorkers(uint8_t workers, int priority = 0);
+
+    /** @brief  Get quantity of worker threads used to generate events in parallel
+     *   @retval uint8_t Quantity of worker threads (0 if parallel event generation disabled)
+     */
+    uint8_t getParallelWorkers();
+
+    /** @brief  Set minimum quantity of playing sequences for parallel event generation
+     *   @param  threshold Quantity of playing sequences below which events are generated serially
+     */
+    void setParallelThreshold(uint32_t threshold);
+
+    /** @brief  Get minimum quantity of playing sequences for parallel event generation
+     *   @retval uint32_t Quantity of playing sequences
+     */
+    uint32_t getParallelThreshold();
+
+    /** @brief  Release a scheduled SysEx message after it has been sent or discarded
+     *   @note   Call from JACK process thread. Arena is reused when all scheduled SysEx messages are released.
+     */
+    void releaseSysex();
+
+    /** @brief  Seed pseudo random generators of all tracks and sequences
+     *   @param  seed Seed value (each track and sequence is seeded with a value derived from this)
+     *   @note   Used to make play chance, humanisation, arpeggiator and follow action choice repeatable during capture and replay
+     */
+    void seedRandom(uint32_t seed);
+
+    /** @brief  Find bank and index of a sequence
+     *   @param  pSequence Pointer to sequence
+     *   @param  bank Pointer to populate with bank
+     *   @param  sequence Pointer to populate with index of sequence within bank
+     *   @retval bool True if found
+     */
+    bool locateSequence(Sequence* pSequence, uint8_t* bank, uint8_t* sequence);
+
   private:
+    // Events generated by one playing sequence during parallel event generation
+    struct PARALLEL_JOB {
+        Sequence* pSequence = nullptr;                  // Pointer to the sequence
+        std::multimap<uint64_t, MIDI_MESSAGE*> mEvents; // Events generated by sequence, moved into schedule after all jobs complete
+    };
+
+    /** @brief  Start a sequence from its start at next clock
+     *   @param  bank Index of bank containing sequence
+     *   @param  sequence Index of sequence within bank
+     */
+    void launchSequence(uint8_t bank, uint8_t sequence);
+
+    /** @brief  Perform follow actions of sequences that reached end of their last loop at this clock
+     *   @note   Called after all playing sequences are clocked so that targets start at the next clock (loop point)
+     */
+    void performFollowActions();
+
+    /** @brief  Reserve playing sequences list for all sequences so that it is not reallocated by the audio thread
+     */
+    void reservePlayingSequences();
+
+    /** @brief  Update follow action targets and playing sequences after sequences in a bank are reordered
+     *   @param  bank Index of bank
+     *   @param  vIndex New index of each sequence, indexed by old index (-1 if sequence was removed)
+     */
+    void remapSequences(uint8_t bank, const std::vector<int>& vIndex);
+
+    /** @brief  Clock a sequence and schedule its events
+     *   @param  pSequence Pointer to the sequence
+     *   @param  nTime 64-bit frame time of clock
+     *   @param  dSamplesPerClock Quantity of samples in each clock cycle
+     *   @param  bSync True if sync point
+     *   @param  pSchedule Pointer to the schedule to populate with events
+     */
+    void clockSequence(Sequence* pSequence, uint64_t nTime, double dSamplesPerClock, bool bSync, std::multimap<uint64_t, MIDI_MESSAGE*>* pSchedule);
+
+    /** @brief  Claim and process the next pending parallel job
+     *   @retval bool True if a job was processed, false if no more jobs
+     */
+    bool runParallelJob();
+
+    /** @brief  Worker thread function
+     *   @param  pArgs Pointer to SequenceManager
+     */
+    static void* parallelWorker(void* pArgs);
+
+    /** @brief  Copy a SysEx message to the preallocated arena so that it remains valid whilst scheduled, regardless of pattern edits
+     *   @param  pData Pointer to message
+     *   @param  nSize Quantity of bytes in message
+     *   @retval uint8_t* Pointer to copy or NULL if arena is full
+     *   @note   Does not allocate memory so may be called from JACK process thread and parallel workers
+     */
+    uint8_t* allocSysex(const uint8_t* pData, uint16_t nSize);
+
+
     int fileWrite32(uint32_t value, FILE* pFile);
     int fileWrite16(uint16_t value, FILE* pFile);
     int fileWrite8(uint8_t value, FILE* pFile);
@@ -246,4 +370,23 @@ class SequenceManager {
         m_vPlayingSequences;                             // Vector of <bank,sequence> pairs for currently playing sequences (used to optimise play control)
     std::map<uint8_t, uint16_t> m_mTriggers;             // Map of bank<<8|sequence indexed by MIDI note triggers
     std::map<uint32_t, std::vector<Sequence*>> m_mBanks; // Map of banks: vectors of pointers to sequences indexed by bank
+
+    // Parallel event generation
+    std::vector<PARALLEL_JOB> m_vJobs;                          // Preallocated jobs, one per playing sequence of current clock in play order
+    std::atomic<uint64_t> m_nJobCursor{0};                      // Quantity of jobs << 32 | index of next job to claim
+    std::atomic<uint32_t> m_nJobsDone{0};                       // Quantity of jobs completed
+    uint64_t m_nJobTime           = 0;                          // Clock time of current jobs
+    double m_dJobSamplesPerClock  = 0.0;                        // Samples per clock of current jobs
+    bool m_bJobSync               = false;                      // Sync flag of current jobs
+    pthread_t m_aWorkers[MAX_PARALLEL_WORKERS];                 // Worker threads
+    sem_t m_semWorkers;                                         // Semaphore signalling workers that jobs are available
+    sem_t m_semJobsDone;                                        // Semaphore signalling process thread that all jobs of current clock are complete
+    std::atomic<uint8_t> m_nWorkers{0};                         // Quantity of running worker threads
+    std::atomic<bool> m_bWorkersRunning{false};                 // False to stop worker threads
+    uint32_t m_nParallelThreshold = DEFAULT_PARALLEL_THRESHOLD; // Minimum quantity of playing sequences to use parallel event generation
+
+    // Scheduled SysEx storage
+    uint8_t m_aSysexArena[SYSEX_ARENA_SIZE];     // Copies of scheduled SysEx messages
+    std::atomic<uint32_t> m_nSysexPos{0};        // Offset of next free byte in arena
+    std::atomic<uint32_t> m_nSysexPending{0};    // Quantity of scheduled SysEx messages not yet released
 };
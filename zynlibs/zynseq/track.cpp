@@ -2,16 +2,8 @@
 
 #include "track.h"
 #include <cmath>
-#include <random>
 #include <stdlib.h>
 
-// Random Normal Distribution
-std::random_device rd{};
-std::mt19937 gen{rd()};
-// values near the mean are the most likely
-// standard deviation affects the dispersion of generated values from the mean
-std::normal_distribution d{0.0, 1.0};
-
 bool Track::addPattern(uint32_t position, Pattern* pattern, bool force) {
     // Find (and remove) overlapping patterns
     uint32_t nStart = position;
@@ -92,7 +84,7 @@ void Track::setOutput(uint8_t output) {
     m_bChanged = true;
 }
 
-uint8_t Track::clock(uint32_t nTime, uint32_t nPosition, double dSamplesPerClock, bool bSync) {
+uint8_t Track::clock(uint64_t nTime, uint32_t nPosition, double dSamplesPerClock, bool bSync) {
     if (m_nTrackLength == 0)
         return 0;
     if (m_bMute)
@@ -141,8 +133,7 @@ uint8_t Track::clock(uint32_t nTime, uint32_t nPosition, double dSamplesPerClock
 
 SEQ_EVENT* Track::getEvent() {
     // This function is called repeatedly for each clock period until no more events are available to populate JACK MIDI output schedule
-    static SEQ_EVENT seqEvent;         // A MIDI event timestamped for some imminent or future time
-    static uint32_t nStutterCount = 0; // Count stutters already added to this event
+    SEQ_EVENT& seqEvent = m_seqEvent; // A MIDI event timestamped for some imminent or future time
     if (m_nCurrentPatternPos < 0 || m_nNextEvent < 0)
         return NULL; //!@todo Can we stop between note on and note off being processed resulting in stuck note?
     // Track is being played and playhead is within a pattern
@@ -154,6 +145,8 @@ SEQ_EVENT* Track::getEvent() {
         // fprintf(stderr, "  found event at %u\n", m_nNextStep);
         uint8_t nCommand     = pEvent->getCommand();
         seqEvent.msg.command = nCommand | m_nChannel;
+        seqEvent.msg.data    = nullptr;
+        seqEvent.msg.size    = 0;
         // Found event at (or before) this step
         if (m_nEventValue == pEvent->getValue2end()) {
             // We have reached the end of interpolation so move on to next event
@@ -163,12 +156,14 @@ SEQ_EVENT* Track::getEvent() {
                 // No more events or next event is not this step so move to next step
                 return NULL;
             }
+            nCommand             = pEvent->getCommand();
+            seqEvent.msg.command = nCommand | m_nChannel;
         }
         // Have not yet started to interpolate value
         if (m_nEventValue == -1) {
             // Note Play Chance
             int playChance = int(RAND_MAX * pPattern->getPlayChance() * pEvent->getPlayChance() / 100.0);
-            if (playChance < RAND_MAX && playChance < rand()) {
+            if (playChance < RAND_MAX && playChance < int(m_random() % RAND_MAX)) {
                 m_nEventValue        = pEvent->getValue2end();
                 seqEvent.msg.command = 0xFE;
                 return &seqEvent;
@@ -186,22 +181,22 @@ SEQ_EVENT* Track::getEvent() {
             // Time humanization => Add to offset
             float humanTime = pPattern->getHumanTime();
             if (humanTime > 0.0)
-                m_fEventOffset += humanTime * d(gen);
+                m_fEventOffset += humanTime * m_normal(m_random);
             // Calculate event scheduled time
             seqEvent.time = m_nLastClockTime + m_fEventOffset * pPattern->getClocksPerStep() * m_dSamplesPerClock;
             // Reset Stutter
-            nStutterCount = 0;
+            m_nStutterCount = 0;
         } else if (pEvent->getValue2start() == m_nEventValue) {
             //!@todo Don't get here if start and end values are the same, e.g. note on and off velocity are both 100
             // Already processed start value
             // Add note off/on for each stutter
             if (nCommand == MIDI_NOTE_ON)
-                seqEvent.msg.command = (nStutterCount % 2 ? MIDI_NOTE_ON : MIDI_NOTE_OFF) | m_nChannel;
+                seqEvent.msg.command = (m_nStutterCount % 2 ? MIDI_NOTE_ON : MIDI_NOTE_OFF) | m_nChannel;
             seqEvent.time = m_nLastClockTime + (m_fEventOffset + pEvent->getDuration()) * pPattern->getClocksPerStep() * m_dSamplesPerClock -
                             1; // -1 to send note-off one sample before next step
             if (pEvent->getStutterCount()) {
-                uint32_t stutter_time = m_nLastClockTime + (m_fEventOffset + pEvent->getStutterDur()) * ++nStutterCount * m_dSamplesPerClock;
-                if (stutter_time < seqEvent.time && 2 * pEvent->getStutterCount() >= nStutterCount)
+                uint64_t stutter_time = m_nLastClockTime + (m_fEventOffset + pEvent->getStutterDur()) * ++m_nStutterCount * m_dSamplesPerClock;
+                if (stutter_time < seqEvent.time && 2 * pEvent->getStutterCount() >= m_nStutterCount)
                     seqEvent.time = stutter_time;
                 else
                     m_nEventValue = pEvent->getValue2end();
@@ -215,10 +210,18 @@ SEQ_EVENT* Track::getEvent() {
         int8_t hval2        = m_nEventValue;
         float humanVelo     = pPattern->getHumanVelo();
         if (humanVelo > 0.0) {
-            int16_t dvelo = int16_t(humanVelo * d(gen));
+            int16_t dvelo = int16_t(humanVelo * m_normal(m_random));
             hval2         = int8_t(std::min(std::max(int16_t(hval2) + dvelo, 0), 127));
         }
         seqEvent.msg.value2 = hval2;
+        if (pEvent->getCommand() == MIDI_SYSEX_START) {
+            // System message has no channel and payload resides in pattern's pool (copied by scheduler)
+            seqEvent.msg.command = MIDI_SYSEX_START;
+            seqEvent.msg.data    = pPattern->getEventData(pEvent);
+            seqEvent.msg.size    = seqEvent.msg.data ? pEvent->getDataSize() : 0;
+            if (!seqEvent.msg.data)
+                seqEvent.msg.command = 0xFE; // Missing payload so send harmless message (as for play chance)
+        }
         // fprintf(stderr, "Track::getEvent Scheduled event %u,%u,%u at %u currentTime: %u duration: %u clkperstep: %u sampleperclock: %f event position: %u\n",
         // seqEvent.msg.command, seqEvent.msg.value1, seqEvent.msg.value2, seqEvent.time, m_nLastClockTime, pEvent->getDuration(), pPattern->getClocksPerStep(),
         // m_dSamplesPerClock, pEvent->getPosition());
@@ -258,17 +261,23 @@ void Track::clear() {
 }
 
 void Track::setPosition(uint32_t position) {
-    m_nDivCount  = 0;
-    m_nNextStep  = position / m_nClkPerStep;
-    // fprintf(stderr, "setPosition: next step: %d\n", m_nNextStep);
-    m_nNextEvent = -1; // Avoid playing wrong pattern
+    m_nDivCount          = 0;
+    m_nNextStep          = 0;
+    m_nNextEvent         = -1; // Avoid playing wrong pattern
+    m_nCurrentPatternPos = -1;
     for (auto it = m_mPatterns.begin(); it != m_mPatterns.end(); ++it) {
-        if (it->first <= position && it->first + it->second->getLength() > position) {
-            // Found pattern that spans position
+        if (it->first < position && it->first + it->second->getLength() > position) {
+            // Found pattern that spans position so set step counters as if previous clock had been processed
             m_nCurrentPatternPos = it->first;
+            m_nClkPerStep        = it->second->getClocksPerStep();
+            if (m_nClkPerStep == 0)
+                m_nClkPerStep = 1;
+            m_nNextStep = (position - it->first - 1) / m_nClkPerStep;
+            m_nDivCount = (position - it->first - 1) % m_nClkPerStep;
             break;
         }
     }
+    // fprintf(stderr, "setPosition: next step: %d\n", m_nNextStep);
 }
 
 uint32_t Track::getNextPattern(uint32_t previous) {
@@ -339,3 +348,11 @@ uint32_t Track::getPatternPosition(Pattern* pattern) {
 }
 
 bool Track::isEmpty() { return m_bEmpty; }
+
+MidiFx* Track::getMidiFx() { return &m_midiFx; }
+
+void Track::seedRandom(uint32_t seed) {
+    m_random.seed(seed);
+    m_normal.reset();
+    m_midiFx.seedRandom(seed);
+}
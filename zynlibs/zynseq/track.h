@@ -1,10 +1,12 @@
 #pragma once
+#include "midifx.h"
 #include "pattern.h"
 #include <forward_list>
 #include <map>
+#include <random>
 
 struct SEQ_EVENT {
-    uint32_t time;
+    uint64_t time; // Scheduled time (64-bit frame time)
     MIDI_MESSAGE msg;
 };
 
@@ -81,14 +83,14 @@ class Track {
     void setOutput(uint8_t output);
 
     /** @brief  Handle clock signal
-     *   @param  nTime Time (quantity of samples since JACK epoch)
+     *   @param  nTime Time (64-bit frame time extended from JACK frame time)
      *   @param  nPosition Play position within sequence in clock cycles
      *   @param  dSamplesPerClock Samples per clock
      *   @param  bSync True if sync point
      *   @retval uint8_t 1 if a step needs processing for this track
      *   @note   Tracks are clocked syncronously but not locked to absolute time so depend on start time for absolute timing
      */
-    uint8_t clock(uint32_t nTime, uint32_t nPosition, double dSamplesPerClock, bool bSync);
+    uint8_t clock(uint64_t nTime, uint32_t nPosition, double dSamplesPerClock, bool bSync);
 
     /** @brief  Gets next event at current clock cycle
      *   @retval SEQ_EVENT* Pointer to sequence event at this time or NULL if no more events
@@ -191,6 +193,16 @@ class Track {
      */
     bool isEmpty();
 
+    /** @brief  Get MIDI effects applied to track
+     *   @retval MidiFx* Pointer to MIDI effects object
+     */
+    MidiFx* getMidiFx();
+
+    /** @brief  Seed pseudo random generators used for play chance, humanisation and MIDI effects
+     *   @param  seed Seed value
+     */
+    void seedRandom(uint32_t seed);
+
   private:
     uint8_t m_nType        = 0;               // 0 = MIDI Track, 1 = Audio, 2 = MIDI Program
     uint8_t m_nChainID     = 0;               // Associated Chain ID. 0 for none.
@@ -204,7 +216,7 @@ class Track {
     int m_nNextEvent          = -1;           // Index of next event to process or -1 if no more events at this clock cycle
     int8_t m_nEventValue      = -1;           // Value of event at current interpolation point or -1 if no event
     float m_fEventOffset      = 0;            // Offset for the currently processed Step event (getEvent)
-    uint32_t m_nLastClockTime = 0;            // Time of last clock pulse (sample)
+    uint64_t m_nLastClockTime = 0;            // Time of last clock pulse (64-bit frame time)
     uint32_t m_nNextStep      = 0;            // Postion within pattern (step)
     uint32_t m_nTrackLength   = 0;            // Quantity of clock cycles in track (last pattern start + length)
     double m_dSamplesPerClock;                // Quantity of samples per MIDI clock cycle used to schedule future events, e.g. note off / interpolation
@@ -212,4 +224,10 @@ class Track {
     bool m_bMute    = false;                  // True if track is muted
     bool m_bChanged = true;                   // True if state changed since last hasChanged()
     bool m_bEmpty   = true;                   // True if all patterns in track are empty (have no events)
+    MidiFx m_midiFx;                          // MIDI effects applied to events as they are scheduled
+
+    SEQ_EVENT m_seqEvent;                                // Event returned by getEvent (per track so tracks may be processed concurrently)
+    uint32_t m_nStutterCount = 0;                        // Count of stutters already added to current event
+    std::minstd_rand m_random{std::random_device{}()};   // Pseudo random generator for play chance and humanisation
+    std::normal_distribution<double> m_normal{0.0, 1.0}; // Normal distribution for humanisation
 };
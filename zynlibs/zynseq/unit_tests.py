@@ -9,18 +9,30 @@ import jack
 from time import sleep
 import time
 import filecmp
+import os
 import binascii
+import subprocess
+import sys
 from zynlibs.zynseq import zynseq
 from zynlibs.zynseq.zynseq import libseq
+from zynlibs.rtmonitor import rtmonitor
 
 client = jack.Client("riban")
 midi_in = client.midi_inports.register("midi_in")
 midi_out = client.midi_outports.register("midi_out")
+sync_gen_port = client.outports.register("sync_gen")
+sync_rec_port = client.inports.register("sync_rec")
+feedback_in = client.midi_inports.register("feedback_in")
 zynseq_midi_out = None
 zynseq_midi_in = None
 libseq = None
 last_rx = bytes(0)
 send_midi = None
+send_midi_at = []  # List of (frame time, message) to send to zynseq at frame
+midi_rec = None  # List of (frame time, message) received from zynseq output or None
+sync_gen = None  # Synthetic sync pulse train (start frame, interval, width) or None
+sync_rec = None  # List of (frame time, samples) recorded from zynseq sync output or None
+feedback_rec = None  # List of (frame time, message) recorded from zynseq feedback output or None
 
 play_state = {"STOPPED": 0, "PLAYING": 1, "STOPPING": 2, "STARTING": 3}
 play_mode = {"DISABLED": 0, "ONESHOT": 1, "LOOP": 2, "ONESHOTALL": 3,
@@ -35,10 +47,44 @@ def process(frames):
     for offset, data in midi_in.incoming_midi_events():
         if data:
             last_rx = data
+            if midi_rec is not None:
+                midi_rec.append((client.last_frame_time + offset, bytes(data)))
     midi_in.clear_buffer()
     if send_midi:
         midi_out.write_midi_event(0, send_midi)
         send_midi = None
+    now = client.last_frame_time
+    for frame, data in list(send_midi_at):
+        if frame < now + frames:
+            if frame >= now:
+                midi_out.write_midi_event(frame - now, data)
+            send_midi_at.remove((frame, data))
+    buffer = sync_gen_port.get_buffer()
+    if sync_gen:
+        start, interval, width = sync_gen
+        pulses = memoryview(buffer).cast('f')
+        for frame in range(frames):
+            pulses[frame] = 1.0 if now + frame >= start and (now + frame - start) % interval < width else 0.0
+    else:
+        buffer[:] = bytes(len(buffer))
+    if sync_rec is not None:
+        sync_rec.append((now, bytes(sync_rec_port.get_buffer())))
+    if feedback_rec is not None:
+        for offset, data in feedback_in.incoming_midi_events():
+            feedback_rec.append((now + offset, bytes(data)))
+
+
+# Get start frame time and width of each complete pulse in recorded sync output
+def get_sync_pulses(record):
+    pulses = []
+    for now, data in record:
+        for frame, sample in enumerate(memoryview(data).cast('f')):
+            if sample > 0.5:
+                if pulses and pulses[-1][0] + pulses[-1][1] == now + frame:
+                    pulses[-1][1] += 1
+                else:
+                    pulses.append([now + frame, 1])
+    return pulses[1:-1]
 
 
 client.activate()
@@ -57,6 +103,9 @@ class TestLibZynSeq(unittest.TestCase):
         zynseq_midi_in = client.get_port_by_name('zynthstep:input')
         midi_in.connect(zynseq_midi_out)
         midi_out.connect(zynseq_midi_in)
+        sync_gen_port.connect('zynthstep:sync_in')
+        sync_rec_port.connect('zynthstep:sync_out')
+        feedback_in.connect('zynthstep:feedback')
     #
 
     def test_aa00_debug(self):
@@ -202,6 +251,752 @@ class TestLibZynSeq(unittest.TestCase):
         libseq.setPlayMode(0, 0, play_mode["LOOPSYNC"])
         self.assertEqual(libseq.getPlayMode(0, 0), play_mode["LOOPSYNC"])
 
+    # Arrangement tests
+    def test_ag00_arrangement_location(self):
+        libseq.setTempo(ctypes.c_double(120))
+        libseq.setBeatsPerBar(4)
+        libseq.clearArrangement()
+        libseq.addArrangementTimeSig(3, 3, 4)
+        libseq.addArrangementTempo(5, 0, ctypes.c_double(60))
+        libseq.enableArrangement(True)
+        self.assertTrue(libseq.isArrangementEnabled())
+        self.assertEqual(libseq.getArrangementEventCount(), 2)
+        sleep(0.1)  # Allow jack process to compile arrangement
+        rate = client.samplerate
+        self.assertEqual(libseq.transportGetLocation(2, 1, 0), 2 * rate)
+        self.assertEqual(libseq.transportGetLocation(4, 1, 0), 4 * rate + rate * 3 // 2)
+        self.assertEqual(libseq.transportGetLocation(6, 1, 0), 7 * rate + 3 * rate)
+        libseq.enableArrangement(False)
+        sleep(0.1)
+        self.assertEqual(libseq.transportGetLocation(6, 1, 0), 10 * rate)
+        libseq.clearArrangement()
+
+    def test_ag01_arrangement_events(self):
+        libseq.clearArrangement()
+        libseq.addArrangementLaunch(2, 0, 1, 3)
+        libseq.addArrangementScene(1, 0, 2)
+        libseq.addArrangementLaunch(2, 0, 1, 3)
+        self.assertEqual(libseq.getArrangementEventCount(), 2)
+        bar = ctypes.c_uint16()
+        tick = ctypes.c_uint32()
+        type = ctypes.c_uint8()
+        value = ctypes.c_uint32()
+        self.assertTrue(libseq.getArrangementEvent(0, ctypes.byref(bar), ctypes.byref(tick), ctypes.byref(type), ctypes.byref(value)))
+        self.assertEqual((bar.value, type.value, value.value), (1, 5, 2))
+        self.assertTrue(libseq.getArrangementEvent(1, ctypes.byref(bar), ctypes.byref(tick), ctypes.byref(type), ctypes.byref(value)))
+        self.assertEqual((bar.value, type.value, value.value), (2, 3, 0x103))
+        self.assertFalse(libseq.getArrangementEvent(2, ctypes.byref(bar), ctypes.byref(tick), ctypes.byref(type), ctypes.byref(value)))
+        libseq.removeArrangementEvent(2, 0, 3, 0x103)
+        self.assertEqual(libseq.getArrangementEventCount(), 1)
+        libseq.clearArrangement()
+
+    # Frame time tests
+    def test_ah00_frame_time_wrap(self):
+        libseq.getFrameTime.restype = ctypes.c_uint64
+        rate = client.samplerate
+        # Simulate 32-bit JACK frame time wrapping in 0.5s
+        libseq.setFrameTimeWrap(rate // 2)
+        sleep(0.1)
+        time1 = libseq.getFrameTime()
+        sleep(1)
+        time2 = libseq.getFrameTime()
+        self.assertTrue(0.9 * rate < time2 - time1 < 1.1 * rate)
+
+    def test_ah01_playback_across_wrap(self):
+        global last_rx
+        rate = client.samplerate
+        libseq.setTempo(ctypes.c_double(120))
+        libseq.selectPattern(997)
+        libseq.setBeatsInPattern(1)
+        libseq.setStepsPerBeat(4)
+        libseq.clear()
+        libseq.addNote(0, 0x40, 100, ctypes.c_float(1), ctypes.c_float(0))
+        libseq.setSequencesInBank(2, 1)
+        self.assertTrue(libseq.addPattern(2, 0, 0, 0, 997, True))
+        libseq.setChannel(2, 0, 0, 0)
+        libseq.setPlayMode(2, 0, play_mode["LOOP"])
+        # Simulate 32-bit JACK frame time wrapping 1s after start of playback
+        libseq.setFrameTimeWrap(rate)
+        libseq.setPlayState(2, 0, play_state["STARTING"])
+        # One note each beat (0.5s) should continue to play across wrap
+        notes = []
+        last_rx = bytes(0)
+        time1 = time.time()
+        while time.time() < time1 + 2.2:
+            if binascii.hexlify(last_rx).decode() == "904064":
+                notes.append(time.time())
+                last_rx = bytes(0)
+            sleep(0.001)
+        libseq.setPlayState(2, 0, play_state["STOPPED"])
+        self.assertTrue(len(notes) >= 4)
+        for i in range(1, len(notes)):
+            self.assertTrue(0.45 < notes[i] - notes[i - 1] < 0.55)
+
+    # MIDI effects tests
+    def test_ai00_midifx_params(self):
+        libseq.setSequencesInBank(2, 1)
+        self.assertEqual(libseq.getMidiFxParam(2, 0, 0, 0), 0)  # Enable
+        self.assertEqual(libseq.getMidiFxParam(2, 0, 0, 1), 0xFFF)  # Scale mask
+        libseq.setMidiFxParam(2, 0, 0, 12, 10)  # Arpeggiator octaves limited to 4
+        self.assertEqual(libseq.getMidiFxParam(2, 0, 0, 12), 4)
+        libseq.setMidiFxParam(2, 0, 0, 3, -7)  # Chord interval
+        libseq.save(bytes("/tmp/test_midifx.zynseq", "utf-8"))
+        self.assertTrue(libseq.load(bytes("/tmp/test_midifx.zynseq", "utf-8")))
+        self.assertEqual(libseq.getMidiFxParam(2, 0, 0, 12), 4)
+        self.assertEqual(libseq.getMidiFxParam(2, 0, 0, 3), -7)
+        self.assertEqual(libseq.getMidiFxParam(2, 0, 0, 0), 0)
+
+    def test_ai01_midifx_playback(self):
+        global last_rx
+        libseq.setTempo(ctypes.c_double(120))
+        libseq.selectPattern(996)
+        libseq.setBeatsInPattern(1)
+        libseq.setStepsPerBeat(4)
+        libseq.clear()
+        libseq.addNote(0, 0x42, 100, ctypes.c_float(1), ctypes.c_float(0))
+        libseq.setSequencesInBank(2, 1)
+        self.assertTrue(libseq.addPattern(2, 0, 0, 0, 996, True))
+        libseq.setChannel(2, 0, 0, 0)
+        libseq.setPlayMode(2, 0, play_mode["LOOP"])
+        libseq.setMidiFxParam(2, 0, 0, 1, 0xAB5)  # C major
+        libseq.setMidiFxParam(2, 0, 0, 7, 80)  # Velocity min
+        libseq.setMidiFxParam(2, 0, 0, 8, 80)  # Velocity max
+        libseq.setMidiFxParam(2, 0, 0, 0, 0x05)  # Scale and velocity stages
+        last_rx = bytes(0)
+        libseq.setPlayState(2, 0, play_state["STARTING"])
+        found = False
+        time1 = time.time()
+        while not found and time.time() < time1 + 1:
+            found = binascii.hexlify(last_rx).decode() == "904150"  # F (quantised from F#) at fixed velocity
+            sleep(0.001)
+        libseq.setPlayState(2, 0, play_state["STOPPED"])
+        self.assertTrue(found)
+        libseq.setMidiFxParam(2, 0, 0, 0, 0)
+
+    # Play notes at start of one beat pattern through MIDI effects, returning first beat of output as list of (clock, note on, note)
+    def play_midifx(self, notes, duration):
+        global midi_rec
+        libseq.selectPattern(997)
+        libseq.setBeatsInPattern(1)
+        libseq.setStepsPerBeat(4)
+        libseq.clear()
+        for note in notes:
+            libseq.addNote(0, note, 100, ctypes.c_float(duration), ctypes.c_float(0))
+        self.assertTrue(libseq.addPattern(4, 0, 0, 0, 997, True))
+        midi_rec = []
+        libseq.setPlayState(4, 0, play_state["STARTING"])
+        time1 = time.time()
+        while not [msg for frame, msg in midi_rec if msg[0] == 0x90] and time.time() < time1 + 2:
+            sleep(0.01)
+        sleep(0.45)
+        libseq.setPlayState(4, 0, play_state["STOPPED"])
+        sleep(0.1)
+        events = [(frame, msg[0] == 0x90 and msg[2] > 0, msg[1]) for frame, msg in midi_rec if msg[0] in (0x80, 0x90)]
+        midi_rec = None
+        self.assertTrue(events)
+        start = events[0][0]
+        frames_per_clock = client.samplerate * 60 / 120 / 24
+        result = []
+        for frame, on, note in events:
+            if frame - start >= 0.42 * client.samplerate:
+                break
+            clock = round((frame - start) / frames_per_clock)
+            # Note off is one frame before clock
+            self.assertLessEqual(abs(frame - start - clock * frames_per_clock), 2)
+            result.append((clock, on, note))
+        return result
+
+    def test_ai02_midifx_output(self):
+        libseq.setTempo(ctypes.c_double(120))
+        libseq.setSequencesInBank(4, 1)
+        libseq.setChannel(4, 0, 0, 0)
+        libseq.setPlayMode(4, 0, play_mode["LOOP"])
+        # Chord: major triad on each note, all on and off together
+        libseq.setMidiFxParam(4, 0, 0, 3, 4)
+        libseq.setMidiFxParam(4, 0, 0, 4, 7)
+        libseq.setMidiFxParam(4, 0, 0, 0, 0x02)
+        self.assertEqual(self.play_midifx([60], 3),
+                         [(0, True, 60), (0, True, 64), (0, True, 67), (18, False, 60), (18, False, 64), (18, False, 67)])
+        libseq.setMidiFxParam(4, 0, 0, 3, 0)
+        libseq.setMidiFxParam(4, 0, 0, 4, 0)
+        # Note repeat: held note retriggered every 3 clocks until released
+        libseq.setMidiFxParam(4, 0, 0, 9, 3)
+        libseq.setMidiFxParam(4, 0, 0, 0, 0x08)
+        self.assertEqual(self.play_midifx([60], 2),
+                         [(0, True, 60), (3, False, 60), (3, True, 60), (6, False, 60), (6, True, 60), (9, False, 60), (9, True, 60), (12, False, 60)])
+        libseq.setMidiFxParam(4, 0, 0, 9, 6)
+        # Arpeggiator: held chord played upwards every 6 clocks at 50% gate, input notes not sent
+        libseq.setMidiFxParam(4, 0, 0, 10, 0)  # Up
+        libseq.setMidiFxParam(4, 0, 0, 11, 6)
+        libseq.setMidiFxParam(4, 0, 0, 12, 1)
+        libseq.setMidiFxParam(4, 0, 0, 13, 50)
+        libseq.setMidiFxParam(4, 0, 0, 0, 0x10)
+        self.assertEqual(self.play_midifx([67, 60, 64], 3),
+                         [(0, True, 60), (3, False, 60), (6, True, 64), (9, False, 64), (12, True, 67), (15, False, 67)])
+        libseq.setMidiFxParam(4, 0, 0, 10, 1)  # Down
+        self.assertEqual([note for clock, on, note in self.play_midifx([67, 60, 64], 3) if on], [67, 64, 60])
+        libseq.setMidiFxParam(4, 0, 0, 10, 0)
+        libseq.setMidiFxParam(4, 0, 0, 0, 0)
+
+    def test_ai03_midifx_toggle(self):
+        global midi_rec
+        # Disabling note repeat whilst note held releases note and does not resume repeats when enabled again
+        libseq.setMidiFxParam(4, 0, 0, 9, 3)
+        libseq.setMidiFxParam(4, 0, 0, 0, 0x08)
+        libseq.selectPattern(997)
+        libseq.clear()
+        libseq.addNote(0, 60, 100, ctypes.c_float(3), ctypes.c_float(0))
+        midi_rec = []
+        libseq.setPlayState(4, 0, play_state["STARTING"])
+        time1 = time.time()
+        while not midi_rec and time.time() < time1 + 2:
+            sleep(0.01)
+        sleep(0.1)
+        toggle_index = len(midi_rec)
+        libseq.setMidiFxParam(4, 0, 0, 0, 0)
+        sleep(0.1)
+        libseq.setMidiFxParam(4, 0, 0, 0, 0x08)
+        sleep(0.15)
+        libseq.setPlayState(4, 0, play_state["STOPPED"])
+        sleep(0.1)
+        events = [(msg[0] == 0x90 and msg[2] > 0, msg[1]) for frame, msg in midi_rec if msg[0] in (0x80, 0x90)]
+        toggle_events = [(msg[0] == 0x90 and msg[2] > 0, msg[1]) for frame, msg in midi_rec[toggle_index:] if msg[0] in (0x80, 0x90)]
+        midi_rec = None
+        self.assertEqual(events[0], (True, 60))
+        self.assertEqual(toggle_events[0], (False, 60))
+        self.assertNotIn((True, 60), toggle_events)
+        libseq.setMidiFxParam(4, 0, 0, 0, 0)
+        libseq.setMidiFxParam(4, 0, 0, 9, 6)
+
+    # Parallel event generation tests
+    def test_aj00_parallel_generation(self):
+        global last_rx
+        self.assertEqual(libseq.getParallelWorkers(), 0)
+        self.assertEqual(libseq.getParallelThreshold(), 16)
+        libseq.setParallelWorkers(2)
+        self.assertEqual(libseq.getParallelWorkers(), 2)
+        libseq.setParallelThreshold(1)
+        last_rx = bytes(0)
+        libseq.setPlayState(2, 0, play_state["STARTING"])
+        found = False
+        time1 = time.time()
+        while not found and time.time() < time1 + 1:
+            found = binascii.hexlify(last_rx).decode() == "904264"
+            sleep(0.001)
+        libseq.setPlayState(2, 0, play_state["STOPPED"])
+        self.assertTrue(found)
+        libseq.setParallelThreshold(16)
+        libseq.setParallelWorkers(0)
+        self.assertEqual(libseq.getParallelWorkers(), 0)
+
+    # Replay of a capture compares every period's MIDI output bit-for-bit so replaying with the other generation mode proves events are identical
+    def replay_with_workers(self, filename, workers):
+        replay = subprocess.run([sys.executable, "-c",
+                                 "import ctypes; lib = ctypes.cdll.LoadLibrary('/zynthian/zynthian-ui/zynlibs/zynseq/build/libzynseq.so'); "
+                                 f"lib.setParallelWorkers({workers}); lib.setParallelThreshold(1); "
+                                 f"lib.replayCapture.restype = ctypes.c_int32; print(lib.getParallelWorkers(), lib.replayCapture(b'{filename}'))"],
+                                capture_output=True, text=True, timeout=60)
+        self.assertEqual(replay.stdout.strip(), f"{workers} -1", replay.stderr)
+
+    def test_aj01_parallel_matches_serial(self):
+        libseq.setTempo(ctypes.c_double(120))
+        libseq.setSequencesInBank(3, 4)
+        for seq in range(4):
+            libseq.selectPattern(980 + seq)
+            libseq.setBeatsInPattern(1)
+            libseq.setStepsPerBeat(4)
+            for step in range(0, 4, 1 + seq % 2):
+                # Sequences share step times so order of simultaneous events is checked
+                self.assertTrue(libseq.addNote(step, 60 + seq * 4 + step, 100 - seq, ctypes.c_float(0.5 + seq * 0.25), ctypes.c_float(0)))
+            self.assertTrue(libseq.addPattern(3, seq, 0, 0, 980 + seq, True))
+            libseq.setChannel(3, seq, 0, seq)
+            libseq.setGroup(3, seq, 10 + seq)
+            libseq.setPlayMode(3, seq, play_mode["LOOP"])
+        libseq.setMidiFxParam(3, 1, 0, 0, 0x10)  # Arpeggiator on one sequence
+        for workers, replay_workers in ((0, 3), (3, 0)):
+            libseq.setParallelWorkers(workers)
+            libseq.setParallelThreshold(1)
+            sleep(0.5)  # Allow transport to stop
+            self.assertTrue(libseq.startCapture(bytes("/tmp/test_parallel.zcap", "utf-8")))
+            for seq in range(4):
+                libseq.setPlayState(3, seq, play_state["STARTING"])
+            sleep(1.2)
+            self.assertEqual(libseq.getPlayingSequences(), 4)
+            for seq in range(4):
+                libseq.setPlayState(3, seq, play_state["STOPPED"])
+            sleep(0.2)
+            libseq.stopCapture()
+            self.replay_with_workers("/tmp/test_parallel.zcap", replay_workers)
+        libseq.setParallelThreshold(16)
+        libseq.setParallelWorkers(0)
+        libseq.setSequencesInBank(3, 1)
+
+    # Controller feedback tests
+    def test_ak00_feedback(self):
+        self.assertTrue(libseq.setFeedbackPad(0, 2, 0, 0x90, 0x51))
+        self.assertFalse(libseq.setFeedbackPad(256, 2, 0, 0x90, 0x51))
+        self.assertFalse(libseq.setFeedbackPad(1, 2, 0, 0x40, 0x51))
+        self.assertTrue(libseq.setFeedbackState(play_state["STOPPED"], 1, 1, 0))
+        self.assertTrue(libseq.setFeedbackState(play_state["STARTING"], 5, 0, 12))
+        self.assertTrue(libseq.setFeedbackState(6, 0, 0, 0))
+        self.assertFalse(libseq.setFeedbackState(7, 0, 0, 0))
+        libseq.setFeedbackRate(500)
+        self.assertEqual(libseq.getFeedbackRate(), 500)
+        libseq.setFeedbackRate(1000)
+        libseq.clearFeedbackPads()
+
+    def test_ak01_feedback_output(self):
+        global feedback_rec
+        libseq.setTempo(ctypes.c_double(120))
+        libseq.setSequencesInBank(3, 2)
+        libseq.selectPattern(990)
+        libseq.setBeatsInPattern(4)
+        libseq.addNote(0, 60, 100, ctypes.c_float(1.0), ctypes.c_float(0.0))
+        self.assertTrue(libseq.addPattern(3, 0, 0, 0, 990, True))
+        for state in range(7):
+            libseq.setFeedbackState(state, 0, 0, 0)
+        libseq.setFeedbackState(play_state["STOPPED"], 1, 1, 0)
+        libseq.setFeedbackState(6, 2, 2, 0)  # Empty
+        libseq.setFeedbackState(play_state["STARTING"], 5, 5, 0)
+        libseq.setFeedbackState(play_state["PLAYING"], 5, 0, 12)  # Blink each half beat
+        libseq.setFeedbackState(play_state["STOPPING"], 3, 3, 0)
+        feedback_rec = []
+        # Each pad is sent its state's colour once
+        self.assertTrue(libseq.setFeedbackPad(0, 3, 0, 0x90, 0x51))
+        self.assertTrue(libseq.setFeedbackPad(1, 3, 1, 0x91, 0x52))
+        sleep(0.3)
+        self.assertEqual(sorted(msg for frame, msg in feedback_rec), [bytes([0x90, 0x51, 1]), bytes([0x91, 0x52, 2])])
+        # Playing pad blinks at blink rate without repeating unchanged values
+        feedback_rec = []
+        libseq.setPlayState(3, 0, play_state["STARTING"])
+        sleep(1.2)
+        libseq.setPlayState(3, 0, play_state["STOPPED"])
+        sleep(0.1)
+        pad0 = [(frame, msg[2]) for frame, msg in feedback_rec if msg[:2] == bytes([0x90, 0x51])]
+        self.assertFalse([msg for frame, msg in feedback_rec if msg[:2] != bytes([0x90, 0x51])])
+        values = [value for frame, value in pad0]
+        for i in range(1, len(values)):
+            self.assertNotEqual(values[i], values[i - 1])
+        self.assertEqual(values[-1], 1)
+        toggles = [frame for i, (frame, value) in enumerate(pad0) if i and {value, pad0[i - 1][1]} == {0, 5}]
+        self.assertGreaterEqual(len(toggles), 3)
+        half_beat = client.samplerate * 0.25
+        for i in range(1, len(toggles)):
+            self.assertAlmostEqual(toggles[i] - toggles[i - 1], half_beat, delta=client.blocksize + 1)
+        # Messages are limited to feedback rate
+        libseq.setFeedbackRate(50)
+        feedback_rec = []
+        for pad in range(2, 202):
+            libseq.setFeedbackPad(pad, 3, 1, 0x92 + (pad >> 7), pad & 0x7F)
+        start = client.frame_time
+        sleep(1.0)
+        sent = [msg for frame, msg in feedback_rec if frame < start + client.samplerate]
+        self.assertGreater(len(sent), 30)
+        self.assertLessEqual(len(sent), 55)
+        self.assertEqual(len(set(sent)), len(sent))
+        libseq.setFeedbackRate(1000)
+        libseq.clearFeedbackPads()
+        feedback_rec = None
+
+    # SysEx step event tests
+    def test_al00_sysex(self):
+        global last_rx
+        sysex = bytes([0xF0, 0x7F, 0x7F, 0x06, 0x02, 0xF7])  # MMC play
+        buffer = (ctypes.c_uint8 * len(sysex))(*sysex)
+        libseq.selectPattern(996)
+        self.assertFalse(libseq.addSysex(0, buffer, 5))  # Missing 0xF7
+        self.assertTrue(libseq.addSysex(1, buffer, len(sysex)))
+        self.assertEqual(libseq.getSysex(1, None, 0), len(sysex))
+        rx_buffer = (ctypes.c_uint8 * len(sysex))()
+        libseq.getSysex(1, rx_buffer, len(sysex))
+        self.assertEqual(bytes(rx_buffer), sysex)
+        libseq.save_pattern(996, bytes("/tmp/test_sysex.zynpat", "utf-8"))
+        self.assertTrue(libseq.load_pattern(995, bytes("/tmp/test_sysex.zynpat", "utf-8")))
+        libseq.selectPattern(995)
+        self.assertEqual(libseq.getSysex(1, None, 0), len(sysex))
+        libseq.selectPattern(996)
+        last_rx = bytes(0)
+        libseq.setPlayState(2, 0, play_state["STARTING"])
+        found = False
+        time1 = time.time()
+        while not found and time.time() < time1 + 1:
+            found = last_rx == sysex
+            sleep(0.001)
+        libseq.setPlayState(2, 0, play_state["STOPPED"])
+        self.assertTrue(found)
+        self.assertTrue(libseq.removeSysex(1))
+        self.assertEqual(libseq.getSysex(1, None, 0), 0)
+
+    # Capture and replay tests
+    def test_am00_capture(self):
+        libseq.replayCapture.restype = ctypes.c_int32
+        sleep(0.5)  # Allow transport to stop after previous test
+        self.assertTrue(libseq.startCapture(bytes("/tmp/test_capture.zcap", "utf-8")))
+        self.assertTrue(libseq.isCapturing())
+        self.assertFalse(libseq.startCapture(bytes("/tmp/test_capture.zcap", "utf-8")))
+        libseq.setPlayState(2, 0, play_state["STARTING"])
+        sleep(0.5)
+        libseq.setPlayState(2, 0, play_state["STOPPED"])
+        libseq.stopCapture()
+        self.assertFalse(libseq.isCapturing())
+        self.assertTrue(os.path.isfile("/tmp/test_capture.zcap"))
+        self.assertTrue(os.path.isfile("/tmp/test_capture.zcap.zynseq"))
+        # Replay must run in a process without a JACK client
+        self.assertEqual(libseq.replayCapture(bytes("/tmp/test_capture.zcap", "utf-8")), -2)
+        # Replay in a separate process must reproduce every captured period (-1)
+        replay = subprocess.run([sys.executable, "-c",
+                                 "import ctypes; lib = ctypes.cdll.LoadLibrary('/zynthian/zynthian-ui/zynlibs/zynseq/build/libzynseq.so'); "
+                                 "lib.replayCapture.restype = ctypes.c_int32; print(lib.replayCapture(b'/tmp/test_capture.zcap'))"],
+                                capture_output=True, text=True, timeout=60)
+        self.assertEqual(replay.stdout.strip(), "-1", replay.stderr)
+
+    def test_an00_midi_clock(self):
+        libseq.getMidiClockLatency.restype = ctypes.c_float
+        libseq.setMidiClockLatency.argtypes = [ctypes.c_float]
+        libseq.getMidiClockJitter.restype = ctypes.c_float
+        libseq.setMidiClockLatency(-5.0)
+        self.assertAlmostEqual(libseq.getMidiClockLatency(), -5.0, 3)
+        libseq.setMidiClockLatency(150.0)
+        self.assertAlmostEqual(libseq.getMidiClockLatency(), -5.0, 3)
+        libseq.setMidiClockRamp(200)
+        self.assertEqual(libseq.getMidiClockRamp(), 96)
+        libseq.setMidiClockRamp(24)
+        self.assertEqual(libseq.getMidiClockRamp(), 24)
+        libseq.setMidiClockLatency(0.0)
+        libseq.resetMidiClockJitter()
+        libseq.setMidiClockOutput(True)
+        libseq.setPlayState(2, 0, play_state["STARTING"])
+        sleep(0.5)
+        libseq.setPlayState(2, 0, play_state["STOPPED"])
+        libseq.setMidiClockOutput(False)
+        libseq.setMidiClockRamp(0)
+        # Pulses are sent at the frame nearest their ideal time (less than a frame at common sample rates)
+        self.assertLess(libseq.getMidiClockJitter(True), 25.0)
+
+    def test_an01_record_position(self):
+        global midi_rec
+        # MIDI input is recorded at its frame offset within the period, not the period or clock it arrives in
+        libseq.getNoteOffset.restype = ctypes.c_float
+        libseq.getNoteDuration.restype = ctypes.c_float
+        libseq.setTempo(ctypes.c_double(120))
+        libseq.selectPattern(995)
+        libseq.setBeatsInPattern(4)
+        libseq.setStepsPerBeat(4)
+        libseq.setQuantizeNotes(False)
+        libseq.addNote(0, 30, 100, ctypes.c_float(1), ctypes.c_float(0))
+        libseq.setPlayMode(0, 0, play_mode["LOOP"])
+        midi_rec = []
+        libseq.setPlayState(0, 0, play_state["STARTING"])
+        sleep(0.2)
+        self.assertEqual(libseq.getPlayState(0, 0), play_state["PLAYING"])
+        # Step 0 note is output at its exact frame. Loopback via zynseq adds one period in total, whichever client runs first.
+        ref = [frame for frame, msg in midi_rec if msg == bytes([0x90, 30, 100])]
+        midi_rec = None
+        self.assertTrue(ref)
+        step_zero = ref[0] - client.blocksize
+        step_frames = client.samplerate * 60 / 120 / 4
+        step = int((client.frame_time + 10 * client.blocksize - step_zero) // step_frames) + 1
+        start = step_zero + int((step + 0.4) * step_frames)
+        # Second note is 2.25 steps after first so lands at a different offset within its period
+        libseq.enableMidiRecord(True)
+        send_midi_at.extend([(start, (0x90, 60, 100)),
+                             (start + int(step_frames), (0x80, 60, 0)),
+                             (start + int(step_frames * 2.25), (0x90, 62, 100)),
+                             (start + int(step_frames * 3.75), (0x80, 62, 0))])
+        sleep(0.1 + (start + 4 * step_frames - client.frame_time) / client.samplerate)
+        libseq.enableMidiRecord(False)
+        libseq.setPlayState(0, 0, play_state["STOPPED"])
+        self.assertFalse(send_midi_at)
+        notes = {}
+        for index in range(16):
+            for note in (60, 62):
+                if libseq.getNoteVelocity(index, note):
+                    notes[note] = (index, libseq.getNoteOffset(index, note))
+        self.assertEqual(len(notes), 2)
+        self.assertEqual(notes[60][0], step % 16)
+        self.assertAlmostEqual(notes[60][1], 0.4, delta=0.01)
+        self.assertEqual(notes[62][0], (step + 2) % 16)
+        self.assertAlmostEqual(notes[62][1], 0.65, delta=0.01)
+        self.assertAlmostEqual(libseq.getNoteDuration(notes[60][0], 60), 1.0, delta=0.01)
+        self.assertAlmostEqual(libseq.getNoteDuration(notes[62][0], 62), 1.5, delta=0.01)
+
+    def test_ao00_monitor(self):
+        libseq.getMonitorRegion.restype = ctypes.c_void_p
+        self.assertTrue(libseq.getMonitorRegion())
+        monitor = zynseq.MonitorRegion.from_address(libseq.getMonitorRegion())
+        self.assertEqual(monitor.version, 1)
+        self.assertEqual(monitor.max_sequences, zynseq.MONITOR_SEQUENCES)
+        libseq.setPlayState(2, 0, play_state["STARTING"])
+        sleep(0.5)
+        mon = rtmonitor.read_seqlock(monitor)
+        self.assertIsNotNone(mon)
+        self.assertEqual(mon.seq & 1, 0)
+        self.assertEqual(mon.transport_state, libseq.transportGetPlayStatus())
+        self.assertGreaterEqual(mon.sequences, 1)
+        self.assertEqual((mon.sequence[0].bank, mon.sequence[0].sequence), (2, 0))
+        libseq.setPlayState(2, 0, play_state["STOPPED"])
+        sleep(0.1)
+        self.assertEqual(monitor.sequences, 0)
+        # Region is published to other processes under a name unique to this instance
+        libseq.getMonitorName.restype = ctypes.c_char_p
+        name = libseq.getMonitorName().decode("utf-8")
+        self.assertEqual(name, f"/zynseq.{os.getpid()}")
+        self.assertTrue(os.path.exists("/dev/shm" + name))
+
+    # Follow action tests
+    def test_ap00_follow_action(self):
+        libseq.setTempo(ctypes.c_double(120))
+        libseq.selectPattern(997)
+        libseq.setBeatsInPattern(1)
+        libseq.setSequencesInBank(2, 2)
+        self.assertTrue(libseq.addPattern(2, 0, 0, 0, 997, True))
+        self.assertTrue(libseq.addPattern(2, 1, 0, 0, 997, True))
+        libseq.setPlayMode(2, 0, play_mode["LOOP"])
+        libseq.setPlayMode(2, 1, play_mode["LOOP"])
+        libseq.setFollowAction(2, 0, zynseq.FOLLOW_START, 2, True)
+        self.assertTrue(libseq.addFollowTarget(2, 0, 2, 1, 1))
+        self.assertFalse(libseq.addFollowTarget(2, 0, 2, 1, 0))
+        self.assertEqual(libseq.getFollowTargets(2, 0), 1)
+        self.assertEqual(libseq.getFollowTarget(2, 0, 0), 0x0201)
+        self.assertEqual(libseq.getFollowTarget(2, 0, 1), 0xFFFF)
+        # Sequence 0 plays twice (1s) then sequence 1 starts
+        libseq.setPlayState(2, 0, play_state["STARTING"])
+        sleep(0.6)
+        self.assertEqual(libseq.getPlayState(2, 0), play_state["PLAYING"])
+        self.assertEqual(libseq.getPlayState(2, 1), play_state["STOPPED"])
+        sleep(1.4)
+        self.assertEqual(libseq.getPlayState(2, 0), play_state["STOPPED"])
+        self.assertEqual(libseq.getPlayState(2, 1), play_state["PLAYING"])
+        libseq.setPlayState(2, 1, play_state["STOPPED"])
+        libseq.clearFollowTargets(2, 0)
+        libseq.setFollowAction(2, 0, zynseq.FOLLOW_NONE, 1, True)
+
+    # Wait for a sequence to reach a play state, returning time taken or None on timeout
+    def wait_play_state(self, bank, seq, state, timeout):
+        start = time.monotonic()
+        while time.monotonic() - start < timeout:
+            if libseq.getPlayState(bank, seq) == state:
+                return time.monotonic() - start
+            sleep(0.005)
+        return None
+
+    # Create follow action test sequences in bank, each in its own group, playing patterns of one beat
+    def create_follow_bank(self, bank, patterns, group):
+        libseq.setSequencesInBank(bank, len(patterns))
+        for seq, pattern in enumerate(patterns):
+            libseq.selectPattern(pattern)
+            libseq.setBeatsInPattern(1)
+            self.assertTrue(libseq.addPattern(bank, seq, 0, 0, pattern, True))
+            libseq.setPlayMode(bank, seq, play_mode["LOOP"])
+            libseq.setGroup(bank, seq, group + seq)
+            libseq.clearFollowTargets(bank, seq)
+            libseq.setFollowAction(bank, seq, zynseq.FOLLOW_NONE, 1, True)
+
+    def test_ap01_follow_stop(self):
+        libseq.setTempo(ctypes.c_double(120))
+        self.create_follow_bank(5, (970, 970), 20)
+        # Sequence 0 stops sequence 1 at end of its first loop and continues playing
+        libseq.setFollowAction(5, 0, zynseq.FOLLOW_STOP, 1, False)
+        self.assertTrue(libseq.addFollowTarget(5, 0, 5, 1, 1))
+        libseq.setPlayState(5, 1, play_state["STARTING"])
+        libseq.setPlayState(5, 0, play_state["STARTING"])
+        self.assertIsNotNone(self.wait_play_state(5, 0, play_state["PLAYING"], 2.5))
+        self.assertEqual(libseq.getPlayState(5, 1), play_state["PLAYING"])
+        self.assertAlmostEqual(self.wait_play_state(5, 1, play_state["STOPPED"], 1.0), 0.5, delta=0.1)
+        self.assertEqual(libseq.getPlayState(5, 0), play_state["PLAYING"])
+        libseq.setPlayState(5, 0, play_state["STOPPED"])
+
+    def test_ap02_follow_loops(self):
+        libseq.setTempo(ctypes.c_double(120))
+        self.create_follow_bank(5, (970, 970), 20)
+        # Sequence 0 plays three loops (1.5s) then stops and starts sequence 1
+        libseq.setFollowAction(5, 0, zynseq.FOLLOW_START, 3, True)
+        self.assertEqual(libseq.getFollowLoops(5, 0), 3)
+        self.assertTrue(libseq.addFollowTarget(5, 0, 5, 1, 1))
+        libseq.setPlayState(5, 0, play_state["STARTING"])
+        self.assertIsNotNone(self.wait_play_state(5, 0, play_state["PLAYING"], 2.5))
+        self.assertAlmostEqual(self.wait_play_state(5, 1, play_state["PLAYING"], 2.5), 1.5, delta=0.1)
+        self.assertEqual(libseq.getPlayState(5, 0), play_state["STOPPED"])
+        libseq.setPlayState(5, 1, play_state["STOPPED"])
+
+    def test_ap03_follow_random(self):
+        libseq.setTempo(ctypes.c_double(480))
+        self.create_follow_bank(5, (970, 970, 970), 20)
+        # Sequence 0 randomly starts sequence 1 or 2 which each start sequence 0 again
+        libseq.setFollowAction(5, 0, zynseq.FOLLOW_RANDOM, 1, True)
+        self.assertTrue(libseq.addFollowTarget(5, 0, 5, 1, 1))
+        self.assertTrue(libseq.addFollowTarget(5, 0, 5, 2, 9))
+        self.assertEqual(libseq.getFollowTargetWeight(5, 0, 1), 9)
+        for seq in (1, 2):
+            libseq.setFollowAction(5, seq, zynseq.FOLLOW_START, 1, True)
+            self.assertTrue(libseq.addFollowTarget(5, seq, 5, 0, 1))
+        libseq.setPlayState(5, 0, play_state["STARTING"])
+        self.assertIsNotNone(self.wait_play_state(5, 0, play_state["PLAYING"], 1.0))
+        # Count launches of each target (each plays for 125ms)
+        launches = [0, 0, 0]
+        playing = [False, False, False]
+        start = time.monotonic()
+        while time.monotonic() - start < 5.0:
+            for seq in (1, 2):
+                state = libseq.getPlayState(5, seq) == play_state["PLAYING"]
+                if state and not playing[seq]:
+                    launches[seq] += 1
+                playing[seq] = state
+            sleep(0.005)
+        for seq in range(3):
+            libseq.setPlayState(5, seq, play_state["STOPPED"])
+        libseq.setTempo(ctypes.c_double(120))
+        self.assertGreaterEqual(launches[1] + launches[2], 15)
+        self.assertGreater(launches[2], launches[1])
+
+    def test_ap04_follow_scene(self):
+        libseq.setTempo(ctypes.c_double(120))
+        self.create_follow_bank(5, (970, 970), 20)
+        libseq.selectPattern(971)
+        libseq.setBeatsInPattern(1)
+        libseq.setStepsPerBeat(4)
+        self.assertTrue(libseq.addNote(0, 60, 100, ctypes.c_float(1), ctypes.c_float(0)))
+        # Scene bank has two sequences with notes and an empty sequence which is not started
+        self.create_follow_bank(6, (971, 970, 971), 40)
+        libseq.setFollowAction(5, 0, zynseq.FOLLOW_SCENE, 1, True)
+        self.assertTrue(libseq.addFollowTarget(5, 0, 6, 0, 1))
+        libseq.setPlayState(5, 0, play_state["STARTING"])
+        libseq.setPlayState(5, 1, play_state["STARTING"])
+        self.assertIsNotNone(self.wait_play_state(5, 0, play_state["PLAYING"], 2.5))
+        self.assertIsNotNone(self.wait_play_state(6, 0, play_state["PLAYING"], 1.0))
+        # Scene stops all other sequences
+        self.assertEqual(libseq.getPlayState(5, 0), play_state["STOPPED"])
+        self.assertEqual(libseq.getPlayState(5, 1), play_state["STOPPED"])
+        self.assertEqual(libseq.getPlayState(6, 1), play_state["STOPPED"])
+        self.assertEqual(libseq.getPlayState(6, 2), play_state["PLAYING"])
+        for seq in range(3):
+            libseq.setPlayState(6, seq, play_state["STOPPED"])
+        libseq.setSequencesInBank(6, 1)
+
+    def test_ap05_follow_remap(self):
+        self.create_follow_bank(5, (970, 970, 970), 20)
+        libseq.setFollowAction(5, 0, zynseq.FOLLOW_START, 1, True)
+        self.assertTrue(libseq.addFollowTarget(5, 0, 5, 1, 1))
+        self.assertTrue(libseq.addFollowTarget(5, 0, 5, 2, 1))
+        # Targets follow sequences when they are inserted, moved and removed
+        libseq.insertSequence(5, 1)
+        self.assertEqual(libseq.getFollowTarget(5, 0, 0), 0x0502)
+        self.assertEqual(libseq.getFollowTarget(5, 0, 1), 0x0503)
+        libseq.moveSequence(5, 3, 0)
+        self.assertEqual(libseq.getFollowTarget(5, 1, 0), 0x0503)
+        self.assertEqual(libseq.getFollowTarget(5, 1, 1), 0x0500)
+        libseq.removeSequence(5, 0)
+        self.assertEqual(libseq.getFollowTargets(5, 0), 1)
+        self.assertEqual(libseq.getFollowTarget(5, 0, 0), 0x0502)
+        libseq.clearFollowTargets(5, 0)
+        libseq.setFollowAction(5, 0, zynseq.FOLLOW_NONE, 1, True)
+        libseq.setSequencesInBank(5, 1)
+
+    def test_aq00_sync(self):
+        libseq.setSyncPulseWidth.argtypes = [ctypes.c_float]
+        libseq.getSyncPulseWidth.restype = ctypes.c_float
+        libseq.setSyncThreshold.argtypes = [ctypes.c_float]
+        libseq.getSyncThreshold.restype = ctypes.c_float
+        libseq.setSyncOutput(2)
+        self.assertEqual(libseq.getSyncOutput(), 2)
+        libseq.setSyncOutput(5)
+        self.assertEqual(libseq.getSyncOutput(), 2)
+        libseq.setSyncOutput(0)
+        self.assertEqual(libseq.getSyncOutput(), 0)
+        libseq.setSyncPulseWidth(10.0)
+        self.assertAlmostEqual(libseq.getSyncPulseWidth(), 10.0, 3)
+        libseq.setSyncPulseWidth(500.0)
+        self.assertAlmostEqual(libseq.getSyncPulseWidth(), 10.0, 3)
+        libseq.setSyncInput(4)
+        self.assertEqual(libseq.getSyncInput(), 4)
+        libseq.setSyncInput(0)
+        self.assertEqual(libseq.getSyncInput(), 4)
+        libseq.setSyncThreshold(0.5)
+        self.assertAlmostEqual(libseq.getSyncThreshold(), 0.5, 3)
+        libseq.setSyncThreshold(2.0)
+        self.assertAlmostEqual(libseq.getSyncThreshold(), 0.5, 3)
+        libseq.setSyncEdge(zynseq.SYNC_EDGE_FALLING)
+        self.assertEqual(libseq.getSyncEdge(), zynseq.SYNC_EDGE_FALLING)
+        libseq.setSyncEdge(2)
+        self.assertEqual(libseq.getSyncEdge(), zynseq.SYNC_EDGE_FALLING)
+        libseq.setSyncEdge(zynseq.SYNC_EDGE_RISING)
+        libseq.setSyncInput(2)
+        libseq.setSyncThreshold(0.2)
+        libseq.setSyncPulseWidth(5.0)
+
+    # Record zynseq sync output for duration (seconds), returning list of [start, width] of each complete pulse
+    def record_sync(self, duration):
+        global sync_rec
+        sync_rec = []
+        sleep(duration)
+        record = sync_rec
+        sync_rec = None
+        return get_sync_pulses(record)
+
+    # Assert pulses are evenly spaced with expected width, returning offset of first pulse from pulse train starting at start
+    def check_sync_pulses(self, pulses, start, interval, width):
+        self.assertGreaterEqual(len(pulses), 4)
+        offset = (pulses[0][0] - start) % interval
+        for n, (pulse, frames) in enumerate(pulses):
+            self.assertEqual(frames, width)
+            if n:
+                self.assertAlmostEqual(pulse - pulses[n - 1][0], interval, delta=1)
+            self.assertAlmostEqual((pulse - start - offset + interval // 2) % interval - interval // 2, 0, delta=1)
+        return offset
+
+    def test_aq01_sync_output(self):
+        rate = client.samplerate
+        libseq.setTempo(ctypes.c_double(120))
+        libseq.setClockSource(1)
+        libseq.setSyncOutput(4)
+        libseq.setSyncPulseWidth(ctypes.c_float(5.0))
+        self.create_follow_bank(5, (970,), 20)
+        libseq.setPlayState(5, 0, play_state["STARTING"])
+        self.assertIsNotNone(self.wait_play_state(5, 0, play_state["PLAYING"], 2.5))
+        # Pulse at each 6th clock (4 PPQN) at 120 BPM
+        pulses = self.record_sync(2.0)
+        libseq.setPlayState(5, 0, play_state["STOPPED"])
+        libseq.setSyncOutput(0)
+        self.assertGreaterEqual(len(pulses), 14)
+        self.check_sync_pulses(pulses, pulses[0][0], rate * 60 / 120 / 4, int(5.0 * rate / 1000))
+
+    def test_aq02_sync_input(self):
+        global sync_gen
+        rate = client.samplerate
+        interval = rate * 60 // 100 // 2  # 2 PPQN at 100 BPM
+        width = rate // 100  # 10ms input pulses
+        libseq.setTempo(ctypes.c_double(120))
+        libseq.setSyncInput(2)
+        libseq.setSyncThreshold(ctypes.c_float(0.5))
+        libseq.setSyncEdge(zynseq.SYNC_EDGE_RISING)
+        libseq.setSyncOutput(2)
+        libseq.setSyncPulseWidth(ctypes.c_float(5.0))
+        libseq.setClockSource(4)
+        start = client.frame_time + rate // 10
+        sync_gen = (start, interval, width)
+        # Tempo is recovered from each beat (2 edges) whilst transport is stopped
+        sleep(1.5)
+        self.assertAlmostEqual(libseq.getTempo(), 100.0, delta=0.01)
+        # Recovered clocks drive sync output at the same rate with fixed latency from input edges
+        self.create_follow_bank(5, (970,), 20)
+        libseq.setPlayState(5, 0, play_state["STARTING"])
+        libseq.transportStart(bytes("unittest", "utf-8"))
+        sleep(0.5)
+        rising = self.check_sync_pulses(self.record_sync(2.5), start, interval, int(5.0 * rate / 1000))
+        # Falling edge is detected at end of input pulse
+        libseq.setSyncEdge(zynseq.SYNC_EDGE_FALLING)
+        sleep(1.0)
+        falling = self.check_sync_pulses(self.record_sync(2.5), start, interval, int(5.0 * rate / 1000))
+        self.assertAlmostEqual((falling - rising) % interval, width, delta=1)
+        sync_gen = None
+        libseq.setPlayState(5, 0, play_state["STOPPED"])
+        libseq.transportStop(bytes("unittest", "utf-8"))
+        libseq.setClockSource(1)
+        libseq.setSyncOutput(0)
+        libseq.setSyncEdge(zynseq.SYNC_EDGE_RISING)
+        libseq.setSyncThreshold(ctypes.c_float(0.2))
+        libseq.setTempo(ctypes.c_double(120))
+
 
 '''
     # Sequence tests
@@ -23,8 +23,10 @@
  * ******************************************************************
  */
 
+#include <cmath>   // provides fmod
 #include <cstring> // provides strcmp
 #include <queue>
+#include <random> // provides random_device for capture seed
 #include <set>
 #include <string>
 #include <vector>
@@ -35,18 +37,58 @@
 #include <stdlib.h>        // provides exit
 #include <thread>          // provides thread for timer
 
+#include "analogclock.h"     // provides audio rate sync pulse generation and detection
+#include "arrangement.h"     // provides linear song timeline
+#include "capture.h"         // provides capture and replay of process inputs
+#include "midiclock.h"       // provides MIDI clock pulse generation
 #include "metronome.h"       // metronome wav data
+#include "midifx.h"          // provides per-track MIDI effects
 #include "pattern.h"         // provides pattern objects
+#include "rtlog.h"           // provides real-time safe logging from process thread
+#include "rtmonitor.h"       // provides shared memory monitor region
 #include "sequencemanager.h" // provides management of sequences, patterns, events, etc
 #include "timebase.h"        // provides timebase event map
 #include "zynseq.h"          // exposes library methods as c functions
 
-#define FILE_VERSION 10
+#define FILE_VERSION 13
+
+#define FEEDBACK_MAX_PADS 256                     // Maximum quantity of pads mapped to sequence state feedback
+#define FEEDBACK_STATE_EMPTY (LASTPLAYSTATUS + 1) // Feedback state of a stopped sequence that has no events
+#define FEEDBACK_STATES (LASTPLAYSTATUS + 2)      // Quantity of feedback states
+#define CAPTURE_CLOCK_QUEUE 8                     // Maximum quantity of pending clock positions recorded at start of capture
+#define CLOCK_HISTORY 32                          // Quantity of processed clocks retained to timestamp MIDI input (power of 2)
 
 #define DPRINTF(fmt, args...)                                                                                                                                  \
     if (g_bDebug)                                                                                                                                              \
     fprintf(stderr, fmt, ##args)
 
+// API functions that mutate sequencer state, recorded during capture and called during replay (append only - index is stored in capture log)
+#define CAPTURE_API_LIST(X) \
+    X(playNote) X(sendMidiStart) X(sendMidiStop) X(sendMidiContinue) X(sendMidiSongPos) X(sendMidiSong) X(sendMidiClock) X(sendMidiCommand) \
+    X(setMidiClockOutput) X(setTriggerDevice) X(setTriggerChannel) X(setTriggerNote) X(enableMidiRecord) X(createPattern) X(selectPattern) \
+    X(setBeatsInPattern) X(setStepsPerBeat) X(setSwingDiv) X(setSwingAmount) X(setHumanTime) X(setHumanVelo) X(setPlayChance) X(addNote) \
+    X(removeNote) X(setNoteVelocity) X(setNoteOffset) X(setStutterCount) X(setStutterDur) X(setNotePlayChance) X(addProgramChange) \
+    X(removeProgramChange) X(removeSysex) X(transpose) X(changeVelocityAll) X(changeDurationAll) X(changeStutterCountAll) X(changeStutterDurAll) \
+    X(clear) X(copyPattern) X(setInputRest) X(setScale) X(setTonic) X(setRefNote) X(setQuantizeNotes) X(addPattern) X(removePattern) \
+    X(cleanPatterns) X(toggleMute) X(setTrackType) X(setChainID) X(setChannel) X(setMidiFxParam) X(setPlayMode) X(setPlayState) X(togglePlayState) \
+    X(stop) X(setPlayPosition) X(clearSequence) X(setGroup) X(addTrackToSequence) X(removeTrackFromSequence) X(addTempoEvent) X(addTimeSigEvent) \
+    X(setSequence) X(setSequencesInBank) X(insertSequence) X(removeSequence) X(moveSequence) X(clearBank) X(setTransportToStartOfBar) X(solo) \
+    X(enableArrangement) X(clearArrangement) X(addArrangementLaunch) X(addArrangementStop) X(addArrangementScene) X(addArrangementTempo) \
+    X(addArrangementTimeSig) X(removeArrangementEvent) X(transportLocate) X(transportStart) X(transportStop) X(transportToggle) X(setTempo) \
+    X(setBeatsPerBar) X(enableMetronome) X(setMetronomeVolume) X(setClockSource) X(setFeedbackPad) X(clearFeedbackPads) X(setFeedbackState) \
+    X(refreshFeedback) X(setFeedbackRate) X(setMidiClockLatency) X(setMidiClockRamp) \
+    X(setFollowAction) X(addFollowTarget) X(clearFollowTargets) X(setSyncOutput) X(setSyncPulseWidth) X(setSyncInput) X(setSyncThreshold) \
+    X(setSyncEdge) X(load) X(addSysex) X(setParallelThreshold)
+
+enum CAPTURE_API_ID {
+#define CAPTURE_API_ENUM(fn) API_##fn,
+    CAPTURE_API_LIST(CAPTURE_API_ENUM)
+#undef CAPTURE_API_ENUM
+};
+
+// Record call of API function during capture - place at start of function
+#define CAPTURE_API(fn, args...) CaptureApiScope captureScope(API_##fn, ##args)
+
 struct ev_start {
     uint32_t start;
     uint8_t velocity;
@@ -57,6 +99,9 @@ static struct ev_start startEvents[128];
 jack_port_t* g_pInputPort;            // Pointer to the JACK input port
 jack_port_t* g_pOutputPort;           // Pointer to the JACK output port
 jack_port_t* g_pMetronomePort;        // Pointer to the JACK metronome audio output port
+jack_port_t* g_pFeedbackPort;         // Pointer to the JACK controller feedback output port
+jack_port_t* g_pSyncOutputPort;       // Pointer to the JACK analog sync pulse audio output port
+jack_port_t* g_pSyncInputPort;        // Pointer to the JACK analog sync pulse audio input port
 jack_client_t* g_pJackClient = NULL;  // Pointer to the JACK client
 jack_nframes_t g_nSampleRate = 44100; // Quantity of samples per second
 uint32_t g_nXruns            = 0;
@@ -64,7 +109,7 @@ uint32_t g_nXruns            = 0;
 SequenceManager g_seqMan;                           // Instance of sequence manager
 uint32_t g_nPattern   = 0;                          // Index of currently edited pattern
 Sequence* g_pSequence = NULL;                       // Pattern editor sequence
-std::multimap<uint32_t, MIDI_MESSAGE*> g_mSchedule; // Schedule of MIDI events (queue for sending), indexed by scheduled play time (samples since JACK epoch)
+std::multimap<uint64_t, MIDI_MESSAGE*> g_mSchedule; // Schedule of MIDI events (queue for sending), indexed by scheduled play time (64-bit frame time)
 bool g_bMutex              = false;                 // Mutex lock for access to g_mSchedule
 bool g_bDebug              = false;                 // True to output debug info
 bool g_bPatternModified    = false;                 // True if pattern has changed since last check
@@ -94,14 +139,31 @@ uint32_t g_nBeat                      = 1;         // Current beat within bar
 uint32_t g_nTick                      = 0;         // Current tick within bar
 double g_dBarStartTick                = 0;         // Quantity of ticks from start of song to start of current bar
 jack_nframes_t g_nTransportStartFrame = 0;         // Quantity of frames from JACK epoch to transport start
-std::queue<std::pair<double, double>> g_qClockPos; // Queue of pending clock positions relative to JACK epoch and clock duration in frames at this time
+uint64_t g_nFrameTime                 = 0;         // Monotonic frame time at start of current period, extended from 32-bit JACK frame time
+jack_nframes_t g_nPeriodFrames        = 0;         // Quantity of frames in current period
+jack_nframes_t g_nLastJackFrameTime   = 0;         // JACK frame time at start of current period (used to extend frame time)
+jack_nframes_t g_nFrameTimeOffset     = 0;         // Offset added to JACK frame time to simulate wrap during test
+jack_nframes_t g_nNewFrameTimeOffset  = 0;         // Requested offset added to JACK frame time, applied at start of next period
+std::queue<std::pair<double, double>> g_qClockPos; // Queue of pending clock positions (64-bit frame time) and clock duration in frames at this time
 double g_dFramesPerClock =
     getFramesPerClock(g_dTempo);           //!@todo Change to integer will have 0.1% jitter at 1920 PPQN and much better jitter (0.01%) at current 24PPQN
 uint8_t g_nClock                      = 0; // Quantity of MIDI clocks since start of beat
 uint8_t g_nMidiClock                  = 0; // Quantity of *RECEIVED* MIDI clocks since start of beat
 uint8_t g_nClockSource                = TRANSPORT_CLOCK_INTERNAL; // Source of clock that progresses playback
 bool g_bSendMidiClock                 = false;                    // True to send MIDI clock
+MidiClock g_midiClock;                                            // Clock pulse generator (internal clock source and MIDI clock output)
+float g_fMidiClockLatency             = 0.0;                      // MIDI clock output latency offset in milliseconds
+AnalogClock g_analogClock;                                        // Sync pulse generator and detector (analog clock source and sync output)
+float g_fSyncPulseWidth               = 5.0;                      // Sync output pulse width in milliseconds
 jack_nframes_t g_nFramesSinceLastBeat = 0;                        // Quantity of frames since last beat
+uint64_t g_nLastBeatFrame             = 0;                        // Frame time of last quarter note used to calc tempo of external clock
+Arrangement g_arrangement;                                        // Linear song timeline (arrangement mode)
+uint32_t g_nSongClock = 0;                                        // Quantity of clock cycles from start of song to next clock
+std::pair<double, double> g_aClockHistory[CLOCK_HISTORY];         // Ring of processed clock positions (frame time) and durations (frames)
+uint32_t g_nClockCount   = 0;                                     // Quantity of clocks processed (index of next entry in g_aClockHistory)
+uint32_t g_nClockHistory = 0;                                     // Quantity of valid entries in g_aClockHistory
+MONITOR_REGION* g_pMonitor = NULL;                                // Monitor feed of transport and playhead state
+RTMONITOR g_monitorShm;                                           // Shared memory containing monitor region
 
 float g_fSwingAmount                  = 0.0; // Swing amount, range from 0 to 1, but values over 0.5 are not "MPC swing"
 float g_fHumanTime                    = 0.0; // Timing Humanization, range from 0 to FLOAT_MAX
@@ -115,12 +177,36 @@ struct metro_wav_t g_metro_pip;
 struct metro_wav_t g_metro_peep;
 struct metro_wav_t* g_pMetro = &g_metro_pip; // Pointer to the current metronome sound (pip/peep)
 
+// Controller pad mapped to feedback of a sequence's state
+struct FEEDBACK_PAD {
+    uint8_t bank     = 0;    // Index of bank containing sequence
+    uint8_t sequence = 0;    // Index of sequence within bank
+    uint8_t status   = 0;    // MIDI status byte of feedback message (0 if pad not mapped)
+    uint8_t note     = 0;    // MIDI note or controller number of feedback message
+    uint8_t value    = 0xFF; // Last value sent or 0xFF to force send
+};
+
+// Value (colour) sent to pads for a sequence state
+struct FEEDBACK_STATE {
+    uint8_t colour      = 0; // Value sent to pad
+    uint8_t blinkColour = 0; // Value sent to pad during alternate blink phase
+    uint8_t blinkRate   = 0; // Clock cycles in each blink phase, synchronised to bar (0 for no blink)
+};
+
+FEEDBACK_PAD g_aFeedbackPads[FEEDBACK_MAX_PADS];    // Pads mapped to sequence feedback
+FEEDBACK_STATE g_aFeedbackStates[FEEDBACK_STATES]; // Feedback value for each sequence state
+uint16_t g_nFeedbackPads = 0;                      // Quantity of pads in feedback map (highest mapped pad + 1)
+uint16_t g_nFeedbackNext = 0;                      // Index of pad to check first in next period (round robin when rate limited)
+uint16_t g_nFeedbackRate = 1000;                   // Maximum quantity of feedback messages per second
+double g_dFeedbackCredit = 0.0;                    // Quantity of feedback messages that may be sent (rate limiter)
+
 // ** Internal (non-public) functions  (not delcared in header so need to be in correct order in source file) **
 
 // Enable / disable debug output
 void enableDebug(bool bEnable) {
     fprintf(stderr, "libseq setting debug mode %s\n", bEnable ? "on" : "off");
     g_bDebug = bEnable;
+    rtlogEnable(bEnable);
 }
 
 // Convert tempo to frames per tick
@@ -132,77 +218,55 @@ double getFramesPerTick(double dTempo) {
 // Convert tempo to frames per clock
 double getFramesPerClock(double dTempo) { return getFramesPerTick(dTempo) * g_dTicksPerClock; }
 
+// Get exclusive access to schedule and arrangement
+void getMutex() {
+    while (g_bMutex)
+        std::this_thread::sleep_for(std::chrono::microseconds(10));
+    g_bMutex = true;
+}
+
+// Release exclusive access to schedule and arrangement
+void releaseMutex() { g_bMutex = false; }
+
+/*  Extend 32-bit JACK frame time to monotonic 64-bit frame time - call once at start of each period
+    JACK frame time wraps after 2^32 frames (about 24.8 hours at 48kHz). Unsigned difference between consecutive periods is wrap-safe so accumulate
+    this into 64-bit frame time that will not wrap during lifetime of installation. All scheduling uses 64-bit frame time which is converted to
+    offset within JACK period when events are sent.
+*/
+uint64_t updateFrameTime() {
+    if (g_nNewFrameTimeOffset != g_nFrameTimeOffset) {
+        // Adjust reference so that 64-bit frame time remains continuous when offset changes
+        g_nLastJackFrameTime += g_nNewFrameTimeOffset - g_nFrameTimeOffset;
+        g_nFrameTimeOffset = g_nNewFrameTimeOffset;
+    }
+    jack_nframes_t nJackFrameTime = ioLastFrameTime() + g_nFrameTimeOffset;
+    g_nFrameTime += jack_nframes_t(nJackFrameTime - g_nLastJackFrameTime);
+    g_nLastJackFrameTime = nJackFrameTime;
+    return g_nFrameTime;
+}
+
+// Rebuild arrangement segment table if events, tempo or time signature have changed - call from jack process thread with mutex held
+void compileArrangement() {
+    if (g_arrangement.isDirty())
+        g_arrangement.compile(g_nSampleRate, g_dTicksPerBeat, g_dTempo, g_nBeatsPerBar, g_fBeatType);
+}
+
 // Update bars, beats, ticks for given position in frames
 void updateBBT(jack_position_t* position) {
     //!@todo Populate bbt_sequence (experimental so not urgent but could be useful)
-    double dFrames                    = 0;
-    double dFramesPerTick             = getFramesPerTick(g_dTempo); //!@todo Need to use default tempo from start of song but current tempo now!!!
-    static double dDebugFramesPerTick = 0;
-    uint32_t nBar                     = 0;
-    uint32_t nBeat                    = 0;
-    uint32_t nTick                    = 0;
-    uint8_t nBeatsPerBar              = 4;
-    uint32_t nTicksPerBar             = g_dTicksPerBeat * nBeatsPerBar;
-    bool bDone                        = false;
-    double dFramesInSection;
-    uint32_t nTicksInSection;
-    uint32_t nTicksFromStart   = 0;
-
-    position->tick             = position->frame % uint32_t(dFramesPerTick);
-    position->beat             = (uint32_t(position->frame / dFramesPerTick) % uint32_t(g_dTicksPerBeat)) + 1;
-    position->bar              = (uint32_t(position->frame / dFramesPerTick / g_dTicksPerBeat) % nBeatsPerBar) + 1;
-    position->beats_per_bar    = float(g_nBeatsPerBar);
-    position->beats_per_minute = g_dTempo;
-    position->beat_type        = g_fBeatType;
-    position->ticks_per_beat   = g_dTicksPerBeat;
-    position->bar_start_tick   = 0; //!@todo Need to calculate this
-    // g_pNextTimebaseEvent = g_pTimebase->getPreviousTimebaseEvent(position->bar, (position->beat - 1) * position->ticks_per_beat + position->tick  ,
-    // TIMEBASE_TYPE_ANY);
-
-    // Iterate through events, calculating quantity of frames between each event
-    /*
-    if(g_pTimebase)
-    {
-        for(size_t nIndex = 0; nIndex < g_pTimebase->getEventQuant(); ++nIndex)
-        {
-            // Get next event
-            TimebaseEvent* pEvent = g_pTimebase->getEvent(nIndex);
-            // Calculate quantity of ticks between events and frames between events
-            nTicksInSection = (pEvent->bar * nTicksPerBar + pEvent->clock * g_dFramesPerClock - nTicksFromStart);
-            dFramesInSection = nTicksInSection * dFramesPerTick;
-            // Break if next event is beyond requested position
-            if(dFrames + dFramesInSection > position->frame)
-                break;
-            // Update frame counter, bar and tick from which to count last section
-            dFrames += dFramesInSection;
-            nBar = pEvent->bar;
-            nTick = pEvent->clock * g_dTicksPerClock;
-            nTicksFromStart += nTicksInSection;
-            // Update tempo and time signature from event
-            if(pEvent->type == TIMEBASE_TYPE_TEMPO)
-                dFramesPerTick = getFramesPerTick(pEvent->value);
-            else if(pEvent->type == TIMEBASE_TYPE_TIMESIG)
-            {
-                nBeatsPerBar = pEvent->value >> 8;
-                nBeatsType = pEvent->value & 0x00FF;
-                nTicksPerBar = g_dTicksPerBeat * nBeatsPerBar;
-            }
-        }
-    }
-    */
-    // Calculate BBT from last section
-    dFramesInSection           = position->frame - dFrames;
-    nTicksInSection            = dFramesInSection / dFramesPerTick;
-    uint32_t nBarsInSection    = nTicksInSection / nTicksPerBar;
-    position->bar              = nBar + nBarsInSection + 1;
-    uint32_t nTicksInLastBar   = nTicksInSection % nTicksPerBar;
-    position->beat             = nTicksInLastBar / g_dTicksPerBeat + 1;
-    position->tick             = nTicksInLastBar % position->beat;
-    nTicksFromStart += nTicksInSection;
-    position->bar_start_tick = nTicksFromStart - nTicksInLastBar;
-    g_nClock                 = position->tick % (uint32_t)g_dTicksPerClock;
-    // g_dTempo = g_pTimebase->getTempo(g_nBar, (g_nBeat * g_dTicksPerBeat + g_nTick) / g_dTicksPerClock);
-    // g_nBeatsPerBar = uint32_t(g_pTimebase->getTimeSig(g_nBar, (g_nBeat * g_dTicksPerBeat + g_nTick) / g_dTicksPerClock)) >> 8;
+    getMutex(); // Arrangement tables may be reallocated by API
+    g_arrangement.getBBT(position);
+    releaseMutex();
+    g_nClock = position->tick / g_dTicksPerClock;
+}
+
+// Get song position in frames from one-based bar and beat - call with mutex held
+jack_nframes_t getLocationFrame(uint32_t bar, uint32_t beat, uint32_t tick) {
+    if (bar > 0)
+        --bar;
+    if (beat > 0)
+        --beat;
+    return g_arrangement.getFrame(bar, beat, tick);
 }
 
 /*  Handle timebase callback - update timebase elements (BBT) from transport position
@@ -218,79 +282,65 @@ void updateBBT(jack_position_t* position) {
 
     [Process]
     Calculate bars, beats, ticks at pPosition->frame from start of song or calculate frame from BBT:
-    Iterate through timebase events spliting song into sections delimited by timebase events: time signature / tempo changes, calculating BBT for each section
-   up to current position. Add events from sequences to schedule
+    Binary search the arrangement segment table (sections delimited by time signature / tempo changes) for the section containing the position.
+    On relocate, set sequences to the state and position they would have reached when playing the arrangement from the start.
 */
 void onJackTimebase(jack_transport_state_t nState, jack_nframes_t nFramesInPeriod, jack_position_t* pPosition, int bUpdate, void* pArgs) {
-    // Process timebase events
-    /* Disabled timebase events until linear song implemented
-    while(g_pTimebase && g_pNextTimebaseEvent && (g_pNextTimebaseEvent->bar <= g_nBar)) // || g_pNextTimebaseEvent->bar == g_nBar && g_pNextTimebaseEvent->clock
-    <= g_nClock))
-    {
-        if(g_pNextTimebaseEvent->type == TIMEBASE_TYPE_TEMPO)
-        {
-            g_dTempo = g_pNextTimebaseEvent->value;
-            g_dFramesPerClock = getFramesPerClock(g_dTempo);
-            pPosition->beats_per_minute = g_dTempo;
-            g_bTimebaseChanged = true;
-            DPRINTF("Tempo change to %0.0fbpm frames/clk: %f\n", g_dTempo, g_dFramesPerClock);
-        }
-        else if(g_pNextTimebaseEvent->type == TIMEBASE_TYPE_TIMESIG)
-        {
-            g_nBeatsPerBar = g_pNextTimebaseEvent->value >> 8;
-            g_fBeatType = g_pNextTimebaseEvent->value & 0x0F;
-            pPosition->beats_per_bar = float(g_nBeatsPerBar);
-            g_bTimebaseChanged = true;
-            DPRINTF("Time signature change to %u/%0.0f\n", g_nBeatsPerBar, g_fBeatType);
-        }
-        g_pNextTimebaseEvent = g_pTimebase->getNextTimebaseEvent(g_pNextTimebaseEvent);
-    }
-    */
-
-    // Calculate BBT at start of next period if transport starting, locating or change in tempo or timebase (although latter is commented out)
-    if (bUpdate || g_bTimebaseChanged) {
-        /*
-        if(g_pTimebase)
-        {
-            g_dTempo = g_pTimebase->getTempo(g_nBar, (g_nBeat * g_dTicksPerBeat + g_nTick));
-            g_nBeatsPerBar = g_pTimebase->getTimeSig(g_nBar, (g_nBeat * g_dTicksPerBeat + g_nTick)) >> 8;
-        }
-        */
-        // Update position based on parameters passed
-        if (pPosition->valid & JackPositionBBT) {
+    ioBeginTimebase(nState, nFramesInPeriod, pPosition, bUpdate);
+    // Hold mutex whilst reading arrangement tables which API may reallocate
+    getMutex();
+    compileArrangement();
+
+    // Calculate BBT at start of next period if transport starting, locating or change in timebase. Arrangement may change tempo anywhere so always calculate.
+    if (bUpdate || g_bTimebaseChanged || g_arrangement.isEnabled()) {
+        if (bUpdate && (pPosition->valid & JackPositionBBT)) {
             // Set position from BBT
-            DPRINTF("bUpdate: %s, g_bTimebaseChanged: %s, Position valid flags: %u\n", bUpdate ? "True" : "False", g_bTimebaseChanged ? "True" : "False",
-                    pPosition->valid);
-            DPRINTF("PreSet position from BBT Bar: %u Beat: %u Tick: %u Clock: %u\n", pPosition->bar, pPosition->beat, pPosition->tick, g_nClock);
-            DPRINTF("Beats per bar: %f Tempo: %f\n", pPosition->beats_per_bar, g_dTempo);
+            RTLOG("bUpdate: %s, g_bTimebaseChanged: %s, Position valid flags: %u\n", bUpdate ? "True" : "False", g_bTimebaseChanged ? "True" : "False",
+                  pPosition->valid);
+            RTLOG("PreSet position from BBT Bar: %u Beat: %u Tick: %u Clock: %u\n", pPosition->bar, pPosition->beat, pPosition->tick, g_nClock);
             // Fix overruns
             pPosition->beat += pPosition->tick / (uint32_t)pPosition->ticks_per_beat;
             pPosition->tick %= (uint32_t)(pPosition->ticks_per_beat);
             pPosition->bar += (pPosition->beat - 1) / pPosition->beats_per_bar;
-            pPosition->beat             = ((pPosition->beat - 1) % (uint32_t)(pPosition->beats_per_bar)) + 1;
-            pPosition->frame            = transportGetLocation(pPosition->bar, pPosition->beat, pPosition->tick);
-            pPosition->ticks_per_beat   = g_dTicksPerBeat;
-            pPosition->beats_per_minute = g_dTempo; //!@todo Need to set tempo from position pointer to allow external clients to set tempo
-            g_nClock                    = pPosition->tick / g_dTicksPerClock;
-            g_nBar                      = pPosition->bar;
-            g_nBeat                     = pPosition->beat;
-            g_nTick                     = pPosition->tick;
-            DPRINTF("Set position from BBT Bar: %u Beat: %u Tick: %u Clock: %u\n", pPosition->bar, pPosition->beat, pPosition->tick, g_nClock);
-        } else // if(!bUpdate) //!@todo I have masked bUpdate because I don't see why we would be reaching here but we do and need to figure out why
-        {
-            updateBBT(pPosition);
-            DPRINTF("Set position from frame %u\n", pPosition->frame);
+            pPosition->beat  = ((pPosition->beat - 1) % (uint32_t)(pPosition->beats_per_bar)) + 1;
+            pPosition->frame = getLocationFrame(pPosition->bar, pPosition->beat, pPosition->tick);
+        }
+        double dSongTick = g_arrangement.getBBT(pPosition);
+        g_nTick          = pPosition->tick;
+
+        if (bUpdate || g_bTimebaseChanged) {
+            // Clocks are aligned to start of song so next clock may be after this position
+            g_nSongClock                 = uint32_t(dSongTick / g_dTicksPerClock);
+            if (g_nSongClock * g_dTicksPerClock < dSongTick)
+                ++g_nSongClock;
+            g_nClockHistory              = 0; // Discontinuity so previous clocks no longer map to play position
+            double dClockTick            = g_nSongClock * g_dTicksPerClock;
+            ArrangementSegment* pSegment = g_arrangement.getSegmentAtTick(dClockTick);
+            jack_position_t clockPosition;
+            g_arrangement.getBBTAtTick(dClockTick, &clockPosition);
+            g_nBar                 = clockPosition.bar;
+            g_nBeat                = clockPosition.beat;
+            g_nClock               = clockPosition.tick / g_dTicksPerClock;
+            g_dBarStartTick        = clockPosition.bar_start_tick;
+            g_dFramesPerClock      = pSegment->framesPerTick * g_dTicksPerClock;
+            g_nTransportStartFrame = ioFrameTime() - pPosition->frame; //!@todo This isn't setting to transport start position
+            if (g_arrangement.isEnabled()) {
+                g_arrangement.locate(g_nSongClock, &g_seqMan);
+                if (g_nClockSource & TRANSPORT_CLOCK_INTERNAL) {
+                    // Schedule first clock at next clock position (relative to start of next period)
+                    std::queue<std::pair<double, double>> qEmpty;
+                    std::swap(g_qClockPos, qEmpty);
+                    if (nState == JackTransportRolling)
+                        g_qClockPos.push(std::pair<double, double>(g_nFrameTime + nFramesInPeriod + g_arrangement.getFrameAtTick(dClockTick) - pPosition->frame,
+                                                                   g_dFramesPerClock));
+                }
+            }
+            g_bTimebaseChanged = false;
+            RTLOG("New position: Jack frame: %u Frame: %u Bar: %u Beat: %u Tick: %u Clock: %u Song clock: %u\n", g_nTransportStartFrame, pPosition->frame,
+                  pPosition->bar, pPosition->beat, pPosition->tick, g_nClock, g_nSongClock);
+            //!@todo Check impact of timebase discontinuity
         }
-        g_nTransportStartFrame = jack_frame_time(g_pJackClient) - pPosition->frame; //!@todo This isn't setting to transport start position
-        pPosition->valid       = JackPositionBBT;
-        g_dFramesPerClock      = getFramesPerClock(g_dTempo);
-        g_bTimebaseChanged     = false;
-        DPRINTF("New position: Jack frame: %u Frame: %u Bar: %u Beat: %u Tick: %u Clock: %u\n", g_nTransportStartFrame, pPosition->frame, pPosition->bar,
-                pPosition->beat, pPosition->tick, g_nClock);
-        //!@todo Check impact of timebase discontinuity
     } else {
-        // DPRINTF("Update position with values from previous period Jack frame: %u Frame: %u Bar: %u Beat: %u Tick: %u Clock: %u\n", g_nTransportStartFrame,
-        // pPosition->frame, pPosition->bar, pPosition->beat, pPosition->tick, g_nClock);
         //  Set BBT values calculated during previous period
         pPosition->bar              = g_nBar;
         pPosition->beat             = g_nBeat;
@@ -300,16 +350,147 @@ void onJackTimebase(jack_transport_state_t nState, jack_nframes_t nFramesInPerio
         pPosition->beat_type        = g_fBeatType;
         pPosition->ticks_per_beat   = g_dTicksPerBeat;
         pPosition->beats_per_minute = g_dTempo;
-        // Loop frame if not playing song
-        //        if(!g_nBeat && isSongPlaying())
-        //            pPosition->frame = transportGetLocation(pPosition->bar, pPosition->beat, pPosition->tick); //!@todo Does this work? (yes). Are there any
-        //            discontinuity or impact on other clients? Can it be optimsed?
+        pPosition->valid            = JackPositionBBT;
+    }
+    releaseMutex();
+    ioEndTimebase(pPosition);
+}
+
+/*  Send feedback of sequence states to controller pads - call from jack process thread with mutex held
+    nFrames: Quantity of frames in this period
+    nNow: Frame time at start of this period
+    bRolling: True if transport is rolling
+    Only changed pad values are sent, limited to g_nFeedbackRate messages per second. Pads not updated due to rate limit are sent in later periods.
+*/
+void processFeedback(jack_nframes_t nFrames, uint64_t nNow, bool bRolling) {
+    void* pFeedbackBuffer = ioGetBuffer(IO_PORT_FEEDBACK, nFrames);
+    ioMidiClearBuffer(pFeedbackBuffer);
+    if (g_nFeedbackPads == 0)
+        return;
+    g_dFeedbackCredit += double(g_nFeedbackRate) * nFrames / g_nSampleRate;
+    if (g_dFeedbackCredit > g_nFeedbackPads)
+        g_dFeedbackCredit = g_nFeedbackPads; // Limit burst to one full refresh
+
+    // Blink phase is synchronised to bar when rolling otherwise free runs at tempo
+    uint32_t nPhaseClock;
+    if (bRolling)
+        nPhaseClock = (g_nBeat - 1) * PPQN + g_nClock;
+    else
+        nPhaseClock = nNow / g_dFramesPerClock;
+
+    uint16_t nPad = g_nFeedbackNext;
+    for (uint16_t nChecked = 0; nChecked < g_nFeedbackPads && g_dFeedbackCredit >= 1.0; ++nChecked, ++nPad) {
+        if (nPad >= g_nFeedbackPads)
+            nPad = 0;
+        FEEDBACK_PAD* pPad = &g_aFeedbackPads[nPad];
+        if (pPad->status == 0)
+            continue;
+        Sequence* pSequence = g_seqMan.findSequence(pPad->bank, pPad->sequence);
+        if (!pSequence)
+            continue;
+        uint8_t nState = pSequence->getPlayState();
+        if (nState > LASTPLAYSTATUS)
+            continue;
+        if (nState == STOPPED && pSequence->isEmpty())
+            nState = FEEDBACK_STATE_EMPTY;
+        FEEDBACK_STATE* pState = &g_aFeedbackStates[nState];
+        uint8_t nValue         = pState->colour;
+        if (pState->blinkRate && (nPhaseClock / pState->blinkRate) & 1)
+            nValue = pState->blinkColour;
+        if (nValue == pPad->value)
+            continue;
+        uint8_t* pBuffer = ioMidiEventReserve(pFeedbackBuffer, 0, 3);
+        if (pBuffer == NULL)
+            break; // Exceeded buffer size - send in next period
+        pBuffer[0]  = pPad->status;
+        pBuffer[1]  = pPad->note;
+        pBuffer[2]  = nValue;
+        pPad->value = nValue;
+        g_dFeedbackCredit -= 1.0;
+    }
+    g_nFeedbackNext = nPad;
+}
+
+// Create monitor region in shared memory, falling back to private memory if shared memory is unavailable
+void initMonitor() {
+    g_pMonitor = (MONITOR_REGION*)rtmonitorCreate(g_monitorShm, MONITOR_SHM_PREFIX, sizeof(MONITOR_REGION));
+    if (!g_pMonitor)
+        return;
+    if (!g_monitorShm.bShared)
+        fprintf(stderr, "libzynseq error: failed to create shared memory - monitor feed only available within process\n");
+    g_pMonitor->version      = MONITOR_VERSION;
+    g_pMonitor->maxSequences = MONITOR_SEQUENCES;
+    g_pMonitor->sampleRate   = g_nSampleRate;
+}
+
+void releaseMonitor() {
+    rtmonitorRelease(g_monitorShm);
+    g_pMonitor = NULL;
+}
+
+// Publish transport state and playing sequence positions to monitor region - called from jack process with mutex held
+void publishMonitor(uint64_t nNow, jack_transport_state_t nState) {
+    if (!g_pMonitor)
+        return;
+    rtmonitorWriteBegin(&g_pMonitor->seq);
+    g_pMonitor->sampleRate      = g_nSampleRate;
+    g_pMonitor->frameTime       = nNow;
+    g_pMonitor->tempo           = g_dTempo;
+    g_pMonitor->bar             = g_nBar;
+    g_pMonitor->beat            = g_nBeat;
+    g_pMonitor->beatsPerBar     = g_nBeatsPerBar;
+    g_pMonitor->songClock       = g_nSongClock;
+    g_pMonitor->transportState  = nState;
+    g_pMonitor->clock           = g_nClock;
+    g_pMonitor->editorPlayState = g_pSequence ? g_pSequence->getPlayState() : STOPPED;
+    g_pMonitor->patternPlayhead = getPatternPlayhead();
+    uint32_t nCount             = 0;
+    for (auto& playing : g_seqMan.getPlayingSequences()) {
+        if (nCount >= MONITOR_SEQUENCES)
+            break;
+        // Must not create a sequence from jack process
+        Sequence* pSequence = g_seqMan.findSequence(playing.first, playing.second);
+        if (!pSequence || pSequence->getPlayState() == STOPPED)
+            continue; // Removed from playing sequences at next clock
+        MONITOR_SEQUENCE* pMon = &g_pMonitor->sequence[nCount++];
+        pMon->bank             = playing.first;
+        pMon->sequence         = playing.second;
+        pMon->playState        = pSequence->getPlayState();
+        pMon->playMode         = pSequence->getPlayMode();
+        pMon->position         = pSequence->getPlayPosition();
+        pMon->length           = pSequence->getLength();
+        pMon->group            = pSequence->getGroup();
+    }
+    g_pMonitor->sequences = nCount;
+    rtmonitorWriteEnd(&g_pMonitor->seq);
+}
+
+/*  Get play position of editor sequence at a frame time
+    dTime: Frame time
+    Returns: Fractional play position in clocks
+    Interpolates between recent clocks so that MIDI input is positioned to the sample, extrapolating beyond first or last clock.
+*/
+double getInputPosition(double dTime) {
+    double dPosition = g_pSequence->getPlayPosition(); // Position of next clock
+    if (g_nClockHistory) {
+        // Find most recent clock at or before event
+        uint32_t nBack = 1;
+        while (nBack < g_nClockHistory && g_aClockHistory[(g_nClockCount - nBack) % CLOCK_HISTORY].first > dTime)
+            ++nBack;
+        std::pair<double, double>& clock = g_aClockHistory[(g_nClockCount - nBack) % CLOCK_HISTORY];
+        dPosition += (dTime - clock.first) / clock.second - nBack;
+    }
+    double dLength = g_pSequence->getLength();
+    if (dLength > 0.0) {
+        dPosition = fmod(dPosition, dLength);
+        if (dPosition < 0.0)
+            dPosition += dLength;
     }
+    return dPosition;
 }
 
 /*  Process jack cycle - must complete within single jack period
     nFrames: Quantity of frames in this period
-    pArgs: Parameters passed to function by main thread (not used here)
 
     [For info]
     jack_last_frame_time() returns the quantity of samples since JACK started until start of this period
@@ -321,7 +502,7 @@ void onJackTimebase(jack_transport_state_t nState, jack_nframes_t nFramesInPerio
     For each event, add MIDI events to the output buffer at appropriate sample sequence
     Remove events from schedule
 */
-int onJackProcess(jack_nframes_t nFrames, void* pArgs) {
+int processPeriod(jack_nframes_t nFrames) {
     static jack_position_t transportPosition; // JACK transport position structure populated each cycle and checked for transport progress
     static uint8_t nClock = PPQN;             // Clock pulse count 0..PPQN - 1
     static uint32_t nTicksPerPulse;
@@ -329,30 +510,32 @@ int onJackProcess(jack_nframes_t nFrames, void* pArgs) {
     static double dBeatsPerMinute;            // Store so that we can check for change and do less maths
     static double dBeatsPerBar;               // Store so that we can check for change and do less maths
     static jack_nframes_t nFramerate;         // Store so that we can check for change and do less maths
-    static jack_nframes_t nLastBeatFrame = 0; // Frames since jack epoch of last quarter note used to calc tempo of external clock
-    static std::pair<double, double> lastClock;
 
     // Get output buffer that will be processed in this process cycle
-    void* pOutputBuffer = jack_port_get_buffer(g_pOutputPort, nFrames);
+    void* pOutputBuffer = ioGetBuffer(IO_PORT_OUTPUT, nFrames);
     unsigned char* pBuffer;
-    jack_midi_clear_buffer(pOutputBuffer);
-    jack_nframes_t nNow                        = jack_last_frame_time(g_pJackClient);
-    jack_transport_state_t nState              = jack_transport_query(g_pJackClient, &transportPosition);
+    ioMidiClearBuffer(pOutputBuffer);
+    size_t nMaxEventSize                       = ioMidiMaxEventSize(pOutputBuffer); // Largest event that fits in an empty buffer
+    uint64_t nNow                              = updateFrameTime();
+    g_nPeriodFrames                            = nFrames;
+    jack_transport_state_t nState              = ioTransportQuery(&transportPosition);
 
-    jack_default_audio_sample_t* pOutMetronome = (jack_default_audio_sample_t*)jack_port_get_buffer(g_pMetronomePort, nFrames);
+    jack_default_audio_sample_t* pOutMetronome = (jack_default_audio_sample_t*)ioGetBuffer(IO_PORT_METRONOME, nFrames);
     memset(pOutMetronome, 0, sizeof(jack_default_audio_sample_t) * nFrames);
+    jack_default_audio_sample_t* pOutSync = (jack_default_audio_sample_t*)ioGetBuffer(IO_PORT_SYNC_OUTPUT, nFrames);
+    memset(pOutSync, 0, sizeof(jack_default_audio_sample_t) * nFrames);
 
     // Process MIDI input
-    void* pInputBuffer = jack_port_get_buffer(g_pInputPort, nFrames);
+    void* pInputBuffer = ioGetBuffer(IO_PORT_INPUT, nFrames);
     jack_midi_event_t midiEvent;
-    jack_nframes_t nCount = jack_midi_get_event_count(pInputBuffer);
+    jack_nframes_t nCount = ioMidiGetEventCount(pInputBuffer);
     Pattern* pPattern     = g_seqMan.getPattern(g_nPattern);
     // Track* pTrack = g_pSequence->getTrack(g_pSequence->m_nCurrentTrack);
-    while (g_bMutex)
-        std::this_thread::sleep_for(std::chrono::microseconds(10));
-    g_bMutex = true;
+    jack_nframes_t nInputLatency = ioInputLatency();
+    getMutex();
+    compileArrangement();
     for (jack_nframes_t i = 0; i < nCount; i++) {
-        if (jack_midi_event_get(&midiEvent, pInputBuffer, i))
+        if (ioMidiEventGet(&midiEvent, pInputBuffer, i))
             continue;
         if (g_nClockSource & (TRANSPORT_CLOCK_MIDI | TRANSPORT_CLOCK_ANALOG)) {
             switch (midiEvent.buffer[0]) {
@@ -368,7 +551,7 @@ int onJackProcess(jack_nframes_t nFrames, void* pArgs) {
                 nState   = JackTransportRolling;
                 g_nClock = 0;
                 g_nMidiClock == 0;
-                nLastBeatFrame = 0;
+                g_nLastBeatFrame = 0;
                 g_nBeat        = 1; //!@todo This should be reset with START, not CONTINUE but currently used for bar sync
                 break;
             case MIDI_CLOCK:
@@ -376,11 +559,11 @@ int onJackProcess(jack_nframes_t nFrames, void* pArgs) {
                     // DPRINTF("MIDI CLOCK %u, %u => %u\n", g_nMidiClock, g_nClock, midiEvent.time);
                     if (g_nMidiClock == 0) {
                         // Update tempo on each beat
-                        if (nLastBeatFrame)
-                            setTempo(60.0 * (double)g_nSampleRate / (nNow + midiEvent.time - nLastBeatFrame));
-                        // DPRINTF("BPM = 60 * %u / (%u + %u - %u) = %f\n", g_nSampleRate, nNow, midiEvent.time, nLastBeatFrame, 60.0 * (double)g_nSampleRate /
-                        // (nNow + midiEvent.time - nLastBeatFrame));
-                        nLastBeatFrame = nNow + midiEvent.time;
+                        if (g_nLastBeatFrame)
+                            setTempo(60.0 * (double)g_nSampleRate / (nNow + midiEvent.time - g_nLastBeatFrame));
+                        // DPRINTF("BPM = 60 * %u / (%u + %u - %u) = %f\n", g_nSampleRate, nNow, midiEvent.time, g_nLastBeatFrame, 60.0 * (double)g_nSampleRate /
+                        // (nNow + midiEvent.time - g_nLastBeatFrame));
+                        g_nLastBeatFrame = nNow + midiEvent.time;
                     }
                     if (nState == JackTransportRolling)
                         g_qClockPos.push(std::pair<double, double>(nNow + midiEvent.time, g_dFramesPerClock));
@@ -415,20 +598,15 @@ int onJackProcess(jack_nframes_t nFrames, void* pArgs) {
 
             // Real Time Capture (while playing)
             if (nPlayState) {
+                // Position of event in clocks, from its frame time less the time it took to reach input port
+                double dPosition = getInputPosition(double(nNow + midiEvent.time) - nInputLatency);
                 // Note on event
                 if (((midiEvent.buffer[0] & 0xF0) == 0x90) && midiEvent.buffer[2]) {
+                    nStep                                     = uint32_t(dPosition / pPattern->getClocksPerStep());
                     startEvents[midiEvent.buffer[1]].start    = nStep;
                     startEvents[midiEvent.buffer[1]].velocity = midiEvent.buffer[2];
                     // Calculate clock position offset, in steps (from 0.0 to 1.0)
-                    float offset                              = double(g_pSequence->getPlayPosition()) / double(pPattern->getClocksPerStep()) - double(nStep);
-                    // Subtract latency delay
-                    offset -= double(nFrames) / double(pPattern->getClocksPerStep() * g_dFramesPerClock);
-                    // Add event offset relative to last clock
-                    // if (lastClock.first) {
-                    // offset += double(midiEvent.time + nNow - lastClock.first - nFrames) / double(pPattern->getClocksPerStep() * g_dFramesPerClock);
-                    //}
-                    if (offset < 0.0)
-                        offset = 0;
+                    float offset                              = dPosition / pPattern->getClocksPerStep() - nStep;
 
                     // Quantize or not
                     if (pPattern->getQuantizeNotes()) {
@@ -442,9 +620,9 @@ int onJackProcess(jack_nframes_t nFrames, void* pArgs) {
                 // Note off event
                 else if (((midiEvent.buffer[0] & 0xF0) == 0x90) && midiEvent.buffer[2] == 0 || (midiEvent.buffer[0] & 0xF0) == 0x80) {
                     if (startEvents[midiEvent.buffer[1]].start != -1) {
-                        double dDur = double(g_pSequence->getPlayPosition()) - startEvents[midiEvent.buffer[1]].start * getClocksPerStep();
-                        if (dDur < 1.0)
-                            dDur = pPattern->getLength() + dDur;
+                        double dDur = dPosition - (startEvents[midiEvent.buffer[1]].start + startEvents[midiEvent.buffer[1]].offset) * getClocksPerStep();
+                        if (dDur < 0.0)
+                            dDur = pPattern->getLength() + dDur; // Note off after end of pattern
                         pPattern->addNote(startEvents[midiEvent.buffer[1]].start, midiEvent.buffer[1], startEvents[midiEvent.buffer[1]].velocity,
                                           dDur / getClocksPerStep(), startEvents[midiEvent.buffer[1]].offset);
                         startEvents[midiEvent.buffer[1]].start = -1;
@@ -489,6 +667,21 @@ int onJackProcess(jack_nframes_t nFrames, void* pArgs) {
         }
     }
 
+    // Recover clocks from sync pulses at audio input
+    if (g_nClockSource & TRANSPORT_CLOCK_ANALOG) {
+        jack_default_audio_sample_t* pInSync = (jack_default_audio_sample_t*)ioGetBuffer(IO_PORT_SYNC_INPUT, nFrames);
+        double aEdges[ANALOGCLOCK_MAX_EDGES];
+        uint32_t nEdges = g_analogClock.detect(pInSync, nNow, nFrames, aEdges, ANALOGCLOCK_MAX_EDGES);
+        std::queue<std::pair<double, double>>* pClockQueue = (nState == JackTransportRolling) ? &g_qClockPos : NULL;
+        for (uint32_t nEdge = 0; nEdge < nEdges; ++nEdge) {
+            // Update tempo on each beat
+            double dBeatFrames = g_analogClock.edge(aEdges[nEdge], g_dFramesPerClock, pClockQueue);
+            if (dBeatFrames > 0.0)
+                setTempo(60.0 * (double)g_nSampleRate / dBeatFrames);
+        }
+        g_analogClock.fill(pClockQueue, nNow + nFrames);
+    }
+
     // Send MIDI output aligned with first sample of frame resulting in similar latency to audio
     //!@todo Interpolate events across frame, e.g. CC variations
 
@@ -496,11 +689,15 @@ int onJackProcess(jack_nframes_t nFrames, void* pArgs) {
     if (nState == JackTransportRolling) {
         bool bSync                  = false; // True if at start of bar
         jack_nframes_t nClockOffset = 0;     // Position within this period that clock 0 occurs
-        if (g_nClockSource & TRANSPORT_CLOCK_INTERNAL && g_qClockPos.empty())
-            g_qClockPos.push(std::pair<double, double>(
-                nNow, g_dFramesPerClock)); // There should always be a clock scheduled for internal clock source when transport is rolling
+        uint32_t nBeatsPerBar       = g_nBeatsPerBar;
+        bool bClocked               = false; // True if a clock was processed in this period
+        std::multimap<uint64_t, MIDI_MESSAGE*>* pClockSchedule = g_bSendMidiClock ? &g_mSchedule : NULL;
+        if (g_nClockSource & TRANSPORT_CLOCK_INTERNAL)
+            g_midiClock.fill(&g_qClockPos, nNow, nNow + nFrames, g_dFramesPerClock, 1,
+                             pClockSchedule); // There should always be a clock scheduled for internal clock source when transport is rolling
         while (!g_qClockPos.empty() && (g_qClockPos.front().first < nNow + nFrames)) {
-            bSync = false;
+            bSync    = false;
+            bClocked = true;
             if (g_nClock == 0) {
                 // Clock zero so on beat
                 bSync           = (g_nBeat == 1);
@@ -509,42 +706,59 @@ int onJackProcess(jack_nframes_t nFrames, void* pArgs) {
                 g_nMetronomePtr = 0;
                 nClockOffset    = g_qClockPos.front().first - nNow;
             }
+            if (g_arrangement.isEnabled()) {
+                // Start and stop sequences at this position in arrangement. Tempo and time signature may change at any clock.
+                g_arrangement.clock(g_nSongClock, &g_seqMan);
+                ArrangementSegment* pSegment = g_arrangement.getSegmentAtTick(g_nSongClock * g_dTicksPerClock);
+                g_dFramesPerClock            = pSegment->framesPerTick * g_dTicksPerClock;
+                nBeatsPerBar                 = pSegment->beatsPerBar;
+            }
             // Schedule events in next period
             // Pass clock time and schedule to pattern manager so it can populate with events. Pass sync pulse so that it can synchronise its sequences, e.g.
             // start zynpad sequences
             g_nPlayingSequences =
                 g_seqMan.clock(g_qClockPos.front(), &g_mSchedule, bSync); //!@todo Optimise to reduce rate calling clock especially if we increase the clock
                                                                           //!rate from 24 to 96 or above. Maybe return the time until next check
+            g_aClockHistory[g_nClockCount++ % CLOCK_HISTORY] = g_qClockPos.front();
+            g_analogClock.clock(g_qClockPos.front().first, g_qClockPos.front().second, g_nClock);
+            if (g_nClockHistory < CLOCK_HISTORY)
+                ++g_nClockHistory;
             // Advance clock
+            ++g_nSongClock;
             if (++g_nClock >= PPQN) {
                 g_nClock = 0;
-                if (++g_nBeat > g_nBeatsPerBar) {
+                if (++g_nBeat > nBeatsPerBar) {
                     g_nBeat = 1;
-                    if (g_bClientPlaying) //!@todo This will advance bar and stop manual beats per bar changes working when other clients are playing
+                    g_dBarStartTick += nBeatsPerBar * g_dTicksPerBeat;
+                    if (g_bClientPlaying || g_arrangement.isEnabled()) //!@todo This will advance bar and stop manual beats per bar changes working when other
+                                                                       //!clients are playing
                         ++g_nBar;
                 }
-                DPRINTF("Beat %u of %u\n", g_nBeat, g_nBeatsPerBar);
+                RTLOG("Beat %u of %u\n", g_nBeat, nBeatsPerBar);
             }
-            if (g_bSendMidiClock && g_nPlayingSequences) {
-                // Add a MIDI clock to the queue
-                jack_nframes_t nClockTime = g_qClockPos.front().first - nNow;
-                if (bSync)
-                    g_mSchedule.insert(std::pair<uint32_t, MIDI_MESSAGE*>(nClockTime, new MIDI_MESSAGE({MIDI_CONTINUE, 0, 0})));
-                g_mSchedule.insert(std::pair<uint32_t, MIDI_MESSAGE*>(nClockTime, new MIDI_MESSAGE({MIDI_CLOCK, 0, 0})));
+            if (g_bSendMidiClock) {
+                // MIDI clock runs continuously while transport rolls - internal clock pulses were scheduled by generator
+                uint64_t nClockTime = g_midiClock.getOutputTime(g_qClockPos.front().first);
+                if (bSync && g_nPlayingSequences)
+                    g_mSchedule.emplace_hint(g_mSchedule.lower_bound(nClockTime), nClockTime, new MIDI_MESSAGE({MIDI_CONTINUE, 0, 0})); // Before pulse
+                if (!(g_nClockSource & TRANSPORT_CLOCK_INTERNAL))
+                    g_midiClock.relay(g_qClockPos.front().first, &g_mSchedule);
             }
             if (g_nClockSource & TRANSPORT_CLOCK_INTERNAL)
-                g_qClockPos.push(std::pair<double, double>(g_qClockPos.back().first + g_dFramesPerClock, g_dFramesPerClock));
+                g_midiClock.fill(&g_qClockPos, nNow, nNow + nFrames, g_dFramesPerClock, 2, pClockSchedule);
             g_qClockPos.pop();
         }
         // g_nTick = g_dTicksPerBeat - nRemainingFrames / getFramesPerTick(g_dTempo);
 
-        if (g_nPlayingSequences == 0) {
-            DPRINTF("Stopping transport because no sequences playing clock: %u beat: %u tick: %u\n", g_nClock, g_nBeat, g_nTick);
+        // External clocks, e.g. analog sync pulses, may be several periods apart so only stop after a clock has updated the playing sequences
+        bool bCanStop = bClocked || (g_nClockSource & TRANSPORT_CLOCK_INTERNAL);
+        if (bCanStop && g_nPlayingSequences == 0 && !(g_arrangement.isEnabled() && g_nSongClock <= g_arrangement.getEndClock())) {
+            RTLOG("Stopping transport because no sequences playing clock: %u beat: %u tick: %u\n", g_nClock, g_nBeat, g_nTick);
             transportStop("zynseq");
             g_nMetronomePtr = -1;
             // if(g_nClockSource & TRANSPORT_CLOCK_INTERNAL)
-            {
-                // Remove pending clocks
+            if (!g_bClientPlaying) {
+                // Remove pending clocks unless another client keeps transport (and MIDI clock) rolling
                 std::queue<std::pair<double, double>> qEmpty;
                 std::swap(g_qClockPos, qEmpty);
             }
@@ -560,8 +774,15 @@ int onJackProcess(jack_nframes_t nFrames, void* pArgs) {
                 }
             }
         }
+    } else {
+        g_midiClock.reset();  // Restart pulse train when transport next rolls
+        g_nClockHistory = 0; // Play position does not advance while stopped
     }
 
+    g_analogClock.render(pOutSync, nNow, nFrames);
+    processFeedback(nFrames, nNow, nState == JackTransportRolling);
+    publishMonitor(nNow, nState);
+
     // Process events scheduled to be sent to MIDI output
     if (g_mSchedule.size()) {
         auto it              = g_mSchedule.begin();
@@ -571,15 +792,34 @@ int onJackProcess(jack_nframes_t nFrames, void* pArgs) {
                 break; // Event scheduled beyond this buffer
             if (it->first < nNow) {
                 nTime = 0; // This event is in the past so send as soon as possible
-                DPRINTF("Sending event from past (Scheduled:%u Now:%u Diff:%d samples)\n", it->first, nNow, nNow - it->first);
+                RTLOG("Sending event from past (Scheduled:%llu Now:%llu Diff:%llu samples)\n", (unsigned long long)it->first, (unsigned long long)nNow,
+                      (unsigned long long)(nNow - it->first));
             } else
-                nTime = it->first - nNow; // Schedule event at scheduled time sequence
+                nTime = jack_nframes_t(it->first - nNow); // Convert to offset within this period
             if (nTime >= nFrames) {
-                g_bMutex = false;
+                releaseMutex();
                 return 0; // Must have bumped beyond end of this frame time so must wait until next frame - earlier events were processed and pointer nulled so
                           // will not trigger in next period
             }
-            if (it->second) {
+            if (it->second && it->second->data) {
+                // Variable length message (SysEx) held in sequence manager's arena
+                size_t nSize = it->second->size;
+                if (nSize > nMaxEventSize) {
+                    // Can never fit in output buffer so discard rather than block subsequent events
+                    RTLOG("Discarding %u byte SysEx that exceeds JACK MIDI buffer\n", it->second->size);
+                    pBuffer = NULL;
+                } else {
+                    pBuffer = ioMidiEventReserve(pOutputBuffer, nTime, nSize);
+                    if (pBuffer == NULL)
+                        break; // Insufficient space remaining in this period so send in next period
+                    memcpy(pBuffer, it->second->data, nSize);
+                }
+                g_seqMan.releaseSysex();
+                delete it->second;
+                it->second = NULL;
+                ++it;
+                continue;
+            } else if (it->second) {
                 // Get a pointer to the next available bytes in the output buffer
                 size_t nSize = 1;
                 if (it->second->command < 0xF4) {
@@ -597,7 +837,7 @@ int onJackProcess(jack_nframes_t nFrames, void* pArgs) {
                         nSize = 3;
                     }
                 }
-                pBuffer = jack_midi_event_reserve(pOutputBuffer, nTime, nSize);
+                pBuffer = ioMidiEventReserve(pOutputBuffer, nTime, nSize);
                 if (pBuffer == NULL)
                     break; // Exceeded buffer size (or other issue)
 
@@ -606,15 +846,220 @@ int onJackProcess(jack_nframes_t nFrames, void* pArgs) {
                     pBuffer[1] = it->second->value1;
                 if (nSize > 2)
                     pBuffer[2] = it->second->value2;
+                if (it->second->command == MIDI_CLOCK && it->second->value1 == MIDICLOCK_GENERATED)
+                    g_midiClock.sent(nNow + nTime);
                 delete it->second;
                 it->second = NULL;
             }
             ++it;
-            DPRINTF("Sending MIDI event %d,%d,%d at %u\n", pBuffer[0], pBuffer[1], pBuffer[2], nNow + nTime);
+            RTLOG("Sending MIDI event %d,%d,%d at %llu\n", pBuffer[0], pBuffer[1], pBuffer[2], (unsigned long long)(nNow + nTime));
         }
         g_mSchedule.erase(g_mSchedule.begin(), it);
     }
-    g_bMutex = false;
+    releaseMutex();
+    return 0;
+}
+
+// Runtime state not held in sequence file - recorded at start of capture and restored before replay
+struct RUNTIME_STATE {
+    uint64_t frameTime;                                 // g_nFrameTime
+    uint64_t lastBeatFrame;                             // g_nLastBeatFrame
+    double tempo;                                       // g_dTempo
+    double framesPerClock;                              // g_dFramesPerClock
+    double barStartTick;                                // g_dBarStartTick
+    double ticksPerBeat;                                // g_dTicksPerBeat
+    double feedbackCredit;                              // g_dFeedbackCredit
+    double clockPos[CAPTURE_CLOCK_QUEUE][2];            // g_qClockPos
+    double clockHistory[CLOCK_HISTORY][2];              // g_aClockHistory
+    uint32_t clockCount;                                // g_nClockCount
+    uint32_t clockHistoryCount;                         // g_nClockHistory
+    int64_t metronomePtr;                               // g_nMetronomePtr
+    jack_nframes_t lastJackFrameTime;                   // g_nLastJackFrameTime
+    jack_nframes_t frameTimeOffset;                     // g_nFrameTimeOffset
+    jack_nframes_t periodFrames;                        // g_nPeriodFrames
+    jack_nframes_t newFrameTimeOffset;                  // g_nNewFrameTimeOffset
+    jack_nframes_t transportStartFrame;                 // g_nTransportStartFrame
+    uint32_t beatsPerBar;                               // g_nBeatsPerBar
+    uint32_t bar;                                       // g_nBar
+    uint32_t beat;                                      // g_nBeat
+    uint32_t tick;                                      // g_nTick
+    uint32_t songClock;                                 // g_nSongClock
+    uint32_t pattern;                                   // g_nPattern
+    float beatType;                                     // g_fBeatType
+    float swingAmount;                                  // g_fSwingAmount
+    float humanTime;                                    // g_fHumanTime
+    float humanVelo;                                    // g_fHumanVelo
+    float playChance;                                   // g_fPlayChance
+    float metronomeLevel;                               // g_fMetronomeLevel
+    float midiClockLatency;                             // g_fMidiClockLatency
+    float syncPulseWidth;                               // g_fSyncPulseWidth
+    AnalogClock analogClock;                            // g_analogClock
+    uint16_t feedbackPads;                              // g_nFeedbackPads
+    uint16_t feedbackNext;                              // g_nFeedbackNext
+    uint16_t feedbackRate;                              // g_nFeedbackRate
+    uint8_t clockPosCount;                              // Quantity of entries in clockPos
+    uint8_t clock;                                      // g_nClock
+    uint8_t midiClock;                                  // g_nMidiClock
+    uint8_t clockSource;                                // g_nClockSource
+    uint8_t sendMidiClock;                              // g_bSendMidiClock
+    uint8_t midiClockRamp;                              // Ramp of g_midiClock
+    uint8_t metronome;                                  // g_bMetronome
+    uint8_t metronomePeep;                              // True if g_pMetro is g_metro_peep
+    uint8_t midiRecord;                                 // g_bMidiRecord
+    uint8_t sustain;                                    // g_bSustain
+    uint8_t inputRest;                                  // g_nInputRest
+    uint8_t timebaseChanged;                            // g_bTimebaseChanged
+    uint8_t sequenceBank;                               // Bank of g_pSequence
+    uint8_t sequence;                                   // Sequence of g_pSequence
+    uint8_t sequenceValid;                              // True if g_pSequence was found in a bank
+    FEEDBACK_PAD aFeedbackPads[FEEDBACK_MAX_PADS];      // g_aFeedbackPads
+    FEEDBACK_STATE aFeedbackStates[FEEDBACK_STATES];    // g_aFeedbackStates
+    struct ev_start aStartEvents[128];                  // startEvents
+};
+RUNTIME_STATE g_captureState; // Runtime state populated at start of capture
+uint32_t g_nCaptureSeed = 0;  // Seed of pseudo random generators at start of capture
+
+// Populate runtime state from library - call from process thread at start of first captured period (editor sequence populated by startCapture)
+void getRuntimeState(RUNTIME_STATE* pState) {
+    pState->frameTime           = g_nFrameTime;
+    pState->lastBeatFrame       = g_nLastBeatFrame;
+    pState->tempo               = g_dTempo;
+    pState->framesPerClock      = g_dFramesPerClock;
+    pState->barStartTick        = g_dBarStartTick;
+    pState->ticksPerBeat        = g_dTicksPerBeat;
+    pState->feedbackCredit      = g_dFeedbackCredit;
+    pState->metronomePtr        = int64_t(g_nMetronomePtr);
+    pState->lastJackFrameTime   = g_nLastJackFrameTime;
+    pState->frameTimeOffset     = g_nFrameTimeOffset;
+    pState->periodFrames        = g_nPeriodFrames;
+    pState->newFrameTimeOffset  = g_nNewFrameTimeOffset;
+    pState->transportStartFrame = g_nTransportStartFrame;
+    pState->beatsPerBar         = g_nBeatsPerBar;
+    pState->bar                 = g_nBar;
+    pState->beat                = g_nBeat;
+    pState->tick                = g_nTick;
+    pState->songClock           = g_nSongClock;
+    pState->clockCount          = g_nClockCount;
+    pState->clockHistoryCount   = g_nClockHistory;
+    for (uint32_t i = 0; i < CLOCK_HISTORY; ++i) {
+        pState->clockHistory[i][0] = g_aClockHistory[i].first;
+        pState->clockHistory[i][1] = g_aClockHistory[i].second;
+    }
+    pState->pattern             = g_nPattern;
+    pState->beatType            = g_fBeatType;
+    pState->swingAmount         = g_fSwingAmount;
+    pState->humanTime           = g_fHumanTime;
+    pState->humanVelo           = g_fHumanVelo;
+    pState->playChance          = g_fPlayChance;
+    pState->metronomeLevel      = g_fMetronomeLevel;
+    pState->midiClockLatency    = g_fMidiClockLatency;
+    pState->syncPulseWidth      = g_fSyncPulseWidth;
+    pState->analogClock         = g_analogClock;
+    pState->feedbackPads        = g_nFeedbackPads;
+    pState->feedbackNext        = g_nFeedbackNext;
+    pState->feedbackRate        = g_nFeedbackRate;
+    pState->clock               = g_nClock;
+    pState->midiClock           = g_nMidiClock;
+    pState->clockSource         = g_nClockSource;
+    pState->sendMidiClock       = g_bSendMidiClock;
+    pState->midiClockRamp       = g_midiClock.getRamp();
+    pState->metronome           = g_bMetronome;
+    pState->metronomePeep       = (g_pMetro == &g_metro_peep);
+    pState->midiRecord          = g_bMidiRecord;
+    pState->sustain             = g_bSustain;
+    pState->inputRest           = g_nInputRest;
+    pState->timebaseChanged     = g_bTimebaseChanged;
+    // Queue is copied by cycling it so that its order is retained
+    size_t nClockPos            = g_qClockPos.size();
+    pState->clockPosCount       = 0;
+    for (size_t i = 0; i < nClockPos; ++i) {
+        if (pState->clockPosCount < CAPTURE_CLOCK_QUEUE) {
+            pState->clockPos[pState->clockPosCount][0] = g_qClockPos.front().first;
+            pState->clockPos[pState->clockPosCount][1] = g_qClockPos.front().second;
+            ++pState->clockPosCount;
+        }
+        g_qClockPos.push(g_qClockPos.front());
+        g_qClockPos.pop();
+    }
+    memcpy(pState->aFeedbackPads, g_aFeedbackPads, sizeof(g_aFeedbackPads));
+    memcpy(pState->aFeedbackStates, g_aFeedbackStates, sizeof(g_aFeedbackStates));
+    memcpy(pState->aStartEvents, startEvents, sizeof(startEvents));
+}
+
+// Restore runtime state to library before replay
+void setRuntimeState(const RUNTIME_STATE* pState) {
+    g_nFrameTime           = pState->frameTime;
+    g_nLastBeatFrame       = pState->lastBeatFrame;
+    g_dTempo               = pState->tempo;
+    g_dFramesPerClock      = pState->framesPerClock;
+    g_dBarStartTick        = pState->barStartTick;
+    g_dTicksPerBeat        = pState->ticksPerBeat;
+    g_dFeedbackCredit      = pState->feedbackCredit;
+    g_nMetronomePtr        = size_t(pState->metronomePtr);
+    g_nLastJackFrameTime   = pState->lastJackFrameTime;
+    g_nFrameTimeOffset     = pState->frameTimeOffset;
+    g_nPeriodFrames        = pState->periodFrames;
+    g_nNewFrameTimeOffset  = pState->newFrameTimeOffset;
+    g_nTransportStartFrame = pState->transportStartFrame;
+    g_nBeatsPerBar         = pState->beatsPerBar;
+    g_nBar                 = pState->bar;
+    g_nBeat                = pState->beat;
+    g_nTick                = pState->tick;
+    g_nSongClock           = pState->songClock;
+    g_nClockCount          = pState->clockCount;
+    g_nClockHistory        = pState->clockHistoryCount;
+    for (uint32_t i = 0; i < CLOCK_HISTORY; ++i)
+        g_aClockHistory[i] = std::pair<double, double>(pState->clockHistory[i][0], pState->clockHistory[i][1]);
+    g_fBeatType            = pState->beatType;
+    g_fSwingAmount         = pState->swingAmount;
+    g_fHumanTime           = pState->humanTime;
+    g_fHumanVelo           = pState->humanVelo;
+    g_fPlayChance          = pState->playChance;
+    g_fMetronomeLevel      = pState->metronomeLevel;
+    g_fMidiClockLatency    = pState->midiClockLatency;
+    g_midiClock.setLatency(g_fMidiClockLatency * g_nSampleRate / 1000);
+    g_midiClock.setRamp(pState->midiClockRamp);
+    g_midiClock.reset();
+    g_fSyncPulseWidth      = pState->syncPulseWidth;
+    g_analogClock          = pState->analogClock;
+    g_nFeedbackPads        = pState->feedbackPads;
+    g_nFeedbackNext        = pState->feedbackNext;
+    g_nFeedbackRate        = pState->feedbackRate;
+    g_nClock               = pState->clock;
+    g_nMidiClock           = pState->midiClock;
+    g_nClockSource         = pState->clockSource;
+    g_bSendMidiClock       = pState->sendMidiClock;
+    g_bMetronome           = pState->metronome;
+    g_pMetro               = pState->metronomePeep ? &g_metro_peep : &g_metro_pip;
+    g_bMidiRecord          = pState->midiRecord;
+    g_bSustain             = pState->sustain;
+    g_nInputRest           = pState->inputRest;
+    g_bTimebaseChanged     = pState->timebaseChanged;
+    std::queue<std::pair<double, double>> qClockPos;
+    for (uint8_t i = 0; i < pState->clockPosCount; ++i)
+        qClockPos.push(std::pair<double, double>(pState->clockPos[i][0], pState->clockPos[i][1]));
+    std::swap(g_qClockPos, qClockPos);
+    memcpy(g_aFeedbackPads, pState->aFeedbackPads, sizeof(g_aFeedbackPads));
+    memcpy(g_aFeedbackStates, pState->aFeedbackStates, sizeof(g_aFeedbackStates));
+    memcpy(startEvents, pState->aStartEvents, sizeof(startEvents));
+    g_pSequence = pState->sequenceValid ? g_seqMan.getSequence(pState->sequenceBank, pState->sequence) : NULL;
+    selectPattern(pState->pattern);
+    g_arrangement.setDirty();
+}
+
+/*  Handle JACK process callback
+    nFrames: Quantity of frames in this period
+    pArgs: Parameters passed to function by main thread (not used here)
+    Wraps processing of the period with capture of its inputs and outputs.
+*/
+int onJackProcess(jack_nframes_t nFrames, void* pArgs) {
+    ioBeginPeriod(nFrames);
+    if (captureIsPending()) {
+        getRuntimeState(&g_captureState);
+        ioCaptureState(&g_captureState, sizeof(g_captureState));
+    }
+    processPeriod(nFrames);
+    ioEndPeriod(nFrames);
     return 0;
 }
 
@@ -624,9 +1069,17 @@ int onJackSampleRateChange(jack_nframes_t nFrames, void* pArgs) {
         return 0;
     g_nSampleRate     = nFrames;
     g_dFramesPerClock = getFramesPerClock(g_dTempo);
+    g_midiClock.setLatency(g_fMidiClockLatency * g_nSampleRate / 1000);
+    g_analogClock.setPulseWidth(g_fSyncPulseWidth * g_nSampleRate / 1000);
+    g_arrangement.setDirty();
     return 0;
 }
 
+void onJackLatency(jack_latency_callback_mode_t nMode, void* pArgs) {
+    if (nMode == JackCaptureLatency)
+        ioUpdateInputLatency();
+}
+
 int onJackXrun(void* pArgs) {
     DPRINTF("zynseq detected XRUN %u\n", ++g_nXruns);
     // g_bTimebaseChanged = true; // Discontinuity so need to recalculate timebase parameters
@@ -639,19 +1092,25 @@ void end() {
     for (auto it : g_mSchedule) {
         delete it.second;
     }
+    releaseMonitor();
 }
 
 // ** Library management functions **
 
 __attribute__((constructor)) void zynseq(void) { fprintf(stderr, "Started libzynseq\n"); }
 
-void init(char* name) {
-    //!@todo Invalid name triggers seg fault
-
+// Point metronome sounds at wav data
+void initMetronome() {
     g_metro_pip.data  = metronome_pip;
     g_metro_pip.size  = sizeof(metronome_pip) / sizeof(float);
     g_metro_peep.data = metronome_peep;
     g_metro_peep.size = sizeof(metronome_peep) / sizeof(float);
+}
+
+void init(char* name) {
+    //!@todo Invalid name triggers seg fault
+
+    initMetronome();
 
     // Register with Jack server
     // fprintf(stderr, "**zynseq initialising as %s**\n", name);
@@ -687,12 +1146,39 @@ void init(char* name) {
         return;
     }
 
+    // Create controller feedback output port
+    if (!(g_pFeedbackPort = jack_port_register(g_pJackClient, "feedback", JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0))) {
+        fprintf(stderr, "libzynseq cannot register feedback port\n");
+        return;
+    }
+
+    // Create analog sync output and input ports
+    if (!(g_pSyncOutputPort = jack_port_register(g_pJackClient, "sync_out", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0))) {
+        fprintf(stderr, "libzynseq cannot register sync output port\n");
+        return;
+    }
+    if (!(g_pSyncInputPort = jack_port_register(g_pJackClient, "sync_in", JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0))) {
+        fprintf(stderr, "libzynseq cannot register sync input port\n");
+        return;
+    }
+
     g_nSampleRate     = jack_get_sample_rate(g_pJackClient);
     g_dFramesPerClock = getFramesPerClock(g_dTempo);
+    g_analogClock.setPulseWidth(g_fSyncPulseWidth * g_nSampleRate / 1000);
+    initMonitor();
+    ioSetClient(g_pJackClient);
+    ioSetPort(IO_PORT_INPUT, g_pInputPort);
+    ioSetPort(IO_PORT_OUTPUT, g_pOutputPort);
+    ioSetPort(IO_PORT_METRONOME, g_pMetronomePort);
+    ioSetPort(IO_PORT_FEEDBACK, g_pFeedbackPort);
+    ioSetPort(IO_PORT_SYNC_OUTPUT, g_pSyncOutputPort);
+    ioSetPort(IO_PORT_SYNC_INPUT, g_pSyncInputPort);
 
     // Register JACK callbacks
     jack_set_process_callback(g_pJackClient, onJackProcess, 0);
+    jack_set_thread_init_callback(g_pJackClient, rtlogThreadInit, 0);
     jack_set_sample_rate_callback(g_pJackClient, onJackSampleRateChange, 0);
+    jack_set_latency_callback(g_pJackClient, onJackLatency, 0);
     //    jack_set_xrun_callback(g_pJackClient, onJackXrun, 0); //!@todo Remove xrun handler (just for debug)
 
     if (jack_activate(g_pJackClient)) {
@@ -711,6 +1197,10 @@ void init(char* name) {
 
 bool isModified() { return g_bDirty; }
 
+uint64_t getFrameTime() { return g_nFrameTime; }
+
+void setFrameTimeWrap(uint32_t frames) { g_nNewFrameTimeOffset = -(ioLastFrameTime() + frames); }
+
 int fileWrite8(uint8_t value, FILE* pFile) {
     int nResult = fwrite(&value, 1, 1, pFile);
     return 1;
@@ -764,6 +1254,13 @@ uint32_t fileRead32(FILE* pFile) {
 
 float fileReadBCD(FILE* f) { return float(fileRead16(f)) / 10000 + fileRead16(f); }
 
+// Get value as it would be after writing to and reading from file as BCD
+float roundBCD(float v) {
+    uint16_t nUnits   = uint16_t(v);
+    uint16_t nDecimal = uint16_t((v - nUnits) * 10000);
+    return float(nDecimal) / 10000 + nUnits;
+}
+
 bool checkBlock(FILE* pFile, uint32_t nActualSize, uint32_t nExpectedSize) {
     if (nActualSize < nExpectedSize) {
         for (size_t i = 0; i < nActualSize; ++i)
@@ -773,9 +1270,48 @@ bool checkBlock(FILE* pFile, uint32_t nActualSize, uint32_t nExpectedSize) {
     return false;
 }
 
+// Read variable length payload that follows a SysEx event (file version > 12). Returns quantity of bytes consumed from block.
+uint32_t fileReadEventData(FILE* pFile, uint32_t nBlockSize, Pattern* pPattern, StepEvent* pEvent) {
+    if (checkBlock(pFile, nBlockSize, 2))
+        return nBlockSize;
+    uint16_t nSize = fileRead16(pFile);
+    if (checkBlock(pFile, nBlockSize - 2, nSize + (nSize & 1)))
+        return nBlockSize;
+    uint8_t aData[MAX_SYSEX_SIZE];
+    for (uint16_t i = 0; i < nSize; ++i) {
+        uint8_t nValue = fileRead8(pFile);
+        if (i < MAX_SYSEX_SIZE)
+            aData[i] = nValue;
+    }
+    if (nSize & 1)
+        fileRead8(pFile); // Padding
+    getMutex(); // Pattern's payload pool may move whilst growing
+    if (!pPattern->setEventData(pEvent, aData, nSize))
+        pPattern->removeSysex(pEvent->getPosition()); // Don't leave SysEx without payload
+    releaseMutex();
+    return 2 + nSize + (nSize & 1);
+}
+
+// Write variable length payload that follows a SysEx event. Returns quantity of bytes written.
+int fileWriteEventData(FILE* pFile, Pattern* pPattern, StepEvent* pEvent) {
+    uint8_t* pData = pPattern->getEventData(pEvent);
+    uint16_t nSize = pData ? pEvent->getDataSize() : 0;
+    int nPos       = fileWrite16(nSize, pFile);
+    for (uint16_t i = 0; i < nSize; ++i)
+        nPos += fileWrite8(pData[i], pFile);
+    if (nSize & 1)
+        nPos += fileWrite8('\0', pFile); // Pad to even size
+    return nPos;
+}
+
 bool load(const char* filename) {
+    CAPTURE_API(load, filename); // Replay reloads the same path so the file must be unchanged
     g_pSequence = NULL;
     g_seqMan.init();
+    getMutex();
+    g_arrangement.clear();
+    g_arrangement.enable(false);
+    releaseMutex();
     uint32_t nVersion = 0;
     FILE* pFile;
     pFile = fopen(filename, "r");
@@ -820,8 +1356,10 @@ bool load(const char* filename) {
             }
             uint32_t nPattern = fileRead32(pFile);
             Pattern* pPattern = g_seqMan.getPattern(nPattern);
+            getMutex(); // Pattern may be playing whilst its events and payload pool are replaced
             pPattern->clear();
             pPattern->resetSnapshots();
+            releaseMutex();
             pPattern->setBeatsInPattern(fileRead32(pFile));
             pPattern->setStepsPerBeat(fileRead16(pFile));
             pPattern->setScale(fileRead8(pFile));
@@ -889,10 +1427,14 @@ bool load(const char* filename) {
                 }
                 fileRead8(pFile); // Padding
                 nBlockSize -= 14;
+                if (nVersion > 12 && nCommand == MIDI_SYSEX_START)
+                    nBlockSize -= fileReadEventData(pFile, nBlockSize, pPattern, pEvent);
                 // printf(" Step:%u Duration:%u Command:%02X, Value1:%u..%u, Value2:%u..%u\n", nTime, nDuration, nCommand, nValue1start, nValue2end,
                 // nValue2start, nValue2end);
             }
+            getMutex(); // Payload pool is compacted
             pPattern->resetSnapshots();
+            releaseMutex();
         } else if (memcmp(sHeader, "bank", 4) == 0) {
             // Load banks
             if (checkBlock(pFile, nBlockSize, 6))
@@ -973,6 +1515,72 @@ bool load(const char* filename) {
                 }
                 pSequence->updateLength();
             }
+        } else if (memcmp(sHeader, "mfx ", 4) == 0) {
+            // Load track MIDI effects
+            if (checkBlock(pFile, nBlockSize, 4))
+                continue;
+            uint8_t nBank     = fileRead8(pFile);
+            uint8_t nSequence = fileRead8(pFile);
+            uint8_t nTrack    = fileRead8(pFile);
+            fileRead8(pFile); // Padding
+            nBlockSize -= 4;
+            Track* pTrack = g_seqMan.getSequence(nBank, nSequence)->getTrack(nTrack);
+            while (nBlockSize >= 4) {
+                uint8_t nParam = fileRead8(pFile);
+                fileRead8(pFile); // Padding
+                int16_t nValue = fileRead16(pFile);
+                if (pTrack)
+                    pTrack->getMidiFx()->setParam(nParam, nValue);
+                nBlockSize -= 4;
+            }
+            checkBlock(pFile, nBlockSize, 4); // Skip any incomplete parameter
+        } else if (memcmp(sHeader, "flow", 4) == 0) {
+            // Load sequence follow action
+            if (checkBlock(pFile, nBlockSize, 8))
+                continue;
+            uint8_t nBank     = fileRead8(pFile);
+            uint8_t nSequence = fileRead8(pFile);
+            uint8_t nAction   = fileRead8(pFile);
+            bool bStop        = fileRead8(pFile);
+            uint16_t nLoops   = fileRead16(pFile);
+            fileRead16(pFile); // Padding
+            nBlockSize -= 8;
+            Sequence* pSequence = g_seqMan.getSequence(nBank, nSequence);
+            pSequence->setFollowAction(nAction, nLoops, bStop);
+            while (nBlockSize >= 4) {
+                uint8_t nTargetBank     = fileRead8(pFile);
+                uint8_t nTargetSequence = fileRead8(pFile);
+                uint8_t nWeight         = fileRead8(pFile);
+                fileRead8(pFile); // Padding
+                g_seqMan.getSequence(nTargetBank, nTargetSequence);
+                pSequence->addFollowTarget(nTargetBank, nTargetSequence, nWeight);
+                nBlockSize -= 4;
+            }
+            checkBlock(pFile, nBlockSize, 4); // Skip any incomplete target
+        } else if (memcmp(sHeader, "arng", 4) == 0) {
+            // Load arrangement
+            if (checkBlock(pFile, nBlockSize, 2))
+                continue;
+            bool bEnable = fileRead8(pFile);
+            fileRead8(pFile); // Padding
+            nBlockSize -= 2;
+            std::vector<ArrangementEvent> vEvents;
+            while (nBlockSize >= 12) {
+                ArrangementEvent event;
+                event.bar   = fileRead16(pFile);
+                event.type  = fileRead8(pFile);
+                fileRead8(pFile); // Padding
+                event.tick  = fileRead32(pFile);
+                event.value = fileRead32(pFile);
+                vEvents.push_back(event);
+                nBlockSize -= 12;
+            }
+            checkBlock(pFile, nBlockSize, 12); // Skip any incomplete event
+            getMutex();
+            for (auto it = vEvents.begin(); it != vEvents.end(); ++it)
+                g_arrangement.addEvent(it->bar, it->tick, it->type, it->value);
+            g_arrangement.enable(bEnable);
+            releaseMutex();
         }
     }
     fclose(pFile);
@@ -980,6 +1588,12 @@ bool load(const char* filename) {
     // filename);
     g_bDirty    = false;
     g_pSequence = g_seqMan.getSequence(0, 0);
+    if (captureIsRunning() || replayIsRunning()) {
+        // Loaded sequences are seeded from random_device so reseed for replay to reproduce play chance, humanisation and follow actions
+        getMutex();
+        g_seqMan.seedRandom(g_nCaptureSeed);
+        releaseMutex();
+    }
     selectPattern(1);
     return true;
 }
@@ -1024,7 +1638,9 @@ bool load_pattern(uint32_t nPattern, const char* filename) {
                     continue;
             }
             Pattern* pPattern = g_seqMan.getPattern(nPattern);
+            getMutex(); // Pattern may be playing whilst its events are replaced
             pPattern->clear();
+            releaseMutex();
             pPattern->setBeatsInPattern(fileRead32(pFile));
             pPattern->setStepsPerBeat(fileRead16(pFile));
             pPattern->setScale(fileRead8(pFile));
@@ -1092,10 +1708,14 @@ bool load_pattern(uint32_t nPattern, const char* filename) {
                 }
                 fileRead8(pFile); // Padding
                 nBlockSize -= 14;
+                if (nVersion > 12 && nCommand == MIDI_SYSEX_START)
+                    nBlockSize -= fileReadEventData(pFile, nBlockSize, pPattern, pEvent);
                 // printf(" Step:%u Duration:%u Command:%02X, Value1:%u..%u, Value2:%u..%u\n", nTime, nDuration, nCommand, nValue1start, nValue2end,
                 // nValue2start, nValue2end);
             }
+            getMutex(); // Payload pool is compacted
             pPattern->resetSnapshots();
+            releaseMutex();
         }
     }
     fclose(pFile);
@@ -1166,6 +1786,8 @@ void save(const char* filename) {
                 nPos += fileWrite8(pEvent->getStutterDur(), pFile);
                 nPos += fileWrite8(pEvent->getPlayChance(), pFile);
                 nPos += fileWrite8('\0', pFile); // Pad to even block (could do at end but simplest here)
+                if (pEvent->getCommand() == MIDI_SYSEX_START)
+                    nPos += fileWriteEventData(pFile, pPattern, pEvent);
             }
             nBlockSize = nPos - nStartOfBlock;
             fseek(pFile, nStartOfBlock - 4, SEEK_SET);
@@ -1240,6 +1862,84 @@ void save(const char* filename) {
         fseek(pFile, 0, SEEK_END);
     }
 
+    // Track MIDI effects
+    for (uint32_t nBank = 1; nBank < g_seqMan.getBanks(); ++nBank) {
+        for (uint32_t nSequence = 0; nSequence < g_seqMan.getSequencesInBank(nBank); ++nSequence) {
+            Sequence* pSequence = g_seqMan.getSequence(nBank, nSequence);
+            for (uint32_t nTrack = 0; nTrack < pSequence->getTracks(); ++nTrack) {
+                MidiFx* pMidiFx = pSequence->getTrack(nTrack)->getMidiFx();
+                if (!pMidiFx->isConfigured())
+                    continue;
+                fwrite("mfx xxxx", 8, 1, pFile);
+                nPos += 8;
+                uint32_t nStartOfBlock = nPos;
+                nPos += fileWrite8(nBank, pFile);
+                nPos += fileWrite8(nSequence, pFile);
+                nPos += fileWrite8(nTrack, pFile);
+                nPos += fileWrite8('\0', pFile);
+                for (uint8_t nParam = 0; nParam < MIDIFX_PARAMS; ++nParam) {
+                    nPos += fileWrite8(nParam, pFile);
+                    nPos += fileWrite8('\0', pFile);
+                    nPos += fileWrite16(pMidiFx->getParam(nParam), pFile);
+                }
+                nBlockSize = nPos - nStartOfBlock;
+                fseek(pFile, nStartOfBlock - 4, SEEK_SET);
+                fileWrite32(nBlockSize, pFile);
+                fseek(pFile, 0, SEEK_END);
+            }
+        }
+    }
+
+    // Sequence follow actions
+    for (uint32_t nBank = 1; nBank < g_seqMan.getBanks(); ++nBank) {
+        for (uint32_t nSequence = 0; nSequence < g_seqMan.getSequencesInBank(nBank); ++nSequence) {
+            Sequence* pSequence = g_seqMan.getSequence(nBank, nSequence);
+            if (pSequence->getFollowAction() == FOLLOW_NONE && pSequence->getFollowTargets() == 0)
+                continue;
+            fwrite("flowxxxx", 8, 1, pFile);
+            nPos += 8;
+            uint32_t nStartOfBlock = nPos;
+            nPos += fileWrite8(nBank, pFile);
+            nPos += fileWrite8(nSequence, pFile);
+            nPos += fileWrite8(pSequence->getFollowAction(), pFile);
+            nPos += fileWrite8(pSequence->getFollowStop(), pFile);
+            nPos += fileWrite16(pSequence->getFollowLoops(), pFile);
+            nPos += fileWrite16('\0', pFile);
+            for (uint8_t nTarget = 0; nTarget < pSequence->getFollowTargets(); ++nTarget) {
+                FOLLOW_TARGET* pTarget = pSequence->getFollowTarget(nTarget);
+                nPos += fileWrite8(pTarget->bank, pFile);
+                nPos += fileWrite8(pTarget->sequence, pFile);
+                nPos += fileWrite8(pTarget->weight, pFile);
+                nPos += fileWrite8('\0', pFile);
+            }
+            nBlockSize = nPos - nStartOfBlock;
+            fseek(pFile, nStartOfBlock - 4, SEEK_SET);
+            fileWrite32(nBlockSize, pFile);
+            fseek(pFile, 0, SEEK_END);
+        }
+    }
+
+    // Arrangement
+    if (g_arrangement.isEnabled() || g_arrangement.getEventQuant()) {
+        fwrite("arngxxxx", 8, 1, pFile);
+        nPos += 8;
+        uint32_t nStartOfBlock = nPos;
+        nPos += fileWrite8(g_arrangement.isEnabled(), pFile);
+        nPos += fileWrite8('\0', pFile);
+        for (uint32_t nIndex = 0; nIndex < g_arrangement.getEventQuant(); ++nIndex) {
+            ArrangementEvent* pEvent = g_arrangement.getEvent(nIndex);
+            nPos += fileWrite16(pEvent->bar, pFile);
+            nPos += fileWrite8(pEvent->type, pFile);
+            nPos += fileWrite8('\0', pFile);
+            nPos += fileWrite32(pEvent->tick, pFile);
+            nPos += fileWrite32(pEvent->value, pFile);
+        }
+        nBlockSize = nPos - nStartOfBlock;
+        fseek(pFile, nStartOfBlock - 4, SEEK_SET);
+        fileWrite32(nBlockSize, pFile);
+        fseek(pFile, 0, SEEK_END);
+    }
+
     fclose(pFile);
     g_bDirty = false;
 }
@@ -1305,6 +2005,8 @@ void save_pattern(uint32_t nPattern, const char* filename) {
         nPos += fileWrite8(pEvent->getStutterDur(), pFile);
         nPos += fileWrite8(pEvent->getPlayChance(), pFile);
         nPos += fileWrite8('\0', pFile); // Pad to even block (could do at end but simplest here)
+        if (pEvent->getCommand() == MIDI_SYSEX_START)
+            nPos += fileWriteEventData(pFile, pPattern, pEvent);
     }
     nBlockSize = nPos - nStartOfBlock;
     fseek(pFile, nStartOfBlock - 4, SEEK_SET);
@@ -1315,7 +2017,11 @@ void save_pattern(uint32_t nPattern, const char* filename) {
 
 void savePatternSnapshot() { g_seqMan.getPattern(g_nPattern)->saveSnapshot(); }
 
-void resetPatternSnapshots() { g_seqMan.getPattern(g_nPattern)->resetSnapshots(); }
+void resetPatternSnapshots() {
+    getMutex(); // Payload pool is compacted
+    g_seqMan.getPattern(g_nPattern)->resetSnapshots();
+    releaseMutex();
+}
 
 bool undoPattern() { return g_seqMan.getPattern(g_nPattern)->undo(); }
 
@@ -1343,26 +2049,23 @@ void setHorizontalZoom(uint16_t zoom) { g_nHorizontalZoom = zoom; }
 
 // Schedule a MIDI message to be sent in next JACK process cycle
 void sendMidiMsg(MIDI_MESSAGE* pMsg) {
-    // Find first available time slot
-    uint32_t time = jack_frames_since_cycle_start(g_pJackClient);
+    // Schedule at start of next period - current period may already have been processed
+    uint64_t time = g_nFrameTime + g_nPeriodFrames;
     while (g_bMutex)
         std::this_thread::sleep_for(std::chrono::milliseconds(1));
     g_bMutex = true;
-    g_mSchedule.insert(std::pair<uint32_t, MIDI_MESSAGE*>(time, pMsg));
+    g_mSchedule.insert(std::pair<uint64_t, MIDI_MESSAGE*>(time, pMsg));
     g_bMutex = false;
 }
 
 // Schedule a note off event after 'duration' ms
 void noteOffTimer(uint8_t note, uint8_t channel, uint32_t duration) {
     std::this_thread::sleep_for(std::chrono::milliseconds(duration));
-    MIDI_MESSAGE* pMsg = new MIDI_MESSAGE;
-    pMsg->command      = MIDI_NOTE_OFF | (channel & 0x0F);
-    pMsg->value1       = note;
-    pMsg->value2       = 0;
-    sendMidiMsg(pMsg);
+    sendMidiCommand(MIDI_NOTE_OFF | (channel & 0x0F), note, 0); // Recorded when sent so replay does not depend on timer
 }
 
 void playNote(uint8_t note, uint8_t velocity, uint8_t channel, uint32_t duration) {
+    CAPTURE_API(playNote, note, velocity, channel, duration);
     if (note > 127 || velocity > 127 || channel > 15 || duration > 60000)
         return;
     MIDI_MESSAGE* pMsg = new MIDI_MESSAGE;
@@ -1370,7 +2073,7 @@ void playNote(uint8_t note, uint8_t velocity, uint8_t channel, uint32_t duration
     pMsg->value1       = note;
     pMsg->value2       = velocity;
     sendMidiMsg(pMsg);
-    if (duration) {
+    if (duration && !replayIsRunning()) {
         std::thread noteOffThread(noteOffTimer, note, channel, duration);
         noteOffThread.detach();
     }
@@ -1379,6 +2082,7 @@ void playNote(uint8_t note, uint8_t velocity, uint8_t channel, uint32_t duration
 //!@todo Do we still need functions to send MIDI transport control (start, stop, continuew, songpos, song select, clock)?
 
 void sendMidiStart() {
+    CAPTURE_API(sendMidiStart);
     MIDI_MESSAGE* pMsg = new MIDI_MESSAGE;
     pMsg->command      = MIDI_START;
     sendMidiMsg(pMsg);
@@ -1386,18 +2090,21 @@ void sendMidiStart() {
 }
 
 void sendMidiStop() {
+    CAPTURE_API(sendMidiStop);
     MIDI_MESSAGE* pMsg = new MIDI_MESSAGE;
     pMsg->command      = MIDI_STOP;
     sendMidiMsg(pMsg);
 }
 
 void sendMidiContinue() {
+    CAPTURE_API(sendMidiContinue);
     MIDI_MESSAGE* pMsg = new MIDI_MESSAGE;
     pMsg->command      = MIDI_CONTINUE;
     sendMidiMsg(pMsg);
 }
 
 void sendMidiSongPos(uint16_t pos) {
+    CAPTURE_API(sendMidiSongPos, pos);
     MIDI_MESSAGE* pMsg = new MIDI_MESSAGE;
     pMsg->command      = MIDI_POSITION;
     pMsg->value1       = pos & 0x7F;
@@ -1406,6 +2113,7 @@ void sendMidiSongPos(uint16_t pos) {
 }
 
 void sendMidiSong(uint32_t pos) {
+    CAPTURE_API(sendMidiSong, pos);
     if (pos > 127)
         return;
     MIDI_MESSAGE* pMsg = new MIDI_MESSAGE;
@@ -1415,12 +2123,14 @@ void sendMidiSong(uint32_t pos) {
 }
 
 void sendMidiClock() {
+    CAPTURE_API(sendMidiClock);
     MIDI_MESSAGE* pMsg = new MIDI_MESSAGE;
     pMsg->command      = MIDI_CLOCK;
     sendMidiMsg(pMsg);
 }
 
 void sendMidiCommand(uint8_t status, uint8_t value1, uint8_t value2) {
+    CAPTURE_API(sendMidiCommand, status, value1, value2);
     MIDI_MESSAGE* pMsg = new MIDI_MESSAGE;
     pMsg->command      = status;
     pMsg->value1       = value1;
@@ -1430,11 +2140,84 @@ void sendMidiCommand(uint8_t status, uint8_t value1, uint8_t value2) {
 
 uint8_t getMidiClockOutput() { return g_bSendMidiClock; }
 
-void setMidiClockOutput(bool enable) { g_bSendMidiClock = enable; }
+void setMidiClockOutput(bool enable) {
+    CAPTURE_API(setMidiClockOutput, enable);
+    g_bSendMidiClock = enable;
+}
+
+float getMidiClockLatency() { return g_fMidiClockLatency; }
+
+void setMidiClockLatency(float latency) {
+    CAPTURE_API(setMidiClockLatency, latency);
+    if (latency < -100.0 || latency > 100.0)
+        return;
+    g_fMidiClockLatency = latency;
+    g_midiClock.setLatency(latency * g_nSampleRate / 1000);
+}
+
+uint8_t getMidiClockRamp() { return g_midiClock.getRamp(); }
+
+void setMidiClockRamp(uint8_t pulses) {
+    CAPTURE_API(setMidiClockRamp, pulses);
+    g_midiClock.setRamp(pulses);
+}
+
+float getMidiClockJitter(bool peak) { return g_midiClock.getJitter(peak) * 1000000 / g_nSampleRate; }
+
+void resetMidiClockJitter() { g_midiClock.resetJitter(); }
+
+void setSyncOutput(uint8_t ppqn) {
+    CAPTURE_API(setSyncOutput, ppqn);
+    getMutex();
+    g_analogClock.setOutputPpqn(ppqn);
+    releaseMutex();
+}
+
+uint8_t getSyncOutput() { return g_analogClock.getOutputPpqn(); }
+
+void setSyncPulseWidth(float width) {
+    CAPTURE_API(setSyncPulseWidth, width);
+    if (width < 0.1 || width > 100.0)
+        return;
+    g_fSyncPulseWidth = width;
+    getMutex();
+    g_analogClock.setPulseWidth(width * g_nSampleRate / 1000);
+    releaseMutex();
+}
+
+float getSyncPulseWidth() { return g_fSyncPulseWidth; }
+
+void setSyncInput(uint8_t ppqn) {
+    CAPTURE_API(setSyncInput, ppqn);
+    getMutex();
+    g_analogClock.setInputPpqn(ppqn);
+    releaseMutex();
+}
+
+uint8_t getSyncInput() { return g_analogClock.getInputPpqn(); }
+
+void setSyncThreshold(float level) {
+    CAPTURE_API(setSyncThreshold, level);
+    getMutex();
+    g_analogClock.setThreshold(level);
+    releaseMutex();
+}
+
+float getSyncThreshold() { return g_analogClock.getThreshold(); }
+
+void setSyncEdge(uint8_t edge) {
+    CAPTURE_API(setSyncEdge, edge);
+    getMutex();
+    g_analogClock.setEdge(edge);
+    releaseMutex();
+}
+
+uint8_t getSyncEdge() { return g_analogClock.getEdge(); }
 
 uint8_t getTriggerDevice() { return g_seqMan.getTriggerDevice(); }
 
 void setTriggerDevice(uint8_t idev) {
+    CAPTURE_API(setTriggerDevice, idev);
     g_seqMan.setTriggerDevice(idev);
     g_bDirty = true;
 }
@@ -1442,6 +2225,7 @@ void setTriggerDevice(uint8_t idev) {
 uint8_t getTriggerChannel() { return g_seqMan.getTriggerChannel(); }
 
 void setTriggerChannel(uint8_t channel) {
+    CAPTURE_API(setTriggerChannel, channel);
     g_seqMan.setTriggerChannel(channel);
     g_bDirty = true;
 }
@@ -1449,6 +2233,7 @@ void setTriggerChannel(uint8_t channel) {
 uint8_t getTriggerNote(uint8_t bank, uint8_t sequence) { return g_seqMan.getTriggerNote(bank, sequence); }
 
 void setTriggerNote(uint8_t bank, uint8_t sequence, uint8_t note) {
+    CAPTURE_API(setTriggerNote, bank, sequence, note);
     g_seqMan.setTriggerNote(bank, sequence, note);
     g_bDirty = true;
 }
@@ -1457,11 +2242,18 @@ uint16_t getTriggerSequence(uint8_t note) { return g_seqMan.getTriggerSequence(n
 
 // ** Pattern management functions **
 
-uint32_t createPattern() { return g_seqMan.createPattern(); }
+uint32_t createPattern() {
+    CAPTURE_API(createPattern);
+    return g_seqMan.createPattern();
+}
 
-void cleanPatterns() { g_seqMan.cleanPatterns(); }
+void cleanPatterns() {
+    CAPTURE_API(cleanPatterns);
+    g_seqMan.cleanPatterns();
+}
 
 void toggleMute(uint8_t bank, uint8_t sequence, uint32_t track) {
+    CAPTURE_API(toggleMute, bank, sequence, track);
     Track* pTrack = g_seqMan.getSequence(bank, sequence)->getTrack(track);
     if (pTrack)
         pTrack->mute(!pTrack->isMuted());
@@ -1474,11 +2266,15 @@ bool isMuted(uint8_t bank, uint8_t sequence, uint32_t track) {
     return false;
 }
 
-void enableMidiRecord(bool enable) { g_bMidiRecord = enable; }
+void enableMidiRecord(bool enable) {
+    CAPTURE_API(enableMidiRecord, enable);
+    g_bMidiRecord = enable;
+}
 
 bool isMidiRecord() { return g_bMidiRecord; }
 
 void selectPattern(uint32_t pattern) {
+    CAPTURE_API(selectPattern, pattern);
     g_nPattern = pattern;
     setPatternModified(g_seqMan.getPattern(g_nPattern), true, true);
     addPattern(0, 0, 0, 0, g_nPattern, true);
@@ -1512,6 +2308,7 @@ uint32_t getBeatsInPattern() {
 }
 
 void setBeatsInPattern(uint32_t beats) {
+    CAPTURE_API(setBeatsInPattern, beats);
     if (!g_seqMan.getPattern(g_nPattern))
         return;
     g_seqMan.getPattern(g_nPattern)->setBeatsInPattern(beats);
@@ -1533,6 +2330,7 @@ uint32_t getStepsPerBeat() {
 }
 
 void setStepsPerBeat(uint32_t steps) {
+    CAPTURE_API(setStepsPerBeat, steps);
     if (!g_seqMan.getPattern(g_nPattern))
         return;
     g_seqMan.getPattern(g_nPattern)->setStepsPerBeat(steps);
@@ -1547,6 +2345,7 @@ uint32_t getSwingDiv() {
 }
 
 void setSwingDiv(uint32_t div) {
+    CAPTURE_API(setSwingDiv, div);
     if (!g_seqMan.getPattern(g_nPattern))
         return;
     g_seqMan.getPattern(g_nPattern)->setSwingDiv(div);
@@ -1561,6 +2360,7 @@ float getSwingAmount() {
 }
 
 void setSwingAmount(float amount) {
+    CAPTURE_API(setSwingAmount, amount);
     if (!g_seqMan.getPattern(g_nPattern))
         return;
     g_seqMan.getPattern(g_nPattern)->setSwingAmount(amount);
@@ -1575,6 +2375,7 @@ float getHumanTime() {
 }
 
 void setHumanTime(float amount) {
+    CAPTURE_API(setHumanTime, amount);
     if (!g_seqMan.getPattern(g_nPattern))
         return;
     g_seqMan.getPattern(g_nPattern)->setHumanTime(amount);
@@ -1589,6 +2390,7 @@ float getHumanVelo() {
 }
 
 void setHumanVelo(float amount) {
+    CAPTURE_API(setHumanVelo, amount);
     if (!g_seqMan.getPattern(g_nPattern))
         return;
     g_seqMan.getPattern(g_nPattern)->setHumanVelo(amount);
@@ -1603,6 +2405,7 @@ float getPlayChance() {
 }
 
 void setPlayChance(float chance) {
+    CAPTURE_API(setPlayChance, chance);
     if (!g_seqMan.getPattern(g_nPattern))
         return;
     g_seqMan.getPattern(g_nPattern)->setPlayChance(chance);
@@ -1611,6 +2414,7 @@ void setPlayChance(float chance) {
 }
 
 bool addNote(uint32_t step, uint8_t note, uint8_t velocity, float duration, float offset) {
+    CAPTURE_API(addNote, step, note, velocity, duration, offset);
     if (!g_seqMan.getPattern(g_nPattern))
         return false;
     if (g_seqMan.getPattern(g_nPattern)->addNote(step, note, velocity, duration, offset)) {
@@ -1622,6 +2426,7 @@ bool addNote(uint32_t step, uint8_t note, uint8_t velocity, float duration, floa
 }
 
 void removeNote(uint32_t step, uint8_t note) {
+    CAPTURE_API(removeNote, step, note);
     if (!g_seqMan.getPattern(g_nPattern))
         return;
     setPatternModified(g_seqMan.getPattern(g_nPattern), true, false);
@@ -1642,6 +2447,7 @@ uint8_t getNoteVelocity(uint32_t step, uint8_t note) {
 }
 
 void setNoteVelocity(uint32_t step, uint8_t note, uint8_t velocity) {
+    CAPTURE_API(setNoteVelocity, step, note, velocity);
     if (!g_seqMan.getPattern(g_nPattern))
         return;
     setPatternModified(g_seqMan.getPattern(g_nPattern), true, false);
@@ -1656,6 +2462,7 @@ float getNoteOffset(uint32_t step, uint8_t note) {
 }
 
 void setNoteOffset(uint32_t step, uint8_t note, float offset) {
+    CAPTURE_API(setNoteOffset, step, note, offset);
     if (!g_seqMan.getPattern(g_nPattern))
         return;
     setPatternModified(g_seqMan.getPattern(g_nPattern), true, false);
@@ -1670,6 +2477,7 @@ uint8_t getStutterCount(uint32_t step, uint8_t note) {
 }
 
 void setStutterCount(uint32_t step, uint8_t note, uint8_t count) {
+    CAPTURE_API(setStutterCount, step, note, count);
     if (!g_seqMan.getPattern(g_nPattern))
         return;
     setPatternModified(g_seqMan.getPattern(g_nPattern), true, false);
@@ -1684,6 +2492,7 @@ uint8_t getStutterDur(uint32_t step, uint8_t note) {
 }
 
 void setStutterDur(uint32_t step, uint8_t note, uint8_t dur) {
+    CAPTURE_API(setStutterDur, step, note, dur);
     if (!g_seqMan.getPattern(g_nPattern))
         return;
     setPatternModified(g_seqMan.getPattern(g_nPattern), true, false);
@@ -1698,6 +2507,7 @@ uint8_t getNotePlayChance(uint32_t step, uint8_t note) {
 }
 
 void setNotePlayChance(uint32_t step, uint8_t note, uint8_t chance) {
+    CAPTURE_API(setNotePlayChance, step, note, chance);
     if (!g_seqMan.getPattern(g_nPattern))
         return;
     setPatternModified(g_seqMan.getPattern(g_nPattern), true, false);
@@ -1712,6 +2522,7 @@ float getNoteDuration(uint32_t step, uint8_t note) {
 }
 
 bool addProgramChange(uint32_t step, uint8_t program) {
+    CAPTURE_API(addProgramChange, step, program);
     if (!g_seqMan.getPattern(g_nPattern))
         return false;
     if (g_seqMan.getPattern(g_nPattern)->addProgramChange(step, program)) {
@@ -1723,6 +2534,7 @@ bool addProgramChange(uint32_t step, uint8_t program) {
 }
 
 void removeProgramChange(uint32_t step, uint8_t program) {
+    CAPTURE_API(removeProgramChange, step, program);
     if (!g_seqMan.getPattern(g_nPattern))
         return;
     if (g_seqMan.getPattern(g_nPattern)->removeProgramChange(step))
@@ -1737,7 +2549,49 @@ uint8_t getProgramChange(uint32_t step) {
     return 0xFF;
 }
 
+bool addSysex(uint32_t step, const uint8_t* data, uint16_t size) {
+    CAPTURE_API(addSysex, step, CaptureBlob{data, size}, size);
+    Pattern* pPattern = g_seqMan.getPattern(g_nPattern);
+    if (!pPattern)
+        return false;
+    getMutex(); // Pattern's payload pool may move whilst growing
+    bool bResult = pPattern->addSysex(step, data, size);
+    releaseMutex();
+    if (bResult) {
+        setPatternModified(pPattern, true, false);
+        g_bDirty = true;
+    }
+    return bResult;
+}
+
+bool removeSysex(uint32_t step) {
+    CAPTURE_API(removeSysex, step);
+    Pattern* pPattern = g_seqMan.getPattern(g_nPattern);
+    if (!pPattern)
+        return false;
+    getMutex();
+    bool bResult = pPattern->removeSysex(step);
+    releaseMutex();
+    if (bResult) {
+        setPatternModified(pPattern, true, false);
+        g_bDirty = true;
+    }
+    return bResult;
+}
+
+uint16_t getSysex(uint32_t step, uint8_t* data, uint16_t size) {
+    Pattern* pPattern = g_seqMan.getPattern(g_nPattern);
+    if (!pPattern)
+        return 0;
+    uint16_t nSize       = 0;
+    const uint8_t* pData = pPattern->getSysex(step, &nSize);
+    if (pData && data)
+        memcpy(data, pData, std::min(nSize, size));
+    return nSize;
+}
+
 void transpose(int8_t value) {
+    CAPTURE_API(transpose, value);
     if (!g_seqMan.getPattern(g_nPattern))
         return;
     setPatternModified(g_seqMan.getPattern(g_nPattern), true, false);
@@ -1746,6 +2600,7 @@ void transpose(int8_t value) {
 }
 
 void changeVelocityAll(int value) {
+    CAPTURE_API(changeVelocityAll, value);
     if (!g_seqMan.getPattern(g_nPattern))
         return;
     setPatternModified(g_seqMan.getPattern(g_nPattern), true, false);
@@ -1754,6 +2609,7 @@ void changeVelocityAll(int value) {
 }
 
 void changeDurationAll(float value) {
+    CAPTURE_API(changeDurationAll, value);
     if (!g_seqMan.getPattern(g_nPattern))
         return;
     setPatternModified(g_seqMan.getPattern(g_nPattern), true, false);
@@ -1762,6 +2618,7 @@ void changeDurationAll(float value) {
 }
 
 void changeStutterCountAll(int value) {
+    CAPTURE_API(changeStutterCountAll, value);
     if (!g_seqMan.getPattern(g_nPattern))
         return;
     setPatternModified(g_seqMan.getPattern(g_nPattern), true, false);
@@ -1770,6 +2627,7 @@ void changeStutterCountAll(int value) {
 }
 
 void changeStutterDurAll(int value) {
+    CAPTURE_API(changeStutterDurAll, value);
     if (!g_seqMan.getPattern(g_nPattern))
         return;
     setPatternModified(g_seqMan.getPattern(g_nPattern), true, false);
@@ -1778,6 +2636,7 @@ void changeStutterDurAll(int value) {
 }
 
 void clear() {
+    CAPTURE_API(clear);
     if (!g_seqMan.getPattern(g_nPattern))
         return;
     setPatternModified(g_seqMan.getPattern(g_nPattern), true, false);
@@ -1787,11 +2646,15 @@ void clear() {
 }
 
 void copyPattern(uint32_t source, uint32_t destination) {
+    CAPTURE_API(copyPattern, source, destination);
+    getMutex(); // Destination pattern's events and payload pool are replaced
     g_seqMan.copyPattern(source, destination);
+    releaseMutex();
     g_bDirty = true;
 }
 
 void setInputRest(uint8_t note) {
+    CAPTURE_API(setInputRest, note);
     if (note > 127)
         g_nInputRest = 0xFF;
     g_nInputRest = note;
@@ -1801,6 +2664,7 @@ void setInputRest(uint8_t note) {
 uint8_t getInputRest() { return g_nInputRest; }
 
 void setScale(uint32_t scale) {
+    CAPTURE_API(setScale, scale);
     if (!g_seqMan.getPattern(g_nPattern))
         return;
     if (scale != g_seqMan.getPattern(g_nPattern)->getScale())
@@ -1815,6 +2679,7 @@ uint32_t getScale() {
 }
 
 void setTonic(uint8_t tonic) {
+    CAPTURE_API(setTonic, tonic);
     if (!g_seqMan.getPattern(g_nPattern))
         return;
     g_seqMan.getPattern(g_nPattern)->setTonic(tonic);
@@ -1867,6 +2732,7 @@ uint8_t getRefNote() {
 }
 
 void setRefNote(uint8_t note) {
+    CAPTURE_API(setRefNote, note);
     if (g_seqMan.getPattern(g_nPattern))
         g_seqMan.getPattern(g_nPattern)->setRefNote(note);
 }
@@ -1878,6 +2744,7 @@ bool getQuantizeNotes() {
 }
 
 void setQuantizeNotes(bool flag) {
+    CAPTURE_API(setQuantizeNotes, flag);
     if (g_seqMan.getPattern(g_nPattern))
         g_seqMan.getPattern(g_nPattern)->setQuantizeNotes(flag);
 }
@@ -1897,6 +2764,7 @@ uint32_t getPatternPlayhead() {
 // ** Sequence management functions **
 
 bool addPattern(uint8_t bank, uint8_t sequence, uint32_t track, uint32_t position, uint32_t pattern, bool force) {
+    CAPTURE_API(addPattern, bank, sequence, track, position, pattern, force);
     bool bUpdated = g_seqMan.addPattern(bank, sequence, track, position, pattern, force);
     if (bank + sequence)
         g_bDirty |= bUpdated;
@@ -1904,6 +2772,7 @@ bool addPattern(uint8_t bank, uint8_t sequence, uint32_t track, uint32_t positio
 }
 
 void removePattern(uint8_t bank, uint8_t sequence, uint32_t track, uint32_t position) {
+    CAPTURE_API(removePattern, bank, sequence, track, position);
     g_seqMan.removePattern(bank, sequence, track, position);
     g_bDirty = true;
 }
@@ -1934,6 +2803,7 @@ uint8_t getPlayMode(uint8_t bank, uint8_t sequence) {
 }
 
 void setPlayMode(uint8_t bank, uint8_t sequence, uint8_t mode) {
+    CAPTURE_API(setPlayMode, bank, sequence, mode);
     Sequence* pSequence = g_seqMan.getSequence(bank, sequence);
     pSequence->setPlayMode(mode);
     if (bank + sequence)
@@ -1945,6 +2815,7 @@ uint8_t getPlayState(uint8_t bank, uint8_t sequence) { return g_seqMan.getSequen
 bool isEmpty(uint8_t bank, uint8_t sequence) { return g_seqMan.getSequence(bank, sequence)->isEmpty(); }
 
 void setPlayState(uint8_t bank, uint8_t sequence, uint8_t state) {
+    CAPTURE_API(setPlayState, bank, sequence, state);
     if (transportGetPlayStatus() != JackTransportRolling) {
         if (state == STARTING) {
             setTransportToStartOfBar();
@@ -1968,6 +2839,7 @@ void setPlayState(uint8_t bank, uint8_t sequence, uint8_t state) {
 }
 
 void togglePlayState(uint8_t bank, uint8_t sequence) {
+    CAPTURE_API(togglePlayState, bank, sequence);
     if (g_seqMan.getSequence(bank, sequence)->getPlayMode() == DISABLED)
         return;
     uint8_t nState = g_seqMan.getSequence(bank, sequence)->getPlayState();
@@ -2013,7 +2885,10 @@ uint8_t getProgress(uint8_t bank, uint8_t start, uint8_t end, uint16_t* progress
     return count;
 }
 
-void stop() { g_seqMan.stop(); }
+void stop() {
+    CAPTURE_API(stop);
+    g_seqMan.stop();
+}
 
 uint32_t getPlayPosition(uint8_t bank, uint8_t sequence) {
     Sequence* pSequence = g_seqMan.getSequence(bank, sequence);
@@ -2021,6 +2896,7 @@ uint32_t getPlayPosition(uint8_t bank, uint8_t sequence) {
 }
 
 void setPlayPosition(uint8_t bank, uint8_t sequence, uint32_t clock) {
+    CAPTURE_API(setPlayPosition, bank, sequence, clock);
     Sequence* pSequence = g_seqMan.getSequence(bank, sequence);
     pSequence->setPlayPosition(clock);
 }
@@ -2028,6 +2904,7 @@ void setPlayPosition(uint8_t bank, uint8_t sequence, uint32_t clock) {
 uint32_t getSequenceLength(uint8_t bank, uint8_t sequence) { return g_seqMan.getSequence(bank, sequence)->getLength(); }
 
 void clearSequence(uint8_t bank, uint8_t sequence) {
+    CAPTURE_API(clearSequence, bank, sequence);
     Sequence* pSequence = g_seqMan.getSequence(bank, sequence);
     pSequence->clear();
     g_bDirty = true;
@@ -2036,6 +2913,7 @@ void clearSequence(uint8_t bank, uint8_t sequence) {
 size_t getPlayingSequences() { return g_nPlayingSequences; }
 
 void setSequencesInBank(uint8_t bank, uint8_t sequences) {
+    CAPTURE_API(setSequencesInBank, bank, sequences);
     while (g_bMutex)
         std::this_thread::sleep_for(std::chrono::microseconds(10));
     g_bMutex = true;
@@ -2046,7 +2924,10 @@ void setSequencesInBank(uint8_t bank, uint8_t sequences) {
 
 uint32_t getSequencesInBank(uint32_t bank) { return g_seqMan.getSequencesInBank(bank); }
 
-void clearBank(uint32_t bank) { g_seqMan.clearBank(bank); }
+void clearBank(uint32_t bank) {
+    CAPTURE_API(clearBank, bank);
+    g_seqMan.clearBank(bank);
+}
 
 // ** Sequence management functions **
 
@@ -2056,19 +2937,74 @@ uint8_t getGroup(uint8_t bank, uint8_t sequence) {
 }
 
 void setGroup(uint8_t bank, uint8_t sequence, uint8_t group) {
+    CAPTURE_API(setGroup, bank, sequence, group);
     Sequence* pSequence = g_seqMan.getSequence(bank, sequence);
     return pSequence->setGroup(group);
     g_bDirty = true;
 }
 
+void setFollowAction(uint8_t bank, uint8_t sequence, uint8_t action, uint16_t loops, bool stop) {
+    CAPTURE_API(setFollowAction, bank, sequence, action, loops, stop);
+    Sequence* pSequence = g_seqMan.getSequence(bank, sequence);
+    getMutex();
+    pSequence->setFollowAction(action, loops, stop);
+    releaseMutex();
+    g_bDirty = true;
+}
+
+uint8_t getFollowAction(uint8_t bank, uint8_t sequence) { return g_seqMan.getSequence(bank, sequence)->getFollowAction(); }
+
+uint16_t getFollowLoops(uint8_t bank, uint8_t sequence) { return g_seqMan.getSequence(bank, sequence)->getFollowLoops(); }
+
+bool getFollowStop(uint8_t bank, uint8_t sequence) { return g_seqMan.getSequence(bank, sequence)->getFollowStop(); }
+
+bool addFollowTarget(uint8_t bank, uint8_t sequence, uint8_t targetBank, uint8_t targetSequence, uint8_t weight) {
+    CAPTURE_API(addFollowTarget, bank, sequence, targetBank, targetSequence, weight);
+    Sequence* pSequence = g_seqMan.getSequence(bank, sequence);
+    getMutex();
+    g_seqMan.getSequence(targetBank, targetSequence); // Create target here so that audio thread does not allocate it
+    bool bResult = pSequence->addFollowTarget(targetBank, targetSequence, weight);
+    releaseMutex();
+    if (bResult)
+        g_bDirty = true;
+    return bResult;
+}
+
+void clearFollowTargets(uint8_t bank, uint8_t sequence) {
+    CAPTURE_API(clearFollowTargets, bank, sequence);
+    Sequence* pSequence = g_seqMan.getSequence(bank, sequence);
+    getMutex();
+    pSequence->clearFollowTargets();
+    releaseMutex();
+    g_bDirty = true;
+}
+
+uint8_t getFollowTargets(uint8_t bank, uint8_t sequence) { return g_seqMan.getSequence(bank, sequence)->getFollowTargets(); }
+
+uint16_t getFollowTarget(uint8_t bank, uint8_t sequence, uint8_t index) {
+    FOLLOW_TARGET* pTarget = g_seqMan.getSequence(bank, sequence)->getFollowTarget(index);
+    if (!pTarget)
+        return 0xFFFF;
+    return (pTarget->bank << 8) | pTarget->sequence;
+}
+
+uint8_t getFollowTargetWeight(uint8_t bank, uint8_t sequence, uint8_t index) {
+    FOLLOW_TARGET* pTarget = g_seqMan.getSequence(bank, sequence)->getFollowTarget(index);
+    if (!pTarget)
+        return 0;
+    return pTarget->weight;
+}
+
 bool hasSequenceChanged(uint8_t bank, uint8_t sequence) { return g_seqMan.getSequence(bank, sequence)->isModified(); }
 
 uint32_t addTrackToSequence(uint8_t bank, uint8_t sequence, uint32_t track) {
+    CAPTURE_API(addTrackToSequence, bank, sequence, track);
     g_bDirty = true;
     return g_seqMan.getSequence(bank, sequence)->addTrack(track);
 }
 
 void removeTrackFromSequence(uint8_t bank, uint8_t sequence, uint32_t track) {
+    CAPTURE_API(removeTrackFromSequence, bank, sequence, track);
     Sequence* pSequence = g_seqMan.getSequence(bank, sequence);
     if (!pSequence->removeTrack(track))
         return;
@@ -2077,6 +3013,7 @@ void removeTrackFromSequence(uint8_t bank, uint8_t sequence, uint32_t track) {
 }
 
 void addTempoEvent(uint8_t bank, uint8_t sequence, uint32_t tempo, uint16_t bar, uint16_t tick) {
+    CAPTURE_API(addTempoEvent, bank, sequence, tempo, bar, tick);
     //!@todo Concert tempo events to use double for tempo value
     g_seqMan.getSequence(bank, sequence)->addTempo(tempo, bar, tick);
     g_bDirty = true;
@@ -2085,6 +3022,7 @@ void addTempoEvent(uint8_t bank, uint8_t sequence, uint32_t tempo, uint16_t bar,
 uint32_t getTempoAt(uint8_t bank, uint8_t sequence, uint16_t bar, uint16_t tick) { return g_seqMan.getSequence(bank, sequence)->getTempo(bar, tick); }
 
 void addTimeSigEvent(uint8_t bank, uint8_t sequence, uint8_t beats, uint8_t type, uint16_t bar) {
+    CAPTURE_API(addTimeSigEvent, bank, sequence, beats, type, bar);
     if (bar < 1)
         bar = 1;
     g_seqMan.getSequence(bank, sequence)->addTimeSig((beats << 8) | type, bar);
@@ -2097,7 +3035,10 @@ uint8_t getBeatsPerBar(uint8_t bank, uint8_t sequence, uint16_t bar) { return ge
 
 uint32_t getTracksInSequence(uint8_t bank, uint8_t sequence) { return g_seqMan.getSequence(bank, sequence)->getTracks(); }
 
-void setSequence(uint8_t bank, uint8_t sequence) { g_pSequence = g_seqMan.getSequence(bank, sequence); }
+void setSequence(uint8_t bank, uint8_t sequence) {
+    CAPTURE_API(setSequence, bank, sequence);
+    g_pSequence = g_seqMan.getSequence(bank, sequence);
+}
 
 void setSequenceName(uint8_t bank, uint8_t sequence, const char* name) { g_seqMan.getSequence(bank, sequence)->setName(std::string(name)); }
 
@@ -2107,19 +3048,28 @@ const char* getSequenceName(uint8_t bank, uint8_t sequence) {
 }
 
 bool moveSequence(uint8_t bank, uint8_t sequence, uint8_t position) {
+    CAPTURE_API(moveSequence, bank, sequence, position);
+    getMutex(); // Audio thread clocks playing sequences by index
     bool bResult = g_seqMan.moveSequence(bank, sequence, position);
     g_pSequence  = g_seqMan.getSequence(0, 0);
+    releaseMutex();
     return bResult;
 }
 
 void insertSequence(uint8_t bank, uint8_t sequence) {
+    CAPTURE_API(insertSequence, bank, sequence);
+    getMutex(); // Audio thread clocks playing sequences by index
     g_seqMan.insertSequence(bank, sequence);
     g_pSequence = g_seqMan.getSequence(0, 0);
+    releaseMutex();
 }
 
 void removeSequence(uint8_t bank, uint8_t sequence) {
+    CAPTURE_API(removeSequence, bank, sequence);
+    getMutex(); // Audio thread clocks playing sequences by index
     g_seqMan.removeSequence(bank, sequence);
     g_pSequence = g_seqMan.getSequence(0, 0);
+    releaseMutex();
 }
 
 void updateSequenceInfo() { g_seqMan.updateAllSequenceLengths(); }
@@ -2134,6 +3084,7 @@ uint32_t getPatternsInTrack(uint8_t bank, uint8_t sequence, uint32_t track) {
 }
 
 void setTrackType(uint8_t bank, uint8_t sequence, uint32_t track, uint8_t type) {
+    CAPTURE_API(setTrackType, bank, sequence, track, type);
     Sequence* pSequence = g_seqMan.getSequence(bank, sequence);
     Track* pTrack       = pSequence->getTrack(track);
     if (!pTrack)
@@ -2151,6 +3102,7 @@ uint8_t getTrackType(uint8_t bank, uint8_t sequence, uint32_t track) {
 }
 
 void setChainID(uint8_t bank, uint8_t sequence, uint32_t track, uint8_t chain_id) {
+    CAPTURE_API(setChainID, bank, sequence, track, chain_id);
     Sequence* pSequence = g_seqMan.getSequence(bank, sequence);
     Track* pTrack       = pSequence->getTrack(track);
     if (!pTrack)
@@ -2168,6 +3120,7 @@ uint8_t getChainID(uint8_t bank, uint8_t sequence, uint32_t track) {
 }
 
 void setChannel(uint8_t bank, uint8_t sequence, uint32_t track, uint8_t channel) {
+    CAPTURE_API(setChannel, bank, sequence, track, channel);
     Sequence* pSequence = g_seqMan.getSequence(bank, sequence);
     Track* pTrack       = pSequence->getTrack(track);
     if (!pTrack)
@@ -2184,7 +3137,25 @@ uint8_t getChannel(uint8_t bank, uint8_t sequence, uint32_t track) {
     return pTrack->getChannel();
 }
 
+void setMidiFxParam(uint8_t bank, uint8_t sequence, uint32_t track, uint8_t param, int16_t value) {
+    CAPTURE_API(setMidiFxParam, bank, sequence, track, param, value);
+    Track* pTrack = g_seqMan.getSequence(bank, sequence)->getTrack(track);
+    if (!pTrack)
+        return;
+    pTrack->getMidiFx()->setParam(param, value);
+    if (bank + sequence)
+        g_bDirty = true;
+}
+
+int16_t getMidiFxParam(uint8_t bank, uint8_t sequence, uint32_t track, uint8_t param) {
+    Track* pTrack = g_seqMan.getSequence(bank, sequence)->getTrack(track);
+    if (!pTrack)
+        return 0;
+    return pTrack->getMidiFx()->getParam(param);
+}
+
 void solo(uint8_t bank, uint8_t sequence, uint32_t track, bool solo) {
+    CAPTURE_API(solo, bank, sequence, track, solo);
     Track* pTrack = g_seqMan.getSequence(bank, sequence)->getTrack(track);
     if (!pTrack)
         return;
@@ -2198,56 +3169,113 @@ bool isSolo(uint8_t bank, uint8_t sequence, uint32_t track) {
     return pTrack->isSolo();
 }
 
+// ** Arrangement management **
+
+void enableArrangement(bool enable) {
+    CAPTURE_API(enableArrangement, enable);
+    getMutex();
+    g_arrangement.enable(enable);
+    releaseMutex();
+    g_bDirty = true;
+}
+
+bool isArrangementEnabled() { return g_arrangement.isEnabled(); }
+
+void clearArrangement() {
+    CAPTURE_API(clearArrangement);
+    getMutex();
+    g_arrangement.clear();
+    releaseMutex();
+    g_bDirty = true;
+}
+
+// Add arrangement event with one-based bar
+void addArrangementEvent(uint16_t bar, uint32_t tick, uint8_t type, uint32_t value) {
+    if (bar > 0)
+        --bar;
+    getMutex();
+    g_arrangement.addEvent(bar, tick, type, value);
+    releaseMutex();
+    g_bDirty = true;
+}
+
+void addArrangementLaunch(uint16_t bar, uint32_t tick, uint8_t bank, uint8_t sequence) {
+    CAPTURE_API(addArrangementLaunch, bar, tick, bank, sequence);
+    addArrangementEvent(bar, tick, ARRANGEMENT_LAUNCH, (bank << 8) | sequence);
+}
+
+void addArrangementStop(uint16_t bar, uint32_t tick, uint8_t bank, uint8_t sequence) {
+    CAPTURE_API(addArrangementStop, bar, tick, bank, sequence);
+    addArrangementEvent(bar, tick, ARRANGEMENT_STOP, (bank << 8) | sequence);
+}
+
+void addArrangementScene(uint16_t bar, uint32_t tick, uint8_t bank) {
+    CAPTURE_API(addArrangementScene, bar, tick, bank);
+    addArrangementEvent(bar, tick, ARRANGEMENT_SCENE, bank);
+}
+
+void addArrangementTempo(uint16_t bar, uint32_t tick, double tempo) {
+    CAPTURE_API(addArrangementTempo, bar, tick, tempo);
+    if (tempo >= 10.0 && tempo < 500.0)
+        addArrangementEvent(bar, tick, ARRANGEMENT_TEMPO, tempo * 100 + 0.5);
+}
+
+void addArrangementTimeSig(uint16_t bar, uint8_t beats, uint8_t type) {
+    CAPTURE_API(addArrangementTimeSig, bar, beats, type);
+    if (beats > 0)
+        addArrangementEvent(bar, 0, ARRANGEMENT_TIMESIG, (beats << 8) | type);
+}
+
+void removeArrangementEvent(uint16_t bar, uint32_t tick, uint8_t type, uint32_t value) {
+    CAPTURE_API(removeArrangementEvent, bar, tick, type, value);
+    if (bar > 0)
+        --bar;
+    getMutex();
+    g_arrangement.removeEvent(bar, tick, type, value);
+    releaseMutex();
+    g_bDirty = true;
+}
+
+uint32_t getArrangementEventCount() { return g_arrangement.getEventQuant(); }
+
+bool getArrangementEvent(uint32_t index, uint16_t* bar, uint32_t* tick, uint8_t* type, uint32_t* value) {
+    ArrangementEvent* pEvent = g_arrangement.getEvent(index);
+    if (!pEvent)
+        return false;
+    *bar   = pEvent->bar + 1;
+    *tick  = pEvent->tick;
+    *type  = pEvent->type;
+    *value = pEvent->value;
+    return true;
+}
+
+uint32_t getSongClock() { return g_nSongClock; }
+
 // ** Transport management **/
 
 void setTransportToStartOfBar() {
+    CAPTURE_API(setTransportToStartOfBar);
     jack_position_t position;
-    jack_transport_query(g_pJackClient, &position);
+    ioTransportQuery(&position);
     position.beat = 1;
     position.tick = 0;
     //    position.valid = JackPositionBBT;
-    jack_transport_reposition(g_pJackClient, &position);
+    ioTransportReposition(&position);
     //    g_pNextTimebaseEvent = g_pTimebase->getPreviousTimebaseEvent(position.bar, 1, TIMEBASE_TYPE_ANY); //!@todo Might miss event if 2 at start of bar
 }
 
-void transportLocate(uint32_t frame) { jack_transport_locate(g_pJackClient, frame); }
+void transportLocate(uint32_t frame) {
+    CAPTURE_API(transportLocate, frame);
+    ioTransportLocate(frame);
+}
 
 /*  Calculate the song position in frames from BBT
  */
 jack_nframes_t transportGetLocation(uint32_t bar, uint32_t beat, uint32_t tick) {
-    // Convert one-based bars and beats to zero-based
-    if (bar > 0)
-        --bar;
-    if (beat > 0)
-        --beat;
-    uint32_t nTicksToPrev  = 0;
-    uint32_t nTicksToEvent = 0;
-    uint32_t nTicksPerBar  = g_dTicksPerBeat * g_nBeatsPerBar;
-    //!@todo Handle changes in tempo and time signature
-    //    double dFramesPerTick = getFramesPerTick(DEFAULT_TEMPO);
-    double dFramesPerTick  = getFramesPerTick(g_dTempo);
-    double dFrames         = 0; // Frames to position
-    /*
-    if(g_pTimebase)
-    {
-        for(size_t nIndex = 0; nIndex < g_pTimebase->getEventQuant(); ++nIndex)
-        {
-            TimebaseEvent* pEvent = g_pTimebase->getEvent(nIndex);
-            if(pEvent->bar > bar || pEvent->bar == bar && pEvent->clock > (g_dTicksPerBeat * beat + tick) / g_dTicksPerBeat / PPQN)
-                break; // Ignore events later than new position
-            nTicksToEvent = pEvent->bar * nTicksPerBar + pEvent->clock * g_dTicksPerBeat / PPQN;
-            uint32_t nTicksInBlock = nTicksToEvent - nTicksToPrev;
-            dFrames += dFramesPerTick * nTicksInBlock;
-            nTicksToPrev = nTicksToEvent;
-            if(pEvent->type == TIMEBASE_TYPE_TEMPO)
-                dFramesPerTick = getFramesPerTick(pEvent->value);
-            else if(pEvent->type == TIMEBASE_TYPE_TIMESIG)
-                nTicksPerBar = g_dTicksPerBeat * (pEvent->value >> 8);
-        }
-    }
-    */
-    dFrames += dFramesPerTick * (bar * nTicksPerBar + beat * g_dTicksPerBeat + tick - nTicksToPrev);
-    return dFrames;
+    getMutex();
+    jack_nframes_t nFrame = getLocationFrame(bar, beat, tick);
+    releaseMutex();
+    return nFrame;
 }
 
 bool transportRequestTimebase() {
@@ -2259,25 +3287,26 @@ bool transportRequestTimebase() {
 void transportReleaseTimebase() { jack_release_timebase(g_pJackClient); }
 
 void transportStart(const char* client) {
+    CAPTURE_API(transportStart, client);
     if (strcmp("zynseq", client)) {
         // Not zynseq so flag other client(s) playing
         g_bClientPlaying = true;
         g_setTransportClient.emplace(client);
     }
-    jack_position_t pos;
-    if (jack_transport_query(g_pJackClient, &pos) != JackTransportRolling)
-        jack_transport_start(g_pJackClient);
+    if (ioTransportQuery(NULL) != JackTransportRolling)
+        ioTransportStart();
     if (g_nClockSource & TRANSPORT_CLOCK_INTERNAL) {
         // Send MIDI start message
-        jack_nframes_t nClockTime = g_qClockPos.front().first - jack_last_frame_time(g_pJackClient);
-        g_mSchedule.insert(std::pair<uint32_t, MIDI_MESSAGE*>(nClockTime, new MIDI_MESSAGE({MIDI_START, 0, 0})));
+        uint64_t nClockTime = g_qClockPos.empty() ? g_nFrameTime + g_nPeriodFrames : uint64_t(g_qClockPos.front().first);
+        g_mSchedule.insert(std::pair<uint64_t, MIDI_MESSAGE*>(nClockTime, new MIDI_MESSAGE({MIDI_START, 0, 0})));
     }
 }
 
 void transportStop(const char* client) {
+    CAPTURE_API(transportStop, client);
     if (strcmp(client, "ALL") == 0) {
         g_setTransportClient.clear();
-        jack_transport_stop(g_pJackClient);
+        ioTransportStop();
         return;
     }
     auto itClient = g_setTransportClient.find(std::string(client));
@@ -2285,15 +3314,16 @@ void transportStop(const char* client) {
         g_setTransportClient.erase(itClient);
     g_bClientPlaying = (g_setTransportClient.size() != 0);
     if (!g_bClientPlaying && g_nPlayingSequences == 0)
-        jack_transport_stop(g_pJackClient);
+        ioTransportStop();
     if (g_nClockSource & TRANSPORT_CLOCK_INTERNAL) {
         // Send MIDI stop message
-        jack_nframes_t nClockTime = g_qClockPos.front().first - jack_last_frame_time(g_pJackClient);
-        g_mSchedule.insert(std::pair<uint32_t, MIDI_MESSAGE*>(nClockTime, new MIDI_MESSAGE({MIDI_STOP, 0, 0})));
+        uint64_t nClockTime = g_qClockPos.empty() ? g_nFrameTime + g_nPeriodFrames : uint64_t(g_qClockPos.front().first);
+        g_mSchedule.insert(std::pair<uint64_t, MIDI_MESSAGE*>(nClockTime, new MIDI_MESSAGE({MIDI_STOP, 0, 0})));
     }
 }
 
 void transportToggle(const char* client) {
+    CAPTURE_API(transportToggle, client);
     if (transportGetPlayStatus() == JackTransportRolling)
         transportStop(client);
     else
@@ -2301,14 +3331,14 @@ void transportToggle(const char* client) {
 }
 
 uint8_t transportGetPlayStatus() {
-    jack_position_t position; // Not used but required to query transport
-    jack_transport_state_t nState;
-    return jack_transport_query(g_pJackClient, &position);
+    return ioTransportQuery(NULL);
 }
 
 void setTempo(double tempo) {
+    CAPTURE_API(setTempo, tempo);
     if (tempo >= 10.0 && tempo < 500.0) {
         g_dTempo = tempo;
+        g_arrangement.setDirty();
         if (transportGetPlayStatus() != JackTransportRolling)
             transportLocate(0); // Cludge to update transport tempo when transport not running
         g_dFramesPerClock = getFramesPerClock(g_dTempo);
@@ -2318,8 +3348,11 @@ void setTempo(double tempo) {
 double getTempo() { return g_dTempo; }
 
 void setBeatsPerBar(uint32_t beats) {
-    if (beats > 0)
+    CAPTURE_API(setBeatsPerBar, beats);
+    if (beats > 0) {
         g_nBeatsPerBar = beats;
+        g_arrangement.setDirty();
+    }
 }
 
 uint32_t getBeatsPerBar() { return g_nBeatsPerBar; }
@@ -2327,6 +3360,7 @@ uint32_t getBeatsPerBar() { return g_nBeatsPerBar; }
 void transportSetSyncTimeout(uint32_t timeout) { jack_set_sync_timeout(g_pJackClient, timeout); }
 
 void enableMetronome(bool enable) {
+    CAPTURE_API(enableMetronome, enable);
     g_bMetronome    = enable;
     g_nMetronomePtr = -1;
 }
@@ -2334,6 +3368,7 @@ void enableMetronome(bool enable) {
 bool isMetronomeEnabled() { return g_bMetronome; }
 
 void setMetronomeVolume(float level) {
+    CAPTURE_API(setMetronomeVolume, level);
     if (level > 1.0)
         level = 1.0;
     if (level < 0.0)
@@ -2346,6 +3381,7 @@ float getMetronomeVolume() { return g_fMetronomeLevel; }
 uint8_t getClockSource() { return g_nClockSource; }
 
 void setClockSource(uint8_t source) {
+    CAPTURE_API(setClockSource, source);
     if (source == 0)
         return;
     g_nClockSource = source;
@@ -2356,3 +3392,218 @@ void setClockSource(uint8_t source) {
     std::swap(g_qClockPos, qEmpty);
     g_bMutex = false;
 }
+
+bool setFeedbackPad(uint16_t pad, uint8_t bank, uint8_t sequence, uint8_t status, uint8_t note) {
+    CAPTURE_API(setFeedbackPad, pad, bank, sequence, status, note);
+    if (pad >= FEEDBACK_MAX_PADS || (status && status < 0x80) || status >= 0xF0 || note > 127)
+        return false;
+    getMutex();
+    FEEDBACK_PAD* pPad = &g_aFeedbackPads[pad];
+    pPad->bank         = bank;
+    pPad->sequence     = sequence;
+    pPad->status       = status;
+    pPad->note         = note;
+    pPad->value        = 0xFF;
+    if (status && pad >= g_nFeedbackPads)
+        g_nFeedbackPads = pad + 1;
+    releaseMutex();
+    return true;
+}
+
+void clearFeedbackPads() {
+    CAPTURE_API(clearFeedbackPads);
+    getMutex();
+    for (uint16_t nPad = 0; nPad < FEEDBACK_MAX_PADS; ++nPad)
+        g_aFeedbackPads[nPad] = FEEDBACK_PAD();
+    g_nFeedbackPads = 0;
+    g_nFeedbackNext = 0;
+    releaseMutex();
+}
+
+bool setFeedbackState(uint8_t state, uint8_t colour, uint8_t blinkColour, uint8_t blinkRate) {
+    CAPTURE_API(setFeedbackState, state, colour, blinkColour, blinkRate);
+    if (state >= FEEDBACK_STATES || colour > 127 || blinkColour > 127)
+        return false;
+    getMutex();
+    g_aFeedbackStates[state].colour      = colour;
+    g_aFeedbackStates[state].blinkColour = blinkColour;
+    g_aFeedbackStates[state].blinkRate   = blinkRate;
+    for (uint16_t nPad = 0; nPad < g_nFeedbackPads; ++nPad)
+        g_aFeedbackPads[nPad].value = 0xFF;
+    releaseMutex();
+    return true;
+}
+
+void refreshFeedback() {
+    CAPTURE_API(refreshFeedback);
+    getMutex();
+    for (uint16_t nPad = 0; nPad < g_nFeedbackPads; ++nPad)
+        g_aFeedbackPads[nPad].value = 0xFF;
+    releaseMutex();
+}
+
+void setFeedbackRate(uint16_t rate) {
+    CAPTURE_API(setFeedbackRate, rate);
+    g_nFeedbackRate = rate ? rate : 1;
+}
+
+uint16_t getFeedbackRate() { return g_nFeedbackRate; }
+
+void setParallelWorkers(uint8_t workers) {
+    int nPriority = 0;
+    if (g_pJackClient && jack_is_realtime(g_pJackClient)) {
+        nPriority = jack_client_real_time_priority(g_pJackClient);
+        if (nPriority <= 0 && workers) {
+            // Normal priority workers could be starved by the realtime process thread waiting for them
+            fprintf(stderr, "libzynseq failed to get realtime priority for worker threads - sequences will be clocked serially\n");
+            workers = 0;
+        }
+    }
+    getMutex(); // Workers and their jobs must not change whilst process thread clocks sequences
+    g_seqMan.setParallelWorkers(workers, nPriority > 0 ? nPriority : 0);
+    releaseMutex();
+}
+
+uint8_t getParallelWorkers() { return g_seqMan.getParallelWorkers(); }
+
+void setParallelThreshold(uint32_t threshold) {
+    CAPTURE_API(setParallelThreshold, threshold);
+    g_seqMan.setParallelThreshold(threshold);
+}
+
+uint32_t getParallelThreshold() { return g_seqMan.getParallelThreshold(); }
+
+MONITOR_REGION* getMonitorRegion() { return g_pMonitor; }
+
+const char* getMonitorName() { return g_monitorShm.sName; }
+
+// ** Capture and replay **
+
+// Call a captured API function during replay
+static void replayApi(uint16_t id, const uint8_t* pArgs) {
+    switch (id) {
+#define CAPTURE_API_REPLAY(fn)                                                                                                                                 \
+    case API_##fn:                                                                                                                                             \
+        replayApiCall(fn, pArgs);                                                                                                                              \
+        break;
+        CAPTURE_API_LIST(CAPTURE_API_REPLAY)
+#undef CAPTURE_API_REPLAY
+    default:
+        fprintf(stderr, "libzynseq replay ignoring unknown API call %u\n", id);
+    }
+}
+
+// Replay a process thread record - returns -1 if outputs match
+static int32_t replayRecord(uint8_t type, const void* pPayload, uint32_t nSize, bool bOverlap) {
+    if (type == CAPTURE_RECORD_STATE) {
+        RUNTIME_STATE state;
+        memcpy(&state, pPayload, sizeof(state));
+        setRuntimeState(&state);
+    } else if (type == CAPTURE_RECORD_PERIOD) {
+        const CAPTURE_PERIOD_DATA* pPeriod = (const CAPTURE_PERIOD_DATA*)pPayload;
+        if (!replaySetPeriod(pPeriod))
+            return -2;
+        onJackProcess(pPeriod->frames, NULL);
+        uint64_t nOutput, nFeedback, nMetronome, nSync;
+        replayGetPeriodHashes(&nOutput, &nFeedback, &nMetronome, &nSync);
+        if (nOutput != pPeriod->outputHash || nFeedback != pPeriod->feedbackHash || nMetronome != pPeriod->metronomeHash || nSync != pPeriod->syncHash) {
+            fprintf(stderr, "libzynseq replay: period %u differs (MIDI output %s, feedback %s, metronome %s, sync %s)\n", pPeriod->period,
+                    nOutput == pPeriod->outputHash ? "same" : "differs", nFeedback == pPeriod->feedbackHash ? "same" : "differs",
+                    nMetronome == pPeriod->metronomeHash ? "same" : "differs", nSync == pPeriod->syncHash ? "same" : "differs");
+            if (bOverlap)
+                fprintf(stderr, "libzynseq replay: an API call overlapped period %u during capture\n", pPeriod->period);
+            return pPeriod->period;
+        }
+    } else if (type == CAPTURE_RECORD_TIMEBASE) {
+        CAPTURE_TIMEBASE_DATA timebase;
+        memcpy(&timebase, pPayload, sizeof(timebase));
+        replaySetTimebase(&timebase);
+        jack_position_t position = timebase.position;
+        onJackTimebase(jack_transport_state_t(timebase.state), timebase.frames, &position, timebase.update, NULL);
+        if (replayGetTimebaseHash() != timebase.hash) {
+            fprintf(stderr, "libzynseq replay: timebase before period %u differs%s\n", timebase.period,
+                    bOverlap ? " (an API call overlapped it during capture)" : "");
+            return timebase.period;
+        }
+    }
+    return -1;
+}
+
+bool startCapture(const char* filename) {
+    if (!g_pJackClient || captureIsRunning() || replayIsRunning())
+        return false;
+    // Capture must start from idle so that sequencer state is fully described by saved file and runtime state
+    getMutex();
+    bool bBusy = ioTransportQuery(NULL) == JackTransportRolling || g_seqMan.getPlayingSequencesCount() || !g_mSchedule.empty() ||
+                 !g_setTransportClient.empty() || g_qClockPos.size() > CAPTURE_CLOCK_QUEUE;
+    releaseMutex();
+    if (bBusy) {
+        fprintf(stderr, "libzynseq cannot start capture whilst sequencer is playing\n");
+        return false;
+    }
+    bool bDirty           = g_bDirty;
+    std::string sSnapshot = std::string(filename) + ".zynseq";
+    save(sSnapshot.c_str());
+    g_bDirty     = bDirty;
+    FILE* pFile  = fopen(sSnapshot.c_str(), "r");
+    if (!pFile)
+        return false;
+    fclose(pFile);
+    // Round values that the file stores with limited precision so that live state matches the snapshot that replay will load
+    getMutex();
+    uint32_t nPattern = 0;
+    do {
+        Pattern* pPattern = g_seqMan.getPattern(nPattern);
+        if (!pPattern->getEventAt(0))
+            continue;
+        pPattern->setSwingAmount(roundBCD(pPattern->getSwingAmount()));
+        pPattern->setHumanTime(roundBCD(pPattern->getHumanTime()));
+        pPattern->setHumanVelo(roundBCD(pPattern->getHumanVelo()));
+        pPattern->setPlayChance(roundBCD(pPattern->getPlayChance()));
+        uint32_t nEvent = 0;
+        while (StepEvent* pEvent = pPattern->getEventAt(nEvent++)) {
+            pEvent->setOffset(roundBCD(pEvent->getOffset()));
+            pEvent->setDuration(roundBCD(pEvent->getDuration()));
+        }
+    } while ((nPattern = g_seqMan.getNextPattern(nPattern)) != -1);
+    releaseMutex();
+    uint32_t nSeed = std::random_device{}();
+    g_nCaptureSeed = nSeed;
+    if (!captureStart(filename, "zynseq", CAPTURE_VERSION, g_nSampleRate, nSeed, sizeof(RUNTIME_STATE)))
+        return false;
+    getMutex();
+    g_captureState.sequenceValid = g_seqMan.locateSequence(g_pSequence, &g_captureState.sequenceBank, &g_captureState.sequence);
+    g_seqMan.seedRandom(nSeed);
+    g_arrangement.setDirty(); // Compiled arrangement is not in runtime state so recompile from values that replay restores
+    g_midiClock.reset();      // Clock pulse train is not in runtime state so restart it as replay does
+    captureArm();
+    releaseMutex();
+    return true;
+}
+
+void stopCapture() { captureStop(); }
+
+bool isCapturing() { return captureIsRunning(); }
+
+int32_t replayCapture(const char* filename) {
+    if (g_pJackClient || captureIsRunning() || replayIsRunning())
+        return -2; // Replay drives the process callbacks so must not run alongside JACK
+    CAPTURE_HEADER header;
+    if (!replayOpen(filename, "zynseq", CAPTURE_VERSION, sizeof(RUNTIME_STATE), &header))
+        return -2;
+
+    // Restore state at start of capture
+    initMetronome();
+    replayStart();
+    g_nSampleRate         = header.sampleRate;
+    g_nCaptureSeed        = header.seed;
+    std::string sSnapshot = std::string(filename) + ".zynseq";
+    int32_t nResult       = -2;
+    if (load(sSnapshot.c_str())) {
+        g_seqMan.seedRandom(header.seed);
+        nResult = replayRun(replayRecord, replayApi);
+    }
+    replayStop();
+    replayClose();
+    return nResult;
+}
@@ -63,6 +63,46 @@ enum TRANSPORT_CLOCK {
     TRANSPORT_CLOCK_ANALOG   = 4
 };
 
+// Monitor feed published to shared memory for UI and controller animation without library calls
+#define MONITOR_SHM_PREFIX "/zynseq" // POSIX shared memory object name prefix (/dev/shm/zynseq.<pid>)
+#define MONITOR_VERSION 1            // Layout version of monitor region
+#define MONITOR_SEQUENCES 128        // Maximum quantity of playing sequences in monitor region
+
+// Playing sequence published by jack process
+struct MONITOR_SEQUENCE {
+    uint8_t bank;       // Index of bank containing sequence
+    uint8_t sequence;   // Index of sequence within bank
+    uint8_t playState;  // Play state [STOPPED | PLAYING | STOPPING | STARTING | RESTARTING | STOPPING_SYNC]
+    uint8_t playMode;   // Play mode
+    uint32_t position;  // Play position in clocks (as getPlayPosition)
+    uint32_t length;    // Length of sequence in clocks
+    uint8_t group;      // Group of sequence
+    uint8_t reserved[3]; // Unused (padding)
+};
+
+// Shared memory region containing transport and playhead state, written once per period.
+// Seqlock: seq is odd whilst being written so readers copy the region and retry if seq was odd or changed.
+struct MONITOR_REGION {
+    uint32_t seq;            // Sequence counter
+    uint32_t version;        // Layout version (MONITOR_VERSION)
+    uint32_t maxSequences;   // Quantity of sequence entries (MONITOR_SEQUENCES)
+    uint32_t sampleRate;     // JACK samplerate
+    uint64_t frameTime;      // Frame time at start of period
+    double tempo;            // Tempo in beats per minute (as getTempo)
+    uint32_t bar;            // Current bar
+    uint32_t beat;           // Current beat within bar
+    uint32_t beatsPerBar;    // Beats per bar
+    uint32_t songClock;      // Quantity of clocks from start of song to next clock
+    uint8_t transportState;  // Transport state (as transportGetPlayStatus)
+    uint8_t clock;           // Clock within beat [0..PPQN-1]
+    uint8_t editorPlayState; // Play state of sequence being edited
+    uint8_t reserved;        // Unused (padding)
+    uint32_t patternPlayhead; // Step of playhead in pattern being edited (as getPatternPlayhead)
+    uint32_t sequences;      // Quantity of valid entries in sequence
+    uint32_t reserved2;      // Unused (padding)
+    MONITOR_SEQUENCE sequence[MONITOR_SEQUENCES]; // Playing sequences
+};
+
 // ** Library management functions **
 
 /** @brief  Initialise library and connect to jackd server
@@ -81,6 +121,17 @@ bool isModified();
  */
 void enableDebug(bool bEnable);
 
+/** @brief  Get monotonic frame time
+ *   @retval uint64_t Frame time at start of current JACK period, extended from 32-bit JACK frame time so that it does not wrap
+ */
+uint64_t getFrameTime();
+
+/** @brief  Offset JACK frame time so that it wraps soon
+ *   @param  frames Quantity of frames until 32-bit JACK frame time wraps
+ *   @note   Used to test long running behaviour. Scheduling uses 64-bit frame time which remains continuous.
+ */
+void setFrameTimeWrap(uint32_t frames);
+
 /** @brief  Load sequences and patterns from file
  *   @param  filename Full path and filename
  *   @retval bool True on success
@@ -203,6 +254,89 @@ uint8_t getMidiClockOutput();
  */
 void setMidiClockOutput(bool enable = true);
 
+/** @brief  Get MIDI clock output latency offset
+ *   @retval float Offset in milliseconds
+ */
+float getMidiClockLatency();
+
+/** @brief  Set MIDI clock output latency offset to align slaved devices with audio
+ *   @param  latency Offset in milliseconds [-100..100] - positive delays MIDI clock, negative sends it early
+ */
+void setMidiClockLatency(float latency);
+
+/** @brief  Get quantity of clock pulses over which tempo changes are ramped
+ *   @retval uint8_t Quantity of pulses
+ */
+uint8_t getMidiClockRamp();
+
+/** @brief  Set quantity of clock pulses over which tempo changes are ramped
+ *   @param  pulses Quantity of pulses [0..96, 0 to change tempo immediately]
+ *   @note   Applies to internal clock, i.e. to playback as well as MIDI clock output, so that both stay aligned
+ */
+void setMidiClockRamp(uint8_t pulses);
+
+/** @brief  Get measured deviation of sent MIDI clock pulses from their ideal time
+ *   @param  peak True for peak deviation, false for RMS deviation
+ *   @retval float Deviation in microseconds since last reset
+ */
+float getMidiClockJitter(bool peak);
+
+/** @brief  Reset MIDI clock jitter measurement
+ */
+void resetMidiClockJitter();
+
+/** @brief  Set rate of analog sync pulses rendered to sync_out audio port
+ *   @param  ppqn Pulses per quarter note [0 to disable, 1, 2, 3, 4, 6, 8, 12, 24, 48, 72, 96]
+ *   @note   Pulses are rendered at the sample nearest each clock while transport rolls, including clocks recovered from external sources
+ */
+void setSyncOutput(uint8_t ppqn);
+
+/** @brief  Get rate of analog sync output pulses
+ *   @retval uint8_t Pulses per quarter note (0 if disabled)
+ */
+uint8_t getSyncOutput();
+
+/** @brief  Set duration of analog sync output pulses
+ *   @param  width Pulse width in milliseconds [0.1..100]
+ */
+void setSyncPulseWidth(float width);
+
+/** @brief  Get duration of analog sync output pulses
+ *   @retval float Pulse width in milliseconds
+ */
+float getSyncPulseWidth();
+
+/** @brief  Set rate of analog sync pulses expected at sync_in audio port
+ *   @param  ppqn Pulses per quarter note [1, 2, 3, 4, 6, 8, 12, 24, 48, 72, 96]
+ *   @note   Sync input is used when clock source includes TRANSPORT_CLOCK_ANALOG
+ */
+void setSyncInput(uint8_t ppqn);
+
+/** @brief  Get rate of analog sync input pulses
+ *   @retval uint8_t Pulses per quarter note
+ */
+uint8_t getSyncInput();
+
+/** @brief  Set level at which analog sync input pulses are detected
+ *   @param  level Threshold [0.01..1.0] - input must fall below half this level before next pulse is detected
+ */
+void setSyncThreshold(float level);
+
+/** @brief  Get level at which analog sync input pulses are detected
+ *   @retval float Threshold
+ */
+float getSyncThreshold();
+
+/** @brief  Set which transition of analog sync input pulses marks a clock
+ *   @param  edge Edge [0: Rising, 1: Falling]
+ */
+void setSyncEdge(uint8_t edge);
+
+/** @brief  Get which transition of analog sync input pulses marks a clock
+ *   @retval uint8_t Edge [0: Rising, 1: Falling]
+ */
+uint8_t getSyncEdge();
+
 /** @brief  Get MIDI device used for external trigger of sequences
  *   @retval uint8_t MIDI device index
  */
@@ -249,6 +383,7 @@ uint16_t getTriggerSequence(uint8_t note);
 
 /** @brief  Enable record from MIDI input to add notes to current pattern
  *   @param  enable True to enable MIDI input
+ *   @note   While playing, notes are positioned from their frame time less the input port capture latency, interpolated between clocks
  */
 void enableMidiRecord(bool enable);
 
@@ -512,6 +647,29 @@ void removeProgramChange(uint32_t step, uint8_t program);
  */
 uint8_t getProgramChange(uint32_t step);
 
+/** @brief  Add SysEx message to selected pattern
+ *   @param  step Index of step at which to add SysEx
+ *   @param  data Pointer to complete SysEx message, starting 0xF0 and ending 0xF7
+ *   @param  size Quantity of bytes in message [2..4096]
+ *   @retval bool True on success
+ *   @note   Replaces any existing SysEx at this step
+ */
+bool addSysex(uint32_t step, const uint8_t* data, uint16_t size);
+
+/** @brief  Remove SysEx message from selected pattern
+ *   @param  step Index of step at which to remove SysEx
+ *   @retval bool True on success
+ */
+bool removeSysex(uint32_t step);
+
+/** @brief  Get SysEx message in selected pattern
+ *   @param  step Index of step at which SysEx resides
+ *   @param  data Buffer to populate with message (may be NULL to query size)
+ *   @param  size Size of buffer
+ *   @retval uint16_t Quantity of bytes in message (0 if no SysEx at this step)
+ */
+uint16_t getSysex(uint32_t step, uint8_t* data, uint16_t size);
+
 /** @brief  Transpose selected pattern
  *   @param  value +/- quantity of notes to transpose
  */
@@ -711,6 +869,25 @@ void setChannel(uint8_t bank, uint8_t sequence, uint32_t track, uint8_t channel)
  */
 uint8_t getChannel(uint8_t bank, uint8_t sequence, uint32_t track);
 
+/** @brief  Set track MIDI effect parameter
+ *   @param  bank Index of bank
+ *   @param  sequence Sequence ID
+ *   @param  track Index of track
+ *   @param  param Parameter index [MIDIFX_ENABLE..MIDIFX_PARAMS - 1] (see midifx.h)
+ *   @param  value Parameter value (limited to parameter range)
+ *   @note   Effects may be changed while playing. MIDIFX_ENABLE is a bitwise flag of enabled stages.
+ */
+void setMidiFxParam(uint8_t bank, uint8_t sequence, uint32_t track, uint8_t param, int16_t value);
+
+/** @brief  Get track MIDI effect parameter
+ *   @param  bank Index of bank
+ *   @param  sequence Sequence ID
+ *   @param  track Index of track
+ *   @param  param Parameter index [MIDIFX_ENABLE..MIDIFX_PARAMS - 1] (see midifx.h)
+ *   @retval int16_t Parameter value
+ */
+int16_t getMidiFxParam(uint8_t bank, uint8_t sequence, uint32_t track, uint8_t param);
+
 /** @brief  Get current play mode for a sequence
  *   @param  bank Index of bank containing sequence
  *   @param  sequence Index (sequence) of sequence within bank
@@ -838,6 +1015,76 @@ uint8_t getGroup(uint8_t bank, uint8_t sequence);
  */
 void setGroup(uint8_t bank, uint8_t sequence, uint8_t group);
 
+/** @brief  Set action performed when a sequence reaches its end
+ *   @param  bank Index of bank
+ *   @param  sequence Index of sequence
+ *   @param  action Follow action [FOLLOW_NONE | FOLLOW_START | FOLLOW_STOP | FOLLOW_RANDOM | FOLLOW_SCENE]
+ *   @param  loops Quantity of times sequence plays before action is performed [Optional - default: 1]
+ *   @param  stop True to stop sequence when action is performed [Optional - default: true]
+ *   @note   Action is evaluated in the audio thread so started targets play from the clock following the end of the sequence
+ */
+void setFollowAction(uint8_t bank, uint8_t sequence, uint8_t action, uint16_t loops = 1, bool stop = true);
+
+/** @brief  Get action performed when a sequence reaches its end
+ *   @param  bank Index of bank
+ *   @param  sequence Index of sequence
+ *   @retval uint8_t Follow action
+ */
+uint8_t getFollowAction(uint8_t bank, uint8_t sequence);
+
+/** @brief  Get quantity of times a sequence plays before its follow action is performed
+ *   @param  bank Index of bank
+ *   @param  sequence Index of sequence
+ *   @retval uint16_t Quantity of loops
+ */
+uint16_t getFollowLoops(uint8_t bank, uint8_t sequence);
+
+/** @brief  Check if a sequence stops when its follow action is performed
+ *   @param  bank Index of bank
+ *   @param  sequence Index of sequence
+ *   @retval bool True if sequence stops
+ */
+bool getFollowStop(uint8_t bank, uint8_t sequence);
+
+/** @brief  Add a target to a sequence's follow action
+ *   @param  bank Index of bank
+ *   @param  sequence Index of sequence
+ *   @param  targetBank Index of bank containing target sequence (target bank for FOLLOW_SCENE)
+ *   @param  targetSequence Index of target sequence (ignored for FOLLOW_SCENE)
+ *   @param  weight Relative likelihood of choosing target for FOLLOW_RANDOM and FOLLOW_SCENE [Optional - default: 1]
+ *   @retval bool True on success, false if sequence already has MAX_FOLLOW_TARGETS targets or weight is zero
+ */
+bool addFollowTarget(uint8_t bank, uint8_t sequence, uint8_t targetBank, uint8_t targetSequence, uint8_t weight = 1);
+
+/** @brief  Remove all targets from a sequence's follow action
+ *   @param  bank Index of bank
+ *   @param  sequence Index of sequence
+ */
+void clearFollowTargets(uint8_t bank, uint8_t sequence);
+
+/** @brief  Get quantity of targets of a sequence's follow action
+ *   @param  bank Index of bank
+ *   @param  sequence Index of sequence
+ *   @retval uint8_t Quantity of targets
+ */
+uint8_t getFollowTargets(uint8_t bank, uint8_t sequence);
+
+/** @brief  Get a target of a sequence's follow action
+ *   @param  bank Index of bank
+ *   @param  sequence Index of sequence
+ *   @param  index Index of target
+ *   @retval uint16_t Target bank in MSB, target sequence in LSB or 0xFFFF if invalid index
+ */
+uint16_t getFollowTarget(uint8_t bank, uint8_t sequence, uint8_t index);
+
+/** @brief  Get weight of a target of a sequence's follow action
+ *   @param  bank Index of bank
+ *   @param  sequence Index of sequence
+ *   @param  index Index of target
+ *   @retval uint8_t Weight or 0 if invalid index
+ */
+uint8_t getFollowTargetWeight(uint8_t bank, uint8_t sequence, uint8_t index);
+
 /** @brief  Check if a sequence play state, group or mode has changed since last checked
  *   @param  bank Index of bank
  *   @param  sequence Index of sequence
@@ -932,6 +1179,7 @@ const char* getSequenceName(uint8_t bank, uint8_t sequence);
  *   @param  sequence Index of sequence to move
  *   @param  position Index of sequence to move this sequence, e.g. 0 to insert as first sequence
  *   @note   Sequences after insert point are moved up by one. Bank grows if sequence or position are higher than size of bank
+ *   @note   Follow action targets continue to refer to the same sequences
  *   @retval bool True on success
  */
 bool moveSequence(uint8_t bank, uint8_t sequence, uint8_t position);
@@ -940,6 +1188,7 @@ bool moveSequence(uint8_t bank, uint8_t sequence, uint8_t position);
  *   @param  bank Index of bank
  *   @param  sequence Index at which to insert sequence , e.g. 0 to insert as first sequence
  *   @note   Sequences after insert point are moved up by one. Bank grows if sequence is higher than size of bank
+ *   @note   Follow action targets continue to refer to the same sequences
  */
 void insertSequence(uint8_t bank, uint8_t sequence);
 
@@ -947,6 +1196,7 @@ void insertSequence(uint8_t bank, uint8_t sequence);
  *   @param  bank Index of bank
  *   @param  sequence Index of sequence to remove
  *   @note   Sequences after remove point are moved down by one. Bank grows if sequence is higher than size of bank
+ *   @note   Follow action targets of removed sequence are removed, others continue to refer to the same sequences
  */
 void removeSequence(uint8_t bank, uint8_t sequence);
 
@@ -994,6 +1244,89 @@ void solo(uint8_t bank, uint8_t sequence, uint32_t track, bool solo);
  */
 bool isSolo(uint8_t bank, uint8_t sequence, uint32_t track);
 
+// ** Arrangement (linear song) **
+/** @brief  Enable or disable arrangement mode
+ *   @param  enable True to play sequence launches, tempo and time signature changes from arrangement timeline [Default: true]
+ *   @note   When disabled, transport uses single tempo and time signature
+ */
+void enableArrangement(bool enable = true);
+
+/** @brief  Check if arrangement mode is enabled
+ *   @retval bool True if enabled
+ */
+bool isArrangementEnabled();
+
+/** @brief  Remove all events from arrangement
+ */
+void clearArrangement();
+
+/** @brief  Add sequence launch to arrangement
+ *   @param  bar Bar at which to start sequence [>0]
+ *   @param  tick Tick within bar at which to start sequence
+ *   @param  bank Index of bank
+ *   @param  sequence Index of sequence
+ *   @note   Sequence starts from its beginning. Other sequences in same group are stopped.
+ */
+void addArrangementLaunch(uint16_t bar, uint32_t tick, uint8_t bank, uint8_t sequence);
+
+/** @brief  Add sequence stop to arrangement
+ *   @param  bar Bar at which to stop sequence [>0]
+ *   @param  tick Tick within bar at which to stop sequence
+ *   @param  bank Index of bank
+ *   @param  sequence Index of sequence
+ */
+void addArrangementStop(uint16_t bar, uint32_t tick, uint8_t bank, uint8_t sequence);
+
+/** @brief  Add scene launch to arrangement
+ *   @param  bar Bar at which to start scene [>0]
+ *   @param  tick Tick within bar at which to start scene
+ *   @param  bank Index of bank to launch as scene
+ *   @note   Stops all sequences then starts all non-empty sequences in bank
+ */
+void addArrangementScene(uint16_t bar, uint32_t tick, uint8_t bank);
+
+/** @brief  Add tempo change to arrangement
+ *   @param  bar Bar at which to change tempo [>0]
+ *   @param  tick Tick within bar at which to change tempo
+ *   @param  tempo Tempo in beats per minute [10.0..500.0]
+ */
+void addArrangementTempo(uint16_t bar, uint32_t tick, double tempo);
+
+/** @brief  Add time signature change to arrangement
+ *   @param  bar Bar at which to change time signature [>0]
+ *   @param  beats Beats per bar (numerator)
+ *   @param  type Beat type (denominator)
+ */
+void addArrangementTimeSig(uint16_t bar, uint8_t beats, uint8_t type);
+
+/** @brief  Remove event from arrangement
+ *   @param  bar Bar of event [>0]
+ *   @param  tick Tick within bar of event
+ *   @param  type Event type [1:Tempo 2:Time signature 3:Launch 4:Stop 5:Scene]
+ *   @param  value Event value (bank << 8 | sequence for launch and stop, bank for scene, ignored for tempo and time signature)
+ */
+void removeArrangementEvent(uint16_t bar, uint32_t tick, uint8_t type, uint32_t value);
+
+/** @brief  Get quantity of events in arrangement
+ *   @retval uint32_t Quantity of events
+ */
+uint32_t getArrangementEventCount();
+
+/** @brief  Get arrangement event
+ *   @param  index Index of event (events are ordered by time)
+ *   @param  bar Pointer to populate with bar [>0]
+ *   @param  tick Pointer to populate with tick within bar
+ *   @param  type Pointer to populate with event type [1:Tempo 2:Time signature 3:Launch 4:Stop 5:Scene]
+ *   @param  value Pointer to populate with event value (tempo in 1/100 BPM, beats << 8 | beat type, bank << 8 | sequence or bank)
+ *   @retval bool True if event exists
+ */
+bool getArrangementEvent(uint32_t index, uint16_t* bar, uint32_t* tick, uint8_t* type, uint32_t* value);
+
+/** @brief  Get position within song
+ *   @retval uint32_t Quantity of clock cycles from start of song to next clock
+ */
+uint32_t getSongClock();
+
 // ** Transport control **
 /** @brief  Locate transport to frame
  *   @param  frame Quantity of frames (samples) from start of song to locate
@@ -1085,12 +1418,12 @@ void setMetronomeVolume(float level);
 float getMetronomeVolume();
 
 /** @brief Get clock source
- *   @retval uint8_t Clock source [0:Internal 1:MIDI]
+ *   @retval uint8_t Clock source bitmask [TRANSPORT_CLOCK_INTERNAL | TRANSPORT_CLOCK_MIDI | TRANSPORT_CLOCK_ANALOG]
  */
 uint8_t getClockSource();
 
 /** @brief Set clock source
- *   @param source uint8_t Clock source [0:Internal 1:MIDI]
+ *   @param source uint8_t Clock source bitmask [TRANSPORT_CLOCK_INTERNAL | TRANSPORT_CLOCK_MIDI | TRANSPORT_CLOCK_ANALOG]
  */
 void setClockSource(uint8_t source);
 
@@ -1099,6 +1432,108 @@ void setClockSource(uint8_t source);
  */
 double getFramesPerClock(double dTempo);
 
+/** @brief  Map a controller pad to feedback of a sequence's state
+ *   @param  pad Index of pad [0..255]
+ *   @param  bank Index of bank containing sequence
+ *   @param  sequence Index of sequence within bank
+ *   @param  status MIDI status byte of feedback message, e.g. 0x90 for note-on channel 1 (0 to unmap pad)
+ *   @param  note MIDI note or controller number of feedback message
+ *   @retval bool True on success
+ *   @note   Feedback is sent to the feedback output port when the pad value changes
+ */
+bool setFeedbackPad(uint16_t pad, uint8_t bank, uint8_t sequence, uint8_t status, uint8_t note);
+
+/** @brief  Remove all pads from feedback map
+ */
+void clearFeedbackPads();
+
+/** @brief  Set value (colour) sent to pads for a sequence state
+ *   @param  state Sequence play state [STOPPED | PLAYING | STOPPING | STARTING | RESTARTING | STOPPING_SYNC] or 6 for empty stopped sequence
+ *   @param  colour Value sent to pad [0..127]
+ *   @param  blinkColour Value sent to pad during alternate blink phase [0..127]
+ *   @param  blinkRate Clock cycles in each blink phase, synchronised to bar when transport rolling (0 for no blink, 24 to change each beat)
+ *   @retval bool True on success
+ */
+bool setFeedbackState(uint8_t state, uint8_t colour, uint8_t blinkColour, uint8_t blinkRate);
+
+/** @brief  Resend value to all mapped pads, e.g. after controller reconnects
+ */
+void refreshFeedback();
+
+/** @brief  Set maximum rate of feedback messages
+ *   @param  rate Maximum quantity of messages per second
+ */
+void setFeedbackRate(uint16_t rate);
+
+/** @brief  Get maximum rate of feedback messages
+ *   @retval uint16_t Maximum quantity of messages per second
+ */
+uint16_t getFeedbackRate();
+
+/** @brief  Set quantity of worker threads used to generate events of playing sequences in parallel
+ *   @param  workers Quantity of worker threads [0..8] (0 to disable parallel event generation)
+ *   @note   Workers share the scheduling priority of the JACK process thread. Sequences are clocked serially if realtime priority is unavailable.
+ *   @note   Events are merged in the same order as serial generation so output is unchanged
+ */
+void setParallelWorkers(uint8_t workers);
+
+/** @brief  Get quantity of worker threads used to generate events in parallel
+ *   @retval uint8_t Quantity of running worker threads
+ */
+uint8_t getParallelWorkers();
+
+/** @brief  Set minimum quantity of playing sequences to generate events in parallel
+ *   @param  threshold Quantity of playing sequences below which events are generated serially (Default: 16)
+ */
+void setParallelThreshold(uint32_t threshold);
+
+/** @brief  Get minimum quantity of playing sequences to generate events in parallel
+ *   @retval uint32_t Quantity of playing sequences
+ */
+uint32_t getParallelThreshold();
+
+/** @brief  Get monitor region
+ *   @retval MONITOR_REGION* Pointer to region containing transport state, BBT, tempo and position of each playing sequence or NULL if unavailable
+ *   @note   Region is also published as POSIX shared memory for other processes (see getMonitorName)
+ */
+MONITOR_REGION* getMonitorRegion();
+
+/** @brief  Get name of shared memory object containing monitor region
+ *   @retval const char* POSIX shared memory name (MONITOR_SHM_PREFIX.<pid>) or empty string if region is private to this process
+ */
+const char* getMonitorName();
+
+// ** Capture and replay **
+
+/** @brief  Start capturing process inputs to a log that may be replayed offline to reproduce a problem
+ *   @param  filename Full path and filename of log (sequencer state is saved alongside with ".zynseq" appended)
+ *   @retval bool True on success, false if not initialised, already capturing, sequencer playing or file cannot be written
+ *   @note   Records each period's MIDI input, frame time, transport state and timebase callback, API calls that change sequencer state and a hash of
+ *           each period's outputs. Pseudo random generators are reseeded so that play chance, humanisation and random arpeggio are repeatable.
+ *   @note   Values that the sequence file stores with limited precision (swing, humanisation, play chance, note offset and duration) are rounded.
+ *   @note   JACK callbacks never wait for API calls. Replay applies each call before the first callback that started after it completed. A call that
+ *           overlapped a callback is flagged and reported if replay diverges at that callback.
+ *   @note   Tracks added to sequences during capture are not reproduced exactly.
+ *   @note   A file loaded during capture is reloaded from the same path by replay so must not change before replay.
+ */
+bool startCapture(const char* filename);
+
+/** @brief  Stop capturing process inputs, flushing log to file
+ */
+void stopCapture();
+
+/** @brief  Check if capturing process inputs
+ *   @retval bool True if capturing
+ */
+bool isCapturing();
+
+/** @brief  Replay a capture log offline and compare outputs bit-for-bit with those captured
+ *   @param  filename Full path and filename of log
+ *   @retval int32_t Index of first period whose output differs, -1 if all outputs match, -2 if log cannot be replayed
+ *   @note   Must run in a process that has not called init (no JACK client). Replaces sequencer state with that at start of capture.
+ */
+int32_t replayCapture(const char* filename);
+
 #ifdef __cplusplus
 }
 #endif
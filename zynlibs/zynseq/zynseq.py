@@ -32,6 +32,7 @@ from os.path import dirname, realpath
 from zyngine import zynthian_engine
 from zyngine import zynthian_controller
 from zyngine.zynthian_signal_manager import zynsigman
+from zynlibs.rtmonitor import rtmonitor
 
 # -------------------------------------------------------------------------------
 # Zynthian Step Sequencer Library Wrapper
@@ -65,6 +66,29 @@ SEQ_ONESHOTALL = 3
 SEQ_LOOPALL = 4
 SEQ_LASTPLAYMODE = 4
 
+# Track MIDI effect parameters (see midifx.h)
+MIDIFX_ENABLE = 0
+MIDIFX_SCALE_MASK = 1
+MIDIFX_SCALE_TONIC = 2
+MIDIFX_CHORD_1 = 3
+MIDIFX_CHORD_2 = 4
+MIDIFX_CHORD_3 = 5
+MIDIFX_VELOCITY_CURVE = 6
+MIDIFX_VELOCITY_MIN = 7
+MIDIFX_VELOCITY_MAX = 8
+MIDIFX_REPEAT_RATE = 9
+MIDIFX_ARP_MODE = 10
+MIDIFX_ARP_RATE = 11
+MIDIFX_ARP_OCTAVES = 12
+MIDIFX_ARP_GATE = 13
+
+# Track MIDI effect stages (bitwise flags of MIDIFX_ENABLE)
+MIDIFX_STAGE_SCALE = 0x01
+MIDIFX_STAGE_CHORD = 0x02
+MIDIFX_STAGE_VELOCITY = 0x04
+MIDIFX_STAGE_REPEAT = 0x08
+MIDIFX_STAGE_ARP = 0x10
+
 SEQ_STOPPED = 0
 SEQ_PLAYING = 1
 SEQ_STOPPING = 2
@@ -72,10 +96,63 @@ SEQ_STARTING = 3
 SEQ_RESTARTING = 4
 SEQ_STOPPINGSYNC = 5
 SEQ_LASTPLAYSTATUS = 5
+SEQ_FEEDBACK_EMPTY = 6  # Feedback state of a stopped sequence with no events
 
 PLAY_MODES = ['Disabled', 'Oneshot', 'Loop',
               'Oneshot all', 'Loop all', 'Oneshot sync', 'Loop sync']
 
+FOLLOW_NONE = 0
+FOLLOW_START = 1
+FOLLOW_STOP = 2
+FOLLOW_RANDOM = 3
+FOLLOW_SCENE = 4
+FOLLOW_ACTIONS = ['None', 'Start', 'Stop', 'Random', 'Scene']
+MAX_FOLLOW_TARGETS = 16
+
+SYNC_EDGE_RISING = 0
+SYNC_EDGE_FALLING = 1
+SYNC_PPQN = [1, 2, 3, 4, 6, 8, 12, 24, 48, 72, 96]
+
+MONITOR_SEQUENCES = 128
+
+
+# Playing sequence entry of monitor region (mirrors MONITOR_SEQUENCE in zynseq.h)
+class MonitorSequence(ctypes.Structure):
+    _fields_ = [
+        ("bank", ctypes.c_uint8),
+        ("sequence", ctypes.c_uint8),
+        ("play_state", ctypes.c_uint8),
+        ("play_mode", ctypes.c_uint8),
+        ("position", ctypes.c_uint32),
+        ("length", ctypes.c_uint32),
+        ("group", ctypes.c_uint8),
+        ("reserved", ctypes.c_uint8 * 3)
+    ]
+
+
+# Monitor region published by library (mirrors MONITOR_REGION in zynseq.h)
+class MonitorRegion(ctypes.Structure):
+    _fields_ = [
+        ("seq", ctypes.c_uint32),
+        ("version", ctypes.c_uint32),
+        ("max_sequences", ctypes.c_uint32),
+        ("samplerate", ctypes.c_uint32),
+        ("frame_time", ctypes.c_uint64),
+        ("tempo", ctypes.c_double),
+        ("bar", ctypes.c_uint32),
+        ("beat", ctypes.c_uint32),
+        ("beats_per_bar", ctypes.c_uint32),
+        ("song_clock", ctypes.c_uint32),
+        ("transport_state", ctypes.c_uint8),
+        ("clock", ctypes.c_uint8),
+        ("editor_play_state", ctypes.c_uint8),
+        ("reserved", ctypes.c_uint8),
+        ("pattern_playhead", ctypes.c_uint32),
+        ("sequences", ctypes.c_uint32),
+        ("reserved2", ctypes.c_uint32),
+        ("sequence", MonitorSequence * MONITOR_SEQUENCES)
+    ]
+
 
 class zynseq(zynthian_engine):
 
@@ -87,6 +164,7 @@ class zynseq(zynthian_engine):
     # Initiate library - performed by zynseq module
     def __init__(self, state_manager=None):
         self.state_manager = state_manager
+        self.monitor = None
         self.changing_bank = False
         try:
             self.libseq = ctypes.cdll.LoadLibrary(
@@ -108,7 +186,17 @@ class zynseq(zynthian_engine):
             self.libseq.setPlayChance.argtypes = [ctypes.c_float]
             self.libseq.getPlayChance.restype = ctypes.c_float
             self.libseq.getTempo.restype = ctypes.c_double
+            self.libseq.getFrameTime.restype = ctypes.c_uint64
             self.libseq.setTempo.argtypes = [ctypes.c_double]
+            self.libseq.addArrangementTempo.argtypes = [
+                ctypes.c_uint16, ctypes.c_uint32, ctypes.c_double]
+            self.libseq.getArrangementEvent.argtypes = [ctypes.c_uint32, ctypes.POINTER(ctypes.c_uint16), ctypes.POINTER(
+                ctypes.c_uint32), ctypes.POINTER(ctypes.c_uint8), ctypes.POINTER(ctypes.c_uint32)]
+            self.libseq.setMidiFxParam.argtypes = [
+                ctypes.c_uint8, ctypes.c_uint8, ctypes.c_uint32, ctypes.c_uint8, ctypes.c_int16]
+            self.libseq.getMidiFxParam.argtypes = [
+                ctypes.c_uint8, ctypes.c_uint8, ctypes.c_uint32, ctypes.c_uint8]
+            self.libseq.getMidiFxParam.restype = ctypes.c_int16
             self.libseq.getMetronomeVolume.restype = ctypes.c_float
             self.libseq.setMetronomeVolume.argtypes = [ctypes.c_float]
             self.libseq.getStateChange.argtypes = [
@@ -117,7 +205,31 @@ class zynseq(zynthian_engine):
             self.libseq.getProgress.argtypes = [
                 ctypes.c_uint8, ctypes.c_uint8, ctypes.c_uint8, ctypes.POINTER(ctypes.c_uint16)]
             self.libseq.getProgress.restype = ctypes.c_uint8
+            self.libseq.addSysex.argtypes = [
+                ctypes.c_uint32, ctypes.POINTER(ctypes.c_uint8), ctypes.c_uint16]
+            self.libseq.addSysex.restype = ctypes.c_bool
+            self.libseq.removeSysex.restype = ctypes.c_bool
+            self.libseq.getSysex.argtypes = [
+                ctypes.c_uint32, ctypes.POINTER(ctypes.c_uint8), ctypes.c_uint16]
+            self.libseq.getSysex.restype = ctypes.c_uint16
+            self.libseq.startCapture.restype = ctypes.c_bool
+            self.libseq.isCapturing.restype = ctypes.c_bool
+            self.libseq.getMidiClockLatency.restype = ctypes.c_float
+            self.libseq.setMidiClockLatency.argtypes = [ctypes.c_float]
+            self.libseq.getMidiClockJitter.restype = ctypes.c_float
+            self.libseq.setSyncPulseWidth.argtypes = [ctypes.c_float]
+            self.libseq.getSyncPulseWidth.restype = ctypes.c_float
+            self.libseq.setSyncThreshold.argtypes = [ctypes.c_float]
+            self.libseq.getSyncThreshold.restype = ctypes.c_float
+            self.libseq.getMonitorRegion.restype = ctypes.c_void_p
+            self.libseq.getMonitorName.restype = ctypes.c_char_p
+            self.libseq.setFollowAction.argtypes = [
+                ctypes.c_uint8, ctypes.c_uint8, ctypes.c_uint8, ctypes.c_uint16, ctypes.c_bool]
+            self.libseq.getFollowStop.restype = ctypes.c_bool
+            self.libseq.addFollowTarget.restype = ctypes.c_bool
             self.libseq.init(bytes("zynseq", "utf-8"))
+            if self.libseq.getMonitorRegion():
+                self.monitor = MonitorRegion.from_address(self.libseq.getMonitorRegion())
         except Exception as e:
             self.libseq = None
             print("Can't initialise zynseq library: %s" % str(e))
@@ -353,6 +465,37 @@ class zynseq(zynthian_engine):
     def set_play_mode(self, bank, sequence, mode):
         self.libseq.setPlayMode(bank, sequence, mode)
 
+    # Set action performed when sequence reaches its end
+    # action: FOLLOW_NONE, FOLLOW_START, FOLLOW_STOP, FOLLOW_RANDOM or FOLLOW_SCENE
+    # loops: Quantity of times sequence plays before action is performed
+    # stop: True to stop sequence when action is performed
+    def set_follow_action(self, bank, sequence, action, loops=1, stop=True):
+        self.libseq.setFollowAction(bank, sequence, action, loops, stop)
+
+    # Get follow action of sequence
+    # Returns: Tuple (action, loops, stop)
+    def get_follow_action(self, bank, sequence):
+        return (self.libseq.getFollowAction(bank, sequence), self.libseq.getFollowLoops(bank, sequence), self.libseq.getFollowStop(bank, sequence))
+
+    # Replace targets of sequence's follow action
+    # targets: List of (bank, sequence, weight) - sequence is ignored by FOLLOW_SCENE
+    # Returns: True if all targets added
+    def set_follow_targets(self, bank, sequence, targets):
+        self.libseq.clearFollowTargets(bank, sequence)
+        for target in targets:
+            if not self.libseq.addFollowTarget(bank, sequence, *target):
+                return False
+        return True
+
+    # Get targets of sequence's follow action
+    # Returns: List of (bank, sequence, weight)
+    def get_follow_targets(self, bank, sequence):
+        targets = []
+        for i in range(self.libseq.getFollowTargets(bank, sequence)):
+            target = self.libseq.getFollowTarget(bank, sequence, i)
+            targets.append((target >> 8, target & 0xFF, self.libseq.getFollowTargetWeight(bank, sequence, i)))
+        return targets
+
     def remove_pattern(self, bank, sequence, track, time):
         self.libseq.removePattern(bank, sequence, track, time)
 
@@ -416,4 +559,188 @@ class zynseq(zynthian_engine):
         else:
             return -1
 
+    # Upload controller pad feedback layout to engine which sends state changes and blinks to its feedback port
+    # pads: List of (bank, sequence, status, note) indexed by pad
+    # states: Dictionary of (colour, blink colour, blink rate in clocks) indexed by play state or SEQ_FEEDBACK_EMPTY
+    def set_feedback_layout(self, pads, states):
+        if not self.libseq:
+            return
+        self.libseq.clearFeedbackPads()
+        for state, config in states.items():
+            self.libseq.setFeedbackState(state, *config)
+        for pad, config in enumerate(pads):
+            if config:
+                self.libseq.setFeedbackPad(pad, *config)
+
+    # Add SysEx message to selected pattern
+    # step: Index of step
+    # data: Complete message as bytes or list of integers, starting 0xF0 and ending 0xF7
+    # Returns: True on success
+    def add_sysex(self, step, data):
+        if not self.libseq:
+            return False
+        buffer = (ctypes.c_uint8 * len(data))(*data)
+        return self.libseq.addSysex(step, buffer, len(data))
+
+    # Get SysEx message in selected pattern
+    # step: Index of step
+    # Returns: Message as bytes or None if no SysEx at this step
+    def get_sysex(self, step):
+        if not self.libseq:
+            return None
+        size = self.libseq.getSysex(step, None, 0)
+        if size == 0:
+            return None
+        buffer = (ctypes.c_uint8 * size)()
+        self.libseq.getSysex(step, buffer, size)
+        return bytes(buffer)
+
+    # Start capturing sequencer process inputs to a log for offline replay (sequencer must be stopped)
+    # filename: Full path and filename of log
+    # Returns: True on success
+    def start_capture(self, filename):
+        if self.libseq:
+            return self.libseq.startCapture(bytes(filename, "utf-8"))
+        return False
+
+    # Stop capturing sequencer process inputs
+    def stop_capture(self):
+        if self.libseq:
+            self.libseq.stopCapture()
+
+    # Check if capturing sequencer process inputs
+    # Returns: True if capturing
+    def is_capturing(self):
+        if self.libseq:
+            return self.libseq.isCapturing()
+        return False
+
+    # Set MIDI clock output latency offset
+    # latency: Offset in milliseconds [-100..100], positive delays MIDI clock, negative sends it early
+    def set_midi_clock_latency(self, latency):
+        if self.libseq:
+            self.libseq.setMidiClockLatency(latency)
+
+    # Get MIDI clock output latency offset
+    # Returns: Offset in milliseconds
+    def get_midi_clock_latency(self):
+        if self.libseq:
+            return self.libseq.getMidiClockLatency()
+        return 0.0
+
+    # Set quantity of MIDI clock pulses over which tempo changes are ramped
+    # pulses: Quantity of pulses [0..96], 0 to change tempo immediately
+    def set_midi_clock_ramp(self, pulses):
+        if self.libseq:
+            self.libseq.setMidiClockRamp(pulses)
+
+    # Get quantity of MIDI clock pulses over which tempo changes are ramped
+    # Returns: Quantity of pulses
+    def get_midi_clock_ramp(self):
+        if self.libseq:
+            return self.libseq.getMidiClockRamp()
+        return 0
+
+    # Get measured deviation of sent MIDI clock pulses from their ideal time
+    # peak: True for peak deviation, False for RMS deviation
+    # Returns: Deviation in microseconds
+    def get_midi_clock_jitter(self, peak=True):
+        if self.libseq:
+            return self.libseq.getMidiClockJitter(peak)
+        return 0.0
+
+    # Reset MIDI clock jitter measurement
+    def reset_midi_clock_jitter(self):
+        if self.libseq:
+            self.libseq.resetMidiClockJitter()
+
+    # Set analog sync output rate
+    # ppqn: Pulses per quarter note (see SYNC_PPQN), 0 to disable
+    def set_sync_output(self, ppqn):
+        if self.libseq:
+            self.libseq.setSyncOutput(ppqn)
+
+    # Get analog sync output rate
+    # Returns: Pulses per quarter note, 0 if disabled
+    def get_sync_output(self):
+        if self.libseq:
+            return self.libseq.getSyncOutput()
+        return 0
+
+    # Set analog sync output pulse width
+    # width: Pulse width in milliseconds [0.1..100]
+    def set_sync_pulse_width(self, width):
+        if self.libseq:
+            self.libseq.setSyncPulseWidth(width)
+
+    # Get analog sync output pulse width
+    # Returns: Pulse width in milliseconds
+    def get_sync_pulse_width(self):
+        if self.libseq:
+            return self.libseq.getSyncPulseWidth()
+        return 0.0
+
+    # Set analog sync input rate (used when clock source includes analog)
+    # ppqn: Pulses per quarter note (see SYNC_PPQN)
+    def set_sync_input(self, ppqn):
+        if self.libseq:
+            self.libseq.setSyncInput(ppqn)
+
+    # Get analog sync input rate
+    # Returns: Pulses per quarter note
+    def get_sync_input(self):
+        if self.libseq:
+            return self.libseq.getSyncInput()
+        return 0
+
+    # Set analog sync input detection level
+    # level: Threshold [0.01..1.0]
+    def set_sync_threshold(self, level):
+        if self.libseq:
+            self.libseq.setSyncThreshold(level)
+
+    # Get analog sync input detection level
+    # Returns: Threshold
+    def get_sync_threshold(self):
+        if self.libseq:
+            return self.libseq.getSyncThreshold()
+        return 0.0
+
+    # Set which transition of analog sync input pulses is detected
+    # edge: SYNC_EDGE_RISING or SYNC_EDGE_FALLING
+    def set_sync_edge(self, edge):
+        if self.libseq:
+            self.libseq.setSyncEdge(edge)
+
+    # Get which transition of analog sync input pulses is detected
+    # Returns: SYNC_EDGE_RISING or SYNC_EDGE_FALLING
+    def get_sync_edge(self):
+        if self.libseq:
+            return self.libseq.getSyncEdge()
+        return SYNC_EDGE_RISING
+
+    # Read consistent copy of transport and playhead state without calling library
+    # Returns: MonitorRegion copy or None if unavailable or could not be read whilst being updated
+    def read_monitor(self):
+        if self.monitor is None:
+            return None
+        return rtmonitor.read_seqlock(self.monitor)
+
+    # Get name of shared memory object containing monitor region (for other processes)
+    # Returns: POSIX shared memory name or empty string if region is private to this process
+    def get_monitor_name(self):
+        if self.libseq:
+            return self.libseq.getMonitorName().decode("utf-8")
+        return ""
+
+    # Get playing sequences from a monitor region copy
+    # mon: MonitorRegion returned by read_monitor
+    # Returns: Dictionary of (play_state, position, length) indexed by (bank, sequence)
+    def get_monitor_sequences(self, mon):
+        sequences = {}
+        for i in range(min(mon.sequences, MONITOR_SEQUENCES)):
+            entry = mon.sequence[i]
+            sequences[(entry.bank, entry.sequence)] = (entry.play_state, entry.position, entry.length)
+        return sequences
+
 # -------------------------------------------------------------------------------
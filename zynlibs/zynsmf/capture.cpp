@@ -0,0 +1,203 @@
+/*  Implementation of capture and replay of SMF player and recorder process inputs
+ */
+
+#include "capture.h"
+
+#include <cstring> //provides memset
+
+#define REPLAY_MAX_FRAMES 8192 // Largest JACK period that may be replayed
+
+static bool s_bPeriodCapture            = false;  // True if current period is being captured
+static jack_nframes_t s_nPeriodFrames   = 0;      // Quantity of frames in current period
+static void* s_aOutputs[IO_OUTPUTS]     = {NULL}; // Output buffers cleared in current period (hashed at end of period)
+static uint64_t s_nRecorderHash         = CAPTURE_HASH_SEED; // Hash of events added to recorder in current period
+
+// Replay
+static bool s_bReplay                       = false;  // True if replaying
+static REPLAY_MIDI* s_aReplayMidi[IO_PORTS] = {NULL}; // Replay MIDI buffers, indexed by port (used as port pointers during replay)
+static CAPTURE_PERIOD_DATA s_replayPeriod;            // Inputs of current replayed period
+static uint64_t s_nReplayOutputHash   = 0;            // Hash of MIDI outputs from last replayed period
+static uint64_t s_nReplayRecorderHash = 0;            // Hash of recorder events from last replayed period
+
+// Get period record being populated
+static CAPTURE_PERIOD_DATA* periodRecord() { return (CAPTURE_PERIOD_DATA*)captureRecordFixed(); }
+
+jack_port_t* ioRegisterPort(jack_client_t* pClient, const char* name, unsigned long flags, uint8_t port) {
+    if (s_bReplay)
+        return port < IO_PORTS ? (jack_port_t*)s_aReplayMidi[port] : NULL;
+    return jack_port_register(pClient, name, JACK_DEFAULT_MIDI_TYPE, flags, 0);
+}
+
+void ioUnregisterPort(jack_client_t* pClient, jack_port_t* pPort) {
+    if (!s_bReplay)
+        jack_port_unregister(pClient, pPort);
+}
+
+// Start populating record of current period
+static void beginPeriodRecord() {
+    CAPTURE_PERIOD_DATA* pPeriod = (CAPTURE_PERIOD_DATA*)captureRecordBegin(CAPTURE_RECORD_PERIOD, sizeof(CAPTURE_PERIOD_DATA));
+    pPeriod->period              = captureGetPeriod();
+    pPeriod->frames              = s_nPeriodFrames;
+    s_bPeriodCapture             = true;
+}
+
+void ioBeginPeriod(jack_nframes_t nFrames) {
+    s_nPeriodFrames  = nFrames;
+    s_bPeriodCapture = false;
+    s_nRecorderHash  = CAPTURE_HASH_SEED;
+    memset(s_aOutputs, 0, sizeof(s_aOutputs));
+    if (captureBeginCallback())
+        beginPeriodRecord();
+}
+
+void ioCaptureState(const void* pState, uint32_t nSize) {
+    if (captureState(pState, nSize))
+        beginPeriodRecord();
+}
+
+void ioEndPeriod() {
+    if (!s_bPeriodCapture && !s_bReplay) {
+        captureEndCallback();
+        return;
+    }
+    uint64_t nOutputHash = CAPTURE_HASH_SEED;
+    jack_midi_event_t event;
+    for (uint8_t nOutput = 0; nOutput < IO_OUTPUTS; ++nOutput) {
+        if (!s_aOutputs[nOutput])
+            continue;
+        uint32_t nCount = ioMidiGetEventCount(s_aOutputs[nOutput]);
+        nOutputHash     = captureHash(nOutputHash, &nOutput, sizeof(nOutput));
+        for (uint32_t i = 0; i < nCount; ++i) {
+            // Output events are read directly so that they are not recorded as input
+            if ((s_bReplay ? replayMidiGet(&event, (REPLAY_MIDI*)s_aOutputs[nOutput], i) : jack_midi_event_get(&event, s_aOutputs[nOutput], i)) == 0)
+                nOutputHash = captureHashMidi(nOutputHash, &event);
+        }
+    }
+    if (s_bReplay) {
+        s_nReplayOutputHash   = nOutputHash;
+        s_nReplayRecorderHash = s_nRecorderHash;
+        captureEndCallback();
+        return;
+    }
+    CAPTURE_PERIOD_DATA* pPeriod = periodRecord();
+    pPeriod->outputHash          = nOutputHash;
+    pPeriod->recorderHash        = s_nRecorderHash;
+    captureRecordEnd();
+    s_bPeriodCapture = false;
+    captureEndCallback();
+}
+
+void* ioGetBuffer(jack_port_t* pPort, jack_nframes_t nFrames) {
+    if (s_bReplay)
+        return pPort;
+    return jack_port_get_buffer(pPort, nFrames);
+}
+
+void ioMidiClearBuffer(void* pBuffer, uint8_t output) {
+    if (output < IO_OUTPUTS)
+        s_aOutputs[output] = pBuffer;
+    if (s_bReplay) {
+        replayMidiClear((REPLAY_MIDI*)pBuffer);
+        return;
+    }
+    jack_midi_clear_buffer(pBuffer);
+    if (s_bPeriodCapture && output < IO_OUTPUTS && captureIsProcessThread())
+        periodRecord()->capacity[output] = jack_midi_max_event_size(pBuffer);
+}
+
+uint32_t ioMidiGetEventCount(void* pBuffer) {
+    if (s_bReplay)
+        return replayMidiCount((REPLAY_MIDI*)pBuffer);
+    return jack_midi_get_event_count(pBuffer);
+}
+
+int ioMidiEventGet(jack_midi_event_t* pEvent, void* pBuffer, uint32_t index) {
+    if (s_bReplay)
+        return replayMidiGet(pEvent, (REPLAY_MIDI*)pBuffer, index);
+    int nResult = jack_midi_event_get(pEvent, pBuffer, index);
+    if (nResult == 0 && s_bPeriodCapture && captureIsProcessThread()) {
+        // Append MIDI input event to period record
+        if (captureRecordMidi(pEvent))
+            ++periodRecord()->events;
+    }
+    return nResult;
+}
+
+uint8_t* ioMidiEventReserve(void* pBuffer, jack_nframes_t nTime, size_t nSize) {
+    if (s_bReplay)
+        return replayMidiReserve((REPLAY_MIDI*)pBuffer, nTime, nSize);
+    return jack_midi_event_reserve(pBuffer, nTime, nSize);
+}
+
+void ioRecorded(uint32_t nTime, const uint8_t* pData, size_t nSize) {
+    if (!s_bPeriodCapture && !s_bReplay)
+        return;
+    s_nRecorderHash = captureHash(s_nRecorderHash, &nTime, sizeof(nTime));
+    s_nRecorderHash = captureHash(s_nRecorderHash, pData, nSize);
+}
+
+jack_nframes_t ioLastFrameTime(jack_client_t* pClient) {
+    if (s_bReplay)
+        return s_replayPeriod.frameTime;
+    jack_nframes_t nFrameTime = jack_last_frame_time(pClient);
+    if (s_bPeriodCapture && captureIsProcessThread())
+        periodRecord()->frameTime = nFrameTime;
+    return nFrameTime;
+}
+
+jack_nframes_t ioFrameTime(jack_client_t* pClient) {
+    if (s_bReplay)
+        return s_replayPeriod.frameTime;
+    return jack_frame_time(pClient);
+}
+
+jack_transport_state_t ioTransportQuery(jack_client_t* pClient, jack_position_t* pPosition) {
+    if (s_bReplay) {
+        *pPosition = s_replayPeriod.position;
+        return jack_transport_state_t(s_replayPeriod.transportState);
+    }
+    jack_transport_state_t nState = jack_transport_query(pClient, pPosition);
+    if (s_bPeriodCapture && captureIsProcessThread()) {
+        CAPTURE_PERIOD_DATA* pPeriod = periodRecord();
+        pPeriod->transportState      = nState;
+        pPeriod->position            = *pPosition;
+    }
+    return nState;
+}
+
+void replayStart() {
+    if (s_bReplay)
+        return;
+    for (uint8_t port = 0; port < IO_PORTS; ++port)
+        s_aReplayMidi[port] = replayMidiCreate();
+    memset(&s_replayPeriod, 0, sizeof(s_replayPeriod));
+    s_bReplay = true;
+}
+
+void replayStop() {
+    if (!s_bReplay)
+        return;
+    s_bReplay = false;
+    for (uint8_t port = 0; port < IO_PORTS; ++port) {
+        replayMidiFree(s_aReplayMidi[port]);
+        s_aReplayMidi[port] = NULL;
+    }
+    memset(s_aOutputs, 0, sizeof(s_aOutputs));
+}
+
+bool replayIsRunning() { return s_bReplay; }
+
+bool replaySetPeriod(const CAPTURE_PERIOD_DATA* pPeriod) {
+    if (!s_bReplay || pPeriod->frames > REPLAY_MAX_FRAMES)
+        return false;
+    s_replayPeriod = *pPeriod;
+    for (uint8_t port = 0; port < IO_OUTPUTS; ++port)
+        replayMidiReset(s_aReplayMidi[port], pPeriod->frames, pPeriod->capacity[port]);
+    replayMidiReset(s_aReplayMidi[IO_PORT_INPUT], pPeriod->frames, 0);
+    return replayMidiFill(s_aReplayMidi[IO_PORT_INPUT], (const uint8_t*)(pPeriod + 1), pPeriod->events) != NULL;
+}
+
+void replayGetPeriodHashes(uint64_t* pOutput, uint64_t* pRecorder) {
+    *pOutput   = s_nReplayOutputHash;
+    *pRecorder = s_nReplayRecorderHash;
+}
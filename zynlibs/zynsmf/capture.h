@@ -0,0 +1,148 @@
+/*  Capture and replay of SMF player and recorder process inputs
+ *   The process thread reaches JACK only through the io* functions declared here. Normally they call JACK directly. During capture they also record
+ *   each period's inputs (MIDI input events, frame time, transport position) and hashes of its MIDI output and of the events it adds to the recorder
+ *   using the shared capture core (rtcapture.h). During replay the io* functions serve the recorded inputs from memory and ports are replay buffers.
+ */
+#pragma once
+
+#include "rtcapture.h"     //provides shared capture core
+#include <jack/jack.h>      //provides interface to JACK
+#include <jack/midiport.h>  //provides interface to JACK MIDI ports
+#include <jack/transport.h> //provides JACK transport
+
+#define CAPTURE_VERSION 1
+
+// Ports accessed by process thread (outputs are indexed by track route output)
+#define IO_OUTPUTS 16                // Quantity of MIDI output ports
+#define IO_PORT_INPUT IO_OUTPUTS     // MIDI input (recorder)
+#define IO_PORTS (IO_OUTPUTS + 1)
+
+// Process period record payload (followed by MIDI input events, each time:uint32, size:uint32, data)
+struct CAPTURE_PERIOD_DATA {
+    uint32_t period;                // Index of period since start of capture
+    jack_nframes_t frames;          // Quantity of frames in period
+    jack_nframes_t frameTime;       // JACK frame time at start of period
+    uint32_t transportState;        // JACK transport state
+    uint32_t events;                // Quantity of MIDI input events that follow
+    uint32_t pad;                   // Padding
+    uint32_t capacity[IO_OUTPUTS];  // Largest event that fits in each empty MIDI output buffer
+    uint64_t outputHash;            // Hash of MIDI outputs
+    uint64_t recorderHash;          // Hash of events added to recorder
+    jack_position_t position;       // JACK transport position
+};
+
+/** @brief  Register a JACK port (replay buffer during replay)
+ *   @param  pClient Pointer to JACK client
+ *   @param  name Port name
+ *   @param  flags JACK port flags
+ *   @param  port Port index [0..IO_OUTPUTS-1 | IO_PORT_INPUT]
+ *   @retval jack_port_t* Pointer to port or NULL on failure
+ */
+jack_port_t* ioRegisterPort(jack_client_t* pClient, const char* name, unsigned long flags, uint8_t port);
+
+/** @brief  Unregister a JACK port (ignored during replay)
+ *   @param  pClient Pointer to JACK client
+ *   @param  pPort Pointer to port
+ */
+void ioUnregisterPort(jack_client_t* pClient, jack_port_t* pPort);
+
+/** @brief  Start process period - call at start of each process callback
+ *   @param  nFrames Quantity of frames in period
+ */
+void ioBeginPeriod(jack_nframes_t nFrames);
+
+/** @brief  Record runtime state at start of first captured period - call from process thread after ioBeginPeriod when captureIsPending
+ *   @param  pState Pointer to state
+ *   @param  nSize Size of state
+ */
+void ioCaptureState(const void* pState, uint32_t nSize);
+
+/** @brief  End process period - call at end of each process callback, hashes outputs
+ */
+void ioEndPeriod();
+
+/** @brief  Get buffer of a port for this period
+ *   @param  pPort Pointer to port
+ *   @param  nFrames Quantity of frames in period
+ *   @retval void* Pointer to buffer
+ */
+void* ioGetBuffer(jack_port_t* pPort, jack_nframes_t nFrames);
+
+/** @brief  Clear MIDI output buffer
+ *   @param  pBuffer Pointer to buffer
+ *   @param  output Index of output
+ */
+void ioMidiClearBuffer(void* pBuffer, uint8_t output);
+
+/** @brief  Get quantity of events in MIDI buffer
+ *   @param  pBuffer Pointer to buffer
+ *   @retval uint32_t Quantity of events
+ */
+uint32_t ioMidiGetEventCount(void* pBuffer);
+
+/** @brief  Get event from MIDI input buffer (recorded during capture)
+ *   @param  pEvent Pointer to event to populate
+ *   @param  pBuffer Pointer to buffer
+ *   @param  index Index of event
+ *   @retval int 0 on success
+ */
+int ioMidiEventGet(jack_midi_event_t* pEvent, void* pBuffer, uint32_t index);
+
+/** @brief  Reserve space for event in MIDI buffer
+ *   @param  pBuffer Pointer to buffer
+ *   @param  nTime Offset of event within period
+ *   @param  nSize Size of event in bytes
+ *   @retval uint8_t* Pointer to event data or NULL if insufficient space
+ */
+uint8_t* ioMidiEventReserve(void* pBuffer, jack_nframes_t nTime, size_t nSize);
+
+/** @brief  Hash an event added to the recorder by the process thread
+ *   @param  nTime Time of event in ticks
+ *   @param  pData Pointer to MIDI message
+ *   @param  nSize Size of MIDI message
+ */
+void ioRecorded(uint32_t nTime, const uint8_t* pData, size_t nSize);
+
+/** @brief  Get JACK frame time at start of this period
+ *   @param  pClient Pointer to JACK client
+ *   @retval jack_nframes_t Frame time
+ */
+jack_nframes_t ioLastFrameTime(jack_client_t* pClient);
+
+/** @brief  Get current JACK frame time (frame time of last replayed period during replay)
+ *   @param  pClient Pointer to JACK client
+ *   @retval jack_nframes_t Frame time
+ */
+jack_nframes_t ioFrameTime(jack_client_t* pClient);
+
+/** @brief  Query transport (position of last replayed period during replay)
+ *   @param  pClient Pointer to JACK client
+ *   @param  pPosition Pointer to position to populate
+ *   @retval jack_transport_state_t Transport state
+ */
+jack_transport_state_t ioTransportQuery(jack_client_t* pClient, jack_position_t* pPosition);
+
+/** @brief  Start replay - io* functions serve recorded inputs
+ */
+void replayStart();
+
+/** @brief  Stop replay - io* functions return to JACK
+ */
+void replayStop();
+
+/** @brief  Check if replay is running
+ *   @retval bool True if replaying
+ */
+bool replayIsRunning();
+
+/** @brief  Set inputs of next replayed period
+ *   @param  pPeriod Pointer to period record payload
+ *   @retval bool True on success, false if period exceeds replay buffers
+ */
+bool replaySetPeriod(const CAPTURE_PERIOD_DATA* pPeriod);
+
+/** @brief  Get hashes of outputs from last replayed period
+ *   @param  pOutput Pointer to populate with MIDI output hash
+ *   @param  pRecorder Pointer to populate with recorder hash
+ */
+void replayGetPeriodHashes(uint64_t* pOutput, uint64_t* pRecorder);
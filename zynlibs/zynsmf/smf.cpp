@@ -3,8 +3,9 @@
 
 #include "smf.h"
 
-#include <cstring> //provides strcmp, memset
-#include <stdio.h> //provides printf
+#include <algorithm> //provides upper_bound
+#include <cstring>   //provides strcmp, memset
+#include <stdio.h>   //provides printf
 
 #define MAX_TRACKS 16 // Maximum quantity of tracks automatically created
 #define DPRINTF(fmt, args...)                                                                                                                                  \
@@ -109,6 +110,33 @@ uint32_t Smf::getMicrosecondsPerQuarterNote(uint32_t nTime) {
     return 500000; // Default value for 120bpm
 }
 
+void Smf::compileTempoMap() {
+    m_vTempoSegments.clear();
+    m_vTempoSegments.push_back({0, 500000, 0.0}); // Default value for 120bpm until first tempo change
+    for (auto it = m_mTempoMap.begin(); it != m_mTempoMap.end(); ++it) {
+        if (it->second == 0)
+            continue;
+        TEMPO_SEGMENT& last = m_vTempoSegments.back();
+        if (it->first == last.tick) {
+            last.tempo = it->second;
+            continue;
+        }
+        TEMPO_SEGMENT segment = {it->first, it->second, last.time + double(last.tempo) * (it->first - last.tick) / m_nTicksPerQuarterNote};
+        m_vTempoSegments.push_back(segment);
+    }
+}
+
+double Smf::getTimeAtTick(double dTick) {
+    if (m_vTempoSegments.empty())
+        return 500000.0 * dTick / m_nTicksPerQuarterNote;
+    // Find last segment starting at or before position
+    auto it = std::upper_bound(m_vTempoSegments.begin(), m_vTempoSegments.end(), dTick,
+                               [](double dValue, const TEMPO_SEGMENT& segment) { return dValue < segment.tick; });
+    if (it != m_vTempoSegments.begin())
+        --it;
+    return it->time + double(it->tempo) * (dTick - it->tick) / m_nTicksPerQuarterNote;
+}
+
 void Smf::muteTrack(size_t nTrack, bool bMute) {
     if (nTrack >= m_vTracks.size())
         return;
@@ -274,6 +302,7 @@ bool Smf::load(char* sFilename) {
     }
 
     fclose(pFile);
+    compileTempoMap();
     setPosition(0);
 
     return true;
@@ -352,6 +381,8 @@ void Smf::unload() {
     for (auto it = m_vTracks.begin(); it != m_vTracks.end(); ++it)
         delete (*it);
     m_vTracks.clear();
+    m_mTempoMap.clear();
+    m_vTempoSegments.clear();
     m_bTimecodeBased       = false;
     m_nFormat              = 0;
     m_nTracks              = 0;
@@ -383,23 +414,34 @@ Event* Smf::getEvent(bool bAdvance) {
 }
 
 void Smf::addEvent(size_t nTrack, Event* pEvent) {
-    if (nTrack >= m_vTracks.size()) {
-        if (nTrack > MAX_TRACKS)
-            return;
-        while (m_vTracks.size() <= nTrack)
-            addTrack();
-    }
+    if (nTrack >= m_vTracks.size() && nTrack > MAX_TRACKS)
+        return;
+    // Track schedule and tempo segments may reallocate so must not be read by playback
+    pthread_mutex_lock(&m_mutex);
+    while (m_vTracks.size() <= nTrack)
+        addTrack();
     m_vTracks[nTrack]->addEvent(pEvent);
     if (pEvent->getTime() > m_nDurationInTicks)
         m_nDurationInTicks = pEvent->getTime();
+    if (pEvent->getType() == EVENT_TYPE_META && pEvent->getSubtype() == 0x51) {
+        m_mTempoMap[pEvent->getTime()] = pEvent->getInt32();
+        compileTempoMap();
+    }
+    pthread_mutex_unlock(&m_mutex);
 }
 
+bool Smf::tryLock() { return pthread_mutex_trylock(&m_mutex) == 0; }
+
+void Smf::unlock() { pthread_mutex_unlock(&m_mutex); }
+
 void Smf::setPosition(size_t nTime) {
     for (auto it = m_vTracks.begin(); it != m_vTracks.end(); ++it)
         (*it)->setPosition(nTime);
     m_nPosition = nTime;
 }
 
+size_t Smf::getPosition() { return m_nPosition; }
+
 size_t Smf::getTracks() { return m_vTracks.size(); }
 
 size_t Smf::addTrack() {
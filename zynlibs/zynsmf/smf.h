@@ -5,9 +5,17 @@
 #include "track.h" //provides Track class
 #include <cstdio>  //provides FILE
 #include <map>     //provides map class
+#include <pthread.h> //provides mutex
 #include <string>  //provides string
 #include <vector>  //provides vector class
 
+// Segment of compiled tempo map with constant tempo
+struct TEMPO_SEGMENT {
+    uint32_t tick;  // Start of segment in ticks
+    uint32_t tempo; // Duration of quarter note in microseconds
+    double time;    // Start of segment in microseconds from start of song
+};
+
 class Smf {
   public:
     /** Deconstruct SMF object */
@@ -66,15 +74,31 @@ class Smf {
      *   @param  nTrack Index of track to add event to (new tracks created if required)
      *   @param  pEvent Pointer to an event object
      *   @note   Events are appended to end of track so must have appropriate time parameter
+     *   @note   Waits whilst playback holds lock
      */
     void addEvent(size_t nTrack, Event* pEvent);
 
+    /** @brief  Try to get exclusive access to events and tempo map without waiting
+     *   @retval bool True if access granted - call unlock() when done
+     *   @note   Used by real-time playback so that it does not read whilst events are added
+     */
+    bool tryLock();
+
+    /** @brief  Release exclusive access obtained with tryLock
+     */
+    void unlock();
+
     /** @brief  Set event cursor position to time
      *   @param  nTime Time in milliseconds
      *   @todo   Should Smf class setPosition be in ticks, seconds, microseconds?
      */
     void setPosition(size_t nTime);
 
+    /** @brief  Get event cursor position
+     *   @retval size_t Time of last event retrieved with advance or set by setPosition in ticks
+     */
+    size_t getPosition();
+
     /** @brief  Get MIDI file format
      *   @retval uint8_t SMF format [0|1|2]
      */
@@ -103,6 +127,13 @@ class Smf {
      */
     uint32_t getMicrosecondsPerQuarterNote(uint32_t nTime);
 
+    /** @brief  Get time from start of song at a position, following tempo changes
+     *   @param  dTick Position in ticks
+     *   @retval double Microseconds from start of song
+     *   @note   Uses binary search of tempo map compiled when file is loaded or tempo events added
+     */
+    double getTimeAtTick(double dTick);
+
     /** @brief  Mute a track
      *   @param  nTrack Index of track to mute
      *   @param  bMute True to mute, false to unmute
@@ -184,9 +215,15 @@ class Smf {
      */
     size_t fileReadString(char* pString, size_t nSize, FILE* pFile);
 
+    /** @brief  Populate tempo segments from tempo map
+     */
+    void compileTempoMap();
+
     std::vector<Track*> m_vTracks;            // Vector of tracks within SMF
     std::map<uint32_t, uint32_t> m_mTempoMap; // Map of tempo changes (duration of quarter note in microseconds) indexed by time in ticks
+    std::vector<TEMPO_SEGMENT> m_vTempoSegments; // Tempo map compiled to cumulative time of each tempo change, ordered by time
     std::string m_sFilename;                  // Full path and filename
+    pthread_mutex_t m_mutex = PTHREAD_MUTEX_INITIALIZER; // Protects tracks and tempo map whilst events are added
     bool m_bDebug = false;                    // True for debug output
     bool m_bTimecodeBased;                    // True for timecode based time. False for metrical based time.
     uint16_t m_nFormat              = 0;      // MIDI file format [0|1|2]
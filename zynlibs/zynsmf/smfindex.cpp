@@ -0,0 +1,455 @@
+/** Implementation of standard MIDI file index class
+ */
+
+#include "smfindex.h"
+
+#include <algorithm>  //provides sort
+#include <cstring>    //provides strcmp, memset
+#include <dirent.h>   //provides opendir, readdir
+#include <stdio.h>    //provides printf
+#include <strings.h>  //provides strcasecmp
+#include <sys/stat.h> //provides stat
+
+#define INDEX_MAGIC "ZSMI" // Identifier at start of index cache file
+#define INDEX_VERSION 1    // Version of index cache file format
+#define DPRINTF(fmt, args...)                                                                                                                                  \
+    if (m_bDebug)                                                                                                                                              \
+    fprintf(stderr, fmt, ##args)
+
+SmfIndex::SmfIndex() {}
+
+SmfIndex::~SmfIndex() {
+    pthread_mutex_lock(&m_mutex);
+    m_bRunning = false;
+    m_dqQueue.clear();
+    pthread_cond_signal(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+    if (m_bThread)
+        pthread_join(m_thread, NULL);
+}
+
+void SmfIndex::enableDebug(bool bEnable) { m_bDebug = bEnable; }
+
+// Private helper functions
+
+// Return true if filename has a SMF extension
+static bool isSmfFilename(const char* sName) {
+    const char* sExt = strrchr(sName, '.');
+    if (!sExt)
+        return false;
+    return strcasecmp(sExt, ".mid") == 0 || strcasecmp(sExt, ".midi") == 0 || strcasecmp(sExt, ".smf") == 0 || strcasecmp(sExt, ".kar") == 0;
+}
+
+// Read variable length number from buffer, advancing cursor. Returns false if buffer overrun.
+static bool readVar(const uint8_t*& pData, const uint8_t* pEnd, uint32_t& nValue) {
+    nValue = 0;
+    for (int i = 0; i < 4; ++i) {
+        if (pData >= pEnd)
+            return false;
+        uint8_t nByte = *pData++;
+        nValue        = (nValue << 7) | (nByte & 0x7F);
+        if ((nByte & 0x80) == 0)
+            return true;
+    }
+    return true;
+}
+
+// Read big-endian word of nBytes from buffer
+static uint32_t readBE(const uint8_t* pData, uint8_t nBytes) {
+    uint32_t nValue = 0;
+    for (uint8_t i = 0; i < nBytes; ++i)
+        nValue = (nValue << 8) | pData[i];
+    return nValue;
+}
+
+bool SmfIndex::parse(const char* sFilename, SMF_INFO* pInfo, std::vector<std::string>* pvNames) {
+    memset(pInfo, 0, sizeof(SMF_INFO));
+    pInfo->timeSigNumerator   = 4;
+    pInfo->timeSigDenominator = 4;
+    pInfo->tempo              = 120.0;
+    pvNames->clear();
+
+    // Read whole file with a single read - SMF are small and this avoids per-byte file access
+    FILE* pFile = fopen(sFilename, "r");
+    if (pFile == NULL) {
+        DPRINTF("Failed to open file '%s'\n", sFilename);
+        return false;
+    }
+    fseek(pFile, 0, SEEK_END);
+    long nFileSize = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+    if (nFileSize < 14) {
+        fclose(pFile);
+        return false;
+    }
+    std::vector<uint8_t> vData(nFileSize);
+    size_t nRead = fread(vData.data(), 1, nFileSize, pFile);
+    fclose(pFile);
+    if (nRead != size_t(nFileSize) || memcmp(vData.data(), "MThd", 4) != 0) {
+        DPRINTF("'%s' is not a standard MIDI file\n", sFilename);
+        return false;
+    }
+
+    const uint8_t* pData = vData.data();
+    const uint8_t* pEof  = pData + nRead;
+    uint16_t nDivision   = 0;
+    bool bFirstTempo     = true;
+    bool bFirstTimeSig   = true;
+    bool bFirstKey       = true;
+    std::vector<std::pair<uint32_t, uint32_t>> vTempoMap; // Vector of (time in ticks, microseconds per quarter note)
+
+    // Iterate each block within IFF file
+    while (pEof - pData >= 8) {
+        uint32_t nBlockSize = readBE(pData + 4, 4);
+        const uint8_t* pEnd = pData + 8 + nBlockSize;
+        if (nBlockSize > size_t(pEof - pData - 8))
+            pEnd = pEof; // Truncated file - index what is present
+        if (memcmp(pData, "MThd", 4) == 0 && nBlockSize >= 6) {
+            pInfo->format = readBE(pData + 8, 2);
+            nDivision     = readBE(pData + 12, 2);
+        } else if (memcmp(pData, "MTrk", 4) == 0) {
+            const uint8_t* pCursor = pData + 8;
+            uint32_t nPosition     = 0;
+            uint8_t nRunningStatus = 0;
+            std::string sName;
+            while (pCursor < pEnd) {
+                uint32_t nDelta, nLength;
+                if (!readVar(pCursor, pEnd, nDelta) || pCursor >= pEnd)
+                    break;
+                nPosition += nDelta;
+                uint8_t nStatus = *pCursor;
+                if (nStatus & 0x80)
+                    ++pCursor;
+                else
+                    nStatus = nRunningStatus;
+                if (nStatus == 0xFF) {
+                    // Meta event
+                    if (pCursor >= pEnd)
+                        break;
+                    uint8_t nMetaType = *pCursor++;
+                    if (!readVar(pCursor, pEnd, nLength) || nLength > size_t(pEnd - pCursor))
+                        break;
+                    switch (nMetaType) {
+                    case 0x03: // Track name
+                        if (sName.empty())
+                            sName.assign((const char*)pCursor, nLength);
+                        break;
+                    case 0x51: // Tempo
+                        if (nLength >= 3) {
+                            uint32_t nTempo = readBE(pCursor, 3);
+                            vTempoMap.push_back(std::pair<uint32_t, uint32_t>(nPosition, nTempo));
+                            ++pInfo->tempoChanges;
+                            if (bFirstTempo && nTempo)
+                                pInfo->tempo = 60000000.0 / nTempo;
+                            bFirstTempo = false;
+                        }
+                        break;
+                    case 0x58: // Time signature
+                        if (nLength >= 2 && bFirstTimeSig) {
+                            pInfo->timeSigNumerator   = pCursor[0];
+                            pInfo->timeSigDenominator = 1 << (pCursor[1] & 0x07);
+                            bFirstTimeSig             = false;
+                        }
+                        break;
+                    case 0x59: // Key signature
+                        if (nLength >= 2 && bFirstKey) {
+                            pInfo->keySharps = int8_t(pCursor[0]);
+                            pInfo->keyMinor  = pCursor[1] ? 1 : 0;
+                            bFirstKey        = false;
+                        }
+                        break;
+                    }
+                    pCursor += nLength;
+                    nRunningStatus = 0;
+                } else if (nStatus == 0xF0 || nStatus == 0xF7) {
+                    // SysEx or escape sequence - skip data
+                    if (!readVar(pCursor, pEnd, nLength) || nLength > size_t(pEnd - pCursor))
+                        break;
+                    pCursor += nLength;
+                    nRunningStatus = 0;
+                } else if (nStatus >= 0x80) {
+                    // MIDI event - skip data
+                    nRunningStatus = nStatus;
+                    pCursor += ((nStatus & 0xE0) == 0xC0) ? 1 : 2;
+                } else {
+                    DPRINTF("Unexpected data 0x%02X in '%s'\n", nStatus, sFilename);
+                    break;
+                }
+                ++pInfo->events;
+            }
+            pvNames->push_back(sName);
+            ++pInfo->tracks;
+            if (nPosition > pInfo->durationTicks)
+                pInfo->durationTicks = nPosition;
+        }
+        pData = pEnd;
+    }
+
+    if (nDivision & 0x8000) {
+        // SMPTE timebase: ticks are fixed fractions of a second
+        uint8_t nFps        = -int8_t(nDivision >> 8);
+        uint8_t nResolution = nDivision & 0xFF;
+        if (nFps && nResolution)
+            pInfo->duration = double(pInfo->durationTicks) / (nFps * nResolution);
+        return true;
+    }
+    pInfo->ticksPerQuarterNote = nDivision;
+    if (nDivision == 0)
+        return true;
+
+    // Sum duration of each tempo segment up to end of longest track
+    std::stable_sort(vTempoMap.begin(), vTempoMap.end(),
+                     [](const std::pair<uint32_t, uint32_t>& a, const std::pair<uint32_t, uint32_t>& b) { return a.first < b.first; });
+    double dMicroseconds = 0.0;
+    uint32_t nTime       = 0;
+    uint32_t nTempo      = 500000; // Default value for 120bpm
+    for (auto it = vTempoMap.begin(); it != vTempoMap.end() && it->first < pInfo->durationTicks; ++it) {
+        dMicroseconds += double(nTempo) * (it->first - nTime) / nDivision;
+        nTime  = it->first;
+        nTempo = it->second;
+    }
+    dMicroseconds += double(nTempo) * (pInfo->durationTicks - nTime) / nDivision;
+    pInfo->duration = dMicroseconds / 1000000;
+    return true;
+}
+
+void SmfIndex::indexFile(const std::string& sPath, int64_t nMtime, int64_t nSize) {
+    pthread_mutex_lock(&m_mutex);
+    auto it        = m_mEntries.find(sPath);
+    bool bUpToDate = (it != m_mEntries.end() && it->second.mtime == nMtime && it->second.size == nSize);
+    pthread_mutex_unlock(&m_mutex);
+    if (bUpToDate)
+        return;
+
+    // Parse without lock so that queries are not blocked by file access
+    ENTRY entry;
+    entry.mtime = nMtime;
+    entry.size  = nSize;
+    if (!parse(sPath.c_str(), &entry.info, &entry.vNames))
+        return;
+    entry.info.valid = 1;
+    DPRINTF("Indexed '%s' %u tracks %0.1fs\n", sPath.c_str(), entry.info.tracks, entry.info.duration);
+
+    pthread_mutex_lock(&m_mutex);
+    m_mEntries[sPath] = entry;
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void SmfIndex::indexPath(const std::string& sPath, bool bRecursive) {
+    struct stat fileStat;
+    if (stat(sPath.c_str(), &fileStat))
+        return;
+    if (!S_ISDIR(fileStat.st_mode)) {
+        indexFile(sPath, fileStat.st_mtime, fileStat.st_size);
+        return;
+    }
+    DIR* pDir = opendir(sPath.c_str());
+    if (!pDir)
+        return;
+    std::vector<std::string> vSubdirs;
+    while (struct dirent* pEntry = readdir(pDir)) {
+        if (pEntry->d_name[0] == '.')
+            continue;
+        std::string sChild = sPath + "/" + pEntry->d_name;
+        if (stat(sChild.c_str(), &fileStat))
+            continue;
+        if (S_ISDIR(fileStat.st_mode)) {
+            if (bRecursive)
+                vSubdirs.push_back(sChild);
+        } else if (isSmfFilename(pEntry->d_name)) {
+            indexFile(sChild, fileStat.st_mtime, fileStat.st_size);
+        }
+        if (!m_bRunning)
+            break;
+    }
+    closedir(pDir);
+    for (auto it = vSubdirs.begin(); it != vSubdirs.end() && m_bRunning; ++it)
+        indexPath(*it, true);
+}
+
+void* SmfIndex::threadFn(void* pIndex) {
+    SmfIndex* pThis = (SmfIndex*)pIndex;
+    pthread_mutex_lock(&pThis->m_mutex);
+    while (pThis->m_bRunning) {
+        if (pThis->m_dqQueue.empty()) {
+            pthread_cond_wait(&pThis->m_cond, &pThis->m_mutex);
+            continue;
+        }
+        std::pair<std::string, bool> path = pThis->m_dqQueue.front();
+        pThis->m_dqQueue.pop_front();
+        pThis->m_bBusy = true;
+        pthread_mutex_unlock(&pThis->m_mutex);
+        pThis->indexPath(path.first, path.second);
+        pthread_mutex_lock(&pThis->m_mutex);
+        pThis->m_bBusy = false;
+    }
+    pthread_mutex_unlock(&pThis->m_mutex);
+    return NULL;
+}
+
+/*** Public functions ***/
+
+bool SmfIndex::addPath(const char* sPath, bool bRecursive) {
+    if (!sPath || !sPath[0])
+        return false;
+    std::string sClean(sPath);
+    while (sClean.size() > 1 && sClean.back() == '/')
+        sClean.pop_back();
+    pthread_mutex_lock(&m_mutex);
+    if (!m_bThread) {
+        if (pthread_create(&m_thread, NULL, threadFn, this)) {
+            pthread_mutex_unlock(&m_mutex);
+            fprintf(stderr, "Failed to create SMF index thread\n");
+            return false;
+        }
+        m_bThread = true;
+    }
+    m_dqQueue.push_back(std::pair<std::string, bool>(sClean, bRecursive));
+    pthread_cond_signal(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+    return true;
+}
+
+uint32_t SmfIndex::getPending() {
+    pthread_mutex_lock(&m_mutex);
+    uint32_t nPending = m_dqQueue.size() + (m_bBusy ? 1 : 0);
+    pthread_mutex_unlock(&m_mutex);
+    return nPending;
+}
+
+uint32_t SmfIndex::query(const char** asPaths, uint32_t nCount, SMF_INFO* pInfo) {
+    uint32_t nValid = 0;
+    std::vector<const char*> vStale;
+    pthread_mutex_lock(&m_mutex);
+    for (uint32_t i = 0; i < nCount; ++i) {
+        memset(&pInfo[i], 0, sizeof(SMF_INFO));
+        if (!asPaths[i])
+            continue;
+        struct stat fileStat;
+        if (stat(asPaths[i], &fileStat))
+            continue;
+        auto it = m_mEntries.find(asPaths[i]);
+        if (it == m_mEntries.end() || it->second.mtime != fileStat.st_mtime || it->second.size != fileStat.st_size) {
+            vStale.push_back(asPaths[i]);
+            continue;
+        }
+        pInfo[i] = it->second.info;
+        ++nValid;
+    }
+    pthread_mutex_unlock(&m_mutex);
+    for (auto it = vStale.begin(); it != vStale.end(); ++it)
+        addPath(*it, false);
+    return nValid;
+}
+
+size_t SmfIndex::getTrackName(const char* sPath, uint16_t nTrack, char* sName, size_t nSize) {
+    if (!sName || nSize == 0)
+        return 0;
+    sName[0]       = '\0';
+    size_t nLength = 0;
+    pthread_mutex_lock(&m_mutex);
+    auto it = m_mEntries.find(sPath);
+    if (it != m_mEntries.end() && nTrack < it->second.vNames.size()) {
+        const std::string& sTrackName = it->second.vNames[nTrack];
+        nLength                       = std::min(sTrackName.size(), nSize - 1);
+        memcpy(sName, sTrackName.c_str(), nLength);
+        sName[nLength] = '\0';
+    }
+    pthread_mutex_unlock(&m_mutex);
+    return nLength;
+}
+
+void SmfIndex::clear() {
+    pthread_mutex_lock(&m_mutex);
+    m_dqQueue.clear();
+    m_mEntries.clear();
+    pthread_mutex_unlock(&m_mutex);
+}
+
+// Cache file format: magic, version, sizeof(SMF_INFO), quantity of entries then for each entry:
+// path length (uint16), path, mtime (int64), size (int64), SMF_INFO, quantity of names (uint16), [name length (uint16), name]...
+
+bool SmfIndex::save(const char* sFilename) {
+    FILE* pFile = fopen(sFilename, "w");
+    if (pFile == NULL) {
+        DPRINTF("Failed to open file '%s'\n", sFilename);
+        return false;
+    }
+    uint32_t anHeader[] = {INDEX_VERSION, sizeof(SMF_INFO), 0};
+    fwrite(INDEX_MAGIC, 4, 1, pFile);
+    pthread_mutex_lock(&m_mutex);
+    anHeader[2] = m_mEntries.size();
+    fwrite(anHeader, sizeof(anHeader), 1, pFile);
+    for (auto it = m_mEntries.begin(); it != m_mEntries.end(); ++it) {
+        uint16_t nLength = it->first.size();
+        fwrite(&nLength, sizeof(nLength), 1, pFile);
+        fwrite(it->first.c_str(), nLength, 1, pFile);
+        fwrite(&it->second.mtime, sizeof(int64_t), 1, pFile);
+        fwrite(&it->second.size, sizeof(int64_t), 1, pFile);
+        fwrite(&it->second.info, sizeof(SMF_INFO), 1, pFile);
+        uint16_t nNames = it->second.vNames.size();
+        fwrite(&nNames, sizeof(nNames), 1, pFile);
+        for (auto itName = it->second.vNames.begin(); itName != it->second.vNames.end(); ++itName) {
+            nLength = itName->size();
+            fwrite(&nLength, sizeof(nLength), 1, pFile);
+            fwrite(itName->c_str(), nLength, 1, pFile);
+        }
+    }
+    pthread_mutex_unlock(&m_mutex);
+    bool bSuccess = (ferror(pFile) == 0);
+    fclose(pFile);
+    return bSuccess;
+}
+
+bool SmfIndex::load(const char* sFilename) {
+    FILE* pFile = fopen(sFilename, "r");
+    if (pFile == NULL) {
+        DPRINTF("Failed to open file '%s'\n", sFilename);
+        return false;
+    }
+    char sMagic[4];
+    uint32_t anHeader[3];
+    if (fread(sMagic, 4, 1, pFile) != 1 || memcmp(sMagic, INDEX_MAGIC, 4) != 0 || fread(anHeader, sizeof(anHeader), 1, pFile) != 1 ||
+        anHeader[0] != INDEX_VERSION || anHeader[1] != sizeof(SMF_INFO)) {
+        fprintf(stderr, "Unsupported SMF index file '%s'\n", sFilename);
+        fclose(pFile);
+        return false;
+    }
+
+    // Read to temporary map so that a corrupt file does not leave a partial index
+    std::map<std::string, ENTRY> mEntries;
+    bool bSuccess = true;
+    std::string sPath;
+    for (uint32_t nEntry = 0; nEntry < anHeader[2] && bSuccess; ++nEntry) {
+        ENTRY entry;
+        uint16_t nLength, nNames;
+        bSuccess = fread(&nLength, sizeof(nLength), 1, pFile) == 1;
+        sPath.resize(nLength);
+        bSuccess = bSuccess && (nLength == 0 || fread(&sPath[0], nLength, 1, pFile) == 1);
+        bSuccess = bSuccess && fread(&entry.mtime, sizeof(int64_t), 1, pFile) == 1;
+        bSuccess = bSuccess && fread(&entry.size, sizeof(int64_t), 1, pFile) == 1;
+        bSuccess = bSuccess && fread(&entry.info, sizeof(SMF_INFO), 1, pFile) == 1;
+        bSuccess = bSuccess && fread(&nNames, sizeof(nNames), 1, pFile) == 1;
+        for (uint16_t nName = 0; bSuccess && nName < nNames; ++nName) {
+            std::string sName;
+            bSuccess = fread(&nLength, sizeof(nLength), 1, pFile) == 1;
+            sName.resize(nLength);
+            bSuccess = bSuccess && (nLength == 0 || fread(&sName[0], nLength, 1, pFile) == 1);
+            entry.vNames.push_back(sName);
+        }
+        if (bSuccess)
+            mEntries[sPath] = entry;
+    }
+    fclose(pFile);
+    if (!bSuccess) {
+        fprintf(stderr, "Corrupt SMF index file '%s'\n", sFilename);
+        return false;
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it)
+        m_mEntries[it->first] = it->second;
+    pthread_mutex_unlock(&m_mutex);
+    DPRINTF("Loaded %lu entries from SMF index '%s'\n", mEntries.size(), sFilename);
+    return true;
+}
@@ -0,0 +1,135 @@
+/** Class providing a cache of Standard MIDI File summaries for fast browsing
+ *   Files are scanned by a worker thread which reads only the header and meta events of each file.
+ *   Summaries are keyed by path and validated against file modification time and size.
+ */
+#pragma once
+
+#include <cstdint>    //provides uint data types
+#include <deque>      //provides deque class
+#include <map>        //provides map class
+#include <pthread.h>  //provides multithreading
+#include <string>     //provides string
+#include <vector>     //provides vector class
+
+// Summary of a SMF returned by batch queries (C compatible layout)
+struct SMF_INFO {
+    uint8_t valid;                // 1 if file is indexed and up to date, 0 if not (yet) indexed
+    uint8_t format;               // SMF format [0|1|2]
+    uint16_t tracks;              // Quantity of MTrk chunks
+    uint16_t ticksPerQuarterNote; // Ticks per quarter note
+    uint8_t timeSigNumerator;     // Numerator of first time signature (4 if not specified)
+    uint8_t timeSigDenominator;   // Denominator of first time signature (4 if not specified)
+    int8_t keySharps;             // Quantity of sharps (+ve) or flats (-ve) of first key signature
+    uint8_t keyMinor;             // 1 if first key signature is minor
+    uint32_t tempoChanges;        // Quantity of tempo meta events
+    uint32_t events;              // Quantity of events in all tracks
+    uint32_t durationTicks;       // Duration of longest track in ticks
+    double tempo;                 // Initial tempo in BPM
+    double duration;              // Duration of longest track in seconds
+};
+
+class SmfIndex {
+  public:
+    /** Construct SMF index */
+    SmfIndex();
+
+    /** Deconstruct SMF index, stopping worker thread */
+    ~SmfIndex();
+
+    /** @brief  Enable debug output
+     *   @param  bEnable True to enable, false to disable debug output (Default: true)
+     */
+    void enableDebug(bool bEnable = true);
+
+    /** @brief  Queue a directory or file to be indexed by the worker thread
+     *   @param  sPath Full path of directory or SMF
+     *   @param  bRecursive True to also index subdirectories
+     *   @retval bool True if queued
+     *   @note   Files already indexed with unchanged modification time and size are skipped
+     */
+    bool addPath(const char* sPath, bool bRecursive);
+
+    /** @brief  Get quantity of paths waiting to be indexed
+     *   @retval uint32_t Quantity of queued directories and files, including any being scanned
+     */
+    uint32_t getPending();
+
+    /** @brief  Get summaries of a batch of files
+     *   @param  asPaths Array of full paths of SMF
+     *   @param  nCount Quantity of paths
+     *   @param  pInfo Array of nCount SMF_INFO structures to populate
+     *   @retval uint32_t Quantity of files that are indexed and up to date
+     *   @note   Files that are not indexed or have changed are queued for indexing and marked not valid
+     */
+    uint32_t query(const char** asPaths, uint32_t nCount, SMF_INFO* pInfo);
+
+    /** @brief  Get name of a track in an indexed file
+     *   @param  sPath Full path of SMF
+     *   @param  nTrack Index of track
+     *   @param  sName Buffer to populate with null terminated name
+     *   @param  nSize Size of buffer
+     *   @retval size_t Length of name or 0 if not indexed or no name
+     */
+    size_t getTrackName(const char* sPath, uint16_t nTrack, char* sName, size_t nSize);
+
+    /** @brief  Save index to file
+     *   @param  sFilename Full path and name of cache file
+     *   @retval bool True on success
+     */
+    bool save(const char* sFilename);
+
+    /** @brief  Load index from file, merging with existing entries
+     *   @param  sFilename Full path and name of cache file
+     *   @retval bool True on success
+     */
+    bool load(const char* sFilename);
+
+    /** @brief  Remove all entries from index and clear pending queue
+     */
+    void clear();
+
+    /** @brief  Parse header and meta events of a SMF without storing events
+     *   @param  sFilename Full path of SMF
+     *   @param  pInfo Pointer to summary to populate
+     *   @param  pvNames Pointer to vector to populate with track names
+     *   @retval bool True on success
+     */
+    bool parse(const char* sFilename, SMF_INFO* pInfo, std::vector<std::string>* pvNames);
+
+  private:
+    // Cached summary of a file
+    struct ENTRY {
+        int64_t mtime = 0;                // File modification time
+        int64_t size  = 0;                // File size in bytes
+        SMF_INFO info;                    // Summary
+        std::vector<std::string> vNames;  // Track names
+    };
+
+    /** @brief  Worker thread function
+     *   @param  pIndex Pointer to the SmfIndex object
+     */
+    static void* threadFn(void* pIndex);
+
+    /** @brief  Index a directory or file
+     *   @param  sPath Full path of directory or SMF
+     *   @param  bRecursive True to index subdirectories
+     */
+    void indexPath(const std::string& sPath, bool bRecursive);
+
+    /** @brief  Index a file if not already indexed and up to date
+     *   @param  sPath Full path of SMF
+     *   @param  nMtime File modification time
+     *   @param  nSize File size
+     */
+    void indexFile(const std::string& sPath, int64_t nMtime, int64_t nSize);
+
+    std::map<std::string, ENTRY> m_mEntries;             // Map of summaries indexed by path
+    std::deque<std::pair<std::string, bool>> m_dqQueue;  // Queue of paths to index and recursive flag
+    pthread_mutex_t m_mutex = PTHREAD_MUTEX_INITIALIZER; // Protects entries, queue and busy flag
+    pthread_cond_t m_cond   = PTHREAD_COND_INITIALIZER;  // Signalled when paths are queued or on exit
+    pthread_t m_thread;                                  // Worker thread
+    bool m_bThread  = false;                             // True if worker thread started
+    bool m_bRunning = true;                              // False to stop worker thread
+    bool m_bBusy    = false;                             // True whilst worker is indexing a path
+    bool m_bDebug   = false;                             // True for debug output
+};
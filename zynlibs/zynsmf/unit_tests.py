@@ -3,6 +3,8 @@
 # Unit tests for zynsmf
 # Tests use two letters to define order of groups and two digit integer to define order within group
 
+import subprocess
+import sys
 import unittest
 import jack
 from time import sleep
@@ -12,6 +14,8 @@ from zynlibs.zynsmf.zynsmf import libsmf
 
 smf = None
 client = jack.Client("zynsmf_unittest")
+midi_in = client.midi_inports.register("midi_in")
+midi_rec = None  # List of (frame time, message) received from player or None
 
 STOPPED = 0
 STARTING = 1
@@ -19,6 +23,16 @@ PLAYING = 2
 STOPPING = 3
 
 
+@client.set_process_callback
+def process(frames):
+    if midi_rec is not None:
+        for offset, data in midi_in.incoming_midi_events():
+            midi_rec.append((client.last_frame_time + offset, bytes(data)))
+
+
+client.activate()
+
+
 class TestLibZynSmf(unittest.TestCase):
     @classmethod
     def setUpClass(self):
@@ -94,5 +108,112 @@ class TestLibZynSmf(unittest.TestCase):
         self.assertEqual(client.transport_state, jack.STOPPED)
         self.assertEqual(libsmf.getPlayState(), STOPPED)
 
+    def test_ab03_playback_rate(self):
+        global midi_rec
+        self.assertTrue(zynsmf.load(smf, "./test.mid"))
+        self.assertTrue(libsmf.attachPlayer(smf))
+        libsmf.setPlaybackRate(0.8)
+        self.assertAlmostEqual(libsmf.getPlaybackRate(), 0.8)
+        libsmf.setPlaybackRate(0)
+        self.assertAlmostEqual(libsmf.getPlaybackRate(), 0.8)
+        libsmf.setPlaybackTempo(60.0)
+        self.assertAlmostEqual(libsmf.getPlaybackTempo(), 60.0)
+        self.assertAlmostEqual(libsmf.getPlaybackRate(), 60.0 / libsmf.getTempo(smf, 0))
+        libsmf.setTransportTempoFollow(False)
+        self.assertFalse(libsmf.getTransportTempoFollow())
+        libsmf.setTransportTempoFollow(True)
+        # Events play at times from tempo map scaled by playback rate: 120 BPM for first beat then 240 BPM
+        libsmf.unload(smf)
+        ppqn = libsmf.getTicksPerQuarterNote(smf)
+        libsmf.addTempo(smf, 0, 120.0)
+        libsmf.addTempo(smf, ppqn, 240.0)
+        libsmf.addNote(smf, 0, 0, ppqn // 4, 0, 60, 100)
+        libsmf.addNote(smf, 0, ppqn, ppqn // 4, 0, 62, 100)
+        libsmf.addNote(smf, 0, 2 * ppqn, ppqn // 4, 0, 64, 100)
+        libsmf.setEndOfTrack(smf, 0, 3 * ppqn)
+        libsmf.setPosition(smf, 0)
+        libsmf.setPlaybackRate(2.0)
+        midi_in.connect('zynsmf:midi_out')
+        midi_rec = []
+        libsmf.startPlayback()
+        client.transport_start()
+        sleep(0.6)
+        libsmf.stopPlayback()
+        client.transport_stop()
+        sleep(0.1)
+        midi_in.disconnect('zynsmf:midi_out')
+        starts = {msg[1]: frame for frame, msg in midi_rec if msg[0] == 0x90 and msg[2]}
+        midi_rec = None
+        self.assertEqual(sorted(starts), [60, 62, 64])
+        self.assertAlmostEqual(starts[62] - starts[60], 0.25 * client.samplerate, delta=2)
+        self.assertAlmostEqual(starts[64] - starts[60], 0.375 * client.samplerate, delta=2)
+        libsmf.setPlaybackRate(1.0)
+        libsmf.removePlayer()
+
+    def test_ac00_track_routes(self):
+        self.assertTrue(libsmf.setTrackOutput(1, 2))
+        self.assertEqual(libsmf.getTrackOutput(1), 2)
+        self.assertFalse(libsmf.setTrackOutput(1, 16))
+        libsmf.setTrackChannel(1, 9)
+        self.assertEqual(libsmf.getTrackChannel(1), 9)
+        libsmf.setTrackChannel(1, 16)
+        self.assertEqual(libsmf.getTrackChannel(1), 9)
+        libsmf.setTrackTranspose(1, -12)
+        self.assertEqual(libsmf.getTrackTranspose(1), -12)
+        libsmf.setTrackVelocityCurve(1, 120)
+        self.assertEqual(libsmf.getTrackVelocityCurve(1), 100)
+        self.assertEqual(libsmf.getTrackOutput(0), 0)
+        libsmf.resetTrackRoutes()
+        self.assertEqual(libsmf.getTrackOutput(1), 0)
+        self.assertEqual(libsmf.getTrackChannel(1), -1)
+        self.assertEqual(libsmf.getTrackTranspose(1), 0)
+        self.assertEqual(libsmf.getTrackVelocityCurve(1), 0)
+
+    def test_ad00_index(self):
+        libsmf.clearIndex()
+        info = zynsmf.query_index(["./test.mid"])
+        self.assertEqual(info[0].valid, 0)
+        for i in range(100):
+            if libsmf.getIndexPending() == 0:
+                break
+            sleep(0.01)
+        info = zynsmf.query_index(["./test.mid", "./missing.mid"])
+        self.assertEqual(info[0].valid, 1)
+        self.assertEqual(info[1].valid, 0)
+        self.assertEqual(info[0].tracks, libsmf.getTracks(smf))
+        self.assertEqual(info[0].ticksPerQuarterNote, libsmf.getTicksPerQuarterNote(smf))
+        self.assertTrue(zynsmf.save_index("/tmp/zynsmf_index"))
+        libsmf.clearIndex()
+        self.assertTrue(zynsmf.load_index("/tmp/zynsmf_index"))
+        self.assertEqual(zynsmf.query_index(["./test.mid"])[0].valid, 1)
+
+    def test_ae00_capture(self):
+        self.assertTrue(zynsmf.load(smf, "./test.mid"))
+        self.assertTrue(libsmf.attachPlayer(smf))
+        self.assertTrue(zynsmf.start_capture("/tmp/test_smf_capture.zcap"))
+        self.assertTrue(zynsmf.is_capturing())
+        self.assertFalse(zynsmf.start_capture("/tmp/test_smf_capture.zcap"))
+        libsmf.setTrackTranspose(0, 3)
+        libsmf.startPlayback()
+        client.transport_start()
+        sleep(0.5)
+        libsmf.setPlaybackRate(1.5)
+        sleep(0.5)
+        libsmf.stopPlayback()
+        client.transport_stop()
+        sleep(0.1)
+        zynsmf.stop_capture()
+        self.assertFalse(zynsmf.is_capturing())
+        # Replay must run in a process without a JACK client
+        self.assertEqual(zynsmf.replay_capture("/tmp/test_smf_capture.zcap"), -2)
+        libsmf.resetTrackRoutes()
+        libsmf.setPlaybackRate(1.0)
+        libsmf.removePlayer()
+        replay = subprocess.run([sys.executable, "-c",
+                                 "import ctypes; lib = ctypes.cdll.LoadLibrary('/zynthian/zynthian-ui/zynlibs/zynsmf/build/libzynsmf.so'); "
+                                 "lib.replayCapture.restype = ctypes.c_int32; print(lib.replayCapture(b'/tmp/test_smf_capture.zcap'))"],
+                                capture_output=True, text=True, timeout=60)
+        self.assertEqual(replay.stdout.strip(), "-1", replay.stderr)
+
 
 unittest.main()
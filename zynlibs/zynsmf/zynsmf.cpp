@@ -3,18 +3,31 @@
  *   Provides time information, e.g. duration of song
  */
 
+#include "capture.h" //provides capture and replay of process inputs
+#include "rtlog.h"   //provides real-time safe logging from process thread
 #include "zynsmf.h"
 
 #include <cstring>         //provides strcmp, memset
 #include <jack/jack.h>     //provides interface to JACK
 #include <jack/midiport.h> //provides interface to JACK MIDI ports
+#include <cmath>           //provides pow, lround
 #include <map>             //provides std::map
+#include <string>          //provides std::string
 #include <stdio.h>         //provides printf
 
 #define DPRINTF(fmt, args...)                                                                                                                                  \
     if (g_bDebug)                                                                                                                                              \
     fprintf(stderr, fmt, ##args)
 
+#define MAX_OUTPUTS 16       // Maximum quantity of MIDI output ports
+#define MAX_ROUTED_TRACKS 64 // Quantity of tracks that may be individually routed - further tracks share a default route
+#define MIN_PLAYBACK_RATE 0.1 // Minimum playback rate (relative to song tempo)
+#define MAX_PLAYBACK_RATE 4.0 // Maximum playback rate (relative to song tempo)
+#define CAPTURE_MAX_HANGING 256 // Maximum quantity of hanging notes recorded at start of capture
+#define CAPTURE_MAX_MUTES 256   // Quantity of player tracks whose mute is recorded at start of capture
+
+static_assert(MAX_OUTPUTS == IO_OUTPUTS, "Capture must record every output");
+
 enum playState {
     STOPPED  = 0,
     STARTING = 1,
@@ -25,28 +38,79 @@ enum playState {
 jack_client_t* g_pJackClient           = NULL;
 jack_port_t* g_pMidiInputPort          = NULL;
 jack_port_t* g_pMidiOutputPort         = NULL;
+jack_port_t* g_apMidiOutputPorts[MAX_OUTPUTS]; // Additional output ports created on demand by setTrackOutput (index 0 unused - g_pMidiOutputPort)
 
 bool g_bDebug                          = false;
 uint8_t g_nPlayState                   = STOPPED;
 bool g_bRecording                      = false;
 bool g_bLoop                           = false; // True to loop at end of song
 jack_nframes_t g_nSamplerate           = 44100;
-uint32_t g_nMicrosecondsPerQuarterNote = 500000; // Current tempo
-double g_dPlayerTicksPerFrame;                   // Current tempo
+uint32_t g_nMicrosecondsPerQuarterNote = 500000; // Current recording tempo
 double g_dRecorderTicksPerFrame;                 // Current tempo
-double g_dPosition              = 0.0;           // Position within song in ticks
+double g_dPosition              = 0.0;           // Position within song in microseconds at song tempo (independent of playback rate)
+double g_dPlaybackRate          = 1.0;           // Playback speed relative to song tempo map, e.g. 0.8 to play at 80%
+double g_dTransportScale        = 1.0;           // Factor applied to playback rate by changes of JACK transport tempo during playback
+bool g_bFollowTransport         = true;          // True to scale playback rate with changes of JACK transport tempo
+double g_dTransportBpm          = 0.0;           // JACK transport tempo last seen during playback (0 to resynchronise)
 uint32_t g_nRecordStartPosition = 0;             // Jack frame location when recording started
-std::map<uint16_t, uint8_t>
-    m_mHangingMidi; // Map of played (not released) notes or pitchbend indexed by 16-bit word (MIDI channel << 8) | note/controller number
+jack_transport_state_t g_nPreviousTransportState = JackTransportStopped; // Transport state in previous period
+uint8_t g_nPreviousPlayState                     = STOPPED;              // Play state in previous period
+double g_dBeatsPerMinute                         = 120.0;                // Transport tempo in previous period
+std::map<uint32_t, uint8_t>
+    m_mHangingMidi; // Map of played (not released) notes or pitchbend indexed by 24-bit word (output << 16) | (MIDI channel << 8) | note/controller number
 bool g_aRecNotes[16][128];
 int8_t g_nTranspose  = 0;     // +/- notes to transpose playback
 bool g_bClearHanging = false; // True to request hanging notes are cleared in next process cycle
 
+// Routing and remapping of a track's playback, compiled into lookup tables applied by the playback loop
+struct TRACK_ROUTE {
+    uint8_t output        = 0;  // Index of output port
+    int8_t channel        = -1; // MIDI channel to remap channel messages to or -1 to retain channel
+    int8_t transpose      = 0;  // +/- semitones (added to global transpose)
+    int8_t velocityCurve  = 0;  // Note-on velocity curve (-100..100, 0 = linear, positive = louder)
+    uint8_t aStatus[256];       // Status byte lookup table
+    uint8_t aNote[128];         // Note lookup table (0xFF if transposed out of range)
+    uint8_t aVelocity[128];     // Note-on velocity lookup table
+};
+TRACK_ROUTE g_aTrackRoutes[MAX_ROUTED_TRACKS + 1]; // Route of each track, last entry used by all further tracks
+
 Smf* g_pPlayerSmf    = NULL; // Pointer to the SMF object that is attached to player
 Smf* g_pRecorderSmf  = NULL; // Pointer to the SMF object that is attached to recorder
 Smf* g_pSmf          = NULL; // Pointer to the SMF containing g_pEvent (current event)
 Event* g_pEvent      = NULL; // Pointer to the current event
 
+// API functions that mutate state used by process thread, recorded during capture and called during replay (append only - index is stored in capture log)
+#define CAPTURE_API_LIST(X) \
+    X(removeSmf) X(load) X(unload) X(setPosition) X(addNote) X(addTempo) X(setEndOfTrack) X(getEvent) X(attachPlayer) X(removePlayer) X(setLoop) \
+    X(startPlayback) X(stopPlayback) X(setPlaybackRate) X(setPlaybackTempo) X(setTransportTempoFollow) X(attachRecorder) X(removeRecorder) \
+    X(startRecording) X(stopRecording) X(printEvents) X(muteTrack) X(setTranspose) X(setTrackOutput) X(setTrackChannel) X(setTrackTranspose) \
+    X(setTrackVelocityCurve) X(resetTrackRoutes)
+
+enum CAPTURE_API_ID {
+#define CAPTURE_API_ENUM(fn) API_##fn,
+    CAPTURE_API_LIST(CAPTURE_API_ENUM)
+#undef CAPTURE_API_ENUM
+};
+
+// Record call of API function during capture - place at start of function
+#define CAPTURE_API(fn, args...) CaptureApiScope captureScope(API_##fn, ##args)
+
+// SMF arguments are recorded by role because replay creates its own objects (0: other, 1: player, 2: recorder)
+inline bool capturePack(uint8_t* pData, uint16_t& nSize, Smf* value) {
+    uint8_t nRole = 0;
+    if (value && value == g_pPlayerSmf)
+        nRole = 1;
+    else if (value && value == g_pRecorderSmf)
+        nRole = 2;
+    return capturePack(pData, nSize, nRole);
+}
+
+// Calls on other SMF do not affect the process thread so are replayed with NULL which each API function ignores
+template <> Smf* replayUnpack<Smf*>(const uint8_t*& pData) {
+    uint8_t nRole = replayUnpack<uint8_t>(pData);
+    return nRole == 1 ? g_pPlayerSmf : nRole == 2 ? g_pRecorderSmf : NULL;
+}
+
 //!@todo If playback is active and the parent process closes then seg fault occurs probably because Jack continutes to try to access the object
 
 // Silly little class to provide a vector of pointers and clean up on exit
@@ -67,6 +131,7 @@ class SmfFactory {
 // Create instance of SmfFactory on stack so that it will clean up on exit
 SmfFactory g_Smf;
 auto g_pvSmf = g_Smf.getVector();
+SmfIndex g_SmfIndex; // Index of SMF summaries for browsing
 
 /*** Private functions not exposed as external C functions (not declared in header) ***/
 
@@ -80,6 +145,49 @@ bool isSmfValid(Smf* pSmf) {
     return false;
 }
 
+// Populate lookup tables of a track route from its configuration and the global transpose
+void compileRoute(TRACK_ROUTE* pRoute) {
+    for (uint16_t nStatus = 0; nStatus < 256; ++nStatus) {
+        if (pRoute->channel >= 0 && nStatus >= 0x80 && nStatus < 0xF0)
+            pRoute->aStatus[nStatus] = (nStatus & 0xF0) | pRoute->channel;
+        else
+            pRoute->aStatus[nStatus] = nStatus;
+    }
+    for (int nNote = 0; nNote < 128; ++nNote) {
+        int nValue           = nNote + g_nTranspose + pRoute->transpose;
+        pRoute->aNote[nNote] = (nValue < 0 || nValue > 127) ? 0xFF : nValue;
+    }
+    // Curve exponent is 1/4 at +100, 1 at 0 and 4 at -100
+    double dGamma        = pow(2.0, -pRoute->velocityCurve / 50.0);
+    pRoute->aVelocity[0] = 0;
+    for (int nVelocity = 1; nVelocity < 128; ++nVelocity) {
+        long nValue                  = lround(127.0 * pow(nVelocity / 127.0, dGamma));
+        pRoute->aVelocity[nVelocity] = nValue < 1 ? 1 : nValue;
+    }
+}
+
+// Get playback rate that plays song at a tempo, scaling any tempo changes within song
+double getRateForTempo(double dTempo) {
+    if (!g_pPlayerSmf || dTempo <= 0.0)
+        return g_dPlaybackRate;
+    return dTempo * g_pPlayerSmf->getMicrosecondsPerQuarterNote(0) / 60000000.0;
+}
+
+// Get route of a track
+TRACK_ROUTE* getRoute(size_t nTrack) { return &g_aTrackRoutes[nTrack < MAX_ROUTED_TRACKS ? nTrack : MAX_ROUTED_TRACKS]; }
+
+void compileRoutes() {
+    for (size_t nTrack = 0; nTrack <= MAX_ROUTED_TRACKS; ++nTrack)
+        compileRoute(&g_aTrackRoutes[nTrack]);
+}
+
+// Compile default routes before any playback
+class RouteInitialiser {
+  public:
+    RouteInitialiser() { compileRoutes(); }
+};
+RouteInitialiser g_RouteInitialiser;
+
 /*** Public functions exposed as external C functions in header ***/
 
 Smf* addSmf() {
@@ -89,6 +197,7 @@ Smf* addSmf() {
 }
 
 void removeSmf(Smf* pSmf) {
+    CAPTURE_API(removeSmf, pSmf);
     if (pSmf == g_pPlayerSmf)
         removePlayer();
     if (pSmf == g_pRecorderSmf)
@@ -111,11 +220,14 @@ size_t getSmfCount() { return g_pvSmf->size(); }
 void enableDebug(bool bEnable) {
     fprintf(stderr, "libsmf setting debug mode %s\n", bEnable ? "on" : "off");
     g_bDebug = bEnable;
+    rtlogEnable(bEnable);
+    g_SmfIndex.enableDebug(bEnable);
     for (auto it = g_pvSmf->begin(); it != g_pvSmf->end(); ++it)
         (*it)->enableDebug(bEnable);
 }
 
 bool load(Smf* pSmf, char* filename) {
+    CAPTURE_API(load, pSmf, filename); // Replay reloads the same path so the file must be unchanged
     if (!isSmfValid(pSmf))
         return false;
     return pSmf->load(filename);
@@ -128,6 +240,7 @@ bool save(Smf* pSmf, char* filename) {
 }
 
 void unload(Smf* pSmf) {
+    CAPTURE_API(unload, pSmf);
     if (!isSmfValid(pSmf))
         return;
     pSmf->unload();
@@ -140,12 +253,14 @@ double getDuration(Smf* pSmf) {
 }
 
 void setPosition(Smf* pSmf, uint32_t time) {
+    CAPTURE_API(setPosition, pSmf, time);
     if (!isSmfValid(pSmf))
         return;
     pSmf->setPosition(time);
     g_pSmf      = pSmf;
     g_pEvent    = pSmf->getEvent(false);
-    g_dPosition = double(time);
+    if (pSmf == g_pPlayerSmf)
+        g_dPosition = pSmf->getTimeAtTick(time);
 }
 
 uint32_t getTracks(Smf* pSmf) {
@@ -167,6 +282,7 @@ uint32_t getEvents(Smf* pSmf, size_t nTrack) {
 }
 
 void addNote(Smf* pSmf, uint32_t nTrack, uint32_t nTime, uint32_t nDuration, uint8_t nChannel, uint8_t nNote, uint8_t nVelocity) {
+    CAPTURE_API(addNote, pSmf, nTrack, nTime, nDuration, nChannel, nNote, nVelocity);
     if (!isSmfValid(pSmf))
         return;
     uint8_t* pData = new uint8_t[2];
@@ -182,6 +298,7 @@ void addNote(Smf* pSmf, uint32_t nTrack, uint32_t nTime, uint32_t nDuration, uin
 }
 
 void addTempo(Smf* pSmf, uint32_t nTime, double dTempo) {
+    CAPTURE_API(addTempo, pSmf, nTime, dTempo);
     if (!isSmfValid(pSmf))
         return;
     uint32_t nUspqn = (60000000 / dTempo);
@@ -195,6 +312,7 @@ void addTempo(Smf* pSmf, uint32_t nTime, double dTempo) {
 }
 
 void setEndOfTrack(Smf* pSmf, uint32_t nTrack, uint32_t nTime) {
+    CAPTURE_API(setEndOfTrack, pSmf, nTrack, nTime);
     if (!isSmfValid(pSmf))
         return;
     //!@todo remove existing end of track event
@@ -209,6 +327,7 @@ uint16_t getTicksPerQuarterNote(Smf* pSmf) {
 }
 
 bool getEvent(Smf* pSmf, bool bAdvance) {
+    CAPTURE_API(getEvent, pSmf, bAdvance); // Moves event cursor used by player
     if (!isSmfValid(pSmf))
         return false;
     g_pSmf   = pSmf;
@@ -263,41 +382,180 @@ static int onJackSamplerate(jack_nframes_t nFrames, void* args) {
     if (nFrames == 0)
         return 0; // Avoid divide by zero errors - better to have wrong samplerate than crash
     g_nSamplerate = nFrames;
-    //!@todo This is a nasty use of double precision floating point where we should be able to do most of this with integer maths
-    if (g_pPlayerSmf)
-        g_dPlayerTicksPerFrame = double(g_pPlayerSmf->getTicksPerQuarterNote()) / ((double(g_nMicrosecondsPerQuarterNote) / 1000000) * double(g_nSamplerate));
+    // Playback uses the compiled tempo map of the song so only recorder needs recalculating
     if (g_pRecorderSmf)
         g_dRecorderTicksPerFrame =
             double(g_pRecorderSmf->getTicksPerQuarterNote()) / ((double(g_nMicrosecondsPerQuarterNote) / 1000000) * double(g_nSamplerate));
     return 0;
 }
 
-// Handle JACK process callback
-static int onJackProcess(jack_nframes_t nFrames, void* notused) {
+// ** Capture runtime state **
+
+bool createOutputPort(uint8_t nOutput);
+
+// Process thread state at start of capture that is not described by the SMF files saved by startCapture
+struct RUNTIME_STATE {
+    double recorderTicksPerFrame;              // g_dRecorderTicksPerFrame
+    double position;                           // g_dPosition
+    double playbackRate;                       // g_dPlaybackRate
+    double transportScale;                     // g_dTransportScale
+    double transportBpm;                       // g_dTransportBpm
+    double beatsPerMinute;                     // g_dBeatsPerMinute
+    uint32_t samplerate;                       // g_nSamplerate
+    uint32_t microsecondsPerQuarterNote;       // g_nMicrosecondsPerQuarterNote
+    uint32_t recordStartPosition;              // g_nRecordStartPosition
+    uint32_t previousTransportState;           // g_nPreviousTransportState
+    uint32_t playerPosition;                   // Event cursor of player SMF in ticks
+    uint32_t hangingCount;                     // Quantity of entries in hanging
+    uint16_t outputs;                          // Bitmask of output ports that exist (bit 0: main output)
+    uint8_t playState;                         // g_nPlayState
+    uint8_t previousPlayState;                 // g_nPreviousPlayState
+    int8_t transpose;                          // g_nTranspose
+    bool recording;                            // g_bRecording
+    bool loop;                                 // g_bLoop
+    bool followTransport;                      // g_bFollowTransport
+    bool clearHanging;                         // g_bClearHanging
+    bool player;                               // True if player attached
+    bool recorder;                             // True if recorder attached
+    int8_t routes[MAX_ROUTED_TRACKS + 1][4];   // Configuration of g_aTrackRoutes (output, channel, transpose, velocity curve)
+    uint8_t mutes[CAPTURE_MAX_MUTES / 8];      // Bitmask of muted player tracks
+    uint32_t hanging[CAPTURE_MAX_HANGING][2];  // m_mHangingMidi
+    bool recNotes[16][128];                    // g_aRecNotes
+};
+
+// Populate runtime state - call from process thread at start of first captured period - returns false if state does not fit
+static bool getRuntimeState(RUNTIME_STATE* pState) {
+    memset(pState, 0, sizeof(RUNTIME_STATE));
+    if (m_mHangingMidi.size() > CAPTURE_MAX_HANGING)
+        return false;
+    pState->recorderTicksPerFrame      = g_dRecorderTicksPerFrame;
+    pState->position                   = g_dPosition;
+    pState->playbackRate               = g_dPlaybackRate;
+    pState->transportScale             = g_dTransportScale;
+    pState->transportBpm               = g_dTransportBpm;
+    pState->beatsPerMinute             = g_dBeatsPerMinute;
+    pState->samplerate                 = g_nSamplerate;
+    pState->microsecondsPerQuarterNote = g_nMicrosecondsPerQuarterNote;
+    pState->recordStartPosition        = g_nRecordStartPosition;
+    pState->previousTransportState     = g_nPreviousTransportState;
+    pState->playerPosition             = g_pPlayerSmf ? g_pPlayerSmf->getPosition() : 0;
+    pState->outputs                    = g_pMidiOutputPort ? 1 : 0;
+    for (uint8_t nOutput = 1; nOutput < MAX_OUTPUTS; ++nOutput)
+        if (g_apMidiOutputPorts[nOutput])
+            pState->outputs |= 1 << nOutput;
+    pState->playState         = g_nPlayState;
+    pState->previousPlayState = g_nPreviousPlayState;
+    pState->transpose         = g_nTranspose;
+    pState->recording         = g_bRecording;
+    pState->loop              = g_bLoop;
+    pState->followTransport   = g_bFollowTransport;
+    pState->clearHanging      = g_bClearHanging;
+    pState->player            = g_pPlayerSmf != NULL;
+    pState->recorder          = g_pRecorderSmf != NULL;
+    for (size_t nTrack = 0; nTrack <= MAX_ROUTED_TRACKS; ++nTrack) {
+        pState->routes[nTrack][0] = g_aTrackRoutes[nTrack].output;
+        pState->routes[nTrack][1] = g_aTrackRoutes[nTrack].channel;
+        pState->routes[nTrack][2] = g_aTrackRoutes[nTrack].transpose;
+        pState->routes[nTrack][3] = g_aTrackRoutes[nTrack].velocityCurve;
+    }
+    if (g_pPlayerSmf) {
+        size_t nTracks = g_pPlayerSmf->getTracks();
+        for (size_t nTrack = 0; nTrack < nTracks && nTrack < CAPTURE_MAX_MUTES; ++nTrack)
+            if (g_pPlayerSmf->isTrackMuted(nTrack))
+                pState->mutes[nTrack / 8] |= 1 << (nTrack % 8);
+    }
+    for (auto it = m_mHangingMidi.begin(); it != m_mHangingMidi.end(); ++it) {
+        pState->hanging[pState->hangingCount][0] = it->first;
+        pState->hanging[pState->hangingCount][1] = it->second;
+        ++pState->hangingCount;
+    }
+    memcpy(pState->recNotes, g_aRecNotes, sizeof(g_aRecNotes));
+    return true;
+}
+
+// Restore runtime state before replay (player and recorder SMF loaded by replayCapture)
+static void setRuntimeState(const RUNTIME_STATE* pState) {
+    for (size_t nTrack = 0; nTrack <= MAX_ROUTED_TRACKS; ++nTrack) {
+        g_aTrackRoutes[nTrack].output        = pState->routes[nTrack][0];
+        g_aTrackRoutes[nTrack].channel       = pState->routes[nTrack][1];
+        g_aTrackRoutes[nTrack].transpose     = pState->routes[nTrack][2];
+        g_aTrackRoutes[nTrack].velocityCurve = pState->routes[nTrack][3];
+    }
+    g_nTranspose = pState->transpose;
+    compileRoutes();
+    if (pState->outputs & 1)
+        g_pMidiOutputPort = ioRegisterPort(NULL, "midi_out", JackPortIsOutput, 0);
+    for (uint8_t nOutput = 1; nOutput < MAX_OUTPUTS; ++nOutput)
+        if (pState->outputs & (1 << nOutput))
+            createOutputPort(nOutput);
+    if (!pState->player)
+        g_pPlayerSmf = NULL;
+    if (pState->recorder)
+        g_pMidiInputPort = ioRegisterPort(NULL, "midi_in", JackPortIsInput, IO_PORT_INPUT);
+    else
+        g_pRecorderSmf = NULL;
+    if (g_pPlayerSmf) {
+        g_pPlayerSmf->setPosition(pState->playerPosition);
+        size_t nTracks = g_pPlayerSmf->getTracks();
+        for (size_t nTrack = 0; nTrack < nTracks && nTrack < CAPTURE_MAX_MUTES; ++nTrack)
+            g_pPlayerSmf->muteTrack(nTrack, pState->mutes[nTrack / 8] & (1 << (nTrack % 8)));
+    }
+    g_dRecorderTicksPerFrame      = pState->recorderTicksPerFrame;
+    g_dPosition                   = pState->position;
+    g_dPlaybackRate               = pState->playbackRate;
+    g_dTransportScale             = pState->transportScale;
+    g_dTransportBpm               = pState->transportBpm;
+    g_dBeatsPerMinute             = pState->beatsPerMinute;
+    g_nSamplerate                 = pState->samplerate;
+    g_nMicrosecondsPerQuarterNote = pState->microsecondsPerQuarterNote;
+    g_nRecordStartPosition        = pState->recordStartPosition;
+    g_nPreviousTransportState     = jack_transport_state_t(pState->previousTransportState);
+    g_nPlayState                  = pState->playState;
+    g_nPreviousPlayState          = pState->previousPlayState;
+    g_bRecording                  = pState->recording;
+    g_bLoop                       = pState->loop;
+    g_bFollowTransport            = pState->followTransport;
+    g_bClearHanging               = pState->clearHanging;
+    m_mHangingMidi.clear();
+    for (uint32_t i = 0; i < pState->hangingCount && i < CAPTURE_MAX_HANGING; ++i)
+        m_mHangingMidi[pState->hanging[i][0]] = pState->hanging[i][1];
+    memcpy(g_aRecNotes, pState->recNotes, sizeof(g_aRecNotes));
+}
+
+// Process one period of player and recorder
+static void processPeriod(jack_nframes_t nFrames) {
     static uint8_t nCommand;
     static uint8_t nData1;
     static uint8_t nData2;
 
     if (g_pMidiInputPort == NULL && g_pMidiOutputPort == NULL)
-        return 0;
-    static jack_transport_state_t nPreviousTransportState = JackTransportStopped;
-    static uint8_t nPreviousPlayState                     = STOPPED;
-    static uint8_t nStatus;
+        return;
     static jack_position_t transport_position;
-    static double dBeatsPerMinute          = 120.0;
 
-    jack_nframes_t nNow                    = jack_last_frame_time(g_pJackClient);
-    jack_transport_state_t nTransportState = jack_transport_query(g_pJackClient, &transport_position);
+    jack_nframes_t nNow                    = ioLastFrameTime(g_pJackClient);
+    jack_transport_state_t nTransportState = ioTransportQuery(g_pJackClient, &transport_position);
 
     // Handle change of tempo
-    if (nPreviousTransportState != nTransportState || transport_position.beats_per_minute != dBeatsPerMinute && transport_position.beats_per_minute > 0) {
-        dBeatsPerMinute = transport_position.beats_per_minute;
-        if (dBeatsPerMinute)
-            g_nMicrosecondsPerQuarterNote = 60000000.0 / dBeatsPerMinute;
+    if (g_nPreviousTransportState != nTransportState || transport_position.beats_per_minute != g_dBeatsPerMinute && transport_position.beats_per_minute > 0) {
+        g_dBeatsPerMinute = transport_position.beats_per_minute;
+        if (g_dBeatsPerMinute)
+            g_nMicrosecondsPerQuarterNote = 60000000.0 / g_dBeatsPerMinute;
         onJackSamplerate(g_nSamplerate, 0);
     }
+    // Scale playback rate to follow change of transport tempo during playback
+    if (g_nPlayState == PLAYING && (transport_position.valid & JackPositionBBT) && transport_position.beats_per_minute > 0 &&
+        transport_position.beats_per_minute != g_dTransportBpm) {
+        if (g_bFollowTransport && g_dTransportBpm > 0) {
+            // Scale user's playback rate by change of transport tempo
+            double dScale = g_dTransportScale * transport_position.beats_per_minute / g_dTransportBpm;
+            double dRate  = g_dPlaybackRate * dScale;
+            if (dRate >= MIN_PLAYBACK_RATE && dRate <= MAX_PLAYBACK_RATE)
+                g_dTransportScale = dScale;
+        }
+        g_dTransportBpm = transport_position.beats_per_minute;
+    }
     // Handle change of transport state
-    if (nTransportState != nPreviousTransportState) {
+    if (nTransportState != g_nPreviousTransportState) {
         if (g_nPlayState == STARTING || g_nPlayState == PLAYING) {
             if (nTransportState == JackTransportStarting)
                 g_nPlayState = STARTING;
@@ -307,22 +565,22 @@ static int onJackProcess(jack_nframes_t nFrames, void* notused) {
                 g_nPlayState = STOPPED;
         } else
             g_nPlayState = STOPPED;
-        nPreviousTransportState = nTransportState;
+        g_nPreviousTransportState = nTransportState;
     }
 
     void* pMidiBuffer; // Pointer to the memory area used by MIDI input / output ports (reused for each)
 
-    if (g_bRecording && g_pMidiInputPort && (pMidiBuffer = jack_port_get_buffer(g_pMidiInputPort, nFrames))) {
+    if (g_bRecording && g_pMidiInputPort && (pMidiBuffer = ioGetBuffer(g_pMidiInputPort, nFrames))) {
         //!@todo Add tempo changes
         jack_midi_event_t midiEvent;
-        jack_nframes_t nCount = jack_midi_get_event_count(pMidiBuffer);
+        jack_nframes_t nCount = ioMidiGetEventCount(pMidiBuffer);
         uint8_t* pData;
         if (nCount) {
             Event* pEvent;
             uint8_t* pData;
             size_t nSize;
             for (jack_nframes_t i = 0; i < nCount; i++) {
-                jack_midi_event_get(&midiEvent, pMidiBuffer, i);
+                ioMidiEventGet(&midiEvent, pMidiBuffer, i);
                 switch (midiEvent.buffer[0] & 0xF0) {
                 case MIDI_NOTE_OFF:
                     g_aRecNotes[midiEvent.buffer[0] & 0x0f][midiEvent.buffer[1]] = false;
@@ -353,19 +611,30 @@ static int onJackProcess(jack_nframes_t nFrames, void* notused) {
                     uint32_t nPosition = nNow + midiEvent.time - g_nRecordStartPosition; // Time of event in samples since start of recording
                     pEvent             = new Event(g_dRecorderTicksPerFrame * nPosition, EVENT_TYPE_MIDI, midiEvent.buffer[0], nSize, pData);
                     g_pRecorderSmf->addEvent(midiEvent.buffer[0] & 0x0F, pEvent); // Add event to a track based on its MIDI channel
+                    ioRecorded(pEvent->getTime(), midiEvent.buffer, nSize + 1);
                 }
             }
         }
     }
 
-    if (g_pMidiOutputPort && (pMidiBuffer = jack_port_get_buffer(g_pMidiOutputPort, nFrames))) {
-        jack_midi_clear_buffer(pMidiBuffer);
+    if (g_pMidiOutputPort && (pMidiBuffer = ioGetBuffer(g_pMidiOutputPort, nFrames))) {
+        // Output buffers indexed by track route output (unused outputs send to main output)
+        void* apMidiBuffers[MAX_OUTPUTS];
+        apMidiBuffers[0] = pMidiBuffer;
+        ioMidiClearBuffer(pMidiBuffer, 0);
+        for (uint8_t nOutput = 1; nOutput < MAX_OUTPUTS; ++nOutput) {
+            apMidiBuffers[nOutput] = g_apMidiOutputPorts[nOutput] ? ioGetBuffer(g_apMidiOutputPorts[nOutput], nFrames) : NULL;
+            if (apMidiBuffers[nOutput])
+                ioMidiClearBuffer(apMidiBuffers[nOutput], nOutput);
+            else
+                apMidiBuffers[nOutput] = pMidiBuffer;
+        }
         if (!g_pPlayerSmf || g_nPlayState == STOPPED)
-            return 0; // We don't have a SMF loaded or we are stopped so don't bother processing any data
+            return; // We don't have a SMF loaded or we are stopped so don't bother processing any data
 
         // Handle change of play state
-        if (nPreviousPlayState != g_nPlayState || g_nPlayState == STOPPING) {
-            DPRINTF("zysmf::onJackProcess Previous play state: %u New play state: %u\n", nPreviousPlayState, g_nPlayState);
+        if (g_nPreviousPlayState != g_nPlayState || g_nPlayState == STOPPING) {
+            RTLOG("zysmf::onJackProcess Previous play state: %u New play state: %u\n", g_nPreviousPlayState, g_nPlayState);
             if (g_nPlayState == STOPPED || g_nPlayState == STOPPING) {
                 g_nPlayState    = STOPPED;
                 g_bClearHanging = true;
@@ -373,76 +642,89 @@ static int onJackProcess(jack_nframes_t nFrames, void* notused) {
         }
         if (g_nPlayState == STARTING and nTransportState == JackTransportRolling)
             g_nPlayState = PLAYING;
-        nPreviousPlayState = g_nPlayState;
+        g_nPreviousPlayState = g_nPlayState;
 
         if (g_nPlayState == PLAYING) {
             //!@todo Store playback position to allow pause / resume
-            // Process all pending smf events
-            g_dPosition += g_dPlayerTicksPerFrame * nFrames; // Ticks since start of song
-            while (Event* pEvent = g_pPlayerSmf->getEvent(false)) {
-                if (pEvent->getTime() > g_dPosition)
-                    break;
-                pEvent = g_pPlayerSmf->getEvent(true);
-
-                if (pEvent->getType() == EVENT_TYPE_META) {
-                    if (pEvent->getSubtype() == META_TYPE_TEMPO && pEvent->getInt32()) {
-                        g_nMicrosecondsPerQuarterNote = pEvent->getInt32();
-                        onJackSamplerate(g_nSamplerate, 0);
-                    }
-                    continue;
-                }
-                if (pEvent->getType() == EVENT_TYPE_MIDI) {
-                    jack_nframes_t nOffset    = g_dPosition - nNow;
-                    jack_midi_data_t* pBuffer = jack_midi_event_reserve(pMidiBuffer, nOffset, pEvent->getSize() + 1);
-                    if (!pBuffer)
+            // Process all smf events within this period. Song time advances by period scaled by playback rate and each event is offset within period
+            // by its time from the compiled tempo map, so tempo changes (in song or of playback rate) do not accumulate timing error.
+            double dFrameDuration = 1000000.0 * g_dPlaybackRate * g_dTransportScale / g_nSamplerate; // Song microseconds per frame
+            double dEnd           = g_dPosition + dFrameDuration * nFrames;
+            bool bEnd = false;
+            // Events being added to song are played late in next period
+            if (g_pPlayerSmf->tryLock()) {
+                while (Event* pEvent = g_pPlayerSmf->getEvent(false)) {
+                    double dTime = g_pPlayerSmf->getTimeAtTick(pEvent->getTime());
+                    if (dTime >= dEnd)
                         break;
-                    nCommand = pEvent->getSubtype();
-
-                    // Store note and some controller values to allow reset when stopped
-                    if (pEvent->getSize() == 2) {
-                        nData1 = *(pEvent->getData());
-                        nData2 = *(pEvent->getData() + 1);
-                        switch (nCommand & 0xF0) {
-                        case MIDI_NOTE_ON:
-                            nData1 += g_nTranspose;
-                            if (nData1 > 127)
-                                continue;
-                            if (nData2 == 0) {
-                                nCommand = nCommand & 0x8f;
-                                m_mHangingMidi.erase(nCommand << 8 | nData1);
-                            } else
-                                m_mHangingMidi[(nCommand & 0x8f) << 8 | nData1] = nData2;
-                            break;
-                        case MIDI_NOTE_OFF:
-                            nData1 += g_nTranspose;
-                            if (nData1 > 127)
-                                continue;
-                            m_mHangingMidi.erase(nCommand << 8 | nData1);
-                            break;
-                        case MIDI_CONTROLLER:
-                            if (nData1 < 64 || nData1 > 69)
-                                break; // Only handle sustain type CC
-                        case MIDI_POLY_PRESSURE:
-                        case MIDI_CHANNEL_PRESSURE:
-                            if (nData2 == 0)
-                                m_mHangingMidi.erase(nCommand << 8 | nData1);
-                            else
-                                m_mHangingMidi[nCommand << 8 | nData1] = 0;
-                            break;
-                        case MIDI_PITCH_BEND:
-                            m_mHangingMidi[nCommand << 8] = 0x40;
+                    pEvent = g_pPlayerSmf->getEvent(true);
+
+                    if (pEvent->getType() == EVENT_TYPE_META)
+                        continue; // Tempo changes are applied by compiled tempo map
+                    if (pEvent->getType() == EVENT_TYPE_MIDI) {
+                        TRACK_ROUTE* pRoute       = getRoute(g_pPlayerSmf->getCurrentTrack());
+                        uint32_t nOutput          = uint32_t(pRoute->output) << 16;
+                        jack_nframes_t nOffset    = dTime > g_dPosition ? jack_nframes_t((dTime - g_dPosition) / dFrameDuration) : 0;
+                        if (nOffset >= nFrames)
+                            nOffset = nFrames - 1;
+                        nCommand                  = pRoute->aStatus[pEvent->getSubtype()];
+
+                        // Store note and some controller values to allow reset when stopped
+                        if (pEvent->getSize() == 2) {
+                            nData1 = *(pEvent->getData());
+                            nData2 = *(pEvent->getData() + 1);
+                            switch (nCommand & 0xF0) {
+                            case MIDI_NOTE_ON:
+                                nData1 = pRoute->aNote[nData1 & 0x7F];
+                                if (nData1 > 127)
+                                    continue;
+                                nData2 = pRoute->aVelocity[nData2 & 0x7F];
+                                if (nData2 == 0) {
+                                    nCommand = nCommand & 0x8f;
+                                    m_mHangingMidi.erase(nOutput | nCommand << 8 | nData1);
+                                } else
+                                    m_mHangingMidi[nOutput | (nCommand & 0x8f) << 8 | nData1] = nData2;
+                                break;
+                            case MIDI_NOTE_OFF:
+                                nData1 = pRoute->aNote[nData1 & 0x7F];
+                                if (nData1 > 127)
+                                    continue;
+                                m_mHangingMidi.erase(nOutput | nCommand << 8 | nData1);
+                                break;
+                            case MIDI_CONTROLLER:
+                                if (nData1 < 64 || nData1 > 69)
+                                    break; // Only handle sustain type CC
+                            case MIDI_POLY_PRESSURE:
+                            case MIDI_CHANNEL_PRESSURE:
+                                if (nData2 == 0)
+                                    m_mHangingMidi.erase(nOutput | nCommand << 8 | nData1);
+                                else
+                                    m_mHangingMidi[nOutput | nCommand << 8 | nData1] = 0;
+                                break;
+                            case MIDI_PITCH_BEND:
+                                m_mHangingMidi[nOutput | nCommand << 8] = 0x40;
+                                break;
+                            }
+                        }
+                        // Reserve buffer after lookup so that dropped (out of range) notes do not leave empty events
+                        jack_midi_data_t* pBuffer = ioMidiEventReserve(apMidiBuffers[pRoute->output], nOffset, pEvent->getSize() + 1);
+                        if (!pBuffer)
                             break;
+                        if (pEvent->getSize() == 2) {
+                            *pBuffer       = nCommand;
+                            *(pBuffer + 1) = nData1;
+                            *(pBuffer + 2) = nData2;
+                        } else {
+                            *pBuffer = nCommand;
+                            memcpy(pBuffer + 1, pEvent->getData(), pEvent->getSize());
                         }
-                        *pBuffer       = nCommand;
-                        *(pBuffer + 1) = nData1;
-                        *(pBuffer + 2) = nData2;
-                    } else {
-                        *pBuffer = nCommand;
-                        memcpy(pBuffer + 1, pEvent->getData(), pEvent->getSize());
                     }
                 }
+                bEnd = !g_pPlayerSmf->getEvent(false);
+                g_pPlayerSmf->unlock();
             }
-            if (!g_pPlayerSmf->getEvent(false)) {
+            g_dPosition = dEnd;
+            if (bEnd) {
                 // No more events so must be at end of song
                 stopPlayback();
                 if (g_bLoop)
@@ -452,10 +734,10 @@ static int onJackProcess(jack_nframes_t nFrames, void* notused) {
         if (g_bClearHanging) {
             // Reset any hanging events (held notes, pitchbend, sustain, etc.)
             for (auto it = m_mHangingMidi.begin(); it != m_mHangingMidi.end(); ++it) {
-                jack_midi_data_t* pBuffer = jack_midi_event_reserve(pMidiBuffer, 0, 3);
+                jack_midi_data_t* pBuffer = ioMidiEventReserve(apMidiBuffers[(it->first >> 16) % MAX_OUTPUTS], 0, 3);
                 if (!pBuffer)
                     break;
-                uint8_t nStatus = it->first >> 8;
+                uint8_t nStatus = (it->first >> 8) & 0xFF;
                 uint8_t nValue1 = it->first & 0x00FF;
                 *pBuffer        = nStatus;
                 *(pBuffer + 1)  = nValue1;
@@ -465,7 +747,20 @@ static int onJackProcess(jack_nframes_t nFrames, void* notused) {
             g_bClearHanging = false;
         }
     }
+}
 
+// Handle JACK process callback
+static int onJackProcess(jack_nframes_t nFrames, void* notused) {
+    ioBeginPeriod(nFrames);
+    if (captureIsPending()) {
+        RUNTIME_STATE state;
+        if (getRuntimeState(&state))
+            ioCaptureState(&state, sizeof(state));
+        else
+            captureLost(); // Too many hanging notes to record
+    }
+    processPeriod(nFrames);
+    ioEndPeriod();
     return 0;
 }
 
@@ -476,10 +771,13 @@ void removeJackClient() {
 }
 
 bool createJackClient() {
+    if (replayIsRunning())
+        return true; // Replay drives the process callback without JACK
     if (!g_pJackClient) {
         // Initialise JACK client
         g_pJackClient = jack_client_open("zynsmf", JackNoStartServer, NULL);
         if (g_pJackClient && !jack_set_process_callback(g_pJackClient, onJackProcess, 0) &&
+            !jack_set_thread_init_callback(g_pJackClient, rtlogThreadInit, 0) &&
             !jack_set_sample_rate_callback(g_pJackClient, onJackSamplerate, 0) && !jack_activate(g_pJackClient)) {
             fprintf(stderr, "Started libzynsmf\n");
             return true;
@@ -490,45 +788,79 @@ bool createJackClient() {
     return true;
 }
 
+// Create output port if it does not exist
+bool createOutputPort(uint8_t nOutput) {
+    if (nOutput == 0 || g_apMidiOutputPorts[nOutput])
+        return true;
+    if (!g_pJackClient && !replayIsRunning())
+        return false;
+    char sName[16];
+    sprintf(sName, "midi_out_%u", nOutput + 1);
+    g_apMidiOutputPorts[nOutput] = ioRegisterPort(g_pJackClient, sName, JackPortIsOutput, nOutput);
+    if (!g_apMidiOutputPorts[nOutput]) {
+        DPRINTF("Failed to create JACK output port %s\n", sName);
+        return false;
+    }
+    return true;
+}
+
 bool attachPlayer(Smf* pSmf) {
+    CAPTURE_API(attachPlayer, pSmf);
     if (!isSmfValid(pSmf))
         return false;
     if (!createJackClient())
         return false;
     if (!g_pMidiOutputPort)
-        g_pMidiOutputPort = jack_port_register(g_pJackClient, "midi_out", JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0);
+        g_pMidiOutputPort = ioRegisterPort(g_pJackClient, "midi_out", JackPortIsOutput, 0);
     if (!g_pMidiOutputPort) {
         removePlayer();
         DPRINTF("Failed to create JACK output port\n");
         return false;
     }
+    // Create additional output ports used by track routes
+    for (size_t nTrack = 0; nTrack <= MAX_ROUTED_TRACKS; ++nTrack)
+        createOutputPort(g_aTrackRoutes[nTrack].output);
     DPRINTF("Created new JACK player\n");
     g_pPlayerSmf  = pSmf;
-    g_nSamplerate = jack_get_sample_rate(g_pJackClient);
-    onJackSamplerate(g_nSamplerate, 0); // Set g_dTicksPerFrame
+    if (g_pJackClient)
+        g_nSamplerate = jack_get_sample_rate(g_pJackClient);
+    onJackSamplerate(g_nSamplerate, 0);
 
     return true;
 }
 
 void removePlayer() {
+    CAPTURE_API(removePlayer);
     if (g_pMidiOutputPort)
-        jack_port_unregister(g_pJackClient, g_pMidiOutputPort);
+        ioUnregisterPort(g_pJackClient, g_pMidiOutputPort);
     g_pMidiOutputPort = NULL;
+    for (uint8_t nOutput = 1; nOutput < MAX_OUTPUTS; ++nOutput) {
+        if (g_apMidiOutputPorts[nOutput])
+            ioUnregisterPort(g_pJackClient, g_apMidiOutputPorts[nOutput]);
+        g_apMidiOutputPorts[nOutput] = NULL;
+    }
     if (!g_pRecorderSmf)
         removeJackClient();
     g_pPlayerSmf = NULL;
 }
 
-void setLoop(bool bLoop) { g_bLoop = bLoop; }
+void setLoop(bool bLoop) {
+    CAPTURE_API(setLoop, bLoop);
+    g_bLoop = bLoop;
+}
 
 void startPlayback() {
-    if (!g_pJackClient)
+    CAPTURE_API(startPlayback);
+    if (!g_pJackClient && !replayIsRunning())
         return;
-    g_dPosition  = 0.0;
-    g_nPlayState = STARTING;
+    g_dPosition       = 0.0;
+    g_dTransportBpm   = 0.0;
+    g_dTransportScale = 1.0;
+    g_nPlayState      = STARTING;
 }
 
 void stopPlayback() {
+    CAPTURE_API(stopPlayback);
     if (g_nPlayState == STOPPED)
         return;
     g_nPlayState = STOPPING;
@@ -538,13 +870,43 @@ void stopPlayback() {
 
 uint8_t getPlayState() { return g_nPlayState; }
 
+void setPlaybackRate(double dRate) {
+    CAPTURE_API(setPlaybackRate, dRate);
+    if (dRate < MIN_PLAYBACK_RATE || dRate > MAX_PLAYBACK_RATE)
+        return;
+    g_dPlaybackRate = dRate;
+}
+
+double getPlaybackRate() { return g_dPlaybackRate; }
+
+void setPlaybackTempo(double dTempo) {
+    CAPTURE_API(setPlaybackTempo, dTempo);
+    setPlaybackRate(getRateForTempo(dTempo));
+}
+
+double getPlaybackTempo() {
+    if (!g_pPlayerSmf)
+        return 0.0;
+    return 60000000.0 * g_dPlaybackRate / g_pPlayerSmf->getMicrosecondsPerQuarterNote(0);
+}
+
+void setTransportTempoFollow(bool bEnable) {
+    CAPTURE_API(setTransportTempoFollow, bEnable);
+    g_bFollowTransport = bEnable;
+    if (!bEnable)
+        g_dTransportScale = 1.0;
+}
+
+bool getTransportTempoFollow() { return g_bFollowTransport; }
+
 bool attachRecorder(Smf* pSmf) {
+    CAPTURE_API(attachRecorder, pSmf);
     if (!isSmfValid(pSmf))
         return false;
     if (!createJackClient())
         return false;
     if (!g_pMidiInputPort)
-        g_pMidiInputPort = jack_port_register(g_pJackClient, "midi_in", JACK_DEFAULT_MIDI_TYPE, JackPortIsInput, 0);
+        g_pMidiInputPort = ioRegisterPort(g_pJackClient, "midi_in", JackPortIsInput, IO_PORT_INPUT);
     if (!g_pMidiInputPort) {
         removeRecorder();
         DPRINTF("Failed to create JACK input port\n");
@@ -552,14 +914,16 @@ bool attachRecorder(Smf* pSmf) {
     }
     DPRINTF("Created new JACK recorder\n");
     g_pRecorderSmf = pSmf;
-    g_nSamplerate  = jack_get_sample_rate(g_pJackClient);
+    if (g_pJackClient)
+        g_nSamplerate = jack_get_sample_rate(g_pJackClient);
     onJackSamplerate(g_nSamplerate, 0); // Set g_dRecorderTicksPerFrame
     return true;
 }
 
 void removeRecorder() {
+    CAPTURE_API(removeRecorder);
     if (g_pMidiInputPort)
-        jack_port_unregister(g_pJackClient, g_pMidiInputPort);
+        ioUnregisterPort(g_pJackClient, g_pMidiInputPort);
     g_pMidiInputPort = NULL;
     if (!g_pPlayerSmf)
         removeJackClient();
@@ -567,6 +931,7 @@ void removeRecorder() {
 }
 
 void startRecording() {
+    CAPTURE_API(startRecording);
     if (!g_pMidiInputPort || !g_pRecorderSmf)
         return;
     g_nRecordStartPosition = 0; // Set start time to 0 so that first MIDI event will update and mark actual start of recording
@@ -578,7 +943,7 @@ void startRecording() {
             g_aRecNotes[ch][note] = false;
 
     jack_position_t transport_position;
-    jack_transport_state_t nTransportState = jack_transport_query(g_pJackClient, &transport_position);
+    jack_transport_state_t nTransportState = ioTransportQuery(g_pJackClient, &transport_position);
     double dBeatsPerMinute                 = transport_position.beats_per_minute;
     g_nMicrosecondsPerQuarterNote          = 60000000.0 / dBeatsPerMinute;
     g_dRecorderTicksPerFrame = double(g_pRecorderSmf->getTicksPerQuarterNote()) / ((double(g_nMicrosecondsPerQuarterNote) / 1000000) * double(g_nSamplerate));
@@ -587,6 +952,7 @@ void startRecording() {
 }
 
 void stopRecording() {
+    CAPTURE_API(stopRecording);
     if (!g_bRecording)
         return;
     g_bRecording = false;
@@ -597,7 +963,7 @@ void stopRecording() {
                 uint8_t* pData     = new uint8_t[2];
                 *pData             = note;
                 *(pData + 1)       = 0;
-                uint32_t nPosition = jack_frame_time(g_pJackClient) - g_nRecordStartPosition; // Time of event in samples since start of recording
+                uint32_t nPosition = ioFrameTime(g_pJackClient) - g_nRecordStartPosition; // Time of event in samples since start of recording
                 Event* pEvent      = new Event(g_dRecorderTicksPerFrame * nPosition, EVENT_TYPE_MIDI, MIDI_NOTE_OFF, 2, pData);
                 g_pRecorderSmf->addEvent(chan, pEvent); // Add event to a track based on its MIDI channel
             }
@@ -614,6 +980,7 @@ double getTempo(Smf* pSmf, uint32_t nTime) {
 }
 
 void printEvents(Smf* pSmf, size_t nTrack) {
+    CAPTURE_API(printEvents, pSmf, nTrack); // Moves event cursor used by player
     printf("Print events for track %lu\n", nTrack);
     if (!isSmfValid(pSmf))
         return;
@@ -636,6 +1003,7 @@ void printEvents(Smf* pSmf, size_t nTrack) {
 }
 
 void muteTrack(Smf* pSmf, size_t nTrack, bool bMute) {
+    CAPTURE_API(muteTrack, pSmf, nTrack, bMute);
     if (!isSmfValid(pSmf))
         return;
     pSmf->muteTrack(nTrack, bMute);
@@ -649,8 +1017,193 @@ bool isTrackMuted(Smf* pSmf, size_t nTrack) {
 }
 
 void setTranspose(int8_t nTranspose) {
+    CAPTURE_API(setTranspose, nTranspose);
     g_bClearHanging = true;
     g_nTranspose    = nTranspose;
+    compileRoutes();
 }
 
 uint8_t getTranspose() { return g_nTranspose; }
+
+bool setTrackOutput(size_t nTrack, uint8_t nOutput) {
+    CAPTURE_API(setTrackOutput, nTrack, nOutput);
+    if (nOutput >= MAX_OUTPUTS)
+        return false;
+    if (g_pMidiOutputPort && !createOutputPort(nOutput))
+        return false;
+    g_bClearHanging          = true;
+    getRoute(nTrack)->output = nOutput;
+    return true;
+}
+
+uint8_t getTrackOutput(size_t nTrack) { return getRoute(nTrack)->output; }
+
+void setTrackChannel(size_t nTrack, int8_t nChannel) {
+    CAPTURE_API(setTrackChannel, nTrack, nChannel);
+    if (nChannel > 15)
+        return;
+    TRACK_ROUTE* pRoute = getRoute(nTrack);
+    g_bClearHanging     = true;
+    pRoute->channel     = nChannel < 0 ? -1 : nChannel;
+    compileRoute(pRoute);
+}
+
+int8_t getTrackChannel(size_t nTrack) { return getRoute(nTrack)->channel; }
+
+void setTrackTranspose(size_t nTrack, int8_t nTranspose) {
+    CAPTURE_API(setTrackTranspose, nTrack, nTranspose);
+    TRACK_ROUTE* pRoute = getRoute(nTrack);
+    g_bClearHanging     = true;
+    pRoute->transpose   = nTranspose;
+    compileRoute(pRoute);
+}
+
+int8_t getTrackTranspose(size_t nTrack) { return getRoute(nTrack)->transpose; }
+
+void setTrackVelocityCurve(size_t nTrack, int8_t nCurve) {
+    CAPTURE_API(setTrackVelocityCurve, nTrack, nCurve);
+    if (nCurve < -100)
+        nCurve = -100;
+    if (nCurve > 100)
+        nCurve = 100;
+    TRACK_ROUTE* pRoute   = getRoute(nTrack);
+    pRoute->velocityCurve = nCurve;
+    compileRoute(pRoute);
+}
+
+int8_t getTrackVelocityCurve(size_t nTrack) { return getRoute(nTrack)->velocityCurve; }
+
+void resetTrackRoutes() {
+    CAPTURE_API(resetTrackRoutes);
+    g_bClearHanging = true;
+    for (size_t nTrack = 0; nTrack <= MAX_ROUTED_TRACKS; ++nTrack) {
+        g_aTrackRoutes[nTrack].output        = 0;
+        g_aTrackRoutes[nTrack].channel       = -1;
+        g_aTrackRoutes[nTrack].transpose     = 0;
+        g_aTrackRoutes[nTrack].velocityCurve = 0;
+    }
+    compileRoutes();
+}
+
+bool addIndexPath(const char* path, bool recursive) { return g_SmfIndex.addPath(path, recursive); }
+
+uint32_t getIndexPending() { return g_SmfIndex.getPending(); }
+
+uint32_t queryIndex(const char** paths, uint32_t count, SMF_INFO* info) {
+    if (!paths || !info)
+        return 0;
+    return g_SmfIndex.query(paths, count, info);
+}
+
+size_t getIndexTrackName(const char* path, uint16_t track, char* name, size_t size) { return g_SmfIndex.getTrackName(path, track, name, size); }
+
+bool saveIndex(const char* filename) { return g_SmfIndex.save(filename); }
+
+bool loadIndex(const char* filename) { return g_SmfIndex.load(filename); }
+
+void clearIndex() { g_SmfIndex.clear(); }
+
+// ** Capture and replay **
+
+// Call a captured API function during replay
+static void replayApi(uint16_t id, const uint8_t* pArgs) {
+    switch (id) {
+#define CAPTURE_API_REPLAY(fn)                                                                                                                                 \
+    case API_##fn:                                                                                                                                             \
+        replayApiCall(fn, pArgs);                                                                                                                              \
+        break;
+        CAPTURE_API_LIST(CAPTURE_API_REPLAY)
+#undef CAPTURE_API_REPLAY
+    default:
+        fprintf(stderr, "libzynsmf replay ignoring unknown API call %u\n", id);
+    }
+}
+
+// Replay a process thread record - returns -1 if outputs match
+static int32_t replayRecord(uint8_t type, const void* pPayload, uint32_t nSize, bool bOverlap) {
+    if (type == CAPTURE_RECORD_STATE) {
+        RUNTIME_STATE state;
+        memcpy(&state, pPayload, sizeof(state));
+        setRuntimeState(&state);
+    } else if (type == CAPTURE_RECORD_PERIOD) {
+        const CAPTURE_PERIOD_DATA* pPeriod = (const CAPTURE_PERIOD_DATA*)pPayload;
+        if (!replaySetPeriod(pPeriod))
+            return -2;
+        onJackProcess(pPeriod->frames, NULL);
+        uint64_t nOutput, nRecorder;
+        replayGetPeriodHashes(&nOutput, &nRecorder);
+        if (nOutput != pPeriod->outputHash || nRecorder != pPeriod->recorderHash) {
+            fprintf(stderr, "libzynsmf replay: period %u differs (MIDI output %s, recorder %s)\n", pPeriod->period,
+                    nOutput == pPeriod->outputHash ? "same" : "differs", nRecorder == pPeriod->recorderHash ? "same" : "differs");
+            if (bOverlap)
+                fprintf(stderr, "libzynsmf replay: an API call overlapped period %u during capture\n", pPeriod->period);
+            return pPeriod->period;
+        }
+    }
+    return -1;
+}
+
+bool startCapture(const char* filename) {
+    if (!g_pJackClient || captureIsRunning() || replayIsRunning())
+        return false;
+    // Capture must start with player stopped so that its state is fully described by saved file and runtime state
+    if (g_nPlayState != STOPPED || g_bRecording) {
+        fprintf(stderr, "libzynsmf cannot start capture whilst playing or recording\n");
+        return false;
+    }
+    std::string sPlayer   = std::string(filename) + ".mid";
+    std::string sRecorder = std::string(filename) + ".rec.mid";
+    // Empty SMF are not saved so replay starts them empty
+    remove(sPlayer.c_str());
+    remove(sRecorder.c_str());
+    if (g_pPlayerSmf && g_pPlayerSmf->getEvents() > 1 && !g_pPlayerSmf->save((char*)sPlayer.c_str()))
+        return false;
+    if (g_pRecorderSmf && g_pRecorderSmf->getEvents() > 1 && !g_pRecorderSmf->save((char*)sRecorder.c_str()))
+        return false;
+    // Reset event cursor so that live player matches the file that replay will load
+    if (g_pPlayerSmf)
+        g_pPlayerSmf->setPosition(g_pPlayerSmf->getPosition());
+    if (!captureStart(filename, "zynsmf", CAPTURE_VERSION, g_nSamplerate, 0, sizeof(RUNTIME_STATE)))
+        return false;
+    captureArm();
+    return true;
+}
+
+void stopCapture() { captureStop(); }
+
+bool isCapturing() { return captureIsRunning(); }
+
+int32_t replayCapture(const char* filename) {
+    if (g_pJackClient || captureIsRunning() || replayIsRunning())
+        return -2; // Replay drives the process callbacks so must not run alongside JACK
+    CAPTURE_HEADER header;
+    if (!replayOpen(filename, "zynsmf", CAPTURE_VERSION, sizeof(RUNTIME_STATE), &header))
+        return -2;
+
+    // Restore SMF at start of capture (runtime state removes those that were not attached)
+    replayStart();
+    g_nSamplerate         = header.sampleRate;
+    std::string sPlayer   = std::string(filename) + ".mid";
+    std::string sRecorder = std::string(filename) + ".rec.mid";
+    g_pPlayerSmf          = addSmf();
+    if (!g_pPlayerSmf->load((char*)sPlayer.c_str()))
+        g_pPlayerSmf->unload();
+    g_pRecorderSmf = addSmf();
+    if (!g_pRecorderSmf->load((char*)sRecorder.c_str()))
+        g_pRecorderSmf->unload();
+    int32_t nResult = replayRun(replayRecord, replayApi);
+
+    // Release replay state
+    Smf* pPlayer   = g_pPlayerSmf;
+    Smf* pRecorder = g_pRecorderSmf;
+    removePlayer();
+    removeRecorder();
+    removeSmf(pPlayer);
+    removeSmf(pRecorder);
+    g_nPlayState = STOPPED;
+    g_bRecording = false;
+    m_mHangingMidi.clear();
+    replayStop();
+    replayClose();
+    return nResult;
+}
@@ -5,6 +5,7 @@
 //!@todo Add license
 
 #include "smf.h"
+#include "smfindex.h"
 #include <cstdint>
 
 #ifdef __cplusplus
@@ -186,6 +187,39 @@ void stopPlayback();
  */
 uint8_t getPlayState();
 
+/** @brief  Set playback rate
+ *   @param  dRate Playback speed relative to song tempo [0.1..4.0], e.g. 0.8 to play at 80%
+ *   @note   Tempo changes within song are scaled by playback rate
+ */
+void setPlaybackRate(double dRate);
+
+/** @brief  Get playback rate
+ *   @retval double Playback speed relative to song tempo
+ */
+double getPlaybackRate();
+
+/** @brief  Set playback rate so that start of song plays at a tempo
+ *   @param  dTempo Tempo in BPM
+ *   @note   Player must be attached. Tempo changes within song are scaled proportionally.
+ */
+void setPlaybackTempo(double dTempo);
+
+/** @brief  Get tempo that start of song plays at
+ *   @retval double Tempo in BPM or 0 if player not attached
+ */
+double getPlaybackTempo();
+
+/** @brief  Set whether playback follows JACK transport tempo
+ *   @param  bEnable True to scale playback rate by changes of JACK transport tempo during playback
+ *   @note   Playback rate set by setPlaybackRate or setPlaybackTempo is retained and restored when disabled or playback restarts
+ */
+void setTransportTempoFollow(bool bEnable);
+
+/** @brief  Get whether playback follows JACK transport tempo
+ *   @retval bool True if following JACK transport tempo
+ */
+bool getTransportTempoFollow();
+
 /** @brief  Create a JACK client if it does note exist and attach JACK recorder to a SMF
  *   @param  pSmf Pointer to the SMF
  *   @retval bool True on success
@@ -247,6 +281,137 @@ void setTranspose(int8_t nTranspose);
  */
 uint8_t getTranspose();
 
+/** @brief  Set output port of a track
+ *   @param  nTrack Index of track
+ *   @param  nOutput Index of output port [0..15] (0 = midi_out, others midi_out_<nOutput + 1>)
+ *   @retval bool True on success
+ *   @note   Output ports are created on demand when player is attached
+ *   @note   Tracks above 63 share a common route
+ */
+bool setTrackOutput(size_t nTrack, uint8_t nOutput);
+
+/** @brief  Get output port of a track
+ *   @param  nTrack Index of track
+ *   @retval uint8_t Index of output port
+ */
+uint8_t getTrackOutput(size_t nTrack);
+
+/** @brief  Set MIDI channel that a track's channel messages are remapped to
+ *   @param  nTrack Index of track
+ *   @param  nChannel MIDI channel [0..15] or -1 to retain original channel
+ */
+void setTrackChannel(size_t nTrack, int8_t nChannel);
+
+/** @brief  Get MIDI channel that a track's channel messages are remapped to
+ *   @param  nTrack Index of track
+ *   @retval int8_t MIDI channel or -1 if not remapped
+ */
+int8_t getTrackChannel(size_t nTrack);
+
+/** @brief  Set transpose of a track
+ *   @param  nTrack Index of track
+ *   @param  nTranspose +/- semitones to transpose track (added to global transpose)
+ *   @note   Out of range notes are ignored
+ */
+void setTrackTranspose(size_t nTrack, int8_t nTranspose);
+
+/** @brief  Get transpose of a track
+ *   @param  nTrack Index of track
+ *   @retval int8_t +/- semitones track is transposed
+ */
+int8_t getTrackTranspose(size_t nTrack);
+
+/** @brief  Set note-on velocity curve of a track
+ *   @param  nTrack Index of track
+ *   @param  nCurve Velocity curve [-100..100] (0 = linear, positive = louder)
+ */
+void setTrackVelocityCurve(size_t nTrack, int8_t nCurve);
+
+/** @brief  Get note-on velocity curve of a track
+ *   @param  nTrack Index of track
+ *   @retval int8_t Velocity curve
+ */
+int8_t getTrackVelocityCurve(size_t nTrack);
+
+/** @brief  Reset all tracks to main output without remapping
+ */
+void resetTrackRoutes();
+
+/** @brief  Queue a directory or file to be indexed by background worker thread
+ *   @param  path Full path of directory or SMF
+ *   @param  recursive True to also index subdirectories
+ *   @retval bool True if queued
+ *   @note   Only header and meta events are read so indexing is much faster than load
+ */
+bool addIndexPath(const char* path, bool recursive);
+
+/** @brief  Get quantity of paths waiting to be indexed
+ *   @retval uint32_t Quantity of queued paths (0 when indexing is complete)
+ */
+uint32_t getIndexPending();
+
+/** @brief  Get summaries of a batch of files from index
+ *   @param  paths Array of full paths of SMF
+ *   @param  count Quantity of paths
+ *   @param  info Array of count SMF_INFO structures to populate
+ *   @retval uint32_t Quantity of files that are indexed and up to date
+ *   @note   Files not yet indexed or changed since indexed are marked not valid and queued for indexing
+ */
+uint32_t queryIndex(const char** paths, uint32_t count, SMF_INFO* info);
+
+/** @brief  Get name of a track from index
+ *   @param  path Full path of SMF
+ *   @param  track Index of track
+ *   @param  name Buffer to populate with null terminated name
+ *   @param  size Size of buffer
+ *   @retval size_t Length of name or 0 if not indexed or track has no name
+ */
+size_t getIndexTrackName(const char* path, uint16_t track, char* name, size_t size);
+
+/** @brief  Save index to cache file
+ *   @param  filename Full path and name of cache file
+ *   @retval bool True on success
+ */
+bool saveIndex(const char* filename);
+
+/** @brief  Load index from cache file, merging with existing entries
+ *   @param  filename Full path and name of cache file
+ *   @retval bool True on success
+ */
+bool loadIndex(const char* filename);
+
+/** @brief  Clear index
+ */
+void clearIndex();
+
+// ** Capture and replay **
+
+/** @brief  Start capturing player and recorder process inputs to a log that may be replayed offline to reproduce a problem
+ *   @param  filename Full path and filename of log (player and recorder SMF are saved alongside with ".mid" and ".rec.mid" appended)
+ *   @retval bool True on success, false if no JACK client, already capturing, playing, recording or files cannot be written
+ *   @note   Records each period's MIDI input, frame time and transport position, API calls that change player or recorder state and a hash of each
+ *           period's MIDI output and of events added to the recorder.
+ *   @note   Only SMF attached as player or recorder when capture starts are reproduced. API calls on other SMF are replayed as no-ops.
+ *   @note   A file loaded during capture is reloaded from the same path by replay so must not change before replay.
+ */
+bool startCapture(const char* filename);
+
+/** @brief  Stop capturing process inputs, flushing log to file
+ */
+void stopCapture();
+
+/** @brief  Check if capturing process inputs
+ *   @retval bool True if capturing
+ */
+bool isCapturing();
+
+/** @brief  Replay a capture log offline and compare outputs bit-for-bit with those captured
+ *   @param  filename Full path and filename of log
+ *   @retval int32_t Index of first period whose output differs, -1 if all outputs match, -2 if log cannot be replayed
+ *   @note   Must run in a process that has not attached a player or recorder (no JACK client)
+ */
+int32_t replayCapture(const char* filename);
+
 #ifdef __cplusplus
 }
 #endif
@@ -68,6 +68,25 @@ PLAY_STATE_PLAYING = 2
 PLAY_STATE_STOPPING = 3
 
 
+# Summary of a MIDI file from the index (must match SMF_INFO in smfindex.h)
+class SmfInfo(ctypes.Structure):
+    _fields_ = [
+        ("valid", ctypes.c_uint8),
+        ("format", ctypes.c_uint8),
+        ("tracks", ctypes.c_uint16),
+        ("ticksPerQuarterNote", ctypes.c_uint16),
+        ("timeSigNumerator", ctypes.c_uint8),
+        ("timeSigDenominator", ctypes.c_uint8),
+        ("keySharps", ctypes.c_int8),
+        ("keyMinor", ctypes.c_uint8),
+        ("tempoChanges", ctypes.c_uint32),
+        ("events", ctypes.c_uint32),
+        ("durationTicks", ctypes.c_uint32),
+        ("tempo", ctypes.c_double),
+        ("duration", ctypes.c_double)
+    ]
+
+
 # -------------------------------------------------------------------------------
 # Zynthian Standard MIDI File Library Wrapper
 #
@@ -107,10 +126,47 @@ def init():
         libsmf.attachRecorder.argtypes = [ctypes.c_ulong]
         libsmf.getTempo.argtypes = [ctypes.c_ulong, ctypes.c_uint]
         libsmf.getTempo.restype = ctypes.c_double
+        libsmf.setPlaybackRate.argtypes = [ctypes.c_double]
+        libsmf.getPlaybackRate.restype = ctypes.c_double
+        libsmf.setPlaybackTempo.argtypes = [ctypes.c_double]
+        libsmf.getPlaybackTempo.restype = ctypes.c_double
+        libsmf.setTransportTempoFollow.argtypes = [ctypes.c_bool]
+        libsmf.getTransportTempoFollow.restype = ctypes.c_bool
         libsmf.printEvents.argtypes = [ctypes.c_ulong, ctypes.c_uint]
         libsmf.muteTrack.argtypes = [
             ctypes.c_ulong, ctypes.c_uint, ctypes.c_ubyte]
         libsmf.isTrackMuted.argtypes = [ctypes.c_ulong, ctypes.c_uint]
+        libsmf.setTrackOutput.argtypes = [ctypes.c_ulong, ctypes.c_ubyte]
+        libsmf.setTrackOutput.restype = ctypes.c_bool
+        libsmf.getTrackOutput.argtypes = [ctypes.c_ulong]
+        libsmf.getTrackOutput.restype = ctypes.c_ubyte
+        libsmf.setTrackChannel.argtypes = [ctypes.c_ulong, ctypes.c_byte]
+        libsmf.getTrackChannel.argtypes = [ctypes.c_ulong]
+        libsmf.getTrackChannel.restype = ctypes.c_byte
+        libsmf.setTrackTranspose.argtypes = [ctypes.c_ulong, ctypes.c_byte]
+        libsmf.getTrackTranspose.argtypes = [ctypes.c_ulong]
+        libsmf.getTrackTranspose.restype = ctypes.c_byte
+        libsmf.setTrackVelocityCurve.argtypes = [ctypes.c_ulong, ctypes.c_byte]
+        libsmf.getTrackVelocityCurve.argtypes = [ctypes.c_ulong]
+        libsmf.getTrackVelocityCurve.restype = ctypes.c_byte
+        libsmf.addIndexPath.argtypes = [ctypes.c_char_p, ctypes.c_bool]
+        libsmf.addIndexPath.restype = ctypes.c_bool
+        libsmf.getIndexPending.restype = ctypes.c_uint32
+        libsmf.queryIndex.argtypes = [ctypes.POINTER(
+            ctypes.c_char_p), ctypes.c_uint32, ctypes.POINTER(SmfInfo)]
+        libsmf.queryIndex.restype = ctypes.c_uint32
+        libsmf.getIndexTrackName.argtypes = [
+            ctypes.c_char_p, ctypes.c_uint16, ctypes.c_char_p, ctypes.c_size_t]
+        libsmf.getIndexTrackName.restype = ctypes.c_size_t
+        libsmf.saveIndex.argtypes = [ctypes.c_char_p]
+        libsmf.saveIndex.restype = ctypes.c_bool
+        libsmf.loadIndex.argtypes = [ctypes.c_char_p]
+        libsmf.loadIndex.restype = ctypes.c_bool
+        libsmf.startCapture.argtypes = [ctypes.c_char_p]
+        libsmf.startCapture.restype = ctypes.c_bool
+        libsmf.isCapturing.restype = ctypes.c_bool
+        libsmf.replayCapture.argtypes = [ctypes.c_char_p]
+        libsmf.replayCapture.restype = ctypes.c_int32
     except Exception as e:
         libsmf = None
         print(f"Can't initialise zynsmf library: {e}")
@@ -143,4 +199,88 @@ def save(smf, filename):
         return libsmf.save(ctypes.c_ulong(smf), bytes(filename, "utf-8"))
     return False
 
+
+# Queue a directory or file to be indexed in background
+#  path: Full path of directory or MIDI file
+#  recursive: True to index subdirectories
+#  Returns: True on success
+def add_index_path(path, recursive=False):
+    if libsmf:
+        return libsmf.addIndexPath(bytes(path, "utf-8"), recursive)
+    return False
+
+
+# Get summaries of a batch of MIDI files from index
+#  paths: List of full paths and filenames
+#  Returns: List of SmfInfo (valid member is 0 if file not yet indexed)
+def query_index(paths):
+    if not libsmf or not paths:
+        return []
+    c_paths = (ctypes.c_char_p * len(paths))(*[bytes(path, "utf-8") for path in paths])
+    info = (SmfInfo * len(paths))()
+    libsmf.queryIndex(c_paths, len(paths), info)
+    return list(info)
+
+
+# Get track name of an indexed MIDI file
+#  path: Full path and filename
+#  track: Index of track
+#  Returns: Track name or empty string if not indexed or unnamed
+def get_index_track_name(path, track):
+    if libsmf:
+        name = ctypes.create_string_buffer(256)
+        libsmf.getIndexTrackName(bytes(path, "utf-8"), track, name, 256)
+        return name.value.decode("utf-8", "replace")
+    return ""
+
+
+# Save index to cache file
+#  filename: Full path and filename
+#  Returns: True on success
+def save_index(filename):
+    if libsmf:
+        return libsmf.saveIndex(bytes(filename, "utf-8"))
+    return False
+
+
+# Load index from cache file
+#  filename: Full path and filename
+#  Returns: True on success
+def load_index(filename):
+    if libsmf:
+        return libsmf.loadIndex(bytes(filename, "utf-8"))
+    return False
+
+
+# Start capturing player and recorder process inputs to a log for offline replay
+#  filename: Full path and filename of log
+#  Returns: True on success
+def start_capture(filename):
+    if libsmf:
+        return libsmf.startCapture(bytes(filename, "utf-8"))
+    return False
+
+
+# Stop capturing process inputs
+def stop_capture():
+    if libsmf:
+        libsmf.stopCapture()
+
+
+# Check if capturing process inputs
+#  Returns: True if capturing
+def is_capturing():
+    if libsmf:
+        return libsmf.isCapturing()
+    return False
+
+
+# Replay a capture log offline (must not have attached player or recorder in this process)
+#  filename: Full path and filename of log
+#  Returns: Index of first period that differs, -1 if all match, -2 on error
+def replay_capture(filename):
+    if libsmf:
+        return libsmf.replayCapture(bytes(filename, "utf-8"))
+    return -2
+
 # -------------------------------------------------------------------------------